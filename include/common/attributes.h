@@ -66,6 +66,43 @@
 #define NOINLINE __attribute__((noinline))
 #endif /* !_MSC_VER */
 
+/*
+ * Force inlining of a function, e.g. so that constant arguments are
+ * propagated into its body:
+ * static ALWAYS_INLINE void func() {}
+ */
+#ifdef _MSC_VER
+#define ALWAYS_INLINE __forceinline
+#else /* !_MSC_VER */
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#endif /* !_MSC_VER */
+
+/*
+ * Check the arguments of a function taking a printf() format string:
+ * void func(int arg, const char *fmt, ...) ATTR_FORMAT_PRINTF(2, 3);
+ */
+#if defined(__MINGW32__)
+#define ATTR_FORMAT_PRINTF(fmt, attr) \
+    __attribute__((__format__(__gnu_printf__, fmt, attr)))
+#elif defined(__GNUC__)
+#define ATTR_FORMAT_PRINTF(fmt, attr) \
+    __attribute__((__format__(__printf__, fmt, attr)))
+#else
+#define ATTR_FORMAT_PRINTF(fmt, attr)
+#endif
+
+/*
+ * Hint that the cache line holding an address will be read soon:
+ * dav1d_prefetch(ptr);
+ */
+#if defined(__GNUC__)
+#define dav1d_prefetch(p) __builtin_prefetch(p)
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define dav1d_prefetch(p) _mm_prefetch((const char *) (p), _MM_HINT_T0)
+#else
+#define dav1d_prefetch(p) ((void) (p))
+#endif
+
 #if defined(__GNUC__) && !defined(__INTEL_COMPILER) && !defined(__clang__)
 #    define dav1d_uninit(x) x=x
 #else
@@ -68,6 +68,10 @@ static inline unsigned rl32(const uint8_t *const ptr) {
     return (rl16(&ptr[2]) << 16) | rl16(ptr);
 }
 
+static inline uint64_t rl64(const uint8_t *const ptr) {
+    return (((uint64_t) rl32(&ptr[4])) << 32) | rl32(ptr);
+}
+
 static inline unsigned inv_recenter(const unsigned r, const unsigned v) {
     if (v > (r << 1))
         return v;
@@ -28,20 +28,204 @@
 #ifndef __DAV1D_H__
 #define __DAV1D_H__
 
+#include <stdarg.h>
+
 #include "common.h"
 #include "picture.h"
 #include "data.h"
 
 typedef struct Dav1dContext Dav1dContext;
 typedef struct Dav1dRef Dav1dRef;
+typedef struct Dav1dThreadPool Dav1dThreadPool;
+
+enum Dav1dDecodeFrameType {
+    DAV1D_DECODEFRAMETYPE_ALL, ///< all frames
+    DAV1D_DECODEFRAMETYPE_REFERENCE, ///< frames used as reference (i.e.
+                                     ///< skip the ones that refresh none)
+    DAV1D_DECODEFRAMETYPE_INTRA, ///< key and intra-only frames
+    DAV1D_DECODEFRAMETYPE_KEY, ///< key frames
+};
+
+enum Dav1dNonRefFilters {
+    DAV1D_NONREFFILTERS_ALL, ///< apply all post-filters
+    DAV1D_NONREFFILTERS_DEBLOCK, ///< skip CDEF and loop restoration
+    DAV1D_NONREFFILTERS_NONE, ///< skip deblocking, CDEF and loop restoration
+};
+
+enum Dav1dTraceEventType {
+    DAV1D_TRACE_FRAME, ///< decoding of a frame (both passes, if any)
+    DAV1D_TRACE_TILE_SBROW, ///< decoding of a superblock row of the tiles
+                            ///< (sby), or of a whole tile (sby = -1)
+    DAV1D_TRACE_DEBLOCK, ///< post-filter stages of a superblock row (sby)
+    DAV1D_TRACE_CDEF,
+    DAV1D_TRACE_LR,
+    DAV1D_TRACE_WAIT_REF, ///< waiting for a reference frame to be decoded
+                          ///< far enough, while decoding sbrow sby
+    DAV1D_TRACE_WAIT_TILE, ///< frame thread waiting for tile progress or
+                           ///< tasks run by the tile workers
+    DAV1D_TRACE_WAIT_FRAME_THREAD, ///< waiting for the frame thread decoding
+                                   ///< the frame (poc) to become free for a
+                                   ///< new frame
+    DAV1D_TRACE_WAIT_WAVEFRONT, ///< waiting for the sbrow above sby to be
+                                ///< reconstructed far enough (wavefront
+                                ///< reconstruction within a tile)
+};
+
+typedef struct Dav1dTraceEvent {
+    enum Dav1dTraceEventType type;
+    int end; // 0 at the beginning of the span, 1 at its end
+    uint64_t time; // monotonic clock, in nanoseconds
+    // thread the event happened on: 0 for the thread calling into the
+    // decoder, 1 + n for frame thread n, and -1 - m for tile worker m (of
+    // the thread pool, which may be shared with other decoders)
+    int thread;
+    unsigned poc; // frame_offset of the frame
+    int sby; // superblock row, or -1
+} Dav1dTraceEvent;
 
 typedef struct Dav1dSettings {
-    int n_frame_threads;
-    int n_tile_threads;
+    int n_frame_threads; // 0 = auto
+    int n_tile_threads; // tile worker threads, shared by all frame threads;
+                        // 0 = auto (one per logical processor)
+    // Logical processors that the frame and tile threads created by the
+    // context may run on (NULL = no restriction), which also sets the
+    // automatic thread counts. Picture buffers are first written by these
+    // threads, so restricting them to the processors of one NUMA node keeps
+    // reference pictures on that node. Ignored where unsupported.
+    const int *cpus;
+    int n_cpus;
+    // Tile worker threads to use instead of creating n_tile_threads of the
+    // context's own (NULL = own threads), see dav1d_thread_pool_create().
+    Dav1dThreadPool *thread_pool;
+    // Maximum number of frames decoded in parallel (0 = n_frame_threads),
+    // which bounds the output delay independently of the thread counts.
+    int max_frame_delay;
+    // If set, with frame threading, dav1d_decode() returns each picture as
+    // soon as it (and any picture before it) is fully decoded, rather than
+    // once its frame thread is needed for a new frame.
+    int low_latency;
+    // If set, with a single frame thread (n_frame_threads = 1) and tile
+    // threads, each frame is decoded in two passes, like with frame
+    // threading: the thread decoding it parses its symbols, while the tile
+    // threads reconstruct and post-filter the superblock rows parsed so far.
+    // This overlaps the entropy decoding with the pixel work without adding
+    // a frame of delay, at the cost of the memory for the parsed block and
+    // coefficient data of a frame. Frames using intra block copy are still
+    // decoded in one pass.
+    int parse_ahead;
+    // Maximum number of rounds (of a CPU pause instruction, each a few to
+    // some tens of nanoseconds) that a thread waiting for the progress of
+    // another (a reference frame, the entropy context of the previous frame,
+    // or the tiles of its frame) spins for before it goes to sleep; the
+    // rounds actually spun adapt to how long recent waits took. Spinning
+    // saves the latency of a sleep and wake-up, at the cost of CPU time that
+    // other processes could use. 0 (the default) means never spin.
+    int spin_wait;
+    // If set (the default), on processors with cores of different speeds
+    // (ARM big.LITTLE, Intel P- and E-cores), the frame threads, which parse
+    // their frames serially, only run on the faster cores (of cpus, if set),
+    // while the tile workers run on all of them. Linux only.
+    int performance_cores;
+    // Maximum number of unused picture buffers kept for reuse by later
+    // pictures of the same size (0 = auto, enough for all reference and
+    // in-flight pictures).
+    int max_pooled_pictures;
+    // Callbacks to allocate picture buffers in the caller's memory (e.g.
+    // for zero-copy output); the internal pool is not used if they are set.
+    Dav1dPicAllocator allocator;
+    // If set, minimize memory use at some cost in throughput: frames are
+    // decoded one at a time (n_frame_threads = 0 means 1 rather than auto),
+    // avoiding the full-frame data passed between frame threads, at most one
+    // unused buffer of each kind is kept for reuse (unless
+    // max_pooled_pictures is set), and pictures are only padded to the
+    // superblock size. Tile threads are unaffected.
+    int low_memory;
+    // If set, back the internally allocated pictures and the per-frame
+    // working buffers (including the frame-threading block and coefficient
+    // data) with transparent hugepages where the OS supports them, to
+    // reduce TLB misses when accessing large frames.
+    int hugepages;
+    // If set, each output picture is passed to picture_ready() (with
+    // picture_ready_cookie) as soon as it, and all pictures before it, are
+    // decoded, instead of being returned by dav1d_decode() or
+    // dav1d_get_picture(); low_latency is implied. With frame threading, it
+    // is called from the frame thread that finished decoding the picture
+    // (never concurrently), else from the thread decoding the data. The
+    // callback takes over the reference to the picture (see
+    // dav1d_picture_unref()), and must not call back into the decoder.
+    void (*picture_ready)(Dav1dPicture *pic, void *cookie);
+    void *picture_ready_cookie;
+    // Frames to decode (and output); the tile data of others is dropped
+    // as soon as their frame header is parsed, e.g. for thumbnails or
+    // trick play. Pictures shown again that were skipped are not output.
+    enum Dav1dDecodeFrameType decode_frame_type;
+    // Operating point of the sequence to decode (0-31; 0 by default, the
+    // highest quality one): the OBUs of temporal or spatial layers that it
+    // does not include are dropped unparsed. If the sequence has fewer
+    // operating points, the first one is used.
+    int operating_point;
+    // If its width and height are non-zero, only the tiles intersecting
+    // this rectangle (in luma pixels) are decoded, e.g. the viewport of
+    // 360 degree video; the others are neither parsed nor reconstructed
+    // (but for the one the frame's entropy context is adapted from), and
+    // the decoded area is returned in Dav1dPicture.region. This is meant
+    // for streams whose tiles are coded independently (with motion limited
+    // to the same tiles of the reference frames): otherwise, the edges of
+    // the decoded area, or all of it in later frames, can be corrupted.
+    Dav1dRect decode_region;
+    // If set (the default), film grain is synthesized on output pictures
+    // (reference pictures stay grain-free); otherwise its parameters are
+    // returned with them (see Dav1dPicture.film_grain), e.g. to apply it
+    // while rendering on a GPU.
+    int apply_grain;
+    // Callback to apply CDEF and loop restoration outside of the decoder
+    // (e.g. as GPU compute shaders), sbrow by sbrow, after deblocking.
+    Dav1dPostFilter post_filter;
+    // Post-filters applied to frames that are not used as reference (i.e.
+    // that refresh none); skipping some lowers the quality of these frames
+    // only, since no other frame is predicted from them, e.g. to play back
+    // in real time on slow devices. All of them are applied by default.
+    enum Dav1dNonRefFilters nonref_filters;
+    // If set, the time spent in each decoding stage, the tiling, the size
+    // of the data and the coding tools used (block and transform counts) of
+    // each frame are returned in Dav1dPicture.stats, e.g. to find the
+    // frames that are slow to decode, and why, at the cost of reading the
+    // clock for each task and counting the blocks.
+    int frame_stats;
+    // If set, the modes, motion vectors, reference frames, segments and
+    // transform sizes of the blocks of each frame are returned with its
+    // picture, per 8x8 luma area (see Dav1dPicture.block_info), e.g. for a
+    // transcoder to start its motion search from, or for video analytics.
+    // They are gathered while parsing, into a buffer that is reference
+    // counted along with the picture rather than copied.
+    int export_block_info;
+    // Format of the output pictures: with DAV1D_OUTPUTFORMAT_SEMIPLANAR
+    // (e.g. NV12 or P010 for 4:2:0, as hardware encoders and renderers
+    // expect), pictures are converted as they are output, after film grain
+    // synthesis, so that no separate pass over them is needed. Monochrome
+    // pictures stay planar, as do those passed to a picture_ready callback
+    // if there is no memory to convert them; see Dav1dPicture.p.format.
+    enum Dav1dOutputFormat output_format;
+    // If set, trace() is called (with trace_cookie) at the beginning and
+    // end of each decoding stage and wait of the threads, e.g. to draw a
+    // timeline of the frame and tile threads. The spans of each thread are
+    // properly nested. It is called concurrently from all threads, and must
+    // be quick, thread-safe and not call back into the decoder.
+    void (*trace)(const Dav1dTraceEvent *ev, void *cookie);
+    void *trace_cookie;
+    // Receives the error messages of the library (with log_cookie), and the
+    // bitstream parsing traces if built with the trace_level option, as a
+    // vprintf() format string and its arguments. By default, they are
+    // written to stderr; NULL discards them. It may be called concurrently
+    // from the decoding threads. No messages are formatted if the library
+    // is built with logging disabled.
+    void (*log)(void *cookie, const char *format, va_list ap);
+    void *log_cookie;
 } Dav1dSettings;
 
 /*
- * Init the library.
+ * Init the library. The internal tables are built on first use, so this
+ * is cheap, and calling it is not required.
  */
 DAV1D_API void dav1d_init(void);
 
@@ -59,7 +243,8 @@ DAV1D_API void dav1d_default_settings(Dav1dSettings *s);
  * Open/allocate decoder instance.
  *
  * The resulting instance context will be placed in $c_out and can be used in
- * iterative calls to dav1d_decode().
+ * iterative calls to dav1d_send_data() and dav1d_get_picture(), or to
+ * dav1d_decode() (the two interfaces should not be mixed).
  *
  * You should free the context using dav1d_close() when you're done decoding.
  *
@@ -79,14 +264,239 @@ DAV1D_API int dav1d_open(Dav1dContext **c_out, const Dav1dSettings *s);
  */
 DAV1D_API int dav1d_decode(Dav1dContext *c, Dav1dData *in, Dav1dPicture *out);
 
+/**
+ * Queue input data for decoding by dav1d_get_picture(). Library takes
+ * ownership of the passed-in reference (and resets $in) on success. One
+ * buffer can be queued at a time: this returns -EAGAIN, leaving $in
+ * untouched, until dav1d_get_picture() has started parsing the previous one.
+ * Other errors are < 0 (a negative errno code), and 0 means success.
+ *
+ * Once all input is sent, signal the end of the stream by passing NULL;
+ * sending new data (e.g. after dav1d_flush()) resumes decoding.
+ *
+ * This may be called from one thread while another one calls
+ * dav1d_get_picture(), but not concurrently with itself or other functions.
+ */
+DAV1D_API int dav1d_send_data(Dav1dContext *c, Dav1dData *in);
+
+/**
+ * Parse and decode queued input data until a picture is available, and
+ * return it in $out. The caller assumes ownership of the returned picture.
+ * This returns -EAGAIN if more data needs to be sent first, or after the end
+ * of the stream was signalled, once all pictures were returned; other
+ * errors are < 0 (a negative errno code, and the data being parsed is
+ * dropped), and 0 means success.
+ */
+DAV1D_API int dav1d_get_picture(Dav1dContext *c, Dav1dPicture *out);
+
 /**
  * Close decoder instance, free all associated memory, and set $c_out to NULL.
  */
 DAV1D_API void dav1d_close(Dav1dContext **c_out);
 
 /**
- * Flush all delayed frames in decoder, to be used when seeking.
+ * Flush all delayed frames in decoder, and drop the input data sent but not
+ * decoded yet, to be used when seeking. Frames being decoded by frame threads
+ * are cancelled, rather than decoded fully, and the reference frames are
+ * dropped, so that inter frames are skipped until the next key frame.
  */
 DAV1D_API void dav1d_flush(Dav1dContext *c);
 
+/**
+ * Return the decoder instance to the state of a newly opened one, to decode
+ * an unrelated stream: on top of what dav1d_flush() does, the sequence
+ * header is dropped, so that the next stream must start with one. Unlike a
+ * dav1d_close()/dav1d_open() pair, the threads, the picture and buffer
+ * pools and the frame buffers (for streams of the same or smaller size) are
+ * kept. The settings of dav1d_open() stay in effect, and the statistics
+ * keep accumulating.
+ */
+DAV1D_API void dav1d_reset(Dav1dContext *c);
+
+/**
+ * Change the threading of the decoder instance, e.g. to use fewer threads
+ * while the device is hot or the application is in the background, without
+ * the dav1d_close()/dav1d_open() pair that would lose the reference frames.
+ * Only n_frame_threads, n_tile_threads, thread_pool, max_frame_delay, cpus,
+ * n_cpus, low_latency, parse_ahead, spin_wait and performance_cores are used
+ * from $s, like in dav1d_open(); the other settings of dav1d_open() stay in
+ * effect.
+ *
+ * This takes effect at a frame boundary: frames in flight are decoded
+ * fully first, but the decoded pictures not returned yet must be drained
+ * (see dav1d_decode() and dav1d_get_picture()) before the frame threads can
+ * be replaced, and, as long as there are any, or a frame's tile groups have
+ * only been partially sent, this returns -EAGAIN, changing nothing. Other
+ * errors are < 0 (a negative errno code), after which the decoder instance
+ * can only be closed, and 0 means success.
+ */
+DAV1D_API int dav1d_set_threads(Dav1dContext *c, const Dav1dSettings *s);
+
+typedef struct Dav1dSequenceHeader {
+    int profile; ///< 0 (main), 1 (high) or 2 (professional)
+    int still_picture;
+    int max_width, max_height; ///< largest frame size, in pixels
+    int bpc; ///< bits per component (8, 10 or 12)
+    enum Dav1dPixelLayout layout;
+    enum Dav1dColorPrimaries pri;
+    enum Dav1dTransferCharacteristics trc;
+    enum Dav1dMatrixCoefficients mtrx;
+    enum Dav1dChromaSamplePosition chr;
+    int color_range; ///< 0 = limited, 1 = full range
+    int num_operating_points;
+    struct Dav1dSequenceHeaderOperatingPoint {
+        int idc; ///< temporal (bits 0-7) and spatial (8-11) layers included
+        int major_level, minor_level;
+        int tier;
+    } operating_points[32];
+} Dav1dSequenceHeader;
+
+/**
+ * Parse the first sequence header in $buf/$sz, OBUs in the format passed to
+ * dav1d_decode(), into $out. This needs no decoder instance, and neither
+ * allocates memory nor starts threads.
+ *
+ * This returns 0 on success, -ENOENT if the data holds no sequence header,
+ * or -EINVAL if it is invalid.
+ */
+DAV1D_API int dav1d_parse_sequence_header(const uint8_t *buf, size_t sz,
+                                          Dav1dSequenceHeader *out);
+
+enum Dav1dMemoryCategory {
+    DAV1D_MEM_PICTURES, ///< internally allocated picture buffers, including
+                        ///< the ones kept for reuse (see max_pooled_pictures)
+    DAV1D_MEM_BLOCK_DATA, ///< motion vectors and segmentation maps of frames,
+                          ///< and the exported block info of pictures
+    DAV1D_MEM_FRAME, ///< per-frame working buffers (loopfilter masks and
+                     ///< levels, block contexts, pre-filter pixel rows)
+    DAV1D_MEM_FRAME_THREADING, ///< full-frame block, palette and coefficient
+                               ///< data passed between the two passes of
+                               ///< frame threading (or parse-ahead)
+    DAV1D_MEM_TILE_CONTEXTS, ///< per-thread scratch buffers; those of a
+                             ///< shared thread pool are not included
+    DAV1D_MEM_NUM_CATEGORIES,
+};
+
+typedef struct Dav1dMemoryStats {
+    size_t current[DAV1D_MEM_NUM_CATEGORIES]; ///< bytes held now
+    size_t peak[DAV1D_MEM_NUM_CATEGORIES]; ///< most bytes held at any time
+    size_t total; ///< sum of current[]
+} Dav1dMemoryStats;
+
+/**
+ * Get the memory held by the decoder instance, in bytes, per category, and
+ * the high-water mark of each category since dav1d_open(). Memory of
+ * pictures allocated by a user allocator, and small fixed-size state, are
+ * not included.
+ *
+ * This returns < 0 (a negative errno code) on error, or 0 on success.
+ */
+DAV1D_API int dav1d_get_memory_stats(Dav1dContext *c, Dav1dMemoryStats *stats);
+
+enum Dav1dWaitType {
+    DAV1D_WAIT_REF, ///< on the decoding progress of a reference frame
+                    ///< (for motion compensation, motion vectors or the
+                    ///< segmentation map), with frame threading
+    DAV1D_WAIT_CDF, ///< on the entropy context of the frame that the next
+                    ///< one adapts it from, with frame threading
+    DAV1D_WAIT_TILE, ///< a frame thread on the tile worker threads (for tile
+                     ///< progress, or its last tasks to finish)
+    DAV1D_WAIT_FRAME_THREAD, ///< on a busy frame thread to submit a new frame
+                             ///< (including the tasks the waiting thread
+                             ///< runs meanwhile)
+    DAV1D_WAIT_WAVEFRONT, ///< a tile worker on the sbrow above the one it
+                          ///< reconstructs (with frame threading, the sbrows
+                          ///< of a tile are reconstructed as a wavefront)
+    DAV1D_WAIT_NUM_TYPES,
+};
+
+typedef struct Dav1dWaitStats {
+    uint64_t count[DAV1D_WAIT_NUM_TYPES]; ///< waits that blocked
+    uint64_t nanos[DAV1D_WAIT_NUM_TYPES]; ///< total time they blocked, summed
+                                          ///< over all threads
+} Dav1dWaitStats;
+
+/**
+ * Get the number of times the threads of the decoder instance blocked, and
+ * for how long, per type of wait, since dav1d_open(), e.g. to tell whether
+ * more frame threads, tile threads or streams would use more cores. Waits
+ * that return right away are not counted.
+ *
+ * This returns < 0 (a negative errno code) on error, or 0 on success.
+ */
+DAV1D_API int dav1d_get_wait_stats(Dav1dContext *c, Dav1dWaitStats *stats);
+
+/**
+ * Decoding stages timed by builds configured with -Dprofiling=true. They
+ * nest: tile superblock rows include coefficient decoding and block
+ * reconstruction, and, without frame threads, OBU parsing includes the
+ * decoding of the frames it submits.
+ */
+enum Dav1dProfileStage {
+    DAV1D_PROF_PARSE_OBUS, ///< OBU parsing (one call per OBU)
+    DAV1D_PROF_TILE_SBROW, ///< entropy decoding and reconstruction of one
+                           ///< superblock row of a tile
+    DAV1D_PROF_COEFS, ///< coefficient decoding (one call per transform block)
+    DAV1D_PROF_RECON_INTRA, ///< reconstruction of intra blocks
+    DAV1D_PROF_RECON_INTER, ///< reconstruction of inter blocks
+    DAV1D_PROF_LOOPFILTER, ///< deblocking of a superblock row
+    DAV1D_PROF_CDEF, ///< CDEF of a superblock row
+    DAV1D_PROF_LR, ///< loop restoration of a superblock row
+    DAV1D_PROF_NUM_STAGES,
+};
+
+typedef struct Dav1dProfile {
+    /**
+     * Time spent in each stage, summed over all threads, in ticks of the
+     * CPU's timestamp counter where available (TSC on x86, virtual counter
+     * on AArch64), else in nanoseconds; ticks are only meaningful relative
+     * to each other.
+     */
+    uint64_t ticks[DAV1D_PROF_NUM_STAGES];
+    uint64_t calls[DAV1D_PROF_NUM_STAGES]; ///< number of times each ran
+} Dav1dProfile;
+
+/**
+ * Get the time spent by the decoder instance in each decoding stage since
+ * dav1d_open(), accumulated by each of its threads. The worker threads of a
+ * shared thread pool count the work of all the instances using it. The
+ * result is a snapshot: stages still running in the decoder's threads may
+ * or may not be included.
+ *
+ * This returns -ENOSYS (and zeroes $prof) if the library was built without
+ * profiling, other values < 0 (a negative errno code) on error, or 0 on
+ * success.
+ */
+DAV1D_API int dav1d_get_profile(Dav1dContext *c, Dav1dProfile *prof);
+
+/**
+ * Create a set of tile worker threads that can be shared by many decoder
+ * instances, by passing it as thread_pool in their settings, so that the
+ * number of threads is bounded by n_tile_threads rather than by the number
+ * of instances times their thread count. Work from all instances is served
+ * in the order their frames were submitted. Only n_tile_threads, cpus and
+ * n_cpus are used from $s.
+ *
+ * The pool must outlive all decoder instances using it, and is freed, and
+ * $pool_out set to NULL, by dav1d_thread_pool_destroy().
+ *
+ * This returns < 0 (a negative errno code) on error, or 0 on success.
+ */
+DAV1D_API int dav1d_thread_pool_create(Dav1dThreadPool **pool_out,
+                                       const Dav1dSettings *s);
+DAV1D_API void dav1d_thread_pool_destroy(Dav1dThreadPool **pool_out);
+
+/**
+ * Restrict the SIMD instruction sets used by the library to those whose CPU
+ * flags are set in $mask. Flags for instruction sets that the host does not
+ * support are ignored, so ~0U (the default) uses everything available and 0
+ * forces the C code paths.
+ *
+ * This is a process-wide setting, which applies to the decoder instances
+ * opened after the call: each one keeps the instruction sets that were
+ * allowed when dav1d_open() created it, so instances using different masks
+ * can run side by side in one process (e.g. to compare SIMD levels).
+ */
+DAV1D_API void dav1d_set_cpu_flags_mask(unsigned mask);
+
 #endif /* __DAV1D_H__ */
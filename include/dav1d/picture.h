@@ -106,10 +106,22 @@ enum Dav1dChromaSamplePosition {
     DAV1D_CHR_COLOCATED = 2, ///< Co-located with luma(0, 0) sample
 };
 
+enum Dav1dOutputFormat {
+    DAV1D_OUTPUTFORMAT_PLANAR, ///< one plane per component
+    /**
+     * Luma plane, and a plane of interleaved U and V samples (NV12, NV16 or
+     * NV24, depending on the layout); above 8 bpc, the samples of both
+     * planes are stored in the most significant bits of their 16-bit words
+     * (P010, P210 or P410 for 10 bpc).
+     */
+    DAV1D_OUTPUTFORMAT_SEMIPLANAR,
+};
+
 typedef struct Dav1dPictureParameters {
     int w; ///< width (in pixels)
     int h; ///< height (in pixels)
     enum Dav1dPixelLayout layout; ///< format of the picture
+    enum Dav1dOutputFormat format; ///< arrangement of the planes in memory
     enum Dav1dFrameType type; ///< type of the picture
     int bpc; ///< bits per pixel component (8 or 10)
 
@@ -124,13 +136,121 @@ typedef struct Dav1dPictureParameters {
     int fullrange;
 } Dav1dPictureParameters;
 
+/**
+ * Film grain parameters, as coded in the frame header (see the AV1
+ * specification, film_grain_params()); the multipliers and offsets keep
+ * their bias of 128 (256 for uv_offset).
+ */
+typedef struct Dav1dFilmGrainData {
+    unsigned seed;
+    int num_y_points;
+    uint8_t y_points[14][2 /* value, scaling */];
+    int chroma_scaling_from_luma;
+    int num_uv_points[2];
+    uint8_t uv_points[2][10][2 /* value, scaling */];
+    int scaling_shift;
+    int ar_coeff_lag;
+    int8_t ar_coeffs_y[24];
+    int8_t ar_coeffs_uv[2][25];
+    int ar_coeff_shift;
+    int grain_scale_shift;
+    int uv_mult[2];
+    int uv_luma_mult[2];
+    int uv_offset[2];
+    int overlap_flag;
+    int clip_to_restricted_range;
+} Dav1dFilmGrainData;
+
+typedef struct Dav1dRect {
+    int x, y; ///< top-left corner (in luma pixels)
+    int w, h; ///< size (in luma pixels)
+} Dav1dRect;
+
+/**
+ * Decoding statistics of a picture, collected if Dav1dSettings.frame_stats
+ * is set. They are all zero for pictures that were shown again without
+ * being decoded (show_existing_frame).
+ */
+typedef struct Dav1dFrameStats {
+    size_t data_sz; ///< size of the frame's tile data (in bytes)
+    int tile_cols, tile_rows; ///< tiling of the frame
+    int frame_thread; ///< frame thread that decoded it (-1 = none)
+    /**
+     * Time spent decoding the tiles (entropy decoding and reconstruction)
+     * and in each of the post-filters, summed over all threads that did so,
+     * and the wall-clock time from the start of the frame's decoding to its
+     * end (all in nanoseconds). With frame threading, the wall-clock time
+     * includes waiting for the reference frames to be decoded.
+     */
+    uint64_t tile_time, deblock_time, cdef_time, lr_time;
+    uint64_t decode_time;
+    /**
+     * Coding tools used: the number of intra and inter (including intra
+     * block copy) blocks, and, among these, of skip (i.e. without residual)
+     * blocks, intra blocks with a palette and inter blocks with warped
+     * (local or global) motion.
+     */
+    unsigned intra_blocks, inter_blocks;
+    unsigned skip_blocks, palette_blocks, warped_blocks;
+    /**
+     * Transform blocks of all planes, per transform size, in the order of
+     * the AV1 specification: 4x4, 8x8, 16x16, 32x32, 64x64, 4x8, 8x4, 8x16,
+     * 16x8, 16x32, 32x16, 32x64, 64x32, 4x16, 16x4, 8x32, 32x8, 16x64, 64x16.
+     */
+    unsigned tx_blocks[19];
+} Dav1dFrameStats;
+
+enum Dav1dBlockInfoFlags {
+    DAV1D_BLOCK_INTRA = 1 << 0, ///< intra prediction (mode is an intra mode)
+    DAV1D_BLOCK_INTRABC = 1 << 1, ///< intra block copy (mv[0] is set)
+    DAV1D_BLOCK_SKIP = 1 << 2, ///< no residual
+    DAV1D_BLOCK_PALETTE = 1 << 3, ///< luma palette
+};
+
+/**
+ * Coding parameters of the block covering an 8x8 luma area, see
+ * Dav1dSettings.export_block_info. If several blocks (of less than 8
+ * pixels in width or height) cover it, those of the last one decoded.
+ */
+typedef struct Dav1dBlockInfo {
+    /**
+     * Motion vectors (in 1/8 pixels) of inter blocks, for ref[0] and, with
+     * compound prediction, ref[1]; for intra block copy, the displacement
+     * vector in mv[0].
+     */
+    struct { int16_t y, x; } mv[2];
+    /**
+     * Reference frames of inter blocks (1 = LAST to 7 = ALTREF, as in the
+     * AV1 specification), ref[1] being -1 unless the block uses compound
+     * prediction; 0 and -1 for intra blocks.
+     */
+    int8_t ref[2];
+    uint8_t w4, h4; ///< size of the block (in 4-pixel units)
+    /**
+     * Prediction mode, numbered as in the AV1 specification: the luma
+     * intra mode (0 = DC_PRED to 12 = PAETH_PRED; DC_PRED for filter intra
+     * and intra block copy), or the inter mode (13 = NEARESTMV to 24 =
+     * NEW_NEWMV).
+     */
+    uint8_t mode;
+    uint8_t seg_id; ///< segment
+    /**
+     * Largest luma transform size, numbered as in Dav1dFrameStats.tx_blocks
+     * (inter blocks may split it further).
+     */
+    uint8_t tx;
+    uint8_t flags; ///< see enum Dav1dBlockInfoFlags
+} Dav1dBlockInfo;
+
 typedef struct Dav1dPicture {
     /**
      * Pointers to planar image data (Y is [0], U is [1], V is [2]). The data
      * should be bytes (for 8 bpc) or words (for 10 bpc). In case of words
      * containing 10 bpc image data, the pixels should be located in the LSB
      * bits, so that values range between [0, 1023]; the upper bits should be
-     * zero'ed out.
+     * zero'ed out. For the semi-planar format (see p.format), data[1] holds
+     * the interleaved U and V samples, data[2] is NULL, and the samples of
+     * 10 bpc data are in the most significant bits instead.
      */
     void *data[3];
     struct Dav1dRef *ref; ///< allocation origin
@@ -143,8 +263,166 @@ typedef struct Dav1dPicture {
     Dav1dPictureParameters p;
 
     int poc; ///< frame number
+
+    /**
+     * Area of the picture that was decoded: all of it, unless a decode
+     * region was set in Dav1dSettings, in which case it is the area covered
+     * by the tiles intersecting it. Pixels outside of it are undefined.
+     */
+    Dav1dRect region;
+
+    /**
+     * Film grain to synthesize on the picture for display, if
+     * film_grain_present is set. Unless Dav1dSettings.apply_grain is unset,
+     * the decoder does so itself, and output pictures have it unset.
+     */
+    int film_grain_present;
+    Dav1dFilmGrainData film_grain;
+
+    Dav1dFrameStats stats; ///< see Dav1dSettings.frame_stats
+
+    /**
+     * If Dav1dSettings.export_block_info is set, the coding parameters of
+     * each 8x8 luma area of the picture, row by row, with block_info_stride
+     * entries per row (the width rounded up to a multiple of 8, divided by
+     * 8), else NULL. They are shared by all references to the picture
+     * (see block_info_ref), and only valid within the decoded region.
+     */
+    Dav1dBlockInfo *block_info;
+    ptrdiff_t block_info_stride;
+    struct Dav1dRef *block_info_ref; ///< allocation origin of block_info
+
+    void *allocator_data; ///< set by Dav1dPicAllocator.alloc_picture, if used
 } Dav1dPicture;
 
+/**
+ * Alignment, in bytes, of the plane pointers and strides of pictures
+ * returned by Dav1dPicAllocator.alloc_picture.
+ */
+#define DAV1D_PICTURE_ALIGNMENT 32
+
+typedef struct Dav1dPicAllocator {
+    void *cookie; ///< passed to both callbacks
+    /**
+     * Allocate the picture buffer, so that the decoder writes directly into
+     * it. If NULL, the decoder allocates pictures internally.
+     *
+     * On entry, pic->p.w, h, layout, format and bpc are set. The callback
+     * must set data[0] (and data[1], and data[2] for the planar format,
+     * unless the layout is I400), stride[0] (and stride[1]), and may set
+     * allocator_data. Pixels take one byte for bpc 8 and two bytes
+     * otherwise. Each plane must have room for the picture's width and
+     * height rounded up to a multiple of 128 luma pixels (subsampled for
+     * chroma, and twice as wide for the interleaved chroma of the
+     * semi-planar format), since the decoder writes whole blocks. The plane
+     * pointers and strides must be multiples of DAV1D_PICTURE_ALIGNMENT; U
+     * and V share stride[1]. Decoded pictures are planar; semi-planar ones
+     * are only allocated for output (see Dav1dSettings.output_format).
+     *
+     * Returns 0 on success, or a negative errno value (e.g. -ENOMEM), which
+     * is returned from dav1d_decode(). May be called from any of the
+     * decoder's threads, including concurrently.
+     *
+     * The picture may be kept as a reference by the decoder, so its data
+     * must stay valid until release_picture is called for it.
+     */
+    int (*alloc_picture)(Dav1dPicture *pic, void *cookie);
+    /**
+     * Release a picture from alloc_picture, after its last reference (the
+     * decoder's or the application's) was dropped. pic has the fields set
+     * by alloc_picture. May be called from any thread, including the
+     * decoder's, and after dav1d_close().
+     */
+    void (*release_picture)(Dav1dPicture *pic, void *cookie);
+} Dav1dPicAllocator;
+
+/**
+ * Loop restoration parameters of one restoration unit, as coded (see the
+ * AV1 specification, read_lr_unit()).
+ */
+typedef struct Dav1dRestorationUnit {
+    uint8_t type; ///< 0 = none, 1 = Wiener, 2 = self-guided
+    uint8_t sgr_idx; ///< self-guided filter parameter set (0-15)
+    int16_t sgr_weights[2]; ///< self-guided projection weights (xqd)
+    int16_t filter_h[3], filter_v[3]; ///< first 3 (of 7 symmetric) Wiener taps
+} Dav1dRestorationUnit;
+
+/**
+ * A superblock row of a picture whose CDEF and loop restoration are left to
+ * Dav1dPostFilter.filter_sbrow, with their parameters.
+ */
+typedef struct Dav1dPostFilterSbrow {
+    /**
+     * The picture being decoded, deblocked (before film grain, if any), in
+     * which the callback writes the filtered pixels back. Its references
+     * are owned by the decoder.
+     */
+    Dav1dPicture *pic;
+    int sby; ///< superblock row index
+    int sb_size; ///< superblock size (64 or 128)
+    int last; ///< set for the last superblock row of the picture
+    /**
+     * Luma rows deblocked since the previous call, [y_start, y_end) (which
+     * the decoder won't write any more; chroma rows scale accordingly).
+     * Before returning, the callback must have filtered all rows before
+     * y_start, or, in the last call, all of the picture: these rows are
+     * then made available to the frames predicted from this one. Rows it
+     * wrote back no longer hold the deblocked pixels, so it has to keep
+     * aside those that are still needed to filter the rows below them.
+     */
+    int y_start, y_end;
+
+    /**
+     * CDEF: whether it is enabled for the sequence, the damping (3-6) and
+     * the luma and chroma strengths for each index (primary strength * 4 +
+     * secondary strength, both as coded; all 0 if the frame has no CDEF),
+     * and the index of each 64x64 luma block of the superblock row, with
+     * cdef_idx_stride entries per row (sb_size / 64 rows; -1 = not
+     * filtered). 8x8 luma blocks without coded coefficients are not
+     * filtered either: cdef_coded has one entry per 8x8 block,
+     * cdef_coded_stride per row (sb_size / 8 rows), set for those that
+     * have some.
+     */
+    int cdef;
+    int cdef_damping;
+    uint8_t cdef_y_strength[8], cdef_uv_strength[8];
+    const int8_t *cdef_idx;
+    ptrdiff_t cdef_idx_stride;
+    const uint8_t *cdef_coded;
+    ptrdiff_t cdef_coded_stride;
+
+    /**
+     * Loop restoration, per plane: the frame restoration type (0 = none,
+     * 1 = Wiener, 2 = self-guided, 3 = switchable), the log2 of the unit
+     * size (in pixels of the plane), and the units of the picture so far,
+     * lr_unit_cols per row and lr_unit_rows rows: all of those with their
+     * top edge above the bottom of the superblock row, and all of them in
+     * the last call. A last row or column of units of less than half the
+     * unit size is part of the one before it.
+     */
+    uint8_t lr_type[3];
+    uint8_t lr_unit_size_log2[3];
+    const Dav1dRestorationUnit *lr_units[3];
+    int lr_unit_cols[3], lr_unit_rows[3];
+} Dav1dPostFilterSbrow;
+
+typedef struct Dav1dPostFilter {
+    void *cookie; ///< passed to the callback
+    /**
+     * Apply CDEF and loop restoration to a superblock row, e.g. on a GPU,
+     * instead of the decoder. If NULL, the decoder does so itself.
+     *
+     * Called for each superblock row of the pictures which have CDEF or
+     * loop restoration to apply (unless skipped, see
+     * Dav1dSettings.nonref_filters), once it is deblocked, in order. It is
+     * never called concurrently for the same picture, but may be for
+     * different pictures, from any of the decoder's threads, which wait for
+     * it to return (see Dav1dPostFilterSbrow.y_start). Film grain can be
+     * left to the application as well, see Dav1dSettings.apply_grain.
+     */
+    void (*filter_sbrow)(const Dav1dPostFilterSbrow *sbrow, void *cookie);
+} Dav1dPostFilter;
+
 /**
  * Release reference to a picture.
  */
@@ -0,0 +1,240 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "src/cpu.h"
+#include "src/looprestoration.h"
+
+#include "common/attributes.h"
+#include "common/intops.h"
+#include "src/tables.h"
+
+#if BITDEPTH == 8 && ARCH_AARCH64
+void dav1d_wiener_filter_h_neon(int16_t *dst, const pixel *src,
+                                const int16_t fh[7], const int w, int h);
+void dav1d_wiener_filter_v_neon(pixel *dst, ptrdiff_t stride,
+                                const int16_t *mid, int w, int h,
+                                const int16_t fv[7]);
+
+void dav1d_sgr_box3_h_neon(int32_t *sumsq, int16_t *sum, const pixel *src,
+                           int w, int h);
+void dav1d_sgr_box3_v_neon(int32_t *sumsq, int16_t *sum, int w, int h);
+void dav1d_sgr_box5_h_neon(int32_t *sumsq, int16_t *sum, const pixel *src,
+                           int w, int h);
+void dav1d_sgr_box5_v_neon(int32_t *sumsq, int16_t *sum, int w, int h);
+void dav1d_sgr_calc_ab1_neon(int32_t *a, int16_t *b, int w, int h, int s);
+void dav1d_sgr_calc_ab2_neon(int32_t *a, int16_t *b, int w, int h, int s);
+void dav1d_sgr_finish_filter1_neon(int16_t *tmp, const pixel *src,
+                                   const int32_t *a, const int16_t *b,
+                                   int w, int h);
+void dav1d_sgr_finish_filter2_neon(int16_t *tmp, const pixel *src,
+                                   const int32_t *a, const int16_t *b,
+                                   int w, int h);
+void dav1d_sgr_weighted1_neon(pixel *dst, ptrdiff_t stride,
+                              const int16_t *t1, int w, int h, int wt);
+void dav1d_sgr_weighted2_neon(pixel *dst, ptrdiff_t stride,
+                              const int16_t *t1, const int16_t *t2,
+                              int w, int h, int w0, int w1);
+
+// 256 * 1.5 + 3 + 3 = 390
+#define REST_UNIT_STRIDE (390)
+
+// Stride of the box sum buffers; they must have room for 8 columns to the
+// left of the restoration unit and for the columns written past its right
+// edge, since the box sums are computed in blocks of 8 from column -1.
+#define SGR_STRIDE (384 + 32)
+
+// Same as padding() in looprestoration.c, the asm functions expect the
+// same layout of the padded unit.
+static void padding(pixel *dst, const pixel *p, const ptrdiff_t p_stride,
+                    const pixel (*left)[4],
+                    const pixel *lpf, const ptrdiff_t lpf_stride,
+                    int unit_w, const int stripe_h, const enum LrEdgeFlags edges)
+{
+    const int have_left = !!(edges & LR_HAVE_LEFT);
+    const int have_right = !!(edges & LR_HAVE_RIGHT);
+
+    // Copy more pixels if we don't have to pad them
+    unit_w += 3 * have_left + 3 * have_right;
+    pixel *dst_l = dst + 3 * !have_left;
+    p -= 3 * have_left;
+    lpf -= 3 * have_left;
+
+    if (edges & LR_HAVE_TOP) {
+        // Copy previous loop filtered rows
+        const pixel *const above_1 = lpf;
+        const pixel *const above_2 = above_1 + PXSTRIDE(lpf_stride);
+        pixel_copy(dst_l, above_1, unit_w);
+        pixel_copy(dst_l + REST_UNIT_STRIDE, above_1, unit_w);
+        pixel_copy(dst_l + 2 * REST_UNIT_STRIDE, above_2, unit_w);
+    } else {
+        // Pad with first row
+        pixel_copy(dst_l, p, unit_w);
+        pixel_copy(dst_l + REST_UNIT_STRIDE, p, unit_w);
+        pixel_copy(dst_l + 2 * REST_UNIT_STRIDE, p, unit_w);
+        if (have_left) {
+            pixel_copy(dst_l, &left[0][1], 3);
+            pixel_copy(dst_l + REST_UNIT_STRIDE, &left[0][1], 3);
+            pixel_copy(dst_l + 2 * REST_UNIT_STRIDE, &left[0][1], 3);
+        }
+    }
+
+    pixel *dst_tl = dst_l + 3 * REST_UNIT_STRIDE;
+    if (edges & LR_HAVE_BOTTOM) {
+        // Copy next loop filtered rows
+        const pixel *const below_1 = lpf + 6 * PXSTRIDE(lpf_stride);
+        const pixel *const below_2 = below_1 + PXSTRIDE(lpf_stride);
+        pixel_copy(dst_tl + stripe_h * REST_UNIT_STRIDE, below_1, unit_w);
+        pixel_copy(dst_tl + (stripe_h + 1) * REST_UNIT_STRIDE, below_2, unit_w);
+        pixel_copy(dst_tl + (stripe_h + 2) * REST_UNIT_STRIDE, below_2, unit_w);
+    } else {
+        // Pad with last row
+        const pixel *const src = p + (stripe_h - 1) * PXSTRIDE(p_stride);
+        pixel_copy(dst_tl + stripe_h * REST_UNIT_STRIDE, src, unit_w);
+        pixel_copy(dst_tl + (stripe_h + 1) * REST_UNIT_STRIDE, src, unit_w);
+        pixel_copy(dst_tl + (stripe_h + 2) * REST_UNIT_STRIDE, src, unit_w);
+        if (have_left) {
+            pixel_copy(dst_tl + stripe_h * REST_UNIT_STRIDE,
+                       &left[stripe_h - 1][1], 3);
+            pixel_copy(dst_tl + (stripe_h + 1) * REST_UNIT_STRIDE,
+                       &left[stripe_h - 1][1], 3);
+            pixel_copy(dst_tl + (stripe_h + 2) * REST_UNIT_STRIDE,
+                       &left[stripe_h - 1][1], 3);
+        }
+    }
+
+    // Inner UNIT_WxSTRIPE_H; the pixels left of it come from $left, since
+    // the picture may already hold the restored pixels of the previous unit
+    for (int j = 0; j < stripe_h; j++) {
+        pixel_copy(dst_tl + 3 * have_left, p + 3 * have_left,
+                   unit_w - 3 * have_left);
+        if (have_left)
+            pixel_copy(dst_tl, &left[j][1], 3);
+        dst_tl += REST_UNIT_STRIDE;
+        p += PXSTRIDE(p_stride);
+    }
+
+    if (!have_right) {
+        pixel *pad = dst_l + unit_w;
+        pixel *row_last = &dst_l[unit_w - 1];
+        // Pad 3x(STRIPE_H+6) with last column
+        for (int j = 0; j < stripe_h + 6; j++) {
+            pixel_set(pad, *row_last, 3);
+            pad += REST_UNIT_STRIDE;
+            row_last += REST_UNIT_STRIDE;
+        }
+    }
+
+    if (!have_left) {
+        // Pad 3x(STRIPE_H+6) with first column
+        for (int j = 0; j < stripe_h + 6; j++) {
+            pixel_set(dst, *dst_l, 3);
+            dst += REST_UNIT_STRIDE;
+            dst_l += REST_UNIT_STRIDE;
+        }
+    }
+}
+
+// The asm functions process blocks of 8 pixels and may write past w, up
+// to the next multiple of 8, which is always within the picture stride.
+// The padded buffer has some slack at the end for the same reason.
+static void wiener_filter_neon(pixel *const dst, const ptrdiff_t dst_stride,
+                               const pixel (*const left)[4],
+                               const pixel *const lpf,
+                               const ptrdiff_t lpf_stride,
+                               const int w, const int h,
+                               const int16_t fh[7], const int16_t fv[7],
+                               const enum LrEdgeFlags edges)
+{
+    ALIGN_STK_16(pixel, tmp, 70 /*(64 + 3 + 3)*/ * REST_UNIT_STRIDE + 32,);
+    ALIGN_STK_16(int16_t, mid, 70 /*(64 + 3 + 3)*/ * 384,);
+
+    padding(tmp, dst, dst_stride, left, lpf, lpf_stride, w, h, edges);
+    dav1d_wiener_filter_h_neon(mid, tmp, fh, w, h + 6);
+    dav1d_wiener_filter_v_neon(dst, dst_stride, mid, w, h, fv);
+}
+
+static void selfguided_filter_neon(int16_t *const dst, const pixel *const src,
+                                   const int w, const int h,
+                                   const int n, const int s)
+{
+    // Box sums and their inverses, for rows -3 to h + 3 and columns -8 to
+    // w + 24 of the unit
+    ALIGN_STK_16(int32_t, a_mem, 70 /*(64 + 3 + 3)*/ * SGR_STRIDE,);
+    ALIGN_STK_16(int16_t, b_mem, 70 /*(64 + 3 + 3)*/ * SGR_STRIDE,);
+    int32_t *const a = a_mem + 3 * SGR_STRIDE + 8;
+    int16_t *const b = b_mem + 3 * SGR_STRIDE + 8;
+
+    if (n == 25) {
+        dav1d_sgr_box5_h_neon(a, b, src, w, h);
+        dav1d_sgr_box5_v_neon(a, b, w, h);
+        dav1d_sgr_calc_ab2_neon(a, b, w, h, s);
+        dav1d_sgr_finish_filter2_neon(dst, src, a, b, w, h);
+    } else {
+        dav1d_sgr_box3_h_neon(a, b, src, w, h);
+        dav1d_sgr_box3_v_neon(a, b, w, h);
+        dav1d_sgr_calc_ab1_neon(a, b, w, h, s);
+        dav1d_sgr_finish_filter1_neon(dst, src, a, b, w, h);
+    }
+}
+
+static void sgr_filter_neon(pixel *const dst, const ptrdiff_t dst_stride,
+                            const pixel (*const left)[4],
+                            const pixel *const lpf, const ptrdiff_t lpf_stride,
+                            const int w, const int h, const int sgr_idx,
+                            const int16_t sgr_w[2], const enum LrEdgeFlags edges)
+{
+    ALIGN_STK_16(pixel, tmp, 70 /*(64 + 3 + 3)*/ * REST_UNIT_STRIDE + 32,);
+    ALIGN_STK_16(int16_t, dst0, 64 * 384,);
+
+    padding(tmp, dst, dst_stride, left, lpf, lpf_stride, w, h, edges);
+
+    if (!sgr_params[sgr_idx][0]) {
+        selfguided_filter_neon(dst0, tmp, w, h, 9, sgr_params[sgr_idx][3]);
+        dav1d_sgr_weighted1_neon(dst, dst_stride, dst0, w, h,
+                                 (1 << 7) - sgr_w[1]);
+    } else if (!sgr_params[sgr_idx][1]) {
+        selfguided_filter_neon(dst0, tmp, w, h, 25, sgr_params[sgr_idx][2]);
+        dav1d_sgr_weighted1_neon(dst, dst_stride, dst0, w, h, sgr_w[0]);
+    } else {
+        ALIGN_STK_16(int16_t, dst1, 64 * 384,);
+        selfguided_filter_neon(dst0, tmp, w, h, 25, sgr_params[sgr_idx][2]);
+        selfguided_filter_neon(dst1, tmp, w, h, 9, sgr_params[sgr_idx][3]);
+        dav1d_sgr_weighted2_neon(dst, dst_stride, dst0, dst1, w, h, sgr_w[0],
+                                 (1 << 7) - sgr_w[0] - sgr_w[1]);
+    }
+}
+#endif
+
+void bitfn(dav1d_loop_restoration_dsp_init_arm)(Dav1dLoopRestorationDSPContext *const c) {
+    const unsigned flags = dav1d_get_cpu_flags();
+
+    if (!(flags & DAV1D_ARM_CPU_FLAG_NEON)) return;
+
+#if BITDEPTH == 8 && ARCH_AARCH64
+    c->wiener = wiener_filter_neon;
+    c->selfguided = sgr_filter_neon;
+#endif
+}
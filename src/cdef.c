@@ -96,6 +96,7 @@ static void fill(uint16_t *tmp, const ptrdiff_t stride,
 
 /* Smooth in the direction detected. */
 static void cdef_filter_block_c(pixel *const dst, const ptrdiff_t dst_stride,
+                                const pixel (*left)[2],
                                 /*const*/ pixel *const top[2],
                                 const int w, const int h, const int pri_strength,
                                 const int sec_strength, const int dir,
@@ -134,8 +135,11 @@ static void cdef_filter_block_c(pixel *const dst, const ptrdiff_t dst_stride,
     for (int y = y_start; y < 0; y++)
         for (int x = x_start; x < x_end; x++)
             tmp2[y * tmp_stride + x] = top[y & 1][x];
+    for (int y = 0; y < h; y++)
+        for (int x = x_start; x < 0; x++)
+            tmp2[y * tmp_stride + x] = left[y][2 + x];
     for (int y = 0; y < y_end; y++)
-        for (int x = x_start; x < x_end; x++)
+        for (int x = y < h ? 0 : x_start; x < x_end; x++)
             tmp2[y * tmp_stride + x] = dst[y * PXSTRIDE(dst_stride) + x];
 
     // run actual filter
@@ -186,6 +190,7 @@ static void cdef_filter_block_c(pixel *const dst, const ptrdiff_t dst_stride,
 #define cdef_fn(w, h) \
 static void cdef_filter_block_##w##x##h##_c(pixel *const dst, \
                                             const ptrdiff_t stride, \
+                                            const pixel (*left)[2], \
                                             /*const*/ pixel *const top[2], \
                                             const int pri_strength, \
                                             const int sec_strength, \
@@ -193,8 +198,8 @@ static void cdef_filter_block_##w##x##h##_c(pixel *const dst, \
                                             const int damping, \
                                             const enum CdefEdgeFlags edges) \
 { \
-    cdef_filter_block_c(dst, stride, top, w, h, pri_strength, sec_strength, \
-                        dir, damping, edges); \
+    cdef_filter_block_c(dst, stride, left, top, w, h, pri_strength, \
+                        sec_strength, dir, damping, edges); \
 }
 
 cdef_fn(4, 4);
@@ -295,4 +300,12 @@ void bitfn(dav1d_cdef_dsp_init)(Dav1dCdefDSPContext *const c) {
     c->fb[0] = cdef_filter_block_8x8_c;
     c->fb[1] = cdef_filter_block_4x8_c;
     c->fb[2] = cdef_filter_block_4x4_c;
+
+#if HAVE_ASM
+#if ARCH_AARCH64 || ARCH_ARM
+    bitfn(dav1d_cdef_dsp_init_arm)(c);
+#elif ARCH_X86
+    bitfn(dav1d_cdef_dsp_init_x86)(c);
+#endif
+#endif
 }
@@ -40,16 +40,27 @@ enum CdefEdgeFlags {
     HAVE_BOTTOM = 1 << 3,
 };
 
+#ifdef BITDEPTH
+typedef const pixel (*const_left_pixel_row_2px)[2];
+#else
+typedef const void *const_left_pixel_row_2px;
+#endif
+
 // CDEF operates entirely on pre-filter data; if bottom/right edges are
 // present (according to $edges), then the pre-filter data is located in
-// $dst. However, the edge pixels above $dst may be post-filter, so in
-// order to get access to pre-filter top pixels, use $top.
-typedef void (*cdef_fn)(pixel *dst, ptrdiff_t stride,
-                        /*const*/ pixel *const top[2],
-                        int pri_strength, int sec_strength,
-                        int dir, int damping, enum CdefEdgeFlags edges);
-typedef int (*cdef_dir_fn)(const pixel *dst, ptrdiff_t stride,
-                           unsigned *var);
+// $dst. However, the edge pixels above and to the left of $dst may be
+// post-filter, so in order to get access to pre-filter top pixels, use
+// $top, and for the 2 pre-filter pixels left of each row, use $left.
+#define decl_cdef_fn(name) \
+void (name)(pixel *dst, ptrdiff_t stride, const_left_pixel_row_2px left, \
+            /*const*/ pixel *const top[2], \
+            int pri_strength, int sec_strength, \
+            int dir, int damping, enum CdefEdgeFlags edges)
+typedef decl_cdef_fn(*cdef_fn);
+
+#define decl_cdef_dir_fn(name) \
+int (name)(const pixel *dst, ptrdiff_t stride, unsigned *var)
+typedef decl_cdef_dir_fn(*cdef_dir_fn);
 
 typedef struct Dav1dCdefDSPContext {
     cdef_dir_fn dir;
@@ -59,4 +70,9 @@ typedef struct Dav1dCdefDSPContext {
 void dav1d_cdef_dsp_init_8bpc(Dav1dCdefDSPContext *c);
 void dav1d_cdef_dsp_init_10bpc(Dav1dCdefDSPContext *c);
 
+void dav1d_cdef_dsp_init_x86_8bpc(Dav1dCdefDSPContext *c);
+void dav1d_cdef_dsp_init_x86_10bpc(Dav1dCdefDSPContext *c);
+void dav1d_cdef_dsp_init_arm_8bpc(Dav1dCdefDSPContext *c);
+void dav1d_cdef_dsp_init_arm_10bpc(Dav1dCdefDSPContext *c);
+
 #endif /* __DAV1D_SRC_CDEF_H__ */
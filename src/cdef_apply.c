@@ -32,6 +32,7 @@
 #include "common/intops.h"
 
 #include "src/cdef_apply.h"
+#include "src/profile.h"
 
 static void backup2lines(pixel *const dst[3][2],
                          /*const*/ pixel *const src[3],
@@ -72,22 +73,6 @@ static void backup2x8(pixel dst[3][8][2],
     }
 }
 
-static void restore2x8(pixel *const dst[3],
-                       const ptrdiff_t dst_stride[2],
-                       const pixel src[3][8][2], const enum Dav1dPixelLayout layout)
-{
-    for (int y = 0, y_off = 0; y < 8; y++, y_off += PXSTRIDE(dst_stride[0]))
-        pixel_copy(&dst[0][y_off - 2], src[0][y], 2);
-
-    if (layout == DAV1D_PIXEL_LAYOUT_I400) return;
-    const int ss_ver = layout == DAV1D_PIXEL_LAYOUT_I420;
-
-    for (int y = 0, y_off = 0; y < (8 >> ss_ver); y++, y_off += PXSTRIDE(dst_stride[1])) {
-        pixel_copy(&dst[1][y_off - 2], src[1][y], 2);
-        pixel_copy(&dst[2][y_off - 2], src[2][y], 2);
-    }
-}
-
 static int adjust_strength(const int strength, const unsigned var) {
     if (!var) return 0;
     const int i = var >> 6 ? imin(ulog2(var >> 6), 12) : 0;
@@ -99,6 +84,7 @@ void bytefn(dav1d_cdef_brow)(Dav1dFrameContext *const f,
                              const Av1Filter *const lflvl,
                              const int by_start, const int by_end)
 {
+    PROF_START(prof_start);
     const Dav1dDSPContext *const dsp = f->dsp;
     enum CdefEdgeFlags edges = HAVE_BOTTOM | (by_start > 0 ? HAVE_TOP : 0);
     pixel *ptrs[3] = { p[0], p[1], p[2] };
@@ -111,11 +97,6 @@ void bytefn(dav1d_cdef_brow)(Dav1dFrameContext *const f,
     const int ss_ver = layout == DAV1D_PIXEL_LAYOUT_I420;
     const int ss_hor = layout != DAV1D_PIXEL_LAYOUT_I444;
 
-    // FIXME a design improvement that could be made here is to keep a set of
-    // flags for each block position on whether the block was filtered; if not,
-    // the backup of pre-filter data is empty, and the restore is therefore
-    // unnecessary as well.
-
     for (int by = by_start; by < by_end; by += 2, edges |= HAVE_TOP) {
         const int tf = f->lf.top_pre_cdef_toggle;
         if (by + 2 >= f->bh) edges &= ~HAVE_BOTTOM;
@@ -126,7 +107,10 @@ void bytefn(dav1d_cdef_brow)(Dav1dFrameContext *const f,
                          8, f->bw * 4, layout);
         }
 
+        // pre-filter pixels left of the current block, which are passed to
+        // the filter instead of being restored into the frame around it
         pixel lr_bak[2 /* idx */][3 /* plane */][8 /* y */][2 /* x */];
+        int bit = 0;
         pixel *iptrs[3] = { ptrs[0], ptrs[1], ptrs[2] };
         edges &= ~HAVE_LEFT;
         edges |= HAVE_RIGHT;
@@ -134,16 +118,23 @@ void bytefn(dav1d_cdef_brow)(Dav1dFrameContext *const f,
             const int sb128x = sbx >>1;
             const int sb64_idx = ((by & sbsz) >> 3) + (sbx & 1);
             const int cdef_idx = lflvl[sb128x].cdef_idx[sb64_idx];
-            if (cdef_idx == -1 ||
-                (!f->frame_hdr.cdef.y_strength[cdef_idx] &&
-                 !f->frame_hdr.cdef.uv_strength[cdef_idx]))
-            {
+            const int y_lvl = cdef_idx == -1 ? 0 :
+                f->frame_hdr.cdef.y_strength[cdef_idx];
+            const int uv_lvl = cdef_idx == -1 || !has_chroma ? 0 :
+                f->frame_hdr.cdef.uv_strength[cdef_idx];
+            if (!y_lvl && !uv_lvl) {
                 last_skip = 1;
                 goto next_sb;
             }
 
-            const int y_lvl = f->frame_hdr.cdef.y_strength[cdef_idx];
-            const int uv_lvl = f->frame_hdr.cdef.uv_strength[cdef_idx];
+            const int y_pri_lvl = (y_lvl >> 2) << (BITDEPTH - 8);
+            int y_sec_lvl = y_lvl & 3;
+            y_sec_lvl += y_sec_lvl == 3;
+            y_sec_lvl <<= BITDEPTH - 8;
+            const int uv_pri_lvl = (uv_lvl >> 2) << (BITDEPTH - 8);
+            int uv_sec_lvl = uv_lvl & 3;
+            uv_sec_lvl += uv_sec_lvl == 3;
+            uv_sec_lvl <<= BITDEPTH - 8;
             pixel *bptrs[3] = { iptrs[0], iptrs[1], iptrs[2] };
             for (int bx = sbx * sbsz; bx < imin((sbx + 1) * sbsz, f->bw);
                  bx += 2, edges |= HAVE_LEFT)
@@ -161,32 +152,24 @@ void bytefn(dav1d_cdef_brow)(Dav1dFrameContext *const f,
                     goto next_b;
                 }
 
-                if (!last_skip) {
-                    // backup post-filter data (will be restored at the end)
-                    backup2x8(lr_bak[1], bptrs, f->cur.p.stride, 0, layout);
-
-                    // restore pre-filter data from last iteration
-                    restore2x8(bptrs, f->cur.p.stride, lr_bak[0], layout);
+                if (last_skip && edges & HAVE_LEFT) {
+                    // the block to the left was not filtered, so its
+                    // pre-filter pixels are still in the frame
+                    backup2x8(lr_bak[bit], bptrs, f->cur.p.stride, 0, layout);
                 }
                 if (edges & HAVE_RIGHT) {
                     // backup pre-filter data for next iteration
-                    backup2x8(lr_bak[0], bptrs, f->cur.p.stride, 8, layout);
+                    backup2x8(lr_bak[!bit], bptrs, f->cur.p.stride, 8, layout);
                 }
 
-                // the actual filter
-                const int y_pri_lvl = (y_lvl >> 2) << (BITDEPTH - 8);
-                int y_sec_lvl = y_lvl & 3;
-                y_sec_lvl += y_sec_lvl == 3;
-                y_sec_lvl <<= BITDEPTH - 8;
-                const int uv_pri_lvl = (uv_lvl >> 2) << (BITDEPTH - 8);
-                int uv_sec_lvl = uv_lvl & 3;
-                uv_sec_lvl += uv_sec_lvl == 3;
-                uv_sec_lvl <<= BITDEPTH - 8;
-                unsigned variance;
-                const int dir = dsp->cdef.dir(bptrs[0], f->cur.p.stride[0],
-                                              &variance);
+                // the actual filter; the direction only matters for the
+                // primary taps
+                unsigned variance = 0;
+                const int dir = y_pri_lvl || uv_pri_lvl ?
+                    dsp->cdef.dir(bptrs[0], f->cur.p.stride[0], &variance) : 0;
                 if (y_lvl) {
                     dsp->cdef.fb[0](bptrs[0], f->cur.p.stride[0],
+                                    lr_bak[bit][0],
                                     (pixel *const [2]) {
                                         &f->lf.cdef_line_ptr[tf][0][0][bx * 4],
                                         &f->lf.cdef_line_ptr[tf][0][1][bx * 4],
@@ -195,12 +178,13 @@ void bytefn(dav1d_cdef_brow)(Dav1dFrameContext *const f,
                                     y_sec_lvl, y_pri_lvl ? dir : 0,
                                     damping, edges);
                 }
-                if (uv_lvl && has_chroma) {
+                if (uv_lvl) {
                     const int uvdir =
                         f->cur.p.p.layout != DAV1D_PIXEL_LAYOUT_I422 ? dir :
                         ((uint8_t[]) { 7, 0, 2, 4, 5, 6, 6, 6 })[dir];
                     for (int pl = 1; pl <= 2; pl++) {
                         dsp->cdef.fb[uv_idx](bptrs[pl], f->cur.p.stride[1],
+                                             lr_bak[bit][pl],
                                              (pixel *const [2]) {
                                                  &f->lf.cdef_line_ptr[tf][pl][0][bx * 4 >> ss_hor],
                                                  &f->lf.cdef_line_ptr[tf][pl][1][bx * 4 >> ss_hor],
@@ -211,10 +195,7 @@ void bytefn(dav1d_cdef_brow)(Dav1dFrameContext *const f,
                     }
                 }
 
-                if (!last_skip) {
-                    // restore post-filter data from the beginning of this loop
-                    restore2x8(bptrs, f->cur.p.stride, lr_bak[1], layout);
-                }
+                bit ^= 1;
                 last_skip = 0;
 
             next_b:
@@ -234,4 +215,5 @@ void bytefn(dav1d_cdef_brow)(Dav1dFrameContext *const f,
         ptrs[2] += 8 * PXSTRIDE(f->cur.p.stride[1]) >> ss_ver;
         f->lf.top_pre_cdef_toggle ^= 1;
     }
+    PROF_END(prof_start, DAV1D_PROF_CDEF);
 }
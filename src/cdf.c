@@ -4048,40 +4048,45 @@ static inline int get_qcat_idx(int q) {
     return 3;
 }
 
-static CdfThreadContext cdf_init[4] = {
-    [0] = { .cdf = NULL },
-    [1] = { .cdf = NULL },
-    [2] = { .cdf = NULL },
-    [3] = { .cdf = NULL },
-};
+static CdfThreadContext cdf_init[4];
+static pthread_once_t cdf_init_once = PTHREAD_ONCE_INIT;
 
-void av1_init_states(CdfThreadContext *const cdf, const int qidx) {
-    const int qcat = get_qcat_idx(qidx);
-    if (cdf_init[qcat].cdf) {
-        cdf_thread_ref(cdf, &cdf_init[qcat]);
-        return;
+// Several decoder instances may start on their first frame at the same time,
+// so the default contexts of all quantizer categories are set up at once.
+static void init_default_cdfs(void) {
+    for (int qcat = 0; qcat < 4; qcat++) {
+        cdf_thread_alloc(&cdf_init[qcat], NULL);
+        cdf_init[qcat].cdf->m = av1_default_cdf;
+        memcpy(cdf_init[qcat].cdf->kfym, default_kf_y_mode_cdf,
+               sizeof(default_kf_y_mode_cdf));
+        cdf_init[qcat].cdf->coef = av1_default_coef_cdf[qcat];
+        cdf_init[qcat].cdf->mv = default_mv_cdf;
+        cdf_init[qcat].cdf->dmv = default_mv_cdf;
     }
+}
 
-    cdf_thread_alloc(&cdf_init[qcat], NULL);
-    cdf_init[qcat].cdf->m = av1_default_cdf;
-    memcpy(cdf_init[qcat].cdf->kfym, default_kf_y_mode_cdf,
-           sizeof(default_kf_y_mode_cdf));
-    cdf_init[qcat].cdf->coef = av1_default_coef_cdf[qcat];
-    cdf_init[qcat].cdf->mv = default_mv_cdf;
-    cdf_init[qcat].cdf->dmv = default_mv_cdf;
-    cdf_thread_ref(cdf, &cdf_init[qcat]);
+void av1_init_states(CdfThreadContext *const cdf, const int qidx) {
+    pthread_once(&cdf_init_once, init_default_cdfs);
+    cdf_thread_ref(cdf, &cdf_init[get_qcat_idx(qidx)]);
 }
 
 void av1_update_tile_cdf(const Av1FrameHeader *const hdr,
-                         CdfContext *const dst,
+                         CdfContext *const dst, const CdfContext *const in,
                          const CdfContext *const src)
 {
     int i, j, k, l;
 
+    // All coefficient contexts are adapted and written below, so only the
+    // others, of which a frame type only adapts a subset, start from $in.
+    dst->m = in->m;
+    memcpy(dst->kfym, in->kfym, sizeof(dst->kfym));
+    dst->mv = in->mv;
+    dst->dmv = in->dmv;
+
 #define update_cdf_1d(n1d, name) \
     do { \
-        memcpy(dst->name, src->name, sizeof(*dst->name) * n1d); \
-        assert(!dst->name[n1d - 1]); \
+        memcpy(dst->name, src->name, sizeof(*dst->name) * (n1d)); \
+        assert(!dst->name[(n1d) - 1]); \
         dst->name[n1d] = 0; \
     } while (0)
 
@@ -4231,14 +4236,18 @@ void cdf_thread_unref(CdfThreadContext *const cdf) {
     memset(cdf, 0, sizeof(*cdf));
 }
 
-void cdf_thread_wait(CdfThreadContext *const cdf) {
-    if (!cdf->t) return;
+int cdf_thread_wait(CdfThreadContext *const cdf) {
+    if (!cdf->t) return 0;
 
-    if (atomic_load(cdf->progress)) return;
+    if (atomic_load(cdf->progress)) return 0;
+    dav1d_spin_while(&cdf->t->spin, !atomic_load(cdf->progress));
+    if (atomic_load(cdf->progress)) return 1;
     pthread_mutex_lock(&cdf->t->lock);
     while (!atomic_load(cdf->progress))
         pthread_cond_wait(&cdf->t->cond, &cdf->t->lock);
     pthread_mutex_unlock(&cdf->t->lock);
+
+    return 1;
 }
 
 void cdf_thread_signal(CdfThreadContext *const cdf) {
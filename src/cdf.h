@@ -133,7 +133,7 @@ typedef struct CdfThreadContext {
 
 void av1_init_states(CdfThreadContext *cdf, int qidx);
 void av1_update_tile_cdf(const Av1FrameHeader *hdr, CdfContext *dst,
-                         const CdfContext *src);
+                         const CdfContext *in, const CdfContext *src);
 
 void cdf_thread_alloc(CdfThreadContext *cdf, struct thread_data *t);
 void cdf_thread_ref(CdfThreadContext *dst, CdfThreadContext *src);
@@ -141,8 +141,9 @@ void cdf_thread_unref(CdfThreadContext *cdf);
 
 /*
  * These are binary signals (so a signal is either "done" or "not done").
+ * cdf_thread_wait() returns whether it had to wait.
  */
-void cdf_thread_wait(CdfThreadContext *cdf);
+int cdf_thread_wait(CdfThreadContext *cdf);
 void cdf_thread_signal(CdfThreadContext *cdf);
 
 #endif /* __AV1_CDF_H__ */
@@ -29,8 +29,8 @@
 
 #include <errno.h>
 #include <limits.h>
+#include <stdlib.h>
 #include <string.h>
-#include <stdio.h>
 #include <inttypes.h>
 
 #include "dav1d/data.h"
@@ -38,15 +38,21 @@
 #include "common/intops.h"
 #include "common/mem.h"
 
+#include "src/cpu.h"
 #include "src/decode.h"
 #include "src/dequant_tables.h"
 #include "src/env.h"
+#include "src/fg_apply.h"
+#include "src/log.h"
+#include "src/pixfmt.h"
+#include "src/profile.h"
 #include "src/qm.h"
 #include "src/recon.h"
 #include "src/ref.h"
 #include "src/tables.h"
 #include "src/thread_task.h"
 #include "src/warpmv.h"
+#include "src/wedge.h"
 
 static void init_quant_tables(const Av1SequenceHeader *const seq_hdr,
                               const Av1FrameHeader *const frame_hdr,
@@ -78,13 +84,13 @@ static int read_mv_component_diff(Dav1dTileContext *const t,
     const Dav1dFrameContext *const f = t->f;
     const int have_hp = f->frame_hdr.hp;
     const int sign = msac_decode_bool_adapt(&ts->msac, mv_comp->sign);
-    const int cl = msac_decode_symbol_adapt(&ts->msac, mv_comp->classes, 11);
+    const int cl = msac_decode_symbol_adapt16(&ts->msac, mv_comp->classes, 11);
     int up, fp, hp;
 
     if (!cl) {
         up = msac_decode_bool_adapt(&ts->msac, mv_comp->class0);
         if (have_fp) {
-            fp = msac_decode_symbol_adapt(&ts->msac, mv_comp->class0_fp[up], 4);
+            fp = msac_decode_symbol_adapt4(&ts->msac, mv_comp->class0_fp[up], 4);
             hp = have_hp ? msac_decode_bool_adapt(&ts->msac, mv_comp->class0_hp) : 1;
         } else {
             fp = 3;
@@ -95,7 +101,7 @@ static int read_mv_component_diff(Dav1dTileContext *const t,
         for (int n = 0; n < cl; n++)
             up |= msac_decode_bool_adapt(&ts->msac, mv_comp->classN[n]) << n;
         if (have_fp) {
-            fp = msac_decode_symbol_adapt(&ts->msac, mv_comp->classN_fp, 4);
+            fp = msac_decode_symbol_adapt4(&ts->msac, mv_comp->classN_fp, 4);
             hp = have_hp ? msac_decode_bool_adapt(&ts->msac, mv_comp->classN_hp) : 1;
         } else {
             fp = 3;
@@ -111,7 +117,7 @@ static int read_mv_component_diff(Dav1dTileContext *const t,
 static void read_mv_residual(Dav1dTileContext *const t, mv *const ref_mv,
                              CdfMvContext *const mv_cdf, const int have_fp)
 {
-    switch (msac_decode_symbol_adapt(&t->ts->msac, t->ts->cdf.mv.joint, N_MV_JOINTS)) {
+    switch (msac_decode_symbol_adapt4(&t->ts->msac, t->ts->cdf.mv.joint, N_MV_JOINTS)) {
     case MV_JOINT_HV:
         ref_mv->y += read_mv_component_diff(t, &mv_cdf->comp[0], have_fp);
         ref_mv->x += read_mv_component_diff(t, &mv_cdf->comp[1], have_fp);
@@ -214,7 +220,7 @@ static void find_matching_ref(const Dav1dTileContext *const t,
                         have_top && t->bx + bw4 < t->ts->tiling.col_end &&
                         (intra_edge_flags & EDGE_I444_TOP_HAS_RIGHT);
 
-#define bs(rp) av1_block_dimensions[sbtype_to_bs[(rp)->sb_type]]
+#define bs(rp) av1_block_dimensions[(rp)->bs]
 #define matches(rp) ((rp)->ref[0] == ref + 1 && (rp)->ref[1] == -1)
 
     if (have_top) {
@@ -362,7 +368,7 @@ static void read_pal_plane(Dav1dTileContext *const t, Av1Block *const b,
 {
     Dav1dTileState *const ts = t->ts;
     const Dav1dFrameContext *const f = t->f;
-    const int pal_sz = b->pal_sz[pl] = 2 + msac_decode_symbol_adapt(&ts->msac,
+    const int pal_sz = b->pal_sz[pl] = 2 + msac_decode_symbol_adapt8(&ts->msac,
                                                  ts->cdf.m.pal_sz[pl][sz_ctx], 7);
     uint16_t cache[16], used_cache[8];
     int l_cache = pl ? t->pal_sz_uv[1][by4] : t->l.pal_sz[by4];
@@ -411,7 +417,7 @@ static void read_pal_plane(Dav1dTileContext *const t, Av1Block *const b,
     const int n_used_cache = i;
 
     // parse new entries
-    uint16_t *const pal = f->frame_thread.pass ?
+    uint16_t *const pal = t->pass ?
         f->frame_thread.pal[((t->by >> 1) + (t->bx & 1)) * (f->b4_stride >> 1) +
                             ((t->bx >> 1) + (t->by & 1))][pl] : t->pal[pl];
     if (i < pal_sz) {
@@ -448,14 +454,14 @@ static void read_pal_plane(Dav1dTileContext *const t, Av1Block *const b,
     }
 
     if (DEBUG_BLOCK_INFO) {
-        printf("Post-pal[pl=%d,sz=%d,cache_size=%d,used_cache=%d]: r=%d, cache=",
-               pl, pal_sz, n_cache, n_used_cache, ts->msac.rng);
+        dav1d_log(f->c, "Post-pal[pl=%d,sz=%d,cache_size=%d,used_cache=%d]: r=%d, cache=",
+                  pl, pal_sz, n_cache, n_used_cache, ts->msac.rng);
         for (int n = 0; n < n_cache; n++)
-            printf("%c%02x", n ? ' ' : '[', cache[n]);
-        printf("%s, pal=", n_cache ? "]" : "[]");
+            dav1d_log(f->c, "%c%02x", n ? ' ' : '[', cache[n]);
+        dav1d_log(f->c, "%s, pal=", n_cache ? "]" : "[]");
         for (int n = 0; n < pal_sz; n++)
-            printf("%c%02x", n ? ' ' : '[', pal[n]);
-        printf("]\n");
+            dav1d_log(f->c, "%c%02x", n ? ' ' : '[', pal[n]);
+        dav1d_log(f->c, "]\n");
     }
 }
 
@@ -467,7 +473,7 @@ static void read_pal_uv(Dav1dTileContext *const t, Av1Block *const b,
     // V pal coding
     Dav1dTileState *const ts = t->ts;
     const Dav1dFrameContext *const f = t->f;
-    uint16_t *const pal = f->frame_thread.pass ?
+    uint16_t *const pal = t->pass ?
         f->frame_thread.pal[((t->by >> 1) + (t->bx & 1)) * (f->b4_stride >> 1) +
                             ((t->bx >> 1) + (t->by & 1))][2] : t->pal[2];
     if (msac_decode_bool(&ts->msac, 128 << 7)) {
@@ -484,79 +490,72 @@ static void read_pal_uv(Dav1dTileContext *const t, Av1Block *const b,
             pal[i] = msac_decode_bools(&ts->msac, f->cur.p.p.bpc);
     }
     if (DEBUG_BLOCK_INFO) {
-        printf("Post-pal[pl=2]: r=%d ", ts->msac.rng);
+        dav1d_log(f->c, "Post-pal[pl=2]: r=%d ", ts->msac.rng);
         for (int n = 0; n < b->pal_sz[1]; n++)
-            printf("%c%02x", n ? ' ' : '[', pal[n]);
-        printf("]\n");
+            dav1d_log(f->c, "%c%02x", n ? ' ' : '[', pal[n]);
+        dav1d_log(f->c, "]\n");
     }
 }
 
-// meant to be SIMD'able, so that theoretical complexity of this function
-// times block size goes from w4*h4 to w4+h4-1
-// a and b are previous two lines containing (a) top/left entries or (b)
-// top/left entries, with a[0] being either the first top or first left entry,
-// depending on top_offset being 1 or 0, and b being the first top/left entry
-// for whichever has one. left_offset indicates whether the (len-1)th entry
-// has a left neighbour.
-// output is order[] and ctx for each member of this diagonal.
-static void order_palette(const uint8_t *pal_idx, const ptrdiff_t stride,
-                          const int i, const int first, const int last,
-                          uint8_t (*const order)[8], uint8_t *const ctx)
+// colour context for the pattern of equal neighbours (bit 0: top == left,
+// bit 1: top == top-left, bit 2: left == top-left); the other patterns
+// can't happen
+static const uint8_t pal_ctx_lut[8] = { 1, 3, 2, 0, 2, 0, 0, 4 };
+
+// Derives the context of the colour at pal_idx from its decoded top, left
+// and top-left neighbours, and the candidates these put first in the
+// colour order (cand[], with their bits set in *mask); the remaining
+// palette entries follow in increasing order, see get_pal_color().
+static inline int get_pal_ctx(const uint8_t *const pal_idx,
+                              const ptrdiff_t stride,
+                              const int have_top, const int have_left,
+                              uint8_t cand[3], unsigned *const mask)
 {
-    int have_top = i > first;
-
-    pal_idx += first + (i - first) * stride;
-    for (int j = first, n = 0; j >= last; have_top = 1, j--, n++, pal_idx += stride - 1) {
-        const int have_left = j > 0;
-
-        assert(have_left || have_top);
-
-#define add(v_in) do { \
-        const int v = v_in; \
-        assert(v < 8U); \
-        order[n][o_idx++] = v; \
-        mask |= 1 << v; \
-    } while (0)
-
-        unsigned mask = 0;
-        int o_idx = 0;
-        if (!have_left) {
-            ctx[n] = 0;
-            add(pal_idx[-stride]);
-        } else if (!have_top) {
-            ctx[n] = 0;
-            add(pal_idx[-1]);
-        } else {
-            const int l = pal_idx[-1], t = pal_idx[-stride], tl = pal_idx[-(stride + 1)];
-            const int same_t_l = t == l;
-            const int same_t_tl = t == tl;
-            const int same_l_tl = l == tl;
-            const int same_all = same_t_l & same_t_tl & same_l_tl;
-
-            if (same_all) {
-                ctx[n] = 4;
-                add(t);
-            } else if (same_t_l) {
-                ctx[n] = 3;
-                add(t);
-                add(tl);
-            } else if (same_t_tl | same_l_tl) {
-                ctx[n] = 2;
-                add(tl);
-                add(same_t_tl ? l : t);
-            } else {
-                ctx[n] = 1;
-                add(imin(t, l));
-                add(imax(t, l));
-                add(tl);
-            }
-        }
-        for (unsigned m = 1, bit = 0; m < 0x100; m <<= 1, bit++)
-            if (!(mask & m))
-                order[n][o_idx++] = bit;
-        assert(o_idx == 8);
-#undef add
+    assert(have_left || have_top);
+    if (!have_left || !have_top) {
+        cand[0] = have_left ? pal_idx[-1] : pal_idx[-stride];
+        *mask = 1U << cand[0];
+        return 0;
     }
+
+    const int l = pal_idx[-1], t = pal_idx[-stride], tl = pal_idx[-(stride + 1)];
+    const int ctx = pal_ctx_lut[(t == l) | (t == tl) << 1 | (l == tl) << 2];
+    assert(ctx);
+    switch (ctx) {
+    case 4:
+        cand[0] = t;
+        break;
+    case 3:
+        cand[0] = t;
+        cand[1] = tl;
+        break;
+    case 2:
+        cand[0] = tl;
+        cand[1] = t == tl ? l : t;
+        break;
+    default:
+        cand[0] = imin(t, l);
+        cand[1] = imax(t, l);
+        cand[2] = tl;
+        break;
+    }
+    *mask = (1U << t) | (1U << l) | (1U << tl);
+    return ctx;
+}
+
+// Maps a decoded colour index back to the palette entry, without building
+// the full colour order: the n_cand (1 to 3, depending on ctx) neighbour
+// candidates, then the other entries in increasing order.
+static inline int get_pal_color(const uint8_t cand[3], const unsigned mask,
+                                const int ctx, int color_idx)
+{
+    static const uint8_t n_cand[5] = { 1, 3, 2, 2, 1 };
+    if (color_idx < n_cand[ctx])
+        return cand[color_idx];
+    unsigned free = ~mask & 0xff;
+    for (color_idx -= n_cand[ctx]; color_idx; color_idx--)
+        free &= free - 1;
+    return ctz(free);
 }
 
 static void read_pal_indices(Dav1dTileContext *const t,
@@ -567,20 +566,23 @@ static void read_pal_indices(Dav1dTileContext *const t,
 {
     Dav1dTileState *const ts = t->ts;
     const ptrdiff_t stride = bw4 * 4;
-    pal_idx[0] = msac_decode_uniform(&ts->msac, b->pal_sz[pl]);
+    const unsigned pal_sz = b->pal_sz[pl];
+    pal_idx[0] = msac_decode_uniform(&ts->msac, pal_sz);
     uint16_t (*const color_map_cdf)[8 + 1] =
-        ts->cdf.m.color_map[pl][b->pal_sz[pl] - 2];
+        ts->cdf.m.color_map[pl][pal_sz - 2];
     for (int i = 1; i < 4 * (w4 + h4) - 1; i++) {
         // top/left-to-bottom/right diagonals ("wave-front")
-        uint8_t order[64][8], ctx[64];
         const int first = imin(i, w4 * 4 - 1);
         const int last = imax(0, i - h4 * 4 + 1);
-        order_palette(pal_idx, stride, i, first, last, order, ctx);
-        for (int j = first, m = 0; j >= last; j--, m++) {
+        uint8_t *p = &pal_idx[(i - first) * stride + first];
+        for (int j = first; j >= last; j--, p += stride - 1) {
+            uint8_t cand[3];
+            unsigned mask;
+            const int ctx = get_pal_ctx(p, stride, i > j, j > 0, cand, &mask);
             const int color_idx =
-                msac_decode_symbol_adapt(&ts->msac, color_map_cdf[ctx[m]],
-                                         b->pal_sz[pl]);
-            pal_idx[(i - j) * stride + j] = order[m][color_idx];
+                msac_decode_symbol_adapt8(&ts->msac, color_map_cdf[ctx],
+                                          pal_sz);
+            *p = get_pal_color(cand, mask, ctx, color_idx);
         }
     }
     // fill invisible edges
@@ -637,23 +639,24 @@ static void read_vartx_tree(Dav1dTileContext *const t,
         }
         t->by -= y;
         if (DEBUG_BLOCK_INFO)
-            printf("Post-vartxtree[%x/%x]: r=%d\n",
-                   b->tx_split[0], b->tx_split[1], t->ts->msac.rng);
+            dav1d_log(f->c, "Post-vartxtree[%x/%x]: r=%d\n",
+                      b->tx_split[0], b->tx_split[1], t->ts->msac.rng);
         b->uvtx = av1_max_txfm_size_for_bs[bs][f->cur.p.p.layout];
     }
 }
 
-static inline unsigned get_prev_frame_segid(const Dav1dFrameContext *const f,
+static inline unsigned get_prev_frame_segid(const Dav1dTileContext *const t,
                                             const int by, const int bx,
                                             const int w4, int h4,
                                             const uint8_t *ref_seg_map,
                                             const ptrdiff_t stride)
 {
+    const Dav1dFrameContext *const f = t->f;
     unsigned seg_id = 8;
 
     assert(f->frame_hdr.primary_ref_frame != PRIMARY_REF_NONE);
-    dav1d_thread_picture_wait(&f->refp[f->frame_hdr.primary_ref_frame],
-                              (by + h4) * 4, PLANE_TYPE_BLOCK);
+    dav1d_wait_ref(t, &f->refp[f->frame_hdr.primary_ref_frame],
+                   (by + h4) * 4, PLANE_TYPE_BLOCK);
 
     ref_seg_map += by * stride + bx;
     do {
@@ -666,6 +669,52 @@ static inline unsigned get_prev_frame_segid(const Dav1dFrameContext *const f,
     return seg_id;
 }
 
+static void export_block_info(Dav1dTileContext *const t, const Av1Block *const b,
+                              const int bw4, const int bh4,
+                              const int w4, const int h4)
+{
+    const Dav1dFrameContext *const f = t->f;
+    Dav1dBlockInfo info = {
+        .ref = { 0, -1 },
+        .w4 = bw4, .h4 = bh4,
+        .seg_id = b->seg_id,
+        .flags = b->skip ? DAV1D_BLOCK_SKIP : 0,
+    };
+
+    if (b->intra) {
+        info.mode = b->y_mode == FILTER_PRED ? DC_PRED : b->y_mode;
+        info.tx = b->tx;
+        info.flags |= DAV1D_BLOCK_INTRA;
+        if (b->pal_sz[0]) info.flags |= DAV1D_BLOCK_PALETTE;
+    } else if (!(f->frame_hdr.frame_type & 1)) {
+        info.mv[0].y = b->mv[0].y;
+        info.mv[0].x = b->mv[0].x;
+        info.tx = b->max_ytx;
+        info.flags |= DAV1D_BLOCK_INTRABC;
+    } else {
+        const int is_comp = b->comp_type != COMP_INTER_NONE;
+        // spec numbering: the inter modes follow the 13 intra modes
+        info.mode = N_INTRA_PRED_MODES +
+                    (is_comp ? N_INTER_PRED_MODES : 0) + b->inter_mode;
+        info.ref[0] = b->ref[0] + 1;
+        info.mv[0].y = b->mv[0].y;
+        info.mv[0].x = b->mv[0].x;
+        if (is_comp) {
+            info.ref[1] = b->ref[1] + 1;
+            info.mv[1].y = b->mv[1].y;
+            info.mv[1].x = b->mv[1].x;
+        }
+        info.tx = b->max_ytx;
+    }
+
+    const ptrdiff_t stride = f->cur.p.block_info_stride;
+    Dav1dBlockInfo *row = &f->cur.p.block_info[(t->by >> 1) * stride];
+    const int x_start = t->bx >> 1, x_end = (t->bx + w4 + 1) >> 1;
+    for (int y = t->by >> 1; y < (t->by + h4 + 1) >> 1; y++, row += stride)
+        for (int x = x_start; x < x_end; x++)
+            row[x] = info;
+}
+
 static void decode_b(Dav1dTileContext *const t,
                      const enum BlockLevel bl,
                      const enum BlockSize bs,
@@ -674,8 +723,8 @@ static void decode_b(Dav1dTileContext *const t,
 {
     Dav1dTileState *const ts = t->ts;
     const Dav1dFrameContext *const f = t->f;
-    Av1Block b_mem, *const b = f->frame_thread.pass ?
-        &f->frame_thread.b[t->by * f->b4_stride + t->bx] : &b_mem;
+    Av1Block b_mem, *const b = t->pass ?
+        t->frame_thread.b++ : &b_mem;
     const uint8_t *const b_dim = av1_block_dimensions[bs];
     const int bx4 = t->bx & 31, by4 = t->by & 31;
     const int ss_ver = f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420;
@@ -690,7 +739,7 @@ static void decode_b(Dav1dTileContext *const t,
                            (bw4 > ss_hor || t->bx & 1) &&
                            (bh4 > ss_ver || t->by & 1);
 
-    if (f->frame_thread.pass == 2) {
+    if (t->pass == 2) {
         if (b->intra) {
             f->bd_fn.recon_b_intra(t, bs, intra_edge_flags, b);
 
@@ -703,7 +752,10 @@ static void decode_b(Dav1dTileContext *const t,
             memset(&t->l.mode[by4], y_mode_nofilt, bh4);
             memset(&t->a->mode[bx4], y_mode_nofilt, bw4);
         } else {
-            if (b->comp_type == COMP_INTER_NONE && b->motion_mode == MM_WARP) {
+            // the motion mode is not coded (or set) for intra block copy
+            if ((f->frame_hdr.frame_type & 1) &&
+                b->comp_type == COMP_INTER_NONE && b->motion_mode == MM_WARP)
+            {
                 uint64_t mask[2] = { 0, 0 };
                 find_matching_ref(t, intra_edge_flags, bw4, bh4, w4, h4,
                                   have_left, have_top, b->ref[0], mask);
@@ -738,7 +790,7 @@ static void decode_b(Dav1dTileContext *const t,
         b->skip_mode = msac_decode_bool_adapt(&ts->msac,
                                               ts->cdf.m.skip_mode[smctx]);
         if (DEBUG_BLOCK_INFO)
-            printf("Post-skipmode[%d]: r=%d\n", b->skip_mode, ts->msac.rng);
+            dav1d_log(f->c, "Post-skipmode[%d]: r=%d\n", b->skip_mode, ts->msac.rng);
     } else {
         b->skip_mode = 0;
     }
@@ -748,7 +800,7 @@ static void decode_b(Dav1dTileContext *const t,
     if (f->frame_hdr.segmentation.enabled) {
         if (!f->frame_hdr.segmentation.update_map) {
             b->seg_id = f->prev_segmap ?
-                        get_prev_frame_segid(f, t->by, t->bx, w4, h4,
+                        get_prev_frame_segid(t, t->by, t->bx, w4, h4,
                                              f->prev_segmap, f->b4_stride) : 0;
         } else if (f->frame_hdr.segmentation.seg_data.preskip) {
             if (f->frame_hdr.segmentation.temporal &&
@@ -758,14 +810,14 @@ static void decode_b(Dav1dTileContext *const t,
             {
                 // temporal predicted seg_id
                 b->seg_id = f->prev_segmap ?
-                            get_prev_frame_segid(f, t->by, t->bx, w4, h4,
+                            get_prev_frame_segid(t, t->by, t->bx, w4, h4,
                                                  f->prev_segmap, f->b4_stride) : 0;
             } else {
                 int seg_ctx;
                 const unsigned pred_seg_id =
                     get_cur_frame_segid(t->by, t->bx, have_top, have_left,
                                         &seg_ctx, f->cur_segmap, f->b4_stride);
-                const unsigned diff = msac_decode_symbol_adapt(&ts->msac,
+                const unsigned diff = msac_decode_symbol_adapt8(&ts->msac,
                                                    ts->cdf.m.seg_id[seg_ctx],
                                                    NUM_SEGMENTS);
                 const unsigned last_active_seg_id =
@@ -776,8 +828,8 @@ static void decode_b(Dav1dTileContext *const t,
             }
 
             if (DEBUG_BLOCK_INFO)
-                printf("Post-segid[preskip;%d]: r=%d\n",
-                       b->seg_id, ts->msac.rng);
+                dav1d_log(f->c, "Post-segid[preskip;%d]: r=%d\n",
+                          b->seg_id, ts->msac.rng);
         }
     } else {
         b->seg_id = 0;
@@ -788,7 +840,7 @@ static void decode_b(Dav1dTileContext *const t,
     b->skip = b->skip_mode ? 1 :
               msac_decode_bool_adapt(&ts->msac, ts->cdf.m.skip[sctx]);
     if (DEBUG_BLOCK_INFO)
-        printf("Post-skip[%d]: r=%d\n", b->skip, ts->msac.rng);
+        dav1d_log(f->c, "Post-skip[%d]: r=%d\n", b->skip, ts->msac.rng);
 
     // segment_id
     if (f->frame_hdr.segmentation.enabled &&
@@ -802,7 +854,7 @@ static void decode_b(Dav1dTileContext *const t,
         {
             // temporal predicted seg_id
             b->seg_id = f->prev_segmap ?
-                        get_prev_frame_segid(f, t->by, t->bx, w4, h4,
+                        get_prev_frame_segid(t, t->by, t->bx, w4, h4,
                                              f->prev_segmap, f->b4_stride) : 0;
         } else {
             int seg_ctx;
@@ -812,7 +864,7 @@ static void decode_b(Dav1dTileContext *const t,
             if (b->skip) {
                 b->seg_id = pred_seg_id;
             } else {
-                const unsigned diff = msac_decode_symbol_adapt(&ts->msac,
+                const unsigned diff = msac_decode_symbol_adapt8(&ts->msac,
                                                    ts->cdf.m.seg_id[seg_ctx],
                                                    NUM_SEGMENTS);
                 const unsigned last_active_seg_id =
@@ -824,8 +876,8 @@ static void decode_b(Dav1dTileContext *const t,
         }
 
         if (DEBUG_BLOCK_INFO)
-            printf("Post-segid[postskip;%d]: r=%d\n",
-                   b->seg_id, ts->msac.rng);
+            dav1d_log(f->c, "Post-segid[postskip;%d]: r=%d\n",
+                      b->seg_id, ts->msac.rng);
     }
 
     // cdef index
@@ -840,8 +892,8 @@ static void decode_b(Dav1dTileContext *const t,
             if (bw4 == 32 && bh4 == 32) t->cur_sb_cdef_idx_ptr[idx + 3] = v;
 
             if (DEBUG_BLOCK_INFO)
-                printf("Post-cdef_idx[%d]: r=%d\n",
-                        *t->cur_sb_cdef_idx_ptr, ts->msac.rng);
+                dav1d_log(f->c, "Post-cdef_idx[%d]: r=%d\n",
+                           *t->cur_sb_cdef_idx_ptr, ts->msac.rng);
         }
     }
 
@@ -853,7 +905,7 @@ static void decode_b(Dav1dTileContext *const t,
         const int have_delta_q = f->frame_hdr.delta.q.present &&
             (bs != (f->seq_hdr.sb128 ? BS_128x128 : BS_64x64) || !b->skip);
         if (have_delta_q) {
-            int delta_q = msac_decode_symbol_adapt(&ts->msac, ts->cdf.m.delta_q, 4);
+            int delta_q = msac_decode_symbol_adapt4(&ts->msac, ts->cdf.m.delta_q, 4);
             if (delta_q == 3) {
                 const int n_bits = 1 + msac_decode_bools(&ts->msac, 3);
                 delta_q = msac_decode_bools(&ts->msac, n_bits) + 1 + (1 << n_bits);
@@ -864,8 +916,8 @@ static void decode_b(Dav1dTileContext *const t,
             }
             ts->last_qidx = iclip(ts->last_qidx + delta_q, 1, 255);
             if (have_delta_q && DEBUG_BLOCK_INFO)
-                printf("Post-delta_q[%d->%d]: r=%d\n",
-                       delta_q, ts->last_qidx, ts->msac.rng);
+                dav1d_log(f->c, "Post-delta_q[%d->%d]: r=%d\n",
+                          delta_q, ts->last_qidx, ts->msac.rng);
         }
         if (ts->last_qidx == f->frame_hdr.quant.yac) {
             // assign frame-wide q values to this sb
@@ -884,7 +936,7 @@ static void decode_b(Dav1dTileContext *const t,
                 f->seq_hdr.layout != DAV1D_PIXEL_LAYOUT_I400 ? 4 : 2 : 1;
 
             for (int i = 0; i < n_lfs; i++) {
-                int delta_lf = msac_decode_symbol_adapt(&ts->msac,
+                int delta_lf = msac_decode_symbol_adapt4(&ts->msac,
                                 ts->cdf.m.delta_lf[i + f->frame_hdr.delta.lf.multi], 4);
                 if (delta_lf == 3) {
                     const int n_bits = 1 + msac_decode_bools(&ts->msac, 3);
@@ -896,7 +948,7 @@ static void decode_b(Dav1dTileContext *const t,
                 }
                 ts->last_delta_lf[i] = iclip(ts->last_delta_lf[i] + delta_lf, -63, 63);
                 if (have_delta_q && DEBUG_BLOCK_INFO)
-                    printf("Post-delta_lf[%d:%d]: r=%d\n", i, delta_lf, ts->msac.rng);
+                    dav1d_log(f->c, "Post-delta_lf[%d:%d]: r=%d\n", i, delta_lf, ts->msac.rng);
             }
         }
         if (!memcmp(ts->last_delta_lf, (int8_t[4]) { 0, 0, 0, 0 }, 4)) {
@@ -916,11 +968,11 @@ static void decode_b(Dav1dTileContext *const t,
                                        have_top, have_left);
         b->intra = !msac_decode_bool_adapt(&ts->msac, ts->cdf.m.intra[ictx]);
         if (DEBUG_BLOCK_INFO)
-            printf("Post-intra[%d]: r=%d\n", b->intra, ts->msac.rng);
+            dav1d_log(f->c, "Post-intra[%d]: r=%d\n", b->intra, ts->msac.rng);
     } else if (f->frame_hdr.allow_intrabc) {
         b->intra = !msac_decode_bool_adapt(&ts->msac, ts->cdf.m.intrabc);
         if (DEBUG_BLOCK_INFO)
-            printf("Post-intrabcflag[%d]: r=%d\n", b->intra, ts->msac.rng);
+            dav1d_log(f->c, "Post-intrabcflag[%d]: r=%d\n", b->intra, ts->msac.rng);
     } else {
         b->intra = 1;
     }
@@ -931,17 +983,17 @@ static void decode_b(Dav1dTileContext *const t,
             ts->cdf.m.y_mode[av1_ymode_size_context[bs]] :
             ts->cdf.kfym[intra_mode_context[t->a->mode[bx4]]]
                         [intra_mode_context[t->l.mode[by4]]];
-        b->y_mode = msac_decode_symbol_adapt(&ts->msac, ymode_cdf,
+        b->y_mode = msac_decode_symbol_adapt16(&ts->msac, ymode_cdf,
                                               N_INTRA_PRED_MODES);
         if (DEBUG_BLOCK_INFO)
-            printf("Post-ymode[%d]: r=%d\n", b->y_mode, ts->msac.rng);
+            dav1d_log(f->c, "Post-ymode[%d]: r=%d\n", b->y_mode, ts->msac.rng);
 
         // angle delta
         if (b_dim[2] + b_dim[3] >= 2 && b->y_mode >= VERT_PRED &&
             b->y_mode <= VERT_LEFT_PRED)
         {
             uint16_t *const acdf = ts->cdf.m.angle_delta[b->y_mode - VERT_PRED];
-            const int angle = msac_decode_symbol_adapt(&ts->msac, acdf, 7);
+            const int angle = msac_decode_symbol_adapt8(&ts->msac, acdf, 7);
             b->y_angle = angle - 3;
         } else {
             b->y_angle = 0;
@@ -950,20 +1002,20 @@ static void decode_b(Dav1dTileContext *const t,
         if (has_chroma) {
             const int cfl_allowed = !!(cfl_allowed_mask & (1 << bs));
             uint16_t *const uvmode_cdf = ts->cdf.m.uv_mode[cfl_allowed][b->y_mode];
-            b->uv_mode = msac_decode_symbol_adapt(&ts->msac, uvmode_cdf,
+            b->uv_mode = msac_decode_symbol_adapt16(&ts->msac, uvmode_cdf,
                                          N_UV_INTRA_PRED_MODES - !cfl_allowed);
             if (DEBUG_BLOCK_INFO)
-                printf("Post-uvmode[%d]: r=%d\n", b->uv_mode, ts->msac.rng);
+                dav1d_log(f->c, "Post-uvmode[%d]: r=%d\n", b->uv_mode, ts->msac.rng);
 
             if (b->uv_mode == CFL_PRED) {
 #define SIGN(a) (!!(a) + ((a) > 0))
                 const int sign =
-                    msac_decode_symbol_adapt(&ts->msac, ts->cdf.m.cfl_sign, 8) + 1;
+                    msac_decode_symbol_adapt8(&ts->msac, ts->cdf.m.cfl_sign, 8) + 1;
                 const int sign_u = sign * 0x56 >> 8, sign_v = sign - sign_u * 3;
                 assert(sign_u == sign / 3);
                 if (sign_u) {
                     const int ctx = (sign_u == 2) * 3 + sign_v;
-                    b->cfl_alpha[0] = msac_decode_symbol_adapt(&ts->msac,
+                    b->cfl_alpha[0] = msac_decode_symbol_adapt16(&ts->msac,
                                             ts->cdf.m.cfl_alpha[ctx], 16) + 1;
                     if (sign_u == 1) b->cfl_alpha[0] = -b->cfl_alpha[0];
                 } else {
@@ -971,7 +1023,7 @@ static void decode_b(Dav1dTileContext *const t,
                 }
                 if (sign_v) {
                     const int ctx = (sign_v == 2) * 3 + sign_u;
-                    b->cfl_alpha[1] = msac_decode_symbol_adapt(&ts->msac,
+                    b->cfl_alpha[1] = msac_decode_symbol_adapt16(&ts->msac,
                                             ts->cdf.m.cfl_alpha[ctx], 16) + 1;
                     if (sign_v == 1) b->cfl_alpha[1] = -b->cfl_alpha[1];
                 } else {
@@ -979,13 +1031,13 @@ static void decode_b(Dav1dTileContext *const t,
                 }
 #undef SIGN
                 if (DEBUG_BLOCK_INFO)
-                    printf("Post-uvalphas[%d/%d]: r=%d\n",
-                           b->cfl_alpha[0], b->cfl_alpha[1], ts->msac.rng);
+                    dav1d_log(f->c, "Post-uvalphas[%d/%d]: r=%d\n",
+                              b->cfl_alpha[0], b->cfl_alpha[1], ts->msac.rng);
             } else if (b_dim[2] + b_dim[3] >= 2 && b->uv_mode >= VERT_PRED &&
                        b->uv_mode <= VERT_LEFT_PRED)
             {
                 uint16_t *const acdf = ts->cdf.m.angle_delta[b->uv_mode - VERT_PRED];
-                const int angle = msac_decode_symbol_adapt(&ts->msac, acdf, 7);
+                const int angle = msac_decode_symbol_adapt8(&ts->msac, acdf, 7);
                 b->uv_angle = angle - 3;
             } else {
                 b->uv_angle = 0;
@@ -1002,7 +1054,7 @@ static void decode_b(Dav1dTileContext *const t,
                 const int use_y_pal =
                     msac_decode_bool_adapt(&ts->msac, ts->cdf.m.pal_y[sz_ctx][pal_ctx]);
                 if (DEBUG_BLOCK_INFO)
-                    printf("Post-y_pal[%d]: r=%d\n", use_y_pal, ts->msac.rng);
+                    dav1d_log(f->c, "Post-y_pal[%d]: r=%d\n", use_y_pal, ts->msac.rng);
                 if (use_y_pal)
                     read_pal_plane(t, b, 0, sz_ctx, bx4, by4);
             }
@@ -1012,7 +1064,7 @@ static void decode_b(Dav1dTileContext *const t,
                 const int use_uv_pal =
                     msac_decode_bool_adapt(&ts->msac, ts->cdf.m.pal_uv[pal_ctx]);
                 if (DEBUG_BLOCK_INFO)
-                    printf("Post-uv_pal[%d]: r=%d\n", use_uv_pal, ts->msac.rng);
+                    dav1d_log(f->c, "Post-uv_pal[%d]: r=%d\n", use_uv_pal, ts->msac.rng);
                 if (use_uv_pal) // see aomedia bug 2183 for why we use luma coordinates
                     read_pal_uv(t, b, sz_ctx, bx4, by4);
             }
@@ -1025,36 +1077,36 @@ static void decode_b(Dav1dTileContext *const t,
                                             ts->cdf.m.use_filter_intra[bs]);
             if (is_filter) {
                 b->y_mode = FILTER_PRED;
-                b->y_angle = msac_decode_symbol_adapt(&ts->msac,
+                b->y_angle = msac_decode_symbol_adapt8(&ts->msac,
                                                   ts->cdf.m.filter_intra, 5);
             }
             if (DEBUG_BLOCK_INFO)
-                printf("Post-filterintramode[%d/%d]: r=%d\n",
-                       b->y_mode, b->y_angle, ts->msac.rng);
+                dav1d_log(f->c, "Post-filterintramode[%d/%d]: r=%d\n",
+                          b->y_mode, b->y_angle, ts->msac.rng);
         }
 
         if (b->pal_sz[0]) {
             uint8_t *pal_idx;
-            if (f->frame_thread.pass) {
-                pal_idx = ts->frame_thread.pal_idx;
-                ts->frame_thread.pal_idx += bw4 * bh4 * 16;
+            if (t->pass) {
+                pal_idx = t->frame_thread.pal_idx;
+                t->frame_thread.pal_idx += bw4 * bh4 * 16;
             } else
                 pal_idx = t->scratch.pal_idx;
             read_pal_indices(t, pal_idx, b, 0, w4, h4, bw4, bh4);
             if (DEBUG_BLOCK_INFO)
-                printf("Post-y-pal-indices: r=%d\n", ts->msac.rng);
+                dav1d_log(f->c, "Post-y-pal-indices: r=%d\n", ts->msac.rng);
         }
 
         if (has_chroma && b->pal_sz[1]) {
             uint8_t *pal_idx;
-            if (f->frame_thread.pass) {
-                pal_idx = ts->frame_thread.pal_idx;
-                ts->frame_thread.pal_idx += cbw4 * cbh4 * 16;
+            if (t->pass) {
+                pal_idx = t->frame_thread.pal_idx;
+                t->frame_thread.pal_idx += cbw4 * cbh4 * 16;
             } else
                 pal_idx = &t->scratch.pal_idx[bw4 * bh4 * 16];
             read_pal_indices(t, pal_idx, b, 1, cw4, ch4, cbw4, cbh4);
             if (DEBUG_BLOCK_INFO)
-                printf("Post-uv-pal-indices: r=%d\n", ts->msac.rng);
+                dav1d_log(f->c, "Post-uv-pal-indices: r=%d\n", ts->msac.rng);
         }
 
         const TxfmInfo *t_dim;
@@ -1068,8 +1120,8 @@ static void decode_b(Dav1dTileContext *const t,
             if (f->frame_hdr.txfm_mode == TX_SWITCHABLE && t_dim->max > TX_4X4) {
                 const int tctx = get_tx_ctx(t->a, &t->l, t_dim, by4, bx4);
                 uint16_t *const tx_cdf = ts->cdf.m.txsz[t_dim->max - 1][tctx];
-                int depth = msac_decode_symbol_adapt(&ts->msac, tx_cdf,
-                                                     imin(t_dim->max + 1, 3));
+                int depth = msac_decode_symbol_adapt4(&ts->msac, tx_cdf,
+                                                      imin(t_dim->max + 1, 3));
 
                 while (depth--) {
                     b->tx = t_dim->sub;
@@ -1077,11 +1129,11 @@ static void decode_b(Dav1dTileContext *const t,
                 }
             }
             if (DEBUG_BLOCK_INFO)
-                printf("Post-tx[%d]: r=%d\n", b->tx, ts->msac.rng);
+                dav1d_log(f->c, "Post-tx[%d]: r=%d\n", b->tx, ts->msac.rng);
         }
 
         // reconstruction
-        if (f->frame_thread.pass == 1) {
+        if (t->pass == 1) {
             f->bd_fn.read_coef_blocks(t, bs, b);
         } else {
             f->bd_fn.recon_b_intra(t, bs, intra_edge_flags, b);
@@ -1106,7 +1158,7 @@ static void decode_b(Dav1dTileContext *const t,
         memset(&t->l.pal_sz[by4], b->pal_sz[0], bh4);
         memset(&t->a->pal_sz[bx4], b->pal_sz[0], bw4);
         if (b->pal_sz[0]) {
-            uint16_t *const pal = f->frame_thread.pass ?
+            uint16_t *const pal = t->pass ?
                 f->frame_thread.pal[((t->by >> 1) + (t->bx & 1)) * (f->b4_stride >> 1) +
                                     ((t->bx >> 1) + (t->by & 1))][0] : t->pal[0];
             for (int x = 0; x < bw4; x++)
@@ -1121,7 +1173,7 @@ static void decode_b(Dav1dTileContext *const t,
             memset(&t->pal_sz_uv[1][by4], b->pal_sz[1], bh4);
             memset(&t->pal_sz_uv[0][bx4], b->pal_sz[1], bw4);
             if (b->pal_sz[1]) for (int pl = 1; pl < 3; pl++) {
-                uint16_t *const pal = f->frame_thread.pass ?
+                uint16_t *const pal = t->pass ?
                     f->frame_thread.pal[((t->by >> 1) + (t->bx & 1)) * (f->b4_stride >> 1) +
                                         ((t->bx >> 1) + (t->by & 1))][pl] : t->pal[pl];
                 // see aomedia bug 2183 for why we use luma coordinates here
@@ -1158,10 +1210,9 @@ static void decode_b(Dav1dTileContext *const t,
         int n_mvs;
         mv mvlist[2][2];
         av1_find_ref_mvs(mvstack, &n_mvs, mvlist, NULL,
-                         (int[2]) { -1, -1 }, f->bw, f->bh,
-                         bs, bp, t->by, t->bx, ts->tiling.col_start,
-                         ts->tiling.col_end, ts->tiling.row_start,
-                         ts->tiling.row_end, f->libaom_cm);
+                         (int[2]) { -1, -1 }, bs, bp, t->by, t->bx,
+                         ts->tiling.col_start, ts->tiling.col_end,
+                         ts->tiling.row_start, ts->tiling.row_end, &f->rf);
 
         if (mvlist[0][0].y | mvlist[0][0].x)
             b->mv[0] = mvlist[0][0];
@@ -1180,13 +1231,13 @@ static void decode_b(Dav1dTileContext *const t,
         const struct mv ref = b->mv[0];
         read_mv_residual(t, &b->mv[0], &ts->cdf.dmv, 0);
         if (DEBUG_BLOCK_INFO)
-            printf("Post-dmv[%d/%d,ref=%d/%d|%d/%d]: r=%d\n",
-                   b->mv[0].y, b->mv[0].x, ref.y, ref.x,
-                   mvlist[0][0].y, mvlist[0][0].x, ts->msac.rng);
+            dav1d_log(f->c, "Post-dmv[%d/%d,ref=%d/%d|%d/%d]: r=%d\n",
+                      b->mv[0].y, b->mv[0].x, ref.y, ref.x,
+                      mvlist[0][0].y, mvlist[0][0].x, ts->msac.rng);
         read_vartx_tree(t, b, bs, bx4, by4);
 
         // reconstruction
-        if (f->frame_thread.pass == 1) {
+        if (t->pass == 1) {
             f->bd_fn.read_coef_blocks(t, bs, b);
         } else {
             f->bd_fn.recon_b_inter(t, bs, b);
@@ -1218,7 +1269,7 @@ static void decode_b(Dav1dTileContext *const t,
                                          have_top, have_left);
             is_comp = msac_decode_bool_adapt(&ts->msac, ts->cdf.m.comp[ctx]);
             if (DEBUG_BLOCK_INFO)
-                printf("Post-compflag[%d]: r=%d\n", is_comp, ts->msac.rng);
+                dav1d_log(f->c, "Post-compflag[%d]: r=%d\n", is_comp, ts->msac.rng);
         } else {
             is_comp = 0;
         }
@@ -1235,10 +1286,10 @@ static void decode_b(Dav1dTileContext *const t,
             int n_mvs, ctx;
             mv mvlist[2][2];
             av1_find_ref_mvs(mvstack, &n_mvs, mvlist, &ctx,
-                             (int[2]) { b->ref[0], b->ref[1] }, f->bw, f->bh,
-                             bs, bp, t->by, t->bx, ts->tiling.col_start,
+                             (int[2]) { b->ref[0], b->ref[1] }, bs, bp,
+                             t->by, t->bx, ts->tiling.col_start,
                              ts->tiling.col_end, ts->tiling.row_start,
-                             ts->tiling.row_end, f->libaom_cm);
+                             ts->tiling.row_end, &f->rf);
 
             b->mv[0] = mvstack[0].this_mv;
             b->mv[1] = mvstack[0].comp_mv;
@@ -1247,9 +1298,9 @@ static void decode_b(Dav1dTileContext *const t,
                 unset_hp_bit(&b->mv[1]);
             }
             if (DEBUG_BLOCK_INFO)
-                printf("Post-skipmodeblock[mv=1:y=%d,x=%d,2:y=%d,x=%d,refs=%d+%d\n",
-                       b->mv[0].y, b->mv[0].x, b->mv[1].y, b->mv[1].x,
-                       b->ref[0], b->ref[1]);
+                dav1d_log(f->c, "Post-skipmodeblock[mv=1:y=%d,x=%d,2:y=%d,x=%d,refs=%d+%d\n",
+                          b->mv[0].y, b->mv[0].x, b->mv[1].y, b->mv[1].x,
+                          b->ref[0], b->ref[1]);
         } else if (is_comp) {
             const int dir_ctx = get_comp_dir_ctx(t->a, &t->l, by4, bx4,
                                                  have_top, have_left);
@@ -1308,24 +1359,24 @@ static void decode_b(Dav1dTileContext *const t,
                 }
             }
             if (DEBUG_BLOCK_INFO)
-                printf("Post-refs[%d/%d]: r=%d\n",
-                       b->ref[0], b->ref[1], ts->msac.rng);
+                dav1d_log(f->c, "Post-refs[%d/%d]: r=%d\n",
+                          b->ref[0], b->ref[1], ts->msac.rng);
 
             candidate_mv mvstack[8];
             int n_mvs, ctx;
             mv mvlist[2][2];
             av1_find_ref_mvs(mvstack, &n_mvs, mvlist, &ctx,
-                             (int[2]) { b->ref[0], b->ref[1] }, f->bw, f->bh,
-                             bs, bp, t->by, t->bx, ts->tiling.col_start,
+                             (int[2]) { b->ref[0], b->ref[1] }, bs, bp,
+                             t->by, t->bx, ts->tiling.col_start,
                              ts->tiling.col_end, ts->tiling.row_start,
-                             ts->tiling.row_end, f->libaom_cm);
+                             ts->tiling.row_end, &f->rf);
 
-            b->inter_mode = msac_decode_symbol_adapt(&ts->msac,
+            b->inter_mode = msac_decode_symbol_adapt8(&ts->msac,
                                              ts->cdf.m.comp_inter_mode[ctx],
                                              N_COMP_INTER_PRED_MODES);
             if (DEBUG_BLOCK_INFO)
-                printf("Post-compintermode[%d,ctx=%d,n_mvs=%d]: r=%d\n",
-                       b->inter_mode, ctx, n_mvs, ts->msac.rng);
+                dav1d_log(f->c, "Post-compintermode[%d,ctx=%d,n_mvs=%d]: r=%d\n",
+                          b->inter_mode, ctx, n_mvs, ts->msac.rng);
 
             const uint8_t *const im = av1_comp_inter_pred_modes[b->inter_mode];
             b->drl_idx = 0;
@@ -1340,8 +1391,8 @@ static void decode_b(Dav1dTileContext *const t,
                                              ts->cdf.m.drl_bit[drl_ctx_v2]);
                     }
                     if (DEBUG_BLOCK_INFO)
-                        printf("Post-drlidx[%d,n_mvs=%d]: r=%d\n",
-                               b->drl_idx, n_mvs, ts->msac.rng);
+                        dav1d_log(f->c, "Post-drlidx[%d,n_mvs=%d]: r=%d\n",
+                                  b->drl_idx, n_mvs, ts->msac.rng);
                 }
             } else if (im[0] == NEARMV || im[1] == NEARMV) {
                 b->drl_idx = 1;
@@ -1355,8 +1406,8 @@ static void decode_b(Dav1dTileContext *const t,
                                              ts->cdf.m.drl_bit[drl_ctx_v3]);
                     }
                     if (DEBUG_BLOCK_INFO)
-                        printf("Post-drlidx[%d,n_mvs=%d]: r=%d\n",
-                               b->drl_idx, n_mvs, ts->msac.rng);
+                        dav1d_log(f->c, "Post-drlidx[%d,n_mvs=%d]: r=%d\n",
+                                  b->drl_idx, n_mvs, ts->msac.rng);
                 }
             }
 
@@ -1385,9 +1436,9 @@ static void decode_b(Dav1dTileContext *const t,
             assign_comp_mv(1, comp);
 #undef assign_comp_mv
             if (DEBUG_BLOCK_INFO)
-                printf("Post-residual_mv[1:y=%d,x=%d,2:y=%d,x=%d]: r=%d\n",
-                       b->mv[0].y, b->mv[0].x, b->mv[1].y, b->mv[1].x,
-                       ts->msac.rng);
+                dav1d_log(f->c, "Post-residual_mv[1:y=%d,x=%d,2:y=%d,x=%d]: r=%d\n",
+                          b->mv[0].y, b->mv[0].x, b->mv[1].y, b->mv[1].x,
+                          ts->msac.rng);
 
             // jnt_comp vs. seg vs. wedge
             int is_segwedge = 0;
@@ -1397,8 +1448,8 @@ static void decode_b(Dav1dTileContext *const t,
                 is_segwedge = msac_decode_bool_adapt(&ts->msac,
                                                  ts->cdf.m.mask_comp[mask_ctx]);
                 if (DEBUG_BLOCK_INFO)
-                    printf("Post-segwedge_vs_jntavg[%d,ctx=%d]: r=%d\n",
-                           is_segwedge, mask_ctx, ts->msac.rng);
+                    dav1d_log(f->c, "Post-segwedge_vs_jntavg[%d,ctx=%d]: r=%d\n",
+                              is_segwedge, mask_ctx, ts->msac.rng);
             }
 
             if (!is_segwedge) {
@@ -1412,11 +1463,11 @@ static void decode_b(Dav1dTileContext *const t,
                         msac_decode_bool_adapt(&ts->msac,
                                                ts->cdf.m.jnt_comp[jnt_ctx]);
                     if (DEBUG_BLOCK_INFO)
-                        printf("Post-jnt_comp[%d,ctx=%d[ac:%d,ar:%d,lc:%d,lr:%d]]: r=%d\n",
-                               b->comp_type == COMP_INTER_AVG,
-                               jnt_ctx, t->a->comp_type[bx4], t->a->ref[0][bx4],
-                               t->l.comp_type[by4], t->l.ref[0][by4],
-                               ts->msac.rng);
+                        dav1d_log(f->c, "Post-jnt_comp[%d,ctx=%d[ac:%d,ar:%d,lc:%d,lr:%d]]: r=%d\n",
+                                  b->comp_type == COMP_INTER_AVG,
+                                  jnt_ctx, t->a->comp_type[bx4], t->a->ref[0][bx4],
+                                  t->l.comp_type[by4], t->l.ref[0][by4],
+                                  ts->msac.rng);
                 } else {
                     b->comp_type = COMP_INTER_AVG;
                 }
@@ -1427,16 +1478,16 @@ static void decode_b(Dav1dTileContext *const t,
                         msac_decode_bool_adapt(&ts->msac,
                                                ts->cdf.m.wedge_comp[ctx]);
                     if (b->comp_type == COMP_INTER_WEDGE)
-                        b->wedge_idx = msac_decode_symbol_adapt(&ts->msac,
+                        b->wedge_idx = msac_decode_symbol_adapt16(&ts->msac,
                                                 ts->cdf.m.wedge_idx[ctx], 16);
                 } else {
                     b->comp_type = COMP_INTER_SEG;
                 }
                 b->mask_sign = msac_decode_bool(&ts->msac, 128 << 7);
                 if (DEBUG_BLOCK_INFO)
-                    printf("Post-seg/wedge[%d,wedge_idx=%d,sign=%d]: r=%d\n",
-                           b->comp_type == COMP_INTER_WEDGE,
-                           b->wedge_idx, b->mask_sign, ts->msac.rng);
+                    dav1d_log(f->c, "Post-seg/wedge[%d,wedge_idx=%d,sign=%d]: r=%d\n",
+                              b->comp_type == COMP_INTER_WEDGE,
+                              b->wedge_idx, b->mask_sign, ts->msac.rng);
             }
         } else {
             b->comp_type = COMP_INTER_NONE;
@@ -1472,16 +1523,16 @@ static void decode_b(Dav1dTileContext *const t,
             }
             b->ref[1] = -1;
             if (DEBUG_BLOCK_INFO)
-                printf("Post-ref[%d]: r=%d\n", b->ref[0], ts->msac.rng);
+                dav1d_log(f->c, "Post-ref[%d]: r=%d\n", b->ref[0], ts->msac.rng);
 
             candidate_mv mvstack[8];
             int n_mvs, ctx;
             mv mvlist[2][2];
             av1_find_ref_mvs(mvstack, &n_mvs, mvlist, &ctx,
-                             (int[2]) { b->ref[0], -1 }, f->bw, f->bh, bs, bp,
+                             (int[2]) { b->ref[0], -1 }, bs, bp,
                              t->by, t->bx, ts->tiling.col_start,
                              ts->tiling.col_end, ts->tiling.row_start,
-                             ts->tiling.row_end, f->libaom_cm);
+                             ts->tiling.row_end, &f->rf);
 
             // mode parsing and mv derivation from ref_mvs
             if (msac_decode_bool_adapt(&ts->msac, ts->cdf.m.newmv_mode[ctx & 7])) {
@@ -1524,9 +1575,9 @@ static void decode_b(Dav1dTileContext *const t,
                 }
 
                 if (DEBUG_BLOCK_INFO)
-                    printf("Post-intermode[%d,drl=%d,mv=y:%d,x:%d,n_mvs=%d]: r=%d\n",
-                           b->inter_mode, b->drl_idx, b->mv[0].y, b->mv[0].x, n_mvs,
-                           ts->msac.rng);
+                    dav1d_log(f->c, "Post-intermode[%d,drl=%d,mv=y:%d,x:%d,n_mvs=%d]: r=%d\n",
+                              b->inter_mode, b->drl_idx, b->mv[0].y, b->mv[0].x, n_mvs,
+                              ts->msac.rng);
             } else {
                 has_subpel_filter = 1;
                 b->inter_mode = NEWMV;
@@ -1548,13 +1599,13 @@ static void decode_b(Dav1dTileContext *const t,
                     if (!f->frame_hdr.hp) unset_hp_bit(&b->mv[0]);
                 }
                 if (DEBUG_BLOCK_INFO)
-                    printf("Post-intermode[%d,drl=%d]: r=%d\n",
-                           b->inter_mode, b->drl_idx, ts->msac.rng);
+                    dav1d_log(f->c, "Post-intermode[%d,drl=%d]: r=%d\n",
+                              b->inter_mode, b->drl_idx, ts->msac.rng);
                 read_mv_residual(t, &b->mv[0], &ts->cdf.mv,
                                  !f->frame_hdr.force_integer_mv);
                 if (DEBUG_BLOCK_INFO)
-                    printf("Post-residualmv[mv=y:%d,x:%d]: r=%d\n",
-                           b->mv[0].y, b->mv[0].x, ts->msac.rng);
+                    dav1d_log(f->c, "Post-residualmv[mv=y:%d,x:%d]: r=%d\n",
+                              b->mv[0].y, b->mv[0].x, ts->msac.rng);
             }
 
             // interintra flags
@@ -1563,7 +1614,7 @@ static void decode_b(Dav1dTileContext *const t,
                 interintra_allowed_mask & (1 << bs) &&
                 msac_decode_bool_adapt(&ts->msac, ts->cdf.m.interintra[ii_sz_grp]))
             {
-                b->interintra_mode = msac_decode_symbol_adapt(&ts->msac,
+                b->interintra_mode = msac_decode_symbol_adapt4(&ts->msac,
                                           ts->cdf.m.interintra_mode[ii_sz_grp],
                                           N_INTER_INTRA_PRED_MODES);
                 const int wedge_ctx = av1_wedge_ctx_lut[bs];
@@ -1571,7 +1622,7 @@ static void decode_b(Dav1dTileContext *const t,
                     msac_decode_bool_adapt(&ts->msac,
                                            ts->cdf.m.interintra_wedge[wedge_ctx]);
                 if (b->interintra_type == INTER_INTRA_WEDGE)
-                    b->wedge_idx = msac_decode_symbol_adapt(&ts->msac,
+                    b->wedge_idx = msac_decode_symbol_adapt16(&ts->msac,
                                             ts->cdf.m.wedge_idx[wedge_ctx], 16);
             } else {
                 b->interintra_type = INTER_INTRA_NONE;
@@ -1579,9 +1630,9 @@ static void decode_b(Dav1dTileContext *const t,
             if (DEBUG_BLOCK_INFO && f->seq_hdr.inter_intra &&
                 interintra_allowed_mask & (1 << bs))
             {
-                printf("Post-interintra[t=%d,m=%d,w=%d]: r=%d\n",
-                       b->interintra_type, b->interintra_mode,
-                       b->wedge_idx, ts->msac.rng);
+                dav1d_log(f->c, "Post-interintra[t=%d,m=%d,w=%d]: r=%d\n",
+                          b->interintra_type, b->interintra_mode,
+                          b->wedge_idx, ts->msac.rng);
             }
 
             // motion variation
@@ -1603,32 +1654,32 @@ static void decode_b(Dav1dTileContext *const t,
                     f->frame_hdr.warp_motion && (mask[0] | mask[1]);
 
                 b->motion_mode = allow_warp ?
-                    msac_decode_symbol_adapt(&ts->msac, ts->cdf.m.motion_mode[bs], 3) :
+                    msac_decode_symbol_adapt4(&ts->msac, ts->cdf.m.motion_mode[bs], 3) :
                     msac_decode_bool_adapt(&ts->msac, ts->cdf.m.obmc[bs]);
                 if (b->motion_mode == MM_WARP) {
                     has_subpel_filter = 0;
                     derive_warpmv(t, bw4, bh4, mask, b->mv[0], &t->warpmv);
 #define signabs(v) v < 0 ? '-' : ' ', abs(v)
                     if (DEBUG_BLOCK_INFO)
-                        printf("[ %c%x %c%x %c%x\n  %c%x %c%x %c%x ]\n"
-                               "alpha=%c%x, beta=%c%x, gamma=%c%x, delta=%c%x\n",
-                               signabs(t->warpmv.matrix[0]),
-                               signabs(t->warpmv.matrix[1]),
-                               signabs(t->warpmv.matrix[2]),
-                               signabs(t->warpmv.matrix[3]),
-                               signabs(t->warpmv.matrix[4]),
-                               signabs(t->warpmv.matrix[5]),
-                               signabs(t->warpmv.alpha),
-                               signabs(t->warpmv.beta),
-                               signabs(t->warpmv.gamma),
-                               signabs(t->warpmv.delta));
+                        dav1d_log(f->c, "[ %c%x %c%x %c%x\n  %c%x %c%x %c%x ]\n"
+                                  "alpha=%c%x, beta=%c%x, gamma=%c%x, delta=%c%x\n",
+                                  signabs(t->warpmv.matrix[0]),
+                                  signabs(t->warpmv.matrix[1]),
+                                  signabs(t->warpmv.matrix[2]),
+                                  signabs(t->warpmv.matrix[3]),
+                                  signabs(t->warpmv.matrix[4]),
+                                  signabs(t->warpmv.matrix[5]),
+                                  signabs(t->warpmv.alpha),
+                                  signabs(t->warpmv.beta),
+                                  signabs(t->warpmv.gamma),
+                                  signabs(t->warpmv.delta));
 #undef signabs
                 }
 
                 if (DEBUG_BLOCK_INFO)
-                    printf("Post-motionmode[%d]: r=%d [mask: 0x%" PRIu64 "x/0x%"
-                           PRIu64 "x]\n", b->motion_mode, ts->msac.rng, mask[0],
-                            mask[1]);
+                    dav1d_log(f->c, "Post-motionmode[%d]: r=%d [mask: 0x%" PRIu64 "x/0x%"
+                              PRIu64 "x]\n", b->motion_mode, ts->msac.rng, mask[0],
+                               mask[1]);
             } else {
                 b->motion_mode = MM_TRANSLATION;
             }
@@ -1641,24 +1692,24 @@ static void decode_b(Dav1dTileContext *const t,
                 const int comp = b->comp_type != COMP_INTER_NONE;
                 const int ctx1 = get_filter_ctx(t->a, &t->l, comp, 0, b->ref[0],
                                                 by4, bx4);
-                filter[0] = msac_decode_symbol_adapt(&ts->msac,
+                filter[0] = msac_decode_symbol_adapt4(&ts->msac,
                     ts->cdf.m.filter[0][ctx1], N_SWITCHABLE_FILTERS);
                 if (f->seq_hdr.dual_filter) {
                     const int ctx2 = get_filter_ctx(t->a, &t->l, comp, 1,
                                                     b->ref[0], by4, bx4);
                     if (DEBUG_BLOCK_INFO)
-                        printf("Post-subpel_filter1[%d,ctx=%d]: r=%d\n",
-                               filter[0], ctx1, ts->msac.rng);
-                    filter[1] = msac_decode_symbol_adapt(&ts->msac,
+                        dav1d_log(f->c, "Post-subpel_filter1[%d,ctx=%d]: r=%d\n",
+                                  filter[0], ctx1, ts->msac.rng);
+                    filter[1] = msac_decode_symbol_adapt4(&ts->msac,
                         ts->cdf.m.filter[1][ctx2], N_SWITCHABLE_FILTERS);
                     if (DEBUG_BLOCK_INFO)
-                        printf("Post-subpel_filter2[%d,ctx=%d]: r=%d\n",
-                               filter[1], ctx2, ts->msac.rng);
+                        dav1d_log(f->c, "Post-subpel_filter2[%d,ctx=%d]: r=%d\n",
+                                  filter[1], ctx2, ts->msac.rng);
                 } else {
                     filter[1] = filter[0];
                     if (DEBUG_BLOCK_INFO)
-                        printf("Post-subpel_filter[%d,ctx=%d]: r=%d\n",
-                               filter[0], ctx1, ts->msac.rng);
+                        dav1d_log(f->c, "Post-subpel_filter[%d,ctx=%d]: r=%d\n",
+                                  filter[0], ctx1, ts->msac.rng);
                 }
             } else {
                 filter[0] = filter[1] = FILTER_8TAP_REGULAR;
@@ -1671,7 +1722,7 @@ static void decode_b(Dav1dTileContext *const t,
         read_vartx_tree(t, b, bs, bx4, by4);
 
         // reconstruction
-        if (f->frame_thread.pass == 1) {
+        if (t->pass == 1) {
             f->bd_fn.read_coef_blocks(t, bs, b);
         } else {
             f->bd_fn.recon_b_inter(t, bs, b);
@@ -1748,6 +1799,8 @@ static void decode_b(Dav1dTileContext *const t,
         for (int y = 0; y < bh4; y++)
             *noskip_mask++ |= mask;
     }
+    if (f->cur.p.block_info)
+        export_block_info(t, b, bw4, bh4, w4, h4);
 }
 
 static int decode_sb(Dav1dTileContext *const t, const enum BlockLevel bl,
@@ -1766,10 +1819,10 @@ static int decode_sb(Dav1dTileContext *const t, const enum BlockLevel bl,
     uint16_t *pc;
     enum BlockPartition bp;
     int ctx, bx8, by8;
-    if (f->frame_thread.pass != 2) {
+    if (t->pass != 2) {
         if (0 && bl == BL_64X64)
-            printf("poc=%d,y=%d,x=%d,bl=%d,r=%d\n",
-                   f->frame_hdr.frame_offset, t->by, t->bx, bl, t->ts->msac.rng);
+            dav1d_log(f->c, "poc=%d,y=%d,x=%d,bl=%d,r=%d\n",
+                      f->frame_hdr.frame_offset, t->by, t->bx, bl, t->ts->msac.rng);
         bx8 = (t->bx & 31) >> 1;
         by8 = (t->by & 31) >> 1;
         ctx = get_partition_ctx(t->a, &t->l, bl, by8, bx8);
@@ -1777,13 +1830,14 @@ static int decode_sb(Dav1dTileContext *const t, const enum BlockLevel bl,
     }
 
     if (have_h_split && have_v_split) {
-        if (f->frame_thread.pass == 2) {
-            const Av1Block *const b = &f->frame_thread.b[t->by * f->b4_stride + t->bx];
+        if (t->pass == 2) {
+            // the first block of this partition is the next one coded
+            const Av1Block *const b = t->frame_thread.b;
             bp = b->bl == bl ? b->bp : PARTITION_SPLIT;
         } else {
             const unsigned n_part = bl == BL_8X8 ? N_SUB8X8_PARTITIONS :
                 bl == BL_128X128 ? N_PARTITIONS - 2 : N_PARTITIONS;
-            bp = msac_decode_symbol_adapt(&t->ts->msac, pc, n_part);
+            bp = msac_decode_symbol_adapt16(&t->ts->msac, pc, n_part);
             if (f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I422 &&
                 (bp == PARTITION_V || bp == PARTITION_V4 ||
                  bp == PARTITION_T_LEFT_SPLIT || bp == PARTITION_T_RIGHT_SPLIT))
@@ -1791,9 +1845,9 @@ static int decode_sb(Dav1dTileContext *const t, const enum BlockLevel bl,
                 return 1;
             }
             if (DEBUG_BLOCK_INFO)
-                printf("poc=%d,y=%d,x=%d,bl=%d,ctx=%d,bp=%d: r=%d\n",
-                       f->frame_hdr.frame_offset, t->by, t->bx, bl, ctx, bp,
-                       t->ts->msac.rng);
+                dav1d_log(f->c, "poc=%d,y=%d,x=%d,bl=%d,ctx=%d,bp=%d: r=%d\n",
+                          f->frame_hdr.frame_offset, t->by, t->bx, bl, ctx, bp,
+                          t->ts->msac.rng);
         }
         const uint8_t *const b = av1_block_sizes[bl][bp];
 
@@ -1917,16 +1971,17 @@ static int decode_sb(Dav1dTileContext *const t, const enum BlockLevel bl,
         }
     } else if (have_h_split) {
         unsigned is_split;
-        if (f->frame_thread.pass == 2) {
-            const Av1Block *const b = &f->frame_thread.b[t->by * f->b4_stride + t->bx];
+        if (t->pass == 2) {
+            // the first block of this partition is the next one coded
+            const Av1Block *const b = t->frame_thread.b;
             is_split = b->bl != bl;
         } else {
             const unsigned p = gather_top_partition_prob(pc, bl);
             is_split = msac_decode_bool(&t->ts->msac, p);
             if (DEBUG_BLOCK_INFO)
-                printf("poc=%d,y=%d,x=%d,bl=%d,ctx=%d,bp=%d: r=%d\n",
-                       f->frame_hdr.frame_offset, t->by, t->bx, bl, ctx,
-                       is_split ? PARTITION_SPLIT : PARTITION_H, t->ts->msac.rng);
+                dav1d_log(f->c, "poc=%d,y=%d,x=%d,bl=%d,ctx=%d,bp=%d: r=%d\n",
+                          f->frame_hdr.frame_offset, t->by, t->bx, bl, ctx,
+                          is_split ? PARTITION_SPLIT : PARTITION_H, t->ts->msac.rng);
         }
 
         assert(bl < BL_8X8);
@@ -1945,8 +2000,9 @@ static int decode_sb(Dav1dTileContext *const t, const enum BlockLevel bl,
     } else {
         assert(have_v_split);
         unsigned is_split;
-        if (f->frame_thread.pass == 2) {
-            const Av1Block *const b = &f->frame_thread.b[t->by * f->b4_stride + t->bx];
+        if (t->pass == 2) {
+            // the first block of this partition is the next one coded
+            const Av1Block *const b = t->frame_thread.b;
             is_split = b->bl != bl;
         } else {
             const unsigned p = gather_left_partition_prob(pc, bl);
@@ -1954,9 +2010,9 @@ static int decode_sb(Dav1dTileContext *const t, const enum BlockLevel bl,
             if (f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I422 && !is_split)
                 return 1;
             if (DEBUG_BLOCK_INFO)
-                printf("poc=%d,y=%d,x=%d,bl=%d,ctx=%d,bp=%d: r=%d\n",
-                       f->frame_hdr.frame_offset, t->by, t->bx, bl, ctx,
-                       is_split ? PARTITION_SPLIT : PARTITION_V, t->ts->msac.rng);
+                dav1d_log(f->c, "poc=%d,y=%d,x=%d,bl=%d,ctx=%d,bp=%d: r=%d\n",
+                          f->frame_hdr.frame_offset, t->by, t->bx, bl, ctx,
+                          is_split ? PARTITION_SPLIT : PARTITION_V, t->ts->msac.rng);
         }
 
         assert(bl < BL_8X8);
@@ -1974,7 +2030,7 @@ static int decode_sb(Dav1dTileContext *const t, const enum BlockLevel bl,
         }
     }
 
-    if (f->frame_thread.pass != 2 && (bp != PARTITION_SPLIT || bl == BL_8X8)) {
+    if (t->pass != 2 && (bp != PARTITION_SPLIT || bl == BL_8X8)) {
         memset(&t->a->partition[bx8], av1_al_part_ctx[0][bl][bp], hsz);
         memset(&t->l.partition[by8], av1_al_part_ctx[1][bl][bp], hsz);
     }
@@ -2022,8 +2078,13 @@ static void setup_tile(Dav1dTileState *const ts,
     const int row_sb_end = f->frame_hdr.tiling.row_start_sb[tile_row + 1];
     const int sb_shift = f->sb_shift;
 
+    memset(&ts->stats, 0, sizeof(ts->stats));
+
+    // at most one block per 4x4 pixels
+    ts->frame_thread.b = &f->frame_thread.b[tile_start_off / 16];
     ts->frame_thread.pal_idx = &f->frame_thread.pal_idx[tile_start_off * 2];
-    ts->frame_thread.cf = &((int32_t *) f->frame_thread.cf)[tile_start_off * 3];
+    ts->frame_thread.cf = (uint8_t *) f->frame_thread.cf +
+        (((size_t) tile_start_off * 3) << (1 + (f->seq_hdr.bpc > 8)));
     ts->cdf = *f->in_cdf.cdf;
     ts->last_qidx = f->frame_hdr.quant.yac;
     memset(ts->last_delta_lf, 0, sizeof(ts->last_delta_lf));
@@ -2054,11 +2115,100 @@ static void setup_tile(Dav1dTileState *const ts,
         ts->lr_ref[p]->sgr_weights[1] = 31;
     }
 
-    if (f->n_tc > 1)
+    if (f->n_tc > 1) {
         atomic_init(&ts->progress, row_sb_start);
+        ts->tile_thread.next_sby = row_sb_start;
+    }
 }
 
-int decode_tile_sbrow(Dav1dTileContext *const t) {
+int dav1d_tile_context_alloc(Dav1dTileContext *const t,
+                             const Dav1dFrameContext *const f)
+{
+    const int sb128 = f->seq_hdr.sb128, hbd = f->seq_hdr.bpc > 8;
+    const int layout = 1 + sb128 + 2 * hbd;
+    if (t->buf_layout == layout) return 0;
+
+    const int sb_sz = 64 << sb128;
+    const size_t pixel_sz = 1 << hbd, coef_sz = 2 << hbd;
+    const size_t cf_sz = 32 * 32 * coef_sz;
+    // the two compound prediction intermediates are the largest user of
+    // scratch; palette indices, CfL AC, inter-intra and OBMC need less
+    const size_t scratch_sz = 2 * sb_sz * sb_sz * coef_sz;
+    const size_t emu_edge_sz = 160 * (sb_sz + 7) * pixel_sz;
+    const size_t sz = cf_sz + scratch_sz + emu_edge_sz;
+
+    // the tile context may be shared with other decoder instances (or see
+    // another sequence later), so it never shrinks
+    uint8_t *buf = (uint8_t *) t->cf;
+    if (sz > (size_t) atomic_load(&t->buf_sz)) {
+        dav1d_free_aligned(buf);
+        buf = dav1d_alloc_aligned(sz, 32);
+        t->cf = (coef *) buf;
+        t->buf_layout = 0;
+        atomic_store(&t->buf_sz, buf ? (int) sz : 0);
+        if (!buf) return -ENOMEM;
+    }
+    memset(buf, 0, cf_sz);
+    t->scratch.mem = &buf[cf_sz];
+    t->emu_edge = (pixel *) &buf[cf_sz + scratch_sz];
+    t->buf_layout = layout;
+
+    return 0;
+}
+
+// Sets the pixels of one sbrow of a tile outside of the decoding region to
+// grey, and its block data to values that neither affect the post-filters
+// nor later frames: no loopfilter, segment 0, and intra blocks for the
+// projection of motion vectors.
+static void skip_tile_sbrow(Dav1dTileContext *const t) {
+    const Dav1dFrameContext *const f = t->f;
+    const Dav1dTileState *const ts = t->ts;
+    const int bx = ts->tiling.col_start, bw4 = ts->tiling.col_end - bx;
+    const int by = t->by, bh4 = imin(by + f->sb_step, ts->tiling.row_end) - by;
+
+    if (t->pass != 2) {
+        const refmvs intra = {
+            .ref = { 0, -1 }, .mv = { [0] = { .y = -0x8000, .x = -0x8000 } },
+            .bs = BS_4x4,
+        };
+
+        for (int y = by; y < by + bh4; y++) {
+            memset(&f->lf.level[y * f->b4_stride + bx], 0,
+                   bw4 * sizeof(*f->lf.level));
+            if (f->cur_segmap && f->frame_hdr.segmentation.update_map)
+                memset(&f->cur_segmap[y * f->b4_stride + bx], 0, bw4);
+            if (f->mvs_ref)
+                for (int x = bx; x < bx + bw4; x++)
+                    f->mvs[y * f->b4_stride + x] = intra;
+        }
+    }
+
+    if (t->pass != 1) {
+        const int bpc = f->cur.p.p.bpc;
+        const int ss_ver = f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420;
+        const int ss_hor = f->cur.p.p.layout != DAV1D_PIXEL_LAYOUT_I444;
+        const int n_pl = f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I400 ? 1 : 3;
+
+        for (int pl = 0; pl < n_pl; pl++) {
+            const int sx = pl && ss_hor, sy = pl && ss_ver;
+            const ptrdiff_t stride = f->cur.p.stride[!!pl];
+            const int w = (bw4 * 4) >> sx, h = (bh4 * 4) >> sy;
+            uint8_t *ptr = (uint8_t *) f->cur.p.data[pl] +
+                           ((by * 4) >> sy) * stride + (((bx * 4) >> sx) << (bpc > 8));
+
+            for (int y = 0; y < h; y++, ptr += stride) {
+                if (bpc == 8) {
+                    memset(ptr, 128, w);
+                } else {
+                    for (int x = 0; x < w; x++)
+                        ((uint16_t *) ptr)[x] = 1 << (bpc - 1);
+                }
+            }
+        }
+    }
+}
+
+static int tile_sbrow(Dav1dTileContext *const t) {
     const Dav1dFrameContext *const f = t->f;
     const enum BlockLevel root_bl = f->seq_hdr.sb128 ? BL_128X128 : BL_64X64;
     Dav1dTileState *const ts = t->ts;
@@ -2067,36 +2217,57 @@ int decode_tile_sbrow(Dav1dTileContext *const t) {
     const int tile_row = ts->tiling.row, tile_col = ts->tiling.col;
     const int col_sb_start = f->frame_hdr.tiling.col_start_sb[tile_col];
     const int col_sb128_start = col_sb_start >> !f->seq_hdr.sb128;
+    // with parse-ahead, pass 2 runs alongside pass 1, on a set of above
+    // contexts of its own (the loopfilter reads those of pass 1)
+    BlockContext *const a = f->a + col_sb128_start + tile_row * f->sb128w +
+        (t->pass == 2 && c->parse_ahead) * f->sb128w * f->frame_hdr.tiling.rows;
 
-    reset_context(&t->l, !(f->frame_hdr.frame_type & 1), f->frame_thread.pass);
-    if (f->frame_thread.pass == 2) {
-        for (t->bx = ts->tiling.col_start,
-             t->a = f->a + col_sb128_start + tile_row * f->sb128w;
+    if (ts->skip) {
+        skip_tile_sbrow(t);
+        return 0;
+    }
+
+    reset_context(&t->l, !(f->frame_hdr.frame_type & 1), t->pass);
+    // where the data of this sbrow starts in the 2-pass streams
+    FrameThreadPos *const sbrow_pos = t->pass ?
+        &f->frame_thread.sbrow_pos[(t->by >> f->sb_shift) *
+                                   f->frame_hdr.tiling.cols + tile_col] : NULL;
+    if (t->pass == 2) {
+        t->frame_thread = *sbrow_pos;
+        for (t->bx = ts->tiling.col_start, t->a = a;
              t->bx < ts->tiling.col_end; t->bx += sb_step)
         {
+            const int sbx = (t->bx - ts->tiling.col_start) >> f->sb_shift;
+            if (f->tile_thread.wavefront)
+                dav1d_tile_task_wait_sb(t, sbx);
             if (decode_sb(t, root_bl, c->intra_edge.root[root_bl]))
                 return 1;
+            f->bd_fn.backup_ipred_edge(t);
+            if (f->tile_thread.wavefront)
+                dav1d_tile_task_signal_sb(t, sbx + 1);
             if (t->bx & 16 || f->seq_hdr.sb128)
                 t->a++;
         }
-        f->bd_fn.backup_ipred_edge(t);
         return 0;
     }
+    if (t->pass == 1)
+        t->frame_thread = *sbrow_pos = ts->frame_thread;
 
     const int ss_ver = f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420;
     const int ss_hor = f->cur.p.p.layout != DAV1D_PIXEL_LAYOUT_I444;
 
-    if (c->n_fc > 1 && f->frame_hdr.use_ref_frame_mvs) {
-        for (int n = 0; n < 7; n++)
-            dav1d_thread_picture_wait(&f->refp[n], 4 * (t->by + sb_step),
-                                      PLANE_TYPE_BLOCK);
-        av1_init_ref_mv_tile_row(f->libaom_cm,
+    if (f->frame_hdr.use_ref_frame_mvs) {
+        if (c->n_fc > 1)
+            for (int n = 0; n < 7; n++)
+                dav1d_wait_ref(t, &f->refp[n], 4 * (t->by + sb_step),
+                               PLANE_TYPE_BLOCK);
+        av1_init_refmvs_tile_row(&f->rf,
                                  ts->tiling.col_start, ts->tiling.col_end,
                                  t->by, imin(t->by + sb_step, f->bh));
     }
     memset(t->pal_sz_uv[1], 0, sizeof(*t->pal_sz_uv));
     const int sb128y = t->by >> 5;
-    for (t->bx = ts->tiling.col_start, t->a = f->a + col_sb128_start + tile_row * f->sb128w,
+    for (t->bx = ts->tiling.col_start, t->a = a,
          t->lf_mask = f->lf.mask + sb128y * f->sb128w + col_sb128_start;
          t->bx < ts->tiling.col_end; t->bx += sb_step)
     {
@@ -2140,8 +2311,8 @@ int decode_tile_sbrow(Dav1dTileContext *const t) {
 
             if (frame_type == RESTORATION_SWITCHABLE) {
                 const int filter =
-                    msac_decode_symbol_adapt(&ts->msac,
-                                             ts->cdf.m.restore_switchable, 3);
+                    msac_decode_symbol_adapt4(&ts->msac,
+                                              ts->cdf.m.restore_switchable, 3);
                 lr->type = filter ? filter == 2 ? RESTORATION_SGRPROJ :
                                                   RESTORATION_WIENER :
                                     RESTORATION_NONE;
@@ -2185,10 +2356,10 @@ int decode_tile_sbrow(Dav1dTileContext *const t) {
                 memcpy(lr->sgr_weights, ts->lr_ref[p]->sgr_weights, sizeof(lr->sgr_weights));
                 ts->lr_ref[p] = lr;
                 if (DEBUG_BLOCK_INFO)
-                    printf("Post-lr_wiener[pl=%d,v[%d,%d,%d],h[%d,%d,%d]]: r=%d\n",
-                           p, lr->filter_v[0], lr->filter_v[1],
-                           lr->filter_v[2], lr->filter_h[0],
-                           lr->filter_h[1], lr->filter_h[2], ts->msac.rng);
+                    dav1d_log(f->c, "Post-lr_wiener[pl=%d,v[%d,%d,%d],h[%d,%d,%d]]: r=%d\n",
+                              p, lr->filter_v[0], lr->filter_v[1],
+                              lr->filter_v[2], lr->filter_h[0],
+                              lr->filter_h[1], lr->filter_h[2], ts->msac.rng);
             } else if (lr->type == RESTORATION_SGRPROJ) {
                 const unsigned idx = msac_decode_bools(&ts->msac, 4);
                 lr->sgr_idx = idx;
@@ -2206,22 +2377,23 @@ int decode_tile_sbrow(Dav1dTileContext *const t) {
                 memcpy(lr->filter_h, ts->lr_ref[p]->filter_h, sizeof(lr->filter_h));
                 ts->lr_ref[p] = lr;
                 if (DEBUG_BLOCK_INFO)
-                    printf("Post-lr_sgrproj[pl=%d,idx=%d,w[%d,%d]]: r=%d\n",
-                           p, lr->sgr_idx, lr->sgr_weights[0],
-                           lr->sgr_weights[1], ts->msac.rng);
+                    dav1d_log(f->c, "Post-lr_sgrproj[pl=%d,idx=%d,w[%d,%d]]: r=%d\n",
+                              p, lr->sgr_idx, lr->sgr_weights[0],
+                              lr->sgr_weights[1], ts->msac.rng);
             }
         }
         if (decode_sb(t, root_bl, c->intra_edge.root[root_bl]))
             return 1;
+        // backup pre-loopfilter pixels for intra prediction of the next sbrow
+        if (t->pass != 1)
+            f->bd_fn.backup_ipred_edge(t);
         if (t->bx & 16 || f->seq_hdr.sb128) {
             t->a++;
             t->lf_mask++;
         }
     }
-
-    // backup pre-loopfilter pixels for intra prediction of the next sbrow
-    if (f->frame_thread.pass != 1)
-        f->bd_fn.backup_ipred_edge(t);
+    if (t->pass == 1)
+        ts->frame_thread = t->frame_thread;
 
     // backup t->a/l.tx_lpf_y/uv at tile boundaries to use them to "fix"
     // up the initial value in neighbour tiles when running the loopfilter
@@ -2235,61 +2407,604 @@ int decode_tile_sbrow(Dav1dTileContext *const t) {
     return 0;
 }
 
-int decode_frame(Dav1dFrameContext *const f) {
+int decode_tile_sbrow(Dav1dTileContext *const t) {
+    PROF_START(prof_start);
+    const int res = tile_sbrow(t);
+    PROF_END(prof_start, DAV1D_PROF_TILE_SBROW);
+    return res;
+}
+
+// Account for the buffers allocated by decode_frame() in f->mem.
+static void update_memory_usage(Dav1dFrameContext *const f) {
+    size_t sz[DAV1D_MEM_NUM_CATEGORIES] = { 0 };
+
+    sz[DAV1D_MEM_FRAME] = f->n_ts * sizeof(*f->ts) + f->arena.frame_sz;
+    sz[DAV1D_MEM_FRAME_THREADING] = f->arena.frame_thread_sz;
+
+    MemoryUsage *const mem = f->mem;
+    pthread_mutex_lock(&mem->lock);
+    for (int i = 0; i < DAV1D_MEM_NUM_CATEGORIES; i++) {
+        mem->cur[i] += sz[i] - f->mem_sz[i];
+        if (mem->cur[i] > mem->peak[i]) mem->peak[i] = mem->cur[i];
+        f->mem_sz[i] = sz[i];
+    }
+    pthread_mutex_unlock(&mem->lock);
+}
+
+static size_t arena_take(size_t *const sz, const size_t n) {
+    const size_t off = *sz;
+    *sz += (n + 63) & ~(size_t) 63;
+    return off;
+}
+
+// Size of frame_thread.cf; coefficients are 16 bits for 8 bpc, and 32 bits
+// otherwise.
+static size_t frame_thread_cf_size(const int sb128w, const int sb128h,
+                                   const int hbd)
+{
+    return ((size_t) 3 * sb128w * sb128h * 128 * 128) << (1 + hbd);
+}
+
+// (Re)allocate the frame-size dependent buffers in f->arena. They are sized
+// for the largest frames (and tilings) of the sequence, so that resolution
+// changes within it are served from the same memory; in low-memory mode,
+// only for the current frame (and grown as needed).
+static int alloc_frame_arena(Dav1dFrameContext *const f) {
     const Dav1dContext *const c = f->c;
+    const int max_w = c->low_memory ? f->frame_hdr.width :
+                      imax(f->seq_hdr.max_width, f->frame_hdr.width);
+    const int max_h = c->low_memory ? f->frame_hdr.height :
+                      imax(f->seq_hdr.max_height, f->frame_hdr.height);
+    const int sb128w = (max_w + 127) >> 7, sb128h = (max_h + 127) >> 7;
+    const int sb64w = (max_w + 63) >> 6, sb64h = (max_h + 63) >> 6;
+    // tiles are at least one superblock in size
+    const int tile_cols = c->low_memory ? f->frame_hdr.tiling.cols :
+                          imax(imin(sb64w, 64), f->frame_hdr.tiling.cols);
+    const int tile_rows = c->low_memory ? f->frame_hdr.tiling.rows :
+                          imax(imin(sb64h, 64), f->frame_hdr.tiling.rows);
+    const int hbd = f->seq_hdr.bpc > 8;
+    // the intra edges backed up for the sbrow below only need to be kept
+    // until that one is decoded, so unless the tile rows are about as many
+    // as the sbrows, they go to a ring of two rows per tile row (one being
+    // written and one read, see ipred_edge_row())
+    f->ipred_edge_ring = 2 * f->frame_hdr.tiling.rows < f->sbh;
+    const int ipred_edge_rows = f->ipred_edge_ring ?
+                                2 * f->frame_hdr.tiling.rows : sb128h * 2;
+
+    if (f->arena.mem && sb128w <= f->arena.sb128w && sb128h <= f->arena.sb128h &&
+        tile_cols <= f->arena.tile_cols && tile_rows <= f->arena.tile_rows &&
+        hbd <= f->arena.hbd && ipred_edge_rows <= f->arena.ipred_edge_rows)
+    {
+        return 0;
+    }
+    dav1d_freep_aligned(&f->arena.mem);
+    f->arena.frame_sz = f->arena.frame_thread_sz = 0;
+
+    const ptrdiff_t b4_stride = sb128w * 32;
+    // per plane; superblock rows (f->sbh) are at most 64 pixels high, so
+    // there are at most sb128h * 2 of them
+    const size_t ipred_edge_sz = (size_t) sb128w * 128 * ipred_edge_rows;
+    size_t sz = 0;
+    // with parse-ahead, a second set for pass 2 (see tile_sbrow())
+    const size_t a_off = arena_take(&sz, sizeof(*f->a) * sb128w * tile_rows *
+                                         (1 + c->parse_ahead));
+    const size_t mask_off =
+        arena_take(&sz, sizeof(*f->lf.mask) * sb128w * sb128h);
+    const size_t level_off =
+        arena_take(&sz, sizeof(*f->lf.level) * sb128w * sb128h * 32 * 32);
+    // pixel arrays, of pixels of 1 << hbd bytes (a higher bitdepth
+    // reallocates them, see above)
+    const size_t line_sz = (b4_stride * 4) << hbd; // a row of the frame
+    const size_t ipred_edge_off = arena_take(&sz, (ipred_edge_sz * 3) << hbd);
+    const size_t cdef_line_off = arena_take(&sz, line_sz * 12);
+    // two sets, for even and odd sbrows, so that LR of one sbrow can
+    // run concurrently with the deblock of the next
+    const size_t lr_lpf_line_off = arena_take(&sz, line_sz * 2 * 3 * 12);
+    const size_t re_off = arena_take(&sz, sb128h * 32 * 2 * tile_cols);
+    // for the sbrows (of up to 128 pixels high) passed to c->post_filter,
+    // and the restoration units of each plane (of at least 32 pixels)
+    size_t pf_cdef_idx_off = 0, pf_cdef_coded_off = 0, pf_lr_units_off = 0;
+    const size_t pf_lr_units_sz = (size_t) sb128w * 4 * sb128h * 4;
+    if (c->post_filter.filter_sbrow) {
+        pf_cdef_idx_off = arena_take(&sz, sb128w * 2 * 2);
+        pf_cdef_coded_off = arena_take(&sz, sb128w * 16 * 16);
+        pf_lr_units_off = arena_take(&sz, sizeof(Dav1dRestorationUnit) *
+                                          pf_lr_units_sz * 3);
+    }
+    const size_t frame_sz = sz;
+
+    size_t b_off = 0, pal_off = 0, pal_idx_off = 0, cbi_off = 0, cf_off = 0;
+    size_t tile_start_off_off = 0, sbrow_pos_off = 0, sb_progress_off = 0;
+    size_t cf_sz = 0;
+    if (c->n_fc > 1 || c->parse_ahead) {
+        b_off = arena_take(&sz, sizeof(*f->frame_thread.b) *
+                                sb128w * sb128h * 32 * 32);
+        pal_off = arena_take(&sz, sizeof(*f->frame_thread.pal) *
+                                  sb128w * sb128h * 16 * 16);
+        pal_idx_off = arena_take(&sz, sizeof(*f->frame_thread.pal_idx) *
+                                      sb128w * sb128h * 128 * 128 * 2);
+        cbi_off = arena_take(&sz, sizeof(*f->frame_thread.cbi) *
+                                  sb128w * sb128h * 32 * 32);
+        cf_sz = frame_thread_cf_size(sb128w, sb128h, hbd);
+        cf_off = arena_take(&sz, cf_sz);
+        tile_start_off_off =
+            arena_take(&sz, sizeof(*f->frame_thread.tile_start_off) *
+                            tile_cols * tile_rows);
+        // per tile sbrow, of up to 64 pixels high
+        sbrow_pos_off = arena_take(&sz, sizeof(*f->frame_thread.sbrow_pos) *
+                                        sb128h * 2 * tile_cols);
+        sb_progress_off =
+            arena_take(&sz, sizeof(*f->tile_thread.sb_progress) *
+                            sb128h * 2 * tile_cols);
+    }
+
+    uint8_t *const mem = f->arena.mem = c->hugepages ?
+        dav1d_alloc_aligned_hugepage(sz, 64) : dav1d_alloc_aligned(sz, 64);
+    if (!mem) return -ENOMEM;
+    f->arena.sb128w = sb128w;
+    f->arena.sb128h = sb128h;
+    f->arena.tile_cols = tile_cols;
+    f->arena.tile_rows = tile_rows;
+    f->arena.hbd = hbd;
+    f->arena.ipred_edge_rows = ipred_edge_rows;
+    f->arena.frame_sz = frame_sz;
+    f->arena.frame_thread_sz = sz - frame_sz;
+
+    f->a = (void *) &mem[a_off];
+    f->lf.mask = (void *) &mem[mask_off];
+    f->lf.level = (void *) &mem[level_off];
+
+    for (int pl = 0; pl <= 2; pl++)
+        f->ipred_edge[pl] = &mem[ipred_edge_off + ((ipred_edge_sz * pl) << hbd)];
+
+    uint8_t *ptr = f->lf.cdef_line = &mem[cdef_line_off];
+    uint8_t *lr_ptr = f->lf.lr_lpf_line = &mem[lr_lpf_line_off];
+    for (int pl = 0; pl <= 2; pl++) {
+        f->lf.cdef_line_ptr[0][pl][0] = ptr + line_sz * 0;
+        f->lf.cdef_line_ptr[0][pl][1] = ptr + line_sz * 1;
+        f->lf.cdef_line_ptr[1][pl][0] = ptr + line_sz * 2;
+        f->lf.cdef_line_ptr[1][pl][1] = ptr + line_sz * 3;
+        ptr += line_sz * 4;
+
+        f->lf.lr_lpf_line_ptr[0][pl] = lr_ptr;
+        f->lf.lr_lpf_line_ptr[1][pl] = lr_ptr + line_sz * 3 * 12;
+        lr_ptr += line_sz * 12;
+    }
+
+    f->lf.tx_lpf_right_edge[0] = &mem[re_off];
+    f->lf.tx_lpf_right_edge[1] = &mem[re_off + sb128h * 32 * tile_cols];
+
+    if (c->post_filter.filter_sbrow) {
+        f->post_filter.cdef_idx = (int8_t *) &mem[pf_cdef_idx_off];
+        f->post_filter.cdef_coded = &mem[pf_cdef_coded_off];
+        Dav1dRestorationUnit *const lr_units =
+            (Dav1dRestorationUnit *) &mem[pf_lr_units_off];
+        for (int pl = 0; pl < 3; pl++)
+            f->post_filter.lr_units[pl] = &lr_units[pf_lr_units_sz * pl];
+    }
+
+    if (c->n_fc > 1 || c->parse_ahead) {
+        f->frame_thread.b = (void *) &mem[b_off];
+        f->frame_thread.pal = (void *) &mem[pal_off];
+        f->frame_thread.pal_idx = &mem[pal_idx_off];
+        f->frame_thread.cbi = (void *) &mem[cbi_off];
+        f->frame_thread.cf = &mem[cf_off];
+        f->frame_thread.tile_start_off = (void *) &mem[tile_start_off_off];
+        f->frame_thread.sbrow_pos = (void *) &mem[sbrow_pos_off];
+        f->tile_thread.sb_progress = (void *) &mem[sb_progress_off];
+        // the inverse transforms clear the coefficients after use
+        memset(f->frame_thread.cf, 0, cf_sz);
+    }
 
-    if (f->n_tc > 1) {
-        if (f->frame_hdr.tiling.cols * f->sbh > f->tile_thread.titsati_sz) {
-            f->tile_thread.task_idx_to_sby_and_tile_idx =
-                malloc(sizeof(*f->tile_thread.task_idx_to_sby_and_tile_idx) *
-                       f->frame_hdr.tiling.cols * f->sbh);
-            if (!f->tile_thread.task_idx_to_sby_and_tile_idx) return -ENOMEM;
-            f->tile_thread.titsati_sz = f->frame_hdr.tiling.cols * f->sbh;
-        }
-        if (f->tile_thread.titsati_init[0] != f->frame_hdr.tiling.cols ||
-            f->tile_thread.titsati_init[1] != f->sbh)
-        {
-            for (int tile_row = 0, tile_idx = 0;
-                 tile_row < f->frame_hdr.tiling.rows; tile_row++)
+    return 0;
+}
+
+// Finds the tiles intersecting c->decode_region, and sets the area they
+// cover as the decoded region of the picture.
+static void set_decode_region(Dav1dFrameContext *const f) {
+    const Dav1dRect *const r = &f->c->decode_region;
+    const int cols = f->frame_hdr.tiling.cols, rows = f->frame_hdr.tiling.rows;
+    const int *const col_sb = f->frame_hdr.tiling.col_start_sb;
+    const int *const row_sb = f->frame_hdr.tiling.row_start_sb;
+    const int sb_sz = 64 << f->seq_hdr.sb128;
+
+    if (r->w && r->h) {
+        int col = 0, row = 0;
+        while (col < cols - 1 && col_sb[col + 1] * sb_sz <= r->x) col++;
+        f->region.col_start = col++;
+        while (col < cols && col_sb[col] * sb_sz < r->x + r->w) col++;
+        f->region.col_end = col;
+        while (row < rows - 1 && row_sb[row + 1] * sb_sz <= r->y) row++;
+        f->region.row_start = row++;
+        while (row < rows && row_sb[row] * sb_sz < r->y + r->h) row++;
+        f->region.row_end = row;
+    } else {
+        f->region.col_start = f->region.row_start = 0;
+        f->region.col_end = cols;
+        f->region.row_end = rows;
+    }
+
+    Dav1dRect *const out = &f->cur.p.region;
+    out->x = col_sb[f->region.col_start] * sb_sz;
+    out->y = row_sb[f->region.row_start] * sb_sz;
+    out->w = imin(col_sb[f->region.col_end] * sb_sz, f->frame_hdr.width) - out->x;
+    out->h = imin(row_sb[f->region.row_end] * sb_sz, f->frame_hdr.height) - out->y;
+}
+
+// Sets up the tiles of the tile groups received since the last call. With
+// frame threading, these keep arriving while the frame is decoded; if fewer
+// than min_tiles tiles (in tile index order) were set up so far, this waits
+// for more, unless all tile groups were received. Tiles still missing then,
+// or following an invalid tile size in their tile group, are skipped.
+static void setup_tiles(Dav1dFrameContext *const f, const int min_tiles) {
+    const int cols = f->frame_hdr.tiling.cols;
+    const int n_ts = cols * f->frame_hdr.tiling.rows;
+    const unsigned tile_col_mask = (1 << f->frame_hdr.tiling.log2_cols) - 1;
+
+    for (;;) {
+        int n_tile_data, done = 1;
+        if (f->c->n_fc == 1) {
+            n_tile_data = f->n_tile_data;
+        } else {
+            // written by dav1d_submit_tile_data() under the lock
+            pthread_mutex_lock(&f->frame_thread.td.lock);
+            while (f->tile_setup.n_tiles < min_tiles &&
+                   f->n_tile_data == f->tile_setup.n_groups &&
+                   !f->tile_data_done)
             {
-                for (int sby = f->frame_hdr.tiling.row_start_sb[tile_row];
-                     sby < f->frame_hdr.tiling.row_start_sb[tile_row + 1]; sby++)
-                {
-                    for (int tile_col = 0; tile_col < f->frame_hdr.tiling.cols;
-                         tile_col++, tile_idx++)
-                    {
-                        f->tile_thread.task_idx_to_sby_and_tile_idx[tile_idx][0] = sby;
-                        f->tile_thread.task_idx_to_sby_and_tile_idx[tile_idx][1] =
-                            tile_row * f->frame_hdr.tiling.cols + tile_col;
+                pthread_cond_wait(&f->frame_thread.td.cond,
+                                  &f->frame_thread.td.lock);
+            }
+            n_tile_data = f->n_tile_data;
+            done = f->tile_data_done;
+            pthread_mutex_unlock(&f->frame_thread.td.lock);
+        }
+
+        for (int i = f->tile_setup.n_groups; i < n_tile_data; i++) {
+            const uint8_t *data = f->tile[i].data.data;
+            size_t size = f->tile[i].data.sz;
+            int bad = 0;
+
+            const int last_tile_row_plus1 = 1 + (f->tile[i].end >> f->frame_hdr.tiling.log2_cols);
+            const int last_tile_col_plus1 = 1 + (f->tile[i].end & tile_col_mask);
+            const int empty_tile_cols = imax(0, last_tile_col_plus1 - f->frame_hdr.tiling.cols);
+            const int empty_tile_rows = imax(0, last_tile_row_plus1 - f->frame_hdr.tiling.rows);
+            const int empty_tiles =
+                (empty_tile_rows << f->frame_hdr.tiling.log2_cols) + empty_tile_cols;
+            for (int j = f->tile[i].start; j <= f->tile[i].end - empty_tiles; j++) {
+                const int tile_row = j >> f->frame_hdr.tiling.log2_cols;
+                const int tile_col = j & tile_col_mask;
+
+                if (tile_col >= f->frame_hdr.tiling.cols) continue;
+                if (tile_row >= f->frame_hdr.tiling.rows) continue;
+
+                size_t tile_sz = size;
+                if (!bad && j != f->tile[i].end - empty_tiles) {
+                    if (size < (size_t) f->frame_hdr.tiling.n_bytes) {
+                        bad = 1;
+                    } else {
+                        tile_sz = 0;
+                        for (int k = 0; k < f->frame_hdr.tiling.n_bytes; k++)
+                            tile_sz |= *data++ << (k * 8);
+                        tile_sz++;
+                        size -= f->frame_hdr.tiling.n_bytes;
+                        bad = tile_sz > size;
                     }
                 }
+                f->tile_setup.error |= bad;
+
+                const int n = tile_row * cols + tile_col;
+                Dav1dTileState *const ts = &f->ts[n];
+                setup_tile(ts, f, bad ? NULL : data, bad ? 0 : tile_sz,
+                           tile_row, tile_col,
+                           f->c->n_fc > 1 || f->c->parse_ahead ?
+                               f->frame_thread.tile_start_off[n] : 0);
+                ts->skip = bad ||
+                           tile_col < f->region.col_start ||
+                           tile_col >= f->region.col_end ||
+                           tile_row < f->region.row_start ||
+                           tile_row >= f->region.row_end;
+                if (!bad && j == f->frame_hdr.tiling.update &&
+                    f->frame_hdr.refresh_context)
+                {
+                    // later frames need the adapted entropy context
+                    ts->skip = 0;
+                    f->tile_setup.update_set = 1;
+                }
+                if (!bad) {
+                    data += tile_sz;
+                    size -= tile_sz;
+                }
+                f->tile_setup.n_tiles = n + 1;
             }
-            f->tile_thread.titsati_init[0] = f->frame_hdr.tiling.cols;
-            f->tile_thread.titsati_init[1] = f->sbh;
         }
+        f->tile_setup.n_groups = n_tile_data;
+
+        if (done) {
+            // the frame was cut short (e.g. by dav1d_flush())
+            for (int n = f->tile_setup.n_tiles; n < n_ts; n++) {
+                setup_tile(&f->ts[n], f, NULL, 0, n / cols, n % cols,
+                           f->c->n_fc > 1 || f->c->parse_ahead ?
+                               f->frame_thread.tile_start_off[n] : 0);
+                f->ts[n].skip = 1;
+            }
+            f->tile_setup.n_tiles = n_ts;
+        }
+
+        if (f->n_tc > 1) {
+            // hand the new tiles out to the tile workers
+            struct TaskThreadData *const ttd = f->tile_thread.ttd;
+            pthread_mutex_lock(&ttd->lock);
+            if (f->tile_thread.tiles_ready != f->tile_setup.n_tiles) {
+                f->tile_thread.tiles_ready = f->tile_setup.n_tiles;
+                pthread_cond_broadcast(&ttd->cond);
+            }
+            pthread_mutex_unlock(&ttd->lock);
+        }
+
+        if (f->tile_setup.n_tiles >= min_tiles) break;
     }
+}
 
-    if (f->frame_hdr.tiling.cols * f->frame_hdr.tiling.rows > f->n_ts) {
-        f->ts = realloc(f->ts, f->frame_hdr.tiling.cols *
-                               f->frame_hdr.tiling.rows * sizeof(*f->ts));
-        if (!f->ts) return -ENOMEM;
-        for (int n = f->n_ts;
-             n < f->frame_hdr.tiling.cols * f->frame_hdr.tiling.rows; n++)
-        {
-            Dav1dTileState *const ts = &f->ts[n];
-            pthread_mutex_init(&ts->tile_thread.lock, NULL);
-            pthread_cond_init(&ts->tile_thread.cond, NULL);
+// f->bd_fn.filter_sbrow(), timing each stage for the frame statistics,
+// and tracing them
+static void filter_sbrow_timed(Dav1dFrameContext *const f, const int sby) {
+    static const enum Dav1dTraceEventType trace_type[3] = {
+        DAV1D_TRACE_DEBLOCK, DAV1D_TRACE_CDEF, DAV1D_TRACE_LR,
+    };
+    const filter_sbrow_fn stage[3] = {
+        f->bd_fn.filter_sbrow_deblock,
+        f->bd_fn.filter_sbrow_cdef,
+        f->bd_fn.filter_sbrow_lr,
+    };
+
+    uint64_t start = dav1d_time_nanos();
+    for (int n = 0; n < 3; n++) {
+        dav1d_trace(f, f->tc->trace_thread, trace_type[n], 0, sby);
+        stage[n](f, sby);
+        dav1d_trace(f, f->tc->trace_thread, trace_type[n], 1, sby);
+        const uint64_t end = dav1d_time_nanos();
+        f->stats.stage_time[1 + n] += end - start;
+        start = end;
+    }
+}
+
+// restoration types as numbered in the AV1 specification
+static const uint8_t post_filter_lr_type[] = {
+    [RESTORATION_NONE] = 0,
+    [RESTORATION_WIENER] = 1,
+    [RESTORATION_SGRPROJ] = 2,
+    [RESTORATION_SWITCHABLE] = 3,
+};
+
+void dav1d_post_filter_sbrow(Dav1dFrameContext *const f, const int sby) {
+    Dav1dPostFilterSbrow *const s = &f->post_filter.sbrow;
+    const int sb_size = f->sb_step * 4;
+    const int ss_ver = f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420;
+    const int ss_hor = f->cur.p.p.layout != DAV1D_PIXEL_LAYOUT_I444;
+
+    s->pic = &f->cur.p;
+    s->sby = sby;
+    s->sb_size = sb_size;
+    s->last = sby + 1 == f->sbh;
+    // deblocking the next sbrow changes up to 6 (luma) rows above it, and
+    // y_end stays a multiple of 8
+    s->y_start = sby ? sby * sb_size - 8 : 0;
+    s->y_end = s->last ? f->cur.p.p.h : (sby + 1) * sb_size - 8;
+
+    s->cdef = f->seq_hdr.cdef;
+    if (s->cdef) {
+        const Av1Filter *const lflvl =
+            &f->lf.mask[(sby >> !f->seq_hdr.sb128) * f->sb128w];
+        const int sb64w = (f->bw + 15) >> 4;
+        const int sb64_row = f->seq_hdr.sb128 ? 0 : sby & 1;
+        int8_t *const cdef_idx = f->post_filter.cdef_idx;
+        uint8_t *const cdef_coded = f->post_filter.cdef_coded;
+
+        s->cdef_damping = f->frame_hdr.cdef.damping;
+        memset(s->cdef_y_strength, 0, sizeof(s->cdef_y_strength));
+        memset(s->cdef_uv_strength, 0, sizeof(s->cdef_uv_strength));
+        for (int n = 0; n < 1 << f->frame_hdr.cdef.n_bits; n++) {
+            s->cdef_y_strength[n] = f->frame_hdr.cdef.y_strength[n];
+            s->cdef_uv_strength[n] = f->frame_hdr.cdef.uv_strength[n];
+        }
+        // laid out like in dav1d_cdef_brow()
+        s->cdef_idx = cdef_idx;
+        s->cdef_idx_stride = f->sb128w * 2;
+        for (int y = 0; y < sb_size >> 6; y++)
+            for (int x = 0; x < sb64w; x++)
+                cdef_idx[y * s->cdef_idx_stride + x] =
+                    lflvl[x >> 1].cdef_idx[((sb64_row + y) << 1) + (x & 1)];
+        s->cdef_coded = cdef_coded;
+        s->cdef_coded_stride = f->sb128w * 16;
+        for (int y = 0; y < sb_size >> 3; y++) {
+            const int by = sby * f->sb_step + y * 2, by_idx = by & 30;
+            for (int x = 0; x < (f->bw + 1) >> 1; x++) {
+                const Av1Filter *const l = &lflvl[x >> 4];
+                cdef_coded[y * s->cdef_coded_stride + x] = by < f->bh &&
+                    ((l->noskip_mask[by_idx] | l->noskip_mask[by_idx + 1]) >>
+                     ((x * 2) & 30) & 3);
+            }
         }
-        if (c->n_fc > 1) {
-            freep(&f->frame_thread.tile_start_off);
-            f->frame_thread.tile_start_off =
-                malloc(sizeof(*f->frame_thread.tile_start_off) *
-                       f->frame_hdr.tiling.cols * f->frame_hdr.tiling.rows);
+    }
+
+    for (int pl = 0; pl < 3; pl++) {
+        const enum RestorationType type = f->frame_hdr.restoration.type[pl];
+
+        s->lr_type[pl] = post_filter_lr_type[type];
+        if (type == RESTORATION_NONE) {
+            s->lr_units[pl] = NULL;
+            s->lr_unit_cols[pl] = s->lr_unit_rows[pl] = 0;
+            continue;
+        }
+
+        const int ss_v = ss_ver && pl, ss_h = ss_hor && pl;
+        const int unit_size_log2 = f->frame_hdr.restoration.unit_size[!!pl];
+        const int half_unit_size = (1 << unit_size_log2) >> 1;
+        const int w = (f->cur.p.p.w + ss_h) >> ss_h;
+        const int h = (f->cur.p.p.h + ss_v) >> ss_v;
+        const int cols = imax((w + half_unit_size) >> unit_size_log2, 1);
+        const int rows = imax((h + half_unit_size) >> unit_size_log2, 1);
+        // those starting in the sbrows decoded so far
+        const int row_h = ((sby + 1) * sb_size) >> ss_v;
+        const int rows_ready = s->last ? rows :
+            imin((row_h + (1 << unit_size_log2) - 1) >> unit_size_log2, rows);
+        Dav1dRestorationUnit *const units = f->post_filter.lr_units[pl];
+
+        for (int ruy = f->post_filter.lr_rows[pl]; ruy < rows_ready; ruy++)
+            for (int rux = 0; rux < cols; rux++) {
+                // looked up like in lr_sbrow()
+                const Av1RestorationUnit *const lr =
+                    &f->lf.mask[((ruy << unit_size_log2) >> (7 - ss_v)) * f->sb128w +
+                                ((rux << unit_size_log2) >> (7 - ss_h))]
+                        .lr[pl][((ruy & 16) >> 3) + ((rux & 16) >> 4)];
+                Dav1dRestorationUnit *const u = &units[ruy * cols + rux];
+
+                u->type = post_filter_lr_type[lr->type];
+                u->sgr_idx = lr->sgr_idx;
+                memcpy(u->sgr_weights, lr->sgr_weights, sizeof(u->sgr_weights));
+                memcpy(u->filter_h, lr->filter_h, sizeof(u->filter_h));
+                memcpy(u->filter_v, lr->filter_v, sizeof(u->filter_v));
+            }
+        f->post_filter.lr_rows[pl] = rows_ready;
+
+        s->lr_unit_size_log2[pl] = unit_size_log2;
+        s->lr_units[pl] = units;
+        s->lr_unit_cols[pl] = cols;
+        s->lr_unit_rows[pl] = rows_ready;
+    }
+
+    f->c->post_filter.filter_sbrow(s, f->c->post_filter.cookie);
+}
+
+int dav1d_post_filter_progress(const Dav1dFrameContext *const f,
+                               const int sby)
+{
+    if (!f->post_filter.active || sby + 1 == f->sbh)
+        return (sby + 1) * f->sb_step * 4;
+    // the callback finishes the rows before the ones it was just given
+    return f->post_filter.sbrow.y_start;
+}
+
+static void finish_frame_stats(Dav1dFrameContext *const f) {
+    Dav1dFrameStats *const stats = &f->stats.out;
+
+    stats->data_sz = 0;
+    for (int i = 0; i < f->n_tile_data; i++)
+        stats->data_sz += f->tile[i].data.sz;
+    stats->tile_cols = f->frame_hdr.tiling.cols;
+    stats->tile_rows = f->frame_hdr.tiling.rows;
+    stats->frame_thread = f->c->n_fc > 1 ? (int) (f - f->c->fc) : -1;
+    stats->tile_time = f->stats.stage_time[0];
+    stats->deblock_time = f->stats.stage_time[1];
+    stats->cdef_time = f->stats.stage_time[2];
+    stats->lr_time = f->stats.stage_time[3];
+    stats->decode_time = dav1d_time_nanos() - f->stats.start;
+
+    stats->intra_blocks = stats->inter_blocks = 0;
+    stats->skip_blocks = stats->palette_blocks = stats->warped_blocks = 0;
+    memset(stats->tx_blocks, 0, sizeof(stats->tx_blocks));
+    for (int n = 0; n < f->frame_hdr.tiling.cols * f->frame_hdr.tiling.rows; n++) {
+        const Dav1dTileState *const ts = &f->ts[n];
+        stats->intra_blocks += ts->stats.intra;
+        stats->inter_blocks += ts->stats.inter;
+        stats->skip_blocks += ts->stats.skip;
+        stats->palette_blocks += ts->stats.palette;
+        stats->warped_blocks += ts->stats.warped;
+        for (int i = 0; i < N_RECT_TX_SIZES; i++)
+            stats->tx_blocks[i] += ts->stats.tx[i];
+    }
+}
+
+// The adapted entropy context only depends on the context update tile, so
+// it is published as soon as that tile is parsed, rather than at the end of
+// the frame, and frames which use it as their input context can start then.
+static void publish_out_cdf(Dav1dFrameContext *const f) {
+    if (!f->out_cdf.cdf) return;
+
+    if (f->tile_setup.update_set)
+        av1_update_tile_cdf(&f->frame_hdr, f->out_cdf.cdf, f->in_cdf.cdf,
+                            &f->ts[f->frame_hdr.tiling.update].cdf);
+    else
+        memcpy(f->out_cdf.cdf, f->in_cdf.cdf, sizeof(*f->out_cdf.cdf));
+    cdf_thread_signal(&f->out_cdf);
+    cdf_thread_unref(&f->out_cdf);
+}
+
+// With parse-ahead, runs pass 1 on the frame thread, interleaving the tile
+// columns like n_tc == 1 does, and hands each sbrow out to the tile tasks
+// of pass 2 once it is parsed in all of them. If a tile fails to parse, the
+// rest of the frame is cancelled, as decoding stops there with n_tc == 1.
+// Parsing is not held back by pass 2, so with 64x64 superblocks, the
+// loopfilter masks it builds for sbrow N + 1 share an Av1Filter with sbrow
+// N being deblocked; this relies on each sbrow having the words of its own
+// half of the masks (see Av1Filter).
+static void parse_frame(Dav1dFrameContext *const f) {
+    Dav1dTileContext *const t = f->tc;
+    const int update_tile_row =
+        f->frame_hdr.tiling.update / f->frame_hdr.tiling.cols;
+    uint64_t time = 0;
+
+    t->pass = 1;
+    for (int tile_row = 0; tile_row < f->frame_hdr.tiling.rows; tile_row++) {
+        for (int sby = f->frame_hdr.tiling.row_start_sb[tile_row];
+             sby < f->frame_hdr.tiling.row_start_sb[tile_row + 1]; sby++)
+        {
+            if (dav1d_frame_cancelled(f)) break;
+            t->by = sby << f->sb_shift;
+            const uint64_t start = f->c->frame_stats ? dav1d_time_nanos() : 0;
+            dav1d_trace(f, t->trace_thread, DAV1D_TRACE_TILE_SBROW, 0, sby);
+            for (int tile_col = 0; tile_col < f->frame_hdr.tiling.cols; tile_col++) {
+                t->ts = &f->ts[tile_row * f->frame_hdr.tiling.cols + tile_col];
+                if (decode_tile_sbrow(t)) {
+                    atomic_store(&f->tile_thread.aborted, 1);
+                    break;
+                }
+            }
+            dav1d_trace(f, t->trace_thread, DAV1D_TRACE_TILE_SBROW, 1, sby);
+            if (start)
+                time += dav1d_time_nanos() - start;
+            dav1d_tile_task_parsed(f, sby + 1);
         }
+        if (tile_row == update_tile_row)
+            publish_out_cdf(f);
+    }
+    // if cancelled, the tasks of the sbrows left only signal their progress
+    dav1d_tile_task_parsed(f, f->sbh);
+
+    if (time) {
+        pthread_mutex_lock(&f->tile_thread.ttd->lock);
+        f->stats.stage_time[0] += time;
+        pthread_mutex_unlock(&f->tile_thread.ttd->lock);
+    }
+}
+
+int decode_frame(Dav1dFrameContext *const f) {
+    const Dav1dContext *const c = f->c;
+    int res;
+
+    if (c->frame_stats) {
+        f->stats.start = dav1d_time_nanos();
+        memset(f->stats.stage_time, 0, sizeof(f->stats.stage_time));
+    }
+
+    if (f->frame_hdr.tiling.cols * f->frame_hdr.tiling.rows > f->n_ts) {
+        // cache line aligned, see Dav1dTileState.progress
+        dav1d_free_aligned(f->ts);
+        f->n_ts = 0;
+        f->ts = dav1d_alloc_aligned(f->frame_hdr.tiling.cols *
+                                    f->frame_hdr.tiling.rows * sizeof(*f->ts),
+                                    64);
+        if (!f->ts) return -ENOMEM;
         f->n_ts = f->frame_hdr.tiling.cols * f->frame_hdr.tiling.rows;
     }
 
-    if (c->n_fc > 1) {
+    if ((res = alloc_frame_arena(f)) < 0) return res;
+    update_memory_usage(f);
+    if ((res = dav1d_tile_context_alloc(f->tc, f)) < 0) return res;
+    f->tile_thread.error = 0;
+
+    if (c->n_fc > 1 || c->parse_ahead) {
         int tile_idx = 0;
         for (int tile_row = 0; tile_row < f->frame_hdr.tiling.rows; tile_row++) {
             int row_off = f->frame_hdr.tiling.row_start_sb[tile_row] *
@@ -2303,77 +3018,6 @@ int decode_frame(Dav1dFrameContext *const f) {
         }
     }
 
-    if (f->sb128w * f->frame_hdr.tiling.rows > f->a_sz) {
-        freep(&f->a);
-        f->a = malloc(f->sb128w * f->frame_hdr.tiling.rows * sizeof(*f->a));
-        if (!f->a) return -ENOMEM;
-        f->a_sz = f->sb128w * f->frame_hdr.tiling.rows;
-    }
-
-    // update allocation of block contexts for above
-    if (f->sb128w > f->lf.line_sz) {
-        dav1d_freep_aligned(&f->lf.cdef_line);
-        dav1d_freep_aligned(&f->lf.lr_lpf_line);
-
-        // note that we allocate all pixel arrays as if we were dealing with
-        // 10 bits/component data
-        uint16_t *ptr = f->lf.cdef_line =
-            dav1d_alloc_aligned(f->b4_stride * 4 * 12 * sizeof(uint16_t), 32);
-
-        uint16_t *lr_ptr = f->lf.lr_lpf_line =
-            dav1d_alloc_aligned(f->b4_stride * 4 * 3 * 12 * sizeof(uint16_t), 32);
-
-        for (int pl = 0; pl <= 2; pl++) {
-            f->lf.cdef_line_ptr[0][pl][0] = ptr + f->b4_stride * 4 * 0;
-            f->lf.cdef_line_ptr[0][pl][1] = ptr + f->b4_stride * 4 * 1;
-            f->lf.cdef_line_ptr[1][pl][0] = ptr + f->b4_stride * 4 * 2;
-            f->lf.cdef_line_ptr[1][pl][1] = ptr + f->b4_stride * 4 * 3;
-            ptr += f->b4_stride * 4 * 4;
-
-            f->lf.lr_lpf_line_ptr[pl] = lr_ptr;
-            lr_ptr += f->b4_stride * 4 * 12;
-        }
-
-        f->lf.line_sz = f->sb128w;
-    }
-
-    // update allocation for loopfilter masks
-    if (f->sb128w * f->sb128h > f->lf.mask_sz) {
-        freep(&f->lf.mask);
-        freep(&f->lf.level);
-        freep(&f->frame_thread.b);
-        f->lf.mask = malloc(f->sb128w * f->sb128h * sizeof(*f->lf.mask));
-        f->lf.level = malloc(f->sb128w * f->sb128h * 32 * 32 *
-                             sizeof(*f->lf.level));
-        if (!f->lf.mask || !f->lf.level) return -ENOMEM;
-        if (c->n_fc > 1) {
-            freep(&f->frame_thread.b);
-            freep(&f->frame_thread.cbi);
-            dav1d_freep_aligned(&f->frame_thread.cf);
-            dav1d_freep_aligned(&f->frame_thread.pal_idx);
-            freep(&f->frame_thread.pal);
-            f->frame_thread.b = malloc(sizeof(*f->frame_thread.b) *
-                                       f->sb128w * f->sb128h * 32 * 32);
-            f->frame_thread.pal = malloc(sizeof(*f->frame_thread.pal) *
-                                         f->sb128w * f->sb128h * 16 * 16);
-            f->frame_thread.pal_idx =
-                dav1d_alloc_aligned(sizeof(*f->frame_thread.pal_idx) *
-                                    f->sb128w * f->sb128h * 128 * 128 * 2, 32);
-            f->frame_thread.cbi = malloc(sizeof(*f->frame_thread.cbi) *
-                                         f->sb128w * f->sb128h * 32 * 32);
-            f->frame_thread.cf =
-                dav1d_alloc_aligned(sizeof(int32_t) * 3 *
-                                    f->sb128w * f->sb128h * 128 * 128, 32);
-            if (!f->frame_thread.b || !f->frame_thread.pal_idx ||
-                !f->frame_thread.cf)
-            {
-                return -ENOMEM;
-            }
-            memset(f->frame_thread.cf, 0,
-                   sizeof(int32_t) * 3 * f->sb128w * f->sb128h * 128 * 128);
-        }
-        f->lf.mask_sz = f->sb128w * f->sb128h;
-    }
     if (f->frame_hdr.loopfilter.sharpness != f->lf.last_sharpness) {
         dav1d_calc_eih(&f->lf.lim_lut, f->frame_hdr.loopfilter.sharpness);
         f->lf.last_sharpness = f->frame_hdr.loopfilter.sharpness;
@@ -2381,53 +3025,39 @@ int decode_frame(Dav1dFrameContext *const f) {
     dav1d_calc_lf_values(f->lf.lvl, &f->frame_hdr, (int8_t[4]) { 0, 0, 0, 0 });
     memset(f->lf.mask, 0, sizeof(*f->lf.mask) * f->sb128w * f->sb128h);
 
-    if (f->sbh * f->sb128w * 128 > f->ipred_edge_sz) {
-        dav1d_freep_aligned(&f->ipred_edge[0]);
-        uint16_t *ptr = f->ipred_edge[0] =
-            dav1d_alloc_aligned(f->sb128w * 128 * f->sbh * 3 * sizeof(uint16_t), 32);
-        if (!f->ipred_edge[0]) return -ENOMEM;
-        f->ipred_edge_sz = f->sbh * f->sb128w * 128;
-        f->ipred_edge[1] = &ptr[f->ipred_edge_sz];
-        f->ipred_edge[2] = &ptr[f->ipred_edge_sz * 2];
-    }
-
-    if (f->sb128h > f->lf.re_sz) {
-        freep(&f->lf.tx_lpf_right_edge[0]);
-        f->lf.tx_lpf_right_edge[0] = malloc((f->sb128h * 32 * 2) *
-                                            f->frame_hdr.tiling.cols);
-        if (!f->lf.tx_lpf_right_edge[0]) return -ENOMEM;
-        f->lf.tx_lpf_right_edge[1] = f->lf.tx_lpf_right_edge[0] +
-                                     f->sb128h * 32 * f->frame_hdr.tiling.cols;
-        f->lf.re_sz = f->sb128h;
-    }
-
     // init ref mvs
     if ((f->frame_hdr.frame_type & 1) || f->frame_hdr.allow_intrabc) {
         f->mvs = f->mvs_ref->data;
         const int order_hint_n_bits = f->seq_hdr.order_hint * f->seq_hdr.order_hint_n_bits;
-        av1_init_ref_mv_common(f->libaom_cm, f->bw >> 1, f->bh >> 1,
-                               f->b4_stride, f->seq_hdr.sb128,
-                               f->mvs, f->ref_mvs, f->cur.p.poc, f->refpoc,
-                               f->refrefpoc, f->frame_hdr.gmv,
-                               f->frame_hdr.hp, f->frame_hdr.force_integer_mv,
-                               f->frame_hdr.use_ref_frame_mvs,
-                               order_hint_n_bits);
-        if (c->n_fc == 1 && f->frame_hdr.use_ref_frame_mvs)
-            av1_init_ref_mv_tile_row(f->libaom_cm, 0, f->bw, 0, f->bh);
+        res = av1_init_refmvs_frame(&f->rf, f->bw, f->bh,
+                                    f->b4_stride, f->seq_hdr.sb128,
+                                    f->mvs, f->ref_mvs, f->cur.p.poc, f->refpoc,
+                                    f->refrefpoc, f->frame_hdr.gmv,
+                                    f->frame_hdr.hp, f->frame_hdr.force_integer_mv,
+                                    f->frame_hdr.use_ref_frame_mvs,
+                                    order_hint_n_bits);
+        if (res < 0) return res;
     }
 
     // setup dequant tables
     init_quant_tables(&f->seq_hdr, &f->frame_hdr, f->frame_hdr.quant.yac, f->dq);
-    if (f->frame_hdr.quant.qm)
+    if (f->frame_hdr.quant.qm) {
+        av1_init_qm_tables();
         for (int j = 0; j < N_RECT_TX_SIZES; j++) {
             f->qm[0][j][0] = av1_qm_tbl[f->frame_hdr.quant.qm_y][0][j];
             f->qm[0][j][1] = av1_qm_tbl[f->frame_hdr.quant.qm_u][1][j];
             f->qm[0][j][2] = av1_qm_tbl[f->frame_hdr.quant.qm_v][1][j];
         }
+    }
     for (int i = f->frame_hdr.quant.qm; i < 2; i++)
         for (int tx = 0; tx < N_RECT_TX_SIZES; tx++)
             for (int pl = 0; pl < 3; pl++)
-                f->qm[i][tx][pl] = av1_qm_tbl[15][!!pl][tx];
+                f->qm[i][tx][pl] = av1_qm_flat;
+
+    // the wedge and inter-intra masks are built once the first frame that
+    // can use them comes along
+    if (f->frame_hdr.frame_type & 1)
+        av1_init_wedge_masks();
 
     // setup jnt_comp weights
     if (f->frame_hdr.switchable_comp_refs) {
@@ -2464,58 +3094,20 @@ int decode_frame(Dav1dFrameContext *const f) {
         }
     }
 
-    // init loopfilter pointers
-    f->lf.mask_ptr = f->lf.mask;
-    f->lf.p[0] = f->cur.p.data[0];
-    f->lf.p[1] = f->cur.p.data[1];
-    f->lf.p[2] = f->cur.p.data[2];
+    // init loopfilter state
     f->lf.tile_row = 1;
 
-    cdf_thread_wait(&f->in_cdf);
-
-    // parse individual tiles per tile group
-    int update_set = 0, tile_idx = 0;
-    const unsigned tile_col_mask = (1 << f->frame_hdr.tiling.log2_cols) - 1;
-    for (int i = 0; i < f->n_tile_data; i++) {
-        const uint8_t *data = f->tile[i].data.data;
-        size_t size = f->tile[i].data.sz;
-
-        const int last_tile_row_plus1 = 1 + (f->tile[i].end >> f->frame_hdr.tiling.log2_cols);
-        const int last_tile_col_plus1 = 1 + (f->tile[i].end & tile_col_mask);
-        const int empty_tile_cols = imax(0, last_tile_col_plus1 - f->frame_hdr.tiling.cols);
-        const int empty_tile_rows = imax(0, last_tile_row_plus1 - f->frame_hdr.tiling.rows);
-        const int empty_tiles =
-            (empty_tile_rows << f->frame_hdr.tiling.log2_cols) + empty_tile_cols;
-        for (int j = f->tile[i].start; j <= f->tile[i].end - empty_tiles; j++) {
-            const int tile_row = j >> f->frame_hdr.tiling.log2_cols;
-            const int tile_col = j & tile_col_mask;
-
-            if (tile_col >= f->frame_hdr.tiling.cols) continue;
-            if (tile_row >= f->frame_hdr.tiling.rows) continue;
-
-            size_t tile_sz;
-            if (j == f->tile[i].end - empty_tiles) {
-                tile_sz = size;
-            } else {
-                tile_sz = 0;
-                for (int k = 0; k < f->frame_hdr.tiling.n_bytes; k++)
-                    tile_sz |= *data++ << (k * 8);
-                tile_sz++;
-                size -= f->frame_hdr.tiling.n_bytes;
-                if (tile_sz > size) goto error;
-            }
-
-            setup_tile(&f->ts[tile_row * f->frame_hdr.tiling.cols + tile_col],
-                       f, data, tile_sz, tile_row, tile_col,
-                       c->n_fc > 1 ? f->frame_thread.tile_start_off[tile_idx++] : 0);
-            if (j == f->frame_hdr.tiling.update && f->frame_hdr.refresh_context)
-                update_set = 1;
-            data += tile_sz;
-            size -= tile_sz;
-        }
+    if (c->n_fc > 1) {
+        const uint64_t start = dav1d_time_nanos();
+        if (cdf_thread_wait(&f->in_cdf))
+            dav1d_wait_stats_add(f, DAV1D_WAIT_CDF, dav1d_time_nanos() - start);
     }
 
-    cdf_thread_unref(&f->in_cdf);
+    // set up the tiles received so far; with frame threading, the others
+    // are set up as they arrive, before the tile rows they are in are decoded
+    memset(&f->tile_setup, 0, sizeof(f->tile_setup));
+    f->tile_thread.tiles_ready = 0;
+    setup_tiles(f, 0);
 
     // 2-pass decoding:
     // - enabled for frame-threading, so that one frame can do symbol parsing
@@ -2526,9 +3118,16 @@ int decode_frame(Dav1dFrameContext *const f) {
     // - pass 0 means no 2-pass;
     // - pass 1 means symbol parsing only;
     // - pass 2 means reconstruction and loop filtering.
-
-    const int uses_2pass = c->n_fc > 1 && f->frame_hdr.refresh_context;
-    for (f->frame_thread.pass = uses_2pass;
+    // With parse-ahead (c->parse_ahead), the frame thread runs pass 1 on its
+    // own, alongside (and ahead of) the tile tasks of pass 2.
+
+    const int parse_ahead = c->parse_ahead && !f->frame_hdr.allow_intrabc;
+    const int uses_2pass =
+        (c->n_fc > 1 && f->frame_hdr.refresh_context) || parse_ahead;
+    const int update_tile_row =
+        f->frame_hdr.tiling.update / f->frame_hdr.tiling.cols;
+    atomic_init(&f->tile_thread.aborted, 0);
+    for (f->frame_thread.pass = uses_2pass + parse_ahead;
          f->frame_thread.pass <= 2 * uses_2pass; f->frame_thread.pass++)
     {
         const enum PlaneType progress_plane_type =
@@ -2536,44 +3135,78 @@ int decode_frame(Dav1dFrameContext *const f) {
             f->frame_thread.pass == 1 ? PLANE_TYPE_BLOCK : PLANE_TYPE_Y;
 
         for (int n = 0; n < f->sb128w * f->frame_hdr.tiling.rows; n++)
-            reset_context(&f->a[n], !(f->frame_hdr.frame_type & 1), f->frame_thread.pass);
+            reset_context(&f->a[n], !(f->frame_hdr.frame_type & 1),
+                          parse_ahead ? 1 : f->frame_thread.pass);
+        if (parse_ahead)
+            for (int n = f->sb128w * f->frame_hdr.tiling.rows;
+                 n < 2 * f->sb128w * f->frame_hdr.tiling.rows; n++)
+            {
+                reset_context(&f->a[n], !(f->frame_hdr.frame_type & 1), 2);
+            }
 
         if (f->n_tc == 1) {
             Dav1dTileContext *const t = f->tc;
+            t->pass = f->frame_thread.pass;
 
             // no tile threading - we explicitly interleave tile/sbrow decoding
             // and post-filtering, so that the full process runs in-line, so
             // that frame threading is still possible
             for (int tile_row = 0; tile_row < f->frame_hdr.tiling.rows; tile_row++) {
+                setup_tiles(f, (tile_row + 1) * f->frame_hdr.tiling.cols);
                 for (int sby = f->frame_hdr.tiling.row_start_sb[tile_row];
                      sby < f->frame_hdr.tiling.row_start_sb[tile_row + 1]; sby++)
                 {
+                    if (dav1d_frame_cancelled(f)) break;
                     t->by = sby << (4 + f->seq_hdr.sb128);
+                    const uint64_t start = c->frame_stats ? dav1d_time_nanos() : 0;
+                    dav1d_trace(f, t->trace_thread, DAV1D_TRACE_TILE_SBROW, 0, sby);
                     for (int tile_col = 0; tile_col < f->frame_hdr.tiling.cols; tile_col++) {
                         t->ts = &f->ts[tile_row * f->frame_hdr.tiling.cols + tile_col];
 
                         int res;
-                        if ((res = decode_tile_sbrow(t)))
+                        if ((res = decode_tile_sbrow(t))) {
+                            publish_out_cdf(f);
                             return res;
+                        }
                     }
+                    dav1d_trace(f, t->trace_thread, DAV1D_TRACE_TILE_SBROW, 1, sby);
+                    if (start)
+                        f->stats.stage_time[0] += dav1d_time_nanos() - start;
 
                     // loopfilter + cdef + restoration
-                    if (f->frame_thread.pass != 1)
-                        f->bd_fn.filter_sbrow(f, sby);
-                    dav1d_thread_picture_signal(&f->cur, (sby + 1) * f->sb_step * 4,
+                    if (f->frame_thread.pass != 1) {
+                        if (c->frame_stats || c->trace.callback)
+                            filter_sbrow_timed(f, sby);
+                        else
+                            f->bd_fn.filter_sbrow(f, sby);
+                    }
+                    dav1d_thread_picture_signal(&f->cur,
+                                                f->frame_thread.pass == 1 ?
+                                                (sby + 1) * f->sb_step * 4 :
+                                                dav1d_post_filter_progress(f, sby),
                                                 progress_plane_type);
                 }
+                if (f->frame_thread.pass <= 1 && tile_row == update_tile_row)
+                    publish_out_cdf(f);
             }
         } else {
             // signal available tasks to worker threads
             int num_tasks;
 
-            const uint64_t all_mask = ~0ULL >> (64 - f->n_tc);
-            pthread_mutex_lock(&f->tile_thread.lock);
-            while (f->tile_thread.available != all_mask)
-                pthread_cond_wait(&f->tile_thread.icond, &f->tile_thread.lock);
-            assert(!f->tile_thread.tasks_left);
-            if (f->frame_thread.pass == 1 || f->n_tc >= f->frame_hdr.tiling.cols) {
+            // in pass 2, the sbrows of a tile don't depend on each other's
+            // symbols anymore, so they can be reconstructed as a wavefront;
+            // not with intra block copy, which may refer to any superblock
+            // above
+            f->tile_thread.wavefront = f->frame_thread.pass == 2 &&
+                                       !f->frame_hdr.allow_intrabc;
+            if (f->tile_thread.wavefront)
+                for (int n = 0; n < f->sbh * f->frame_hdr.tiling.cols; n++)
+                    atomic_init(&f->tile_thread.sb_progress[n].sbs, 0);
+            f->tile_thread.parsed = parse_ahead ? 0 : f->sbh;
+
+            if (!f->tile_thread.wavefront &&
+                (f->frame_thread.pass == 1 || f->n_tc >= f->frame_hdr.tiling.cols))
+            {
                 // we can (or in fact, if >, we need to) do full tile decoding.
                 // loopfilter happens below
                 num_tasks = f->frame_hdr.tiling.cols * f->frame_hdr.tiling.rows;
@@ -2583,63 +3216,78 @@ int decode_frame(Dav1dFrameContext *const f) {
                 // waiting for the post-filter to complete
                 num_tasks = f->sbh * f->frame_hdr.tiling.cols;
             }
-            f->tile_thread.num_tasks = f->tile_thread.tasks_left = num_tasks;
-            pthread_cond_broadcast(&f->tile_thread.cond);
-            pthread_mutex_unlock(&f->tile_thread.lock);
-
-            // loopfilter + cdef + restoration
-            for (int tile_row = 0; tile_row < f->frame_hdr.tiling.rows; tile_row++) {
-                for (int sby = f->frame_hdr.tiling.row_start_sb[tile_row];
-                     sby < f->frame_hdr.tiling.row_start_sb[tile_row + 1]; sby++)
-                {
-                    for (int tile_col = 0; tile_col < f->frame_hdr.tiling.cols;
-                         tile_col++)
+            dav1d_tile_task_submit(f, num_tasks);
+            // the workers take the tiles as they are set up
+            setup_tiles(f, f->frame_hdr.tiling.cols * f->frame_hdr.tiling.rows);
+            if (parse_ahead)
+                parse_frame(f);
+
+            // loopfilter + cdef + restoration run as tasks of their own,
+            // pipelined across sbrows, and signal picture progress as the
+            // last stage of each sbrow completes
+            if (f->frame_thread.pass == 1) {
+                for (int tile_row = 0; tile_row < f->frame_hdr.tiling.rows; tile_row++) {
+                    for (int sby = f->frame_hdr.tiling.row_start_sb[tile_row];
+                         sby < f->frame_hdr.tiling.row_start_sb[tile_row + 1]; sby++)
                     {
-                        Dav1dTileState *const ts =
-                            &f->ts[tile_row * f->frame_hdr.tiling.cols + tile_col];
-
-                        if (atomic_load(&ts->progress) <= sby) {
-                            pthread_mutex_lock(&ts->tile_thread.lock);
-                            while (atomic_load(&ts->progress) <= sby)
-                                pthread_cond_wait(&ts->tile_thread.cond,
-                                                  &ts->tile_thread.lock);
-                            pthread_mutex_unlock(&ts->tile_thread.lock);
+                        for (int tile_col = 0; tile_col < f->frame_hdr.tiling.cols;
+                             tile_col++)
+                        {
+                            Dav1dTileState *const ts =
+                                &f->ts[tile_row * f->frame_hdr.tiling.cols + tile_col];
+
+                            if (atomic_load(&ts->progress) <= sby)
+                                dav1d_tile_task_wait_progress(f, ts, sby);
                         }
-                    }
 
-                    // loopfilter + cdef + restoration
-                    if (f->frame_thread.pass != 1)
-                        f->bd_fn.filter_sbrow(f, sby);
-                    dav1d_thread_picture_signal(&f->cur, (sby + 1) * f->sb_step * 4,
-                                                progress_plane_type);
+                        dav1d_thread_picture_signal(&f->cur, (sby + 1) * f->sb_step * 4,
+                                                    progress_plane_type);
+                    }
+                    if (tile_row == update_tile_row)
+                        publish_out_cdf(f);
                 }
             }
-        }
 
-        if (f->frame_thread.pass <= 1 && f->frame_hdr.refresh_context) {
-            // cdf update
-            if (update_set)
-                av1_update_tile_cdf(&f->frame_hdr, f->out_cdf.cdf,
-                                    &f->ts[f->frame_hdr.tiling.update].cdf);
-            cdf_thread_signal(&f->out_cdf);
-            cdf_thread_unref(&f->out_cdf);
+            // workers may still be returning from their last task, which
+            // must be done before the tile state is reset or reallocated
+            dav1d_tile_task_wait(f);
         }
-        if (f->frame_thread.pass == 1) {
+
+        // cdf update, unless it was already published
+        if (f->frame_thread.pass <= 1)
+            publish_out_cdf(f);
+        if (f->tile_thread.error || dav1d_frame_cancelled(f)) break;
+        if (f->frame_thread.pass == 1 && f->n_tc > 1) {
             assert(c->n_fc > 1);
             for (int tile_idx = 0;
                  tile_idx < f->frame_hdr.tiling.rows * f->frame_hdr.tiling.cols;
                  tile_idx++)
             {
                 Dav1dTileState *const ts = &f->ts[tile_idx];
-                const int tile_start_off = f->frame_thread.tile_start_off[tile_idx];
-                ts->frame_thread.pal_idx = &f->frame_thread.pal_idx[tile_start_off * 2];
-                ts->frame_thread.cf = &((int32_t *) f->frame_thread.cf)[tile_start_off * 3];
-                if (f->n_tc > 0)
-                    atomic_init(&ts->progress, 0);
+                const int row_sb_start = ts->tiling.row_start >> f->sb_shift;
+                atomic_init(&ts->progress, row_sb_start);
+                ts->tile_thread.next_sby = row_sb_start;
             }
         }
     }
 
+    // pass 2 clears the coefficients left by pass 1 as it consumes them; if
+    // the frame was cut short (by an error, or cancelled by dav1d_flush())
+    // before it was done, the next frame decoded with this context would
+    // pick up those that remain
+    if (uses_2pass && f->frame_thread.pass <= 2)
+        memset(f->frame_thread.cf, 0,
+               frame_thread_cf_size(f->arena.sb128w, f->arena.sb128h,
+                                    f->arena.hbd));
+
+    if (c->frame_stats) {
+        finish_frame_stats(f);
+        // the output copy of the picture was taken when the frame was
+        // submitted (see submit_frame() for the one of n_fc == 1); it is
+        // only read once the frame is signalled as done below
+        if (c->n_fc > 1)
+            c->frame_thread.out_delayed[f - c->fc].p.stats = f->stats.out;
+    }
     dav1d_thread_picture_signal(&f->cur, UINT_MAX, PLANE_TYPE_ALL);
 
     for (int i = 0; i < 7; i++) {
@@ -2650,6 +3298,7 @@ int decode_frame(Dav1dFrameContext *const f) {
     }
 
     dav1d_thread_picture_unref(&f->cur);
+    cdf_thread_unref(&f->in_cdf);
     if (f->cur_segmap_ref)
         dav1d_ref_dec(f->cur_segmap_ref);
     if (f->prev_segmap_ref)
@@ -2660,13 +3309,179 @@ int decode_frame(Dav1dFrameContext *const f) {
     for (int i = 0; i < f->n_tile_data; i++)
         dav1d_data_unref(&f->tile[i].data);
 
+    return f->tile_thread.error ? -ENOMEM : f->tile_setup.error ? -EINVAL : 0;
+}
+
+// The DSP function tables only depend on the bitdepth and the CPU flags in
+// use, so they are shared by all decoder instances opened with the same
+// flags. Each set is built by the first dav1d_open() with its flags, and
+// kept for the lifetime of the process.
+typedef struct DSPTables {
+    struct DSPTables *next;
+    unsigned cpu_flags;
+    Dav1dDSPContext dsp[3 /* 8, 10, 12 bits/component */];
+} DSPTables;
+
+static DSPTables *dsp_tables;
+static pthread_mutex_t dsp_tables_lock;
+static pthread_once_t dsp_tables_lock_initted = PTHREAD_ONCE_INIT;
+
+static void init_dsp_tables_lock(void) {
+    pthread_mutex_init(&dsp_tables_lock, NULL);
+}
+
+#define assign_bitdepth_case(bd) \
+static void init_dsp_##bd##bpc(Dav1dDSPContext *const dsp) { \
+    dav1d_cdef_dsp_init_##bd##bpc(&dsp->cdef); \
+    dav1d_intra_pred_dsp_init_##bd##bpc(&dsp->ipred); \
+    dav1d_itx_dsp_init_##bd##bpc(&dsp->itx); \
+    dav1d_loop_filter_dsp_init_##bd##bpc(&dsp->lf); \
+    dav1d_loop_restoration_dsp_init_##bd##bpc(&dsp->lr); \
+    dav1d_mc_dsp_init_##bd##bpc(&dsp->mc); \
+    dav1d_film_grain_dsp_init_##bd##bpc(&dsp->fg); \
+    dav1d_pixfmt_dsp_init_##bd##bpc(&dsp->pixfmt); \
+}
+#if CONFIG_8BPC
+assign_bitdepth_case(8)
+#endif
+#if CONFIG_10BPC
+assign_bitdepth_case(10)
+#endif
+#undef assign_bitdepth_case
+
+const Dav1dDSPContext *dav1d_get_dsp_tables(void) {
+    pthread_once(&dsp_tables_lock_initted, init_dsp_tables_lock);
+    pthread_mutex_lock(&dsp_tables_lock);
+    const unsigned cpu_flags = dav1d_get_cpu_flags();
+    DSPTables *t = dsp_tables;
+    while (t && t->cpu_flags != cpu_flags)
+        t = t->next;
+    if (!t && (t = malloc(sizeof(*t)))) {
+        memset(t, 0, sizeof(*t));
+        t->cpu_flags = cpu_flags;
+#if CONFIG_8BPC
+        init_dsp_8bpc(&t->dsp[0]);
+#endif
+#if CONFIG_10BPC
+        init_dsp_10bpc(&t->dsp[1]);
+#endif
+        t->next = dsp_tables;
+        dsp_tables = t;
+    }
+    pthread_mutex_unlock(&dsp_tables_lock);
+    return t ? t->dsp : NULL;
+}
+
+// Allocates out like the decoded pictures (including the size of their
+// progress data with frame threading, so that they share the pool), in the
+// given format, and sets all but its pixels to those of in.
+static int alloc_output_picture(const Dav1dContext *const c,
+                                Dav1dPicture *const out,
+                                const Dav1dPicture *const in,
+                                const enum Dav1dOutputFormat format)
+{
+    Dav1dThreadPicture tp = { 0 };
+    const int res =
+        dav1d_thread_picture_alloc(c, &tp, in->p.w, in->p.h, in->p.layout,
+                                   format, in->p.bpc,
+                                   c->low_memory && !c->seq_hdr.sb128 ? 64 : 128,
+                                   &c->allocator, c->picture_pool,
+                                   c->n_fc > 1 ? &c->fc[0].frame_thread.td : NULL,
+                                   1);
+    if (res < 0) return res;
+
+    *out = *in;
+    if (out->block_info_ref)
+        dav1d_ref_inc(out->block_info_ref);
+    memcpy(out->data, tp.p.data, sizeof(out->data));
+    memcpy(out->stride, tp.p.stride, sizeof(out->stride));
+    out->ref = tp.p.ref;
+    out->allocator_data = tp.p.allocator_data;
+    out->p.format = format;
     return 0;
+}
 
-error:
-    for (int i = 0; i < f->n_tile_data; i++)
-        dav1d_data_unref(&f->tile[i].data);
+static int apply_grain(const Dav1dContext *const c, Dav1dPicture *const out,
+                       const Dav1dPicture *const in)
+{
+    if (!c->apply_grain || !in->film_grain_present) {
+        dav1d_picture_ref(out, in);
+        return 0;
+    }
+
+    const int res = alloc_output_picture(c, out, in, DAV1D_OUTPUTFORMAT_PLANAR);
+    if (res < 0) return res;
+
+    if (in->p.bpc <= 8) {
+#if CONFIG_8BPC
+        dav1d_apply_grain_8bpc(&c->dsp[0].fg, out, in);
+#endif
+    } else {
+#if CONFIG_10BPC
+        dav1d_apply_grain_10bpc(&c->dsp[1].fg, out, in);
+#endif
+    }
+    out->film_grain_present = 0;
+    return 0;
+}
+
+static int convert_picture(const Dav1dContext *const c,
+                           Dav1dPicture *const out,
+                           const Dav1dPicture *const in)
+{
+    if (c->output_format == DAV1D_OUTPUTFORMAT_PLANAR ||
+        in->p.layout == DAV1D_PIXEL_LAYOUT_I400)
+    {
+        dav1d_picture_ref(out, in);
+        return 0;
+    }
+
+    const int res = alloc_output_picture(c, out, in, c->output_format);
+    if (res < 0) return res;
+
+    if (in->p.bpc <= 8) {
+#if CONFIG_8BPC
+        dav1d_convert_picture_8bpc(&c->dsp[0].pixfmt, out, in);
+#endif
+    } else {
+#if CONFIG_10BPC
+        dav1d_convert_picture_10bpc(&c->dsp[1].pixfmt, out, in);
+#endif
+    }
+    return 0;
+}
 
-    return -EINVAL;
+int dav1d_output_image(const Dav1dContext *const c, Dav1dPicture *const out,
+                       const Dav1dPicture *const in)
+{
+    Dav1dPicture grain = { 0 };
+    int res = apply_grain(c, &grain, in);
+    if (res < 0) return res;
+    res = convert_picture(c, out, &grain);
+    dav1d_picture_unref(&grain);
+    return res;
+}
+
+void dav1d_picture_ready(const Dav1dContext *const c,
+                         PictureReadyQueue *const q, const int slot)
+{
+    pthread_mutex_lock(&q->lock);
+    if (slot >= 0) q->finished[slot] = 1;
+    while (q->finished[q->head]) {
+        Dav1dThreadPicture *const out_delayed = &q->slots[q->head];
+        if (out_delayed->visible && !out_delayed->flushed) {
+            Dav1dPicture p = { 0 };
+            // without memory for the grain or conversion, pass the
+            // picture as is
+            if (dav1d_output_image(c, &p, &out_delayed->p) < 0)
+                dav1d_picture_ref(&p, &out_delayed->p);
+            q->callback(&p, q->cookie);
+        }
+        dav1d_thread_picture_unref(out_delayed);
+        q->finished[q->head] = 0;
+        if (++q->head == q->n_slots) q->head = 0;
+    }
+    pthread_mutex_unlock(&q->lock);
 }
 
 int submit_frame(Dav1dContext *const c) {
@@ -2681,10 +3496,7 @@ int submit_frame(Dav1dContext *const c) {
             c->frame_thread.next = 0;
 
         f = &c->fc[next];
-        pthread_mutex_lock(&f->frame_thread.td.lock);
-        while (f->n_tile_data > 0)
-            pthread_cond_wait(&f->frame_thread.td.cond,
-                              &f->frame_thread.td.lock);
+        dav1d_frame_thread_wait_idle(f, c->tc);
         out_delayed = &c->frame_thread.out_delayed[next];
         if (out_delayed->p.data[0]) {
             if (out_delayed->visible && !out_delayed->flushed)
@@ -2694,43 +3506,41 @@ int submit_frame(Dav1dContext *const c) {
     } else {
         f = c->fc;
     }
+    // frames only wait for those decoded before them, so that's the order
+    // their tasks are served in, whichever frame thread submits first
+    if (f->n_tc > 1) {
+        // dav1d_frame_thread_wait_idle() takes ttd->lock before td.lock, so
+        // ours is not held meanwhile; the idle frame thread only wakes up
+        // once we set n_tile_data
+        if (c->n_fc > 1) pthread_mutex_unlock(&f->frame_thread.td.lock);
+        dav1d_tile_task_seq(f);
+        if (c->n_fc > 1) pthread_mutex_lock(&f->frame_thread.td.lock);
+    }
 
     f->seq_hdr = c->seq_hdr;
     f->frame_hdr = c->frame_hdr;
-    const int bd_idx = (f->seq_hdr.bpc - 8) >> 1;
-    f->dsp = &c->dsp[bd_idx];
-
-    if (!f->dsp->ipred.intra_pred[TX_4X4][DC_PRED]) {
-        Dav1dDSPContext *const dsp = &c->dsp[bd_idx];
-
-        switch (f->seq_hdr.bpc) {
-#define assign_bitdepth_case(bd) \
-        case bd: \
-            dav1d_cdef_dsp_init_##bd##bpc(&dsp->cdef); \
-            dav1d_intra_pred_dsp_init_##bd##bpc(&dsp->ipred); \
-            dav1d_itx_dsp_init_##bd##bpc(&dsp->itx); \
-            dav1d_loop_filter_dsp_init_##bd##bpc(&dsp->lf); \
-            dav1d_loop_restoration_dsp_init_##bd##bpc(&dsp->lr); \
-            dav1d_mc_dsp_init_##bd##bpc(&dsp->mc); \
-            break
+    switch (f->seq_hdr.bpc) {
 #if CONFIG_8BPC
-        assign_bitdepth_case(8);
+    case 8:
 #endif
 #if CONFIG_10BPC
-        assign_bitdepth_case(10);
+    case 10:
 #endif
-#undef assign_bitdepth_case
-        default:
-            fprintf(stderr, "Compiled without support for %d-bit decoding\n",
-                    f->seq_hdr.bpc);
-            return -ENOPROTOOPT;
-        }
+        break;
+    default:
+        dav1d_log(c, "Compiled without support for %d-bit decoding\n",
+                  f->seq_hdr.bpc);
+        return -ENOPROTOOPT;
     }
+    f->dsp = &c->dsp[(f->seq_hdr.bpc - 8) >> 1];
 
 #define assign_bitdepth_case(bd) \
         f->bd_fn.recon_b_inter = recon_b_inter_##bd##bpc; \
         f->bd_fn.recon_b_intra = recon_b_intra_##bd##bpc; \
         f->bd_fn.filter_sbrow = filter_sbrow_##bd##bpc; \
+        f->bd_fn.filter_sbrow_deblock = filter_sbrow_deblock_##bd##bpc; \
+        f->bd_fn.filter_sbrow_cdef = filter_sbrow_cdef_##bd##bpc; \
+        f->bd_fn.filter_sbrow_lr = filter_sbrow_lr_##bd##bpc; \
         f->bd_fn.backup_ipred_edge = backup_ipred_edge_##bd##bpc; \
         f->bd_fn.read_coef_blocks = read_coef_blocks_##bd##bpc
     if (f->seq_hdr.bpc <= 8) {
@@ -2757,20 +3567,26 @@ int submit_frame(Dav1dContext *const c) {
         const int pri_ref = f->frame_hdr.refidx[f->frame_hdr.primary_ref_frame];
         cdf_thread_ref(&f->in_cdf, &c->cdf[pri_ref]);
     }
-    if (f->frame_hdr.refresh_context) {
+    // the output context is only filled in once the input context is
+    // final and the update tile has been parsed, see publish_out_cdf()
+    if (f->frame_hdr.refresh_context)
         cdf_thread_alloc(&f->out_cdf, c->n_fc > 1 ? &f->frame_thread.td : NULL);
-        memcpy(f->out_cdf.cdf, f->in_cdf.cdf, sizeof(*f->in_cdf.cdf));
-    }
 
     // FIXME qsort so tiles are in order (for frame threading)
     memcpy(f->tile, c->tile, c->n_tile_data * sizeof(*f->tile));
     f->n_tile_data = c->n_tile_data;
+    f->tile_data_done = c->n_fc == 1;
     c->n_tile_data = 0;
 
     // allocate frame
-    if ((res = dav1d_thread_picture_alloc(&f->cur, f->frame_hdr.width,
+    if ((res = dav1d_thread_picture_alloc(c, &f->cur, f->frame_hdr.width,
                                           f->frame_hdr.height,
-                                          f->seq_hdr.layout, f->seq_hdr.bpc,
+                                          f->seq_hdr.layout,
+                                          DAV1D_OUTPUTFORMAT_PLANAR,
+                                          f->seq_hdr.bpc,
+                                          c->low_memory && !f->seq_hdr.sb128 ?
+                                              64 : 128,
+                                          &c->allocator, c->picture_pool,
                                           c->n_fc > 1 ? &f->frame_thread.td : NULL,
                                           f->frame_hdr.show_frame)) < 0)
     {
@@ -2784,13 +3600,47 @@ int submit_frame(Dav1dContext *const c) {
     f->cur.p.p.mtrx = f->seq_hdr.mtrx;
     f->cur.p.p.chr = f->seq_hdr.chr;
     f->cur.p.p.fullrange = f->seq_hdr.color_range;
+    f->cur.p.film_grain_present = f->frame_hdr.film_grain.present;
+    f->cur.p.film_grain = f->frame_hdr.film_grain.data;
+    set_decode_region(f);
+    if (c->export_block_info) {
+        const int stride = (f->frame_hdr.width + 7) >> 3;
+        const int h8 = (f->frame_hdr.height + 7) >> 3;
+        Dav1dRef *const ref =
+            dav1d_ref_create_using_pool(c->block_info_pool, stride * h8 *
+                                        sizeof(*f->cur.p.block_info));
+        if (!ref) {
+            dav1d_thread_picture_unref(&f->cur);
+            return -ENOMEM;
+        }
+        f->cur.p.block_info_ref = ref;
+        f->cur.p.block_info = ref->data;
+        f->cur.p.block_info_stride = stride;
+    }
+    f->filters = f->frame_hdr.refresh_frame_flags ? DAV1D_NONREFFILTERS_ALL :
+                                                    c->nonref_filters;
+    f->post_filter.active = 0;
+    if (c->post_filter.filter_sbrow && f->filters == DAV1D_NONREFFILTERS_ALL) {
+        // only frames which have some CDEF or LR to apply
+        for (int n = 0; n < 1 << f->frame_hdr.cdef.n_bits; n++)
+            f->post_filter.active |= f->frame_hdr.cdef.y_strength[n] |
+                                     f->frame_hdr.cdef.uv_strength[n];
+        for (int pl = 0; pl < 3; pl++)
+            f->post_filter.active |=
+                f->frame_hdr.restoration.type[pl] != RESTORATION_NONE;
+        f->post_filter.active = !!f->post_filter.active;
+    }
+    memset(f->post_filter.lr_rows, 0, sizeof(f->post_filter.lr_rows));
 
     // move f->cur into output queue
     if (c->n_fc == 1) {
         if (f->frame_hdr.show_frame)
             dav1d_picture_ref(&c->out, &f->cur.p);
     } else {
+        // a picture_ready callback may be emptying the queue concurrently
+        pthread_mutex_lock(&c->picture_ready.lock);
         dav1d_thread_picture_ref(out_delayed, &f->cur);
+        pthread_mutex_unlock(&c->picture_ready.lock);
     }
 
     f->bw = ((f->frame_hdr.width + 7) >> 3) << 1;
@@ -2804,8 +3654,9 @@ int submit_frame(Dav1dContext *const c) {
 
     // ref_mvs
     if ((f->frame_hdr.frame_type & 1) || f->frame_hdr.allow_intrabc) {
-        f->mvs_ref = dav1d_ref_create(f->sb128h * 32 * f->b4_stride *
-                                      sizeof(*f->mvs));
+        f->mvs_ref = dav1d_ref_create_using_pool(c->refmvs_pool,
+                                                 f->sb128h * 32 * f->b4_stride *
+                                                 sizeof(*f->mvs));
         f->mvs = f->mvs_ref->data;
         if (f->frame_hdr.use_ref_frame_mvs) {
             for (int i = 0; i < 7; i++) {
@@ -2835,30 +3686,37 @@ int submit_frame(Dav1dContext *const c) {
 
     // segmap
     if (f->frame_hdr.segmentation.enabled) {
-        if (f->frame_hdr.segmentation.temporal) {
+        // the map of the primary reference frame predicts this frame's
+        // (temporal), or is this frame's if not updated, in which case the
+        // frame shares it rather than copying it; no map means all zeroes
+        // (e.g. for references without segmentation)
+        f->prev_segmap_ref = NULL;
+        f->prev_segmap = NULL;
+        if (f->frame_hdr.segmentation.temporal ||
+            !f->frame_hdr.segmentation.update_map)
+        {
             const int pri_ref = f->frame_hdr.primary_ref_frame;
             assert(pri_ref != PRIMARY_REF_NONE);
             const int ref_w = (f->refp[pri_ref].p.p.w + 3) >> 2;
             const int ref_h = (f->refp[pri_ref].p.p.h + 3) >> 2;
-            if (ref_w == f->bw && ref_h == f->bh) {
-                f->prev_segmap_ref = c->refs[f->frame_hdr.refidx[pri_ref]].segmap;
+            Dav1dRef *const segmap = c->refs[f->frame_hdr.refidx[pri_ref]].segmap;
+            if (segmap && ref_w == f->bw && ref_h == f->bh) {
+                f->prev_segmap_ref = segmap;
                 dav1d_ref_inc(f->prev_segmap_ref);
                 f->prev_segmap = f->prev_segmap_ref->data;
-            } else {
-                f->prev_segmap_ref = NULL;
-                f->prev_segmap = NULL;
             }
-        } else {
-            f->prev_segmap_ref = NULL;
-            f->prev_segmap = NULL;
         }
         if (f->frame_hdr.segmentation.update_map) {
-            f->cur_segmap_ref = dav1d_ref_create(f->b4_stride * 32 * f->sb128h);
+            f->cur_segmap_ref = dav1d_ref_create_using_pool(c->segmap_pool,
+                                                            f->b4_stride * 32 * f->sb128h);
             f->cur_segmap = f->cur_segmap_ref->data;
-        } else {
+        } else if (f->prev_segmap_ref) {
             f->cur_segmap_ref = f->prev_segmap_ref;
             dav1d_ref_inc(f->cur_segmap_ref);
             f->cur_segmap = f->prev_segmap_ref->data;
+        } else {
+            f->cur_segmap_ref = NULL;
+            f->cur_segmap = NULL;
         }
     } else {
         f->cur_segmap = NULL;
@@ -2867,6 +3725,7 @@ int submit_frame(Dav1dContext *const c) {
     }
 
     // update references etc.
+    c->skipped_refs &= ~f->frame_hdr.refresh_frame_flags;
     for (int i = 0; i < 8; i++) {
         if (f->frame_hdr.refresh_frame_flags & (1 << i)) {
             if (c->refs[i].p.p.data[0])
@@ -2904,12 +3763,40 @@ int submit_frame(Dav1dContext *const c) {
     }
 
     if (c->n_fc == 1) {
-        if ((res = decode_frame(f)) < 0)
+        dav1d_trace(f, 0, DAV1D_TRACE_FRAME, 0, -1);
+        res = decode_frame(f);
+        dav1d_trace(f, 0, DAV1D_TRACE_FRAME, 1, -1);
+        if (res < 0)
             return res;
+        if (c->frame_stats && f->frame_hdr.show_frame)
+            c->out.stats = f->stats.out;
     } else {
+        c->frame_thread.tile_f = f;
         pthread_cond_signal(&f->frame_thread.td.cond);
         pthread_mutex_unlock(&f->frame_thread.td.lock);
     }
 
     return 0;
 }
+
+void dav1d_submit_tile_data(Dav1dContext *const c, const int done) {
+    Dav1dFrameContext *const f = c->frame_thread.tile_f;
+
+    if (!f) {
+        // submit_frame() failed
+        for (int n = 0; n < c->n_tile_data; n++)
+            dav1d_data_unref(&c->tile[n].data);
+        c->n_tile_data = 0;
+        return;
+    }
+
+    pthread_mutex_lock(&f->frame_thread.td.lock);
+    memcpy(&f->tile[f->n_tile_data], c->tile,
+           c->n_tile_data * sizeof(*f->tile));
+    f->n_tile_data += c->n_tile_data;
+    f->tile_data_done = done;
+    pthread_cond_broadcast(&f->frame_thread.td.cond);
+    pthread_mutex_unlock(&f->frame_thread.td.lock);
+    c->n_tile_data = 0;
+    if (done) c->frame_thread.tile_f = NULL;
+}
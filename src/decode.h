@@ -30,6 +30,36 @@
 
 #include "src/internal.h"
 
+// The DSP function tables of all bitdepths for the CPU flags currently in
+// use (see dav1d_set_cpu_flags_mask()), or NULL if out of memory.
+const Dav1dDSPContext *dav1d_get_dsp_tables(void);
+
 int submit_frame(Dav1dContext *c);
+// With frame threading, hands the tile groups received after the first one
+// (with which submit_frame() was called) to c->frame_thread.tile_f, which
+// decodes them as they arrive; done is set with the last one, or to cut the
+// frame short, its missing tiles being skipped.
+void dav1d_submit_tile_data(Dav1dContext *c, int done);
+
+// Passes sbrow sby, deblocked, to c->post_filter instead of running the CDEF
+// and LR stages on it, if f->post_filter.active.
+void dav1d_post_filter_sbrow(Dav1dFrameContext *f, int sby);
+// The luma rows of the picture that are done once the post-filter of sbrow
+// sby is: all of them, but for those the post_filter callback still has to
+// finish.
+int dav1d_post_filter_progress(const Dav1dFrameContext *f, int sby);
+
+// Marks the picture in output queue slot as decoded (unless slot < 0), and
+// passes the decoded ones at the head of the queue to the picture_ready
+// callback.
+void dav1d_picture_ready(const Dav1dContext *c, PictureReadyQueue *q,
+                         int slot);
+
+// Sets out to in as it is output: with its film grain synthesized, if it
+// has any and c->apply_grain is set, and in c->output_format, in a newly
+// allocated picture if either changes it; else to a reference to in.
+// Returns 0 or a negative errno value.
+int dav1d_output_image(const Dav1dContext *c, Dav1dPicture *out,
+                       const Dav1dPicture *in);
 
 #endif /* __DAV1D_SRC_DECODE_H__ */
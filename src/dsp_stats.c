@@ -0,0 +1,171 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "config.h"
+
+#if CONFIG_DSP_STATS
+
+#include <stdlib.h>
+
+#include "src/dsp_stats.h"
+#include "src/internal.h"
+#include "src/log.h"
+#include "src/tables.h"
+
+static const char *const filter_names[N_2D_FILTERS] = {
+    [FILTER_2D_8TAP_REGULAR]        = "8tap_regular",
+    [FILTER_2D_8TAP_REGULAR_SMOOTH] = "8tap_regular_smooth",
+    [FILTER_2D_8TAP_REGULAR_SHARP]  = "8tap_regular_sharp",
+    [FILTER_2D_8TAP_SHARP_REGULAR]  = "8tap_sharp_regular",
+    [FILTER_2D_8TAP_SHARP_SMOOTH]   = "8tap_sharp_smooth",
+    [FILTER_2D_8TAP_SHARP]          = "8tap_sharp",
+    [FILTER_2D_8TAP_SMOOTH_REGULAR] = "8tap_smooth_regular",
+    [FILTER_2D_8TAP_SMOOTH]         = "8tap_smooth",
+    [FILTER_2D_8TAP_SMOOTH_SHARP]   = "8tap_smooth_sharp",
+    [FILTER_2D_BILINEAR]            = "bilinear",
+};
+
+// named like the itxfm_add[] functions, i.e. horizontal then vertical
+static const char *const txtp_names[N_TX_TYPES_PLUS_LL] = {
+    [DCT_DCT]           = "dct_dct",
+    [ADST_DCT]          = "dct_adst",
+    [DCT_ADST]          = "adst_dct",
+    [ADST_ADST]         = "adst_adst",
+    [FLIPADST_DCT]      = "dct_flipadst",
+    [DCT_FLIPADST]      = "flipadst_dct",
+    [FLIPADST_FLIPADST] = "flipadst_flipadst",
+    [ADST_FLIPADST]     = "flipadst_adst",
+    [FLIPADST_ADST]     = "adst_flipadst",
+    [IDTX]              = "identity_identity",
+    [V_DCT]             = "identity_dct",
+    [H_DCT]             = "dct_identity",
+    [V_ADST]            = "identity_adst",
+    [H_ADST]            = "adst_identity",
+    [V_FLIPADST]        = "identity_flipadst",
+    [H_FLIPADST]        = "flipadst_identity",
+    [WHT_WHT]           = "wht_wht",
+};
+
+// intra_pred[] is indexed by the modes implemented by the DSP functions,
+// which reuse some of the values of enum IntraPredMode
+static const char *const ipred_names[N_IMPL_INTRA_PRED_MODES] = {
+    [DC_PRED]       = "dc",
+    [DC_128_PRED]   = "dc_128",
+    [TOP_DC_PRED]   = "dc_top",
+    [LEFT_DC_PRED]  = "dc_left",
+    [HOR_PRED]      = "h",
+    [VERT_PRED]     = "v",
+    [PAETH_PRED]    = "paeth",
+    [SMOOTH_PRED]   = "smooth",
+    [SMOOTH_V_PRED] = "smooth_v",
+    [SMOOTH_H_PRED] = "smooth_h",
+    [Z1_PRED]       = "z1",
+    [Z2_PRED]       = "z2",
+    [Z3_PRED]       = "z3",
+    [FILTER_PRED]   = "filter",
+};
+
+typedef struct Entry {
+    uint64_t calls;
+    const char *name;
+    int w, h;
+} Entry;
+
+static int cmp_entries(const void *const a, const void *const b) {
+    const uint64_t ca = ((const Entry *) a)->calls;
+    const uint64_t cb = ((const Entry *) b)->calls;
+    return (ca < cb) - (ca > cb);
+}
+
+static void log_entries(const Dav1dContext *const c, const char *const fn,
+                        Entry *const entries, const int n)
+{
+    uint64_t total = 0;
+    for (int i = 0; i < n; i++)
+        total += entries[i].calls;
+    if (!total) return;
+
+    qsort(entries, n, sizeof(*entries), cmp_entries);
+    dav1d_log(c, "%s: %llu calls\n", fn, (unsigned long long) total);
+    for (int i = 0; i < n && entries[i].calls; i++)
+        dav1d_log(c, "  %s_%dx%d: %llu (%.2f%%)\n", entries[i].name,
+                  entries[i].w, entries[i].h,
+                  (unsigned long long) entries[i].calls,
+                  100.0 * entries[i].calls / total);
+}
+
+void dav1d_dsp_stats_add(DspStats *const dst, const DspStats *const src) {
+    uint64_t *const d = (uint64_t *) dst;
+    const uint64_t *const s = (const uint64_t *) src;
+
+    for (size_t i = 0; i < sizeof(*dst) / sizeof(*d); i++)
+        d[i] += s[i];
+}
+
+void dav1d_dsp_stats_log(const Dav1dContext *const c,
+                         const DspStats *const stats)
+{
+    Entry entries[N_2D_FILTERS * 7 * 7];
+    int n;
+
+    for (int fn = 0; fn < 2; fn++) {
+        n = 0;
+        for (int filter = 0; filter < N_2D_FILTERS; filter++)
+            for (int w = 0; w < 7; w++)
+                for (int h = 0; h < 7; h++)
+                    entries[n++] = (Entry) {
+                        .calls = (fn ? stats->mct : stats->mc)[filter][w][h],
+                        .name = filter_names[filter],
+                        .w = 2 << w, .h = 2 << h,
+                    };
+        log_entries(c, fn ? "mct" : "mc", entries, n);
+    }
+
+    n = 0;
+    for (int tx = 0; tx < N_RECT_TX_SIZES; tx++)
+        for (int txtp = 0; txtp < N_TX_TYPES_PLUS_LL; txtp++)
+            entries[n++] = (Entry) {
+                .calls = stats->itx[tx][txtp],
+                .name = txtp_names[txtp],
+                .w = av1_txfm_dimensions[tx].w * 4,
+                .h = av1_txfm_dimensions[tx].h * 4,
+            };
+    log_entries(c, "itx", entries, n);
+
+    n = 0;
+    for (int tx = 0; tx < N_RECT_TX_SIZES; tx++)
+        for (int mode = 0; mode < N_IMPL_INTRA_PRED_MODES; mode++)
+            entries[n++] = (Entry) {
+                .calls = stats->ipred[tx][mode],
+                .name = ipred_names[mode],
+                .w = av1_txfm_dimensions[tx].w * 4,
+                .h = av1_txfm_dimensions[tx].h * 4,
+            };
+    log_entries(c, "ipred", entries, n);
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __DAV1D_SRC_DSP_STATS_H__
+#define __DAV1D_SRC_DSP_STATS_H__
+
+// Calls of the DSP functions per kernel and block size, if built with
+// CONFIG_DSP_STATS, to find out which ones matter most for real streams:
+// each tile context counts the calls made with it, and dav1d_close() logs
+// the sums, most frequent first.
+
+#if CONFIG_DSP_STATS
+
+#include <stdint.h>
+
+#include "dav1d/dav1d.h"
+
+#include "common/intops.h"
+
+#include "src/levels.h"
+
+typedef struct DspStats {
+    // [filter][log2(w) - 1][log2(h) - 1], for blocks of 2x2 to 128x128
+    uint64_t mc[N_2D_FILTERS][7][7];
+    uint64_t mct[N_2D_FILTERS][7][7];
+    uint64_t itx[N_RECT_TX_SIZES][N_TX_TYPES_PLUS_LL];
+    uint64_t ipred[N_RECT_TX_SIZES][N_IMPL_INTRA_PRED_MODES];
+} DspStats;
+
+#define DSP_STATS_MC(t, fn, filter, w, h) \
+    ((t)->dsp_stats.fn[filter][ulog2(w) - 1][ulog2(h) - 1]++)
+#define DSP_STATS_ITX(t, tx, txtp) ((t)->dsp_stats.itx[tx][txtp]++)
+#define DSP_STATS_IPRED(t, tx, mode) ((t)->dsp_stats.ipred[tx][mode]++)
+
+void dav1d_dsp_stats_add(DspStats *dst, const DspStats *src);
+
+void dav1d_dsp_stats_log(const Dav1dContext *c, const DspStats *stats);
+
+#else
+
+#define DSP_STATS_MC(t, fn, filter, w, h) do { } while (0)
+#define DSP_STATS_ITX(t, tx, txtp) do { } while (0)
+#define DSP_STATS_IPRED(t, tx, mode) do { } while (0)
+
+#endif
+
+#endif /* __DAV1D_SRC_DSP_STATS_H__ */
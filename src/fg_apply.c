@@ -0,0 +1,165 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "common/attributes.h"
+#include "common/bitdepth.h"
+#include "common/intops.h"
+
+#include "src/fg_apply.h"
+
+// Piecewise linear interpolation of the scaling function over all pixel
+// values, from up to 14 points of 8-bit value and scaling (none means no
+// grain at all).
+static void generate_scaling(const uint8_t points[][2], const int num,
+                             uint8_t scaling[SCALING_SIZE])
+{
+    const int shift_x = BITDEPTH - 8;
+    const int scaling_size = 1 << BITDEPTH;
+
+    if (!num) {
+        memset(scaling, 0, scaling_size);
+        return;
+    }
+
+    // fill up the preceding entries with the initial value
+    memset(scaling, points[0][1], points[0][0] << shift_x);
+
+    // linearly interpolate the values in the middle
+    for (int i = 0; i < num - 1; i++) {
+        const int bx = points[i][0];
+        const int by = points[i][1];
+        const int ex = points[i + 1][0];
+        const int ey = points[i + 1][1];
+        const int dx = ex - bx;
+        const int dy = ey - by;
+        const int delta = dy * ((0x10000 + (dx >> 1)) / dx);
+        for (int x = 0, d = 0x8000; x < dx; x++) {
+            scaling[(bx + x) << shift_x] = by + (d >> 16);
+            d += delta;
+        }
+    }
+
+    // fill up the remaining entries with the final value
+    const int n = points[num - 1][0] << shift_x;
+    memset(&scaling[n], points[num - 1][1], scaling_size - n);
+
+#if BITDEPTH != 8
+    // interpolate the entries between the 8-bit ones
+    const int pad = 1 << shift_x, rnd = pad >> 1;
+    for (int i = 0; i < num - 1; i++) {
+        const int bx = points[i][0] << shift_x;
+        const int ex = points[i + 1][0] << shift_x;
+        const int dx = ex - bx;
+        for (int x = 0; x < dx; x += pad) {
+            const int range = scaling[bx + x + pad] - scaling[bx + x];
+            for (int n = 1, r = rnd; n < pad; n++) {
+                r += range;
+                scaling[bx + x + n] = scaling[bx + x] + (r >> shift_x);
+            }
+        }
+    }
+#endif
+}
+
+void bitfn(dav1d_apply_grain)(const Dav1dFilmGrainDSPContext *const dsp,
+                              Dav1dPicture *const out,
+                              const Dav1dPicture *const in)
+{
+    const Dav1dFilmGrainData *const data = &in->film_grain;
+
+    ALIGN_STK_16(int16_t, grain_lut, 3,[GRAIN_HEIGHT + 1][GRAIN_WIDTH]);
+    uint8_t scaling[3][SCALING_SIZE];
+
+    // generate the grain templates and scaling functions as needed
+    if (data->num_y_points)
+        dsp->generate_grain_y(grain_lut[0], data);
+    if (data->num_y_points || data->chroma_scaling_from_luma)
+        generate_scaling(data->y_points, data->num_y_points, scaling[0]);
+    for (int uv = 0; uv < 2; uv++) {
+        if (data->num_uv_points[uv] || data->chroma_scaling_from_luma)
+            dsp->generate_grain_uv[in->p.layout - 1](grain_lut[1 + uv],
+                                                     grain_lut[0], data, uv);
+        if (data->num_uv_points[uv])
+            generate_scaling(data->uv_points[uv], data->num_uv_points[uv],
+                             scaling[1 + uv]);
+    }
+
+    const int w = out->p.w, h = out->p.h;
+    const int ss_ver = in->p.layout == DAV1D_PIXEL_LAYOUT_I420;
+    const int ss_hor = in->p.layout != DAV1D_PIXEL_LAYOUT_I444;
+    const int cpw = (w + ss_hor) >> ss_hor, cph = (h + ss_ver) >> ss_ver;
+    const int is_id = in->p.mtrx == DAV1D_MC_IDENTITY;
+
+    // copy over the planes without grain
+    if (!data->num_y_points) {
+        for (int y = 0; y < h; y++)
+            pixel_copy((pixel *) out->data[0] + y * PXSTRIDE(out->stride[0]),
+                       (const pixel *) in->data[0] + y * PXSTRIDE(in->stride[0]),
+                       w);
+    }
+    for (int uv = 0; uv < 2 && in->p.layout != DAV1D_PIXEL_LAYOUT_I400; uv++) {
+        if (data->num_uv_points[uv] || data->chroma_scaling_from_luma) continue;
+        for (int y = 0; y < cph; y++)
+            pixel_copy((pixel *) out->data[1 + uv] + y * PXSTRIDE(out->stride[1]),
+                       (const pixel *) in->data[1 + uv] + y * PXSTRIDE(in->stride[1]),
+                       cpw);
+    }
+
+    // synthesize the grain, in rows of 32x32 blocks
+    for (int row = 0; row * FG_BLOCK_SIZE < h; row++) {
+        const int bh = imin(h - row * FG_BLOCK_SIZE, FG_BLOCK_SIZE);
+        const ptrdiff_t luma_off = row * FG_BLOCK_SIZE * PXSTRIDE(in->stride[0]);
+        const pixel *const luma_src = (const pixel *) in->data[0] + luma_off;
+
+        if (data->num_y_points)
+            dsp->fgy_32x32xn((pixel *) out->data[0] +
+                                 row * FG_BLOCK_SIZE * PXSTRIDE(out->stride[0]),
+                             out->stride[0], luma_src, in->stride[0], data, w,
+                             scaling[0], grain_lut[0], bh, row);
+
+        if (in->p.layout == DAV1D_PIXEL_LAYOUT_I400) continue;
+
+        const int cbh = (bh + ss_ver) >> ss_ver;
+        const ptrdiff_t in_off =
+            ((row * FG_BLOCK_SIZE) >> ss_ver) * PXSTRIDE(in->stride[1]);
+        const ptrdiff_t out_off =
+            ((row * FG_BLOCK_SIZE) >> ss_ver) * PXSTRIDE(out->stride[1]);
+        for (int uv = 0; uv < 2; uv++) {
+            if (!data->num_uv_points[uv] && !data->chroma_scaling_from_luma)
+                continue;
+            dsp->fguv_32x32xn[in->p.layout - 1](
+                (pixel *) out->data[1 + uv] + out_off, out->stride[1],
+                (const pixel *) in->data[1 + uv] + in_off, in->stride[1],
+                data, cpw, scaling[data->chroma_scaling_from_luma ? 0 : 1 + uv],
+                grain_lut[1 + uv], cbh, row, luma_src, in->stride[0], w, uv,
+                is_id);
+        }
+    }
+}
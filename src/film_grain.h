@@ -0,0 +1,94 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DAV1D_SRC_FILM_GRAIN_H__
+#define __DAV1D_SRC_FILM_GRAIN_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common/bitdepth.h"
+
+#include "dav1d/picture.h"
+
+// The grain templates are generated at 82x73 (luma) or 44x38 (subsampled
+// chroma), of which blocks of 32x32 (luma) pixels plus overlap are picked
+// at random offsets. Grain values are stored in 16 bits for all bitdepths.
+#define GRAIN_WIDTH 82
+#define GRAIN_HEIGHT 73
+#define SUB_GRAIN_WIDTH 44
+#define SUB_GRAIN_HEIGHT 38
+#define FG_BLOCK_SIZE 32
+// scaling lookup tables are indexed by pixel value
+#define SCALING_SIZE 1024
+
+#define decl_generate_grain_y_fn(name) \
+void (name)(int16_t buf[][GRAIN_WIDTH], const Dav1dFilmGrainData *data)
+typedef decl_generate_grain_y_fn(*generate_grain_y_fn);
+
+// buf_y is the luma template, for the auto-regressive filter; uv is 0 for
+// U, 1 for V
+#define decl_generate_grain_uv_fn(name) \
+void (name)(int16_t buf[][GRAIN_WIDTH], \
+            const int16_t buf_y[][GRAIN_WIDTH], \
+            const Dav1dFilmGrainData *data, int uv)
+typedef decl_generate_grain_uv_fn(*generate_grain_uv_fn);
+
+// Applies grain to one row of 32x32 luma blocks (row_num, of bh <= 32 pixel
+// rows) of width pw, reading from src and writing to dst.
+#define decl_fgy_32x32xn_fn(name) \
+void (name)(pixel *dst_row, ptrdiff_t dst_stride, \
+            const pixel *src_row, ptrdiff_t src_stride, \
+            const Dav1dFilmGrainData *data, int pw, \
+            const uint8_t scaling[SCALING_SIZE], \
+            const int16_t grain_lut[][GRAIN_WIDTH], int bh, int row_num)
+typedef decl_fgy_32x32xn_fn(*fgy_32x32xn_fn);
+
+// Same for a chroma plane (pw and bh are subsampled), with the grain
+// scaled according to the (co-located, not yet grained) luma_row pixels of
+// a picture lw pixels wide; is_id is set for the identity matrix, which
+// changes the clipping range.
+#define decl_fguv_32x32xn_fn(name) \
+void (name)(pixel *dst_row, ptrdiff_t dst_stride, \
+            const pixel *src_row, ptrdiff_t src_stride, \
+            const Dav1dFilmGrainData *data, int pw, \
+            const uint8_t scaling[SCALING_SIZE], \
+            const int16_t grain_lut[][GRAIN_WIDTH], int bh, int row_num, \
+            const pixel *luma_row, ptrdiff_t luma_stride, int lw, \
+            int uv, int is_id)
+typedef decl_fguv_32x32xn_fn(*fguv_32x32xn_fn);
+
+typedef struct Dav1dFilmGrainDSPContext {
+    generate_grain_y_fn generate_grain_y;
+    generate_grain_uv_fn generate_grain_uv[3 /* 420, 422, 444 */];
+    fgy_32x32xn_fn fgy_32x32xn;
+    fguv_32x32xn_fn fguv_32x32xn[3 /* 420, 422, 444 */];
+} Dav1dFilmGrainDSPContext;
+
+void dav1d_film_grain_dsp_init_8bpc(Dav1dFilmGrainDSPContext *c);
+void dav1d_film_grain_dsp_init_10bpc(Dav1dFilmGrainDSPContext *c);
+
+#endif /* __DAV1D_SRC_FILM_GRAIN_H__ */
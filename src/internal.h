@@ -31,6 +31,7 @@
 #include <stdatomic.h>
 
 #include "dav1d/data.h"
+#include "dav1d/dav1d.h"
 
 typedef struct Dav1dFrameContext Dav1dFrameContext;
 typedef struct Dav1dTileState Dav1dTileState;
@@ -40,7 +41,9 @@ typedef struct Dav1dTileContext Dav1dTileContext;
 
 #include "src/cdef.h"
 #include "src/cdf.h"
+#include "src/dsp_stats.h"
 #include "src/env.h"
+#include "src/film_grain.h"
 #include "src/intra_edge.h"
 #include "src/ipred.h"
 #include "src/itx.h"
@@ -51,9 +54,11 @@ typedef struct Dav1dTileContext Dav1dTileContext;
 #include "src/mc.h"
 #include "src/msac.h"
 #include "src/picture.h"
+#include "src/pixfmt.h"
 #include "src/recon.h"
 #include "src/ref_mvs.h"
 #include "src/thread.h"
+#include "src/thread_data.h"
 
 typedef struct Dav1dDSPContext {
     Dav1dIntraPredDSPContext ipred;
@@ -62,8 +67,72 @@ typedef struct Dav1dDSPContext {
     Dav1dLoopFilterDSPContext lf;
     Dav1dCdefDSPContext cdef;
     Dav1dLoopRestorationDSPContext lr;
+    Dav1dFilmGrainDSPContext fg;
+    Dav1dPixFmtDSPContext pixfmt;
 } Dav1dDSPContext;
 
+struct Dav1dThreadPool {
+    Dav1dTileContext *tc;
+    int n_tc; // if 1, there are no worker threads, and frames are decoded inline
+    // written by all workers: on cache lines apart from the fields above,
+    // which they only read
+    struct TaskThreadData {
+        ALIGN(pthread_mutex_t lock, 64);
+        pthread_cond_t cond;
+        // signalled on wavefront progress, if wf_waiting threads wait for it
+        pthread_cond_t wf_cond;
+        int wf_waiting;
+        // frame contexts with tasks that haven't been picked up yet, in
+        // decode order (across all decoder instances using the pool)
+        Dav1dFrameContext *first;
+        unsigned seq; // decode order counter
+        int die;
+    } ttd;
+};
+
+// Output of the picture_ready callback with frame threading: the output
+// queue (c->frame_thread.out_delayed) is emptied in order by whichever
+// frame thread finishes the picture at its head, or a later picture once
+// that one is finished, rather than by the application thread.
+typedef struct PictureReadyQueue {
+    void (*callback)(Dav1dPicture *pic, void *cookie);
+    void *cookie;
+    pthread_mutex_t lock; // protects the fields below, and the queue slots
+    Dav1dThreadPicture *slots;
+    uint8_t *finished; // per slot, set once its picture is decoded
+    int n_slots;
+    int head; // slot of the oldest picture not handed out yet
+} PictureReadyQueue;
+
+// Bytes held by the frame contexts, per Dav1dMemoryCategory; the pools and
+// tile contexts are accounted for separately.
+typedef struct MemoryUsage {
+    pthread_mutex_t lock;
+    size_t cur[DAV1D_MEM_NUM_CATEGORIES], peak[DAV1D_MEM_NUM_CATEGORIES];
+} MemoryUsage;
+
+// Waits that blocked, per Dav1dWaitType; only updated once a thread is done
+// waiting anyway, so a lock costs no extra contention.
+typedef struct WaitStats {
+    pthread_mutex_t lock;
+    uint64_t count[DAV1D_WAIT_NUM_TYPES], nanos[DAV1D_WAIT_NUM_TYPES];
+} WaitStats;
+
+// Positions in the streams of coded blocks, palette indices and coefficients
+// that pass 1 of 2-pass decoding writes and pass 2 reads, in decoding order.
+typedef struct FrameThreadPos {
+    Av1Block *b;
+    uint8_t *pal_idx;
+    coef *cf;
+} FrameThreadPos;
+
+// Superblocks of a tile sbrow reconstructed so far, in wavefront
+// reconstruction; the sbrows next to each other (and the tiles) are
+// reconstructed by different threads, so each has a cache line of its own.
+typedef struct SbProgress {
+    ALIGN(atomic_int sbs, 64);
+} SbProgress;
+
 struct Dav1dContext {
     Dav1dFrameContext *fc;
     int n_fc;
@@ -76,16 +145,73 @@ struct Dav1dContext {
     } tile[256];
     int n_tile_data, have_seq_hdr, have_frame_hdr;
     unsigned tile_mask;
+    enum Dav1dDecodeFrameType decode_frame_type;
+    int operating_point;
+    unsigned operating_point_idc; // layers included; 0 = all
+    Dav1dRect decode_region; // w or h = 0: all tiles
+    int apply_grain;
+    Dav1dPostFilter post_filter;
+    enum Dav1dNonRefFilters nonref_filters;
+    int frame_stats;
+    int export_block_info;
+    enum Dav1dOutputFormat output_format;
+    struct {
+        void (*callback)(const Dav1dTraceEvent *ev, void *cookie);
+        void *cookie;
+    } trace;
+    struct {
+        void (*callback)(void *cookie, const char *format, va_list ap);
+        void *cookie;
+    } logger;
+#if CONFIG_PROFILING
+    // of the application thread, and of the threads that dav1d_set_threads()
+    // (or dav1d_close()) stopped
+    Dav1dProfile prof;
+#endif
+#if CONFIG_DSP_STATS
+    DspStats dsp_stats; // of the tile contexts freed so far
+#endif
+    // refs[] slots that skipped frames (see decode_frame_type) should have
+    // refreshed, or that dav1d_flush() emptied; these keep their earlier
+    // picture, if any, which is not shown again
+    unsigned skipped_refs;
     Av1SequenceHeader seq_hdr; // FIXME make ref?
     Av1FrameHeader frame_hdr; // FIXME make ref?
 
+    // input of dav1d_send_data(): one queued buffer, handed over (under
+    // lock) to dav1d_get_picture(), which parses it from data; drain is set
+    // by dav1d_send_data(NULL), and cleared when new data is sent
+    struct {
+        pthread_mutex_t lock;
+        Dav1dData queued;
+        int drain;
+        Dav1dData data;
+    } input;
+
     // decoded output picture queue
     Dav1dPicture out;
+    PictureReadyQueue picture_ready;
     struct {
         Dav1dThreadPicture *out_delayed;
         unsigned next;
+        int low_latency; // output pictures as soon as they are decoded
+        atomic_int flush; // see dav1d_frame_cancelled()
+        // frame still receiving its tile groups, if any
+        Dav1dFrameContext *tile_f;
     } frame_thread;
 
+    // picture buffers: the user's allocator, or else recycled buffers
+    Dav1dPicAllocator allocator;
+    Dav1dMemPool *picture_pool;
+    // recycled per-frame motion vector and segmentation map buffers
+    Dav1dMemPool *refmvs_pool, *segmap_pool;
+    Dav1dMemPool *block_info_pool; // if export_block_info is set
+    MemoryUsage mem;
+    WaitStats waits;
+    int low_memory;
+    int hugepages;
+    int parse_ahead; // Dav1dSettings.parse_ahead, if it applies
+
     // reference/entropy state
     struct {
         Dav1dThreadPicture p;
@@ -95,11 +221,21 @@ struct Dav1dContext {
         unsigned refpoc[7];
         WarpedMotionParams gmv[7];
         Av1LoopfilterModeRefDeltas lf_mode_ref_deltas;
-        Av1FilmGrainData film_grain;
+        Dav1dFilmGrainData film_grain;
     } refs[8];
     CdfThreadContext cdf[8];
 
-    Dav1dDSPContext dsp[3 /* 8, 10, 12 bits/component */];
+    // shared DSP function tables, indexed by bitdepth (8, 10, 12), for the
+    // CPU flags in use when the decoder was opened
+    const Dav1dDSPContext *dsp;
+
+    // tile worker threads, shared by all frame contexts, and possibly with
+    // other decoder instances (if it was passed in Dav1dSettings)
+    Dav1dThreadPool *pool;
+    int own_pool;
+    // used by the application thread to run tasks while it waits for a
+    // frame thread (with both frame and tile threading)
+    Dav1dTileContext *tc;
 
     // tree to keep track of which edges are available
     struct {
@@ -127,37 +263,83 @@ struct Dav1dFrameContext {
         Dav1dData data;
         int start, end;
     } tile[256];
-    int n_tile_data;
+    // with frame threading, the frame is submitted with its first tile
+    // group, and the others are added (under frame_thread.td.lock) as they
+    // arrive, until tile_data_done is set; see dav1d_submit_tile_data()
+    int n_tile_data, tile_data_done;
+    // progress of setup_tiles(): tile groups and tiles (in tile index
+    // order) set up so far, whether the tile the entropy context is adapted
+    // from is one of them, and whether a tile size was invalid
+    struct {
+        int n_groups, n_tiles, update_set, error;
+    } tile_setup;
 
     const Dav1dContext *c;
-    Dav1dTileContext *tc;
-    int n_tc;
+    MemoryUsage *mem; // &c->mem
+    WaitStats *waits; // &c->waits
+    PictureReadyQueue *picture_ready; // &c->picture_ready
+    size_t mem_sz[DAV1D_MEM_NUM_CATEGORIES]; // this frame's part of it
+    Dav1dTileContext *tc; // single context used by the frame thread itself
+    int n_tc; // number of tile worker threads (c->pool->n_tc)
     Dav1dTileState *ts;
     int n_ts;
+    // backing memory of the frame-size dependent buffers below (a, ipred_edge,
+    // frame_thread.b/cbi/pal/pal_idx/cf/tile_start_off/sbrow_pos,
+    // tile_thread.sb_progress, lf.level/mask,
+    // lf.tx_lpf_right_edge, lf.cdef_line, lf.lr_lpf_line and the arrays of
+    // post_filter), and the sizes
+    // it was allocated for
+    struct {
+        uint8_t *mem;
+        int sb128w, sb128h, tile_cols, tile_rows, hbd, ipred_edge_rows;
+        size_t frame_sz, frame_thread_sz; // in bytes
+    } arena;
     const Dav1dDSPContext *dsp;
     struct {
         recon_b_intra_fn recon_b_intra;
         recon_b_inter_fn recon_b_inter;
         filter_sbrow_fn filter_sbrow;
+        filter_sbrow_fn filter_sbrow_deblock;
+        filter_sbrow_fn filter_sbrow_cdef;
+        filter_sbrow_fn filter_sbrow_lr;
         backup_ipred_edge_fn backup_ipred_edge;
         read_coef_blocks_fn read_coef_blocks;
     } bd_fn;
 
-    int ipred_edge_sz;
+    // pre-deblock bottom rows of the sbrows, for intra prediction of the
+    // sbrow below; a ring of two rows per tile row if ipred_edge_ring is set,
+    // else one row per sbrow (see ipred_edge_row())
     pixel *ipred_edge[3];
+    int ipred_edge_ring;
     ptrdiff_t b4_stride;
     int bw, bh, sb128w, sb128h, sbh, sb_shift, sb_step;
+    struct {
+        int col_start, col_end, row_start, row_end; // in tile units
+    } region; // tiles intersecting c->decode_region
+    // post-filters to apply; all but for non-reference frames
+    enum Dav1dNonRefFilters filters;
+    // if c->frame_stats is set: when decoding started, and the time spent
+    // in each stage (tiles, deblock, cdef, lr) so far, in nanoseconds (with
+    // tile threads, updated under tile_thread.ttd->lock), and the resulting
+    // statistics of the picture once decoded
+    struct {
+        uint64_t start, stage_time[4];
+        Dav1dFrameStats out;
+    } stats;
     uint16_t dq[NUM_SEGMENTS][3 /* plane */][2 /* dc/ac */];
     const uint8_t *qm[2 /* is_1d */][N_RECT_TX_SIZES][3 /* plane */];
     BlockContext *a;
-    int a_sz /* w*tile_rows */;
-    AV1_COMMON *libaom_cm; // FIXME
+    refmvs_frame rf;
     uint8_t jnt_weights[7][7];
 
     struct {
-        struct thread_data td;
-        int pass, die;
-        // indexed using t->by * f->b4_stride + t->bx
+        // taken by the threads waiting on this frame's pictures and entropy
+        // context, so on cache lines of its own
+        ALIGN(struct thread_data td, 64);
+        ALIGN(int pass, 64);
+        int die;
+        // coded blocks of each tile in decoding order, starting at
+        // tile_start_off / 16 and streamed through t->frame_thread.b
         Av1Block *b;
         struct CodedBlockInfo {
             int16_t eob[3 /* plane */];
@@ -171,6 +353,10 @@ struct Dav1dFrameContext {
         coef *cf;
         // start offsets per tile
         int *tile_start_off;
+        // stream positions at the start of each sbrow of each tile, indexed
+        // using sby * tiling.cols + tile_col; recorded by pass 1, so that
+        // pass 2 can decode the sbrows of a tile independently
+        FrameThreadPos *sbrow_pos;
     } frame_thread;
 
     // loopfilter
@@ -178,7 +364,6 @@ struct Dav1dFrameContext {
         uint8_t (*level)[4];
         Av1Filter *mask;
         int top_pre_cdef_toggle;
-        int mask_sz /* w*h */, line_sz /* w */, re_sz /* h */;
         Av1FilterLUT lim_lut;
         int last_sharpness;
         uint8_t lvl[8 /* seg_id */][4 /* dir */][8 /* ref */][2 /* is_gmv */];
@@ -186,22 +371,54 @@ struct Dav1dFrameContext {
         pixel *cdef_line;
         pixel *cdef_line_ptr[2 /* pre, post */][3 /* plane */][2 /* y */];
         pixel *lr_lpf_line;
-        pixel *lr_lpf_line_ptr[3 /* plane */];
+        pixel *lr_lpf_line_ptr[2 /* sby & 1 */][3 /* plane */];
 
         // in-loop filter per-frame state keeping
         int tile_row; // for carry-over at tile row edges
-        pixel *p[3];
-        Av1Filter *mask_ptr, *prev_mask_ptr;
     } lf;
 
-    // threading (refer to tc[] for per-thread things)
+    // with c->post_filter: whether it filters this frame (instead of the
+    // CDEF and LR stages), the sbrow passed to it, with its arrays (in the
+    // arena; lr_units for the whole frame), and the unit rows of each plane
+    // copied to lr_units so far
+    struct {
+        int active;
+        Dav1dPostFilterSbrow sbrow;
+        int8_t *cdef_idx;
+        uint8_t *cdef_coded;
+        Dav1dRestorationUnit *lr_units[3];
+        int lr_rows[3];
+    } post_filter;
+
+    // threading (tile and post-filter tasks run on the shared workers in
+    // c->pool, and on this frame's own thread, using its tc, whenever it
+    // would otherwise wait for them; all counters are protected by ttd->lock,
+    // and written by any thread, so they start on a cache line of their own,
+    // and the frame context after them does as well)
     struct FrameTileThreadData {
-        uint64_t available;
-        pthread_mutex_t lock;
-        pthread_cond_t cond, icond;
-        int tasks_left, num_tasks;
-        int (*task_idx_to_sby_and_tile_idx)[2];
-        int titsati_sz, titsati_init[2];
+        ALIGN(struct TaskThreadData *ttd, 64);
+        Dav1dFrameContext *next; // in ttd->first
+        pthread_cond_t icond; // signalled on tile progress and task completion
+        int tasks_left, num_tasks, tasks_running;
+        unsigned seq; // decode order of this frame, see dav1d_tile_task_seq()
+        // per post-filter stage (deblock, cdef, lr): first sbrow not handed
+        // out yet, and number of sbrows finished
+        int filter_next[3], filter_done[3];
+        int error; // a tile task could not allocate its buffers
+        int tiles_ready; // tile_setup.n_tiles, for the workers
+        // wavefront reconstruction (pass 2): the sbrows of a tile are tasks
+        // of their own, each trailing the previous one by two superblocks;
+        // sb_progress holds the superblocks reconstructed per sbrow of each
+        // tile, indexed like frame_thread.sbrow_pos
+        int wavefront;
+        SbProgress *sb_progress;
+        // with parse-ahead, the frame thread runs pass 1 alongside the tasks
+        // of pass 2, which only take the sbrows parsed so far (under
+        // ttd->lock; f->sbh otherwise); aborted is set if parsing failed,
+        // see dav1d_frame_cancelled()
+        int parsed;
+        atomic_int aborted;
+        Dav1dSpin spin; // for the frame thread's waits on tile progress
     } tile_thread;
 };
 
@@ -210,19 +427,18 @@ struct Dav1dTileState {
         int col_start, col_end, row_start, row_end; // in 4px units
         int col, row; // in tile units
     } tiling;
+    int skip; // not decoded, outside of f->region
 
     CdfContext cdf;
     MsacContext msac;
 
-    atomic_int progress; // in sby units
+    // read and written by other threads than the one decoding the tile, so
+    // on a cache line apart from its entropy decoding state (and the rest)
+    ALIGN(atomic_int progress, 64); // in sby units
     struct {
-        pthread_mutex_t lock;
-        pthread_cond_t cond;
+        int next_sby; // first sbrow not handed out yet (under ttd->lock)
     } tile_thread;
-    struct {
-        uint8_t *pal_idx;
-        coef *cf;
-    } frame_thread;
+    ALIGN(FrameThreadPos frame_thread, 64); // of pass 1, in between sbrows
 
     uint16_t dqmem[NUM_SEGMENTS][3 /* plane */][2 /* dc/ac */];
     const uint16_t (*dq)[3][2];
@@ -233,15 +449,30 @@ struct Dav1dTileState {
     const uint8_t (*lflvl)[4][8][2];
 
     Av1RestorationUnit *lr_ref[3];
+
+    // if c->frame_stats is set, the blocks decoded in this tile so far, see
+    // Dav1dFrameStats; per tile, so that its threads never share them
+    struct {
+        unsigned intra, inter, skip, palette, warped;
+        unsigned tx[N_RECT_TX_SIZES];
+    } stats;
 };
 
+// Each thread writes its own; they start on a cache line, so that those in
+// an array (of the workers of a pool) don't share any.
 struct Dav1dTileContext {
-    const Dav1dFrameContext *f;
+    ALIGN(const Dav1dFrameContext *f, 64);
     Dav1dTileState *ts;
     int bx, by;
     BlockContext l, *a;
+    FrameThreadPos frame_thread; // in the sbrow being decoded
+    int pass; // frame_thread.pass of the sbrow being decoded
     coef *cf;
     pixel *emu_edge; // stride=160
+    // cf, scratch and emu_edge share one buffer of buf_sz bytes, laid out
+    // for buf_layout, allocated on first use by dav1d_tile_context_alloc()
+    int buf_layout;
+    atomic_int buf_sz;
     // FIXME types can be changed to pixel (and dynamically allocated)
     // which would make copy/assign operations slightly faster?
     uint16_t al_pal[2 /* a/l */][32 /* bx/y4 */][3 /* plane */][8 /* palette_idx */];
@@ -267,9 +498,17 @@ struct Dav1dTileContext {
 
     struct {
         struct thread_data td;
-        struct FrameTileThreadData *fttd;
-        int die;
+        struct TaskThreadData *ttd;
+        int tile_col; // of the last tile-sbrow task taken, see take_tile_task()
     } tile_thread;
+    int trace_thread; // Dav1dTraceEvent.thread of the thread using it
+
+#if CONFIG_PROFILING
+    Dav1dProfile prof; // of the (frame or worker) thread using this context
+#endif
+#if CONFIG_DSP_STATS
+    DspStats dsp_stats;
+#endif
 };
 
 #endif /* __DAV1D_SRC_INTERNAL_H__ */
@@ -421,9 +421,9 @@ static int get_filter_strength(const unsigned blk_wh, const unsigned d,
     return strength;
 }
 
-static void filter_edge(pixel *const out, const int sz,
-                        const pixel *const in, const int from, const int to,
-                        const unsigned strength)
+static void filter_edge_c(pixel *const out, const int sz,
+                          const pixel *const in, const int from, const int to,
+                          const int strength)
 {
     const uint8_t kernel[3][5] = {
         { 0, 4, 8, 4, 0 },
@@ -431,7 +431,7 @@ static void filter_edge(pixel *const out, const int sz,
         { 2, 4, 4, 4, 2 }
     };
 
-    assert(strength > 0);
+    assert(strength > 0 && strength <= 3);
     for (int i = 0; i < sz; i++) {
         int s = 0;
         for (int j = 0; j < 5; j++)
@@ -445,8 +445,8 @@ static int get_upsample(const int blk_wh, const unsigned d, const int type) {
     return type ? (blk_wh <= 8) : (blk_wh <= 16);
 }
 
-static void upsample_edge(pixel *const out, const int hsz,
-                          const pixel *const in, const int from, const int to)
+static void upsample_edge_c(pixel *const out, const int hsz,
+                            const pixel *const in, const int from, const int to)
 {
     const int8_t kernel[4] = { -1, 9, 9, -1 };
     int i;
@@ -461,6 +461,14 @@ static void upsample_edge(pixel *const out, const int hsz,
     out[i * 2] = in[iclip(i, from, to - 1)];
 }
 
+// The directional predictors get no DSP context, so their edge preparation
+// goes through a copy of the table's entries, taken whenever the table is
+// (once per bitdepth, see submit_frame()).
+static struct {
+    filter_edge_fn filter_edge;
+    upsample_edge_fn upsample_edge;
+} edge_dsp = { filter_edge_c, upsample_edge_c };
+
 static NOINLINE void
 z1_c(pixel *dst, const ptrdiff_t stride, const pixel *const topleft_in,
      int angle, const int width, const int height)
@@ -474,8 +482,8 @@ z1_c(pixel *dst, const ptrdiff_t stride, const pixel *const topleft_in,
     int max_base_x;
     const int upsample_above = get_upsample(width + height, 90 - angle, is_sm);
     if (upsample_above) {
-        upsample_edge(top_out, width + height,
-                      &topleft_in[1], -1, width + imin(width, height));
+        edge_dsp.upsample_edge(top_out, width + height, &topleft_in[1],
+                               -1, width + imin(width, height));
         top = top_out;
         max_base_x = 2 * (width + height) - 2;
     } else {
@@ -483,9 +491,9 @@ z1_c(pixel *dst, const ptrdiff_t stride, const pixel *const topleft_in,
             get_filter_strength(width + height, 90 - angle, is_sm);
 
         if (filter_strength) {
-            filter_edge(top_out, width + height,
-                        &topleft_in[1], -1, width + imin(width, height),
-                        filter_strength);
+            edge_dsp.filter_edge(top_out, width + height, &topleft_in[1],
+                                 -1, width + imin(width, height),
+                                 filter_strength);
             top = top_out;
             max_base_x = width + height - 1;
         } else {
@@ -538,27 +546,30 @@ z2_c(pixel *dst, const ptrdiff_t stride, const pixel *const topleft_in,
     pixel *const topleft = &edge[height * 2];
 
     if (upsample_above) {
-        upsample_edge(topleft, width + 1, topleft_in, 0, width + 1);
+        edge_dsp.upsample_edge(topleft, width + 1, topleft_in,
+                               0, width + 1);
     } else {
         const int filter_strength =
             get_filter_strength(width + height, angle - 90, is_sm);
 
         if (filter_strength) {
-            filter_edge(&topleft[1], width, &topleft_in[1], -1, width,
-                        filter_strength);
+            edge_dsp.filter_edge(&topleft[1], width, &topleft_in[1],
+                                 -1, width, filter_strength);
         } else {
             pixel_copy(&topleft[1], &topleft_in[1], width);
         }
     }
     if (upsample_left) {
-        upsample_edge(edge, height + 1, &topleft_in[-height], 0, height + 1);
+        edge_dsp.upsample_edge(edge, height + 1, &topleft_in[-height],
+                               0, height + 1);
     } else {
         const int filter_strength =
             get_filter_strength(width + height, 180 - angle, is_sm);
 
         if (filter_strength) {
-            filter_edge(&topleft[-height], height, &topleft_in[-height],
-                        0, height + 1, filter_strength);
+            edge_dsp.filter_edge(&topleft[-height], height,
+                                 &topleft_in[-height], 0, height + 1,
+                                 filter_strength);
         } else {
             pixel_copy(&topleft[-height], &topleft_in[-height], height);
         }
@@ -617,9 +628,9 @@ z3_c(pixel *dst, const ptrdiff_t stride, const pixel *const topleft_in,
     int max_base_y;
     const int upsample_left = get_upsample(width + height, angle - 180, is_sm);
     if (upsample_left) {
-        upsample_edge(left_out, width + height,
-                      &topleft_in[-(width + height)],
-                      imax(width - height, 0), width + height + 1);
+        edge_dsp.upsample_edge(left_out, width + height,
+                               &topleft_in[-(width + height)],
+                               imax(width - height, 0), width + height + 1);
         left = &left_out[2 * (width + height) - 2];
         max_base_y = 2 * (width + height) - 2;
     } else {
@@ -627,10 +638,10 @@ z3_c(pixel *dst, const ptrdiff_t stride, const pixel *const topleft_in,
             get_filter_strength(width + height, angle - 180, is_sm);
 
         if (filter_strength) {
-            filter_edge(left_out, width + height,
-                        &topleft_in[-(width + height)],
-                        imax(width - height, 0), width + height + 1,
-                        filter_strength);
+            edge_dsp.filter_edge(left_out, width + height,
+                                 &topleft_in[-(width + height)],
+                                 imax(width - height, 0), width + height + 1,
+                                 filter_strength);
             left = &left_out[width + height - 1];
             max_base_y = width + height - 1;
         } else {
@@ -1054,4 +1065,18 @@ void bitfn(dav1d_intra_pred_dsp_init)(Dav1dIntraPredDSPContext *const c) {
     c->cfl_pred[3] = cfl_pred_32xN_c;
 
     c->pal_pred = pal_pred_c;
+
+    c->filter_edge = filter_edge_c;
+    c->upsample_edge = upsample_edge_c;
+
+#if HAVE_ASM
+#if ARCH_AARCH64 || ARCH_ARM
+    bitfn(dav1d_intra_pred_dsp_init_arm)(c);
+#elif ARCH_X86
+    bitfn(dav1d_intra_pred_dsp_init_x86)(c);
+#endif
+#endif
+
+    edge_dsp.filter_edge = c->filter_edge;
+    edge_dsp.upsample_edge = c->upsample_edge;
 }
@@ -83,6 +83,26 @@ void (name)(pixel *dst, ptrdiff_t stride, const uint16_t *pal, \
             const uint8_t *idx, const int w, const int h)
 typedef decl_pal_pred_fn(*pal_pred_fn);
 
+/*
+ * Intra edge filter of directional prediction, for i in [0, sz):
+ * out[i] = (sum(kernel[j] * in[iclip(i - 2 + j, from, to - 1)]) + 8) >> 4
+ * - kernel is the 5-tap kernel of strength (1 to 3);
+ * - out may not alias in.
+ */
+#define decl_filter_edge_fn(name) \
+void (name)(pixel *out, int sz, const pixel *in, int from, int to, \
+            int strength)
+typedef decl_filter_edge_fn(*filter_edge_fn);
+
+/*
+ * 2x intra edge upsampling of directional prediction: writes the 2 * hsz - 1
+ * pixels from in[0] to in[hsz - 1] and the half-pel positions in between
+ * (4-tap filtered) to out, reading in[] clipped to [from, to - 1] as above.
+ */
+#define decl_upsample_edge_fn(name) \
+void (name)(pixel *out, int hsz, const pixel *in, int from, int to)
+typedef decl_upsample_edge_fn(*upsample_edge_fn);
+
 typedef struct Dav1dIntraPredDSPContext {
     angular_ipred_fn intra_pred[N_RECT_TX_SIZES][N_IMPL_INTRA_PRED_MODES];
 
@@ -93,9 +113,18 @@ typedef struct Dav1dIntraPredDSPContext {
 
     // palette
     pal_pred_fn pal_pred;
+
+    // edge preparation of the directional (z1/z2/z3) predictors
+    filter_edge_fn filter_edge;
+    upsample_edge_fn upsample_edge;
 } Dav1dIntraPredDSPContext;
 
 void dav1d_intra_pred_dsp_init_8bpc(Dav1dIntraPredDSPContext *c);
 void dav1d_intra_pred_dsp_init_10bpc(Dav1dIntraPredDSPContext *c);
 
+void dav1d_intra_pred_dsp_init_x86_8bpc(Dav1dIntraPredDSPContext *c);
+void dav1d_intra_pred_dsp_init_x86_10bpc(Dav1dIntraPredDSPContext *c);
+void dav1d_intra_pred_dsp_init_arm_8bpc(Dav1dIntraPredDSPContext *c);
+void dav1d_intra_pred_dsp_init_arm_10bpc(Dav1dIntraPredDSPContext *c);
+
 #endif /* __DAV1D_SRC_IPRED_H__ */
@@ -138,9 +138,18 @@ bytefn(prepare_intra_edges)(const int x, const int have_left,
 
         if (have_left) {
             const int px_have = imin(sz, (h - y) << 2);
-
-            for (int i = 0; i < px_have; i++)
-                left[sz - 1 - i] = dst[PXSTRIDE(stride) * i - 1];
+            const pixel *src = &dst[-1];
+            pixel *out = &left[sz - 1];
+
+            // px_have is a multiple of 4, like all block edges
+            for (int i = 0; i < px_have; i += 4) {
+                out[ 0] = src[0];
+                out[-1] = src[PXSTRIDE(stride)];
+                out[-2] = src[PXSTRIDE(stride) * 2];
+                out[-3] = src[PXSTRIDE(stride) * 3];
+                src += PXSTRIDE(stride) * 4;
+                out -= 4;
+            }
             if (px_have < sz)
                 pixel_set(left, left[sz - px_have], sz - px_have);
         } else {
@@ -153,9 +162,17 @@ bytefn(prepare_intra_edges)(const int x, const int have_left,
 
             if (have_bottomleft) {
                 const int px_have = imin(sz, (h - y - th) << 2);
-
-                for (int i = 0; i < px_have; i++)
-                    left[-(i + 1)] = dst[(sz + i) * PXSTRIDE(stride) - 1];
+                const pixel *src = &dst[sz * PXSTRIDE(stride) - 1];
+                pixel *out = &left[-1];
+
+                for (int i = 0; i < px_have; i += 4) {
+                    out[ 0] = src[0];
+                    out[-1] = src[PXSTRIDE(stride)];
+                    out[-2] = src[PXSTRIDE(stride) * 2];
+                    out[-3] = src[PXSTRIDE(stride) * 3];
+                    src += PXSTRIDE(stride) * 4;
+                    out -= 4;
+                }
                 if (px_have < sz)
                     pixel_set(left - sz, left[-px_have], sz - px_have);
             } else {
@@ -167,28 +184,30 @@ bytefn(prepare_intra_edges)(const int x, const int have_left,
     if (av1_intra_prediction_edges[mode].needs_top) {
         const int sz = tw << 2;
         pixel *const top = &topleft_out[1];
+        const int needs_topright = av1_intra_prediction_edges[mode].needs_topright;
+        const int have_topright = (!needs_topright || !have_top || x + tw >= w) ? 0 :
+                                  (edge_flags & EDGE_I444_TOP_HAS_RIGHT);
 
-        if (have_top) {
-            const int px_have = imin(sz, (w - x) << 2);
-            pixel_copy(top, dst_top, px_have);
-            if (px_have < sz)
-                pixel_set(top + px_have, top[px_have - 1], sz - px_have);
+        if (have_topright && (w - x - tw) << 2 >= sz) {
+            // both edges are complete, and contiguous in the source row
+            pixel_copy(top, dst_top, sz << 1);
         } else {
-            pixel_set(top, have_left ? dst[-1] : ((1 << BITDEPTH) >> 1) - 1, sz);
-        }
-
-        if (av1_intra_prediction_edges[mode].needs_topright) {
-            const int have_topright = (!have_top || x + tw >= w) ? 0 :
-                                      (edge_flags & EDGE_I444_TOP_HAS_RIGHT);
+            if (have_top) {
+                const int px_have = imin(sz, (w - x) << 2);
+                pixel_copy(top, dst_top, px_have);
+                if (px_have < sz)
+                    pixel_set(top + px_have, top[px_have - 1], sz - px_have);
+            } else {
+                pixel_set(top, have_left ? dst[-1] : ((1 << BITDEPTH) >> 1) - 1, sz);
+            }
 
             if (have_topright) {
-                const int px_have = imin(sz, (w - x - tw) << 2);
+                const int px_have = (w - x - tw) << 2;
 
                 pixel_copy(top + sz, &dst_top[sz], px_have);
-                if (px_have < sz)
-                    pixel_set(top + sz + px_have, top[sz + px_have - 1],
-                              sz - px_have);
-            } else {
+                pixel_set(top + sz + px_have, top[sz + px_have - 1],
+                          sz - px_have);
+            } else if (needs_topright) {
                 pixel_set(top + sz, top[sz - 1], sz);
             }
         }
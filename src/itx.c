@@ -46,18 +46,42 @@ static void NOINLINE
 inv_txfm_add_c(pixel *dst, const ptrdiff_t stride,
                coef *const coeff, const int eob,
                const int w, const int h, const int shift1, const int shift2,
-               const itx_1d_fn first_1d_fn, const itx_1d_fn second_1d_fn)
+               const itx_1d_fn first_1d_fn, const itx_1d_fn second_1d_fn,
+               const int has_dconly)
 {
     int i, j;
     const ptrdiff_t sh = imin(h, 32), sw = imin(w, 32);
     assert((h >= 4 || h <= 64) && (w >= 4 || w <= 64));
+    const int is_rect2 = w * 2 == h || h * 2 == w;
+    const int rnd1 = (1 << shift1) >> 1;
+    const int rnd2 = (1 << shift2) >> 1;
+
+    if (has_dconly && !eob) {
+        // only the DC coefficient is set, so both dct passes output a
+        // constant and the residual is the same for every pixel
+        int dc = coeff[0];
+        coeff[0] = 0;
+        if (is_rect2)
+            dc = (dc * 2896 + 2048) >> 12;
+        dc = (dc * 2896 + 2048) >> 12;
+        dc = (dc + rnd1) >> shift1;
+        dc = (dc * 2896 + 2048) >> 12;
+        dc = (dc + rnd2) >> shift2;
+        for (j = 0; j < h; j++, dst += PXSTRIDE(stride))
+            for (i = 0; i < w; i++)
+                dst[i] = iclip_pixel(dst[i] + dc);
+        return;
+    }
+
+    // all coefficients past eob in scan order are zero, and no scan reaches
+    // row or column n before position n, so rows and columns past eob can
+    // be skipped in the first pass and when clearing the coefficients
+    const int nz_h = imin(sh, eob + 1), nz_w = imin(sw, eob + 1);
     // Maximum value for h and w is 64
     coef tmp[4096 /* w * h */], out[64 /* h */], in_mem[64 /* w */];
-    const int is_rect2 = w * 2 == h || h * 2 == w;
 
     if (w != sw) memset(&in_mem[sw], 0, (w - sw) * sizeof(*in_mem));
-    const int rnd1 = (1 << shift1) >> 1;
-    for (i = 0; i < sh; i++) {
+    for (i = 0; i < nz_h; i++) {
         if (w != sw || is_rect2) {
             for (j = 0; j < sw; j++) {
                 in_mem[j] = coeff[i + j * sh];
@@ -72,8 +96,7 @@ inv_txfm_add_c(pixel *dst, const ptrdiff_t stride,
             tmp[i * w + j] = (tmp[i * w + j] + (rnd1)) >> shift1;
     }
 
-    if (h != sh) memset(&tmp[sh * w], 0, w * (h - sh) * sizeof(*tmp));
-    const int rnd2 = (1 << shift2) >> 1;
+    if (h != nz_h) memset(&tmp[nz_h * w], 0, w * (h - nz_h) * sizeof(*tmp));
     for (i = 0; i < w; i++) {
         second_1d_fn(&tmp[i], w, out, 1);
         for (j = 0; j < h; j++)
@@ -81,10 +104,11 @@ inv_txfm_add_c(pixel *dst, const ptrdiff_t stride,
                 iclip_pixel(dst[i + j * PXSTRIDE(stride)] +
                             ((out[j] + (rnd2)) >> shift2));
     }
-    memset(coeff, 0, sizeof(*coeff) * sh * sw);
+    for (j = 0; j < nz_w; j++)
+        memset(&coeff[j * sh], 0, sizeof(*coeff) * nz_h);
 }
 
-#define inv_txfm_fn(type1, type2, w, h, shift1, shift2) \
+#define inv_txfm_fn(type1, type2, w, h, shift1, shift2, has_dconly) \
 static void \
 inv_txfm_add_##type1##_##type2##_##w##x##h##_c(pixel *dst, \
                                                const ptrdiff_t stride, \
@@ -92,35 +116,35 @@ inv_txfm_add_##type1##_##type2##_##w##x##h##_c(pixel *dst, \
                                                const int eob) \
 { \
     inv_txfm_add_c(dst, stride, coeff, eob, w, h, shift1, shift2, \
-                   inv_##type1##w##_1d, inv_##type2##h##_1d); \
+                   inv_##type1##w##_1d, inv_##type2##h##_1d, has_dconly); \
 }
 
 #define inv_txfm_fn64(w, h, shift1, shift2) \
-inv_txfm_fn(dct, dct, w, h, shift1, shift2)
+inv_txfm_fn(dct, dct, w, h, shift1, shift2, 1)
 
 #define inv_txfm_fn32(w, h, shift1, shift2) \
 inv_txfm_fn64(w, h, shift1, shift2) \
-inv_txfm_fn(identity, identity, w, h, shift1, shift2)
+inv_txfm_fn(identity, identity, w, h, shift1, shift2, 0)
 
 #define inv_txfm_fn16(w, h, shift1, shift2) \
 inv_txfm_fn32(w, h, shift1, shift2) \
-inv_txfm_fn(adst,     dct,      w, h, shift1, shift2) \
-inv_txfm_fn(dct,      adst,     w, h, shift1, shift2) \
-inv_txfm_fn(adst,     adst,     w, h, shift1, shift2) \
-inv_txfm_fn(dct,      flipadst, w, h, shift1, shift2) \
-inv_txfm_fn(flipadst, dct,      w, h, shift1, shift2) \
-inv_txfm_fn(adst,     flipadst, w, h, shift1, shift2) \
-inv_txfm_fn(flipadst, adst,     w, h, shift1, shift2) \
-inv_txfm_fn(flipadst, flipadst, w, h, shift1, shift2) \
-inv_txfm_fn(identity, dct,      w, h, shift1, shift2) \
-inv_txfm_fn(dct,      identity, w, h, shift1, shift2) \
+inv_txfm_fn(adst,     dct,      w, h, shift1, shift2, 0) \
+inv_txfm_fn(dct,      adst,     w, h, shift1, shift2, 0) \
+inv_txfm_fn(adst,     adst,     w, h, shift1, shift2, 0) \
+inv_txfm_fn(dct,      flipadst, w, h, shift1, shift2, 0) \
+inv_txfm_fn(flipadst, dct,      w, h, shift1, shift2, 0) \
+inv_txfm_fn(adst,     flipadst, w, h, shift1, shift2, 0) \
+inv_txfm_fn(flipadst, adst,     w, h, shift1, shift2, 0) \
+inv_txfm_fn(flipadst, flipadst, w, h, shift1, shift2, 0) \
+inv_txfm_fn(identity, dct,      w, h, shift1, shift2, 0) \
+inv_txfm_fn(dct,      identity, w, h, shift1, shift2, 0) \
 
 #define inv_txfm_fn84(w, h, shift1, shift2) \
 inv_txfm_fn16(w, h, shift1, shift2) \
-inv_txfm_fn(identity, flipadst, w, h, shift1, shift2) \
-inv_txfm_fn(flipadst, identity, w, h, shift1, shift2) \
-inv_txfm_fn(identity, adst,     w, h, shift1, shift2) \
-inv_txfm_fn(adst,     identity, w, h, shift1, shift2) \
+inv_txfm_fn(identity, flipadst, w, h, shift1, shift2, 0) \
+inv_txfm_fn(flipadst, identity, w, h, shift1, shift2, 0) \
+inv_txfm_fn(identity, adst,     w, h, shift1, shift2, 0) \
+inv_txfm_fn(adst,     identity, w, h, shift1, shift2, 0) \
 
 inv_txfm_fn84( 4,  4, 0, 4)
 inv_txfm_fn84( 4,  8, 0, 4)
@@ -224,4 +248,12 @@ void bitfn(dav1d_itx_dsp_init)(Dav1dInvTxfmDSPContext *const c) {
     assign_itx_all_fn64(64, 16, R);
     assign_itx_all_fn64(64, 32, R);
     assign_itx_all_fn64(64, 64, );
+
+#if HAVE_ASM
+#if ARCH_AARCH64 || ARCH_ARM
+    bitfn(dav1d_itx_dsp_init_arm)(c);
+#elif ARCH_X86
+    bitfn(dav1d_itx_dsp_init_x86)(c);
+#endif
+#endif
 }
@@ -33,46 +33,47 @@
 #include "common/intops.h"
 
 #include "src/lf_apply.h"
+#include "src/profile.h"
 
-static inline int maxifzero(const uint8_t (*const a)[4], const int have_b,
-                            const uint8_t (*const b)[4], const int diridx)
+// The bits of rows starty4 to endy4 (exclusive) of a col edge mask, whose
+// halves hold hsz rows each (see Av1Filter); the other half may be written
+// by blocks of the next sbrow meanwhile, so it is not read.
+static inline unsigned col_mask(const uint16_t *const mask, const int hsz,
+                                const int starty4, const int endy4)
 {
-    const int a_val = (*a)[diridx];
-    if (a_val) return a_val;
-    if (!have_b) return a_val;
-    return (*b)[diridx];
+    const unsigned m = (starty4 < hsz ? mask[0] : 0) |
+                       (endy4 > hsz ? (unsigned) mask[1] << hsz : 0);
+    return (m >> starty4) & (unsigned) ((1ULL << (endy4 - starty4)) - 1);
+}
+
+// The bits of all cols of a row edge mask, whose halves hold hsz cols each
+static inline unsigned row_mask(const uint16_t *const mask, const int hsz) {
+    return mask[0] | (unsigned) mask[1] << hsz;
 }
 
 static inline void filter_plane_cols_y(const Dav1dFrameContext *const f,
                                        const int have_left,
                                        const uint8_t (*lvl)[4],
                                        const ptrdiff_t b4_stride,
-                                       const uint32_t (*const mask)[3],
+                                       const uint16_t (*const mask)[3][2],
                                        pixel *dst, const ptrdiff_t ls,
+                                       const int w,
                                        const int starty4, const int endy4)
 {
     const Dav1dDSPContext *const dsp = f->dsp;
 
     // filter edges between columns (e.g. block1 | block2)
-    for (int y = starty4; y < endy4;
-         y++, dst += 4 * PXSTRIDE(ls), lvl += b4_stride)
-    {
-        pixel *ptr = dst;
-        const uint8_t (*l)[4] = lvl;
-        const uint32_t *const hmask = mask[y];
-        const unsigned hm = hmask[0] | hmask[1] | hmask[2];
-
-        for (unsigned x = 1; hm & ~(x - 1); l++, x <<= 1, ptr += 4) {
-            if ((have_left || x > 1) && (hm & x)) {
-                const int L = maxifzero(l, have_left || x > 1, &l[-1], 0);
-                if (!L) continue;
-                const int H = L >> 4;
-                const int E = f->lf.lim_lut.e[L], I = f->lf.lim_lut.i[L];
-                const int idx = (hmask[2] & x) ? 2 : !!(hmask[1] & x);
-
-                dsp->lf.loop_filter[idx][0](ptr, ls, E, I, H);
-            }
-        }
+    for (int x = 0; x < w; x++) {
+        if (!have_left && !x) continue;
+        const uint32_t hmask[3] = {
+            col_mask(mask[x][0], 16, starty4, endy4),
+            col_mask(mask[x][1], 16, starty4, endy4),
+            col_mask(mask[x][2], 16, starty4, endy4),
+        };
+        if (!(hmask[0] | hmask[1] | hmask[2])) continue;
+        dsp->lf.loop_filter_sb[0][0](&dst[x * 4], ls, hmask,
+                                     (const uint8_t(*)[4]) &lvl[x][0],
+                                     b4_stride, &f->lf.lim_lut);
     }
 }
 
@@ -80,7 +81,7 @@ static inline void filter_plane_rows_y(const Dav1dFrameContext *const f,
                                        const int have_top,
                                        const uint8_t (*lvl)[4],
                                        const ptrdiff_t b4_stride,
-                                       const uint32_t (*const mask)[3],
+                                       const uint16_t (*const mask)[3][2],
                                        pixel *dst, const ptrdiff_t ls,
                                        const int starty4, const int endy4)
 {
@@ -92,22 +93,16 @@ static inline void filter_plane_rows_y(const Dav1dFrameContext *const f,
     for (int y = starty4; y < endy4;
          y++, dst += 4 * PXSTRIDE(ls), lvl += b4_stride)
     {
-        pixel *ptr = dst;
-        const uint8_t (*l)[4] = lvl;
-        const uint32_t *const vmask = mask[y];
-        const unsigned vm = vmask[0] | vmask[1] | vmask[2];
-
-        for (unsigned x = 1; vm & ~(x - 1); x <<= 1, ptr += 4, l++) {
-            if ((have_top || y) && (vm & x)) {
-                const int L = maxifzero(l, have_top || y, &l[-b4_stride], 1);
-                if (!L) continue;
-                const int H = L >> 4;
-                const int E = f->lf.lim_lut.e[L], I = f->lf.lim_lut.i[L];
-                const int idx = (vmask[2] & x) ? 2 : !!(vmask[1] & x);
-
-                dsp->lf.loop_filter[idx][1](ptr, ls, E, I, H);
-            }
-        }
+        if (!have_top && !y) continue;
+        const uint32_t vmask[3] = {
+            row_mask(mask[y][0], 16),
+            row_mask(mask[y][1], 16),
+            row_mask(mask[y][2], 16),
+        };
+        if (!(vmask[0] | vmask[1] | vmask[2])) continue;
+        dsp->lf.loop_filter_sb[0][1](dst, ls, vmask,
+                                     (const uint8_t(*)[4]) &lvl[0][1],
+                                     b4_stride, &f->lf.lim_lut);
     }
 }
 
@@ -115,49 +110,28 @@ static inline void filter_plane_cols_uv(const Dav1dFrameContext *const f,
                                         const int have_left,
                                         const uint8_t (*lvl)[4],
                                         const ptrdiff_t b4_stride,
-                                        const uint32_t (*const mask)[2],
+                                        const uint16_t (*const mask)[2][2],
                                         pixel *const u, pixel *const v,
-                                        const ptrdiff_t ls,
+                                        const ptrdiff_t ls, const int w,
                                         const int starty4, const int endy4)
 {
     const Dav1dDSPContext *const dsp = f->dsp;
-    int y;
-    ptrdiff_t off_l;
-    const int ss_ver = f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420;
-    const int ss_hor = f->cur.p.p.layout != DAV1D_PIXEL_LAYOUT_I444;
-    const int hstep = 1 << ss_hor;
+    const int hsz = 16 >> (f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420);
 
     // filter edges between columns (e.g. block1 | block2)
-    lvl += ss_hor + ss_ver * b4_stride;
-    for (off_l = 0, y = starty4; y < endy4;
-         y++, off_l += 4 * PXSTRIDE(ls), lvl += b4_stride << ss_ver)
-    {
-        ptrdiff_t off = off_l;
-        const uint8_t (*l)[4] = lvl;
-        const uint32_t *const hmask = mask[y];
-        const unsigned hm = hmask[0] | hmask[1];
-
-        for (unsigned x = 1; hm & ~(x - 1); l += hstep, x <<= 1, off += 4) {
-            if ((have_left || x > 1) && (hm & x)) {
-                const int idx = !!(hmask[1] & x);
-
-                const int Lu = maxifzero(l, have_left || x > 1, &l[-hstep], 2);
-                if (Lu) {
-                    const int H = Lu >> 4;
-                    const int E = f->lf.lim_lut.e[Lu], I = f->lf.lim_lut.i[Lu];
-
-                    dsp->lf.loop_filter_uv[idx][0](&u[off], ls, E, I, H);
-                }
-
-                const int Lv = maxifzero(l, have_left || x > 1, &l[-hstep], 3);
-                if (Lv) {
-                    const int H = Lv >> 4;
-                    const int E = f->lf.lim_lut.e[Lv], I = f->lf.lim_lut.i[Lv];
-
-                    dsp->lf.loop_filter_uv[idx][0](&v[off], ls, E, I, H);
-                }
-            }
-        }
+    for (int x = 0; x < w; x++) {
+        if (!have_left && !x) continue;
+        const uint32_t hmask[2] = {
+            col_mask(mask[x][0], hsz, starty4, endy4),
+            col_mask(mask[x][1], hsz, starty4, endy4),
+        };
+        if (!(hmask[0] | hmask[1])) continue;
+        dsp->lf.loop_filter_sb[1][0](&u[x * 4], ls, hmask,
+                                     (const uint8_t(*)[4]) &lvl[x][2],
+                                     b4_stride, &f->lf.lim_lut);
+        dsp->lf.loop_filter_sb[1][0](&v[x * 4], ls, hmask,
+                                     (const uint8_t(*)[4]) &lvl[x][3],
+                                     b4_stride, &f->lf.lim_lut);
     }
 }
 
@@ -165,53 +139,33 @@ static inline void filter_plane_rows_uv(const Dav1dFrameContext *const f,
                                         const int have_top,
                                         const uint8_t (*lvl)[4],
                                         const ptrdiff_t b4_stride,
-                                        const uint32_t (*const mask)[2],
+                                        const uint16_t (*const mask)[2][2],
                                         pixel *const u, pixel *const v,
                                         const ptrdiff_t ls,
                                         const int starty4, const int endy4)
 {
     const Dav1dDSPContext *const dsp = f->dsp;
-    int y;
-    ptrdiff_t off_l;
-    const int ss_ver = f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420;
-    const int ss_hor = f->cur.p.p.layout != DAV1D_PIXEL_LAYOUT_I444;
-    const int hstep = 1 << ss_hor;
+    const int hsz = 16 >> (f->cur.p.p.layout != DAV1D_PIXEL_LAYOUT_I444);
+    ptrdiff_t off_l = 0;
 
     //                                 block1
     // filter edges between rows (e.g. ------)
     //                                 block2
-    lvl += ss_ver * b4_stride + ss_hor;
-    for (off_l = 0, y = starty4; y < endy4;
-         y++, off_l += 4 * PXSTRIDE(ls), lvl += b4_stride << ss_ver)
+    for (int y = starty4; y < endy4;
+         y++, off_l += 4 * PXSTRIDE(ls), lvl += b4_stride)
     {
-        ptrdiff_t off = off_l;
-        const uint8_t (*l)[4] = lvl;
-        const uint32_t *const vmask = mask[y];
-        const unsigned vm = vmask[0] | vmask[1];
-
-        for (unsigned x = 1; vm & ~(x - 1); x <<= 1, off += 4, l += hstep) {
-            if ((have_top || y) && (vm & x)) {
-                const int idx = !!(vmask[1] & x);
-
-                const int Lu = maxifzero(l, have_top || y,
-                                         &l[-(b4_stride << ss_ver)], 2);
-                if (Lu) {
-                    const int H = Lu >> 4;
-                    const int E = f->lf.lim_lut.e[Lu], I = f->lf.lim_lut.i[Lu];
-
-                    dsp->lf.loop_filter_uv[idx][1](&u[off], ls, E, I, H);
-                }
-
-                const int Lv = maxifzero(l, have_top || y,
-                                         &l[-(b4_stride << ss_ver)], 3);
-                if (Lv) {
-                    const int H = Lv >> 4;
-                    const int E = f->lf.lim_lut.e[Lv], I = f->lf.lim_lut.i[Lv];
-
-                    dsp->lf.loop_filter_uv[idx][1](&v[off], ls, E, I, H);
-                }
-            }
-        }
+        if (!have_top && !y) continue;
+        const uint32_t vmask[2] = {
+            row_mask(mask[y][0], hsz),
+            row_mask(mask[y][1], hsz),
+        };
+        if (!(vmask[0] | vmask[1])) continue;
+        dsp->lf.loop_filter_sb[1][1](&u[off_l], ls, vmask,
+                                     (const uint8_t(*)[4]) &lvl[0][2],
+                                     b4_stride, &f->lf.lim_lut);
+        dsp->lf.loop_filter_sb[1][1](&v[off_l], ls, vmask,
+                                     (const uint8_t(*)[4]) &lvl[0][3],
+                                     b4_stride, &f->lf.lim_lut);
     }
 }
 
@@ -219,6 +173,7 @@ void bytefn(dav1d_loopfilter_sbrow)(const Dav1dFrameContext *const f,
                                     pixel *const p[3], Av1Filter *const lflvl,
                                     int sby, const int start_of_tile_row)
 {
+    PROF_START(prof_start);
     int x, have_left;
     // Don't filter outside the frame
     const int hy4 = (f->cur.p.p.h + 3) >> 2;
@@ -239,22 +194,30 @@ void bytefn(dav1d_loopfilter_sbrow)(const Dav1dFrameContext *const f,
     for (int tile_col = 1;; tile_col++) {
         x = f->frame_hdr.tiling.col_start_sb[tile_col];
         if ((x << sbl2) >= f->bw) break;
-        const int mask = x & is_sb64 ? 1 << 16 : 1;
-        const int uv_mask = x & is_sb64 ? 1 << (16 >> ss_hor) : 1;
+        const int col = x & is_sb64 ? 16 : 0;
+        const int uv_col = x & is_sb64 ? 16 >> ss_hor : 0;
         x >>= is_sb64;
+        // only the rows of this sbrow, i.e. the halves of the col masks
+        // it covers (see Av1Filter)
+        uint16_t (*const y_hmask)[2] = lflvl[x].filter_y[0][col];
         for (int y = starty4; y < endy4; y++) {
-            const int idx = 2 * !!(lflvl[x].filter_y[0][y][2] & mask) +
-                                !!(lflvl[x].filter_y[0][y][1] & mask);
-            lflvl[x].filter_y[0][y][2] &= ~mask;
-            lflvl[x].filter_y[0][y][1] &= ~mask;
-            lflvl[x].filter_y[0][y][0] &= ~mask;
-            lflvl[x].filter_y[0][y][imin(idx, lpf_y[y - starty4])] |= mask;
+            const int half = y >> 4;
+            const unsigned mask = 1U << (y & 15);
+            const int idx = 2 * !!(y_hmask[2][half] & mask) +
+                                !!(y_hmask[1][half] & mask);
+            y_hmask[2][half] &= ~mask;
+            y_hmask[1][half] &= ~mask;
+            y_hmask[0][half] &= ~mask;
+            y_hmask[imin(idx, lpf_y[y - starty4])][half] |= mask;
         }
+        uint16_t (*const uv_hmask)[2] = lflvl[x].filter_uv[0][uv_col];
         for (int y = starty4 >> ss_ver; y < uv_endy4; y++) {
-            const int idx = !!(lflvl[x].filter_uv[0][y][1] & uv_mask);
-            lflvl[x].filter_uv[0][y][1] &= ~uv_mask;
-            lflvl[x].filter_uv[0][y][0] &= ~uv_mask;
-            lflvl[x].filter_uv[0][y][imin(idx, lpf_uv[y - (starty4 >> ss_ver)])] |= uv_mask;
+            const int half = y >> (4 - ss_ver);
+            const unsigned uv_mask = 1U << (y & (15 >> ss_ver));
+            const int idx = !!(uv_hmask[1][half] & uv_mask);
+            uv_hmask[1][half] &= ~uv_mask;
+            uv_hmask[0][half] &= ~uv_mask;
+            uv_hmask[imin(idx, lpf_uv[y - (starty4 >> ss_ver)])][half] |= uv_mask;
         }
         lpf_y  += halign;
         lpf_uv += halign >> ss_ver;
@@ -266,26 +229,31 @@ void bytefn(dav1d_loopfilter_sbrow)(const Dav1dFrameContext *const f,
         for (x = 0, a = &f->a[f->sb128w * (start_of_tile_row - 1)];
              x < f->sb128w; x++, a++)
         {
-            uint32_t *const y_vmask = lflvl[x].filter_y[1][starty4];
-            const unsigned y_vm = y_vmask[0] | y_vmask[1] | y_vmask[2];
-
-            for (unsigned mask = 1, i = 0; i < 32; mask <<= 1, i++) {
-                if (!(y_vm & mask)) continue;
-                const int idx = 2 * !!(y_vmask[2] & mask) + !!(y_vmask[1] & mask);
-                y_vmask[2] &= ~mask;
-                y_vmask[1] &= ~mask;
-                y_vmask[0] &= ~mask;
-                y_vmask[imin(idx, a->tx_lpf_y[i])] |= mask;
+            uint16_t (*const y_vmask)[2] = lflvl[x].filter_y[1][starty4];
+            for (int i = 0; i < 32; i++) {
+                const int half = i >> 4;
+                const unsigned mask = 1U << (i & 15);
+                if (!((y_vmask[0][half] | y_vmask[1][half] |
+                       y_vmask[2][half]) & mask))
+                    continue;
+                const int idx = 2 * !!(y_vmask[2][half] & mask) +
+                                    !!(y_vmask[1][half] & mask);
+                y_vmask[2][half] &= ~mask;
+                y_vmask[1][half] &= ~mask;
+                y_vmask[0][half] &= ~mask;
+                y_vmask[imin(idx, a->tx_lpf_y[i])][half] |= mask;
             }
 
-            uint32_t *const uv_vmask = lflvl[x].filter_uv[1][starty4 >> ss_ver];
-            const unsigned uv_vm = uv_vmask[0] | uv_vmask[1];
-            for (unsigned mask = 1, i = 0; i < (32 >> ss_hor); mask <<= 1, i++) {
-                if (!(uv_vm & mask)) continue;
-                const int idx = !!(uv_vmask[1] & mask);
-                uv_vmask[1] &= ~mask;
-                uv_vmask[0] &= ~mask;
-                uv_vmask[imin(idx, a->tx_lpf_uv[i])] |= mask;
+            uint16_t (*const uv_vmask)[2] =
+                lflvl[x].filter_uv[1][starty4 >> ss_ver];
+            for (int i = 0; i < (32 >> ss_hor); i++) {
+                const int half = i >> (4 - ss_hor);
+                const unsigned mask = 1U << (i & (15 >> ss_hor));
+                if (!((uv_vmask[0][half] | uv_vmask[1][half]) & mask)) continue;
+                const int idx = !!(uv_vmask[1][half] & mask);
+                uv_vmask[1][half] &= ~mask;
+                uv_vmask[0][half] &= ~mask;
+                uv_vmask[imin(idx, a->tx_lpf_uv[i])][half] |= mask;
             }
         }
     }
@@ -296,8 +264,8 @@ void bytefn(dav1d_loopfilter_sbrow)(const Dav1dFrameContext *const f,
          x++, have_left = 1, ptr += 128, level_ptr += 32)
     {
         filter_plane_cols_y(f, have_left, level_ptr, f->b4_stride,
-                            lflvl[x].filter_y[0],
-                            ptr, f->cur.p.stride[0], starty4, endy4);
+                            lflvl[x].filter_y[0], ptr, f->cur.p.stride[0],
+                            imin(32, f->bw - 32 * x), starty4, endy4);
     }
 
     level_ptr = f->lf.level + f->b4_stride * sby * sbsz;
@@ -307,27 +275,31 @@ void bytefn(dav1d_loopfilter_sbrow)(const Dav1dFrameContext *const f,
                             ptr, f->cur.p.stride[0], starty4, endy4);
     }
 
-    if (!f->frame_hdr.loopfilter.level_u && !f->frame_hdr.loopfilter.level_v)
+    if (!f->frame_hdr.loopfilter.level_u && !f->frame_hdr.loopfilter.level_v) {
+        PROF_END(prof_start, DAV1D_PROF_LOOPFILTER);
         return;
+    }
 
     ptrdiff_t uv_off;
-    level_ptr = f->lf.level + f->b4_stride * sby * sbsz;
+    level_ptr = f->lf.level + f->b4_stride * (sby * sbsz >> ss_ver);
     for (uv_off = 0, have_left = 0, x = 0; x < f->sb128w;
-         x++, have_left = 1, uv_off += 128 >> ss_hor, level_ptr += 32)
+         x++, have_left = 1, uv_off += 128 >> ss_hor, level_ptr += 32 >> ss_hor)
     {
         filter_plane_cols_uv(f, have_left, level_ptr, f->b4_stride,
                              lflvl[x].filter_uv[0],
                              &p[1][uv_off], &p[2][uv_off], f->cur.p.stride[1],
+                             (imin(32, f->bw - 32 * x) + ss_hor) >> ss_hor,
                              starty4 >> ss_ver, uv_endy4);
     }
 
-    level_ptr = f->lf.level + f->b4_stride * sby * sbsz;
+    level_ptr = f->lf.level + f->b4_stride * (sby * sbsz >> ss_ver);
     for (uv_off = 0, x = 0; x < f->sb128w;
-         x++, uv_off += 128 >> ss_hor, level_ptr += 32)
+         x++, uv_off += 128 >> ss_hor, level_ptr += 32 >> ss_hor)
     {
         filter_plane_rows_uv(f, have_top, level_ptr, f->b4_stride,
                              lflvl[x].filter_uv[1],
                              &p[1][uv_off], &p[2][uv_off], f->cur.p.stride[1],
                              starty4 >> ss_ver, uv_endy4);
     }
+    PROF_END(prof_start, DAV1D_PROF_LOOPFILTER);
 }
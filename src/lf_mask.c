@@ -80,13 +80,90 @@ static void decomp_tx(uint8_t (*txa)[2 /* txsz, step */][32 /* y */][32 /* x */]
     }
 }
 
-static inline void mask_edges_inter(uint32_t (*masks)[32][3],
+// Sets bits (1 per 4px unit along an edge of the 128x128 area) in an edge
+// mask, split in the words of its halves of hsz units each (see Av1Filter).
+// A half without any of the bits is not written at all, since it may be
+// deblocked, or written by another tile, meanwhile.
+static inline void mask_bits(uint16_t *const edge, const unsigned bits,
+                             const int hsz)
+{
+    const unsigned lo = bits & ((1U << hsz) - 1), hi = bits >> hsz;
+    if (lo) edge[0] |= lo;
+    if (hi) edge[1] |= hi;
+}
+
+// Sets the bits of the n 4px units starting at pos along a block edge, in
+// edge[] of the smaller of the transform size inside the block (tx) and
+// the one on the other side of the edge (nb[]). Neighbouring transform
+// sizes mostly come in long runs, so the bits are set a run at a time.
+static inline void mask_block_edge(uint16_t (*const edge)[2],
+                                   const int pos, const int n, const int hsz,
+                                   const int tx, const uint8_t *const nb)
+{
+    for (int i = 0; i < n;) {
+        const int lvl = imin(tx, nb[i]);
+        int j = i + 1;
+        while (j < n && imin(tx, nb[j]) == lvl) j++;
+        mask_bits(edge[lvl],
+                  (unsigned) ((((uint64_t) 1 << (j - i)) - 1) << (pos + i)), hsz);
+        i = j;
+    }
+}
+
+static inline void mask_edges_intra(uint16_t (*const masks)[32][3][2],
+                                    const int by4, const int bx4,
+                                    const int w4, const int h4,
+                                    const int skip_inter,
+                                    const enum RectTxfmSize tx,
+                                    uint8_t *const a, uint8_t *const l)
+{
+    const TxfmInfo *const t_dim = &av1_txfm_dimensions[tx];
+    const int twl4 = t_dim->lw, thl4 = t_dim->lh;
+    const int twl4c = imin(2, twl4), thl4c = imin(2, thl4);
+    int y, x;
+
+    // left block edge
+    mask_block_edge(masks[0][bx4], by4, h4, 16, twl4c, l);
+
+    // top block edge
+    mask_block_edge(masks[1][by4], bx4, w4, 16, thl4c, a);
+
+    if (!skip_inter) {
+        // inner (tx) left|right edges
+        const unsigned t_y = 1U << by4;
+        const unsigned inner_y = (((uint64_t) t_y) << h4) - t_y;
+        const int hstep = t_dim->w;
+        for (x = hstep; x < w4; x += hstep)
+            mask_bits(masks[0][bx4 + x][twl4c], inner_y, 16);
+
+        //            top
+        // inner (tx) --- edges
+        //           bottom
+        const unsigned t_x = 1U << bx4;
+        const unsigned inner_x = (((uint64_t) t_x) << w4) - t_x;
+        const int vstep = t_dim->h;
+        for (y = vstep; y < h4; y += vstep)
+            mask_bits(masks[1][by4 + y][thl4c], inner_x, 16);
+    }
+
+    memset(a, thl4c, w4);
+    memset(l, twl4c, h4);
+}
+
+static inline void mask_edges_inter(uint16_t (*const masks)[32][3][2],
                                     const int by4, const int bx4,
                                     const int w4, const int h4, const int skip,
                                     const enum RectTxfmSize max_tx,
                                     const uint16_t *const tx_masks,
                                     uint8_t *const a, uint8_t *const l)
 {
+    // without any transform split, the block is covered by max_tx
+    // transforms throughout, like an intra block
+    if (!tx_masks[0]) {
+        mask_edges_intra(masks, by4, bx4, w4, h4, skip, max_tx, a, l);
+        return;
+    }
+
     const TxfmInfo *const t_dim = &av1_txfm_dimensions[max_tx];
     int y, x;
 
@@ -98,30 +175,24 @@ static inline void mask_edges_inter(uint32_t (*masks)[32][3],
                       max_tx, 0, y_off, x_off, tx_masks);
 
     // left block edge
-    unsigned mask = 1U << bx4;
-    for (y = 0; y < h4; y++)
-        masks[0][by4 + y][imin(txa[0][0][y][0], l[y])] |= mask;
+    unsigned mask = 1U << by4;
+    for (y = 0; y < h4; y++, mask <<= 1)
+        mask_bits(masks[0][bx4][imin(txa[0][0][y][0], l[y])], mask, 16);
 
     // top block edge
-    for (x = 0; x < w4; x++, mask <<= 1)
-        masks[1][by4][imin(txa[1][0][0][x], a[x])] |= mask;
+    for (x = 0, mask = 1U << bx4; x < w4; x++, mask <<= 1)
+        mask_bits(masks[1][by4][imin(txa[1][0][0][x], a[x])], mask, 16);
 
     if (!skip) {
         // inner (tx) left|right edges
-        for (y = 0; y < h4; y++) {
+        for (y = 0, mask = 1U << by4; y < h4; y++, mask <<= 1) {
             int ltx = txa[0][0][y][0];
             int step = txa[0][1][y][0];
-            if (step < w4) {
-                x = step;
-                mask = 1U << (bx4 + step);
-                do {
-                    const int rtx = txa[0][0][y][x];
-                    masks[0][by4 + y][imin(rtx, ltx)] |= mask;
-                    ltx = rtx;
-                    step = txa[0][1][y][x];
-                    x += step;
-                    mask <<= step;
-                } while (x < w4);
+            for (x = step; x < w4; x += step) {
+                const int rtx = txa[0][0][y][x];
+                mask_bits(masks[0][bx4 + x][imin(rtx, ltx)], mask, 16);
+                ltx = rtx;
+                step = txa[0][1][y][x];
             }
         }
 
@@ -133,7 +204,7 @@ static inline void mask_edges_inter(uint32_t (*masks)[32][3],
             int step = txa[1][1][0][x];
             for (y = step; y < h4; y += step) {
                 const int btx = txa[1][0][y][x];
-                masks[1][by4 + y][imin(ttx, btx)] |= mask;
+                mask_bits(masks[1][by4 + y][imin(ttx, btx)], mask, 16);
                 ttx = btx;
                 step = txa[1][1][y][x];
             }
@@ -145,51 +216,10 @@ static inline void mask_edges_inter(uint32_t (*masks)[32][3],
     memcpy(a, txa[1][0][h4 - 1], w4);
 }
 
-static inline void mask_edges_intra(uint32_t (*const masks)[32][3],
-                                    const int by4, const int bx4,
-                                    const int w4, const int h4,
-                                    const enum RectTxfmSize tx,
-                                    uint8_t *const a, uint8_t *const l)
-{
-    const TxfmInfo *const t_dim = &av1_txfm_dimensions[tx];
-    const int twl4 = t_dim->lw, thl4 = t_dim->lh;
-    const int twl4c = imin(2, twl4), thl4c = imin(2, thl4);
-    int y, x;
-
-    // left block edge
-    unsigned mask = 1U << bx4;
-    for (y = 0; y < h4; y++)
-        masks[0][by4 + y][imin(twl4c, l[y])] |= mask;
-
-    // top block edge
-    for (mask = 1U << bx4, x = 0; x < w4; x++, mask <<= 1)
-        masks[1][by4][imin(thl4c, a[x])] |= mask;
-
-    static const uint32_t hstep[] = {
-        0xffffffff, 0x55555555, 0x11111111, 0x01010101, 0x00010001
-    };
-
-    // inner (tx) left|right edges
-    const unsigned t = 1U << bx4;
-    const unsigned inner = (((uint64_t) t) << w4) - t;
-    mask = (inner - t) & hstep[twl4];
-    for (y = 0; y < h4; y++)
-        masks[0][by4 + y][twl4c] |= mask;
-
-    //            top
-    // inner (tx) --- edges
-    //           bottom
-    const int vstep = t_dim->h;
-    for (y = vstep; y < h4; y += vstep)
-        masks[1][by4 + y][thl4c] |= inner;
-
-    memset(a, thl4c, w4);
-    memset(l, twl4c, h4);
-}
-
-static inline void mask_edges_chroma(uint32_t (*const masks)[32][2],
+static inline void mask_edges_chroma(uint16_t (*const masks)[32][2][2],
                                      const int cby4, const int cbx4,
                                      const int cw4, const int ch4,
+                                     const int ss_hor, const int ss_ver,
                                      const int skip_inter,
                                      const enum RectTxfmSize tx,
                                      uint8_t *const a, uint8_t *const l)
@@ -199,33 +229,30 @@ static inline void mask_edges_chroma(uint32_t (*const masks)[32][2],
     const int twl4c = !!twl4, thl4c = !!thl4;
     int y, x;
 
+    const int vsz = 16 >> ss_ver, hsz = 16 >> ss_hor;
+
     // left block edge
-    unsigned mask = 1U << cbx4;
-    for (y = 0; y < ch4; y++)
-        masks[0][cby4 + y][imin(twl4c, l[y])] |= mask;
+    mask_block_edge(masks[0][cbx4], cby4, ch4, vsz, twl4c, l);
 
     // top block edge
-    for (mask = 1U << cbx4, x = 0; x < cw4; x++, mask <<= 1)
-        masks[1][cby4][imin(thl4c, a[x])] |= mask;
+    mask_block_edge(masks[1][cby4], cbx4, cw4, hsz, thl4c, a);
 
     if (!skip_inter) {
-        static const uint32_t hstep[] = {
-            0xffffffff, 0x55555555, 0x11111111, 0x01010101
-        };
-
         // inner (tx) left|right edges
-        const int t = 1U << cbx4;
-        const unsigned inner = (((uint64_t) t) << cw4) - t;
-        mask = (inner - t) & hstep[twl4];
-        for (y = 0; y < ch4; y++)
-            masks[0][cby4 + y][twl4c] |= mask;
+        const unsigned t_y = 1U << cby4;
+        const unsigned inner_y = (((uint64_t) t_y) << ch4) - t_y;
+        const int hstep = t_dim->w;
+        for (x = hstep; x < cw4; x += hstep)
+            mask_bits(masks[0][cbx4 + x][twl4c], inner_y, vsz);
 
         //            top
         // inner (tx) --- edges
         //           bottom
+        const unsigned t_x = 1U << cbx4;
+        const unsigned inner_x = (((uint64_t) t_x) << cw4) - t_x;
         const int vstep = t_dim->h;
         for (y = vstep; y < ch4; y += vstep)
-            masks[1][cby4 + y][thl4c] |= inner;
+            mask_bits(masks[1][cby4 + y][thl4c], inner_x, hsz);
     }
 
     memset(a, thl4c, cw4);
@@ -255,18 +282,18 @@ void dav1d_create_lf_mask_intra(Av1Filter *const lflvl,
     const int bx4 = bx & 31;
     const int by4 = by & 31;
 
-    level_cache += by * b4_stride + bx;
-    for (int y = 0; y < bh4; y++) {
+    // the level stores may alias filter_level, so load it only once
+    const uint8_t lvl_y0 = filter_level[0][0][0];
+    const uint8_t lvl_y1 = filter_level[1][0][0];
+    uint8_t (*lvl)[4] = level_cache + by * b4_stride + bx;
+    for (int y = 0; y < bh4; y++, lvl += b4_stride) {
         for (int x = 0; x < bw4; x++) {
-            level_cache[x][0] = filter_level[0][0][0];
-            level_cache[x][1] = filter_level[1][0][0];
-            level_cache[x][2] = filter_level[2][0][0];
-            level_cache[x][3] = filter_level[3][0][0];
+            lvl[x][0] = lvl_y0;
+            lvl[x][1] = lvl_y1;
         }
-        level_cache += b4_stride;
     }
 
-    mask_edges_intra(lflvl->filter_y, by4, bx4, bw4, bh4, ytx, ay, ly);
+    mask_edges_intra(lflvl->filter_y, by4, bx4, bw4, bh4, 0, ytx, ay, ly);
 
     if (!auv) return;
 
@@ -277,7 +304,19 @@ void dav1d_create_lf_mask_intra(Av1Filter *const lflvl,
     const int cbx4 = bx4 >> ss_hor;
     const int cby4 = by4 >> ss_ver;
 
-    mask_edges_chroma(lflvl->filter_uv, cby4, cbx4, cbw4, cbh4, 0, uvtx, auv, luv);
+    // chroma levels are stored at chroma block positions
+    const uint8_t lvl_u = filter_level[2][0][0];
+    const uint8_t lvl_v = filter_level[3][0][0];
+    lvl = level_cache + (by >> ss_ver) * b4_stride + (bx >> ss_hor);
+    for (int y = 0; y < cbh4; y++, lvl += b4_stride) {
+        for (int x = 0; x < cbw4; x++) {
+            lvl[x][2] = lvl_u;
+            lvl[x][3] = lvl_v;
+        }
+    }
+
+    mask_edges_chroma(lflvl->filter_uv, cby4, cbx4, cbw4, cbh4,
+                      ss_hor, ss_ver, 0, uvtx, auv, luv);
 }
 
 void dav1d_create_lf_mask_inter(Av1Filter *const lflvl,
@@ -303,15 +342,15 @@ void dav1d_create_lf_mask_inter(Av1Filter *const lflvl,
     const int bx4 = bx & 31;
     const int by4 = by & 31;
 
-    level_cache += by * b4_stride + bx;
-    for (int y = 0; y < bh4; y++) {
+    // the level stores may alias filter_level, so load it only once
+    const uint8_t lvl_y0 = filter_level[0][0][0];
+    const uint8_t lvl_y1 = filter_level[1][0][0];
+    uint8_t (*lvl)[4] = level_cache + by * b4_stride + bx;
+    for (int y = 0; y < bh4; y++, lvl += b4_stride) {
         for (int x = 0; x < bw4; x++) {
-            level_cache[x][0] = filter_level[0][0][0];
-            level_cache[x][1] = filter_level[1][0][0];
-            level_cache[x][2] = filter_level[2][0][0];
-            level_cache[x][3] = filter_level[3][0][0];
+            lvl[x][0] = lvl_y0;
+            lvl[x][1] = lvl_y1;
         }
-        level_cache += b4_stride;
     }
 
     mask_edges_inter(lflvl->filter_y, by4, bx4, bw4, bh4, skip,
@@ -326,7 +365,19 @@ void dav1d_create_lf_mask_inter(Av1Filter *const lflvl,
     const int cbx4 = bx4 >> ss_hor;
     const int cby4 = by4 >> ss_ver;
 
-    mask_edges_chroma(lflvl->filter_uv, cby4, cbx4, cbw4, cbh4, skip, uvtx, auv, luv);
+    // chroma levels are stored at chroma block positions
+    const uint8_t lvl_u = filter_level[2][0][0];
+    const uint8_t lvl_v = filter_level[3][0][0];
+    lvl = level_cache + (by >> ss_ver) * b4_stride + (bx >> ss_hor);
+    for (int y = 0; y < cbh4; y++, lvl += b4_stride) {
+        for (int x = 0; x < cbw4; x++) {
+            lvl[x][2] = lvl_u;
+            lvl[x][3] = lvl_v;
+        }
+    }
+
+    mask_edges_chroma(lflvl->filter_uv, cby4, cbx4, cbw4, cbh4,
+                      ss_hor, ss_ver, skip, uvtx, auv, luv);
 }
 
 void dav1d_calc_eih(Av1FilterLUT *const lim_lut, const int filter_sharpness) {
@@ -346,6 +397,8 @@ void dav1d_calc_eih(Av1FilterLUT *const lim_lut, const int filter_sharpness) {
         lim_lut->i[level] = limit;
         lim_lut->e[level] = 2 * (level + 2) + limit;
     }
+    lim_lut->sharp[0] = (filter_sharpness + 3) >> 2;
+    lim_lut->sharp[1] = filter_sharpness ? 9 - filter_sharpness : 0xff;
 }
 
 static void dav1d_calc_lf_value(uint8_t (*const lflvl_values)[2],
@@ -36,6 +36,7 @@
 typedef struct Av1FilterLUT {
     uint8_t e[64];
     uint8_t i[64];
+    uint64_t sharp[2]; // I = imax(imin(L >> sharp[0], sharp[1]), 1), for SIMD
 } Av1FilterLUT;
 
 typedef struct Av1RestorationUnit {
@@ -48,9 +49,16 @@ typedef struct Av1RestorationUnit {
 
 // each struct describes one 128x128 area (1 or 4 SBs)
 typedef struct Av1Filter {
-    // each bit is 1 col
-    uint32_t filter_y[2 /* 0=col, 1=row */][32][3];
-    uint32_t filter_uv[2 /* 0=col, 1=row */][32][2];
+    // for col edges, mask[x] has 1 bit per row (y); for row edges, mask[y]
+    // has 1 bit per col (x), i.e. bits run along the edge in both cases.
+    // The bits are split in two words, one per half of the area along the
+    // edge (64 luma pixels, i.e. 16 units of 4px, or 16 >> ss for chroma):
+    // with 64x64 superblocks, the halves of a col are different sbrows, and
+    // those of a row may be different tile cols, so a half being deblocked,
+    // or written by one tile, never shares a word with blocks being decoded
+    // in the other half.
+    uint16_t filter_y[2 /* 0=col, 1=row */][32][3][2 /* half */];
+    uint16_t filter_uv[2 /* 0=col, 1=row */][32][2][2 /* half */];
     int8_t cdef_idx[4]; // -1 means "unset"
     uint32_t noskip_mask[32];
     Av1RestorationUnit lr[3][4];
@@ -28,8 +28,16 @@
 #include "config.h"
 #include "version.h"
 
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+#define _GNU_SOURCE
+#endif
+
 #include <errno.h>
+#include <stdio.h>
 #include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 #include "dav1d/dav1d.h"
 #include "dav1d/data.h"
@@ -37,23 +45,19 @@
 #include "common/mem.h"
 #include "common/validate.h"
 
+#include "src/decode.h"
 #include "src/internal.h"
+#include "src/log.h"
 #include "src/obu.h"
-#include "src/qm.h"
+#include "src/profile.h"
 #include "src/ref.h"
 #include "src/thread_task.h"
-#include "src/wedge.h"
-
-static void init_internal(void) {
-    av1_init_wedge_masks();
-    av1_init_interintra_masks();
-    av1_init_qm_tables();
-}
-
-static pthread_once_t initted = PTHREAD_ONCE_INIT;
 
 void dav1d_init(void) {
-    pthread_once(&initted, init_internal);
+    // the wedge, inter-intra and quantizer matrix tables are built by the
+    // first frame which needs them, see av1_init_wedge_masks() and
+    // av1_init_qm_tables(), so that processes which never decode such a
+    // frame don't spend the time nor touch the memory
 }
 
 const char *dav1d_version(void) {
@@ -61,73 +65,591 @@ const char *dav1d_version(void) {
 }
 
 void dav1d_default_settings(Dav1dSettings *const s) {
-    s->n_frame_threads = 1;
-    s->n_tile_threads = 1;
+    s->n_frame_threads = 0;
+    s->n_tile_threads = 0;
+    s->cpus = NULL;
+    s->n_cpus = 0;
+    s->thread_pool = NULL;
+    s->max_frame_delay = 0;
+    s->low_latency = 0;
+    s->parse_ahead = 0;
+    s->spin_wait = 0;
+    s->performance_cores = 1;
+    s->max_pooled_pictures = 0;
+    s->allocator.cookie = NULL;
+    s->allocator.alloc_picture = NULL;
+    s->allocator.release_picture = NULL;
+    s->low_memory = 0;
+    s->hugepages = 0;
+    s->picture_ready = NULL;
+    s->picture_ready_cookie = NULL;
+    s->decode_frame_type = DAV1D_DECODEFRAMETYPE_ALL;
+    s->operating_point = 0;
+    s->decode_region = (Dav1dRect) { 0, 0, 0, 0 };
+    s->apply_grain = 1;
+    s->post_filter.cookie = NULL;
+    s->post_filter.filter_sbrow = NULL;
+    s->nonref_filters = DAV1D_NONREFFILTERS_ALL;
+    s->frame_stats = 0;
+    s->export_block_info = 0;
+    s->output_format = DAV1D_OUTPUTFORMAT_PLANAR;
+    s->trace = NULL;
+    s->trace_cookie = NULL;
+    s->log = dav1d_log_default_callback;
+    s->log_cookie = NULL;
 }
 
-int dav1d_open(Dav1dContext **const c_out,
-               const Dav1dSettings *const s)
+static int num_logical_processors(void) {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetNativeSystemInfo(&si);
+    return si.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    return (int) sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    return 1;
+#endif
+}
+
+static void set_thread_affinity(const pthread_t thread,
+                                const Dav1dSettings *const s)
 {
-    validate_input_or_ret(c_out != NULL, -EINVAL);
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+    if (!s->n_cpus) return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int n = 0; n < s->n_cpus; n++)
+        if (s->cpus[n] < CPU_SETSIZE)
+            CPU_SET(s->cpus[n], &set);
+    pthread_setaffinity_np(thread, sizeof(set), &set);
+#else
+    (void) thread;
+    (void) s;
+#endif
+}
+
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+// Reads a list of logical processors like "0-7,16,18" from a sysfs file.
+static int read_cpu_list(const char *const path, cpu_set_t *const set) {
+    FILE *const file = fopen(path, "r");
+    if (!file) return 0;
+
+    CPU_ZERO(set);
+    int first, last, n = 0;
+    while (fscanf(file, "%d", &first) == 1) {
+        last = first;
+        int sep = fgetc(file);
+        if (sep == '-') {
+            if (fscanf(file, "%d", &last) != 1) break;
+            sep = fgetc(file);
+        }
+        for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++, n++)
+            CPU_SET(cpu, set);
+        if (sep != ',') break;
+    }
+    fclose(file);
+    return n;
+}
+
+// Finds the faster cores of a processor with cores of different speeds, as
+// reported by Linux: the cores of Intel's hybrid processors have their own
+// PMU, and ARM's have a relative cpu_capacity (of 1024 for the fastest),
+// where mid cores count as fast and little ones (below half) as slow.
+// Returns 0 if all cores are alike.
+static int performance_cores(cpu_set_t *const set) {
+    cpu_set_t atom;
+    if (read_cpu_list("/sys/devices/cpu_core/cpus", set))
+        return read_cpu_list("/sys/devices/cpu_atom/cpus", &atom) > 0;
+
+    int capacity[CPU_SETSIZE], max_capacity = 0;
+    const int n_cpus = imin((int) sysconf(_SC_NPROCESSORS_CONF), CPU_SETSIZE);
+    for (int cpu = 0; cpu < n_cpus; cpu++) {
+        char path[64];
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%d/cpu_capacity", cpu);
+        FILE *const file = fopen(path, "r");
+        capacity[cpu] = 0;
+        if (!file) continue;
+        if (fscanf(file, "%d", &capacity[cpu]) != 1) capacity[cpu] = 0;
+        fclose(file);
+        max_capacity = imax(max_capacity, capacity[cpu]);
+    }
+    CPU_ZERO(set);
+    int slow = 0;
+    for (int cpu = 0; cpu < n_cpus; cpu++) {
+        if (!capacity[cpu]) continue;
+        if (capacity[cpu] * 2 >= max_capacity)
+            CPU_SET(cpu, set);
+        else
+            slow = 1;
+    }
+    return slow;
+}
+#endif
+
+// Like set_thread_affinity(), but also keeping the thread on the faster
+// cores if those differ (see Dav1dSettings.performance_cores), for threads
+// whose serial work the other threads wait for.
+static void set_thread_affinity_fast(const pthread_t thread,
+                                     const Dav1dSettings *const s)
+{
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+    cpu_set_t fast;
+    if (!s->performance_cores || !performance_cores(&fast)) {
+        set_thread_affinity(thread, s);
+        return;
+    }
+    if (s->n_cpus) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int n = 0; n < s->n_cpus; n++)
+            if (s->cpus[n] < CPU_SETSIZE)
+                CPU_SET(s->cpus[n], &set);
+        CPU_AND(&fast, &fast, &set);
+        // none of the permitted cores is fast
+        if (!CPU_COUNT(&fast)) fast = set;
+    }
+    pthread_setaffinity_np(thread, sizeof(fast), &fast);
+#else
+    set_thread_affinity(thread, s);
+#endif
+}
+
+static void free_tile_context(Dav1dTileContext *const t) {
+    // also holds scratch and emu_edge, see dav1d_tile_context_alloc()
+    dav1d_free_aligned(t->cf);
+}
+
+// bytes held by a tile context, including its lazily allocated buffers;
+// as these only grow, this is also the peak
+static size_t tile_context_mem_sz(Dav1dTileContext *const t) {
+    return sizeof(*t) + atomic_load(&t->buf_sz);
+}
+
+static int validate_thread_settings(const Dav1dSettings *const s) {
+    validate_input_or_ret(s->n_tile_threads >= 0 &&
+                          s->n_tile_threads <= 256, -EINVAL);
+    validate_input_or_ret(s->n_cpus >= 0, -EINVAL);
+    validate_input_or_ret(!s->n_cpus || s->cpus != NULL, -EINVAL);
+    for (int n = 0; n < s->n_cpus; n++)
+        validate_input_or_ret(s->cpus[n] >= 0, -EINVAL);
+    return 0;
+}
+
+// 0 means auto: the shared tile workers (which also run the post-filter)
+// get one thread per logical processor, and enough frames are decoded
+// in parallel to keep them busy when tiling or references limit how
+// much work each frame has available; since the workers serve all
+// frames, no re-adjustment to the tiling layout of the stream is needed
+static int num_cpus(const Dav1dSettings *const s) {
+    return s->n_cpus ? s->n_cpus : imax(num_logical_processors(), 1);
+}
+
+int dav1d_get_memory_stats(Dav1dContext *const c,
+                           Dav1dMemoryStats *const stats)
+{
+    validate_input_or_ret(c != NULL, -EINVAL);
+    validate_input_or_ret(stats != NULL, -EINVAL);
+
+    pthread_mutex_lock(&c->mem.lock);
+    for (int i = 0; i < DAV1D_MEM_NUM_CATEGORIES; i++) {
+        stats->current[i] = c->mem.cur[i];
+        stats->peak[i] = c->mem.peak[i];
+    }
+    pthread_mutex_unlock(&c->mem.lock);
+
+    if (c->picture_pool)
+        dav1d_mem_pool_get_usage(c->picture_pool,
+                                 &stats->current[DAV1D_MEM_PICTURES],
+                                 &stats->peak[DAV1D_MEM_PICTURES]);
+    size_t cur, peak;
+    dav1d_mem_pool_get_usage(c->refmvs_pool, &cur, &peak);
+    stats->current[DAV1D_MEM_BLOCK_DATA] = cur;
+    stats->peak[DAV1D_MEM_BLOCK_DATA] = peak;
+    dav1d_mem_pool_get_usage(c->segmap_pool, &cur, &peak);
+    stats->current[DAV1D_MEM_BLOCK_DATA] += cur;
+    stats->peak[DAV1D_MEM_BLOCK_DATA] += peak;
+    if (c->block_info_pool) {
+        dav1d_mem_pool_get_usage(c->block_info_pool, &cur, &peak);
+        stats->current[DAV1D_MEM_BLOCK_DATA] += cur;
+        stats->peak[DAV1D_MEM_BLOCK_DATA] += peak;
+    }
+
+    size_t tc_sz = c->tc ? tile_context_mem_sz(c->tc) : 0;
+    for (int n = 0; n < c->n_fc; n++)
+        tc_sz += tile_context_mem_sz(c->fc[n].tc);
+    if (c->own_pool && c->pool->n_tc > 1)
+        for (int m = 0; m < c->pool->n_tc; m++)
+            tc_sz += tile_context_mem_sz(&c->pool->tc[m]);
+    stats->current[DAV1D_MEM_TILE_CONTEXTS] =
+        stats->peak[DAV1D_MEM_TILE_CONTEXTS] = tc_sz;
+
+    stats->total = 0;
+    for (int i = 0; i < DAV1D_MEM_NUM_CATEGORIES; i++)
+        stats->total += stats->current[i];
+
+    return 0;
+}
+
+int dav1d_get_wait_stats(Dav1dContext *const c, Dav1dWaitStats *const stats) {
+    validate_input_or_ret(c != NULL, -EINVAL);
+    validate_input_or_ret(stats != NULL, -EINVAL);
+
+    pthread_mutex_lock(&c->waits.lock);
+    for (int i = 0; i < DAV1D_WAIT_NUM_TYPES; i++) {
+        stats->count[i] = c->waits.count[i];
+        stats->nanos[i] = c->waits.nanos[i];
+    }
+    pthread_mutex_unlock(&c->waits.lock);
+
+    return 0;
+}
+
+#if CONFIG_PROFILING
+PROF_THREAD_LOCAL Dav1dProfile *dav1d_prof_cur;
+
+static void add_profile(Dav1dProfile *const dst, const Dav1dProfile *const src) {
+    for (int i = 0; i < DAV1D_PROF_NUM_STAGES; i++) {
+        dst->ticks[i] += src->ticks[i];
+        dst->calls[i] += src->calls[i];
+    }
+}
+#endif
+
+int dav1d_get_profile(Dav1dContext *const c, Dav1dProfile *const prof) {
+    validate_input_or_ret(c != NULL, -EINVAL);
+    validate_input_or_ret(prof != NULL, -EINVAL);
+
+    memset(prof, 0, sizeof(*prof));
+#if CONFIG_PROFILING
+    add_profile(prof, &c->prof);
+    for (int n = 0; n < c->n_fc; n++)
+        add_profile(prof, &c->fc[n].tc->prof);
+    if (c->pool->n_tc > 1)
+        for (int m = 0; m < c->pool->n_tc; m++)
+            add_profile(prof, &c->pool->tc[m].prof);
+    return 0;
+#else
+    return -ENOSYS;
+#endif
+}
+
+int dav1d_thread_pool_create(Dav1dThreadPool **const pool_out,
+                             const Dav1dSettings *const s)
+{
+    validate_input_or_ret(pool_out != NULL, -EINVAL);
     validate_input_or_ret(s != NULL, -EINVAL);
-    validate_input_or_ret(s->n_tile_threads >= 1 &&
-                          s->n_tile_threads <= 64, -EINVAL);
-    validate_input_or_ret(s->n_frame_threads >= 1 &&
-                          s->n_frame_threads <= 256, -EINVAL);
+    const int res = validate_thread_settings(s);
+    if (res < 0) return res;
 
-    Dav1dContext *const c = *c_out = dav1d_alloc_aligned(sizeof(*c), 32);
-    if (!c) goto error;
-    memset(c, 0, sizeof(*c));
+    Dav1dThreadPool *const pool = *pool_out =
+        dav1d_alloc_aligned(sizeof(*pool), 64);
+    if (!pool) goto error;
+    memset(pool, 0, sizeof(*pool));
+
+    pool->n_tc = s->n_tile_threads ? s->n_tile_threads :
+                                     imin(num_cpus(s), 256);
+    if (pool->n_tc > 1) {
+        pthread_mutex_init(&pool->ttd.lock, NULL);
+        pthread_cond_init(&pool->ttd.cond, NULL);
+        pthread_cond_init(&pool->ttd.wf_cond, NULL);
+        pool->tc = dav1d_alloc_aligned(sizeof(*pool->tc) * pool->n_tc, 64);
+        if (!pool->tc) goto error;
+        memset(pool->tc, 0, sizeof(*pool->tc) * pool->n_tc);
+        for (int m = 0; m < pool->n_tc; m++) {
+            Dav1dTileContext *const t = &pool->tc[m];
+            t->tile_thread.ttd = &pool->ttd;
+            t->trace_thread = -1 - m;
+            pthread_create(&t->tile_thread.td.thread, NULL, dav1d_tile_task, t);
+            set_thread_affinity(t->tile_thread.td.thread, s);
+        }
+    }
+
+    return 0;
+
+error:
+    if (pool) {
+        if (pool->tc) dav1d_free_aligned(pool->tc);
+        dav1d_freep_aligned(pool_out);
+    }
+    return -ENOMEM;
+}
+
+void dav1d_thread_pool_destroy(Dav1dThreadPool **const pool_out) {
+    validate_input(pool_out != NULL);
+
+    Dav1dThreadPool *const pool = *pool_out;
+    if (!pool) return;
+
+    if (pool->n_tc > 1) {
+        // all decoder instances using the pool are closed, so the workers
+        // are (or will soon be) idle
+        pthread_mutex_lock(&pool->ttd.lock);
+        pool->ttd.die = 1;
+        pthread_cond_broadcast(&pool->ttd.cond);
+        pthread_mutex_unlock(&pool->ttd.lock);
+        for (int m = 0; m < pool->n_tc; m++) {
+            Dav1dTileContext *const t = &pool->tc[m];
+            pthread_join(t->tile_thread.td.thread, NULL);
+            free_tile_context(t);
+        }
+        dav1d_free_aligned(pool->tc);
+        pthread_mutex_destroy(&pool->ttd.lock);
+        pthread_cond_destroy(&pool->ttd.cond);
+        pthread_cond_destroy(&pool->ttd.wf_cond);
+    }
+    dav1d_freep_aligned(pool_out);
+}
+
+// number of frame contexts (and frame threads, if more than one)
+static int num_frame_threads(const Dav1dSettings *const s,
+                             const int low_memory)
+{
+    int n_fc = s->n_frame_threads;
+    if (!n_fc && low_memory) {
+        n_fc = 1;
+    } else if (!n_fc) {
+        const int n_cpu = num_cpus(s);
+        n_fc = 1;
+        while (n_fc < 8 && n_fc * n_fc < n_cpu) n_fc++;
+    }
+    // each frame thread holds one frame in flight
+    if (s->max_frame_delay)
+        n_fc = imin(n_fc, s->max_frame_delay);
+    return n_fc;
+}
+
+// Sets up the tile workers (own or shared) and n_fc frame contexts, and
+// starts the frame threads once everything is allocated, so that a failure
+// leaves nothing running that free_threads() would have to stop.
+static int init_threads(Dav1dContext *const c, const Dav1dSettings *const s,
+                        const int n_fc)
+{
+    if (s->thread_pool) {
+        c->pool = s->thread_pool;
+        c->own_pool = 0;
+    } else {
+        if (dav1d_thread_pool_create(&c->pool, s) < 0) return -ENOMEM;
+        c->own_pool = 1;
+    }
+    c->parse_ahead = s->parse_ahead && n_fc == 1 && c->pool->n_tc > 1;
 
-    c->n_fc = s->n_frame_threads;
-    c->fc = dav1d_alloc_aligned(sizeof(*c->fc) * s->n_frame_threads, 32);
-    if (!c->fc) goto error;
-    memset(c->fc, 0, sizeof(*c->fc) * s->n_frame_threads);
+    c->fc = dav1d_alloc_aligned(sizeof(*c->fc) * n_fc, 64);
+    if (!c->fc) return -ENOMEM;
+    memset(c->fc, 0, sizeof(*c->fc) * n_fc);
+    c->n_fc = n_fc;
+    c->frame_thread.next = 0;
     if (c->n_fc > 1) {
         c->frame_thread.out_delayed =
-            malloc(sizeof(*c->frame_thread.out_delayed) * c->n_fc);
-        memset(c->frame_thread.out_delayed, 0,
-               sizeof(*c->frame_thread.out_delayed) * c->n_fc);
+            calloc(c->n_fc, sizeof(*c->frame_thread.out_delayed));
+        if (!c->frame_thread.out_delayed) return -ENOMEM;
+        c->frame_thread.low_latency = s->low_latency && !c->picture_ready.callback;
+        atomic_init(&c->frame_thread.flush, 0);
+        c->picture_ready.slots = c->frame_thread.out_delayed;
+        c->picture_ready.n_slots = c->n_fc;
+        c->picture_ready.head = 0;
+        c->picture_ready.finished = calloc(c->n_fc, 1);
+        if (!c->picture_ready.finished) return -ENOMEM;
+        if (c->pool->n_tc > 1) {
+            c->tc = dav1d_alloc_aligned(sizeof(*c->tc), 64);
+            if (!c->tc) return -ENOMEM;
+            memset(c->tc, 0, sizeof(*c->tc));
+        }
     }
-    for (int n = 0; n < s->n_frame_threads; n++) {
+    for (int n = 0; n < c->n_fc; n++) {
         Dav1dFrameContext *const f = &c->fc[n];
+        f->tc = dav1d_alloc_aligned(sizeof(*f->tc), 64);
+        if (!f->tc) return -ENOMEM;
+        memset(f->tc, 0, sizeof(*f->tc));
         f->c = c;
+        f->mem = &c->mem;
+        f->waits = &c->waits;
+        f->picture_ready = &c->picture_ready;
         f->lf.last_sharpness = -1;
-        f->n_tc = s->n_tile_threads;
-        f->tc = dav1d_alloc_aligned(sizeof(*f->tc) * s->n_tile_threads, 32);
-        if (!f->tc) goto error;
-        memset(f->tc, 0, sizeof(*f->tc) * s->n_tile_threads);
+        f->n_tc = c->pool->n_tc;
+        f->tc->f = f;
+        f->tc->trace_thread = c->n_fc > 1 ? 1 + n : 0;
+        f->frame_thread.td.spin.max = f->tile_thread.spin.max = s->spin_wait;
         if (f->n_tc > 1) {
-            pthread_mutex_init(&f->tile_thread.lock, NULL);
-            pthread_cond_init(&f->tile_thread.cond, NULL);
+            f->tile_thread.ttd = &c->pool->ttd;
             pthread_cond_init(&f->tile_thread.icond, NULL);
         }
-        for (int m = 0; m < s->n_tile_threads; m++) {
-            Dav1dTileContext *const t = &f->tc[m];
-            t->f = f;
-            t->cf = dav1d_alloc_aligned(32 * 32 * sizeof(int32_t), 32);
-            if (!t->cf) goto error;
-            t->scratch.mem = dav1d_alloc_aligned(128 * 128 * 8, 32);
-            if (!t->scratch.mem) goto error;
-            memset(t->cf, 0, 32 * 32 * sizeof(int32_t));
-            t->emu_edge =
-                dav1d_alloc_aligned(160 * (128 + 7) * sizeof(uint16_t), 32);
-            if (!t->emu_edge) goto error;
-            if (f->n_tc > 1) {
-                pthread_mutex_init(&t->tile_thread.td.lock, NULL);
-                pthread_cond_init(&t->tile_thread.td.cond, NULL);
-                t->tile_thread.fttd = &f->tile_thread;
-                pthread_create(&t->tile_thread.td.thread, NULL, dav1d_tile_task, t);
-            }
-        }
-        f->libaom_cm = av1_alloc_ref_mv_common();
-        if (c->n_fc > 1) {
+    }
+    if (c->n_fc > 1) {
+        for (int n = 0; n < c->n_fc; n++) {
+            Dav1dFrameContext *const f = &c->fc[n];
             pthread_mutex_init(&f->frame_thread.td.lock, NULL);
             pthread_cond_init(&f->frame_thread.td.cond, NULL);
             pthread_create(&f->frame_thread.td.thread, NULL, dav1d_frame_task, f);
+            set_thread_affinity_fast(f->frame_thread.td.thread, s);
         }
     }
 
+    return 0;
+}
+
+// Stops the frame threads, which must be idle (see dav1d_flush()).
+static void join_frame_threads(Dav1dContext *const c) {
+    if (c->n_fc == 1) return;
+
+    for (int n = 0; n < c->n_fc; n++) {
+        Dav1dFrameContext *const f = &c->fc[n];
+        pthread_mutex_lock(&f->frame_thread.td.lock);
+        f->frame_thread.die = 1;
+        pthread_cond_signal(&f->frame_thread.td.cond);
+        pthread_mutex_unlock(&f->frame_thread.td.lock);
+        pthread_join(f->frame_thread.td.thread, NULL);
+        pthread_mutex_destroy(&f->frame_thread.td.lock);
+        pthread_cond_destroy(&f->frame_thread.td.cond);
+    }
+}
+
+// Frees what init_threads() set up (also after it failed halfway), once the
+// frame threads are stopped; the profiles and DSP statistics of the threads
+// are kept in c, and the own tile workers are stopped.
+static void free_threads(Dav1dContext *const c) {
+    if (c->frame_thread.out_delayed) {
+        for (int n = 0; n < c->n_fc; n++)
+            if (c->frame_thread.out_delayed[n].p.data[0])
+                dav1d_thread_picture_unref(&c->frame_thread.out_delayed[n]);
+        free(c->frame_thread.out_delayed);
+        c->frame_thread.out_delayed = NULL;
+    }
+    free(c->picture_ready.finished);
+    c->picture_ready.finished = NULL;
+    c->picture_ready.slots = NULL;
+    c->picture_ready.n_slots = 0;
+    for (int n = 0; n < c->n_fc; n++) {
+        Dav1dFrameContext *const f = &c->fc[n];
+        if (!f->tc) break;
+
+        if (f->n_tc > 1)
+            pthread_cond_destroy(&f->tile_thread.icond);
+#if CONFIG_PROFILING
+        add_profile(&c->prof, &f->tc->prof);
+#endif
+#if CONFIG_DSP_STATS
+        dav1d_dsp_stats_add(&c->dsp_stats, &f->tc->dsp_stats);
+#endif
+        pthread_mutex_lock(&c->mem.lock);
+        for (int i = 0; i < DAV1D_MEM_NUM_CATEGORIES; i++)
+            c->mem.cur[i] -= f->mem_sz[i];
+        pthread_mutex_unlock(&c->mem.lock);
+        free_tile_context(f->tc);
+        dav1d_free_aligned(f->ts);
+        dav1d_free_aligned(f->tc);
+        dav1d_free_aligned(f->arena.mem);
+        av1_free_refmvs_frame(&f->rf);
+    }
+    if (c->fc) dav1d_freep_aligned(&c->fc);
+    c->n_fc = 0;
+    if (c->own_pool && c->pool) {
+#if CONFIG_PROFILING
+        if (c->pool->n_tc > 1)
+            for (int m = 0; m < c->pool->n_tc; m++)
+                add_profile(&c->prof, &c->pool->tc[m].prof);
+#endif
+#if CONFIG_DSP_STATS
+        if (c->pool->n_tc > 1)
+            for (int m = 0; m < c->pool->n_tc; m++)
+                dav1d_dsp_stats_add(&c->dsp_stats, &c->pool->tc[m].dsp_stats);
+#endif
+        dav1d_thread_pool_destroy(&c->pool);
+    }
+    c->pool = NULL;
+    c->own_pool = 0;
+    if (c->tc) {
+        free_tile_context(c->tc);
+        dav1d_freep_aligned(&c->tc);
+    }
+}
+
+int dav1d_open(Dav1dContext **const c_out,
+               const Dav1dSettings *const s)
+{
+    validate_input_or_ret(c_out != NULL, -EINVAL);
+    validate_input_or_ret(s != NULL, -EINVAL);
+    validate_input_or_ret(s->n_frame_threads >= 0 &&
+                          s->n_frame_threads <= 256, -EINVAL);
+    validate_input_or_ret(s->max_frame_delay >= 0 &&
+                          s->max_frame_delay <= 256, -EINVAL);
+    validate_input_or_ret(s->max_pooled_pictures >= 0, -EINVAL);
+    validate_input_or_ret(s->spin_wait >= 0, -EINVAL);
+    validate_input_or_ret(!s->allocator.alloc_picture ==
+                          !s->allocator.release_picture, -EINVAL);
+    validate_input_or_ret(s->decode_frame_type >= DAV1D_DECODEFRAMETYPE_ALL &&
+                          s->decode_frame_type <= DAV1D_DECODEFRAMETYPE_KEY,
+                          -EINVAL);
+    validate_input_or_ret(s->operating_point >= 0 &&
+                          s->operating_point <= 31, -EINVAL);
+    validate_input_or_ret(s->decode_region.x >= 0 && s->decode_region.y >= 0 &&
+                          s->decode_region.w >= 0 && s->decode_region.h >= 0,
+                          -EINVAL);
+    validate_input_or_ret(s->nonref_filters >= DAV1D_NONREFFILTERS_ALL &&
+                          s->nonref_filters <= DAV1D_NONREFFILTERS_NONE,
+                          -EINVAL);
+    validate_input_or_ret(s->output_format >= DAV1D_OUTPUTFORMAT_PLANAR &&
+                          s->output_format <= DAV1D_OUTPUTFORMAT_SEMIPLANAR,
+                          -EINVAL);
+    const int res = validate_thread_settings(s);
+    if (res < 0) return res;
+
+    const int n_fc = num_frame_threads(s, s->low_memory);
+
+    Dav1dContext *const c = *c_out = dav1d_alloc_aligned(sizeof(*c), 32);
+    if (!c) goto error;
+    memset(c, 0, sizeof(*c));
+    c->logger.callback = s->log;
+    c->logger.cookie = s->log_cookie;
+    pthread_mutex_init(&c->mem.lock, NULL);
+    pthread_mutex_init(&c->waits.lock, NULL);
+    pthread_mutex_init(&c->input.lock, NULL);
+    pthread_mutex_init(&c->picture_ready.lock, NULL);
+    c->picture_ready.callback = s->picture_ready;
+    c->picture_ready.cookie = s->picture_ready_cookie;
+
+    c->allocator = s->allocator;
+    c->decode_frame_type = s->decode_frame_type;
+    c->operating_point = s->operating_point;
+    c->decode_region = s->decode_region;
+    c->apply_grain = s->apply_grain;
+    c->post_filter = s->post_filter;
+    c->nonref_filters = s->nonref_filters;
+    c->frame_stats = s->frame_stats;
+    c->export_block_info = s->export_block_info;
+    c->output_format = s->output_format;
+    c->trace.callback = s->trace;
+    c->trace.cookie = s->trace_cookie;
+    c->low_memory = s->low_memory;
+    c->hugepages = s->hugepages;
+    if (!(c->dsp = dav1d_get_dsp_tables())) goto error;
+    // 8 references, plus one per frame thread (and the output picture); in
+    // low-memory mode, just enough to not allocate for every frame
+    const int max_pooled = s->low_memory ? 1 : 8 + n_fc;
+    const int max_pooled_pictures =
+        s->max_pooled_pictures ? s->max_pooled_pictures :
+        s->low_memory ? 1 : 8 + n_fc + 1;
+    if (!c->allocator.alloc_picture &&
+        dav1d_mem_pool_init(&c->picture_pool, max_pooled_pictures,
+                            s->hugepages) < 0)
+    {
+        goto error;
+    }
+    if (dav1d_mem_pool_init(&c->refmvs_pool, max_pooled, 0) < 0 ||
+        dav1d_mem_pool_init(&c->segmap_pool, max_pooled, 0) < 0)
+    {
+        goto error;
+    }
+    // held by the pictures, like their pixels
+    if (c->export_block_info &&
+        dav1d_mem_pool_init(&c->block_info_pool, max_pooled_pictures, 0) < 0)
+    {
+        goto error;
+    }
+
+    if (init_threads(c, s, n_fc) < 0) goto error;
+
     // intra edge tree
     c->intra_edge.root[BL_128X128] = &c->intra_edge.branch_sb128[0].node;
     init_mode_tree(c->intra_edge.root[BL_128X128], c->intra_edge.tip_sb128, 1);
@@ -138,18 +660,93 @@ int dav1d_open(Dav1dContext **const c_out,
 
 error:
     if (c) {
-        if (c->fc) {
-            for (int n = 0; n < c->n_fc; n++)
-                if (c->fc[n].tc)
-                    dav1d_free_aligned(c->fc[n].tc);
-            dav1d_free_aligned(c->fc);
-        }
+        dav1d_log(c, "Failed to allocate memory: %s\n", strerror(errno));
+        free_threads(c);
+        dav1d_mem_pool_close(&c->picture_pool);
+        dav1d_mem_pool_close(&c->refmvs_pool);
+        dav1d_mem_pool_close(&c->segmap_pool);
+        dav1d_mem_pool_close(&c->block_info_pool);
+        pthread_mutex_destroy(&c->mem.lock);
+        pthread_mutex_destroy(&c->waits.lock);
+        pthread_mutex_destroy(&c->input.lock);
+        pthread_mutex_destroy(&c->picture_ready.lock);
         dav1d_freep_aligned(c_out);
     }
-    fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
     return -ENOMEM;
 }
 
+// Moves the oldest queued picture into c->out if it has finished decoding,
+// skipping (invisible or flushed) ones that are not output; the queue runs
+// in submission order from c->frame_thread.next.
+static void output_decoded_picture(Dav1dContext *const c) {
+    for (int n = 0; n < c->n_fc && !c->out.data[0]; n++) {
+        Dav1dThreadPicture *const out_delayed =
+            &c->frame_thread.out_delayed[(c->frame_thread.next + n) % c->n_fc];
+
+        if (!out_delayed->p.data[0]) continue;
+        if (!dav1d_thread_picture_done(out_delayed)) break;
+        if (out_delayed->visible && !out_delayed->flushed)
+            dav1d_picture_ref(&c->out, &out_delayed->p);
+        dav1d_thread_picture_unref(out_delayed);
+    }
+}
+
+static int output_picture(Dav1dContext *const c, Dav1dPicture *const out) {
+    const int res = dav1d_output_image(c, out, &c->out);
+    dav1d_picture_unref(&c->out);
+    return res;
+}
+
+// Whether c->out holds a picture to return; with a picture_ready callback,
+// it is passed to that instead (with frame threading, the frame threads do
+// so, and c->out remains empty).
+static int output_picture_ready(Dav1dContext *const c) {
+    if (!c->out.data[0]) return 0;
+    if (!c->picture_ready.callback) return 1;
+
+    Dav1dPicture p = { 0 };
+    // without memory for the grain or conversion, pass the picture as is
+    if (dav1d_output_image(c, &p, &c->out) < 0)
+        dav1d_picture_ref(&p, &c->out);
+    dav1d_picture_unref(&c->out);
+    c->picture_ready.callback(&p, c->picture_ready.cookie);
+    return 0;
+}
+
+// Waits for the frame threads in submission order, and returns the first
+// picture that is output, or -EAGAIN once all of them are idle.
+static int drain_picture(Dav1dContext *const c, Dav1dPicture *const out) {
+    if (c->n_fc == 1) return -EAGAIN;
+
+    // the stream ends in the middle of a frame
+    if (c->frame_thread.tile_f)
+        dav1d_submit_tile_data(c, 1);
+
+    int flush_count = 0;
+    do {
+        const unsigned next = c->frame_thread.next;
+        Dav1dFrameContext *const f = &c->fc[next];
+
+        dav1d_frame_thread_wait_idle(f, c->tc);
+        pthread_mutex_unlock(&f->frame_thread.td.lock);
+        Dav1dThreadPicture *const out_delayed =
+            &c->frame_thread.out_delayed[next];
+        if (++c->frame_thread.next == c->n_fc)
+            c->frame_thread.next = 0;
+        if (out_delayed->p.data[0]) {
+            int res = 0;
+            if (out_delayed->visible && !out_delayed->flushed)
+                res = dav1d_output_image(c, out, &out_delayed->p);
+            dav1d_thread_picture_unref(out_delayed);
+            if (res < 0 || out->data[0]) {
+                return res;
+            }
+            // else continue
+        }
+    } while (++flush_count < c->n_fc);
+    return -EAGAIN;
+}
+
 int dav1d_decode(Dav1dContext *const c,
                  Dav1dData *const in, Dav1dPicture *const out)
 {
@@ -158,37 +755,8 @@ int dav1d_decode(Dav1dContext *const c,
     validate_input_or_ret(c != NULL, -EINVAL);
     validate_input_or_ret(out != NULL, -EINVAL);
 
-    if (!in) {
-        if (c->n_fc == 1) return -EAGAIN;
-
-        // flush
-        int flush_count = 0;
-        do {
-            const unsigned next = c->frame_thread.next;
-            Dav1dFrameContext *const f = &c->fc[next];
-
-            pthread_mutex_lock(&f->frame_thread.td.lock);
-            while (f->n_tile_data > 0)
-                pthread_cond_wait(&f->frame_thread.td.cond,
-                                  &f->frame_thread.td.lock);
-            pthread_mutex_unlock(&f->frame_thread.td.lock);
-            Dav1dThreadPicture *const out_delayed =
-                &c->frame_thread.out_delayed[next];
-            if (++c->frame_thread.next == c->n_fc)
-                c->frame_thread.next = 0;
-            if (out_delayed->p.data[0]) {
-                if (out_delayed->visible && !out_delayed->flushed) {
-                    dav1d_picture_ref(out, &out_delayed->p);
-                }
-                dav1d_thread_picture_unref(out_delayed);
-                if (out->data[0]) {
-                    return 0;
-                }
-                // else continue
-            }
-        } while (++flush_count < c->n_fc);
-        return -EAGAIN;
-    }
+    dav1d_prof_set(&c->prof);
+    if (!in) return drain_picture(c, out);
 
     while (in->sz > 0) {
         if ((res = parse_obus(c, in)) < 0)
@@ -197,107 +765,233 @@ int dav1d_decode(Dav1dContext *const c,
         assert(res <= in->sz);
         in->sz -= res;
         in->data += res;
-        if (c->out.data[0]) {
+        if (output_picture_ready(c)) {
             if (!in->sz) dav1d_data_unref(in);
-            dav1d_picture_ref(out, &c->out);
-            dav1d_picture_unref(&c->out);
-            return 0;
+            return output_picture(c, out);
         }
     }
 
-    if (c->out.data[0]) {
-        dav1d_picture_ref(out, &c->out);
-        dav1d_picture_unref(&c->out);
-        return 0;
-    }
+    if (c->frame_thread.low_latency)
+        output_decoded_picture(c);
+
+    if (output_picture_ready(c))
+        return output_picture(c, out);
 
     return -EAGAIN;
 }
 
-void dav1d_flush(Dav1dContext *const c) {
-    if (c->n_fc == 1) return;
+int dav1d_send_data(Dav1dContext *const c, Dav1dData *const in) {
+    validate_input_or_ret(c != NULL, -EINVAL);
+    validate_input_or_ret(!in || (in->data != NULL && in->sz > 0), -EINVAL);
 
-    for (int n = 0; n < c->n_fc; n++)
-        c->frame_thread.out_delayed[n].flushed = 1;
+    int res = 0;
+    pthread_mutex_lock(&c->input.lock);
+    if (!in) {
+        c->input.drain = 1;
+    } else if (c->input.queued.data) {
+        res = -EAGAIN;
+    } else {
+        c->input.queued = *in;
+        memset(in, 0, sizeof(*in));
+        c->input.drain = 0;
+    }
+    pthread_mutex_unlock(&c->input.lock);
+
+    return res;
 }
 
-void dav1d_close(Dav1dContext **const c_out) {
-    validate_input(c_out != NULL);
+// Moves the data queued by dav1d_send_data() (if any) to c->input.data,
+// returning whether there was any.
+static int take_input(Dav1dContext *const c) {
+    pthread_mutex_lock(&c->input.lock);
+    c->input.data = c->input.queued;
+    memset(&c->input.queued, 0, sizeof(c->input.queued));
+    pthread_mutex_unlock(&c->input.lock);
 
-    Dav1dContext *const c = *c_out;
-    if (!c) return;
+    return c->input.data.data != NULL;
+}
 
-    for (int n = 0; n < c->n_fc; n++) {
-        Dav1dFrameContext *const f = &c->fc[n];
+int dav1d_get_picture(Dav1dContext *const c, Dav1dPicture *const out) {
+    validate_input_or_ret(c != NULL, -EINVAL);
+    validate_input_or_ret(out != NULL, -EINVAL);
 
-        // clean-up threading stuff
-        if (c->n_fc > 1) {
-            pthread_mutex_lock(&f->frame_thread.td.lock);
-            f->frame_thread.die = 1;
-            pthread_cond_signal(&f->frame_thread.td.cond);
-            pthread_mutex_unlock(&f->frame_thread.td.lock);
-            pthread_join(f->frame_thread.td.thread, NULL);
-            freep(&f->frame_thread.b);
-            dav1d_freep_aligned(&f->frame_thread.pal_idx);
-            dav1d_freep_aligned(&f->frame_thread.cf);
-            freep(&f->frame_thread.tile_start_off);
-            freep(&f->frame_thread.pal);
-            freep(&f->frame_thread.cbi);
-            pthread_mutex_destroy(&f->frame_thread.td.lock);
-            pthread_cond_destroy(&f->frame_thread.td.cond);
+    dav1d_prof_set(&c->prof);
+    Dav1dData *const in = &c->input.data;
+    while (in->data || take_input(c)) {
+        const int res = parse_obus(c, in);
+        if (res < 0) {
+            dav1d_data_unref(in);
+            return res;
         }
-        if (f->n_tc > 1) {
-            pthread_mutex_lock(&f->tile_thread.lock);
-            for (int m = 0; m < f->n_tc; m++) {
-                Dav1dTileContext *const t = &f->tc[m];
-                t->tile_thread.die = 1;
-            }
-            pthread_cond_broadcast(&f->tile_thread.cond);
-            while (f->tile_thread.available != (1 << f->n_tc) - 1)
-                pthread_cond_wait(&f->tile_thread.icond,
-                                  &f->tile_thread.lock);
-            pthread_mutex_unlock(&f->tile_thread.lock);
-            for (int m = 0; m < f->n_tc; m++) {
-                Dav1dTileContext *const t = &f->tc[m];
-                if (f->n_tc > 1) {
-                    pthread_join(t->tile_thread.td.thread, NULL);
-                    pthread_mutex_destroy(&t->tile_thread.td.lock);
-                    pthread_cond_destroy(&t->tile_thread.td.cond);
-                }
-            }
-            pthread_mutex_destroy(&f->tile_thread.lock);
-            pthread_cond_destroy(&f->tile_thread.cond);
-            pthread_cond_destroy(&f->tile_thread.icond);
+
+        assert(res <= in->sz);
+        in->sz -= res;
+        in->data += res;
+        if (!in->sz) dav1d_data_unref(in);
+        if (output_picture_ready(c))
+            return output_picture(c, out);
+    }
+
+    if (c->frame_thread.low_latency)
+        output_decoded_picture(c);
+
+    if (output_picture_ready(c))
+        return output_picture(c, out);
+
+    // all input is parsed; if no more is coming, return the pictures still
+    // being decoded by the frame threads
+    pthread_mutex_lock(&c->input.lock);
+    const int drain = c->input.drain && !c->input.queued.data;
+    pthread_mutex_unlock(&c->input.lock);
+    if (drain)
+        return drain_picture(c, out);
+
+    return -EAGAIN;
+}
+
+void dav1d_flush(Dav1dContext *const c) {
+    dav1d_prof_set(&c->prof);
+    pthread_mutex_lock(&c->input.lock);
+    dav1d_data_unref(&c->input.queued);
+    c->input.drain = 0;
+    pthread_mutex_unlock(&c->input.lock);
+    dav1d_data_unref(&c->input.data);
+
+    if (c->n_fc > 1) {
+        pthread_mutex_lock(&c->picture_ready.lock);
+        for (int n = 0; n < c->n_fc; n++)
+            c->frame_thread.out_delayed[n].flushed = 1;
+        pthread_mutex_unlock(&c->picture_ready.lock);
+
+        // stop the frames in flight at their next sbrow, rather than
+        // waiting for them to be fully decoded before the next one starts
+        atomic_store(&c->frame_thread.flush, 1);
+        if (c->frame_thread.tile_f)
+            dav1d_submit_tile_data(c, 1);
+        for (int n = 0; n < c->n_fc; n++) {
+            Dav1dFrameContext *const f = &c->fc[n];
+            dav1d_frame_thread_wait_idle(f, c->tc);
+            pthread_mutex_unlock(&f->frame_thread.td.lock);
+            if (c->frame_thread.out_delayed[n].p.data[0])
+                dav1d_thread_picture_unref(&c->frame_thread.out_delayed[n]);
         }
-        for (int m = 0; m < f->n_tc; m++) {
-            Dav1dTileContext *const t = &f->tc[m];
-            dav1d_free_aligned(t->cf);
-            dav1d_free_aligned(t->scratch.mem);
-            dav1d_free_aligned(t->emu_edge);
+        atomic_store(&c->frame_thread.flush, 0);
+    }
+    if (c->out.data[0])
+        dav1d_picture_unref(&c->out);
+
+    // drop the frame being parsed, and the reference state: the cancelled
+    // frames did not update it, and later frames would not use it anyway
+    for (int n = 0; n < c->n_tile_data; n++)
+        dav1d_data_unref(&c->tile[n].data);
+    c->n_tile_data = 0;
+    c->have_frame_hdr = 0;
+    c->tile_mask = 0;
+    for (int n = 0; n < 8; n++) {
+        if (c->cdf[n].cdf)
+            cdf_thread_unref(&c->cdf[n]);
+        if (c->refs[n].p.p.data[0])
+            dav1d_thread_picture_unref(&c->refs[n].p);
+        if (c->refs[n].refmvs) {
+            dav1d_ref_dec(c->refs[n].refmvs);
+            c->refs[n].refmvs = NULL;
         }
-        for (int m = 0; m < f->n_ts; m++) {
-            Dav1dTileState *const ts = &f->ts[m];
-            pthread_cond_destroy(&ts->tile_thread.cond);
-            pthread_mutex_destroy(&ts->tile_thread.lock);
+        if (c->refs[n].segmap) {
+            dav1d_ref_dec(c->refs[n].segmap);
+            c->refs[n].segmap = NULL;
         }
-        free(f->ts);
-        dav1d_free_aligned(f->tc);
-        dav1d_free_aligned(f->ipred_edge[0]);
-        free(f->a);
-        free(f->lf.mask);
-        free(f->lf.level);
-        free(f->lf.tx_lpf_right_edge[0]);
-        av1_free_ref_mv_common(f->libaom_cm);
-        dav1d_free_aligned(f->lf.cdef_line);
-        dav1d_free_aligned(f->lf.lr_lpf_line);
-    }
-    dav1d_free_aligned(c->fc);
+    }
+    c->skipped_refs = 0xff;
+}
+
+void dav1d_reset(Dav1dContext *const c) {
+    validate_input(c != NULL);
+
+    dav1d_flush(c);
+    c->have_seq_hdr = 0;
+    c->operating_point_idc = 0;
+    memset(&c->seq_hdr, 0, sizeof(c->seq_hdr));
+    memset(&c->frame_hdr, 0, sizeof(c->frame_hdr));
+}
+
+int dav1d_set_threads(Dav1dContext *const c, const Dav1dSettings *const s) {
+    validate_input_or_ret(c != NULL, -EINVAL);
+    validate_input_or_ret(s != NULL, -EINVAL);
+    validate_input_or_ret(s->n_frame_threads >= 0 &&
+                          s->n_frame_threads <= 256, -EINVAL);
+    validate_input_or_ret(s->max_frame_delay >= 0 &&
+                          s->max_frame_delay <= 256, -EINVAL);
+    validate_input_or_ret(s->spin_wait >= 0, -EINVAL);
+    const int res = validate_thread_settings(s);
+    if (res < 0) return res;
+
+    dav1d_prof_set(&c->prof);
+    // a frame still receiving its tile groups is between frame boundaries
+    if (c->frame_thread.tile_f) return -EAGAIN;
     if (c->n_fc > 1) {
-        for (int n = 0; n < c->n_fc; n++)
+        // the decoded pictures not returned yet have nowhere to go
+        if (!c->picture_ready.callback)
+            for (int n = 0; n < c->n_fc; n++) {
+                const Dav1dThreadPicture *const out_delayed =
+                    &c->frame_thread.out_delayed[n];
+                if (out_delayed->p.data[0] && out_delayed->visible &&
+                    !out_delayed->flushed)
+                {
+                    return -EAGAIN;
+                }
+            }
+        // let the frames in flight (invisible ones, or ones whose picture
+        // goes to the picture_ready callback) finish
+        for (int n = 0; n < c->n_fc; n++) {
+            Dav1dFrameContext *const f = &c->fc[n];
+            dav1d_frame_thread_wait_idle(f, c->tc);
+            pthread_mutex_unlock(&f->frame_thread.td.lock);
             if (c->frame_thread.out_delayed[n].p.data[0])
                 dav1d_thread_picture_unref(&c->frame_thread.out_delayed[n]);
-        free(c->frame_thread.out_delayed);
+        }
+    }
+    // the references are fully decoded now, so nothing waits on (the
+    // thread data of) the frame contexts that decoded them anymore
+    for (int n = 0; n < 8; n++) {
+        c->refs[n].p.t = NULL;
+        c->cdf[n].t = NULL;
     }
+
+    join_frame_threads(c);
+    free_threads(c);
+    if (init_threads(c, s, num_frame_threads(s, c->low_memory)) < 0) {
+        dav1d_log(c, "Failed to allocate memory: %s\n", strerror(errno));
+        free_threads(c);
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+void dav1d_close(Dav1dContext **const c_out) {
+    validate_input(c_out != NULL);
+
+    Dav1dContext *const c = *c_out;
+    if (!c) return;
+
+    // cancel the frames in flight: a frame thread told to exit may not have
+    // started on its frame yet, which the other frames (and the workers of a
+    // shared pool) may be waiting for
+    if (c->n_fc > 1)
+        dav1d_flush(c);
+
+    join_frame_threads(c);
+    // the frame threads have finished, so none of our frames has tasks
+    // queued on the pool anymore
+#if CONFIG_DSP_STATS
+    // the workers of a shared pool count the calls of all its decoders
+    if (c->pool && !c->own_pool && c->pool->n_tc > 1)
+        for (int m = 0; m < c->pool->n_tc; m++)
+            dav1d_dsp_stats_add(&c->dsp_stats, &c->pool->tc[m].dsp_stats);
+#endif
+    free_threads(c);
+#if CONFIG_DSP_STATS
+    dav1d_dsp_stats_log(c, &c->dsp_stats);
+#endif
     for (int n = 0; n < c->n_tile_data; n++)
         dav1d_data_unref(&c->tile[n].data);
     for (int n = 0; n < 8; n++) {
@@ -310,5 +1004,15 @@ void dav1d_close(Dav1dContext **const c_out) {
         if (c->refs[n].segmap)
             dav1d_ref_dec(c->refs[n].segmap);
     }
+    dav1d_mem_pool_close(&c->picture_pool);
+    dav1d_mem_pool_close(&c->refmvs_pool);
+    dav1d_mem_pool_close(&c->segmap_pool);
+    dav1d_mem_pool_close(&c->block_info_pool);
+    dav1d_data_unref(&c->input.queued);
+    dav1d_data_unref(&c->input.data);
+    pthread_mutex_destroy(&c->input.lock);
+    pthread_mutex_destroy(&c->picture_ready.lock);
+    pthread_mutex_destroy(&c->mem.lock);
+    pthread_mutex_destroy(&c->waits.lock);
     dav1d_freep_aligned(c_out);
 }
@@ -0,0 +1,64 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __DAV1D_SRC_LOG_H__
+#define __DAV1D_SRC_LOG_H__
+
+#include "config.h"
+
+#include <stdarg.h>
+
+#include "dav1d/dav1d.h"
+
+#include "common/attributes.h"
+
+// Messages are passed to the Dav1dSettings.log callback of the context
+// (and dropped if c is NULL). Without CONFIG_LOG, dav1d_log() compiles to
+// nothing, the evaluation of its arguments included.
+#if CONFIG_LOG
+void dav1d_log(const Dav1dContext *c, const char *format, ...)
+    ATTR_FORMAT_PRINTF(2, 3);
+#else
+static inline void ATTR_FORMAT_PRINTF(2, 3)
+dav1d_log_nop(const Dav1dContext *const c, const char *const format, ...) {}
+#define dav1d_log(...) do { if (0) dav1d_log_nop(__VA_ARGS__); } while (0)
+#endif
+
+void dav1d_log_default_callback(void *cookie, const char *format, va_list ap);
+
+// Bitstream parsing traces, logged if the build's CONFIG_TRACE_LEVEL is at
+// least their level, and otherwise eliminated at compile time.
+#define DAV1D_TRACE_LEVEL_HEADERS 1 // sequence and frame headers
+#define DAV1D_TRACE_LEVEL_BLOCKS  2 // block modes and entropy decoder state
+#define DAV1D_TRACE_LEVEL_COEFS   3 // coefficient tokens
+
+#define DEBUG_SEQ_HDR    (CONFIG_TRACE_LEVEL >= DAV1D_TRACE_LEVEL_HEADERS)
+#define DEBUG_FRAME_HDR  (CONFIG_TRACE_LEVEL >= DAV1D_TRACE_LEVEL_HEADERS)
+#define DEBUG_BLOCK_INFO (CONFIG_TRACE_LEVEL >= DAV1D_TRACE_LEVEL_BLOCKS)
+#define DEBUG_COEF_INFO  (CONFIG_TRACE_LEVEL >= DAV1D_TRACE_LEVEL_COEFS)
+
+#endif /* __DAV1D_SRC_LOG_H__ */
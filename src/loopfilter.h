@@ -34,23 +34,34 @@
 #include "common/bitdepth.h"
 
 #include "src/levels.h"
+#include "src/lf_mask.h"
 
-#define decl_loopfilter_fn(name) \
-void (name)(pixel *dst, ptrdiff_t stride, int mb_lim, int lim, int hev_thr)
-typedef decl_loopfilter_fn(*loopfilter_fn);
+#define decl_loopfilter_sb_fn(name) \
+void (name)(pixel *dst, ptrdiff_t stride, const uint32_t *mask, \
+            const uint8_t (*lvl)[4], ptrdiff_t lvl_stride, \
+            const Av1FilterLUT *lut)
+typedef decl_loopfilter_sb_fn(*loopfilter_sb_fn);
 
 typedef struct Dav1dLoopFilterDSPContext {
     /*
-     * dimension 1: filter taps (0=4, 1=8, 2=16 for luma; 0=4, 1=6 for chroma)
+     * dimension 1: plane (0=luma, 1=uv)
      * dimension 2: 0=col-edge filter (h), 1=row-edge filter (v)
      *
-     * dst/stride are aligned by 4
+     * dst/stride are aligned by 4; each call filters all edges along one
+     * column (h) or row (v) of a 128x128 superblock. mask has one bitmask
+     * per filter width (4/8/16 taps for luma, 4/6 for uv), with bit n
+     * covering the n-th 4px edge segment. lvl points to the filter level
+     * of the first segment, lvl_stride is the stride of the level array.
      */
-    loopfilter_fn loop_filter[3][2];
-    loopfilter_fn loop_filter_uv[2][2];
+    loopfilter_sb_fn loop_filter_sb[2][2];
 } Dav1dLoopFilterDSPContext;
 
 void dav1d_loop_filter_dsp_init_8bpc(Dav1dLoopFilterDSPContext *c);
 void dav1d_loop_filter_dsp_init_10bpc(Dav1dLoopFilterDSPContext *c);
 
+void dav1d_loop_filter_dsp_init_x86_8bpc(Dav1dLoopFilterDSPContext *c);
+void dav1d_loop_filter_dsp_init_x86_10bpc(Dav1dLoopFilterDSPContext *c);
+void dav1d_loop_filter_dsp_init_arm_8bpc(Dav1dLoopFilterDSPContext *c);
+void dav1d_loop_filter_dsp_init_arm_10bpc(Dav1dLoopFilterDSPContext *c);
+
 #endif /* __DAV1D_SRC_LOOPFILTER_H__ */
@@ -40,6 +40,7 @@
 // TODO Reuse p when no padding is needed (add and remove lpf pixels in p)
 // TODO Chroma only requires 2 rows of padding.
 static void padding(pixel *dst, const pixel *p, const ptrdiff_t p_stride,
+                    const pixel (*left)[4],
                     const pixel *lpf, const ptrdiff_t lpf_stride,
                     int unit_w, const int stripe_h, const enum LrEdgeFlags edges)
 {
@@ -64,6 +65,11 @@ static void padding(pixel *dst, const pixel *p, const ptrdiff_t p_stride,
         pixel_copy(dst_l, p, unit_w);
         pixel_copy(dst_l + REST_UNIT_STRIDE, p, unit_w);
         pixel_copy(dst_l + 2 * REST_UNIT_STRIDE, p, unit_w);
+        if (have_left) {
+            pixel_copy(dst_l, &left[0][1], 3);
+            pixel_copy(dst_l + REST_UNIT_STRIDE, &left[0][1], 3);
+            pixel_copy(dst_l + 2 * REST_UNIT_STRIDE, &left[0][1], 3);
+        }
     }
 
     pixel *dst_tl = dst_l + 3 * REST_UNIT_STRIDE;
@@ -80,11 +86,23 @@ static void padding(pixel *dst, const pixel *p, const ptrdiff_t p_stride,
         pixel_copy(dst_tl + stripe_h * REST_UNIT_STRIDE, src, unit_w);
         pixel_copy(dst_tl + (stripe_h + 1) * REST_UNIT_STRIDE, src, unit_w);
         pixel_copy(dst_tl + (stripe_h + 2) * REST_UNIT_STRIDE, src, unit_w);
+        if (have_left) {
+            pixel_copy(dst_tl + stripe_h * REST_UNIT_STRIDE,
+                       &left[stripe_h - 1][1], 3);
+            pixel_copy(dst_tl + (stripe_h + 1) * REST_UNIT_STRIDE,
+                       &left[stripe_h - 1][1], 3);
+            pixel_copy(dst_tl + (stripe_h + 2) * REST_UNIT_STRIDE,
+                       &left[stripe_h - 1][1], 3);
+        }
     }
 
-    // Inner UNIT_WxSTRIPE_H
+    // Inner UNIT_WxSTRIPE_H; the pixels left of it come from $left, since
+    // the picture may already hold the restored pixels of the previous unit
     for (int j = 0; j < stripe_h; j++) {
-        pixel_copy(dst_tl, p, unit_w);
+        pixel_copy(dst_tl + 3 * have_left, p + 3 * have_left,
+                   unit_w - 3 * have_left);
+        if (have_left)
+            pixel_copy(dst_tl, &left[j][1], 3);
         dst_tl += REST_UNIT_STRIDE;
         p += PXSTRIDE(p_stride);
     }
@@ -115,7 +133,7 @@ static void padding(pixel *dst, const pixel *p, const ptrdiff_t p_stride,
 // FIXME Could implement a version that requires less temporary memory
 // (should be possible to implement with only 6 rows of temp storage)
 static void wiener_c(pixel *p, const ptrdiff_t p_stride,
-                     const pixel *lpf, const ptrdiff_t lpf_stride,
+                     const pixel (*const left)[4], const pixel *lpf, const ptrdiff_t lpf_stride,
                      const int w, const int h,
                      const int16_t filterh[7], const int16_t filterv[7],
                      const enum LrEdgeFlags edges)
@@ -125,7 +143,7 @@ static void wiener_c(pixel *p, const ptrdiff_t p_stride,
     pixel tmp[70 /*(64 + 3 + 3)*/ * REST_UNIT_STRIDE];
     pixel *tmp_ptr = tmp;
 
-    padding(tmp, p, p_stride, lpf, lpf_stride, w, h, edges);
+    padding(tmp, p, p_stride, left, lpf, lpf_stride, w, h, edges);
 
     // Values stored between horizontal and vertical filtering don't
     // fit in a uint8_t.
@@ -489,7 +507,7 @@ static void selfguided_filter(int32_t *dst, const pixel *src,
 }
 
 static void selfguided_c(pixel *p, const ptrdiff_t p_stride,
-                         const pixel *lpf, const ptrdiff_t lpf_stride,
+                         const pixel (*const left)[4], const pixel *lpf, const ptrdiff_t lpf_stride,
                          const int w, const int h, const int sgr_idx,
                          const int16_t sgr_w[2], const enum LrEdgeFlags edges)
 {
@@ -497,7 +515,7 @@ static void selfguided_c(pixel *p, const ptrdiff_t p_stride,
     // of padding above and below
     pixel tmp[70 /*(64 + 3 + 3)*/ * REST_UNIT_STRIDE];
 
-    padding(tmp, p, p_stride, lpf, lpf_stride, w, h, edges);
+    padding(tmp, p, p_stride, left, lpf, lpf_stride, w, h, edges);
 
     // Selfguided filter outputs to a maximum stripe height of 64 and a
     // maximum restoration width of 384 (256 * 1.5)
@@ -551,4 +569,12 @@ static void selfguided_c(pixel *p, const ptrdiff_t p_stride,
 void bitfn(dav1d_loop_restoration_dsp_init)(Dav1dLoopRestorationDSPContext *const c) {
     c->wiener = wiener_c;
     c->selfguided = selfguided_c;
+
+#if HAVE_ASM
+#if ARCH_AARCH64 || ARCH_ARM
+    bitfn(dav1d_loop_restoration_dsp_init_arm)(c);
+#elif ARCH_X86
+    bitfn(dav1d_loop_restoration_dsp_init_x86)(c);
+#endif
+#endif
 }
@@ -32,6 +32,7 @@
 #include "common/intops.h"
 
 #include "src/lr_apply.h"
+#include "src/profile.h"
 
 
 enum LrRestorePlanes {
@@ -42,9 +43,9 @@ enum LrRestorePlanes {
 
 // The loop filter buffer stores 12 rows of pixels. A superblock block will
 // contain at most 2 stripes. Each stripe requires 4 rows pixels (2 above
-// and 2 below) the final 4 rows are used to swap the bottom of the last
-// stripe with the top of the next super block row.
-static void backup_lpf(pixel *dst, ptrdiff_t dst_stride,
+// and 2 below) the final 4 rows of the previous super block row's buffer
+// (prev) are copied to provide the top of the first stripe of this one.
+static void backup_lpf(pixel *dst, ptrdiff_t dst_stride, const pixel *prev,
                        const pixel *src, ptrdiff_t src_stride,
                        const int ss_ver, const int sb128,
                        int row, const int row_h, const int w)
@@ -59,10 +60,10 @@ static void backup_lpf(pixel *dst, ptrdiff_t dst_stride,
         const int top = 4 << sb128;
         // Copy the top part of the stored loop filtered pixels from the
         // previous sb row needed above the first stripe of this sb row.
-        pixel_copy(&dst[dst_stride *  0], &dst[dst_stride *  top], w);
-        pixel_copy(&dst[dst_stride *  1], &dst[dst_stride * (top + 1)], w);
-        pixel_copy(&dst[dst_stride *  2], &dst[dst_stride * (top + 2)], w);
-        pixel_copy(&dst[dst_stride *  3], &dst[dst_stride * (top + 3)], w);
+        pixel_copy(&dst[dst_stride *  0], &prev[dst_stride *  top], w);
+        pixel_copy(&dst[dst_stride *  1], &prev[dst_stride * (top + 1)], w);
+        pixel_copy(&dst[dst_stride *  2], &prev[dst_stride * (top + 2)], w);
+        pixel_copy(&dst[dst_stride *  3], &prev[dst_stride * (top + 3)], w);
     }
 
     dst += 4 * dst_stride;
@@ -96,7 +97,9 @@ void bytefn(dav1d_lr_copy_lpf)(Dav1dFrameContext *const f,
         const int w = f->bw << 2;
         const int row_h = imin((sby + 1) << (6 + f->seq_hdr.sb128), h);
         const int y_stripe = (sby << (6 + f->seq_hdr.sb128)) - offset;
-        backup_lpf(f->lf.lr_lpf_line_ptr[0], sizeof(pixel) * f->b4_stride * 4,
+        backup_lpf(f->lf.lr_lpf_line_ptr[sby & 1][0],
+                   sizeof(pixel) * f->b4_stride * 4,
+                   f->lf.lr_lpf_line_ptr[~sby & 1][0],
                    src[0] - offset * PXSTRIDE(src_stride[0]), src_stride[0],
                    0, f->seq_hdr.sb128, y_stripe, row_h, w);
     }
@@ -111,12 +114,16 @@ void bytefn(dav1d_lr_copy_lpf)(Dav1dFrameContext *const f,
             (sby << ((6 - ss_ver) + f->seq_hdr.sb128)) - offset_uv;
 
         if (restore_planes & LR_RESTORE_U) {
-            backup_lpf(f->lf.lr_lpf_line_ptr[1], sizeof(pixel) * f->b4_stride * 4,
+            backup_lpf(f->lf.lr_lpf_line_ptr[sby & 1][1],
+                       sizeof(pixel) * f->b4_stride * 4,
+                       f->lf.lr_lpf_line_ptr[~sby & 1][1],
                        src[1] - offset_uv * PXSTRIDE(src_stride[1]), src_stride[1],
                        ss_ver, f->seq_hdr.sb128, y_stripe, row_h, w);
         }
         if (restore_planes & LR_RESTORE_V) {
-            backup_lpf(f->lf.lr_lpf_line_ptr[2], sizeof(pixel) * f->b4_stride * 4,
+            backup_lpf(f->lf.lr_lpf_line_ptr[sby & 1][2],
+                       sizeof(pixel) * f->b4_stride * 4,
+                       f->lf.lr_lpf_line_ptr[~sby & 1][2],
                        src[2] - offset_uv * PXSTRIDE(src_stride[1]), src_stride[1],
                        ss_ver, f->seq_hdr.sb128, y_stripe, row_h, w);
         }
@@ -124,15 +131,17 @@ void bytefn(dav1d_lr_copy_lpf)(Dav1dFrameContext *const f,
 }
 
 
-static void lr_stripe(const Dav1dFrameContext *const f, pixel *p, int x, int y,
+static void lr_stripe(const Dav1dFrameContext *const f, pixel *p,
+                      const pixel (*left)[4], int x, int y,
                       const int plane, const int unit_w, const int row_h,
-                      const Av1RestorationUnit *const lr, enum LrEdgeFlags edges)
+                      const Av1RestorationUnit *const lr, enum LrEdgeFlags edges,
+                      const pixel *lpf)
 {
     const Dav1dDSPContext *const dsp = f->dsp;
     const int chroma = !!plane;
     const int ss_ver = chroma & (f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420);
     const int sbrow_has_bottom = (edges & LR_HAVE_BOTTOM);
-    const pixel *lpf = f->lf.lr_lpf_line_ptr[plane] + x;
+    lpf += x;
     const ptrdiff_t p_stride = f->cur.p.stride[chroma];
     const ptrdiff_t lpf_stride = sizeof(pixel) * f->b4_stride * 4;
 
@@ -161,17 +170,18 @@ static void lr_stripe(const Dav1dFrameContext *const f, pixel *p, int x, int y,
             edges |= LR_HAVE_BOTTOM;
         }
         if (lr->type == RESTORATION_WIENER) {
-            dsp->lr.wiener(p, p_stride, lpf, lpf_stride, unit_w, stripe_h,
-                           filterh, filterv, edges);
+            dsp->lr.wiener(p, p_stride, left, lpf, lpf_stride, unit_w,
+                           stripe_h, filterh, filterv, edges);
         } else {
             assert(lr->type == RESTORATION_SGRPROJ);
-            dsp->lr.selfguided(p, p_stride, lpf, lpf_stride, unit_w, stripe_h,
-                               lr->sgr_idx, lr->sgr_weights, edges);
+            dsp->lr.selfguided(p, p_stride, left, lpf, lpf_stride, unit_w,
+                               stripe_h, lr->sgr_idx, lr->sgr_weights, edges);
         }
 
         y += stripe_h;
         if (y + stripe_h > row_h && sbrow_has_bottom) break;
         p += stripe_h * PXSTRIDE(p_stride);
+        left += stripe_h;
         edges |= LR_HAVE_TOP;
         stripe_h = imin(64 >> ss_ver, row_h - y);
         if (stripe_h == 0) break;
@@ -179,22 +189,16 @@ static void lr_stripe(const Dav1dFrameContext *const f, pixel *p, int x, int y,
     }
 }
 
-static void backup3xU(pixel *dst, const pixel *src, const ptrdiff_t src_stride,
-                      int u)
+static void backup4xU(pixel (*dst)[4], const pixel *src,
+                      const ptrdiff_t src_stride, int u)
 {
-    for (; u > 0; u--, dst += 3, src += PXSTRIDE(src_stride))
-        pixel_copy(dst, src, 3);
-}
-
-static void restore3xU(pixel *dst, const ptrdiff_t dst_stride, const pixel *src,
-                       int u)
-{
-    for (; u > 0; u--, dst += PXSTRIDE(dst_stride), src += 3)
-        pixel_copy(dst, src, 3);
+    for (; u > 0; u--, dst++, src += PXSTRIDE(src_stride))
+        pixel_copy(dst, src, 4);
 }
 
 static void lr_sbrow(const Dav1dFrameContext *const f, pixel *p, const int y,
-                     const int w, const int h, const int row_h, const int plane)
+                     const int w, const int h, const int row_h, const int plane,
+                     const pixel *const lpf)
 {
     const int chroma = !!plane;
     const int ss_ver = chroma & (f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420);
@@ -223,17 +227,19 @@ static void lr_sbrow(const Dav1dFrameContext *const f, pixel *p, const int y,
     // Merge last restoration unit if its height is < half_unit_size
     if (ruy > 0) ruy -= (ruy << unit_size_log2) + half_unit_size > h;
 
-    // The first stripe of the frame is shorter by 8 luma pixel rows.
-    const int filter_h =
-        imin(((1 << (6 + f->seq_hdr.sb128)) - 8 * !y) >> ss_ver, h - y);
-
-    pixel pre_lr_border[128 /* maximum sbrow height is 128 */ * 3];
-    pixel post_lr_border[128 /* maximum sbrow height is 128 */ * 3];
+    // The pre-restoration pixels right of each unit, which become the left
+    // edge of the next one; filled before the unit itself gets restored.
+    pixel pre_lr_border[2][128 + 8 /* maximum sbrow height + offset */][4];
+    int bit = 0;
 
     int unit_w = unit_size;
 
     enum LrEdgeFlags edges = (y > 0 ? LR_HAVE_TOP : 0) |
                              (row_h < h ? LR_HAVE_BOTTOM : 0);
+    // The rows restored by lr_stripe(); unless this is the last sbrow, the
+    // bottom ones belong to the stripe restored with the next sbrow, whose
+    // deblocking and CDEF may still be writing them.
+    const int restore_h = row_h - y - (row_h < h ? 8 >> ss_ver : 0);
 
     for (int x = 0, rux = 0; x < w; x+= unit_w, rux++, edges |= LR_HAVE_LEFT) {
         // TODO Clean up this if statement.
@@ -251,30 +257,23 @@ static void lr_sbrow(const Dav1dFrameContext *const f, pixel *p, const int y,
             &f->lf.mask[(((ruy << (unit_size_log2)) >> shift_ver) * f->sb128w) +
                         (x >> shift_hor)].lr[plane][unit_idx];
 
-        if (edges & LR_HAVE_LEFT) {
-            restore3xU(p - 3, p_stride, pre_lr_border, filter_h);
-        }
         // FIXME Don't backup if the next restoration unit is RESTORE_NONE
-        // This also requires not restoring in the same conditions.
         if (edges & LR_HAVE_RIGHT) {
-            backup3xU(pre_lr_border, p + unit_w - 3, p_stride, filter_h);
+            backup4xU(pre_lr_border[bit], p + unit_w - 4, p_stride, restore_h);
         }
         if (lr->type != RESTORATION_NONE) {
-            lr_stripe(f, p, x, y, plane, unit_w, row_h, lr, edges);
-        }
-        if (edges & LR_HAVE_LEFT) {
-            restore3xU(p - 3, p_stride, post_lr_border, filter_h);
-        }
-        if (edges & LR_HAVE_RIGHT) {
-            backup3xU(post_lr_border, p + unit_w - 3, p_stride, filter_h);
+            lr_stripe(f, p, pre_lr_border[!bit], x, y, plane, unit_w, row_h,
+                      lr, edges, lpf);
         }
         p += unit_w;
+        bit ^= 1;
     }
 }
 
 void bytefn(dav1d_lr_sbrow)(Dav1dFrameContext *const f, pixel *const dst[3],
                             const int sby)
 {
+    PROF_START(prof_start);
     const ptrdiff_t offset_y = 8 * !!sby;
     const ptrdiff_t *const dst_stride = f->cur.p.stride;
 
@@ -289,7 +288,7 @@ void bytefn(dav1d_lr_sbrow)(Dav1dFrameContext *const f, pixel *const dst[3],
         const int row_h = imin((sby + 1) << (6 + f->seq_hdr.sb128), h);
         const int y_stripe = (sby << (6 + f->seq_hdr.sb128)) - offset_y;
         lr_sbrow(f, dst[0] - offset_y * PXSTRIDE(dst_stride[0]), y_stripe, w,
-                 h, row_h, 0);
+                 h, row_h, 0, f->lf.lr_lpf_line_ptr[sby & 1][0]);
     }
     if (restore_planes & (LR_RESTORE_U | LR_RESTORE_V)) {
         const int ss_ver = f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420;
@@ -302,10 +301,11 @@ void bytefn(dav1d_lr_sbrow)(Dav1dFrameContext *const f, pixel *const dst[3],
             (sby << ((6 - ss_ver) + f->seq_hdr.sb128)) - offset_uv;
         if (restore_planes & LR_RESTORE_U)
             lr_sbrow(f, dst[1] - offset_uv * PXSTRIDE(dst_stride[1]), y_stripe,
-                     w, h, row_h, 1);
+                     w, h, row_h, 1, f->lf.lr_lpf_line_ptr[sby & 1][1]);
 
         if (restore_planes & LR_RESTORE_V)
             lr_sbrow(f, dst[2] - offset_uv * PXSTRIDE(dst_stride[1]), y_stripe,
-                     w, h, row_h, 2);
+                     w, h, row_h, 2, f->lf.lr_lpf_line_ptr[sby & 1][2]);
     }
+    PROF_END(prof_start, DAV1D_PROF_LR);
 }
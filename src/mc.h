@@ -86,6 +86,13 @@ void (name)(pixel *dst, ptrdiff_t dst_stride, \
             const uint8_t *mask, ptrdiff_t mstride)
 typedef decl_blend_fn(*blend_fn);
 
+#define decl_emu_edge_fn(name) \
+void (name)(intptr_t bw, intptr_t bh, intptr_t iw, intptr_t ih, \
+            intptr_t x, intptr_t y, \
+            pixel *dst, ptrdiff_t dst_stride, \
+            const pixel *src, ptrdiff_t src_stride)
+typedef decl_emu_edge_fn(*emu_edge_fn);
+
 typedef struct Dav1dMCDSPContext {
     mc_fn mc[N_2D_FILTERS];
     mct_fn mct[N_2D_FILTERS];
@@ -96,6 +103,7 @@ typedef struct Dav1dMCDSPContext {
     blend_fn blend;
     warp8x8_fn warp8x8;
     warp8x8t_fn warp8x8t;
+    emu_edge_fn emu_edge;
 } Dav1dMCDSPContext;
 
 void dav1d_mc_dsp_init_8bpc(Dav1dMCDSPContext *c);
@@ -103,5 +111,7 @@ void dav1d_mc_dsp_init_10bpc(Dav1dMCDSPContext *c);
 
 void dav1d_mc_dsp_init_x86_8bpc(Dav1dMCDSPContext *c);
 void dav1d_mc_dsp_init_x86_10bpc(Dav1dMCDSPContext *c);
+void dav1d_mc_dsp_init_arm_8bpc(Dav1dMCDSPContext *c);
+void dav1d_mc_dsp_init_arm_10bpc(Dav1dMCDSPContext *c);
 
 #endif /* __DAV1D_SRC_MC_H__ */
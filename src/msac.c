@@ -260,6 +260,21 @@ unsigned msac_decode_bool(MsacContext *const c, const unsigned cdf) {
     return od_ec_decode_bool_q15(c, cdf);
 }
 
+/* Equivalent to decoding a 2-symbol cdf with msac_decode_symbol_adapt4(),
+ * but without a temporary array to fit update_cdf()'s layout, since bool
+ * cdfs store the counter right after the single probability. */
+unsigned msac_decode_bool_adapt(MsacContext *const c, uint16_t *const cdf) {
+    const unsigned bit = od_ec_decode_bool_q15(c, *cdf);
+    const unsigned count = cdf[1];
+    const int rate = 4 + (count > 15) + (count > 31);
+    if (bit)
+        cdf[0] += (32768 - cdf[0]) >> rate;
+    else
+        cdf[0] -= cdf[0] >> rate;
+    cdf[1] = count + (count < 32);
+    return bit;
+}
+
 unsigned msac_decode_bools(MsacContext *const c, const unsigned l) {
     int v = 0;
     for (int n = (int) l - 1; n >= 0; n--)
@@ -12,6 +12,8 @@
 #ifndef __DAV1D_SRC_MSAC_H__
 #define __DAV1D_SRC_MSAC_H__
 
+#include "config.h"
+
 #include <stdint.h>
 #include <stdlib.h>
 
@@ -28,29 +30,47 @@ void msac_init(MsacContext *c, const uint8_t *data, size_t sz);
 unsigned msac_decode_symbol(MsacContext *c, const uint16_t *cdf,
                             const unsigned n_symbols);
 unsigned msac_decode_bool(MsacContext *c, unsigned cdf);
+unsigned msac_decode_bool_adapt(MsacContext *c, uint16_t *cdf);
 unsigned msac_decode_bools(MsacContext *c, unsigned l);
 int msac_decode_subexp(MsacContext *c, int ref, unsigned n, unsigned k);
 int msac_decode_uniform(MsacContext *c, unsigned n);
 void update_cdf(uint16_t *cdf, unsigned val, unsigned nsymbs);
 
-static inline unsigned msac_decode_symbol_adapt(MsacContext *const c,
-                                                uint16_t *const cdf,
-                                                const unsigned n_symbols)
+static inline unsigned msac_decode_symbol_adapt_c(MsacContext *const c,
+                                                  uint16_t *const cdf,
+                                                  const unsigned n_symbols)
 {
     const unsigned val = msac_decode_symbol(c, cdf, n_symbols);
     update_cdf(cdf, val, n_symbols);
     return val;
 }
 
-static inline unsigned msac_decode_bool_adapt(MsacContext *const c,
-                                              uint16_t *const cdf)
-{
-    const unsigned bit = msac_decode_bool(c, *cdf);
-    uint16_t bak_cdf[3] = { cdf[0], 0, cdf[1] };
-    update_cdf(bak_cdf, bit, 2);
-    cdf[0] = bak_cdf[0];
-    cdf[1] = bak_cdf[2];
-    return bit;
-}
+/* SSE2 and NEON are part of the x86-64 and AArch64 baselines, so the SIMD
+ * versions are used unconditionally instead of going through a DSP table.
+ * The 4/8/16 variants take at most that many symbols, so the smallest one
+ * that fits should be picked at each call site. */
+#if HAVE_ASM && ARCH_X86_64
+#define decl_decode_symbol_adapt_fn(name) \
+unsigned name(MsacContext *c, uint16_t *cdf, unsigned n_symbols)
+decl_decode_symbol_adapt_fn(dav1d_msac_decode_symbol_adapt4_sse2);
+decl_decode_symbol_adapt_fn(dav1d_msac_decode_symbol_adapt8_sse2);
+decl_decode_symbol_adapt_fn(dav1d_msac_decode_symbol_adapt16_sse2);
+#define msac_decode_symbol_adapt4  dav1d_msac_decode_symbol_adapt4_sse2
+#define msac_decode_symbol_adapt8  dav1d_msac_decode_symbol_adapt8_sse2
+#define msac_decode_symbol_adapt16 dav1d_msac_decode_symbol_adapt16_sse2
+#elif HAVE_ASM && ARCH_AARCH64
+#define decl_decode_symbol_adapt_fn(name) \
+unsigned name(MsacContext *c, uint16_t *cdf, unsigned n_symbols)
+decl_decode_symbol_adapt_fn(dav1d_msac_decode_symbol_adapt4_neon);
+decl_decode_symbol_adapt_fn(dav1d_msac_decode_symbol_adapt8_neon);
+decl_decode_symbol_adapt_fn(dav1d_msac_decode_symbol_adapt16_neon);
+#define msac_decode_symbol_adapt4  dav1d_msac_decode_symbol_adapt4_neon
+#define msac_decode_symbol_adapt8  dav1d_msac_decode_symbol_adapt8_neon
+#define msac_decode_symbol_adapt16 dav1d_msac_decode_symbol_adapt16_neon
+#else
+#define msac_decode_symbol_adapt4  msac_decode_symbol_adapt_c
+#define msac_decode_symbol_adapt8  msac_decode_symbol_adapt_c
+#define msac_decode_symbol_adapt16 msac_decode_symbol_adapt_c
+#endif
 
 #endif /* __DAV1D_SRC_MSAC_H__ */
@@ -30,38 +30,40 @@
 #include <assert.h>
 #include <errno.h>
 #include <limits.h>
-#include <stdio.h>
 
 #include "dav1d/data.h"
 
 #include "common/intops.h"
+#include "common/validate.h"
 
 #include "src/decode.h"
 #include "src/getbits.h"
 #include "src/levels.h"
+#include "src/log.h"
 #include "src/obu.h"
+#include "src/profile.h"
 #include "src/ref.h"
+#include "src/thread_task.h"
 #include "src/warpmv.h"
 
-static int parse_seq_hdr(Dav1dContext *const c, GetBits *const gb) {
+static int parse_seq_hdr(const Dav1dContext *const c,
+                         Av1SequenceHeader *const hdr, GetBits *const gb)
+{
     const uint8_t *const init_ptr = gb->ptr;
-    Av1SequenceHeader *const hdr = &c->seq_hdr;
-
-#define DEBUG_SEQ_HDR 0
 
     hdr->profile = get_bits(gb, 3);
     if (hdr->profile > 2) goto error;
 #if DEBUG_SEQ_HDR
-    printf("SEQHDR: post-profile: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "SEQHDR: post-profile: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
     hdr->still_picture = get_bits(gb, 1);
     hdr->reduced_still_picture_header = get_bits(gb, 1);
     if (hdr->reduced_still_picture_header && !hdr->still_picture) goto error;
 #if DEBUG_SEQ_HDR
-    printf("SEQHDR: post-stillpicture_flags: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "SEQHDR: post-stillpicture_flags: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
     if (hdr->reduced_still_picture_header) {
@@ -97,13 +99,13 @@ static int parse_seq_hdr(Dav1dContext *const c, GetBits *const gb) {
             hdr->decoder_model_info_present = 0;
         }
 #if DEBUG_SEQ_HDR
-        printf("SEQHDR: post-timinginfo: off=%ld\n",
-               (gb->ptr - init_ptr) * 8 - gb->bits_left);
+        dav1d_log(c, "SEQHDR: post-timinginfo: off=%ld\n",
+                  (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
         hdr->display_model_info_present = get_bits(gb, 1);
         hdr->num_operating_points = get_bits(gb, 5) + 1;
-        for (int i = 0; i < c->seq_hdr.num_operating_points; i++) {
+        for (int i = 0; i < hdr->num_operating_points; i++) {
             struct Av1SequenceHeaderOperatingPoint *const op =
                 &hdr->operating_points[i];
             op->idc = get_bits(gb, 12);
@@ -129,8 +131,8 @@ static int parse_seq_hdr(Dav1dContext *const c, GetBits *const gb) {
             }
         }
 #if DEBUG_SEQ_HDR
-        printf("SEQHDR: post-operating-points: off=%ld\n",
-               (gb->ptr - init_ptr) * 8 - gb->bits_left);
+        dav1d_log(c, "SEQHDR: post-operating-points: off=%ld\n",
+                  (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
     }
 
@@ -139,8 +141,8 @@ static int parse_seq_hdr(Dav1dContext *const c, GetBits *const gb) {
     hdr->max_width = get_bits(gb, hdr->width_n_bits) + 1;
     hdr->max_height = get_bits(gb, hdr->height_n_bits) + 1;
 #if DEBUG_SEQ_HDR
-    printf("SEQHDR: post-size: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "SEQHDR: post-size: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
     hdr->frame_id_numbers_present =
         hdr->reduced_still_picture_header ? 0 : get_bits(gb, 1);
@@ -149,8 +151,8 @@ static int parse_seq_hdr(Dav1dContext *const c, GetBits *const gb) {
         hdr->frame_id_n_bits = get_bits(gb, 3) + hdr->delta_frame_id_n_bits + 1;
     }
 #if DEBUG_SEQ_HDR
-    printf("SEQHDR: post-frame-id-numbers-present: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "SEQHDR: post-frame-id-numbers-present: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
     hdr->sb128 = get_bits(gb, 1);
@@ -183,8 +185,8 @@ static int parse_seq_hdr(Dav1dContext *const c, GetBits *const gb) {
         }
         hdr->screen_content_tools = get_bits(gb, 1) ? ADAPTIVE : get_bits(gb, 1);
     #if DEBUG_SEQ_HDR
-        printf("SEQHDR: post-screentools: off=%ld\n",
-               (gb->ptr - init_ptr) * 8 - gb->bits_left);
+        dav1d_log(c, "SEQHDR: post-screentools: off=%ld\n",
+                  (gb->ptr - init_ptr) * 8 - gb->bits_left);
     #endif
         hdr->force_integer_mv = hdr->screen_content_tools ?
                                 get_bits(gb, 1) ? ADAPTIVE : get_bits(gb, 1) : 2;
@@ -195,8 +197,8 @@ static int parse_seq_hdr(Dav1dContext *const c, GetBits *const gb) {
     hdr->cdef = get_bits(gb, 1);
     hdr->restoration = get_bits(gb, 1);
 #if DEBUG_SEQ_HDR
-    printf("SEQHDR: post-featurebits: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "SEQHDR: post-featurebits: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
     const int hbd = get_bits(gb, 1);
@@ -246,14 +248,14 @@ static int parse_seq_hdr(Dav1dContext *const c, GetBits *const gb) {
         hdr->separate_uv_delta_q = get_bits(gb, 1);
     }
 #if DEBUG_SEQ_HDR
-    printf("SEQHDR: post-colorinfo: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "SEQHDR: post-colorinfo: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
-    c->seq_hdr.film_grain_present = get_bits(gb, 1);
+    hdr->film_grain_present = get_bits(gb, 1);
 #if DEBUG_SEQ_HDR
-    printf("SEQHDR: post-filmgrain: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "SEQHDR: post-filmgrain: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
     get_bits(gb, 1); // dummy bit
@@ -261,7 +263,7 @@ static int parse_seq_hdr(Dav1dContext *const c, GetBits *const gb) {
     return flush_get_bits(gb) - init_ptr;
 
 error:
-    fprintf(stderr, "Error parsing sequence header\n");
+    dav1d_log(c, "Error parsing sequence header\n");
     return -EINVAL;
 }
 
@@ -325,13 +327,11 @@ static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb,
     Av1FrameHeader *const hdr = &c->frame_hdr;
     int res;
 
-#define DEBUG_FRAME_HDR 0
-
     hdr->show_existing_frame =
         !seqhdr->reduced_still_picture_header && get_bits(gb, 1);
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-show_existing_frame: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-show_existing_frame: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
     if (hdr->show_existing_frame) {
         hdr->existing_frame_idx = get_bits(gb, 3);
@@ -349,8 +349,8 @@ static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb,
         hdr->frame_type == DAV1D_FRAME_TYPE_SWITCH ||
         seqhdr->reduced_still_picture_header || get_bits(gb, 1);
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-frametype_bits: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-frametype_bits: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
     hdr->disable_cdf_update = get_bits(gb, 1);
     hdr->allow_screen_content_tools = seqhdr->screen_content_tools == ADAPTIVE ?
@@ -365,8 +365,8 @@ static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb,
     hdr->frame_size_override = seqhdr->reduced_still_picture_header ? 0 :
                                hdr->frame_type == DAV1D_FRAME_TYPE_SWITCH ? 1 : get_bits(gb, 1);
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-frame_size_override_flag: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-frame_size_override_flag: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
     hdr->frame_offset = seqhdr->order_hint ?
                         get_bits(gb, seqhdr->order_hint_n_bits) : 0;
@@ -414,15 +414,15 @@ static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb,
         }
     }
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-frametype-specific-bits: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-frametype-specific-bits: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
     hdr->refresh_context = !seqhdr->reduced_still_picture_header &&
                            !hdr->disable_cdf_update && !get_bits(gb, 1);
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-refresh_context: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-refresh_context: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
     // tile data
@@ -490,8 +490,8 @@ static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb,
         hdr->tiling.n_bytes = hdr->tiling.update = 0;
     }
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-tiling: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-tiling: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
     // quant data
@@ -509,8 +509,8 @@ static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb,
         }
     }
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-quant: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-quant: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
     hdr->quant.qm = get_bits(gb, 1);
     if (hdr->quant.qm) {
@@ -520,8 +520,8 @@ static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb,
                                                         hdr->quant.qm_u;
     }
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-qm: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-qm: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
     // segmentation data
@@ -603,8 +603,8 @@ static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb,
         hdr->segmentation.seg_data = c->refs[pri_ref].seg_data;
     }
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-segmentation: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-segmentation: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
     // delta q
@@ -615,8 +615,8 @@ static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb,
     hdr->delta.lf.res_log2 = hdr->delta.lf.present ? get_bits(gb, 2) : 0;
     hdr->delta.lf.multi = hdr->delta.lf.present ? get_bits(gb, 1) : 0;
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-delta_q_lf_flags: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-delta_q_lf_flags: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
     // derive lossless flags
@@ -673,8 +673,8 @@ static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb,
         }
     }
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-lpf: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-lpf: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
     // cdef
@@ -692,8 +692,8 @@ static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb,
         hdr->cdef.uv_strength[0] = 0;
     }
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-cdef: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-cdef: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
     // restoration
@@ -729,20 +729,20 @@ static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb,
         hdr->restoration.type[2] = RESTORATION_NONE;
     }
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-restoration: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-restoration: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
     hdr->txfm_mode = hdr->all_lossless ? TX_4X4_ONLY :
                      get_bits(gb, 1) ? TX_SWITCHABLE : TX_LARGEST;
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-txfmmode: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-txfmmode: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
     hdr->switchable_comp_refs = hdr->frame_type & 1 ? get_bits(gb, 1) : 0;
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-refmode: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-refmode: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
     hdr->skip_mode_allowed = 0;
     if (hdr->switchable_comp_refs && hdr->frame_type & 1) {
@@ -795,19 +795,19 @@ static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb,
     }
     hdr->skip_mode_enabled = hdr->skip_mode_allowed ? get_bits(gb, 1) : 0;
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-extskip: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-extskip: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
     hdr->warp_motion = !hdr->error_resilient_mode && hdr->frame_type & 1 &&
         seqhdr->warped_motion && get_bits(gb, 1);
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-warpmotionbit: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-warpmotionbit: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
     hdr->reduced_txtp_set = get_bits(gb, 1);
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-reducedtxtpset: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-reducedtxtpset: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
     for (int i = 0; i < 7; i++)
@@ -858,15 +858,15 @@ static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb,
         }
     }
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-gmv: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-gmv: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
     hdr->film_grain.present = seqhdr->film_grain_present &&
                               (hdr->show_frame || hdr->showable_frame) &&
                               get_bits(gb, 1);
     if (hdr->film_grain.present) {
-        hdr->film_grain.seed = get_bits(gb, 16);
+        const unsigned seed = get_bits(gb, 16);
         hdr->film_grain.update = hdr->frame_type != DAV1D_FRAME_TYPE_INTER || get_bits(gb, 1);
         if (!hdr->film_grain.update) {
             const int refidx = get_bits(gb, 3);
@@ -876,8 +876,10 @@ static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb,
                     break;
             if (i == 7) goto error;
             hdr->film_grain.data = c->refs[refidx].film_grain;
+            hdr->film_grain.data.seed = seed;
         } else {
-            Av1FilmGrainData *const fgd = &hdr->film_grain.data;
+            Dav1dFilmGrainData *const fgd = &hdr->film_grain.data;
+            fgd->seed = seed;
 
             fgd->num_y_points = get_bits(gb, 4);
             if (fgd->num_y_points > 14) goto error;
@@ -936,11 +938,11 @@ static int parse_frame_hdr(Dav1dContext *const c, GetBits *const gb,
             fgd->clip_to_restricted_range = get_bits(gb, 1);
         }
     } else {
-        memset(&hdr->film_grain.data, 0, sizeof(hdr->film_grain));
+        memset(&hdr->film_grain.data, 0, sizeof(hdr->film_grain.data));
     }
 #if DEBUG_FRAME_HDR
-    printf("HDR: post-filmgrain: off=%ld\n",
-           (gb->ptr - init_ptr) * 8 - gb->bits_left);
+    dav1d_log(c, "HDR: post-filmgrain: off=%ld\n",
+              (gb->ptr - init_ptr) * 8 - gb->bits_left);
 #endif
 
 end:
@@ -951,7 +953,7 @@ end:
     return flush_get_bits(gb) - init_ptr;
 
 error:
-    fprintf(stderr, "Error parsing frame header\n");
+    dav1d_log(c, "Error parsing frame header\n");
     return -EINVAL;
 }
 
@@ -975,49 +977,157 @@ static int parse_tile_hdr(Dav1dContext *const c, GetBits *const gb) {
     return flush_get_bits(gb) - init_ptr;
 }
 
-int parse_obus(Dav1dContext *const c, Dav1dData *const in) {
-    GetBits gb;
-    int res;
-
-    init_get_bits(&gb, in->data, in->sz);
-
+// Reads an OBU header and length field, and returns the length of the OBU
+// payload following them, or -1 if they are invalid. OBUs without a length
+// field (e.g. from Annex B streams) extend to the end of the data. *layer_id
+// is set to the temporal layer id in bits 0-2, and the spatial one in bits
+// 8-9, or to -1 if the OBU has no extension.
+static int parse_obu_header(GetBits *const gb, enum ObuType *const type,
+                            int *const layer_id)
+{
     // obu header
-    get_bits(&gb, 1); // obu_forbidden_bit
-    const enum ObuType type = get_bits(&gb, 4);
-    const int has_extension = get_bits(&gb, 1);
-    const int has_length_field = get_bits(&gb, 1);
-    if (!has_length_field) goto error;
-    get_bits(&gb, 1); // reserved
+    get_bits(gb, 1); // obu_forbidden_bit
+    *type = get_bits(gb, 4);
+    const int has_extension = get_bits(gb, 1);
+    const int has_length_field = get_bits(gb, 1);
+    get_bits(gb, 1); // reserved
+    *layer_id = -1;
     if (has_extension) {
-        get_bits(&gb, 3); // temporal_layer_id
-        get_bits(&gb, 2); // enhancement_layer_id
-        get_bits(&gb, 3); // reserved
+        const int temporal_id = get_bits(gb, 3);
+        const int spatial_id = get_bits(gb, 2); // enhancement_layer_id
+        get_bits(gb, 3); // reserved
+        *layer_id = temporal_id | (spatial_id << 8);
+    }
+
+    if (!has_length_field) {
+        const size_t len = gb->ptr_end - gb->ptr_start - 1 - has_extension;
+        if (gb->error || len > INT_MAX) return -1;
+        return (int) len;
     }
 
     // obu length field
     int len = 0, more, i = 0;
     do {
-        more = get_bits(&gb, 1);
-        len |= get_bits(&gb, 7) << (i * 7);
-        if (more && ++i == 8) goto error;
+        more = get_bits(gb, 1);
+        len |= get_bits(gb, 7) << (i * 7);
+        if (more && ++i == 8) return -1;
     } while (more);
-    if (gb.error) goto error;
+    if (gb->error) return -1;
+
+    return len;
+}
+
+int dav1d_parse_sequence_header(const uint8_t *buf, size_t sz,
+                                Dav1dSequenceHeader *const out)
+{
+    validate_input_or_ret(buf != NULL || !sz, -EINVAL);
+    validate_input_or_ret(out != NULL, -EINVAL);
+
+    while (sz > 0) {
+        GetBits gb;
+        enum ObuType type;
+        int layer_id;
+
+        init_get_bits(&gb, buf, sz);
+        const int len = parse_obu_header(&gb, &type, &layer_id);
+        if (len < 0) return -EINVAL;
+        const size_t off = flush_get_bits(&gb) - buf;
+        if ((size_t) len > sz - off) return -EINVAL;
+
+        if (type == OBU_SEQ_HDR) {
+            Av1SequenceHeader hdr = { 0 };
+            if (parse_seq_hdr(NULL, &hdr, &gb) != len) return -EINVAL;
+
+            out->profile = hdr.profile;
+            out->still_picture = hdr.still_picture;
+            out->max_width = hdr.max_width;
+            out->max_height = hdr.max_height;
+            out->bpc = hdr.bpc;
+            out->layout = hdr.layout;
+            out->pri = hdr.pri;
+            out->trc = hdr.trc;
+            out->mtrx = hdr.mtrx;
+            out->chr = hdr.chr;
+            out->color_range = hdr.color_range;
+            out->num_operating_points = hdr.num_operating_points;
+            for (int i = 0; i < hdr.num_operating_points; i++) {
+                out->operating_points[i].idc = hdr.operating_points[i].idc;
+                out->operating_points[i].major_level =
+                    hdr.operating_points[i].major_level;
+                out->operating_points[i].minor_level =
+                    hdr.operating_points[i].minor_level;
+                out->operating_points[i].tier = hdr.operating_points[i].tier;
+            }
+            return 0;
+        }
+
+        buf += off + len;
+        sz -= off + len;
+    }
+
+    return -ENOENT;
+}
+
+// Whether the current frame is to be decoded, as per c->decode_frame_type;
+// inter frames are not if any of their references is missing, e.g. until
+// the next key frame after dav1d_flush().
+static int want_frame(const Dav1dContext *const c) {
+    if (c->frame_hdr.frame_type & 1)
+        for (int i = 0; i < 7; i++)
+            if (!c->refs[c->frame_hdr.refidx[i]].p.p.data[0])
+                return 0;
+
+    switch (c->decode_frame_type) {
+    case DAV1D_DECODEFRAMETYPE_REFERENCE:
+        return c->frame_hdr.refresh_frame_flags != 0;
+    case DAV1D_DECODEFRAMETYPE_INTRA:
+        return !(c->frame_hdr.frame_type & 1);
+    case DAV1D_DECODEFRAMETYPE_KEY:
+        return c->frame_hdr.frame_type == DAV1D_FRAME_TYPE_KEY;
+    default:
+        return 1;
+    }
+}
+
+static int parse_obu(Dav1dContext *const c, Dav1dData *const in) {
+    GetBits gb;
+    enum ObuType type;
+    int layer_id, res;
+
+    init_get_bits(&gb, in->data, in->sz);
+    const int len = parse_obu_header(&gb, &type, &layer_id);
+    if (len < 0) goto error;
 
     int off = flush_get_bits(&gb) - in->data;
     const int init_off = off;
     if (len > in->sz - off) goto error;
 
+    // skip OBUs of layers outside the operating point
+    if (layer_id >= 0 && c->operating_point_idc &&
+        type != OBU_SEQ_HDR && type != OBU_TD &&
+        !((c->operating_point_idc >> (layer_id & 7)) & 1 &&
+          (c->operating_point_idc >> (8 + (layer_id >> 8))) & 1))
+    {
+        return len + init_off;
+    }
+
     switch (type) {
     case OBU_SEQ_HDR:
-        if ((res = parse_seq_hdr(c, &gb)) < 0)
+        if ((res = parse_seq_hdr(c, &c->seq_hdr, &gb)) < 0)
             return res;
         if (res != len) goto error;
+        const int op = c->operating_point < c->seq_hdr.num_operating_points ?
+                       c->operating_point : 0;
+        c->operating_point_idc = c->seq_hdr.operating_points[op].idc;
         c->have_seq_hdr = 1;
         c->have_frame_hdr = 0;
+        if (c->frame_thread.tile_f) dav1d_submit_tile_data(c, 1);
         break;
     case OBU_FRAME:
     case OBU_FRAME_HDR:
         if (!c->have_seq_hdr) goto error;
+        // the previous frame is incomplete
+        if (c->frame_thread.tile_f) dav1d_submit_tile_data(c, 1);
         if ((res = parse_frame_hdr(c, &gb, type == OBU_FRAME_HDR)) < 0)
             return res;
         c->have_frame_hdr = 1;
@@ -1034,17 +1144,31 @@ int parse_obus(Dav1dContext *const c, Dav1dData *const in) {
         if ((res = parse_tile_hdr(c, &gb)) < 0)
             return res;
         off += res;
-        dav1d_ref_inc(in->ref);
-        c->tile[c->n_tile_data].data.ref = in->ref;
-        c->tile[c->n_tile_data].data.data = in->data + off;
-        c->tile[c->n_tile_data].data.sz = len + init_off - off;
         if (c->tile[c->n_tile_data].start > c->tile[c->n_tile_data].end)
             goto error;
+        // tile groups are in order, which lets frame threads decode them
+        // as they arrive
+        if (c->tile[c->n_tile_data].start != (c->tile_mask ?
+                                              ulog2(c->tile_mask) + 1 : 0))
+        {
+            goto error;
+        }
 #define mask(a) ((1 << (a)) - 1)
         const unsigned tile_mask = mask(c->tile[c->n_tile_data].end + 1) -
                                    mask(c->tile[c->n_tile_data].start);
 #undef mask
         if (tile_mask & c->tile_mask) goto error; // tile overlap
+        // referenced only now, so that the error paths above cannot leak it
+        if (want_frame(c)) {
+            dav1d_ref_inc(in->ref);
+            c->tile[c->n_tile_data].data.ref = in->ref;
+            c->tile[c->n_tile_data].data.data = in->data + off;
+            c->tile[c->n_tile_data].data.sz = len + init_off - off;
+        } else {
+            // only the tile positions are needed to find the end of the frame
+            memset(&c->tile[c->n_tile_data].data, 0,
+                   sizeof(c->tile[c->n_tile_data].data));
+        }
         c->tile_mask |= tile_mask;
         c->n_tile_data++;
         break;
@@ -1054,24 +1178,46 @@ int parse_obus(Dav1dContext *const c, Dav1dData *const in) {
         // ignore OBUs we don't care about
         break;
     default:
-        fprintf(stderr, "Unknown OBU type %d of size %d\n", type, len);
+        dav1d_log(c, "Unknown OBU type %d of size %d\n", type, len);
         return -EINVAL;
     }
 
     const int n_tiles = 1 << (c->frame_hdr.tiling.log2_cols +
                               c->frame_hdr.tiling.log2_rows);
-    if (c->have_seq_hdr && c->have_frame_hdr &&
-        c->tile_mask == (1 << n_tiles) - 1)
+    if (c->n_fc > 1 && (type == OBU_FRAME || type == OBU_TILE_GRP) &&
+        want_frame(c))
+    {
+        // with frame threading, the frame is submitted with its first tile
+        // group, and decoded while the others arrive
+        const int done = c->tile_mask == (1 << n_tiles) - 1;
+        if (!c->tile[0].start) submit_frame(c);
+        dav1d_submit_tile_data(c, done);
+        if (done) {
+            c->have_frame_hdr = 0;
+            c->tile_mask = 0;
+        }
+    } else if (c->have_seq_hdr && c->have_frame_hdr &&
+               c->tile_mask == (1 << n_tiles) - 1)
     {
         assert(c->n_tile_data);
-        submit_frame(c);
+        if (want_frame(c)) {
+            submit_frame(c);
+        } else {
+            // intra frames (the only ones decoded then, if the skipped frame
+            // refreshes any references) don't use the references, so these
+            // just keep the earlier pictures
+            c->skipped_refs |= c->frame_hdr.refresh_frame_flags;
+            c->n_tile_data = 0;
+        }
         assert(!c->n_tile_data);
         c->have_frame_hdr = 0;
         c->tile_mask = 0;
     } else if (c->have_seq_hdr && c->have_frame_hdr &&
                c->frame_hdr.show_existing_frame)
     {
-        if (c->n_fc == 1) {
+        if (c->skipped_refs & (1 << c->frame_hdr.existing_frame_idx)) {
+            // its frame was skipped
+        } else if (c->n_fc == 1) {
             dav1d_picture_ref(&c->out,
                               &c->refs[c->frame_hdr.existing_frame_idx].p.p);
         } else {
@@ -1081,10 +1227,7 @@ int parse_obus(Dav1dContext *const c, Dav1dData *const in) {
                 c->frame_thread.next = 0;
 
             Dav1dFrameContext *const f = &c->fc[next];
-            pthread_mutex_lock(&f->frame_thread.td.lock);
-            while (f->n_tile_data > 0)
-                pthread_cond_wait(&f->frame_thread.td.cond,
-                                  &f->frame_thread.td.lock);
+            dav1d_frame_thread_wait_idle(f, c->tc);
             Dav1dThreadPicture *const out_delayed =
                 &c->frame_thread.out_delayed[next];
             if (out_delayed->p.data[0]) {
@@ -1092,11 +1235,16 @@ int parse_obus(Dav1dContext *const c, Dav1dData *const in) {
                     dav1d_picture_ref(&c->out, &out_delayed->p);
                 dav1d_thread_picture_unref(out_delayed);
             }
+            pthread_mutex_lock(&c->picture_ready.lock);
             dav1d_thread_picture_ref(out_delayed,
                                      &c->refs[c->frame_hdr.existing_frame_idx].p);
             out_delayed->visible = 1;
             out_delayed->flushed = 0;
+            pthread_mutex_unlock(&c->picture_ready.lock);
             pthread_mutex_unlock(&f->frame_thread.td.lock);
+            // nothing to decode, but it is output after the pictures before
+            if (c->picture_ready.callback)
+                dav1d_picture_ready(c, &c->picture_ready, next);
         }
         c->have_frame_hdr = 0;
     }
@@ -1104,6 +1252,13 @@ int parse_obus(Dav1dContext *const c, Dav1dData *const in) {
     return len + init_off;
 
 error:
-    fprintf(stderr, "Error parsing OBU data\n");
+    dav1d_log(c, "Error parsing OBU data\n");
     return -EINVAL;
 }
+
+int parse_obus(Dav1dContext *const c, Dav1dData *const in) {
+    PROF_START(prof_start);
+    const int res = parse_obu(c, in);
+    PROF_END(prof_start, DAV1D_PROF_PARSE_OBUS);
+    return res;
+}
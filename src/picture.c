@@ -29,7 +29,7 @@
 
 #include <assert.h>
 #include <errno.h>
-#include <stdio.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -37,75 +37,171 @@
 #include "common/mem.h"
 #include "common/validate.h"
 
+#include "src/log.h"
 #include "src/picture.h"
 #include "src/ref.h"
 #include "src/thread.h"
 
-static int picture_alloc_with_edges(Dav1dPicture *const p,
+// Reference for a picture allocated by the user's allocator; the decoder's
+// extra data for the picture follows it.
+typedef struct UserPicture {
+    Dav1dRef ref;
+    Dav1dPicture pic;
+    Dav1dPicAllocator allocator;
+} UserPicture;
+
+#define USER_PICTURE_SIZE ((sizeof(UserPicture) + 31) & ~31)
+
+// a cache line for the PictureProgress of a Dav1dThreadPicture, wherever
+// the extra memory of the picture starts
+#define PROGRESS_SZ (((sizeof(PictureProgress) + 63) & ~63) + 64)
+
+static void user_picture_release(uint8_t *const data, void *const user_data) {
+    UserPicture *const up = user_data;
+
+    up->allocator.release_picture(&up->pic, up->allocator.cookie);
+    dav1d_free_aligned(up);
+}
+
+static int user_picture_alloc(const Dav1dContext *const c, Dav1dPicture *const p,
+                              const Dav1dPicAllocator *const allocator,
+                              const int extra, void **const extra_ptr)
+{
+    UserPicture *const up = dav1d_alloc_aligned(USER_PICTURE_SIZE + extra, 32);
+    if (!up) return -ENOMEM;
+
+    const int res = allocator->alloc_picture(p, allocator->cookie);
+    if (res < 0) {
+        dav1d_free_aligned(up);
+        return res;
+    }
+    const int has_chroma = p->p.layout != DAV1D_PIXEL_LAYOUT_I400;
+    const int has_v = has_chroma && p->p.format == DAV1D_OUTPUTFORMAT_PLANAR;
+    if (!p->data[0] || ((uintptr_t) p->data[0] & (DAV1D_PICTURE_ALIGNMENT - 1)) ||
+        (p->stride[0] & (DAV1D_PICTURE_ALIGNMENT - 1)) ||
+        (has_chroma &&
+         (!p->data[1] || ((uintptr_t) p->data[1] & (DAV1D_PICTURE_ALIGNMENT - 1)) ||
+          (p->stride[1] & (DAV1D_PICTURE_ALIGNMENT - 1)))) ||
+        (has_v &&
+         (!p->data[2] || ((uintptr_t) p->data[2] & (DAV1D_PICTURE_ALIGNMENT - 1)))))
+    {
+        dav1d_log(c, "Invalid picture from alloc_picture()\n");
+        allocator->release_picture(p, allocator->cookie);
+        dav1d_free_aligned(up);
+        return -EINVAL;
+    }
+
+    up->pic = *p;
+    up->allocator = *allocator;
+    dav1d_ref_init(&up->ref, up, USER_PICTURE_SIZE + extra,
+                   user_picture_release, up);
+    p->ref = &up->ref;
+    if (extra)
+        *extra_ptr = (uint8_t *) up + USER_PICTURE_SIZE;
+
+    return 0;
+}
+
+static int picture_alloc_with_edges(const Dav1dContext *const c,
+                                    Dav1dPicture *const p,
                                     const int w, const int h,
                                     const enum Dav1dPixelLayout layout,
-                                    const int bpc,
+                                    const enum Dav1dOutputFormat format,
+                                    const int bpc, const int align,
+                                    const Dav1dPicAllocator *const allocator,
+                                    Dav1dMemPool *const pool,
                                     const int extra, void **const extra_ptr)
 {
     int aligned_h;
 
     if (p->data[0]) {
-        fprintf(stderr, "Picture already allocated!\n");
+        dav1d_log(c, "Picture already allocated!\n");
         return -1;
     }
     assert(bpc > 0 && bpc <= 16);
 
     const int hbd = bpc > 8;
-    const int aligned_w = (w + 127) & ~127;
+    const int aligned_w = (w + align - 1) & ~(align - 1);
     const int has_chroma = layout != DAV1D_PIXEL_LAYOUT_I400;
     const int ss_ver = layout == DAV1D_PIXEL_LAYOUT_I420;
     const int ss_hor = layout != DAV1D_PIXEL_LAYOUT_I444;
+    // semi-planar pictures have a single chroma plane of twice the width,
+    // and thus take the same size as planar ones
+    const int n_uv = format == DAV1D_OUTPUTFORMAT_PLANAR ? 2 : 1;
     p->stride[0] = aligned_w << hbd;
-    p->stride[1] = has_chroma ? (aligned_w >> ss_hor) << hbd : 0;
+    p->stride[1] = has_chroma ? (aligned_w >> ss_hor) << (hbd + 2 - n_uv) : 0;
+    // with strides of a multiple of 1 KiB (e.g. 1024 or 4096 pixels wide),
+    // the rows that mc() reads for a block all map to the same few cache
+    // sets and evict each other; padding the stride spreads them out
+    if (!(p->stride[0] & 1023))
+        p->stride[0] += DAV1D_PICTURE_ALIGNMENT;
+    if (has_chroma && !(p->stride[1] & 1023))
+        p->stride[1] += DAV1D_PICTURE_ALIGNMENT;
     p->p.w = w;
     p->p.h = h;
     p->p.pri = DAV1D_COLOR_PRI_UNKNOWN;
     p->p.trc = DAV1D_TRC_UNKNOWN;
     p->p.mtrx = DAV1D_MC_UNKNOWN;
     p->p.chr = DAV1D_CHR_UNKNOWN;
-    aligned_h = (h + 127) & ~127;
+    aligned_h = (h + align - 1) & ~(align - 1);
     p->p.layout = layout;
+    p->p.format = format;
     p->p.bpc = bpc;
+    p->allocator_data = NULL;
+    if (allocator->alloc_picture)
+        return user_picture_alloc(c, p, allocator, extra, extra_ptr);
+
     const size_t y_sz = p->stride[0] * aligned_h;
     const size_t uv_sz = p->stride[1] * (aligned_h >> ss_ver);
-    if (!(p->ref = dav1d_ref_create(y_sz + 2 * uv_sz + extra))) {
-        fprintf(stderr, "Failed to allocate memory of size %zu: %s\n",
-                y_sz + 2 * uv_sz + extra, strerror(errno));
+    p->ref = pool ? dav1d_ref_create_using_pool(pool, y_sz + n_uv * uv_sz + extra) :
+                    dav1d_ref_create(y_sz + n_uv * uv_sz + extra);
+    if (!p->ref) {
+        dav1d_log(c, "Failed to allocate memory of size %zu: %s\n",
+                  y_sz + n_uv * uv_sz + extra, strerror(errno));
         return -ENOMEM;
     }
     uint8_t *data = p->ref->data;
     p->data[0] = data;
     p->data[1] = has_chroma ? data + y_sz : NULL;
-    p->data[2] = has_chroma ? data + y_sz + uv_sz : NULL;
+    p->data[2] = has_chroma && n_uv == 2 ? data + y_sz + uv_sz : NULL;
 
     if (extra)
-        *extra_ptr = &data[y_sz + uv_sz * 2];
+        *extra_ptr = &data[y_sz + uv_sz * n_uv];
 
     return 0;
 }
 
-int dav1d_thread_picture_alloc(Dav1dThreadPicture *const p,
+int dav1d_thread_picture_alloc(const Dav1dContext *const c,
+                               Dav1dThreadPicture *const p,
                                const int w, const int h,
-                               const enum Dav1dPixelLayout layout, const int bpc,
+                               const enum Dav1dPixelLayout layout,
+                               const enum Dav1dOutputFormat format, const int bpc,
+                               const int align,
+                               const Dav1dPicAllocator *const allocator,
+                               Dav1dMemPool *const pool,
                                struct thread_data *const t, const int visible)
 {
     p->t = t;
 
+    // the progress is written by the thread decoding the picture while
+    // others poll it, so it gets a cache line of its own, apart from the
+    // pixels before it and the reference count after it
+    void *extra;
     const int res =
-        picture_alloc_with_edges(&p->p, w, h, layout, bpc,
-                                 t != NULL ? sizeof(atomic_int) * 2 : 0,
-                                 (void **) &p->progress);
+        picture_alloc_with_edges(c, &p->p, w, h, layout, format, bpc, align,
+                                 allocator, pool,
+                                 t != NULL ? PROGRESS_SZ : 0, &extra);
 
     p->visible = visible;
     p->flushed = 0;
-    if (t) {
-        atomic_init(&p->progress[0], 0);
-        atomic_init(&p->progress[1], 0);
+    if (t && !res) {
+        p->progress =
+            (PictureProgress *) (((uintptr_t) extra + 63) & ~(uintptr_t) 63);
+        for (int i = 0; i < 2; i++) {
+            atomic_init(&p->progress->progress[i], 0);
+            atomic_init(&p->progress->min_wait[i], UINT_MAX);
+        }
+        p->progress->waiters = NULL;
     }
     return res;
 }
@@ -119,6 +215,8 @@ void dav1d_picture_ref(Dav1dPicture *const dst, const Dav1dPicture *const src) {
         validate_input(src->data[0] != NULL);
         dav1d_ref_inc(src->ref);
     }
+    if (src->block_info_ref)
+        dav1d_ref_inc(src->block_info_ref);
     *dst = *src;
 }
 
@@ -139,6 +237,8 @@ void dav1d_picture_unref(Dav1dPicture *const p) {
         validate_input(p->data[0] != NULL);
         dav1d_ref_dec(p->ref);
     }
+    if (p->block_info_ref)
+        dav1d_ref_dec(p->block_info_ref);
     memset(p, 0, sizeof(*p));
 }
 
@@ -149,28 +249,118 @@ void dav1d_thread_picture_unref(Dav1dThreadPicture *const p) {
     p->progress = NULL;
 }
 
+// A thread waiting for picture progress; lives on the waiter's stack, and
+// is in the picture's waiter list for as long as it waits.
+struct PictureWaiter {
+    struct PictureWaiter *next;
+    pthread_cond_t cond;
+    unsigned y;
+    int type; // index in PictureProgress.progress[]
+    int linked;
+};
+
+// Must be called with p->t->lock held.
+static void update_min_wait(PictureProgress *const pp) {
+    unsigned min_wait[2] = { UINT_MAX, UINT_MAX };
+
+    for (const struct PictureWaiter *w = pp->waiters; w; w = w->next)
+        if (w->y < min_wait[w->type]) min_wait[w->type] = w->y;
+    atomic_store(&pp->min_wait[0], min_wait[0]);
+    atomic_store(&pp->min_wait[1], min_wait[1]);
+}
+
+// Must be called with p->t->lock held.
+static void unlink_waiter(PictureProgress *const pp,
+                          struct PictureWaiter *const w)
+{
+    struct PictureWaiter **pw = &pp->waiters;
+    while (*pw != w) pw = &(*pw)->next;
+    *pw = w->next;
+    w->linked = 0;
+}
+
+// Converts y (in units of plane_type) to the luma row of p's progress to
+// wait for.
+static int wait_row(const Dav1dThreadPicture *const p, int y_unclipped,
+                    const enum PlaneType plane_type)
+{
+    // convert to luma units; include plane delay from loopfilters; clip
+    const int ss_ver = p->p.p.layout == DAV1D_PIXEL_LAYOUT_I420;
+    y_unclipped *= 1 << (plane_type & ss_ver); // we rely here on PLANE_TYPE_UV being 1
+    y_unclipped += (plane_type != PLANE_TYPE_BLOCK) * 8; // delay imposed by loopfilter
+    return iclip(y_unclipped, 1, p->p.p.h);
+}
+
+int dav1d_thread_picture_progressed(const Dav1dThreadPicture *const p,
+                                    const int y, const enum PlaneType plane_type)
+{
+    assert(plane_type != PLANE_TYPE_ALL);
+
+    if (!p->t)
+        return 1;
+
+    const int type = plane_type != PLANE_TYPE_BLOCK;
+    return atomic_load_explicit(&p->progress->progress[type],
+                                memory_order_acquire) >=
+           (unsigned) wait_row(p, y, plane_type);
+}
+
 void dav1d_thread_picture_wait(const Dav1dThreadPicture *const p,
-                               int y_unclipped, const enum PlaneType plane_type)
+                               const int y_unclipped,
+                               const enum PlaneType plane_type)
 {
     assert(plane_type != PLANE_TYPE_ALL);
 
     if (!p->t)
         return;
 
-    // convert to luma units; include plane delay from loopfilters; clip
-    const int ss_ver = p->p.p.layout == DAV1D_PIXEL_LAYOUT_I420;
-    y_unclipped *= 1 << (plane_type & ss_ver); // we rely here on PLANE_TYPE_UV being 1
-    y_unclipped += (plane_type != PLANE_TYPE_BLOCK) * 8; // delay imposed by loopfilter
-    const int y = iclip(y_unclipped, 1, p->p.p.h);
-    atomic_uint *const progress = &p->progress[plane_type != PLANE_TYPE_BLOCK];
+    const int y = wait_row(p, y_unclipped, plane_type);
+    const int type = plane_type != PLANE_TYPE_BLOCK;
+    PictureProgress *const pp = p->progress;
+    atomic_uint *const progress = &pp->progress[type];
 
-    if (atomic_load_explicit(progress, memory_order_acquire) >= y)
+    if (atomic_load_explicit(progress, memory_order_acquire) >= (unsigned) y)
+        return;
+    dav1d_spin_while(&p->t->spin,
+                     atomic_load_explicit(progress, memory_order_acquire) <
+                     (unsigned) y);
+    if (atomic_load_explicit(progress, memory_order_acquire) >= (unsigned) y)
         return;
 
+    struct PictureWaiter w = { .y = y, .type = type, .linked = 1 };
+    pthread_cond_init(&w.cond, NULL);
     pthread_mutex_lock(&p->t->lock);
-    while (atomic_load_explicit(progress, memory_order_relaxed) < y)
-        pthread_cond_wait(&p->t->cond, &p->t->lock);
+    w.next = pp->waiters;
+    pp->waiters = &w;
+    if ((unsigned) y < atomic_load(&pp->min_wait[type]))
+        atomic_store(&pp->min_wait[type], y);
+    // the signalling thread stores progress before it loads min_wait, and
+    // we store min_wait before loading progress, so (all being sequentially
+    // consistent) either it sees our min_wait, or we see its progress
+    while (atomic_load(progress) < (unsigned) y)
+        pthread_cond_wait(&w.cond, &p->t->lock);
+    if (w.linked) {
+        unlink_waiter(pp, &w);
+        update_min_wait(pp);
+    }
     pthread_mutex_unlock(&p->t->lock);
+    pthread_cond_destroy(&w.cond);
+}
+
+int dav1d_thread_picture_has_waiters(const Dav1dThreadPicture *const p) {
+    if (!p->t)
+        return 0;
+
+    return atomic_load(&p->progress->min_wait[0]) != UINT_MAX ||
+           atomic_load(&p->progress->min_wait[1]) != UINT_MAX;
+}
+
+int dav1d_thread_picture_done(const Dav1dThreadPicture *const p) {
+    if (!p->t)
+        return 1;
+
+    return atomic_load_explicit(&p->progress->progress[1],
+                                memory_order_acquire) == UINT_MAX;
 }
 
 void dav1d_thread_picture_signal(const Dav1dThreadPicture *const p,
@@ -182,9 +372,31 @@ void dav1d_thread_picture_signal(const Dav1dThreadPicture *const p,
     if (!p->t)
         return;
 
+    PictureProgress *const pp = p->progress;
+    int wake = 0;
+    if (plane_type != PLANE_TYPE_Y) {
+        atomic_store(&pp->progress[0], y);
+        wake |= atomic_load_explicit(&pp->min_wait[0],
+                                     memory_order_seq_cst) <= (unsigned) y;
+    }
+    if (plane_type != PLANE_TYPE_BLOCK) {
+        atomic_store(&pp->progress[1], y);
+        wake |= atomic_load_explicit(&pp->min_wait[1],
+                                     memory_order_seq_cst) <= (unsigned) y;
+    }
+    if (!wake) return;
+
+    // only wake up the waiters whose row has been reached
     pthread_mutex_lock(&p->t->lock);
-    if (plane_type != PLANE_TYPE_Y) atomic_store(&p->progress[0], y);
-    if (plane_type != PLANE_TYPE_BLOCK) atomic_store(&p->progress[1], y);
-    pthread_cond_broadcast(&p->t->cond);
+    for (struct PictureWaiter *w = pp->waiters, *next; w; w = next) {
+        next = w->next;
+        if (atomic_load_explicit(&pp->progress[w->type],
+                                 memory_order_relaxed) >= w->y)
+        {
+            unlink_waiter(pp, w);
+            pthread_cond_signal(&w->cond);
+        }
+    }
+    update_min_wait(pp);
     pthread_mutex_unlock(&p->t->lock);
 }
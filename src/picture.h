@@ -33,6 +33,7 @@
 #include "src/thread.h"
 #include "dav1d/picture.h"
 
+#include "src/ref.h"
 #include "src/thread_data.h"
 
 enum PlaneType {
@@ -42,20 +43,38 @@ enum PlaneType {
     PLANE_TYPE_ALL,
 };
 
+struct PictureWaiter;
+
+typedef struct PictureProgress {
+    // [0] block data (including segmentation map and motion vectors)
+    // [1] pixel data
+    atomic_uint progress[2];
+    // lowest y that any waiter in the list below waits for, or UINT_MAX;
+    // progress up to below that is signalled without taking the lock
+    atomic_uint min_wait[2];
+    struct PictureWaiter *waiters; // protected by t->lock
+} PictureProgress;
+
 typedef struct Dav1dThreadPicture {
     Dav1dPicture p;
     int visible, flushed;
     struct thread_data *t;
-    // [0] block data (including segmentation map and motion vectors)
-    // [1] pixel data
-    atomic_uint *progress;
+    PictureProgress *progress;
 } Dav1dThreadPicture;
 
 /*
- * Allocate a picture with custom border size.
+ * Allocate a picture with custom border size, using the user's allocator if
+ * it has an alloc_picture callback, else from pool if non-NULL. The planes
+ * are padded to a multiple of align (a power of two, at least the superblock
+ * size) luma pixels in both dimensions. Pictures of either format take the
+ * same size. Failures are logged to c.
  */
-int dav1d_thread_picture_alloc(Dav1dThreadPicture *p, int w, int h,
-                               enum Dav1dPixelLayout layout, int bpc,
+int dav1d_thread_picture_alloc(const Dav1dContext *c,
+                               Dav1dThreadPicture *p, int w, int h,
+                               enum Dav1dPixelLayout layout,
+                               enum Dav1dOutputFormat format, int bpc, int align,
+                               const Dav1dPicAllocator *allocator,
+                               Dav1dMemPool *pool,
                                struct thread_data *t, int visible);
 
 /**
@@ -77,6 +96,25 @@ void dav1d_thread_picture_unref(Dav1dThreadPicture *p);
 void dav1d_thread_picture_wait(const Dav1dThreadPicture *p, int y,
                                enum PlaneType plane_type);
 
+/**
+ * Whether dav1d_thread_picture_wait() with the same arguments would return
+ * right away, without waiting.
+ */
+int dav1d_thread_picture_progressed(const Dav1dThreadPicture *p, int y,
+                                    enum PlaneType plane_type);
+
+/**
+ * Whether any thread is waiting in dav1d_thread_picture_wait() for the
+ * picture to progress, without waiting.
+ */
+int dav1d_thread_picture_has_waiters(const Dav1dThreadPicture *p);
+
+/**
+ * Whether the picture has been fully decoded (i.e. its last progress signal
+ * was for all rows), without waiting.
+ */
+int dav1d_thread_picture_done(const Dav1dThreadPicture *p);
+
 /**
  * Signal decoding progress.
  *
@@ -0,0 +1,87 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "config.h"
+
+#include "common/bitdepth.h"
+
+#include "src/pixfmt.h"
+
+static void interleave_uv_c(pixel *dst, const ptrdiff_t dst_stride,
+                            const pixel *u, const pixel *v,
+                            const ptrdiff_t src_stride,
+                            const int w, const int h, const int shift)
+{
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            dst[2 * x + 0] = u[x] << shift;
+            dst[2 * x + 1] = v[x] << shift;
+        }
+        dst += PXSTRIDE(dst_stride);
+        u += PXSTRIDE(src_stride);
+        v += PXSTRIDE(src_stride);
+    }
+}
+
+static void shift_copy_c(pixel *dst, const ptrdiff_t dst_stride,
+                         const pixel *src, const ptrdiff_t src_stride,
+                         const int w, const int h, const int shift)
+{
+    for (int y = 0; y < h; y++) {
+        if (shift) {
+            for (int x = 0; x < w; x++)
+                dst[x] = src[x] << shift;
+        } else {
+            pixel_copy(dst, src, w);
+        }
+        dst += PXSTRIDE(dst_stride);
+        src += PXSTRIDE(src_stride);
+    }
+}
+
+void bitfn(dav1d_pixfmt_dsp_init)(Dav1dPixFmtDSPContext *const c) {
+    c->interleave_uv = interleave_uv_c;
+    c->shift_copy = shift_copy_c;
+}
+
+void bitfn(dav1d_convert_picture)(const Dav1dPixFmtDSPContext *const dsp,
+                                  Dav1dPicture *const out,
+                                  const Dav1dPicture *const in)
+{
+    const int shift = BITDEPTH == 8 ? 0 : 16 - in->p.bpc;
+    const int ss_ver = in->p.layout == DAV1D_PIXEL_LAYOUT_I420;
+    const int ss_hor = in->p.layout != DAV1D_PIXEL_LAYOUT_I444;
+    const int w = in->p.w, h = in->p.h;
+
+    dsp->shift_copy(out->data[0], out->stride[0], in->data[0], in->stride[0],
+                    w, h, shift);
+    if (in->p.layout == DAV1D_PIXEL_LAYOUT_I400) return;
+
+    dsp->interleave_uv(out->data[1], out->stride[1],
+                       in->data[1], in->data[2], in->stride[1],
+                       (w + ss_hor) >> ss_hor, (h + ss_ver) >> ss_ver, shift);
+}
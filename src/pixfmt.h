@@ -0,0 +1,71 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __DAV1D_SRC_PIXFMT_H__
+#define __DAV1D_SRC_PIXFMT_H__
+
+#include <stddef.h>
+
+#include "common/bitdepth.h"
+
+#include "dav1d/picture.h"
+
+// Interleaves h rows of w U and V pixels into dst (as U0 V0 U1 V1 ...),
+// shifting each of them left by shift (to move high bitdepth samples to
+// the most significant bits).
+#define decl_interleave_uv_fn(name) \
+void (name)(pixel *dst, ptrdiff_t dst_stride, \
+            const pixel *u, const pixel *v, ptrdiff_t src_stride, \
+            int w, int h, int shift)
+typedef decl_interleave_uv_fn(*interleave_uv_fn);
+
+// Copies h rows of w pixels, shifting each of them left by shift.
+#define decl_shift_copy_fn(name) \
+void (name)(pixel *dst, ptrdiff_t dst_stride, \
+            const pixel *src, ptrdiff_t src_stride, \
+            int w, int h, int shift)
+typedef decl_shift_copy_fn(*shift_copy_fn);
+
+typedef struct Dav1dPixFmtDSPContext {
+    interleave_uv_fn interleave_uv;
+    shift_copy_fn shift_copy;
+} Dav1dPixFmtDSPContext;
+
+void dav1d_pixfmt_dsp_init_8bpc(Dav1dPixFmtDSPContext *c);
+void dav1d_pixfmt_dsp_init_10bpc(Dav1dPixFmtDSPContext *c);
+
+// Writes in, a planar picture, to out in the format of out->p.format; out
+// must be allocated with the same size, layout and bitdepth.
+#define decl_convert_picture_fn(name) \
+void (name)(const Dav1dPixFmtDSPContext *dsp, \
+            Dav1dPicture *out, const Dav1dPicture *in)
+typedef decl_convert_picture_fn(*convert_picture_fn);
+
+decl_convert_picture_fn(dav1d_convert_picture_8bpc);
+decl_convert_picture_fn(dav1d_convert_picture_10bpc);
+
+#endif /* __DAV1D_SRC_PIXFMT_H__ */
@@ -0,0 +1,96 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __DAV1D_SRC_PROFILE_H__
+#define __DAV1D_SRC_PROFILE_H__
+
+// Timing of the decoding stages (see Dav1dProfileStage), if built with
+// CONFIG_PROFILING: each thread accumulates into its own Dav1dProfile,
+// which it sets with dav1d_prof_set(), and a stage is timed by putting
+// PROF_START(name) at its start and PROF_END(name, stage) at each exit.
+
+#if CONFIG_PROFILING
+
+#include <stdint.h>
+
+#include "dav1d/dav1d.h"
+
+#include "src/thread_task.h"
+
+#if ARCH_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#elif ARCH_X86
+#include <x86intrin.h>
+#endif
+
+#ifdef _MSC_VER
+#define PROF_THREAD_LOCAL __declspec(thread)
+#else
+#define PROF_THREAD_LOCAL __thread
+#endif
+
+extern PROF_THREAD_LOCAL Dav1dProfile *dav1d_prof_cur;
+
+static inline void dav1d_prof_set(Dav1dProfile *const prof) {
+    dav1d_prof_cur = prof;
+}
+
+static inline uint64_t dav1d_prof_ticks(void) {
+#if ARCH_X86
+    return __rdtsc();
+#elif ARCH_AARCH64 && defined(__GNUC__)
+    uint64_t t;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(t));
+    return t;
+#else
+    return dav1d_time_nanos();
+#endif
+}
+
+static inline void dav1d_prof_add(const enum Dav1dProfileStage stage,
+                                  const uint64_t start)
+{
+    Dav1dProfile *const prof = dav1d_prof_cur;
+
+    if (prof) {
+        prof->ticks[stage] += dav1d_prof_ticks() - start;
+        prof->calls[stage]++;
+    }
+}
+
+#define PROF_START(name) const uint64_t name = dav1d_prof_ticks()
+#define PROF_END(name, stage) dav1d_prof_add(stage, name)
+
+#else
+
+#define dav1d_prof_set(prof) do { } while (0)
+#define PROF_START(name) do { } while (0)
+#define PROF_END(name, stage) do { } while (0)
+
+#endif
+
+#endif /* __DAV1D_SRC_PROFILE_H__ */
@@ -30,6 +30,7 @@
 #include <string.h>
 
 #include "src/qm.h"
+#include "src/thread.h"
 
 static const uint8_t qm_tbl_4x4_t[][2][10] = {
     {
@@ -3063,8 +3064,19 @@ static const uint8_t qm_tbl_32x32_t[][2][528] = {
     },
 };
 
+#define PB_32_X4   32, 32, 32, 32
+#define PB_32_X16  PB_32_X4,  PB_32_X4,  PB_32_X4,  PB_32_X4
+#define PB_32_X64  PB_32_X16, PB_32_X16, PB_32_X16, PB_32_X16
+#define PB_32_X256 PB_32_X64, PB_32_X64, PB_32_X64, PB_32_X64
+const uint8_t av1_qm_flat[32 * 32] = {
+    PB_32_X256, PB_32_X256, PB_32_X256, PB_32_X256
+};
+#undef PB_32_X256
+#undef PB_32_X64
+#undef PB_32_X16
+#undef PB_32_X4
+
 const uint8_t *av1_qm_tbl[16][2][N_RECT_TX_SIZES];
-static uint8_t pb_32x32[32 * 32];
 static uint8_t qm_tbl_4x4[15][2][16];
 static uint8_t qm_tbl_4x8[15][2][32];
 static uint8_t qm_tbl_4x16[15][2][64];
@@ -3104,8 +3116,7 @@ static void untriangle(uint8_t *dst, const uint8_t *src, const int sz) {
     }
 }
 
-void av1_init_qm_tables(void) {
-    // This function is guaranteed to be called only once by dav1d_init
+static void init_qm_tables(void) {
 
     for (int i = 0; i < 15; i++)
         for (int j = 0; j < 2; j++) {
@@ -3143,8 +3154,12 @@ void av1_init_qm_tables(void) {
             av1_qm_tbl[i][j][RTX_16X64] = av1_qm_tbl[i][j][RTX_16X32];
         }
 
-    memset(pb_32x32, 32, sizeof(pb_32x32));
     for (int j = 0; j < 2; j++)
         for (int k = 0; k < N_RECT_TX_SIZES; k++)
-            av1_qm_tbl[15][j][k] = pb_32x32;
+            av1_qm_tbl[15][j][k] = av1_qm_flat;
+}
+
+void av1_init_qm_tables(void) {
+    static pthread_once_t initted = PTHREAD_ONCE_INIT;
+    pthread_once(&initted, init_qm_tables);
 }
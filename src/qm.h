@@ -31,7 +31,10 @@
 #include "src/levels.h"
 
 extern const uint8_t *av1_qm_tbl[16][2][N_RECT_TX_SIZES];
+extern const uint8_t av1_qm_flat[32 * 32];
 
+// Builds av1_qm_tbl[] on the first call; only frames using quantizer
+// matrices need it, the flat matrix is static data.
 void av1_init_qm_tables(void);
 
 #endif /* __DAV1D_SRC_QM_H__ */
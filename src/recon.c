@@ -29,6 +29,7 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "common/attributes.h"
 #include "common/bitdepth.h"
@@ -37,12 +38,16 @@
 #include "common/mem.h"
 
 #include "src/cdef_apply.h"
+#include "src/decode.h"
+#include "src/dsp_stats.h"
 #include "src/ipred_prepare.h"
 #include "src/lf_apply.h"
 #include "src/lr_apply.h"
+#include "src/profile.h"
 #include "src/recon.h"
 #include "src/scan.h"
 #include "src/tables.h"
+#include "src/thread_task.h"
 #include "src/wedge.h"
 
 static unsigned read_golomb(MsacContext *const msac) {
@@ -55,6 +60,113 @@ static unsigned read_golomb(MsacContext *const msac) {
     return val - 1;
 }
 
+static inline int read_br_tok(MsacContext *const msac, uint16_t *const br_cdf,
+                              int tok)
+{
+    do {
+        const int tok_br = msac_decode_symbol_adapt4(msac, br_cdf, 4);
+        tok += tok_br;
+        if (tok_br < 3) break;
+    } while (tok < 15);
+
+    return tok;
+}
+
+/* Decodes the base and range tokens of the coefficients in scan positions
+ * eob (> 0) down to 0 into cf[] and levels[]. This is the same as calling
+ * get_coef_nz_ctx() and get_br_ctx() for each coefficient, but tx_class is
+ * a constant at every call site, so each class gets its own loop with the
+ * neighbour offsets folded in. The eob and DC coefficients are peeled off,
+ * which removes the is_last and rc == 0 special cases from the loop. */
+static ALWAYS_INLINE void decode_coef_toks(Dav1dTileState *const ts,
+                                           const enum RectTxfmSize tx,
+                                           const enum TxClass tx_class,
+                                           const int chroma, const int eob,
+                                           const int16_t *const scan,
+                                           uint8_t *const levels,
+                                           coef *const cf)
+{
+    const TxfmInfo *const t_dim = &av1_txfm_dimensions[tx];
+    uint16_t (*const lo_cdf)[5] = ts->cdf.coef.base_tok[t_dim->ctx][chroma];
+    uint16_t (*const br_cdf)[5] =
+        ts->cdf.coef.br_tok[imin(t_dim->ctx, 3)][chroma];
+    const uint8_t (*const nz_ctx_off)[5] = av1_nz_map_ctx_offset[tx];
+    const int shift = 2 + imin(t_dim->lh, 3), mask = 4 * imin(t_dim->h, 8) - 1;
+    const ptrdiff_t stride = 4 * (imin(t_dim->h, 8) + 1);
+
+    // eob coefficient; all of its neighbours are still zero
+    {
+        const int rc = scan[eob], x = rc >> shift, y = rc & mask;
+        const int eighth_sz = imin(t_dim->w, 8) * imin(t_dim->h, 8) * 2;
+        const int ctx = 1 + (eob > eighth_sz) + (eob > eighth_sz * 2);
+        int tok = 1 + msac_decode_symbol_adapt4(&ts->msac,
+                          ts->cdf.coef.eob_base_tok[t_dim->ctx][chroma][ctx], 3);
+        if (tok == 3) {
+            const int near_dc = tx_class == TX_CLASS_2D ? (x | y) < 2 :
+                                tx_class == TX_CLASS_H ? !x : !y;
+            tok = read_br_tok(&ts->msac, br_cdf[near_dc ? 7 : 14], 3);
+        }
+        levels[x * stride + y] = cf[rc] = tok;
+    }
+
+    for (int i = eob - 1; i > 0; i--) {
+        const int rc = scan[i], x = rc >> shift, y = rc & mask;
+        const uint8_t *const lvl = &levels[x * stride + y];
+
+        int mag = imin(lvl[1], 3) + imin(lvl[stride], 3);
+        switch (tx_class) {
+        case TX_CLASS_2D:
+            mag += imin(lvl[2], 3) + imin(lvl[stride + 1], 3) +
+                   imin(lvl[2 * stride], 3);
+            break;
+        case TX_CLASS_V:
+            mag += imin(lvl[2], 3) + imin(lvl[3], 3) + imin(lvl[4], 3);
+            break;
+        case TX_CLASS_H:
+            mag += imin(lvl[2 * stride], 3) + imin(lvl[3 * stride], 3) +
+                   imin(lvl[4 * stride], 3);
+            break;
+        }
+        const int nz_mag = imin((mag + 1) >> 1, 4);
+        const int ctx = tx_class == TX_CLASS_2D ?
+            nz_ctx_off[imin(y, 4)][imin(x, 4)] + nz_mag :
+            26 + imin(tx_class == TX_CLASS_V ? y : x, 2) * 5 + nz_mag;
+        int tok = msac_decode_symbol_adapt4(&ts->msac, lo_cdf[ctx], 4);
+        if (!tok) continue;
+
+        if (tok == 3) {
+            const int br_mag = lvl[1] + lvl[stride] +
+                (tx_class == TX_CLASS_2D ? lvl[stride + 1] :
+                 tx_class == TX_CLASS_H ? lvl[2 * stride] : lvl[2]);
+            const int near_dc = tx_class == TX_CLASS_2D ? (x | y) < 2 :
+                                tx_class == TX_CLASS_H ? !x : !y;
+            const int br_ctx = imin((br_mag + 1) >> 1, 6) + (near_dc ? 7 : 14);
+            tok = read_br_tok(&ts->msac, br_cdf[br_ctx], 3);
+        }
+        levels[x * stride + y] = cf[rc] = tok;
+    }
+
+    // dc coefficient
+    {
+        int ctx = 0;
+        if (tx_class != TX_CLASS_2D) {
+            const int s = tx_class == TX_CLASS_V ? 1 : stride;
+            const int mag = imin(levels[s], 3) + imin(levels[s * 2], 3) +
+                            imin(levels[s * 3], 3) + imin(levels[s * 4], 3) +
+                            imin(levels[tx_class == TX_CLASS_V ? stride : 1], 3);
+            ctx = 26 + imin((mag + 1) >> 1, 4);
+        }
+        int tok = msac_decode_symbol_adapt4(&ts->msac, lo_cdf[ctx], 4);
+        if (tok == 3) {
+            const int br_mag = levels[1] + levels[stride] +
+                (tx_class == TX_CLASS_2D ? levels[stride + 1] :
+                 tx_class == TX_CLASS_H ? levels[2 * stride] : levels[2]);
+            tok = read_br_tok(&ts->msac, br_cdf[imin((br_mag + 1) >> 1, 6)], 3);
+        }
+        cf[0] = tok;
+    }
+}
+
 static int decode_coefs(Dav1dTileContext *const t,
                         uint8_t *const a, uint8_t *const l,
                         const enum RectTxfmSize tx, const enum BlockSize bs,
@@ -62,25 +174,28 @@ static int decode_coefs(Dav1dTileContext *const t,
                         const int plane, coef *cf,
                         enum TxfmType *const txtp, uint8_t *res_ctx)
 {
+    PROF_START(prof_start);
     Dav1dTileState *const ts = t->ts;
     const int chroma = !!plane;
     const Dav1dFrameContext *const f = t->f;
     const TxfmInfo *const t_dim = &av1_txfm_dimensions[tx];
-    const int dbg = DEBUG_BLOCK_INFO && plane && 0;
+    const int dbg = DEBUG_COEF_INFO;
 
-    if (dbg) printf("Start: r=%d\n", ts->msac.rng);
+    if (f->c->frame_stats) ts->stats.tx[tx]++;
+    if (dbg) dav1d_log(f->c, "Start: r=%d\n", ts->msac.rng);
 
     // does this block have any non-zero coefficients
     const int sctx = get_coef_skip_ctx(t_dim, bs, a, l, chroma, f->cur.p.p.layout);
     const int all_skip =
         msac_decode_bool_adapt(&ts->msac, ts->cdf.coef.skip[t_dim->ctx][sctx]);
     if (dbg)
-    printf("Post-non-zero[%d][%d][%d]: r=%d\n",
-           t_dim->ctx, sctx, all_skip, ts->msac.rng);
+    dav1d_log(f->c, "Post-non-zero[%d][%d][%d]: r=%d\n",
+              t_dim->ctx, sctx, all_skip, ts->msac.rng);
     if (all_skip) {
         *res_ctx = 0x40;
         *txtp = f->frame_hdr.segmentation.lossless[b->seg_id] ? WHT_WHT :
                                                                 DCT_DCT;
+        PROF_END(prof_start, DAV1D_PROF_COEFS);
         return -1;
     }
 
@@ -106,11 +221,11 @@ static int decode_coefs(Dav1dTileContext *const t,
             uint16_t *const txtp_cdf = intra ?
                        ts->cdf.m.txtp_intra[set_idx][t_dim->min][y_mode_nofilt] :
                        ts->cdf.m.txtp_inter[set_idx][t_dim->min];
-            idx = msac_decode_symbol_adapt(&ts->msac, txtp_cdf, set_cnt);
+            idx = msac_decode_symbol_adapt16(&ts->msac, txtp_cdf, set_cnt);
             if (dbg)
-            printf("Post-txtp[%d->%d][%d->%d][%d][%d->%d]: r=%d\n",
-                   set, set_idx, tx, t_dim->min, b->intra ? y_mode_nofilt : -1,
-                   idx, av1_tx_types_per_set[set][idx], ts->msac.rng);
+            dav1d_log(f->c, "Post-txtp[%d->%d][%d->%d][%d][%d->%d]: r=%d\n",
+                      set, set_idx, tx, t_dim->min, b->intra ? y_mode_nofilt : -1,
+                      idx, av1_tx_types_per_set[set][idx], ts->msac.rng);
         }
         *txtp = av1_tx_types_per_set[set][idx];
     }
@@ -124,7 +239,7 @@ static int decode_coefs(Dav1dTileContext *const t,
 #define case_sz(sz, bin) \
     case sz: { \
         uint16_t *const eob_bin_cdf = ts->cdf.coef.eob_bin_##bin[chroma][is_1d]; \
-        eob_bin = msac_decode_symbol_adapt(&ts->msac, eob_bin_cdf, 5 + sz); \
+        eob_bin = msac_decode_symbol_adapt16(&ts->msac, eob_bin_cdf, 5 + sz); \
         break; \
     }
     case_sz(0,   16);
@@ -137,8 +252,8 @@ static int decode_coefs(Dav1dTileContext *const t,
 #undef case_sz
     }
     if (dbg)
-    printf("Post-eob_bin_%d[%d][%d][%d]: r=%d\n",
-           16 << tx2dszctx, chroma, is_1d, eob_bin, ts->msac.rng);
+    dav1d_log(f->c, "Post-eob_bin_%d[%d][%d][%d]: r=%d\n",
+              16 << tx2dszctx, chroma, is_1d, eob_bin, ts->msac.rng);
     int eob;
     if (eob_bin > 1) {
         eob = 1 << (eob_bin - 1);
@@ -146,8 +261,8 @@ static int decode_coefs(Dav1dTileContext *const t,
             ts->cdf.coef.eob_hi_bit[t_dim->ctx][chroma][eob_bin];
         const int eob_hi_bit = msac_decode_bool_adapt(&ts->msac, eob_hi_bit_cdf);
         if (dbg)
-        printf("Post-eob_hi_bit[%d][%d][%d][%d]: r=%d\n",
-               t_dim->ctx, chroma, eob_bin, eob_hi_bit, ts->msac.rng);
+        dav1d_log(f->c, "Post-eob_hi_bit[%d][%d][%d][%d]: r=%d\n",
+                  t_dim->ctx, chroma, eob_bin, eob_hi_bit, ts->msac.rng);
         unsigned mask = eob >> 1;
         if (eob_hi_bit) eob |= mask;
         for (mask >>= 1; mask; mask >>= 1) {
@@ -155,63 +270,52 @@ static int decode_coefs(Dav1dTileContext *const t,
             if (eob_bit) eob |= mask;
         }
         if (dbg)
-        printf("Post-eob[%d]: r=%d\n", eob, ts->msac.rng);
+        dav1d_log(f->c, "Post-eob[%d]: r=%d\n", eob, ts->msac.rng);
     } else {
         eob = eob_bin;
     }
 
     // base tokens
-    uint16_t (*const br_cdf)[5] =
-        ts->cdf.coef.br_tok[imin(t_dim->ctx, 3)][chroma];
     const int16_t *const scan = av1_scans[tx][tx_class];
-    uint8_t levels[36 * 36];
-    ptrdiff_t stride = 4 * (imin(t_dim->h, 8) + 1);
-    memset(levels, 0, stride * 4 * (imin(t_dim->w, 8) + 1));
-    const int shift = 2 + imin(t_dim->lh, 3), mask = 4 * imin(t_dim->h, 8) - 1;
     unsigned cul_level = 0;
-    for (int i = eob, is_last = 1; i >= 0; i--, is_last = 0) {
-        const int rc = scan[i], x = rc >> shift, y = rc & mask;
-
-        // lo tok
-        const int ctx = get_coef_nz_ctx(levels, i, rc, is_last, tx, tx_class);
-        uint16_t *const lo_cdf = is_last ?
-            ts->cdf.coef.eob_base_tok[t_dim->ctx][chroma][ctx] :
-            ts->cdf.coef.base_tok[t_dim->ctx][chroma][ctx];
-        int tok = msac_decode_symbol_adapt(&ts->msac, lo_cdf,
-                                           4 - is_last) + is_last;
-        if (dbg)
-        printf("Post-lo_tok[%d][%d][%d][%d=%d=%d]: r=%d\n",
-               t_dim->ctx, chroma, ctx, i, rc, tok, ts->msac.rng);
-        if (!tok) continue;
-
-        // hi tok
-        if (tok == 3) {
-            const int br_ctx = get_br_ctx(levels, rc, tx, tx_class);
-            do {
-                const int tok_br =
-                    msac_decode_symbol_adapt(&ts->msac, br_cdf[br_ctx], 4);
-                if (dbg)
-                printf("Post-hi_tok[%d][%d][%d][%d=%d=%d->%d]: r=%d\n",
-                       imin(t_dim->ctx, 3), chroma, br_ctx,
-                       i, rc, tok_br, tok, ts->msac.rng);
-                tok += tok_br;
-                if (tok_br < 3) break;
-            } while (tok < 15);
+    if (eob) {
+        uint8_t levels[36 * 36];
+        const ptrdiff_t stride = 4 * (imin(t_dim->h, 8) + 1);
+        memset(levels, 0, stride * 4 * (imin(t_dim->w, 8) + 1));
+        switch (tx_class) {
+        case TX_CLASS_2D:
+            decode_coef_toks(ts, tx, TX_CLASS_2D, chroma, eob, scan, levels, cf);
+            break;
+        case TX_CLASS_H:
+            decode_coef_toks(ts, tx, TX_CLASS_H, chroma, eob, scan, levels, cf);
+            break;
+        case TX_CLASS_V:
+            decode_coef_toks(ts, tx, TX_CLASS_V, chroma, eob, scan, levels, cf);
+            break;
         }
-
-        levels[x * stride + y] = cf[rc] = tok;
+    } else {
+        // dc-only blocks don't need the levels array or any neighbour context
+        int tok = 1 + msac_decode_symbol_adapt4(&ts->msac,
+                          ts->cdf.coef.eob_base_tok[t_dim->ctx][chroma][0], 3);
+        if (tok == 3)
+            tok = read_br_tok(&ts->msac,
+                              ts->cdf.coef.br_tok[imin(t_dim->ctx, 3)][chroma][0],
+                              3);
+        cf[0] = tok;
     }
-
-    // residual and sign
-    int dc_sign = 1;
-    const uint16_t *const dq_tbl = ts->dq[b->seg_id][plane];
-    const uint8_t *const qm_tbl = f->qm[is_1d || *txtp == IDTX][tx][plane];
-    const int dq_shift = imax(0, t_dim->ctx - 2);
+    if (dbg)
+    dav1d_log(f->c, "Post-tokens[%d]: r=%d\n", eob, ts->msac.rng);
+
+    // residual and sign; the nonzero coefficients are collected and only
+    // dequantized after, so that the multiplications stay out of this loop,
+    // which is serialized on the entropy decoder
+    int dc_sign = 1, n_nz = 0;
+    int16_t nz_rc[32 * 32];
+    int nz_tok[32 * 32]; // with the sign
     for (int i = 0; i <= eob; i++) {
         const int rc = scan[i];
         int tok = cf[rc];
         if (!tok) continue;
-        int dq;
 
         // sign
         int sign;
@@ -221,35 +325,43 @@ static int decode_coefs(Dav1dTileContext *const t,
                 ts->cdf.coef.dc_sign[chroma][dc_sign_ctx];
             sign = msac_decode_bool_adapt(&ts->msac, dc_sign_cdf);
             if (dbg)
-            printf("Post-dc_sign[%d][%d][%d]: r=%d\n",
-                   chroma, dc_sign_ctx, sign, ts->msac.rng);
+            dav1d_log(f->c, "Post-dc_sign[%d][%d][%d]: r=%d\n",
+                      chroma, dc_sign_ctx, sign, ts->msac.rng);
             dc_sign = sign ? 0 : 2;
-            dq = (dq_tbl[0] * qm_tbl[0] + 16) >> 5;
         } else {
             sign = msac_decode_bool(&ts->msac, 128 << 7);
             if (dbg)
-            printf("Post-sign[%d=%d=%d]: r=%d\n", i, rc, sign, ts->msac.rng);
-            dq = (dq_tbl[1] * qm_tbl[rc] + 16) >> 5;
+            dav1d_log(f->c, "Post-sign[%d=%d=%d]: r=%d\n", i, rc, sign, ts->msac.rng);
         }
 
         // residual
         if (tok == 15) {
             tok += read_golomb(&ts->msac);
             if (dbg)
-            printf("Post-residual[%d=%d=%d->%d]: r=%d\n",
-                   i, rc, tok - 15, tok, ts->msac.rng);
+            dav1d_log(f->c, "Post-residual[%d=%d=%d->%d]: r=%d\n",
+                      i, rc, tok - 15, tok, ts->msac.rng);
         }
 
-        // dequant
         cul_level += tok;
-        tok *= dq;
-        tok >>= dq_shift;
-        cf[rc] = sign ? -tok : tok;
+        nz_rc[n_nz] = rc;
+        nz_tok[n_nz++] = sign ? -tok : tok;
+    }
+
+    // dequant (the dc, at rc 0, has a quantizer of its own)
+    const uint16_t *const dq_tbl = ts->dq[b->seg_id][plane];
+    const uint8_t *const qm_tbl = f->qm[is_1d || *txtp == IDTX][tx][plane];
+    const int dq_shift = imax(0, t_dim->ctx - 2);
+    for (int n = 0; n < n_nz; n++) {
+        const int rc = nz_rc[n], tok = nz_tok[n];
+        const int dq = (dq_tbl[rc != 0] * qm_tbl[rc] + 16) >> 5;
+        const int v = (abs(tok) * dq) >> dq_shift;
+        cf[rc] = tok < 0 ? -v : v;
     }
 
     // context
     *res_ctx = imin(cul_level, 63) | (dc_sign << 6);
 
+    PROF_END(prof_start, DAV1D_PROF_COEFS);
     return eob;
 }
 
@@ -298,24 +410,24 @@ static void read_coef_tree(Dav1dTileContext *const t,
         coef *cf;
         struct CodedBlockInfo *cbi;
 
-        if (f->frame_thread.pass) {
-            cf = ts->frame_thread.cf;
-            ts->frame_thread.cf += imin(t_dim->w, 8) * imin(t_dim->h, 8) * 16;
+        if (t->pass) {
+            cf = t->frame_thread.cf;
+            t->frame_thread.cf += imin(t_dim->w, 8) * imin(t_dim->h, 8) * 16;
             cbi = &f->frame_thread.cbi[t->by * f->b4_stride + t->bx];
         } else {
             cf = t->cf;
         }
-        if (f->frame_thread.pass != 2) {
+        if (t->pass != 2) {
             eob = decode_coefs(t, &t->a->lcoef[bx4], &t->l.lcoef[by4],
                                ytx, bs, b, 0, 0, cf, &txtp, &cf_ctx);
             if (DEBUG_BLOCK_INFO)
-                printf("Post-y-cf-blk[tx=%d,txtp=%d,eob=%d]: r=%d\n",
-                       ytx, txtp, eob, ts->msac.rng);
+                dav1d_log(f->c, "Post-y-cf-blk[tx=%d,txtp=%d,eob=%d]: r=%d\n",
+                          ytx, txtp, eob, ts->msac.rng);
             memset(&t->a->lcoef[bx4], cf_ctx, imin(txw, f->bw - t->bx));
             memset(&t->l.lcoef[by4], cf_ctx, imin(txh, f->bh - t->by));
             for (int y = 0; y < txh; y++)
                 memset(&t->txtp_map[(by4 + y) * 32 + bx4], txtp, txw);
-            if (f->frame_thread.pass == 1) {
+            if (t->pass == 1) {
                 cbi->eob[0] = eob;
                 cbi->txtp[0] = txtp;
             }
@@ -323,11 +435,12 @@ static void read_coef_tree(Dav1dTileContext *const t,
             eob = cbi->eob[0];
             txtp = cbi->txtp[0];
         }
-        if (!(f->frame_thread.pass & 1)) {
+        if (!(t->pass & 1)) {
             assert(dst);
             if (eob >= 0) {
                 if (DEBUG_BLOCK_INFO && DEBUG_B_PIXELS)
                     coef_dump(cf, imin(t_dim->h, 8) * 4, imin(t_dim->w, 8) * 4, 3, "dq");
+                DSP_STATS_ITX(t, ytx, txtp);
                 dsp->itx.itxfm_add[ytx][txtp](dst, f->cur.p.stride[0], cf, eob);
                 if (DEBUG_BLOCK_INFO && DEBUG_B_PIXELS)
                     hex_dump(dst, f->cur.p.stride[0], t_dim->w * 4, t_dim->h * 4, "recon");
@@ -364,7 +477,7 @@ void bytefn(read_coef_blocks)(Dav1dTileContext *const t,
     Dav1dTileState *const ts = t->ts;
     const int w4 = imin(bw4, f->bw - t->bx), h4 = imin(bh4, f->bh - t->by);
     const int cw4 = (w4 + ss_hor) >> ss_hor, ch4 = (h4 + ss_ver) >> ss_ver;
-    assert(f->frame_thread.pass == 1);
+    assert(t->pass == 1);
     assert(!b->skip);
     const TxfmInfo *const uv_t_dim = &av1_txfm_dimensions[b->uvtx];
     const TxfmInfo *const t_dim = &av1_txfm_dimensions[b->intra ? b->tx : b->max_ytx];
@@ -392,12 +505,12 @@ void bytefn(read_coef_blocks)(Dav1dTileContext *const t,
                         const int eob = cbi[t->bx].eob[0] =
                             decode_coefs(t, &t->a->lcoef[bx4 + x],
                                          &t->l.lcoef[by4 + y], b->tx, bs, b, 1,
-                                         0, ts->frame_thread.cf, &txtp, &cf_ctx);
+                                         0, t->frame_thread.cf, &txtp, &cf_ctx);
                         if (DEBUG_BLOCK_INFO)
-                            printf("Post-y-cf-blk[tx=%d,txtp=%d,eob=%d]: r=%d\n",
-                                   b->tx, txtp, eob, ts->msac.rng);
+                            dav1d_log(f->c, "Post-y-cf-blk[tx=%d,txtp=%d,eob=%d]: r=%d\n",
+                                      b->tx, txtp, eob, ts->msac.rng);
                         cbi[t->bx].txtp[0] = txtp;
-                        ts->frame_thread.cf += imin(t_dim->w, 8) * imin(t_dim->h, 8) * 16;
+                        t->frame_thread.cf += imin(t_dim->w, 8) * imin(t_dim->h, 8) * 16;
                         memset(&t->a->lcoef[bx4 + x], cf_ctx,
                                imin(t_dim->w, f->bw - t->bx));
                         memset(&t->l.lcoef[by4 + y], cf_ctx,
@@ -429,14 +542,14 @@ void bytefn(read_coef_blocks)(Dav1dTileContext *const t,
                         const int eob = cbi[t->bx].eob[1 + pl] =
                             decode_coefs(t, &t->a->ccoef[pl][cbx4 + x],
                                          &t->l.ccoef[pl][cby4 + y], b->uvtx, bs,
-                                         b, b->intra, 1 + pl, ts->frame_thread.cf,
+                                         b, b->intra, 1 + pl, t->frame_thread.cf,
                                          &txtp, &cf_ctx);
                         if (DEBUG_BLOCK_INFO)
-                            printf("Post-uv-cf-blk[pl=%d,tx=%d,"
-                                   "txtp=%d,eob=%d]: r=%d\n",
-                                   pl, b->uvtx, txtp, eob, ts->msac.rng);
+                            dav1d_log(f->c, "Post-uv-cf-blk[pl=%d,tx=%d,"
+                                      "txtp=%d,eob=%d]: r=%d\n",
+                                      pl, b->uvtx, txtp, eob, ts->msac.rng);
                         cbi[t->bx].txtp[1 + pl] = txtp;
-                        ts->frame_thread.cf += uv_t_dim->w * uv_t_dim->h * 16;
+                        t->frame_thread.cf += uv_t_dim->w * uv_t_dim->h * 16;
                         memset(&t->a->ccoef[pl][cbx4 + x], cf_ctx,
                                imin(uv_t_dim->w, (f->bw - t->bx + ss_hor) >> ss_hor));
                         memset(&t->l.ccoef[pl][cby4 + y], cf_ctx,
@@ -450,55 +563,6 @@ void bytefn(read_coef_blocks)(Dav1dTileContext *const t,
     }
 }
 
-static void emu_edge(pixel *dst, const ptrdiff_t dst_stride,
-                     const pixel *ref, const ptrdiff_t ref_stride,
-                     const int bw, const int bh,
-                     const int iw, const int ih,
-                     const int x, const int y)
-{
-    // find offset in reference of visible block to copy
-    ref += iclip(y, 0, ih - 1) * PXSTRIDE(ref_stride) + iclip(x, 0, iw - 1);
-
-    // number of pixels to extend (left, right, top, bottom)
-    const int left_ext = iclip(-x, 0, bw - 1);
-    const int right_ext = iclip(x + bw - iw, 0, bw - 1);
-    assert(left_ext + right_ext < bw);
-    const int top_ext = iclip(-y, 0, bh - 1);
-    const int bottom_ext = iclip(y + bh - ih, 0, bh - 1);
-    assert(top_ext + bottom_ext < bh);
-
-    // copy visible portion first
-    pixel *blk = dst + top_ext * PXSTRIDE(dst_stride);
-    const int center_w = bw - left_ext - right_ext;
-    const int center_h = bh - top_ext - bottom_ext;
-    for (int y = 0; y < center_h; y++) {
-        pixel_copy(blk + left_ext, ref, center_w);
-        // extend left edge for this line
-        if (left_ext)
-            pixel_set(blk, blk[left_ext], left_ext);
-        // extend right edge for this line
-        if (right_ext)
-            pixel_set(blk + left_ext + center_w, blk[left_ext + center_w - 1],
-                      right_ext);
-        ref += PXSTRIDE(ref_stride);
-        blk += PXSTRIDE(dst_stride);
-    }
-
-    // copy top
-    blk = dst + top_ext * PXSTRIDE(dst_stride);
-    for (int y = 0; y < top_ext; y++) {
-        pixel_copy(dst, blk, bw);
-        dst += PXSTRIDE(dst_stride);
-    }
-
-    // copy bottom
-    dst += center_h * PXSTRIDE(dst_stride);
-    for (int y = 0; y < bottom_ext; y++) {
-        pixel_copy(dst, &dst[-PXSTRIDE(dst_stride)], bw);
-        dst += PXSTRIDE(dst_stride);
-    }
-}
-
 static void mc(Dav1dTileContext *const t,
                pixel *const dst8, coef *const dst16, const ptrdiff_t dst_stride,
                const int bw4, const int bh4,
@@ -519,16 +583,17 @@ static void mc(Dav1dTileContext *const t,
     const pixel *ref;
 
     if (refp != &f->cur) // i.e. not for intrabc
-        dav1d_thread_picture_wait(refp, dy + bh4 * v_mul + !!my * 4,
-                                  PLANE_TYPE_Y + !!pl);
+        dav1d_wait_ref(t, refp, dy + bh4 * v_mul + !!my * 4,
+                       PLANE_TYPE_Y + !!pl);
     if (dx < 3 || dx + bw4 * h_mul + 4 > ((f->cur.p.p.w + ss_hor) >> ss_hor) ||
         dy < 3 || dy + bh4 * v_mul + 4 > ((f->cur.p.p.h + ss_ver) >> ss_ver))
     {
-        emu_edge(t->emu_edge, 160 * sizeof(pixel), refp->p.data[pl], ref_stride,
-                 bw4 * h_mul + 7, bh4 * v_mul + 7,
-                 (f->cur.p.p.w + ss_hor) >> ss_hor,
-                 (f->cur.p.p.h + ss_ver) >> ss_ver,
-                 dx - 3, dy - 3);
+        f->dsp->mc.emu_edge(bw4 * h_mul + 7, bh4 * v_mul + 7,
+                            (f->cur.p.p.w + ss_hor) >> ss_hor,
+                            (f->cur.p.p.h + ss_ver) >> ss_ver,
+                            dx - 3, dy - 3,
+                            t->emu_edge, 160 * sizeof(pixel),
+                            refp->p.data[pl], ref_stride);
         ref = &t->emu_edge[160 * 3 + 3];
         ref_stride = 160 * sizeof(pixel);
     } else {
@@ -536,14 +601,138 @@ static void mc(Dav1dTileContext *const t,
     }
 
     if (dst8 != NULL) {
+        DSP_STATS_MC(t, mc, filter_2d, bw4 * h_mul, bh4 * v_mul);
         f->dsp->mc.mc[filter_2d](dst8, dst_stride, ref, ref_stride, bw4 * h_mul,
                                  bh4 * v_mul, mx << !ss_hor, my << !ss_ver);
     } else {
+        DSP_STATS_MC(t, mct, filter_2d, bw4 * h_mul, bh4 * v_mul);
         f->dsp->mc.mct[filter_2d](dst16, ref, ref_stride, bw4 * h_mul,
                                   bh4 * v_mul, mx << !ss_hor, my << !ss_ver);
     }
 }
 
+// Intra block copy vectors are full-pel in luma, and in chroma unless odd
+// in a subsampled direction, and valid streams only point to decoded pixels
+// inside the picture: such blocks are plain copies, which skip mc()'s edge
+// checks and emulation (sized for the subpel filter taps). Anything else,
+// including broken streams, takes the regular path.
+static void mc_intrabc(Dav1dTileContext *const t,
+                       pixel *const dst, const ptrdiff_t dst_stride,
+                       const int bw4, const int bh4,
+                       const int bx, const int by, const int pl, const mv mv)
+{
+    const Dav1dFrameContext *const f = t->f;
+    const int ss_ver = !!pl && f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420;
+    const int ss_hor = !!pl && f->cur.p.p.layout != DAV1D_PIXEL_LAYOUT_I444;
+    const int h_mul = 4 >> ss_hor, v_mul = 4 >> ss_ver;
+    const int w = bw4 * h_mul, h = bh4 * v_mul;
+    const int dx = bx * h_mul + (mv.x >> (3 + ss_hor));
+    const int dy = by * v_mul + (mv.y >> (3 + ss_ver));
+
+    if ((mv.x & (15 >> !ss_hor)) || (mv.y & (15 >> !ss_ver)) ||
+        dx < 0 || dx + w > ((f->cur.p.p.w + ss_hor) >> ss_hor) ||
+        dy < 0 || dy + h > ((f->cur.p.p.h + ss_ver) >> ss_ver))
+    {
+        mc(t, dst, NULL, dst_stride, bw4, bh4, bx, by, pl, mv, &f->cur,
+           FILTER_2D_BILINEAR);
+        return;
+    }
+
+    const ptrdiff_t ref_stride = f->cur.p.stride[!!pl];
+    const pixel *const ref =
+        ((pixel *) f->cur.p.data[pl]) + PXSTRIDE(ref_stride) * dy + dx;
+    DSP_STATS_MC(t, mc, FILTER_2D_BILINEAR, w, h);
+    // without a subpel offset, this is the (SIMD) copy of the put functions
+    f->dsp->mc.mc[FILTER_2D_BILINEAR](dst, dst_stride, ref, ref_stride,
+                                      w, h, 0, 0);
+}
+
+#if CONFIG_MC_PREFETCH
+// Prefetches the reference pixels that mc() reads with the same arguments
+// (within the picture; emu_edge() reads those as well), so that loading them
+// overlaps the prediction of the block's earlier planes or references. If
+// the reference has not been decoded that far, nothing is done rather than
+// waiting, since the rows would be loaded before they are written.
+static void prefetch_mc(Dav1dTileContext *const t,
+                        const int bw4, const int bh4,
+                        const int bx, const int by, const int pl,
+                        const mv mv, const Dav1dThreadPicture *const refp)
+{
+    const Dav1dFrameContext *const f = t->f;
+    const int ss_ver = !!pl && f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420;
+    const int ss_hor = !!pl && f->cur.p.p.layout != DAV1D_PIXEL_LAYOUT_I444;
+    const int h_mul = 4 >> ss_hor, v_mul = 4 >> ss_ver;
+    const int my = mv.y & (15 >> !ss_ver);
+    const int dx = bx * h_mul + (mv.x >> (3 + ss_hor));
+    const int dy = by * v_mul + (mv.y >> (3 + ss_ver));
+
+    if (!dav1d_thread_picture_progressed(refp, dy + bh4 * v_mul + !!my * 4,
+                                         PLANE_TYPE_Y + !!pl))
+    {
+        return;
+    }
+
+    const int w = (f->cur.p.p.w + ss_hor) >> ss_hor;
+    const int h = (f->cur.p.p.h + ss_ver) >> ss_ver;
+    const int x0 = iclip(dx - 3, 0, w - 1), x1 = iclip(dx + bw4 * h_mul + 4, 0, w - 1);
+    const int y0 = iclip(dy - 3, 0, h - 1), y1 = iclip(dy + bh4 * v_mul + 4, 0, h - 1);
+    const ptrdiff_t stride = refp->p.stride[!!pl];
+    const int row_sz = (x1 - x0 + 1) * sizeof(pixel);
+    const uint8_t *row = (const uint8_t *) refp->p.data[pl] +
+                         y0 * stride + x0 * sizeof(pixel);
+    for (int y = y0; y <= y1; y++, row += stride) {
+        for (int x = 0; x < row_sz; x += 64)
+            dav1d_prefetch(&row[x]);
+        dav1d_prefetch(&row[row_sz - 1]);
+    }
+}
+#endif
+
+// Predicts bw4 x bh4 (in 4px units) of neighbouring blocks' motion at (bx,
+// by) into the lap buffer, and blends it into dst, above (mstride 1, one
+// mask value per row) or left (mstride 0, one per column) of the block.
+static void obmc_lap(Dav1dTileContext *const t,
+                     pixel *const dst, const ptrdiff_t dst_stride,
+                     const int bw4, const int bh4,
+                     const int bx, const int by, const int pl,
+                     const refmvs *const n_r, const enum Filter2d filter_2d,
+                     const uint8_t *const mask, const ptrdiff_t mstride)
+{
+    const Dav1dFrameContext *const f = t->f;
+    const int ss_ver = !!pl && f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420;
+    const int ss_hor = !!pl && f->cur.p.p.layout != DAV1D_PIXEL_LAYOUT_I444;
+    const int h_mul = 4 >> ss_hor, v_mul = 4 >> ss_ver;
+    pixel *const lap = t->scratch.lap;
+    const ptrdiff_t lap_stride = (mstride ? 128 : 32) * sizeof(pixel);
+
+    mc(t, lap, NULL, lap_stride, bw4, bh4, bx, by, pl, n_r->mv[0],
+       &f->refp[n_r->ref[0] - 1], filter_2d);
+    f->dsp->mc.blend(dst, dst_stride, lap, lap_stride,
+                     h_mul * bw4, v_mul * bh4, mask, mstride);
+}
+
+// Neighbours with the same reference, motion vector and filter have one
+// continuous prediction, so runs of them along the edge are predicted and
+// blended at once, as long as the run's size stays a power of two (which
+// the SIMD mc and blend functions need). Strips of up to 4 pixels with a
+// subpel offset along the edge use the 4-tap filters, and stay on their own.
+// Sizes are in 4px units, mul pixels each.
+static inline int obmc_extends_run(const refmvs *const run_r,
+                                   const enum Filter2d run_filter,
+                                   const int run_pos, const int run_sz,
+                                   const refmvs *const n_r,
+                                   const enum Filter2d filter,
+                                   const int pos, const int sz,
+                                   const int mul, const int subpel)
+{
+    const int merged_sz = run_sz + sz;
+
+    return run_pos + run_sz == pos && !(merged_sz & (merged_sz - 1)) &&
+           (!subpel || (run_sz * mul > 4 && sz * mul > 4)) &&
+           run_filter == filter && run_r->ref[0] == n_r->ref[0] &&
+           run_r->mv[0].x == n_r->mv[0].x && run_r->mv[0].y == n_r->mv[0].y;
+}
+
 static void obmc(Dav1dTileContext *const t,
                  pixel *const dst, const ptrdiff_t dst_stride,
                  const uint8_t *const b_dim, const int pl,
@@ -552,7 +741,6 @@ static void obmc(Dav1dTileContext *const t,
     assert(!(t->bx & 1) && !(t->by & 1));
     const Dav1dFrameContext *const f = t->f;
     const refmvs *const r = &f->mvs[t->by * f->b4_stride + t->bx];
-    pixel *const lap = t->scratch.lap;
     static const uint8_t obmc_mask_2[2] = { 19,  0 };
     static const uint8_t obmc_mask_4[4] = { 25, 14,  5,  0 };
     static const uint8_t obmc_mask_8[8] = { 28, 22, 16, 11,  7,  3,  0,  0 };
@@ -572,52 +760,86 @@ static void obmc(Dav1dTileContext *const t,
     if (t->by > t->ts->tiling.row_start &&
         (!pl || b_dim[0] * h_mul + b_dim[1] * v_mul >= 16))
     {
+        const int lap_h = imin(b_dim[1], 16) >> 1;
+        const uint8_t *const mask = obmc_masks[imin(b_dim[3], 4) - ss_ver];
+        const refmvs *run_r = NULL;
+        enum Filter2d run_filter = 0;
+        int run_x = 0, run_w = 0;
+
         for (int i = 0, x = 0; x < w4 && i < imin(b_dim[2], 4); ) {
             // only odd blocks are considered for overlap handling, hence +1
             const refmvs *const a_r = &r[x - f->b4_stride + 1];
-            const uint8_t *const a_b_dim =
-                av1_block_dimensions[sbtype_to_bs[a_r->sb_type]];
+            const uint8_t *const a_b_dim = av1_block_dimensions[a_r->bs];
 
             if (a_r->ref[0] > 0) {
-                mc(t, lap, NULL, 128 * sizeof(pixel),
-                   iclip(a_b_dim[0], 2, b_dim[0]), imin(b_dim[1], 16) >> 1,
-                   t->bx + x, t->by, pl, a_r->mv[0],
-                   &f->refp[a_r->ref[0] - 1],
-                   av1_filter_2d[t->a->filter[1][bx4 + x + 1]][t->a->filter[0][bx4 + x + 1]]);
-                f->dsp->mc.blend(&dst[x * h_mul], dst_stride,
-                                 lap, 128 * sizeof(pixel),
-                                 h_mul * iclip(a_b_dim[0], 2, b_dim[0]),
-                                 v_mul * imin(b_dim[1], 16) >> 1,
-                                 obmc_masks[imin(b_dim[3], 4) - ss_ver], 1);
+                const int a_w = iclip(a_b_dim[0], 2, b_dim[0]);
+                const enum Filter2d filter =
+                    av1_filter_2d[t->a->filter[1][bx4 + x + 1]][t->a->filter[0][bx4 + x + 1]];
+
+                if (run_w && !obmc_extends_run(run_r, run_filter, run_x, run_w,
+                                               a_r, filter, x, a_w, h_mul,
+                                               a_r->mv[0].x & (15 >> !ss_hor)))
+                {
+                    obmc_lap(t, &dst[run_x * h_mul], dst_stride, run_w, lap_h,
+                             t->bx + run_x, t->by, pl, run_r, run_filter, mask, 1);
+                    run_w = 0;
+                }
+                if (!run_w) {
+                    run_r = a_r;
+                    run_filter = filter;
+                    run_x = x;
+                }
+                run_w += a_w;
                 i++;
             }
             x += imax(a_b_dim[0], 2);
         }
+        if (run_w)
+            obmc_lap(t, &dst[run_x * h_mul], dst_stride, run_w, lap_h,
+                     t->bx + run_x, t->by, pl, run_r, run_filter, mask, 1);
     }
 
-    if (t->bx > t->ts->tiling.col_start)
+    if (t->bx > t->ts->tiling.col_start) {
+        const int lap_w = imin(b_dim[0], 16) >> 1;
+        const uint8_t *const mask = obmc_masks[imin(b_dim[2], 4) - ss_hor];
+        const refmvs *run_r = NULL;
+        enum Filter2d run_filter = 0;
+        int run_y = 0, run_h = 0;
+
         for (int i = 0, y = 0; y < h4 && i < imin(b_dim[3], 4); ) {
             // only odd blocks are considered for overlap handling, hence +1
             const refmvs *const l_r = &r[(y + 1) * f->b4_stride - 1];
-            const uint8_t *const l_b_dim =
-                av1_block_dimensions[sbtype_to_bs[l_r->sb_type]];
+            const uint8_t *const l_b_dim = av1_block_dimensions[l_r->bs];
 
             if (l_r->ref[0] > 0) {
-                mc(t, lap, NULL, 32 * sizeof(pixel),
-                   imin(b_dim[0], 16) >> 1,
-                   iclip(l_b_dim[1], 2, b_dim[1]),
-                   t->bx, t->by + y, pl, l_r->mv[0],
-                   &f->refp[l_r->ref[0] - 1],
-                   av1_filter_2d[t->l.filter[1][by4 + y + 1]][t->l.filter[0][by4 + y + 1]]);
-                f->dsp->mc.blend(&dst[y * v_mul * PXSTRIDE(dst_stride)], dst_stride,
-                                 lap, 32 * sizeof(pixel),
-                                 h_mul * imin(b_dim[0], 16) >> 1,
-                                 v_mul * iclip(l_b_dim[1], 2, b_dim[1]),
-                                 obmc_masks[imin(b_dim[2], 4) - ss_hor], 0);
+                const int l_h = iclip(l_b_dim[1], 2, b_dim[1]);
+                const enum Filter2d filter =
+                    av1_filter_2d[t->l.filter[1][by4 + y + 1]][t->l.filter[0][by4 + y + 1]];
+
+                if (run_h && !obmc_extends_run(run_r, run_filter, run_y, run_h,
+                                               l_r, filter, y, l_h, v_mul,
+                                               l_r->mv[0].y & (15 >> !ss_ver)))
+                {
+                    obmc_lap(t, &dst[run_y * v_mul * PXSTRIDE(dst_stride)],
+                             dst_stride, lap_w, run_h, t->bx, t->by + run_y, pl,
+                             run_r, run_filter, mask, 0);
+                    run_h = 0;
+                }
+                if (!run_h) {
+                    run_r = l_r;
+                    run_filter = filter;
+                    run_y = y;
+                }
+                run_h += l_h;
                 i++;
             }
             y += imax(l_b_dim[1], 2);
         }
+        if (run_h)
+            obmc_lap(t, &dst[run_y * v_mul * PXSTRIDE(dst_stride)],
+                     dst_stride, lap_w, run_h, t->bx, t->by + run_y, pl,
+                     run_r, run_filter, mask, 0);
+    }
 }
 
 static void warp_affine(Dav1dTileContext *const t,
@@ -656,11 +878,12 @@ static void warp_affine(Dav1dTileContext *const t,
             const pixel *ref_ptr;
             ptrdiff_t ref_stride = refp->p.stride[!!pl];
 
-            dav1d_thread_picture_wait(refp, dy + 4 + 8,
-                                      PLANE_TYPE_Y + !!pl);
+            dav1d_wait_ref(t, refp, dy + 4 + 8,
+                           PLANE_TYPE_Y + !!pl);
             if (dx < 3 || dx + 8 + 4 > width || dy < 3 || dy + 8 + 4 > height) {
-                emu_edge(t->emu_edge, 160 * sizeof(pixel), refp->p.data[pl],
-                         ref_stride, 15, 15, width, height, dx - 3, dy - 3);
+                dsp->mc.emu_edge(15, 15, width, height, dx - 3, dy - 3,
+                                 t->emu_edge, 160 * sizeof(pixel),
+                                 refp->p.data[pl], ref_stride);
                 ref_ptr = &t->emu_edge[160 * 3 + 3];
                 ref_stride = 160 * sizeof(pixel);
             } else {
@@ -678,10 +901,32 @@ static void warp_affine(Dav1dTileContext *const t,
     }
 }
 
+// Row of f->ipred_edge[pl] with the bottom edge of sbrow sby (of the tile
+// row of ts), see backup_ipred_edge(): with ipred_edge_ring, the rows of
+// even and odd sbrows alternate, so the row read by the sbrow below is
+// overwritten by the one after it, which in wavefront reconstruction
+// trails the sbrow in between, and thus only writes the superblocks that
+// one is done with.
+static inline pixel *ipred_edge_sbrow(const Dav1dFrameContext *const f,
+                                      const Dav1dTileState *const ts,
+                                      const int pl, const int sby)
+{
+    const int row = f->ipred_edge_ring ? ts->tiling.row * 2 + (sby & 1) : sby;
+    return &f->ipred_edge[pl][f->sb128w * 128 * row];
+}
+
+// the edge above the sbrow of t
+static inline const pixel *ipred_edge_row(const Dav1dTileContext *const t,
+                                          const int pl)
+{
+    return ipred_edge_sbrow(t->f, t->ts, pl, (t->by >> t->f->sb_shift) - 1);
+}
+
 void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
                            const enum EdgeFlags intra_edge_flags,
                            const Av1Block *const b)
 {
+    PROF_START(prof_start);
     Dav1dTileState *const ts = t->ts;
     const Dav1dFrameContext *const f = t->f;
     const Dav1dDSPContext *const dsp = f->dsp;
@@ -699,6 +944,12 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
     const TxfmInfo *const t_dim = &av1_txfm_dimensions[b->tx];
     const TxfmInfo *const uv_t_dim = &av1_txfm_dimensions[b->uvtx];
 
+    if (f->c->frame_stats) {
+        ts->stats.intra++;
+        ts->stats.skip += b->skip;
+        ts->stats.palette += b->pal_sz[0] || b->pal_sz[1];
+    }
+
     // coefficient coding
     pixel edge_mem[257], *const edge = &edge_mem[128];
     const int cbw4 = (bw4 + ss_hor) >> ss_hor, cbh4 = (bh4 + ss_ver) >> ss_ver;
@@ -709,13 +960,13 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
                 pixel *dst = ((pixel *) f->cur.p.data[0]) +
                              4 * (t->by * PXSTRIDE(f->cur.p.stride[0]) + t->bx);
                 const uint8_t *pal_idx;
-                if (f->frame_thread.pass) {
-                    pal_idx = ts->frame_thread.pal_idx;
-                    ts->frame_thread.pal_idx += bw4 * bh4 * 16;
+                if (t->pass) {
+                    pal_idx = t->frame_thread.pal_idx;
+                    t->frame_thread.pal_idx += bw4 * bh4 * 16;
                 } else {
                     pal_idx = t->scratch.pal_idx;
                 }
-                const uint16_t *const pal = f->frame_thread.pass ?
+                const uint16_t *const pal = t->pass ?
                     f->frame_thread.pal[((t->by >> 1) + (t->bx & 1)) * (f->b4_stride >> 1) +
                                         ((t->bx >> 1) + (t->by & 1))][0] : t->pal[0];
                 f->dsp->ipred.pal_pred(dst, f->cur.p.stride[0], pal,
@@ -752,9 +1003,7 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
                              0 : EDGE_I444_LEFT_HAS_BOTTOM);
                     const pixel *top_sb_edge = NULL;
                     if (!(t->by & (f->sb_step - 1))) {
-                        top_sb_edge = f->ipred_edge[0];
-                        const int sby = t->by >> f->sb_shift;
-                        top_sb_edge += f->sb128w * 128 * (sby - 1);
+                        top_sb_edge = ipred_edge_row(t, 0);
                     }
                     const enum IntraPredMode m =
                         bytefn(prepare_intra_edges)(t->bx,
@@ -767,6 +1016,7 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
                                                     f->cur.p.stride[0], top_sb_edge,
                                                     b->y_mode, &angle,
                                                     t_dim->w, t_dim->h, edge);
+                    DSP_STATS_IPRED(t, b->tx, m);
                     dsp->ipred.intra_pred[b->tx][m](dst, f->cur.p.stride[0],
                                                     edge, angle | sm_fl);
 
@@ -785,9 +1035,9 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
                         coef *cf;
                         int eob;
                         enum TxfmType txtp;
-                        if (f->frame_thread.pass) {
-                            cf = ts->frame_thread.cf;
-                            ts->frame_thread.cf += imin(t_dim->w, 8) * imin(t_dim->h, 8) * 16;
+                        if (t->pass) {
+                            cf = t->frame_thread.cf;
+                            t->frame_thread.cf += imin(t_dim->w, 8) * imin(t_dim->h, 8) * 16;
                             const struct CodedBlockInfo *const cbi =
                                 &f->frame_thread.cbi[t->by * f->b4_stride + t->bx];
                             eob = cbi->eob[0];
@@ -799,8 +1049,8 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
                                                &t->l.lcoef[by4 + y], b->tx, bs,
                                                b, 1, 0, cf, &txtp, &cf_ctx);
                             if (DEBUG_BLOCK_INFO)
-                                printf("Post-y-cf-blk[tx=%d,txtp=%d,eob=%d]: r=%d\n",
-                                       b->tx, txtp, eob, ts->msac.rng);
+                                dav1d_log(f->c, "Post-y-cf-blk[tx=%d,txtp=%d,eob=%d]: r=%d\n",
+                                          b->tx, txtp, eob, ts->msac.rng);
                             memset(&t->a->lcoef[bx4 + x], cf_ctx,
                                    imin(t_dim->w, f->bw - t->bx));
                             memset(&t->l.lcoef[by4 + y], cf_ctx,
@@ -810,6 +1060,7 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
                             if (DEBUG_BLOCK_INFO && DEBUG_B_PIXELS)
                                 coef_dump(cf, imin(t_dim->h, 8) * 4,
                                           imin(t_dim->w, 8) * 4, 3, "dq");
+                            DSP_STATS_ITX(t, b->tx, txtp);
                             dsp->itx.itxfm_add[b->tx]
                                               [txtp](dst,
                                                      f->cur.p.stride[0],
@@ -818,7 +1069,7 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
                                 hex_dump(dst, f->cur.p.stride[0],
                                          t_dim->w * 4, t_dim->h * 4, "recon");
                         }
-                    } else if (!f->frame_thread.pass) {
+                    } else if (!t->pass) {
                         memset(&t->a->lcoef[bx4 + x], 0x40, t_dim->w);
                         memset(&t->l.lcoef[by4 + y], 0x40, t_dim->h);
                     }
@@ -852,9 +1103,7 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
                     int angle = 0;
                     const pixel *top_sb_edge = NULL;
                     if (!((t->by & ~ss_ver) & (f->sb_step - 1))) {
-                        top_sb_edge = f->ipred_edge[pl + 1];
-                        const int sby = t->by >> f->sb_shift;
-                        top_sb_edge += f->sb128w * 128 * (sby - 1);
+                        top_sb_edge = ipred_edge_row(t, pl + 1);
                     }
                     const enum IntraPredMode m =
                         bytefn(prepare_intra_edges)(t->bx >> ss_hor,
@@ -869,6 +1118,7 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
                                                     top_sb_edge, DC_PRED, &angle,
                                                     cfl_uv_t_dim->w,
                                                     cfl_uv_t_dim->h, edge);
+                    DSP_STATS_IPRED(t, cfl_uvtx, m);
                     dsp->ipred.intra_pred[cfl_uvtx][m](uv_dst[pl], stride, edge, 0);
                 }
                 const int furthest_r =
@@ -900,19 +1150,19 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
                 ptrdiff_t uv_dstoff = 4 * ((t->bx >> ss_hor) +
                                            (t->by >> ss_ver) * PXSTRIDE(f->cur.p.stride[1]));
                 const uint8_t *pal_idx;
-                if (f->frame_thread.pass) {
-                    pal_idx = ts->frame_thread.pal_idx;
-                    ts->frame_thread.pal_idx += cbw4 * cbh4 * 16;
+                if (t->pass) {
+                    pal_idx = t->frame_thread.pal_idx;
+                    t->frame_thread.pal_idx += cbw4 * cbh4 * 16;
                 } else {
                     pal_idx = &t->scratch.pal_idx[bw4 * bh4 * 16];
                 }
-                const uint16_t *const pal_u = f->frame_thread.pass ?
+                const uint16_t *const pal_u = t->pass ?
                     f->frame_thread.pal[((t->by >> 1) + (t->bx & 1)) * (f->b4_stride >> 1) +
                                         ((t->bx >> 1) + (t->by & 1))][1] : t->pal[1];
                 f->dsp->ipred.pal_pred(((pixel *) f->cur.p.data[1]) + uv_dstoff,
                                        f->cur.p.stride[1], pal_u,
                                        pal_idx, cbw4 * 4, cbh4 * 4);
-                const uint16_t *const pal_v = f->frame_thread.pass ?
+                const uint16_t *const pal_v = t->pass ?
                     f->frame_thread.pal[((t->by >> 1) + (t->bx & 1)) * (f->b4_stride >> 1) +
                                         ((t->bx >> 1) + (t->by & 1))][2] : t->pal[2];
                 f->dsp->ipred.pal_pred(((pixel *) f->cur.p.data[2]) + uv_dstoff,
@@ -964,9 +1214,7 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
                                  0 : EDGE_I444_LEFT_HAS_BOTTOM);
                         const pixel *top_sb_edge = NULL;
                         if (!((t->by & ~ss_ver) & (f->sb_step - 1))) {
-                            top_sb_edge = f->ipred_edge[1 + pl];
-                            const int sby = t->by >> f->sb_shift;
-                            top_sb_edge += f->sb128w * 128 * (sby - 1);
+                            top_sb_edge = ipred_edge_row(t, 1 + pl);
                         }
                         const enum IntraPredMode m =
                             bytefn(prepare_intra_edges)(t->bx >> ss_hor,
@@ -981,6 +1229,7 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
                                                         top_sb_edge, b->uv_mode,
                                                         &angle, uv_t_dim->w,
                                                         uv_t_dim->h, edge);
+                        DSP_STATS_IPRED(t, b->uvtx, m);
                         dsp->ipred.intra_pred[b->uvtx][m](dst, stride,
                                                           edge, angle | sm_uv_fl);
                         if (DEBUG_BLOCK_INFO && DEBUG_B_PIXELS) {
@@ -998,9 +1247,9 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
                             enum TxfmType txtp;
                             int eob;
                             coef *cf;
-                            if (f->frame_thread.pass) {
-                                cf = ts->frame_thread.cf;
-                                ts->frame_thread.cf += uv_t_dim->w * uv_t_dim->h * 16;
+                            if (t->pass) {
+                                cf = t->frame_thread.cf;
+                                t->frame_thread.cf += uv_t_dim->w * uv_t_dim->h * 16;
                                 const struct CodedBlockInfo *const cbi =
                                     &f->frame_thread.cbi[t->by * f->b4_stride + t->bx];
                                 eob = cbi->eob[pl + 1];
@@ -1013,9 +1262,9 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
                                                    b->uvtx, bs, b, 1, 1 + pl, cf,
                                                    &txtp, &cf_ctx);
                                 if (DEBUG_BLOCK_INFO)
-                                    printf("Post-uv-cf-blk[pl=%d,tx=%d,"
-                                           "txtp=%d,eob=%d]: r=%d [x=%d,cbx4=%d]\n",
-                                           pl, b->uvtx, txtp, eob, ts->msac.rng, x, cbx4);
+                                    dav1d_log(f->c, "Post-uv-cf-blk[pl=%d,tx=%d,"
+                                              "txtp=%d,eob=%d]: r=%d [x=%d,cbx4=%d]\n",
+                                              pl, b->uvtx, txtp, eob, ts->msac.rng, x, cbx4);
                                 memset(&t->a->ccoef[pl][cbx4 + x], cf_ctx,
                                        imin(uv_t_dim->w, (f->bw - t->bx + ss_hor) >> ss_hor));
                                 memset(&t->l.ccoef[pl][cby4 + y], cf_ctx,
@@ -1025,6 +1274,7 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
                                 if (DEBUG_BLOCK_INFO && DEBUG_B_PIXELS)
                                     coef_dump(cf, uv_t_dim->h * 4,
                                               uv_t_dim->w * 4, 3, "dq");
+                                DSP_STATS_ITX(t, b->uvtx, txtp);
                                 dsp->itx.itxfm_add[b->uvtx]
                                                   [txtp](dst, stride,
                                                          cf, eob);
@@ -1032,7 +1282,7 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
                                     hex_dump(dst, stride, uv_t_dim->w * 4,
                                              uv_t_dim->h * 4, "recon");
                             }
-                        } else if (!f->frame_thread.pass) {
+                        } else if (!t->pass) {
                             memset(&t->a->ccoef[pl][cbx4 + x], 0x40, uv_t_dim->w);
                             memset(&t->l.ccoef[pl][cby4 + y], 0x40, uv_t_dim->h);
                         }
@@ -1044,11 +1294,13 @@ void bytefn(recon_b_intra)(Dav1dTileContext *const t, const enum BlockSize bs,
             }
         }
     }
+    PROF_END(prof_start, DAV1D_PROF_RECON_INTRA);
 }
 
 void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
                            const Av1Block *const b)
 {
+    PROF_START(prof_start);
     Dav1dTileState *const ts = t->ts;
     const Dav1dFrameContext *const f = t->f;
     const Dav1dDSPContext *const dsp = f->dsp;
@@ -1066,6 +1318,7 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
                                DAV1D_PIXEL_LAYOUT_I444 - f->cur.p.p.layout;
 
     // prediction
+    int warped = 0;
     const int cbh4 = (bh4 + ss_ver) >> ss_ver, cbw4 = (bw4 + ss_hor) >> ss_hor;
     pixel *dst = ((pixel *) f->cur.p.data[0]) +
         4 * (t->by * PXSTRIDE(f->cur.p.stride[0]) + t->bx);
@@ -1073,13 +1326,13 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
         4 * ((t->bx >> ss_hor) + (t->by >> ss_ver) * PXSTRIDE(f->cur.p.stride[1]));
     if (!(f->frame_hdr.frame_type & 1)) {
         // intrabc
-        mc(t, dst, NULL, f->cur.p.stride[0],
-           bw4, bh4, t->bx, t->by, 0, b->mv[0], &f->cur, FILTER_2D_BILINEAR);
+        mc_intrabc(t, dst, f->cur.p.stride[0],
+                   bw4, bh4, t->bx, t->by, 0, b->mv[0]);
         if (has_chroma) for (int pl = 1; pl < 3; pl++)
-            mc(t, ((pixel *) f->cur.p.data[pl]) + uvdstoff, NULL, f->cur.p.stride[1],
-               bw4 << (bw4 == ss_hor), bh4 << (bh4 == ss_ver),
-               t->bx & ~ss_hor, t->by & ~ss_ver,
-               pl, b->mv[0], &f->cur, FILTER_2D_BILINEAR);
+            mc_intrabc(t, ((pixel *) f->cur.p.data[pl]) + uvdstoff,
+                       f->cur.p.stride[1],
+                       bw4 << (bw4 == ss_hor), bh4 << (bh4 == ss_ver),
+                       t->bx & ~ss_hor, t->by & ~ss_ver, pl, b->mv[0]);
     } else if (b->comp_type == COMP_INTER_NONE) {
         const Dav1dThreadPicture *const refp = &f->refp[b->ref[0]];
         const enum Filter2d filter_2d = b->filter2d;
@@ -1093,7 +1346,14 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
             warp_affine(t, dst, NULL, f->cur.p.stride[0], b_dim, 0, refp,
                         b->motion_mode == MM_WARP ? &t->warpmv :
                             &f->frame_hdr.gmv[b->ref[0]]);
+            warped = 1;
         } else {
+#if CONFIG_MC_PREFETCH
+            // (chroma is never warped if luma isn't)
+            if (has_chroma && bw4 > ss_hor && bh4 > ss_ver)
+                for (int pl = 1; pl < 3; pl++)
+                    prefetch_mc(t, bw4, bh4, t->bx, t->by, pl, b->mv[0], refp);
+#endif
             mc(t, dst, NULL, f->cur.p.stride[0],
                bw4, bh4, t->bx, t->by, 0, b->mv[0], refp, filter_2d);
             if (b->motion_mode == MM_OBMC)
@@ -1108,15 +1368,14 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
             int angle = 0;
             const pixel *top_sb_edge = NULL;
             if (!(t->by & (f->sb_step - 1))) {
-                top_sb_edge = f->ipred_edge[0];
-                const int sby = t->by >> f->sb_shift;
-                top_sb_edge += f->sb128w * 128 * (sby - 1);
+                top_sb_edge = ipred_edge_row(t, 0);
             }
             m = bytefn(prepare_intra_edges)(t->bx, t->bx > ts->tiling.col_start,
                                             t->by, t->by > ts->tiling.row_start,
                                             ts->tiling.col_end, ts->tiling.row_end,
                                             0, dst, f->cur.p.stride[0], top_sb_edge,
                                             m, &angle, bw4, bh4, tl_edge);
+            DSP_STATS_IPRED(t, ii_tx, m);
             dsp->ipred.intra_pred[ii_tx][m](tmp, 4 * bw4 * sizeof(pixel), tl_edge, 0);
             const uint8_t *const ii_mask =
                 b->interintra_type == INTER_INTRA_BLEND ?
@@ -1143,6 +1402,9 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
         // chroma prediction
         if (is_sub8x8) {
             assert(ss_hor == 1);
+            // with frame threading, pass 2 finds the neighbours' filters in
+            // the blocks coded just before this one within its 8x8 area:
+            // top-left, top and left for 4x4, else only the left or top one
             int h_off = 0, v_off = 0;
             if (bw4 == 1 && bh4 == ss_ver) {
                 for (int pl = 0; pl < 2; pl++)
@@ -1151,8 +1413,7 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
                        bw4, bh4, t->bx - 1, t->by - 1, 1 + pl,
                        r[-(f->b4_stride + 1)].mv[0],
                        &f->refp[r[-(f->b4_stride + 1)].ref[0] - 1],
-                       f->frame_thread.pass != 2 ? t->tl_4x4_filter :
-                           f->frame_thread.b[((t->by - 1) * f->b4_stride) + t->bx - 1].filter2d);
+                       t->pass != 2 ? t->tl_4x4_filter : b[-3].filter2d);
                 v_off = 2 * PXSTRIDE(f->cur.p.stride[1]);
                 h_off = 2;
             }
@@ -1163,8 +1424,7 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
                     mc(t, ((pixel *) f->cur.p.data[1 + pl]) + uvdstoff + v_off, NULL,
                        f->cur.p.stride[1], bw4, bh4, t->bx - 1,
                        t->by, 1 + pl, r[-1].mv[0], &f->refp[r[-1].ref[0] - 1],
-                       f->frame_thread.pass != 2 ? left_filter_2d :
-                           f->frame_thread.b[(t->by * f->b4_stride) + t->bx - 1].filter2d);
+                       t->pass != 2 ? left_filter_2d : b[-1].filter2d);
                 h_off = 2;
             }
             if (bh4 == ss_ver) {
@@ -1175,8 +1435,8 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
                        f->cur.p.stride[1], bw4, bh4, t->bx, t->by - 1,
                        1 + pl, r[-f->b4_stride].mv[0],
                        &f->refp[r[-f->b4_stride].ref[0] - 1],
-                       f->frame_thread.pass != 2 ? top_filter_2d :
-                           f->frame_thread.b[((t->by - 1) * f->b4_stride) + t->bx].filter2d);
+                       t->pass != 2 ? top_filter_2d :
+                           b[-1 - (bw4 == 1)].filter2d);
                 v_off = 2 * PXSTRIDE(f->cur.p.stride[1]);
             }
             for (int pl = 0; pl < 2; pl++)
@@ -1227,9 +1487,7 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
                     pixel *const uvdst = ((pixel *) f->cur.p.data[1 + pl]) + uvdstoff;
                     const pixel *top_sb_edge = NULL;
                     if (!(t->by & (f->sb_step - 1))) {
-                        top_sb_edge = f->ipred_edge[pl + 1];
-                        const int sby = t->by >> f->sb_shift;
-                        top_sb_edge += f->sb128w * 128 * (sby - 1);
+                        top_sb_edge = ipred_edge_row(t, pl + 1);
                     }
                     m = bytefn(prepare_intra_edges)(t->bx >> ss_hor,
                                                     (t->bx >> ss_hor) >
@@ -1242,6 +1500,7 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
                                                     0, uvdst, f->cur.p.stride[1],
                                                     top_sb_edge, m,
                                                     &angle, cbw4, cbh4, tl_edge);
+                    DSP_STATS_IPRED(t, ii_tx, m);
                     dsp->ipred.intra_pred[ii_tx][m](tmp, cbw4 * 4 * sizeof(pixel), tl_edge, 0);
                     dsp->mc.blend(uvdst, f->cur.p.stride[1], tmp, cbw4 * 4 * sizeof(pixel),
                                   cbw4 * 4, cbh4 * 4, ii_mask, cbw4 * 4);
@@ -1254,11 +1513,27 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
     } else {
         const enum Filter2d filter_2d = b->filter2d;
         // Maximum super block size is 128x128
-        coef (*tmp)[128 * 128] = (coef (*)[128 * 128]) t->scratch.compinter;
+        coef *const tmp[2] = {
+            t->scratch.compinter, &t->scratch.compinter[bw4 * bh4 * 16]
+        };
         int jnt_weight;
         uint8_t *const seg_mask = t->scratch_seg_mask;
         const uint8_t *mask;
 
+#if CONFIG_MC_PREFETCH
+        for (int i = 0; i < 2; i++) {
+            if (b->inter_mode == GLOBALMV_GLOBALMV &&
+                f->frame_hdr.gmv[b->ref[i]].type > WM_TYPE_TRANSLATION)
+            {
+                continue;
+            }
+            const Dav1dThreadPicture *const refp = &f->refp[b->ref[i]];
+            if (i)
+                prefetch_mc(t, bw4, bh4, t->bx, t->by, 0, b->mv[i], refp);
+            if (has_chroma) for (int pl = 1; pl < 3; pl++)
+                prefetch_mc(t, bw4, bh4, t->bx, t->by, pl, b->mv[i], refp);
+        }
+#endif
         for (int i = 0; i < 2; i++) {
             const Dav1dThreadPicture *const refp = &f->refp[b->ref[i]];
 
@@ -1267,6 +1542,7 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
             {
                 warp_affine(t, NULL, tmp[i], bw4 * 4, b_dim, 0, refp,
                             &f->frame_hdr.gmv[b->ref[i]]);
+                warped = 1;
             } else {
                 mc(t, NULL, tmp[i], 0, bw4, bh4, t->bx, t->by, 0,
                    b->mv[i], refp, filter_2d);
@@ -1343,6 +1619,12 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
         }
     }
 
+    if (f->c->frame_stats) {
+        ts->stats.inter++;
+        ts->stats.skip += b->skip;
+        ts->stats.warped += warped;
+    }
+
     const int cw4 = (w4 + ss_hor) >> ss_hor, ch4 = (h4 + ss_ver) >> ss_ver;
 
     if (b->skip) {
@@ -1355,6 +1637,7 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
             memset(&t->a->ccoef[1][cbx4], 0x40, cw4);
             memset(&t->l.ccoef[1][cby4], 0x40, ch4);
         }
+        PROF_END(prof_start, DAV1D_PROF_RECON_INTER);
         return;
     }
 
@@ -1398,9 +1681,9 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
                         coef *cf;
                         int eob;
                         enum TxfmType txtp;
-                        if (f->frame_thread.pass) {
-                            cf = ts->frame_thread.cf;
-                            ts->frame_thread.cf += uvtx->w * uvtx->h * 16;
+                        if (t->pass) {
+                            cf = t->frame_thread.cf;
+                            t->frame_thread.cf += uvtx->w * uvtx->h * 16;
                             const struct CodedBlockInfo *const cbi =
                                 &f->frame_thread.cbi[t->by * f->b4_stride + t->bx];
                             eob = cbi->eob[1 + pl];
@@ -1415,9 +1698,9 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
                                                b->uvtx, bs, b, 0, 1 + pl,
                                                cf, &txtp, &cf_ctx);
                             if (DEBUG_BLOCK_INFO)
-                                printf("Post-uv-cf-blk[pl=%d,tx=%d,"
-                                       "txtp=%d,eob=%d]: r=%d\n",
-                                       pl, b->uvtx, txtp, eob, ts->msac.rng);
+                                dav1d_log(f->c, "Post-uv-cf-blk[pl=%d,tx=%d,"
+                                          "txtp=%d,eob=%d]: r=%d\n",
+                                          pl, b->uvtx, txtp, eob, ts->msac.rng);
                             memset(&t->a->ccoef[pl][cbx4 + x], cf_ctx,
                                    imin(uvtx->w, (f->bw - t->bx + ss_hor) >> ss_hor));
                             memset(&t->l.ccoef[pl][cby4 + y], cf_ctx,
@@ -1426,6 +1709,7 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
                         if (eob >= 0) {
                             if (DEBUG_BLOCK_INFO && DEBUG_B_PIXELS)
                                 coef_dump(cf, uvtx->h * 4, uvtx->w * 4, 3, "dq");
+                            DSP_STATS_ITX(t, b->uvtx, txtp);
                             dsp->itx.itxfm_add[b->uvtx]
                                               [txtp](&uvdst[4 * x],
                                                      f->cur.p.stride[1],
@@ -1444,11 +1728,37 @@ void bytefn(recon_b_inter)(Dav1dTileContext *const t, const enum BlockSize bs,
             }
         }
     }
+    PROF_END(prof_start, DAV1D_PROF_RECON_INTER);
 }
 
-void bytefn(filter_sbrow)(Dav1dFrameContext *const f, const int sby) {
+static void sbrow_ptrs(const Dav1dFrameContext *const f, const int sby,
+                       pixel *p[3])
+{
     const int ss_ver = f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420;
-    const int sbsz = f->sb_step, sbh = f->sbh;
+    const int y = sby * f->sb_step * 4;
+
+    p[0] = (pixel *) f->cur.p.data[0] + y * PXSTRIDE(f->cur.p.stride[0]);
+    p[1] = (pixel *) f->cur.p.data[1] + (y * PXSTRIDE(f->cur.p.stride[1]) >> ss_ver);
+    p[2] = (pixel *) f->cur.p.data[2] + (y * PXSTRIDE(f->cur.p.stride[1]) >> ss_ver);
+}
+
+static inline Av1Filter *sbrow_mask(const Dav1dFrameContext *const f,
+                                    const int sby)
+{
+    return &f->lf.mask[(sby >> !f->seq_hdr.sb128) * f->sb128w];
+}
+
+// The post-filter stages of one sbrow can run concurrently with other
+// stages of other sbrows, as long as each stage runs in sbrow order, and
+// stage n of a sbrow runs after stage n - 1 of the same sbrow; the deblock
+// stage of sbrow sby must also wait for LR of sbrow sby - 2, which uses the
+// same loop filtered pixel backup buffer. The CDEF stage finishes the last
+// 8 pixel rows of the previous sbrow, and LR lags behind by the same amount.
+void bytefn(filter_sbrow_deblock)(Dav1dFrameContext *const f, const int sby) {
+    if (f->filters == DAV1D_NONREFFILTERS_NONE) return;
+
+    pixel *p[3];
+    sbrow_ptrs(f, sby, p);
 
     if (f->frame_hdr.loopfilter.level_y[0] ||
         f->frame_hdr.loopfilter.level_y[1])
@@ -1456,53 +1766,75 @@ void bytefn(filter_sbrow)(Dav1dFrameContext *const f, const int sby) {
         int start_of_tile_row = 0;
         if (f->frame_hdr.tiling.row_start_sb[f->lf.tile_row] == sby)
             start_of_tile_row = f->lf.tile_row++;
-        bytefn(dav1d_loopfilter_sbrow)(f, f->lf.p, f->lf.mask_ptr, sby,
+        bytefn(dav1d_loopfilter_sbrow)(f, p, sbrow_mask(f, sby), sby,
                                        start_of_tile_row);
     }
 
-    if (f->seq_hdr.restoration) {
+    if (f->seq_hdr.restoration && f->filters == DAV1D_NONREFFILTERS_ALL &&
+        !f->post_filter.active)
+    {
         // Store loop filtered pixels required by loop restoration
-        bytefn(dav1d_lr_copy_lpf)(f, f->lf.p, sby);
+        bytefn(dav1d_lr_copy_lpf)(f, p, sby);
     }
-    if (f->seq_hdr.cdef) {
-        if (sby) {
-            pixel *p_up[3] = {
-                f->lf.p[0] - 8 * PXSTRIDE(f->cur.p.stride[0]),
-                f->lf.p[1] - (8 * PXSTRIDE(f->cur.p.stride[1]) >> ss_ver),
-                f->lf.p[2] - (8 * PXSTRIDE(f->cur.p.stride[1]) >> ss_ver),
-            };
-            bytefn(dav1d_cdef_brow)(f, p_up, f->lf.prev_mask_ptr,
-                                    sby * sbsz - 2, sby * sbsz);
-        }
-        const int n_blks = sbsz - 2 * (sby + 1 < sbh);
-        bytefn(dav1d_cdef_brow)(f, f->lf.p, f->lf.mask_ptr, sby * sbsz,
-                                imin(sby * sbsz + n_blks, f->bh));
+}
+
+void bytefn(filter_sbrow_cdef)(Dav1dFrameContext *const f, const int sby) {
+    const int ss_ver = f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420;
+    const int sbsz = f->sb_step, sbh = f->sbh;
+
+    if (!f->seq_hdr.cdef || f->filters != DAV1D_NONREFFILTERS_ALL ||
+        f->post_filter.active)
+    {
+        return;
     }
-    if (f->seq_hdr.restoration) {
-        bytefn(dav1d_lr_sbrow)(f, f->lf.p, sby);
+
+    pixel *p[3];
+    sbrow_ptrs(f, sby, p);
+    if (sby) {
+        pixel *p_up[3] = {
+            p[0] - 8 * PXSTRIDE(f->cur.p.stride[0]),
+            p[1] - (8 * PXSTRIDE(f->cur.p.stride[1]) >> ss_ver),
+            p[2] - (8 * PXSTRIDE(f->cur.p.stride[1]) >> ss_ver),
+        };
+        bytefn(dav1d_cdef_brow)(f, p_up, sbrow_mask(f, sby - 1),
+                                sby * sbsz - 2, sby * sbsz);
     }
+    const int n_blks = sbsz - 2 * (sby + 1 < sbh);
+    bytefn(dav1d_cdef_brow)(f, p, sbrow_mask(f, sby), sby * sbsz,
+                            imin(sby * sbsz + n_blks, f->bh));
+}
 
-    f->lf.p[0] += sbsz * 4 * PXSTRIDE(f->cur.p.stride[0]);
-    f->lf.p[1] += sbsz * 4 * PXSTRIDE(f->cur.p.stride[1]) >> ss_ver;
-    f->lf.p[2] += sbsz * 4 * PXSTRIDE(f->cur.p.stride[1]) >> ss_ver;
-    f->lf.prev_mask_ptr = f->lf.mask_ptr;
-    if ((sby & 1) || f->seq_hdr.sb128) {
-        f->lf.mask_ptr += f->sb128w;
+void bytefn(filter_sbrow_lr)(Dav1dFrameContext *const f, const int sby) {
+    // the last stage, in sbrow order, takes the place of both
+    if (f->post_filter.active) {
+        dav1d_post_filter_sbrow(f, sby);
+        return;
     }
+    if (!f->seq_hdr.restoration || f->filters != DAV1D_NONREFFILTERS_ALL)
+        return;
+
+    pixel *p[3];
+    sbrow_ptrs(f, sby, p);
+    bytefn(dav1d_lr_sbrow)(f, p, sby);
+}
+
+void bytefn(filter_sbrow)(Dav1dFrameContext *const f, const int sby) {
+    bytefn(filter_sbrow_deblock)(f, sby);
+    bytefn(filter_sbrow_cdef)(f, sby);
+    bytefn(filter_sbrow_lr)(f, sby);
 }
 
 void bytefn(backup_ipred_edge)(Dav1dTileContext *const t) {
     const Dav1dFrameContext *const f = t->f;
     Dav1dTileState *const ts = t->ts;
     const int sby = t->by >> f->sb_shift;
-    const int sby_off = f->sb128w * 128 * sby;
-    const int x_off = ts->tiling.col_start;
+    const int x_off = t->bx;
+    const int w4 = imin(f->sb_step, ts->tiling.col_end - x_off);
 
     const pixel *const y =
         ((const pixel *) f->cur.p.data[0]) + x_off * 4 +
                     ((t->by + f->sb_step) * 4 - 1) * PXSTRIDE(f->cur.p.stride[0]);
-    pixel_copy(&f->ipred_edge[0][sby_off + x_off * 4], y,
-               4 * (ts->tiling.col_end - x_off));
+    pixel_copy(&ipred_edge_sbrow(f, ts, 0, sby)[x_off * 4], y, 4 * w4);
 
     if (f->cur.p.p.layout != DAV1D_PIXEL_LAYOUT_I400) {
         const int ss_ver = f->cur.p.p.layout == DAV1D_PIXEL_LAYOUT_I420;
@@ -1511,8 +1843,8 @@ void bytefn(backup_ipred_edge)(Dav1dTileContext *const t) {
         const ptrdiff_t uv_off = (x_off * 4 >> ss_hor) +
             (((t->by + f->sb_step) * 4 >> ss_ver) - 1) * PXSTRIDE(f->cur.p.stride[1]);
         for (int pl = 1; pl <= 2; pl++)
-            pixel_copy(&f->ipred_edge[pl][sby_off + (x_off * 4 >> ss_hor)],
+            pixel_copy(&ipred_edge_sbrow(f, ts, pl, sby)[x_off * 4 >> ss_hor],
                        &((const pixel *) f->cur.p.data[pl])[uv_off],
-                       4 * (ts->tiling.col_end - x_off) >> ss_hor);
+                       4 * w4 >> ss_hor);
     }
 }
@@ -30,10 +30,8 @@
 
 #include "src/internal.h"
 #include "src/levels.h"
+#include "src/log.h"
 
-#define DEBUG_BLOCK_INFO 0 && \
-        f->frame_hdr.frame_offset == 2 && t->by >= 0 && t->by < 4 && \
-        t->bx >= 8 && t->bx < 12
 #define DEBUG_B_PIXELS 0
 
 #define decl_recon_b_intra_fn(name) \
@@ -65,6 +63,12 @@ decl_recon_b_inter_fn(recon_b_inter_16bpc);
 
 decl_filter_sbrow_fn(filter_sbrow_8bpc);
 decl_filter_sbrow_fn(filter_sbrow_16bpc);
+decl_filter_sbrow_fn(filter_sbrow_deblock_8bpc);
+decl_filter_sbrow_fn(filter_sbrow_deblock_16bpc);
+decl_filter_sbrow_fn(filter_sbrow_cdef_8bpc);
+decl_filter_sbrow_fn(filter_sbrow_cdef_16bpc);
+decl_filter_sbrow_fn(filter_sbrow_lr_8bpc);
+decl_filter_sbrow_fn(filter_sbrow_lr_16bpc);
 
 decl_backup_ipred_edge_fn(backup_ipred_edge_8bpc);
 decl_backup_ipred_edge_fn(backup_ipred_edge_16bpc);
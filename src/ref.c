@@ -27,32 +27,63 @@
 
 #include "config.h"
 
+#ifdef HAVE_MADV_HUGEPAGE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#ifdef HAVE_MADV_HUGEPAGE
+#include <sys/mman.h>
+#endif
+
 #include "common/mem.h"
 
 #include "src/ref.h"
+#include "src/thread.h"
+
+// reference headers are stored after the data, at this alignment
+#define HDR_ALIGN(sz) (((sz) + 31) & ~(size_t) 31)
+
+void *dav1d_alloc_aligned_hugepage(const size_t sz, const size_t align) {
+#ifdef HAVE_MADV_HUGEPAGE
+    const size_t hugepage_sz = 2 << 20;
+    if (sz >= hugepage_sz) {
+        void *const ptr = dav1d_alloc_aligned(sz, hugepage_sz);
+        // advisory only; the memory is usable either way
+        if (ptr) madvise(ptr, sz, MADV_HUGEPAGE);
+        return ptr;
+    }
+#endif
+    return dav1d_alloc_aligned(sz, align);
+}
 
 static void default_free_callback(uint8_t *const data, void *const user_data) {
     dav1d_free_aligned(data);
 }
 
 Dav1dRef *dav1d_ref_create(const size_t size) {
-    Dav1dRef *res = malloc(sizeof(Dav1dRef));
-    void *data = dav1d_alloc_aligned(size, 32);
-
-    if (!res || !data) {
-        if (res) free(res);
-        if (data) free(data);
-        return NULL;
-    }
+    // one allocation for both the data and its reference
+    uint8_t *const data = dav1d_alloc_aligned(HDR_ALIGN(size) + sizeof(Dav1dRef), 32);
+    if (!data) return NULL;
 
-    res->size = size;
-    atomic_init(&res->ref_cnt, 1);
-    res->data = data;
-    res->free_callback = default_free_callback;
+    Dav1dRef *const res = (Dav1dRef *) &data[HDR_ALIGN(size)];
+    dav1d_ref_init(res, data, size, default_free_callback, NULL);
 
     return res;
 }
 
+void dav1d_ref_init(Dav1dRef *const ref, void *const data, const size_t sz,
+                    void (*free_callback)(uint8_t *data, void *user_data),
+                    void *const user_data)
+{
+    ref->data = data;
+    ref->size = sz;
+    atomic_init(&ref->ref_cnt, 1);
+    ref->free_ref = 0;
+    ref->free_callback = free_callback;
+    ref->user_data = user_data;
+}
+
 Dav1dRef *dav1d_ref_wrap(uint8_t *const ptr, const size_t sz,
                          void (*free_callback)(uint8_t *data, void *user_data),
                          void *user_data)
@@ -60,11 +91,8 @@ Dav1dRef *dav1d_ref_wrap(uint8_t *const ptr, const size_t sz,
     Dav1dRef *res = malloc(sizeof(Dav1dRef));
     if (!res) return NULL;
 
-    res->data = ptr;
-    res->size = sz;
-    atomic_init(&res->ref_cnt, 1);
-    res->free_callback = free_callback;
-    res->user_data = user_data;
+    dav1d_ref_init(res, ptr, sz, free_callback, user_data);
+    res->free_ref = 1;
 
     return res;
 }
@@ -75,7 +103,159 @@ void dav1d_ref_inc(Dav1dRef *const ref) {
 
 void dav1d_ref_dec(Dav1dRef *const ref) {
     if (atomic_fetch_sub(&ref->ref_cnt, 1) == 1) {
+        // the callback may free the memory holding the reference
+        const int free_ref = ref->free_ref;
         ref->free_callback(ref->data, ref->user_data);
-        free(ref);
+        if (free_ref) free(ref);
+    }
+}
+
+// Stored after each pooled buffer's data.
+typedef struct PoolBuffer {
+    Dav1dRef ref;
+    struct PoolBuffer *next;
+    Dav1dMemPool *pool;
+    size_t size;
+} PoolBuffer;
+
+struct Dav1dMemPool {
+    pthread_mutex_t lock;
+    PoolBuffer *free_list;
+    int n_free, max_free;
+    int hugepages;
+    size_t bytes, peak_bytes; // allocated by the pool, in use or free
+    // one for the owner, plus one for each buffer in use, so that buffers
+    // can be released (e.g. by the application) after the pool is closed
+    int ref_cnt;
+};
+
+int dav1d_mem_pool_init(Dav1dMemPool **const pool_out, const int max_free,
+                        const int hugepages)
+{
+    Dav1dMemPool *const pool = malloc(sizeof(*pool));
+    if (!pool) return -ENOMEM;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pool->free_list = NULL;
+    pool->n_free = 0;
+    pool->max_free = max_free;
+    pool->hugepages = hugepages;
+    pool->bytes = pool->peak_bytes = 0;
+    pool->ref_cnt = 1;
+    *pool_out = pool;
+
+    return 0;
+}
+
+#define POOL_BUFFER_ALLOC_SIZE(sz) (HDR_ALIGN(sz) + sizeof(PoolBuffer))
+
+static void pool_buffer_free(PoolBuffer *const buf) {
+    dav1d_free_aligned(buf->ref.data);
+}
+
+// Must be called with pool->lock held.
+static void pool_buffer_free_locked(Dav1dMemPool *const pool,
+                                    PoolBuffer *const buf)
+{
+    pool->bytes -= POOL_BUFFER_ALLOC_SIZE(buf->size);
+    pool_buffer_free(buf);
+}
+
+// Must be called with pool->lock held; releases it.
+static void pool_unref_unlock(Dav1dMemPool *const pool) {
+    const int last = !--pool->ref_cnt;
+    pthread_mutex_unlock(&pool->lock);
+    if (last) {
+        pthread_mutex_destroy(&pool->lock);
+        free(pool);
+    }
+}
+
+void dav1d_mem_pool_close(Dav1dMemPool **const pool_out) {
+    Dav1dMemPool *const pool = *pool_out;
+    if (!pool) return;
+    *pool_out = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    PoolBuffer *buf = pool->free_list;
+    pool->free_list = NULL;
+    pool->n_free = pool->max_free = 0;
+    pool_unref_unlock(pool);
+
+    while (buf) {
+        PoolBuffer *const next = buf->next;
+        pool_buffer_free(buf);
+        buf = next;
+    }
+}
+
+static void pool_buffer_release(uint8_t *const data, void *const user_data) {
+    PoolBuffer *const buf = user_data;
+    Dav1dMemPool *const pool = buf->pool;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->n_free < pool->max_free) {
+        buf->next = pool->free_list;
+        pool->free_list = buf;
+        pool->n_free++;
+    } else {
+        pool_buffer_free_locked(pool, buf);
+    }
+    pool_unref_unlock(pool);
+}
+
+Dav1dRef *dav1d_ref_create_using_pool(Dav1dMemPool *const pool,
+                                      const size_t size)
+{
+    PoolBuffer *buf = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    // buffers are sized by the frame size, so ones of another size are
+    // unlikely to be needed again; free them rather than keep them
+    for (PoolBuffer **pbuf = &pool->free_list; *pbuf;) {
+        PoolBuffer *const cur = *pbuf;
+        if (cur->size == size && buf) {
+            pbuf = &cur->next;
+            continue;
+        }
+        *pbuf = cur->next;
+        pool->n_free--;
+        if (cur->size == size)
+            buf = cur;
+        else
+            pool_buffer_free_locked(pool, cur);
     }
+    pool->ref_cnt++;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (!buf) {
+        uint8_t *const data = pool->hugepages ?
+            dav1d_alloc_aligned_hugepage(POOL_BUFFER_ALLOC_SIZE(size), 32) :
+            dav1d_alloc_aligned(POOL_BUFFER_ALLOC_SIZE(size), 32);
+        pthread_mutex_lock(&pool->lock);
+        if (!data) {
+            pool_unref_unlock(pool);
+            return NULL;
+        }
+        pool->bytes += POOL_BUFFER_ALLOC_SIZE(size);
+        if (pool->bytes > pool->peak_bytes)
+            pool->peak_bytes = pool->bytes;
+        pthread_mutex_unlock(&pool->lock);
+        buf = (PoolBuffer *) &data[HDR_ALIGN(size)];
+        buf->ref.data = data;
+        buf->pool = pool;
+        buf->size = size;
+    }
+    dav1d_ref_init(&buf->ref, buf->ref.data, size, pool_buffer_release, buf);
+
+    return &buf->ref;
+}
+
+void dav1d_mem_pool_get_usage(Dav1dMemPool *const pool,
+                              size_t *const bytes, size_t *const peak_bytes)
+{
+    pthread_mutex_lock(&pool->lock);
+    *bytes = pool->bytes;
+    *peak_bytes = pool->peak_bytes;
+    pthread_mutex_unlock(&pool->lock);
 }
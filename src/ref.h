@@ -37,15 +37,49 @@ struct Dav1dRef {
     void *data;
     size_t size;
     atomic_int ref_cnt;
+    int free_ref; // whether the reference itself was allocated separately
     void (*free_callback)(uint8_t *data, void *user_data);
     void *user_data;
 };
 
+/*
+ * Allocate aligned memory for a large buffer that is accessed all over
+ * (e.g. a picture), backed by transparent hugepages where supported, to
+ * reduce TLB misses. Released with dav1d_free_aligned().
+ */
+void *dav1d_alloc_aligned_hugepage(size_t sz, size_t align);
+
 Dav1dRef *dav1d_ref_create(size_t size);
 Dav1dRef *dav1d_ref_wrap(uint8_t *ptr, size_t sz,
                          void (*free_callback)(uint8_t *data, void *user_data),
                          void *user_data);
+/*
+ * Initialize a reference embedded in memory that free_callback releases,
+ * without allocating it.
+ */
+void dav1d_ref_init(Dav1dRef *ref, void *data, size_t sz,
+                    void (*free_callback)(uint8_t *data, void *user_data),
+                    void *user_data);
 void dav1d_ref_inc(Dav1dRef *ref);
 void dav1d_ref_dec(Dav1dRef *ref);
 
+/*
+ * Pool of reference-counted buffers, which recycles released buffers for
+ * new ones of the same size (and frees those of other sizes). At most
+ * max_free unused buffers are kept. If hugepages is set, buffers are
+ * allocated with dav1d_alloc_aligned_hugepage(). Closing the pool frees the unused
+ * buffers; buffers still in use are freed when their last reference is
+ * released.
+ */
+typedef struct Dav1dMemPool Dav1dMemPool;
+int dav1d_mem_pool_init(Dav1dMemPool **pool, int max_free, int hugepages);
+void dav1d_mem_pool_close(Dav1dMemPool **pool);
+Dav1dRef *dav1d_ref_create_using_pool(Dav1dMemPool *pool, size_t size);
+/*
+ * Get the bytes allocated by the pool (for buffers in use or kept for
+ * reuse), now and at most.
+ */
+void dav1d_mem_pool_get_usage(Dav1dMemPool *pool,
+                              size_t *bytes, size_t *peak_bytes);
+
 #endif /* __DAV1D_SRC_REF_H__ */
@@ -20,7 +20,8 @@
 typedef struct refmvs {
     mv mv[2];
     int8_t ref[2]; // [0] = 0: intra=1, [1] = -1: comp=0
-    int8_t mode, sb_type;
+    int8_t mode; // intra or (N_INTRA_PRED_MODES +) inter mode
+    int8_t bs; // enum BlockSize
 } refmvs;
 
 typedef struct candidate_mv {
@@ -29,41 +30,51 @@ typedef struct candidate_mv {
     int weight;
 } candidate_mv;
 
-typedef struct AV1_COMMON AV1_COMMON;
-
-// call once per frame thread
-AV1_COMMON *av1_alloc_ref_mv_common(void);
-void av1_free_ref_mv_common(AV1_COMMON *cm);
+// projected (temporal) motion vector for each 8x8 block of the current frame
+typedef struct refmvs_temporal_block {
+    mv mv;
+    int8_t ref_offset; // order hint distance covered by mv; 0 = unavailable
+} refmvs_temporal_block;
+
+typedef struct refmvs_frame {
+    int iw4, ih4; // frame size in 4px units
+    ptrdiff_t stride; // of cur[] and ref[][], in 4px units
+    int sb128, hp, force_int_mv, use_ref_frame_mvs, order_hint_n_bits;
+    refmvs *cur, *ref[7];
+    unsigned cur_poc, ref_poc[7], ref_ref_poc[7][7];
+    const WarpedMotionParams *gmv;
+    uint8_t sign_bias[8]; // indexed by refmvs.ref[]
+    refmvs_temporal_block *tpl; // 8x8 blocks, (stride / 2) per row
+    size_t tpl_sz;
+} refmvs_frame;
 
 // call once per frame
-void av1_init_ref_mv_common(AV1_COMMON *cm,
-                            int w8, int h8,
-                            ptrdiff_t stride,
-                            int allow_sb128,
-                            refmvs *cur,
-                            refmvs *ref_mvs[7],
-                            unsigned cur_poc,
-                            const unsigned ref_poc[7],
-                            const unsigned ref_ref_poc[7][7],
-                            const WarpedMotionParams gmv[7],
-                            int allow_hp, int force_int_mv,
-                            int allow_ref_frame_mvs, int order_hint);
-
-// call for start of each sbrow per tile
-void av1_init_ref_mv_tile_row(AV1_COMMON *cm,
+int av1_init_refmvs_frame(refmvs_frame *rf, int w4, int h4,
+                          ptrdiff_t stride, int sb128,
+                          refmvs *cur, refmvs *ref_mvs[7],
+                          unsigned cur_poc,
+                          const unsigned ref_poc[7],
+                          const unsigned ref_ref_poc[7][7],
+                          const WarpedMotionParams gmv[7],
+                          int hp, int force_int_mv,
+                          int use_ref_frame_mvs, int order_hint_n_bits);
+
+// call for start of each sbrow per tile (resets and projects the temporal
+// mvs of that tile sbrow only, so tile threads can run it concurrently)
+void av1_init_refmvs_tile_row(const refmvs_frame *rf,
                               int tile_col_start4, int tile_col_end4,
                               int row_start4, int row_end4);
 
-// call for each block
+// call for each block; mvlist is only set for single-reference searches
 void av1_find_ref_mvs(candidate_mv *mvstack, int *cnt, mv (*mvlist)[2],
-                      int *ctx, int refidx[2], int w4, int h4,
+                      int *ctx, const int refidx[2],
                       enum BlockSize bs, enum BlockPartition bp,
                       int by4, int bx4, int tile_col_start4,
                       int tile_col_end4, int tile_row_start4,
-                      int tile_row_end4, AV1_COMMON *cm);
+                      int tile_row_end4, const refmvs_frame *rf);
+
+void av1_free_refmvs_frame(refmvs_frame *rf);
 
-extern const uint8_t bs_to_sbtype[];
-extern const uint8_t sbtype_to_bs[];
 static inline void splat_oneref_mv(refmvs *r, const ptrdiff_t stride,
                                    const int by4, const int bx4,
                                    const enum BlockSize bs,
@@ -78,7 +89,7 @@ static inline void splat_oneref_mv(refmvs *r, const ptrdiff_t stride,
     const refmvs tmpl = (refmvs) {
         .ref = { ref + 1, is_interintra ? 0 : -1 },
         .mv = { mv },
-        .sb_type = bs_to_sbtype[bs],
+        .bs = bs,
         .mode = N_INTRA_PRED_MODES + mode,
     };
     do {
@@ -99,7 +110,7 @@ static inline void splat_intrabc_mv(refmvs *r, const ptrdiff_t stride,
     const refmvs tmpl = (refmvs) {
         .ref = { 0, -1 },
         .mv = { mv },
-        .sb_type = bs_to_sbtype[bs],
+        .bs = bs,
         .mode = DC_PRED,
     };
     do {
@@ -123,7 +134,7 @@ static inline void splat_tworef_mv(refmvs *r, const ptrdiff_t stride,
     const refmvs tmpl = (refmvs) {
         .ref = { ref1 + 1, ref2 + 1 },
         .mv = { mv1, mv2 },
-        .sb_type = bs_to_sbtype[bs],
+        .bs = bs,
         .mode = N_INTRA_PRED_MODES + N_INTER_PRED_MODES + mode,
     };
     do {
@@ -149,7 +160,7 @@ static inline void splat_intraref(refmvs *r, const ptrdiff_t stride,
             r[x] = (refmvs) {
                 .ref = { 0, -1 },
                 .mv = { [0] = { .y = -0x8000, .x = -0x8000 }, },
-                .sb_type = bs_to_sbtype[bs],
+                .bs = bs,
                 .mode = mode,
             };
         r += stride;
@@ -81,4 +81,6 @@ extern const int16_t sgr_one_by_x[25];
 extern const int8_t dav1d_mc_subpel_filters[5][15][8];
 extern const int8_t dav1d_mc_warp_filter[][8];
 
+extern const int16_t dav1d_gaussian_sequence[2048]; // for film grain
+
 #endif /* __DAV1D_SRC_TABLES_H__ */
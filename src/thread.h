@@ -37,19 +37,27 @@
 typedef SRWLOCK pthread_mutex_t;
 typedef CONDITION_VARIABLE pthread_cond_t;
 typedef INIT_ONCE pthread_once_t;
-typedef void *pthread_t;
 typedef void *pthread_mutexattr_t;
 typedef void *pthread_condattr_t;
 typedef void *pthread_attr_t;
 
+// The thread's entry point and argument are kept in here rather than in a
+// separate allocation, so a pthread_t must not move while its thread runs;
+// arg is replaced by the thread's result.
+typedef struct {
+    HANDLE h;
+    void *(*proc)(void*);
+    void *arg;
+} pthread_t;
+
 int dav1d_pthread_create(pthread_t* thread, const pthread_attr_t* attr,
                          void*(*proc)(void*), void* param);
-void dav1d_pthread_join(pthread_t thread, void** res);
+int dav1d_pthread_join(pthread_t* thread, void** res);
 int dav1d_pthread_once(pthread_once_t *once_control,
                        void (*init_routine)(void));
 
 #define pthread_create dav1d_pthread_create
-#define pthread_join   dav1d_pthread_join
+#define pthread_join(thread, res) dav1d_pthread_join(&(thread), res)
 #define pthread_once   dav1d_pthread_once
 
 static inline void pthread_mutex_init(pthread_mutex_t* mutex,
@@ -28,12 +28,54 @@
 #ifndef __DAV1D_SRC_THREAD_DATA_H__
 #define __DAV1D_SRC_THREAD_DATA_H__
 
+#include <stdatomic.h>
+
+#include "config.h"
+
 #include "src/thread.h"
 
+// Bounded spinning before blocking on a condition variable, for waits that
+// are mostly over within microseconds (Dav1dSettings.spin_wait). Each wait
+// spins for up to twice the rounds that recent waits took, plus a few, but
+// never more than max (0 = never spin); a wait that blocks counts as having
+// taken all of them, as with glibc's adaptive mutexes.
+typedef struct Dav1dSpin {
+    int max;
+    atomic_int avg;
+} Dav1dSpin;
+
 struct thread_data {
     pthread_t thread;
     pthread_cond_t cond;
     pthread_mutex_t lock;
+    Dav1dSpin spin; // for waits on progress signalled by this thread
 };
 
+static inline void dav1d_cpu_pause(void) {
+#if defined(_WIN32)
+    YieldProcessor();
+#elif ARCH_X86 && defined(__GNUC__)
+    __asm__ __volatile__("pause");
+#elif (ARCH_AARCH64 || ARCH_ARM) && defined(__GNUC__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Spins while cond holds, re-evaluating it after each pause, for at most
+// the rounds that s currently allows; cond is true after it if the caller
+// still has to block.
+#define dav1d_spin_while(s, cond) do { \
+    Dav1dSpin *const spin_ = (s); \
+    if (!spin_->max) break; \
+    const int avg_ = atomic_load_explicit(&spin_->avg, memory_order_relaxed); \
+    const int rounds_ = avg_ * 2 + 10 < spin_->max ? avg_ * 2 + 10 : spin_->max; \
+    int n_ = 0; \
+    while ((cond) && n_ < rounds_) { \
+        dav1d_cpu_pause(); \
+        n_++; \
+    } \
+    atomic_store_explicit(&spin_->avg, avg_ + (n_ - avg_) / 8, \
+                          memory_order_relaxed); \
+} while (0)
+
 #endif /* __DAV1D_SRC_THREAD_DATA_H__ */
@@ -27,109 +27,613 @@
 
 #include "config.h"
 
+#include <assert.h>
+#include <limits.h>
+
+#include "common/intops.h"
+
+#include "src/decode.h"
+#include "src/profile.h"
 #include "src/thread_task.h"
 
 void *dav1d_frame_task(void *const data) {
     Dav1dFrameContext *const f = data;
 
+    dav1d_prof_set(&f->tc->prof);
+    pthread_mutex_lock(&f->frame_thread.td.lock);
     for (;;) {
-        pthread_mutex_lock(&f->frame_thread.td.lock);
-        f->n_tile_data = 0;
-        int did_signal = 0;
-        while (!f->n_tile_data && !f->frame_thread.die) {
-            if (!did_signal) {
-                did_signal = 1;
-                pthread_cond_signal(&f->frame_thread.td.cond);
-            }
+        while (!f->n_tile_data && !f->frame_thread.die)
             pthread_cond_wait(&f->frame_thread.td.cond,
                               &f->frame_thread.td.lock);
-        }
-        if (f->frame_thread.die) {
-            pthread_mutex_unlock(&f->frame_thread.td.lock);
-            break;
-        }
+        if (f->frame_thread.die) break;
         pthread_mutex_unlock(&f->frame_thread.td.lock);
 
+        dav1d_trace(f, f->tc->trace_thread, DAV1D_TRACE_FRAME, 0, -1);
         decode_frame(f);
+        dav1d_trace(f, f->tc->trace_thread, DAV1D_TRACE_FRAME, 1, -1);
+        // before becoming idle, so that the application thread never finds
+        // the output queue slot of this frame (or an earlier one) occupied
+        if (f->picture_ready->callback)
+            dav1d_picture_ready(f->c, f->picture_ready, (int) (f - f->c->fc));
+
+        // only now, so that a frame submitted before this thread first got
+        // the lock is not lost
+        pthread_mutex_lock(&f->frame_thread.td.lock);
+        // after an early error, tile groups may still be on their way
+        while (!f->tile_data_done)
+            pthread_cond_wait(&f->frame_thread.td.cond,
+                              &f->frame_thread.td.lock);
+        for (int i = 0; i < f->n_tile_data; i++)
+            dav1d_data_unref(&f->tile[i].data);
+        f->n_tile_data = 0;
+        pthread_cond_broadcast(&f->frame_thread.td.cond);
+        if (f->n_tc > 1) {
+            // the application thread may be running tasks while waiting
+            // for us to become idle, see dav1d_frame_thread_wait_idle()
+            struct TaskThreadData *const ttd = f->tile_thread.ttd;
+            pthread_mutex_unlock(&f->frame_thread.td.lock);
+            pthread_mutex_lock(&ttd->lock);
+            pthread_cond_broadcast(&ttd->cond);
+            pthread_mutex_unlock(&ttd->lock);
+            pthread_mutex_lock(&f->frame_thread.td.lock);
+        }
     }
+    pthread_mutex_unlock(&f->frame_thread.td.lock);
 
     return NULL;
 }
 
-void *dav1d_tile_task(void *const data) {
-    Dav1dTileContext *const t = data;
-    struct FrameTileThreadData *const fttd = t->tile_thread.fttd;
-    const Dav1dFrameContext *const f = t->f;
-    const int tile_thread_idx = t - f->tc;
-    const uint64_t mask = 1ULL << tile_thread_idx;
+enum TaskType {
+    TASK_TILE,
+    TASK_DEBLOCK, // also backs up the deblocked pixels needed by LR
+    TASK_CDEF,
+    TASK_LR,
+};
 
-    for (;;) {
-        pthread_mutex_lock(&fttd->lock);
-        fttd->available |= mask;
-        int did_signal = 0;
-        while (!fttd->tasks_left && !t->tile_thread.die) {
-            if (!did_signal) {
-                did_signal = 1;
-                pthread_cond_signal(&fttd->icond);
+static const enum Dav1dTraceEventType task_trace_type[] = {
+    [TASK_TILE] = DAV1D_TRACE_TILE_SBROW,
+    [TASK_DEBLOCK] = DAV1D_TRACE_DEBLOCK,
+    [TASK_CDEF] = DAV1D_TRACE_CDEF,
+    [TASK_LR] = DAV1D_TRACE_LR,
+};
+
+// whether f has tasks that were not handed out yet; LR is the last
+// post-filter stage to be handed out for the last sbrow
+static inline int has_tasks_left(const Dav1dFrameContext *const f) {
+    return f->tile_thread.tasks_left || f->tile_thread.filter_next[2] < f->sbh;
+}
+
+// number of superblock columns of ts
+static inline int tile_sb_cols(const Dav1dFrameContext *const f,
+                               const Dav1dTileState *const ts)
+{
+    return (ts->tiling.col_end - ts->tiling.col_start + f->sb_step - 1) >>
+           f->sb_shift;
+}
+
+static inline atomic_int *sb_progress(const Dav1dFrameContext *const f,
+                                      const Dav1dTileState *const ts,
+                                      const int sby)
+{
+    return &f->tile_thread.sb_progress[sby * f->frame_hdr.tiling.cols +
+                                       ts->tiling.col].sbs;
+}
+
+// whether sbrow sby of ts can be handed out: once it is parsed (see
+// FrameTileThreadData.parsed), and the previous sbrow has finished or, with
+// wavefront reconstruction, is two superblocks ahead
+static int sbrow_ready(const Dav1dFrameContext *const f,
+                       const Dav1dTileState *const ts, const int sby)
+{
+    if (sby >= f->tile_thread.parsed)
+        return 0;
+    if (!f->tile_thread.wavefront)
+        return atomic_load(&ts->progress) == sby;
+    return sby << f->sb_shift == ts->tiling.row_start ||
+           atomic_load(sb_progress(f, ts, sby - 1)) >=
+               imin(2, tile_sb_cols(f, ts));
+}
+
+// Picks a tile task of f whose dependencies are met, and returns its tile
+// index, or -1 if there is none right now. Only tiles that the frame thread
+// has set up (as their data arrived) are taken. For full-tile tasks, *sby is
+// set to -1; for tile-sbrow tasks, it is the sbrow to decode (see
+// sbrow_ready()). Of all ready ones, the task with the lowest sbrow is
+// picked, since the post-filter runs in sbrow order, and of those, the one
+// in the tile column that t decoded last (of any frame), whose above
+// context, entropy state and reference pixels are likely still in the
+// cache of t's core. Must be called with ttd->lock held.
+static int take_tile_task(Dav1dFrameContext *const f,
+                          Dav1dTileContext *const t, int *const sby)
+{
+    struct FrameTileThreadData *const fttd = &f->tile_thread;
+    int tile_idx = -1;
+
+    if (!fttd->tasks_left) return -1;
+    if (!fttd->wavefront &&
+        (f->frame_thread.pass == 1 || f->n_tc >= f->frame_hdr.tiling.cols))
+    {
+        tile_idx = fttd->num_tasks - fttd->tasks_left;
+        if (tile_idx >= fttd->tiles_ready) return -1;
+        *sby = -1;
+    } else {
+        int min_sby = INT_MAX;
+        for (int n = 0; n < fttd->tiles_ready; n++) {
+            Dav1dTileState *const ts = &f->ts[n];
+            const int next_sby = ts->tile_thread.next_sby;
+            if ((next_sby < min_sby ||
+                 (next_sby == min_sby &&
+                  ts->tiling.col == t->tile_thread.tile_col)) &&
+                next_sby << f->sb_shift < ts->tiling.row_end &&
+                sbrow_ready(f, ts, next_sby))
+            {
+                min_sby = next_sby;
+                tile_idx = n;
             }
-            pthread_cond_wait(&fttd->cond, &fttd->lock);
         }
-        if (t->tile_thread.die) {
-            pthread_mutex_unlock(&fttd->lock);
-            break;
-        }
-        fttd->available &= ~mask;
-        const int task_idx = fttd->num_tasks - fttd->tasks_left--;
-        pthread_mutex_unlock(&fttd->lock);
-
-        if (f->frame_thread.pass == 1 || f->n_tc >= f->frame_hdr.tiling.cols) {
-            // we can (or in fact, if >, we need to) do full tile decoding.
-            // loopfilter happens in the main thread
-            Dav1dTileState *const ts = t->ts = &f->ts[task_idx];
-            for (t->by = ts->tiling.row_start; t->by < ts->tiling.row_end;
-                 t->by += f->sb_step)
-            {
-                decode_tile_sbrow(t);
+        if (tile_idx < 0) return -1;
+        f->ts[tile_idx].tile_thread.next_sby++;
+        t->tile_thread.tile_col = f->ts[tile_idx].tiling.col;
+        *sby = min_sby;
+    }
+
+    fttd->tasks_left--;
+    fttd->tasks_running++;
+
+    return tile_idx;
+}
+
+// Picks a post-filter stage of f that can run on its next sbrow, and returns
+// its task type, or -1 if there is none right now. Each stage runs in sbrow
+// order, and after the previous stage of the same sbrow; deblocking also
+// needs all tiles to have decoded the sbrow, and LR of sbrow sby - 2 to have
+// finished, since that uses the same loop filtered pixel backup buffer.
+// Later stages are preferred, so that picture progress advances as early as
+// possible. Must be called with ttd->lock held.
+static int take_filter_task(Dav1dFrameContext *const f, int *const sby) {
+    struct FrameTileThreadData *const fttd = &f->tile_thread;
+    int *const next = fttd->filter_next, *const done = fttd->filter_done;
+
+    if (next[2] == done[2] && next[2] < done[1]) {
+        *sby = next[2]++;
+        return TASK_LR;
+    }
+    if (next[1] == done[1] && next[1] < done[0]) {
+        *sby = next[1]++;
+        return TASK_CDEF;
+    }
+    if (next[0] == done[0] && next[0] < f->sbh && next[0] <= done[2] + 1) {
+        const int s = next[0];
+        int tile_row = 0;
+        while (f->frame_hdr.tiling.row_start_sb[tile_row + 1] <= s) tile_row++;
+        if ((tile_row + 1) * f->frame_hdr.tiling.cols > fttd->tiles_ready)
+            return -1;
+        const Dav1dTileState *const ts =
+            &f->ts[tile_row * f->frame_hdr.tiling.cols];
+        for (int tile_col = 0; tile_col < f->frame_hdr.tiling.cols; tile_col++)
+            if (atomic_load(&ts[tile_col].progress) <= s) return -1;
+        *sby = next[0]++;
+        return TASK_DEBLOCK;
+    }
+
+    return -1;
+}
+
+// Picks any task of f whose dependencies are met (see above) for t to run,
+// and returns its type, or -1 if there is none right now. Must be called
+// with ttd->lock held.
+static int take_task(Dav1dFrameContext *const f, Dav1dTileContext *const t,
+                     int *const tile_idx, int *const sby)
+{
+    int type = take_filter_task(f, sby);
+    if (type < 0 && (*tile_idx = take_tile_task(f, t, sby)) >= 0)
+        type = TASK_TILE;
+
+    if (type >= 0 && !has_tasks_left(f)) {
+        struct FrameTileThreadData *const fttd = &f->tile_thread;
+        Dav1dFrameContext **pf = &fttd->ttd->first;
+        while (*pf != f) pf = &(*pf)->tile_thread.next;
+        *pf = fttd->next;
+        fttd->next = NULL;
+    }
+
+    return type;
+}
 
-                // signal progress
-                pthread_mutex_lock(&ts->tile_thread.lock);
-                atomic_store(&ts->progress, 1 + (t->by >> f->sb_shift));
-                pthread_cond_signal(&ts->tile_thread.cond);
-                pthread_mutex_unlock(&ts->tile_thread.lock);
+// Picks a ready task of any frame, served in decode order, so tasks of
+// a frame are never starved by those of a later frame that references it
+// (and the frame output next comes first), and frames whose remaining tasks
+// are all blocked are skipped. Frames that other threads are waiting for,
+// as a reference, are served before all others though, since those threads
+// (possibly workers, or frame threads whose frames gate yet more frames)
+// are stalled until they progress. If before is set, only frames decoded
+// before it are considered; tasks of those never wait for progress of
+// before itself. Returns the task type, with *pf set to its frame, or -1 if
+// there is none right now. Must be called with ttd->lock held.
+static int take_any_task(struct TaskThreadData *const ttd,
+                         const Dav1dFrameContext *const before,
+                         Dav1dTileContext *const t,
+                         Dav1dFrameContext **const pf,
+                         int *const tile_idx, int *const sby)
+{
+    for (int waited_for = 1; waited_for >= 0; waited_for--) {
+        int skipped = 0;
+        for (Dav1dFrameContext *f = ttd->first; f; f = f->tile_thread.next) {
+            if (before &&
+                (int) (f->tile_thread.seq - before->tile_thread.seq) >= 0)
+            {
+                break;
+            }
+            if (waited_for && !dav1d_thread_picture_has_waiters(&f->cur)) {
+                skipped = 1;
+                continue;
             }
-        } else {
-            const int sby = f->tile_thread.task_idx_to_sby_and_tile_idx[task_idx][0];
-            const int tile_idx = f->tile_thread.task_idx_to_sby_and_tile_idx[task_idx][1];
-            Dav1dTileState *const ts = &f->ts[tile_idx];
-
-            // the interleaved decoding can sometimes cause dependency issues
-            // if one part of the frame decodes signifcantly faster than others.
-            // Ideally, we'd "skip" tile_sbrows where dependencies are missing,
-            // and resume them later as dependencies are met. This also would
-            // solve the broadcast() below and allow us to use signal(). However,
-            // for now, we use linear dependency tracking because it's simpler.
-            if (atomic_load(&ts->progress) < sby) {
-                pthread_mutex_lock(&ts->tile_thread.lock);
-                while (atomic_load(&ts->progress) < sby)
-                    pthread_cond_wait(&ts->tile_thread.cond,
-                                      &ts->tile_thread.lock);
-                pthread_mutex_unlock(&ts->tile_thread.lock);
+            const int type = take_task(f, t, tile_idx, sby);
+            if (type >= 0) {
+                // we may have been woken up for a ready task of a frame
+                // skipped above, and this one may block, so pass that on
+                if (skipped)
+                    pthread_cond_signal(&ttd->cond);
+                *pf = f;
+                return type;
             }
+        }
+    }
+
+    return -1;
+}
+
+// Signals that sbrow sby of ts has finished (along with all of its previous
+// ones). With wavefront reconstruction, sbrows may signal this out of order,
+// since each one finishes after the superblocks of the previous one, but
+// before that one's task has returned.
+static void signal_progress(Dav1dFrameContext *const f,
+                            Dav1dTileState *const ts, const int sby)
+{
+    struct TaskThreadData *const ttd = f->tile_thread.ttd;
+
+    pthread_mutex_lock(&ttd->lock);
+    if (f->tile_thread.wavefront)
+        atomic_store(sb_progress(f, ts, sby), tile_sb_cols(f, ts));
+    if (atomic_load(&ts->progress) <= sby)
+        atomic_store(&ts->progress, 1 + sby);
+    // wake up the frame thread, and a worker for the next sbrow of this
+    // tile, if that is a task of its own, or for the post-filter
+    pthread_cond_signal(&f->tile_thread.icond);
+    if (has_tasks_left(f))
+        pthread_cond_signal(&ttd->cond);
+    if (ttd->wf_waiting)
+        pthread_cond_broadcast(&ttd->wf_cond);
+    pthread_mutex_unlock(&ttd->lock);
+}
+
+void dav1d_tile_task_parsed(Dav1dFrameContext *const f, const int n) {
+    struct TaskThreadData *const ttd = f->tile_thread.ttd;
+
+    pthread_mutex_lock(&ttd->lock);
+    f->tile_thread.parsed = n;
+    // the sbrow may be ready in all tile columns
+    if (has_tasks_left(f))
+        pthread_cond_broadcast(&ttd->cond);
+    pthread_mutex_unlock(&ttd->lock);
+}
+
+void dav1d_tile_task_wait_sb(const Dav1dTileContext *const t, const int sbx) {
+    const Dav1dFrameContext *const f = t->f;
+    const Dav1dTileState *const ts = t->ts;
+
+    if (t->by == ts->tiling.row_start) return;
+    const int sby = t->by >> f->sb_shift;
+    const int need = imin(sbx + 2, tile_sb_cols(f, ts));
+    atomic_int *const progress = sb_progress(f, ts, sby - 1);
+    if (atomic_load(progress) >= need) return;
+
+    struct TaskThreadData *const ttd = f->tile_thread.ttd;
+    const uint64_t start = dav1d_time_nanos();
+    dav1d_trace(f, t->trace_thread, DAV1D_TRACE_WAIT_WAVEFRONT, 0, sby);
+    pthread_mutex_lock(&ttd->lock);
+    ttd->wf_waiting++;
+    while (atomic_load(progress) < need)
+        pthread_cond_wait(&ttd->wf_cond, &ttd->lock);
+    ttd->wf_waiting--;
+    pthread_mutex_unlock(&ttd->lock);
+    dav1d_trace(f, t->trace_thread, DAV1D_TRACE_WAIT_WAVEFRONT, 1, sby);
+    dav1d_wait_stats_add(f, DAV1D_WAIT_WAVEFRONT, dav1d_time_nanos() - start);
+}
+
+void dav1d_tile_task_signal_sb(const Dav1dTileContext *const t, const int n) {
+    const Dav1dFrameContext *const f = t->f;
+    const Dav1dTileState *const ts = t->ts;
+    struct TaskThreadData *const ttd = f->tile_thread.ttd;
+
+    pthread_mutex_lock(&ttd->lock);
+    atomic_store(sb_progress(f, ts, t->by >> f->sb_shift), n);
+    if (ttd->wf_waiting)
+        pthread_cond_broadcast(&ttd->wf_cond);
+    // the next sbrow of the tile may now be handed out
+    if (n == imin(2, tile_sb_cols(f, ts)) && has_tasks_left(f))
+        pthread_cond_signal(&ttd->cond);
+    pthread_mutex_unlock(&ttd->lock);
+}
+
+static void run_tile_task(Dav1dFrameContext *const f, Dav1dTileContext *const t,
+                          const int tile_idx, const int sby)
+{
+    Dav1dTileState *const ts = &f->ts[tile_idx];
+    const int last_sby = f->frame_hdr.tiling.row_start_sb[ts->tiling.row + 1] - 1;
+
+    if (dav1d_frame_cancelled(f)) {
+        signal_progress(f, ts, sby >= 0 ? sby : last_sby);
+        return;
+    }
+    if (dav1d_tile_context_alloc(t, f) < 0) {
+        // skip the tile (or sbrow), but mark it as done so that nothing waits
+        // for it forever; decode_frame() fails the frame at the end
+        pthread_mutex_lock(&f->tile_thread.ttd->lock);
+        f->tile_thread.error = 1;
+        pthread_mutex_unlock(&f->tile_thread.ttd->lock);
+        signal_progress(f, ts, sby >= 0 ? sby : last_sby);
+        return;
+    }
 
-            // we need to interleave sbrow decoding for all tile cols in a
-            // tile row, since otherwise subsequent threads will be blocked
-            // waiting for the post-filter to complete
-            t->ts = ts;
-            t->by = sby << f->sb_shift;
+    t->f = f;
+    t->ts = ts;
+    t->pass = f->frame_thread.pass;
+    if (sby < 0) {
+        // we can (or in fact, if >, we need to) do full tile decoding.
+        // the post-filter runs as tasks of its own
+        for (t->by = ts->tiling.row_start; t->by < ts->tiling.row_end;
+             t->by += f->sb_step)
+        {
+            if (dav1d_frame_cancelled(f)) {
+                signal_progress(f, ts, last_sby);
+                break;
+            }
             decode_tile_sbrow(t);
+            signal_progress(f, ts, t->by >> f->sb_shift);
+        }
+    } else {
+        // we need to interleave sbrow decoding for all tile cols in a
+        // tile row, since otherwise subsequent threads will be blocked
+        // waiting for the post-filter to complete. take_tile_task() only
+        // hands out sbrows whose predecessor in the same tile is done, so
+        // this never waits; other tiles' sbrows are decoded in the meantime.
+        // With wavefront reconstruction, the predecessor may still run,
+        // and tile_sbrow() waits for it per superblock.
+        assert(f->tile_thread.wavefront ? atomic_load(&ts->progress) <= sby :
+                                          atomic_load(&ts->progress) == sby);
+        t->by = sby << f->sb_shift;
+        decode_tile_sbrow(t);
+        signal_progress(f, ts, sby);
+    }
+}
+
+// returns the time the task took, in nanoseconds, if frame statistics are
+// collected, else 0
+static uint64_t run_task(Dav1dFrameContext *const f, Dav1dTileContext *const t,
+                         const enum TaskType type, const int tile_idx,
+                         const int sby)
+{
+    const int skip_filter = dav1d_frame_cancelled(f);
+    const uint64_t start = f->c->frame_stats ? dav1d_time_nanos() : 0;
+
+    dav1d_trace(f, t->trace_thread, task_trace_type[type], 0, sby);
+    switch (type) {
+    case TASK_TILE:
+        run_tile_task(f, t, tile_idx, sby);
+        break;
+    case TASK_DEBLOCK:
+        if (!skip_filter) f->bd_fn.filter_sbrow_deblock(f, sby);
+        break;
+    case TASK_CDEF:
+        if (!skip_filter) f->bd_fn.filter_sbrow_cdef(f, sby);
+        break;
+    case TASK_LR:
+        if (!skip_filter) f->bd_fn.filter_sbrow_lr(f, sby);
+        // LR is the last stage, and runs in sbrow order
+        dav1d_thread_picture_signal(&f->cur, dav1d_post_filter_progress(f, sby),
+                                    f->frame_thread.pass == 0 ?
+                                    PLANE_TYPE_ALL : PLANE_TYPE_Y);
+        break;
+    }
+    dav1d_trace(f, t->trace_thread, task_trace_type[type], 1, sby);
 
-            // signal progress
-            pthread_mutex_lock(&ts->tile_thread.lock);
-            atomic_store(&ts->progress, 1 + sby);
-            pthread_cond_broadcast(&ts->tile_thread.cond);
-            pthread_mutex_unlock(&ts->tile_thread.lock);
+    return start ? dav1d_time_nanos() - start : 0;
+}
+
+// Must be called with ttd->lock held.
+static void finish_task(Dav1dFrameContext *const f, const enum TaskType type,
+                        const uint64_t time)
+{
+    f->stats.stage_time[type] += time;
+    if (type == TASK_TILE) {
+        f->tile_thread.tasks_running--;
+    } else {
+        f->tile_thread.filter_done[type - TASK_DEBLOCK]++;
+        // the next stage of this sbrow, or this stage of the next sbrow
+        // (which the caller will likely pick itself) may now be ready
+        if (has_tasks_left(f))
+            pthread_cond_signal(&f->tile_thread.ttd->cond);
+    }
+    pthread_cond_signal(&f->tile_thread.icond);
+}
+
+void *dav1d_tile_task(void *const data) {
+    Dav1dTileContext *const t = data;
+    struct TaskThreadData *const ttd = t->tile_thread.ttd;
+
+    dav1d_prof_set(&t->prof);
+    pthread_mutex_lock(&ttd->lock);
+    for (;;) {
+        Dav1dFrameContext *f;
+        int tile_idx, sby;
+        const int type = take_any_task(ttd, NULL, t, &f, &tile_idx, &sby);
+        if (type < 0) {
+            if (ttd->die) break;
+            pthread_cond_wait(&ttd->cond, &ttd->lock);
+            continue;
         }
+        pthread_mutex_unlock(&ttd->lock);
+
+        const uint64_t time = run_task(f, t, type, tile_idx, sby);
+
+        pthread_mutex_lock(&ttd->lock);
+        finish_task(f, type, time);
     }
+    pthread_mutex_unlock(&ttd->lock);
 
     return NULL;
 }
+
+void dav1d_tile_task_seq(Dav1dFrameContext *const f) {
+    struct TaskThreadData *const ttd = f->tile_thread.ttd;
+
+    pthread_mutex_lock(&ttd->lock);
+    f->tile_thread.seq = ttd->seq++;
+    pthread_mutex_unlock(&ttd->lock);
+}
+
+void dav1d_tile_task_submit(Dav1dFrameContext *const f, const int num_tasks) {
+    struct TaskThreadData *const ttd = f->tile_thread.ttd;
+    // the first pass of 2-pass decoding has no post-filter
+    const int filter_start = f->frame_thread.pass == 1 ? f->sbh : 0;
+
+    pthread_mutex_lock(&ttd->lock);
+    assert(!f->tile_thread.tasks_left && !f->tile_thread.tasks_running);
+    f->tile_thread.num_tasks = f->tile_thread.tasks_left = num_tasks;
+    for (int n = 0; n < 3; n++)
+        f->tile_thread.filter_next[n] = f->tile_thread.filter_done[n] =
+            filter_start;
+    // frame threads may submit out of order, so keep the list in decode
+    // order, see dav1d_tile_task_seq()
+    Dav1dFrameContext **pf = &ttd->first;
+    while (*pf && (int) ((*pf)->tile_thread.seq - f->tile_thread.seq) < 0)
+        pf = &(*pf)->tile_thread.next;
+    f->tile_thread.next = *pf;
+    *pf = f;
+    pthread_cond_broadcast(&ttd->cond);
+    pthread_mutex_unlock(&ttd->lock);
+}
+
+// Runs a ready task of f on the calling (frame) thread or, if there is none,
+// one of a frame submitted before f, or else waits for f's state to change.
+// Rather than going to sleep, the frame thread runs tasks that no worker has
+// picked up (yet); the workers may all be blocked on tasks of later frames
+// that reference this one. Must be called with ttd->lock held.
+static void run_or_wait(Dav1dFrameContext *const f) {
+    struct TaskThreadData *const ttd = f->tile_thread.ttd;
+    Dav1dFrameContext *tf = f;
+    int tile_idx, sby;
+
+    int type = take_task(f, f->tc, &tile_idx, &sby);
+    if (type < 0)
+        type = take_any_task(ttd, f, f->tc, &tf, &tile_idx, &sby);
+    if (type < 0) {
+        const uint64_t start = dav1d_time_nanos();
+        dav1d_trace(f, f->tc->trace_thread, DAV1D_TRACE_WAIT_TILE, 0, -1);
+        pthread_cond_wait(&f->tile_thread.icond, &ttd->lock);
+        dav1d_trace(f, f->tc->trace_thread, DAV1D_TRACE_WAIT_TILE, 1, -1);
+        dav1d_wait_stats_add(f, DAV1D_WAIT_TILE, dav1d_time_nanos() - start);
+        return;
+    }
+    pthread_mutex_unlock(&ttd->lock);
+
+    const uint64_t time = run_task(tf, f->tc, type, tile_idx, sby);
+
+    pthread_mutex_lock(&ttd->lock);
+    finish_task(tf, type, time);
+}
+
+void dav1d_tile_task_wait_progress(Dav1dFrameContext *const f,
+                                   Dav1dTileState *const ts, const int sby)
+{
+    struct TaskThreadData *const ttd = f->tile_thread.ttd;
+
+    dav1d_spin_while(&f->tile_thread.spin, atomic_load(&ts->progress) <= sby);
+    if (atomic_load(&ts->progress) > sby) return;
+    pthread_mutex_lock(&ttd->lock);
+    while (atomic_load(&ts->progress) <= sby)
+        run_or_wait(f);
+    pthread_mutex_unlock(&ttd->lock);
+}
+
+void dav1d_tile_task_wait(Dav1dFrameContext *const f) {
+    struct TaskThreadData *const ttd = f->tile_thread.ttd;
+    const struct FrameTileThreadData *const fttd = &f->tile_thread;
+
+    pthread_mutex_lock(&ttd->lock);
+    while (fttd->tasks_left || fttd->tasks_running ||
+           fttd->filter_done[2] < f->sbh)
+    {
+        run_or_wait(f);
+    }
+    pthread_mutex_unlock(&ttd->lock);
+}
+
+void dav1d_frame_thread_wait_idle(Dav1dFrameContext *const f,
+                                  Dav1dTileContext *const t)
+{
+    pthread_mutex_lock(&f->frame_thread.td.lock);
+    const int busy = f->n_tile_data > 0;
+    pthread_mutex_unlock(&f->frame_thread.td.lock);
+    const uint64_t start = busy ? dav1d_time_nanos() : 0;
+    if (busy) dav1d_trace(f, 0, DAV1D_TRACE_WAIT_FRAME_THREAD, 0, -1);
+
+    if (t) {
+        // run tasks of any frame until f's frame thread is idle; it wakes
+        // us up through ttd->cond once it is
+        struct TaskThreadData *const ttd = f->tile_thread.ttd;
+
+        pthread_mutex_lock(&ttd->lock);
+        for (;;) {
+            pthread_mutex_lock(&f->frame_thread.td.lock);
+            const int idle = !f->n_tile_data;
+            pthread_mutex_unlock(&f->frame_thread.td.lock);
+            if (idle) break;
+
+            Dav1dFrameContext *tf;
+            int tile_idx, sby;
+            const int type = take_any_task(ttd, NULL, t, &tf, &tile_idx, &sby);
+            if (type < 0) {
+                pthread_cond_wait(&ttd->cond, &ttd->lock);
+                continue;
+            }
+            pthread_mutex_unlock(&ttd->lock);
+
+            const uint64_t time = run_task(tf, t, type, tile_idx, sby);
+
+            pthread_mutex_lock(&ttd->lock);
+            finish_task(tf, type, time);
+        }
+        // we may have consumed a wake-up meant for a worker
+        if (ttd->first)
+            pthread_cond_signal(&ttd->cond);
+        pthread_mutex_unlock(&ttd->lock);
+    }
+
+    pthread_mutex_lock(&f->frame_thread.td.lock);
+    while (f->n_tile_data > 0)
+        pthread_cond_wait(&f->frame_thread.td.cond,
+                          &f->frame_thread.td.lock);
+    if (busy) {
+        dav1d_trace(f, 0, DAV1D_TRACE_WAIT_FRAME_THREAD, 1, -1);
+        dav1d_wait_stats_add(f, DAV1D_WAIT_FRAME_THREAD,
+                             dav1d_time_nanos() - start);
+    }
+}
+
+void dav1d_wait_ref(const Dav1dTileContext *const t,
+                    const Dav1dThreadPicture *const p, const int y,
+                    const enum PlaneType plane_type)
+{
+    const Dav1dFrameContext *const f = t->f;
+
+    if (dav1d_thread_picture_progressed(p, y, plane_type)) return;
+
+    const int sby = t->by >> f->sb_shift;
+    const uint64_t start = dav1d_time_nanos();
+    dav1d_trace(f, t->trace_thread, DAV1D_TRACE_WAIT_REF, 0, sby);
+    dav1d_thread_picture_wait(p, y, plane_type);
+    dav1d_trace(f, t->trace_thread, DAV1D_TRACE_WAIT_REF, 1, sby);
+    dav1d_wait_stats_add(f, DAV1D_WAIT_REF, dav1d_time_nanos() - start);
+}
@@ -28,12 +28,111 @@
 #ifndef __DAV1D_SRC_THREAD_TASK_H__
 #define __DAV1D_SRC_THREAD_TASK_H__
 
+#include <stdint.h>
+#ifndef _WIN32
+#include <time.h>
+#endif
+
 #include "src/internal.h"
 
 int decode_frame(Dav1dFrameContext *f);
+// whether dav1d_flush() is cancelling the frames in flight: f then stops
+// decoding at the next sbrow (its tasks only signal their progress, so that
+// nothing waits for them forever), and is neither output nor referenced;
+// or whether f failed to parse with parse-ahead, and is then output as
+// decoded so far, as with a single thread
+static inline int dav1d_frame_cancelled(const Dav1dFrameContext *const f) {
+    return atomic_load(&f->c->frame_thread.flush) ||
+           atomic_load(&f->tile_thread.aborted);
+}
 void *dav1d_frame_task(void *data);
 
+// monotonic clock, in nanoseconds, for Dav1dSettings.frame_stats
+static inline uint64_t dav1d_time_nanos(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, t;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (uint64_t) ((double) t.QuadPart * 1e9 / freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return 1000000000ULL * ts.tv_sec + ts.tv_nsec;
+#endif
+}
+
+// Dav1dSettings.trace: reports the beginning or end of a span of the
+// thread numbered thread (see Dav1dTraceEvent) for frame f
+static inline void dav1d_trace(const Dav1dFrameContext *const f,
+                               const int thread,
+                               const enum Dav1dTraceEventType type,
+                               const int end, const int sby)
+{
+    const Dav1dContext *const c = f->c;
+
+    if (!c->trace.callback) return;
+    const Dav1dTraceEvent ev = {
+        .type = type,
+        .end = end,
+        .time = dav1d_time_nanos(),
+        .thread = thread,
+        .poc = f->frame_hdr.frame_offset,
+        .sby = sby,
+    };
+    c->trace.callback(&ev, c->trace.cookie);
+}
+// accounts for a wait of f's decoder that blocked for nanos, see
+// dav1d_get_wait_stats()
+static inline void dav1d_wait_stats_add(const Dav1dFrameContext *const f,
+                                        const enum Dav1dWaitType type,
+                                        const uint64_t nanos)
+{
+    WaitStats *const ws = f->waits;
+
+    pthread_mutex_lock(&ws->lock);
+    ws->count[type]++;
+    ws->nanos[type] += nanos;
+    pthread_mutex_unlock(&ws->lock);
+}
+// dav1d_thread_picture_wait() on reference p for the sbrow t is decoding;
+// if it has to wait, it is traced and accounted as DAV1D_WAIT_REF
+void dav1d_wait_ref(const Dav1dTileContext *t, const Dav1dThreadPicture *p,
+                    int y, enum PlaneType plane_type);
+
 int decode_tile_sbrow(Dav1dTileContext *t);
+// allocate t's per-thread buffers for the superblock size and bitdepth of f,
+// if not done so already; returns 0 on success, or -ENOMEM
+int dav1d_tile_context_alloc(Dav1dTileContext *t, const Dav1dFrameContext *f);
 void *dav1d_tile_task(void *data);
 
+// give f its place in the decode order of the frames using the pool, before
+// its tile data is handed to the frame thread (under ttd->lock, since the
+// pool may be shared by several decoders)
+void dav1d_tile_task_seq(Dav1dFrameContext *f);
+// queue num_tasks tile tasks of f on the shared tile worker threads, and
+// (outside the first pass) the post-filter of each sbrow, which signals
+// picture progress as it completes
+void dav1d_tile_task_submit(Dav1dFrameContext *f, int num_tasks);
+// wait until ts has decoded sbrow sby, meanwhile running ready tasks of f
+// on the calling (frame) thread, using f->tc
+void dav1d_tile_task_wait_progress(Dav1dFrameContext *f, Dav1dTileState *ts,
+                                   int sby);
+// wait until all of f's tasks have finished running, meanwhile running
+// ready ones on the calling (frame) thread
+void dav1d_tile_task_wait(Dav1dFrameContext *f);
+// with parse-ahead, hand out the first n sbrows of f to the tile tasks of
+// pass 2, as the frame thread has parsed them
+void dav1d_tile_task_parsed(Dav1dFrameContext *f, int n);
+// with wavefront reconstruction (f->tile_thread.wavefront), wait until the
+// previous sbrow of t's tile has reconstructed superblock column sbx + 1 (or
+// all of them), i.e. the top and top-right edges of superblock column sbx
+// (relative to the tile) of t's sbrow; and signal that t's sbrow has
+// reconstructed its first n superblocks
+void dav1d_tile_task_wait_sb(const Dav1dTileContext *t, int sbx);
+void dav1d_tile_task_signal_sb(const Dav1dTileContext *t, int n);
+// wait until f's frame thread is idle, meanwhile running ready tasks of any
+// frame on the calling (application) thread, using t, unless that is NULL;
+// returns with f->frame_thread.td.lock held
+void dav1d_frame_thread_wait_idle(Dav1dFrameContext *f, Dav1dTileContext *t);
+
 #endif /* __DAV1D_SRC_THREAD_TASK_H__ */
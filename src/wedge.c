@@ -32,6 +32,7 @@
 
 #include "common/intops.h"
 
+#include "src/thread.h"
 #include "src/wedge.h"
 
 enum WedgeDirectionType {
@@ -222,8 +223,7 @@ static void fill2d_16x2(uint8_t *dst, const int w, const int h,
     }
 }
 
-void av1_init_wedge_masks(void) {
-    // This function is guaranteed to be called only once by dav1d_init
+static void init_wedge_masks(void) {
 
     enum WedgeMasterLineType {
         WEDGE_MASTER_LINE_ODD,
@@ -321,8 +321,7 @@ static void build_nondc_ii_masks(uint8_t *const mask_v,
     }
 }
 
-void av1_init_interintra_masks(void) {
-    // This function is guaranteed to be called only once by dav1d_init
+static void init_interintra_masks(void) {
 
     memset(ii_dc_mask, 32, 32 * 32);
 #define set(a) a[II_VERT_PRED - 1], a[II_HOR_PRED - 1], a[II_SMOOTH_PRED - 1]
@@ -337,3 +336,13 @@ void av1_init_interintra_masks(void) {
     build_nondc_ii_masks(set(ii_nondc_mask_4x4),    4,  4, 8);
 #undef set
 }
+
+static void init_masks(void) {
+    init_wedge_masks();
+    init_interintra_masks();
+}
+
+void av1_init_wedge_masks(void) {
+    static pthread_once_t initted = PTHREAD_ONCE_INIT;
+    pthread_once(&initted, init_masks);
+}
@@ -30,11 +30,12 @@
 
 #include "src/levels.h"
 
+// Builds both the wedge and the inter-intra masks on the first call; only
+// inter frames can use them.
 void av1_init_wedge_masks(void);
 extern const uint8_t *wedge_masks[N_BS_SIZES][3 /* 444/luma, 422, 420 */]
                                  [2 /* sign */][16 /* wedge_idx */];
 
-void av1_init_interintra_masks(void);
 extern const uint8_t *const ii_masks[N_BS_SIZES][3 /* 444/luma, 422, 420 */]
                                     [N_INTER_INTRA_PRED_MODES];
 
@@ -36,46 +36,35 @@
 #include "config.h"
 #include "src/thread.h"
 
-typedef struct dav1d_win32_thread_t {
-    HANDLE h;
-    void* param;
-    void*(*proc)(void*);
-    void* res;
-} dav1d_win32_thread_t;
-
 static unsigned __stdcall dav1d_thread_entrypoint(void* data) {
-    dav1d_win32_thread_t* t = data;
-    t->res = t->proc(t->param);
+    pthread_t* t = data;
+    t->arg = t->proc(t->arg);
     return 0;
 }
 
 int dav1d_pthread_create(pthread_t* thread, const pthread_attr_t* attr,
                          void*(*proc)(void*), void* param)
 {
-    dav1d_win32_thread_t* th = *thread = malloc(sizeof(*th));
     (void)attr;
-    if (th == NULL)
-        return ENOMEM;
-    th->proc = proc;
-    th->param = param;
-    uintptr_t h = _beginthreadex(NULL, 0, dav1d_thread_entrypoint, th, 0, NULL);
+    thread->proc = proc;
+    thread->arg = param;
+    uintptr_t h = _beginthreadex(NULL, 0, dav1d_thread_entrypoint, thread, 0, NULL);
     if ( h == 0 ) {
-        int err = errno;
-        free(th);
-        *thread = NULL;
-        return err;
+        thread->h = NULL;
+        return errno;
     }
-    th->h = (HANDLE)h;
+    thread->h = (HANDLE)h;
     return 0;
 }
 
-void dav1d_pthread_join(pthread_t thread, void** res) {
-    dav1d_win32_thread_t* th = thread;
-    WaitForSingleObject(th->h, INFINITE);
+int dav1d_pthread_join(pthread_t* thread, void** res) {
+    if (WaitForSingleObject(thread->h, INFINITE) != WAIT_OBJECT_0)
+        return EINVAL;
 
     if (res != NULL)
-        *res = th->res;
-    free(th);
+        *res = thread->arg;
+    CloseHandle(thread->h);
+    return 0;
 }
 
 int dav1d_pthread_once(pthread_once_t *once_control,
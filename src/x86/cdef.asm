@@ -0,0 +1,513 @@
+; Copyright © 2018, VideoLAN and dav1d authors
+; Copyright © 2018, Two Orioles, LLC
+; All rights reserved.
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice, this
+;    list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+; ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+; WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+; DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+; ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+; (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+; ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+; (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+; SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+%include "config.asm"
+%include "ext/x86/x86inc.asm"
+
+%if ARCH_X86_64
+
+SECTION_RODATA 32
+
+pw_8:          times 16 dw 8
+pw_128:        times 16 dw 128
+pw_0x8000:     times 16 dw 0x8000
+div_even:      dd 840, 420, 280, 210, 168, 140, 120, 105
+div_odd:       dd 420, 210, 140, 105, 105, 105, 105, 105
+shuf_even:     db 12, 13, 10, 11,  8,  9,  6,  7,  4,  5,  2,  3,  0,  1, -1, -1
+shuf_odd:      db  4,  5,  2,  3,  0,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+pri_taps:      dw 4, 2, 3, 3
+
+; cdef_directions4/8 from cdef.c, in units of words of the padded buffer
+; used below, with the 8 directions repeated so that dir+2 and dir+6 can
+; be looked up without wrapping
+%macro CDEF_DIRECTIONS 1 ; stride
+    db -1 * %1 + 1, -2 * %1 + 2
+    db  0 * %1 + 1, -1 * %1 + 2
+    db  0 * %1 + 1,  0 * %1 + 2
+    db  0 * %1 + 1,  1 * %1 + 2
+    db  1 * %1 + 1,  2 * %1 + 2
+    db  1 * %1 + 0,  2 * %1 + 1
+    db  1 * %1 + 0,  2 * %1 + 0
+    db  1 * %1 + 0,  2 * %1 - 1
+%endmacro
+
+cdef_dirs4:    CDEF_DIRECTIONS 8
+               CDEF_DIRECTIONS 8
+cdef_dirs8:    CDEF_DIRECTIONS 16
+               CDEF_DIRECTIONS 16
+
+%define HAVE_LEFT   1
+%define HAVE_RIGHT  2
+%define HAVE_TOP    4
+%define HAVE_BOTTOM 8
+
+SECTION .text
+
+; The filters first copy the block and its 2-pixel border into a buffer of
+; words on the stack, laid out like the tmp buffer of the C code (rows of
+; 16 words for 8-wide blocks, 8 words for 4-wide ones). Unavailable border
+; pixels are set to 0x8000, which is ignored by both the signed max and the
+; unsigned min and is constrained to 0, so no further edge handling is
+; needed. Two rows are filtered at a time, in the two lanes of a ymm for
+; 8-wide blocks and in the two halves of an xmm for 4-wide ones.
+
+%macro CDEF_LOAD_ROW 3 ; w, row, src
+%if %1 == 8
+    pmovzxbw            xm4, [%3]
+    movu [rsp+(%2+2)*32+4], xm4
+%else
+    movd                xm4, [%3]
+    pmovzxbw            xm4, xm4
+    movq [rsp+(%2+2)*16+4], xm4
+%endif
+%endmacro
+
+%macro CDEF_LOAD_LEFT 3 ; w, row, src
+    movd                xm4, [%3-2]
+    pmovzxbw            xm4, xm4
+    movq [rsp+(%2+2)*%1*4], xm4
+%endmacro
+
+; the 2 pre-filter pixels left of body rows come from the left array, as
+; the frame may already hold filtered pixels there
+%macro CDEF_LOAD_LEFT_ARR 2 ; w, row
+    pinsrw              xm4, [leftq+%2*2], 0
+    pmovzxbw            xm4, xm4
+    movd [rsp+(%2+2)*%1*4], xm4
+%endmacro
+
+%macro CDEF_LOAD_RIGHT 3 ; w, row, src
+    movd                xm4, [%3+%1-2]
+    pmovzxbw            xm4, xm4
+    movq [rsp+(%2+2)*%1*4+%1*2], xm4
+%endmacro
+
+%macro CDEF_BODY_ROWS 3 ; load macro, w, h
+    %1                   %2, 0, dstq
+    %1                   %2, 1, dstq+strideq
+    %1                   %2, 2, dstq+strideq*2
+    %1                   %2, 3, dstq+stride3q
+%if %3 == 8
+    %1                   %2, 4, ptrq
+    %1                   %2, 5, ptrq+strideq
+    %1                   %2, 6, ptrq+strideq*2
+    %1                   %2, 7, ptrq+stride3q
+%endif
+%endmacro
+
+%macro CDEF_LOAD_TAP 4 ; w, dst, row, off
+%if %1 == 8
+    movu               xm%2, [rsp+(%3+2)*32+4+%4*2]
+    vinserti128         m%2, [rsp+(%3+3)*32+4+%4*2], 1
+%else
+    movq               xm%2, [rsp+(%3+2)*16+4+%4*2]
+    movhps             xm%2, [rsp+(%3+3)*16+4+%4*2]
+%endif
+%endmacro
+
+; loads the tap at the given offset, updates min/max in m2/m3 and
+; replaces it with constrain(tap - px, threshold, shift)
+%macro CDEF_TAP 6 ; w, dst, row, off, threshold, shift
+    CDEF_LOAD_TAP        %1, %2, %3, %4
+    pminuw               m2, m%2
+    pmaxsw               m3, m%2
+    psubw               m%2, m0
+    pabsw                m5, m%2
+    psrlw               m15, m5, xm%6
+    psubusw             m15, m%5, m15
+    pminuw               m5, m15
+    psignw              m%2, m5, m%2
+%endmacro
+
+%macro CDEF_FILTER_ROWS 2 ; w, row
+    CDEF_LOAD_TAP        %1, 0, %2, 0
+    mova                 m2, m0
+    mova                 m3, m0
+    ; primary taps
+    CDEF_TAP             %1, 6, %2, p0q,  8, 9
+    CDEF_TAP             %1, 7, %2, p0nq, 8, 9
+    paddw                m6, m7
+    pmullw               m1, m6, m10
+    CDEF_TAP             %1, 6, %2, p1q,  8, 9
+    CDEF_TAP             %1, 7, %2, p1nq, 8, 9
+    paddw                m6, m7
+    pmullw               m6, m11
+    paddw                m1, m6
+    ; secondary taps
+    CDEF_TAP             %1, 6, %2, s0aq,  12, 13
+    CDEF_TAP             %1, 7, %2, s0anq, 12, 13
+    paddw                m6, m7
+    CDEF_TAP             %1, 7, %2, s0bq,  12, 13
+    paddw                m6, m7
+    CDEF_TAP             %1, 7, %2, s0bnq, 12, 13
+    paddw                m6, m7
+    paddw                m6, m6
+    paddw                m1, m6
+    CDEF_TAP             %1, 6, %2, s1aq,  12, 13
+    CDEF_TAP             %1, 7, %2, s1anq, 12, 13
+    paddw                m6, m7
+    CDEF_TAP             %1, 7, %2, s1bq,  12, 13
+    paddw                m6, m7
+    CDEF_TAP             %1, 7, %2, s1bnq, 12, 13
+    paddw                m6, m7
+    paddw                m1, m6
+    ; px + ((8 + sum - (sum < 0)) >> 4), clipped to [min, max]
+    psraw                m6, m1, 15
+    paddw                m1, m6
+    paddw                m1, m14
+    psraw                m1, 4
+    paddw                m0, m1
+    pmaxsw               m0, m2
+    pminsw               m0, m3
+%if %1 == 8
+    vextracti128        xm1, m0, 1
+    packuswb            xm0, xm1
+    movq             [dstq], xm0
+    movhps   [dstq+strideq], xm0
+%else
+    packuswb            xm0, xm0
+    movd             [dstq], xm0
+    pextrd   [dstq+strideq], xm0, 1
+%endif
+    lea                dstq, [dstq+strideq*2]
+%endmacro
+
+%macro CDEF_FILTER 2 ; w, h
+%if %1 == 8
+cglobal cdef_filter_%1x%2, 9, 15, 16, -(%2+4)*32, dst, stride, left, top, \
+                                                   pri, sec, dir, damping, \
+                                                   edges, stride3, ptr, t0, t1
+%else
+cglobal cdef_filter_%1x%2, 9, 15, 16, (%2+4)*16, dst, stride, left, top, \
+                                                 pri, sec, dir, damping, \
+                                                 edges, stride3, ptr, t0, t1
+%endif
+    mova                m15, [pw_0x8000]
+%assign cdef_off 0
+%rep (%2+4)*%1*4/mmsize
+    movu   [rsp+cdef_off], m15
+%assign cdef_off cdef_off+mmsize
+%endrep
+    test             edgesd, HAVE_TOP
+    jz .top_done
+    mov                 t0q, [topq+8*0]
+    mov                 t1q, [topq+8*1]
+    CDEF_LOAD_ROW        %1, -2, t0q
+    CDEF_LOAD_ROW        %1, -1, t1q
+    test             edgesd, HAVE_LEFT
+    jz .top_no_left
+    CDEF_LOAD_LEFT       %1, -2, t0q
+    CDEF_LOAD_LEFT       %1, -1, t1q
+.top_no_left:
+    test             edgesd, HAVE_RIGHT
+    jz .top_done
+    CDEF_LOAD_RIGHT      %1, -2, t0q
+    CDEF_LOAD_RIGHT      %1, -1, t1q
+.top_done:
+    lea            stride3q, [strideq*3]
+    lea                ptrq, [dstq+strideq*4]
+    CDEF_BODY_ROWS CDEF_LOAD_ROW, %1, %2
+    test             edgesd, HAVE_LEFT
+    jz .body_no_left
+%assign cdef_y 0
+%rep %2
+    CDEF_LOAD_LEFT_ARR   %1, cdef_y
+%assign cdef_y cdef_y+1
+%endrep
+.body_no_left:
+    test             edgesd, HAVE_RIGHT
+    jz .body_no_right
+    CDEF_BODY_ROWS CDEF_LOAD_RIGHT, %1, %2
+.body_no_right:
+    test             edgesd, HAVE_BOTTOM
+    jz .bottom_done
+%if %2 == 8
+    lea                ptrq, [ptrq+strideq*4]
+%endif
+    CDEF_LOAD_ROW        %1, %2+0, ptrq
+    CDEF_LOAD_ROW        %1, %2+1, ptrq+strideq
+    test             edgesd, HAVE_LEFT
+    jz .bottom_no_left
+    CDEF_LOAD_LEFT       %1, %2+0, ptrq
+    CDEF_LOAD_LEFT       %1, %2+1, ptrq+strideq
+.bottom_no_left:
+    test             edgesd, HAVE_RIGHT
+    jz .bottom_done
+    CDEF_LOAD_RIGHT      %1, %2+0, ptrq
+    CDEF_LOAD_RIGHT      %1, %2+1, ptrq+strideq
+.bottom_done:
+
+    ; thresholds, damping shifts and primary tap weights
+    movd                xm8, prid
+    vpbroadcastw         m8, xm8
+    movd               xm12, secd
+    vpbroadcastw        m12, xm12
+    xor                 t1d, t1d
+    bsr                 t0d, prid
+    mov             stride3d, dampingd
+    sub             stride3d, t0d
+    cmovs           stride3d, t1d
+    movd                xm9, stride3d
+    bsr                 t0d, secd
+    mov             stride3d, dampingd
+    sub             stride3d, t0d
+    cmovs           stride3d, t1d
+    movd               xm13, stride3d
+    and                prid, 1
+    lea                 t0q, [pri_taps]
+    vpbroadcastw        m10, [t0q+priq*4+0]
+    vpbroadcastw        m11, [t0q+priq*4+2]
+    mova                m14, [pw_8]
+
+    ; tap offsets for dir, dir+2 and dir+6
+    DEFINE_ARGS dst, stride, p0, p0n, p1, p1n, s0a, s0an, \
+                s0b, s0bn, s1a, s1an, s1b, s1bn, tbl
+%if %1 == 8
+    lea                tblq, [cdef_dirs8]
+%else
+    lea                tblq, [cdef_dirs4]
+%endif
+    lea                tblq, [tblq+s0aq*2] ; s0a still holds dir
+    movsx               p0q, byte [tblq+ 0]
+    movsx               p1q, byte [tblq+ 1]
+    movsx              s0aq, byte [tblq+ 4]
+    movsx              s1aq, byte [tblq+ 5]
+    movsx              s0bq, byte [tblq+12]
+    movsx              s1bq, byte [tblq+13]
+    mov                p0nq, p0q
+    neg                p0nq
+    mov                p1nq, p1q
+    neg                p1nq
+    mov               s0anq, s0aq
+    neg               s0anq
+    mov               s1anq, s1aq
+    neg               s1anq
+    mov               s0bnq, s0bq
+    neg               s0bnq
+    mov               s1bnq, s1bq
+    neg               s1bnq
+
+%assign cdef_y 0
+%rep %2/2
+    CDEF_FILTER_ROWS     %1, cdef_y
+%assign cdef_y cdef_y+2
+%endrep
+    RET
+%endmacro
+
+INIT_YMM avx2
+CDEF_FILTER 8, 8
+INIT_XMM avx2
+CDEF_FILTER 4, 8
+CDEF_FILTER 4, 4
+
+; The direction search builds the partial sums of each direction in pairs
+; of xmm registers (lines 0-7 and 8-15) by shifting the rows, or sums of
+; pairs of rows or pixels, into place. Partial sums that are weighted the
+; same are interleaved, so that pmaddwd squares and adds them in one go.
+
+%macro SHIFT_SUM4 7 ; lo, hi, tmp, src shifted by 0, 1, 2, 3 words
+    pslldq               %1, %5, 2
+    paddw                %1, %4
+    pslldq               %3, %6, 4
+    paddw                %1, %3
+    pslldq               %3, %7, 6
+    paddw                %1, %3
+    psrldq               %2, %5, 14
+    psrldq               %3, %6, 12
+    paddw                %2, %3
+    psrldq               %3, %7, 10
+    paddw                %2, %3
+%endmacro
+
+%macro COST 5 ; lo/dst, hi, tmp, shuf, div
+    pshufb               %2, [%4]
+    punpckhwd            %3, %1, %2
+    punpcklwd            %1, %2
+    pmaddwd              %3, %3
+    pmaddwd              %1, %1
+    pmulld               %3, [%5+16]
+    pmulld               %1, [%5+ 0]
+    paddd                %1, %3
+%endmacro
+
+INIT_XMM avx2
+cglobal cdef_dir, 3, 7, 16, 16*8, src, stride, var, stride3, t0, t1, best
+    lea            stride3q, [strideq*3]
+    pmovzxbw             m0, [srcq+strideq*0]
+    pmovzxbw             m1, [srcq+strideq*1]
+    pmovzxbw             m2, [srcq+strideq*2]
+    pmovzxbw             m3, [srcq+stride3q]
+    lea                srcq, [srcq+strideq*4]
+    pmovzxbw             m4, [srcq+strideq*0]
+    pmovzxbw             m5, [srcq+strideq*1]
+    pmovzxbw             m6, [srcq+strideq*2]
+    pmovzxbw             m7, [srcq+stride3q]
+    mova                 m8, [pw_128]
+    psubw                m0, m8
+    psubw                m1, m8
+    psubw                m2, m8
+    psubw                m3, m8
+    psubw                m4, m8
+    psubw                m5, m8
+    psubw                m6, m8
+    psubw                m7, m8
+
+    ; directions 7 and 5 sum pairs of rows
+    paddw                m8, m0, m1
+    paddw                m9, m2, m3
+    paddw               m10, m4, m5
+    paddw               m11, m6, m7
+    SHIFT_SUM4          m12, m13, m14, m8, m9, m10, m11
+    COST                m12, m13, m14, shuf_odd, div_odd
+    mova        [rsp+16*7], m12
+    SHIFT_SUM4          m12, m13, m14, m11, m10, m9, m8
+    COST                m12, m13, m14, shuf_odd, div_odd
+    mova        [rsp+16*5], m12
+    ; direction 6: column sums
+    paddw                m8, m9
+    paddw               m10, m11
+    paddw                m8, m10
+    pmaddwd              m8, m8
+    pmulld               m8, [div_odd+16]
+    mova        [rsp+16*6], m8
+
+    ; directions 1 and 3 sum pairs of pixels, 2: row sums
+    phaddw               m8, m0, m4
+    phaddw               m9, m1, m5
+    phaddw              m10, m2, m6
+    phaddw              m11, m3, m7
+    SHIFT_SUM4          m12, m13, m14, m8, m9, m10, m11
+    COST                m12, m13, m14, shuf_odd, div_odd
+    mova        [rsp+16*1], m12
+    pshufd               m8, m8, q1032
+    pshufd               m9, m9, q1032
+    pshufd              m10, m10, q1032
+    pshufd              m11, m11, q1032
+    SHIFT_SUM4          m12, m13, m14, m11, m10, m9, m8
+    COST                m12, m13, m14, shuf_odd, div_odd
+    mova        [rsp+16*3], m12
+    phaddw               m8, m9
+    phaddw              m10, m11
+    phaddw               m8, m10
+    pmaddwd              m8, m8
+    pmulld               m8, [div_odd+16]
+    mova        [rsp+16*2], m8
+
+    ; directions 0 and 4 (mirrored, which doesn't change its cost)
+    ; shift each row by one more or less than the previous one
+    pslldq              m10, m1, 2
+    paddw                m8, m0, m10
+    psrldq               m9, m1, 14
+    pslldq              m10, m2, 4
+    paddw                m8, m10
+    psrldq              m10, m2, 12
+    paddw                m9, m10
+    pslldq              m10, m3, 6
+    paddw                m8, m10
+    psrldq              m10, m3, 10
+    paddw                m9, m10
+    pslldq              m10, m4, 8
+    paddw                m8, m10
+    psrldq              m10, m4, 8
+    paddw                m9, m10
+    pslldq              m10, m5, 10
+    paddw                m8, m10
+    psrldq              m10, m5, 6
+    paddw                m9, m10
+    pslldq              m10, m6, 12
+    paddw                m8, m10
+    psrldq              m10, m6, 4
+    paddw                m9, m10
+    pslldq              m10, m7, 14
+    paddw                m8, m10
+    psrldq              m10, m7, 2
+    paddw                m9, m10
+    COST                 m8, m9, m10, shuf_even, div_even
+    mova        [rsp+16*0], m8
+
+    pslldq              m10, m6, 2
+    paddw               m11, m7, m10
+    psrldq              m12, m6, 14
+    pslldq              m10, m5, 4
+    paddw               m11, m10
+    psrldq              m10, m5, 12
+    paddw               m12, m10
+    pslldq              m10, m4, 6
+    paddw               m11, m10
+    psrldq              m10, m4, 10
+    paddw               m12, m10
+    pslldq              m10, m3, 8
+    paddw               m11, m10
+    psrldq              m10, m3, 8
+    paddw               m12, m10
+    pslldq              m10, m2, 10
+    paddw               m11, m10
+    psrldq              m10, m2, 6
+    paddw               m12, m10
+    pslldq              m10, m1, 12
+    paddw               m11, m10
+    psrldq              m10, m1, 4
+    paddw               m12, m10
+    pslldq              m10, m0, 14
+    paddw               m11, m10
+    psrldq              m10, m0, 2
+    paddw               m12, m10
+    COST                m11, m12, m10, shuf_even, div_even
+    mova        [rsp+16*4], m11
+
+    ; horizontal sums, then pick the first direction with the highest cost
+    mova                 m0, [rsp+16*0]
+    phaddd               m0, [rsp+16*1]
+    mova                 m1, [rsp+16*2]
+    phaddd               m1, [rsp+16*3]
+    mova                 m2, [rsp+16*4]
+    phaddd               m2, [rsp+16*5]
+    mova                 m3, [rsp+16*6]
+    phaddd               m3, [rsp+16*7]
+    phaddd               m0, m1
+    phaddd               m2, m3
+    pmaxsd               m1, m0, m2
+    pshufd               m3, m1, q1032
+    pmaxsd               m1, m3
+    pshufd               m3, m1, q2301
+    pmaxsd               m1, m3
+    pcmpeqd              m3, m0, m1
+    pcmpeqd              m1, m2
+    packssdw             m3, m1
+    packsswb             m3, m3
+    pmovmskb          bestd, m3
+    bsf               bestd, bestd
+    mova        [rsp+16*0], m0
+    mova        [rsp+16*1], m2
+    mov                 t0d, [rsp+bestq*4]
+    xor               bestd, 4
+    sub                 t0d, [rsp+bestq*4]
+    xor               bestd, 4
+    shr                 t0d, 10
+    mov              [varq], t0d
+    RET
+
+%endif ; ARCH_X86_64
@@ -0,0 +1,1311 @@
+; Copyright © 2018, VideoLAN and dav1d authors
+; Copyright © 2018, Two Orioles, LLC
+; All rights reserved.
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice, this
+;    list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+; ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+; WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+; DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+; ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+; (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+; ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+; (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+; SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+%include "config.asm"
+%include "ext/x86/x86inc.asm"
+
+%if ARCH_X86_64
+
+SECTION_RODATA 32
+
+paeth_shuf4:    db  7,  7,  7,  7,  6,  6,  6,  6,  5,  5,  5,  5,  4,  4,  4,  4
+                db  3,  3,  3,  3,  2,  2,  2,  2,  1,  1,  1,  1,  0,  0,  0,  0
+paeth_shuf8:    db  3,  3,  3,  3,  3,  3,  3,  3,  2,  2,  2,  2,  2,  2,  2,  2
+                db  1,  1,  1,  1,  1,  1,  1,  1,  0,  0,  0,  0,  0,  0,  0,  0
+paeth_shuf16:   times 16 db 1
+                times 16 db 0
+smooth_v_shuf4: db  0,  1,  0,  1,  0,  1,  0,  1,  2,  3,  2,  3,  2,  3,  2,  3
+                db  4,  5,  4,  5,  4,  5,  4,  5,  6,  7,  6,  7,  6,  7,  6,  7
+smooth_v_shuf8: times 8 db 0, 1
+                times 8 db 2, 3
+smooth_h_shuf4: db  3,128,  3,128,  3,128,  3,128,  2,128,  2,128,  2,128,  2,128
+                db  1,128,  1,128,  1,128,  1,128,  0,128,  0,128,  0,128,  0,128
+smooth_h_shuf8: times 8 db 1, 128
+                times 8 db 0, 128
+smooth_perm:    dd  0,  4,  1,  5,  2,  6,  3,  7
+
+; sm_weight_arrays[] from ipred.c, pre-scaled by 128 for use with pmulhrsw
+; (rounding is exact since (x * (w << 7) * 2 + (1 << 15)) >> 16 equals
+; (x * w + 128) >> 8)
+%macro SMOOTH_WEIGHT_TABLE 1-*
+    %rep %0
+        dw %1*128
+        %rotate 1
+    %endrep
+%endmacro
+
+smooth_weights: SMOOTH_WEIGHT_TABLE         \
+      0,   0, 255, 128, 255, 149,  85,  64, \
+    255, 197, 146, 105,  73,  50,  37,  32, \
+    255, 225, 196, 170, 145, 123, 102,  84, \
+     68,  54,  43,  33,  26,  20,  17,  16, \
+    255, 240, 225, 210, 196, 182, 169, 157, \
+    145, 133, 122, 111, 101,  92,  83,  74, \
+     66,  59,  52,  45,  39,  34,  29,  25, \
+     21,  17,  14,  12,  10,   9,   8,   8, \
+    255, 248, 240, 233, 225, 218, 210, 203, \
+    196, 189, 182, 176, 169, 163, 156, 150, \
+    144, 138, 133, 127, 121, 116, 111, 106, \
+    101,  96,  91,  86,  82,  77,  73,  69, \
+     65,  61,  57,  54,  50,  47,  44,  41, \
+     38,  35,  32,  29,  27,  25,  22,  20, \
+     18,  16,  15,  13,  12,  10,   9,   8, \
+      7,   6,   6,   5,   5,   4,   4,   4
+
+pb_1:          times 4 db 1
+pb_128:        times 4 db 128
+pb_row0_words: db  1,128,  1,128
+pb_row1_words: db  0,128,  0,128
+pw_2048:       times 2 dw 2048
+; the filter_edge kernels of strengths 1 to 3, as the weights of
+; (in[i - 2] + in[i + 2]), (in[i - 1] + in[i + 1]) and in[i]
+filter_edge_kernels: dw 0, 4, 8,  0, 5, 6,  2, 4, 4
+
+%macro JMP_TABLE 3-*
+    %xdefine %1_%2_table (%%table - 2*4)
+    %xdefine %%base mangle(private_prefix %+ _%1_%2)
+    %%table:
+    %rep %0 - 2
+        dd %%base %+ .w%3 - (%%table - 2*4)
+        %rotate 1
+    %endrep
+%endmacro
+
+JMP_TABLE pal_pred, avx2, 4, 8, 16, 32, 64
+
+%define m(x) mangle(private_prefix %+ _ %+ x %+ SUFFIX)
+
+SECTION .text
+
+; The intra prediction function pointers are specialized per block size, while
+; most of the SIMD code only depends on the block width. Each size gets a small
+; entry point that loads the address of the width-specific code and the block
+; height into w and h, and then jumps into the shared function body.
+%macro IPRED_FN 3 ; type, w, h
+cglobal ipred_%1_%2x%3, 3, 7, 0, dst, stride, tl, w, h
+    lea                  wq, [m(ipred_%1).w%2]
+    mov                  hd, %3
+    jmp m(ipred_%1)
+%endmacro
+
+%macro IPRED_FNS 1-2 IPRED_FN ; type, macro
+    %2 %1,  4,  4
+    %2 %1,  4,  8
+    %2 %1,  4, 16
+    %2 %1,  8,  4
+    %2 %1,  8,  8
+    %2 %1,  8, 16
+    %2 %1,  8, 32
+    %2 %1, 16,  4
+    %2 %1, 16,  8
+    %2 %1, 16, 16
+    %2 %1, 16, 32
+    %2 %1, 16, 64
+    %2 %1, 32,  8
+    %2 %1, 32, 16
+    %2 %1, 32, 32
+    %2 %1, 32, 64
+    %2 %1, 64, 16
+    %2 %1, 64, 32
+    %2 %1, 64, 64
+%endmacro
+
+INIT_YMM avx2
+; Stores the row in m0 (m0-m1 for w64) into every row of the block. Only
+; entered by jumping from the dc and v entry points below.
+cglobal ipred_splat, 3, 7, 4, dst, stride, tl, w, h, stride3
+.w4:
+    lea            stride3q, [strideq*3]
+.w4_loop:
+    movd   [dstq+strideq*0], xm0
+    movd   [dstq+strideq*1], xm0
+    movd   [dstq+strideq*2], xm0
+    movd   [dstq+stride3q ], xm0
+    lea                dstq, [dstq+strideq*4]
+    sub                  hd, 4
+    jg .w4_loop
+    RET
+.w8:
+    lea            stride3q, [strideq*3]
+.w8_loop:
+    movq   [dstq+strideq*0], xm0
+    movq   [dstq+strideq*1], xm0
+    movq   [dstq+strideq*2], xm0
+    movq   [dstq+stride3q ], xm0
+    lea                dstq, [dstq+strideq*4]
+    sub                  hd, 4
+    jg .w8_loop
+    RET
+.w16:
+    lea            stride3q, [strideq*3]
+.w16_loop:
+    mova   [dstq+strideq*0], xm0
+    mova   [dstq+strideq*1], xm0
+    mova   [dstq+strideq*2], xm0
+    mova   [dstq+stride3q ], xm0
+    lea                dstq, [dstq+strideq*4]
+    sub                  hd, 4
+    jg .w16_loop
+    RET
+.w32:
+    lea            stride3q, [strideq*3]
+.w32_loop:
+    mova   [dstq+strideq*0], m0
+    mova   [dstq+strideq*1], m0
+    mova   [dstq+strideq*2], m0
+    mova   [dstq+stride3q ], m0
+    lea                dstq, [dstq+strideq*4]
+    sub                  hd, 4
+    jg .w32_loop
+    RET
+.w64:
+    lea            stride3q, [strideq*3]
+.w64_loop:
+    mova [dstq+strideq*0+32*0], m0
+    mova [dstq+strideq*0+32*1], m1
+    mova [dstq+strideq*1+32*0], m0
+    mova [dstq+strideq*1+32*1], m1
+    mova [dstq+strideq*2+32*0], m0
+    mova [dstq+strideq*2+32*1], m1
+    mova [dstq+stride3q +32*0], m0
+    mova [dstq+stride3q +32*1], m1
+    lea                dstq, [dstq+strideq*4]
+    sub                  hd, 4
+    jg .w64_loop
+    RET
+
+; sum of n pixels, the result ends up in the low word of xm%1
+%macro DC_SUM 4 ; dst, tmp, zero, n
+    %if %4 <= 8
+    psadbw              xm%1, xm%3
+    %elif %4 == 16
+    psadbw              xm%1, xm%3
+    punpckhqdq          xm%2, xm%1, xm%1
+    paddw               xm%1, xm%2
+    %else
+    %if %4 == 64
+    psadbw               m%2, m%3
+    %endif
+    psadbw               m%1, m%3
+    %if %4 == 64
+    paddw                m%1, m%2
+    %endif
+    vextracti128        xm%2, m%1, 1
+    paddw               xm%1, xm%2
+    punpckhqdq          xm%2, xm%1, xm%1
+    paddw               xm%1, xm%2
+    %endif
+%endmacro
+
+%macro DC_LOAD 3 ; dst, src, n
+    %if %3 == 4
+    movd                xm%1, [%2]
+    %elif %3 == 8
+    movq                xm%1, [%2]
+    %elif %3 == 16
+    movu                xm%1, [%2]
+    %elif %3 == 32
+    movu                 m%1, [%2]
+    %endif
+%endmacro
+
+; dc_shift = log2(n)
+%macro DC_SHIFT 1 ; n
+    %assign dc_shift 2 + (%1 >= 8) + (%1 >= 16) + (%1 >= 32) + (%1 >= 64) + (%1 >= 128)
+%endmacro
+
+; broadcast the dc in wd to every byte of m0 (and m1 for w64) and splat it
+%macro DC_SPLAT 2 ; w, h
+    movd                xm0, wd
+    vpbroadcastb         m0, xm0
+%if %1 == 64
+    mova                 m1, m0
+%endif
+    mov                  hd, %2
+    jmp m(ipred_splat).w%1
+%endmacro
+
+%macro DC_LOAD_SUM 3 ; dst, src, n
+%if %3 == 64
+    movu                 m%1, [%2]
+    movu                 m1, [%2+32]
+    DC_SUM               %1, 1, 2, %3
+%else
+    DC_LOAD              %1, %2, %3
+    DC_SUM               %1, 1, 2, %3
+%endif
+%endmacro
+
+%macro IPRED_DC_FN 3 ; unused, w, h
+cglobal ipred_dc_%2x%3, 3, 7, 4, dst, stride, tl, w, h, stride3
+    pxor                xm2, xm2
+    DC_LOAD_SUM          0, tlq+1, %2
+    DC_LOAD_SUM          3, tlq-%3, %3
+    paddw               xm0, xm3
+    movd                 wd, xm0
+    add                  wd, (%2 + %3) >> 1
+%if %2 == %3
+    DC_SHIFT             %2 + %3
+    shr                  wd, dc_shift
+%else
+    ; dc = (sum >> log2(min(w, h))) * (1 / (1 + max(w, h) / min(w, h)))
+  %if %2 < %3
+    DC_SHIFT             %2
+    %assign dc_ratio %3 / %2
+  %else
+    DC_SHIFT             %3
+    %assign dc_ratio %2 / %3
+  %endif
+    shr                  wd, dc_shift
+  %if dc_ratio == 2
+    imul                 wd, 0x5556
+  %else
+    imul                 wd, 0x3334
+  %endif
+    shr                  wd, 16
+%endif
+    DC_SPLAT             %2, %3
+%endmacro
+
+%macro IPRED_DC_TOP_FN 3 ; unused, w, h
+cglobal ipred_dc_top_%2x%3, 3, 7, 4, dst, stride, tl, w, h, stride3
+    pxor                xm2, xm2
+    DC_LOAD_SUM          0, tlq+1, %2
+    movd                 wd, xm0
+    add                  wd, %2 >> 1
+    DC_SHIFT             %2
+    shr                  wd, dc_shift
+    DC_SPLAT             %2, %3
+%endmacro
+
+%macro IPRED_DC_LEFT_FN 3 ; unused, w, h
+cglobal ipred_dc_left_%2x%3, 3, 7, 4, dst, stride, tl, w, h, stride3
+    pxor                xm2, xm2
+    DC_LOAD_SUM          0, tlq-%3, %3
+    movd                 wd, xm0
+    add                  wd, %3 >> 1
+    DC_SHIFT             %3
+    shr                  wd, dc_shift
+    DC_SPLAT             %2, %3
+%endmacro
+
+%macro IPRED_DC_128_FN 3 ; unused, w, h
+cglobal ipred_dc_128_%2x%3, 3, 7, 4, dst, stride, tl, w, h, stride3
+    vpbroadcastd         m0, [pb_128]
+%if %2 == 64
+    mova                 m1, m0
+%endif
+    mov                  hd, %3
+    jmp m(ipred_splat).w%2
+%endmacro
+
+%macro IPRED_V_FN 3 ; unused, w, h
+cglobal ipred_v_%2x%3, 3, 7, 4, dst, stride, tl, w, h, stride3
+%if %2 == 4
+    movd                xm0, [tlq+1]
+%elif %2 == 8
+    movq                xm0, [tlq+1]
+%elif %2 == 16
+    movu                xm0, [tlq+1]
+%else
+    movu                 m0, [tlq+1]
+%if %2 == 64
+    movu                 m1, [tlq+33]
+%endif
+%endif
+    mov                  hd, %3
+    jmp m(ipred_splat).w%2
+%endmacro
+
+IPRED_FNS dc,       IPRED_DC_FN
+IPRED_FNS dc_top,   IPRED_DC_TOP_FN
+IPRED_FNS dc_left,  IPRED_DC_LEFT_FN
+IPRED_FNS dc_128,   IPRED_DC_128_FN
+IPRED_FNS v,        IPRED_V_FN
+
+%macro IPRED_H 2 ; w, store_type
+    vpbroadcastb         m0, [tlq-1]
+    vpbroadcastb         m1, [tlq-2]
+    vpbroadcastb         m2, [tlq-3]
+    sub                 tlq, 4
+    vpbroadcastb         m3, [tlq+0]
+    mov%2  [dstq+strideq*0], m0
+    mov%2  [dstq+strideq*1], m1
+    mov%2  [dstq+strideq*2], m2
+    mov%2  [dstq+stride3q ], m3
+%if %1 == 64
+    mov%2  [dstq+strideq*0+32], m0
+    mov%2  [dstq+strideq*1+32], m1
+    mov%2  [dstq+strideq*2+32], m2
+    mov%2  [dstq+stride3q +32], m3
+%endif
+    lea                dstq, [dstq+strideq*4]
+    sub                  hd, 4
+    jg .w%1
+    RET
+%endmacro
+
+INIT_XMM avx2
+cglobal ipred_h, 3, 7, 4, dst, stride, tl, w, h, stride3
+    lea            stride3q, [strideq*3]
+    jmp                  wq
+.w4:
+    IPRED_H               4, d
+.w8:
+    IPRED_H               8, q
+.w16:
+    IPRED_H              16, a
+INIT_YMM avx2
+.w32:
+    IPRED_H              32, a
+.w64:
+    IPRED_H              64, a
+
+IPRED_FNS h
+
+%macro PAETH 2 ; top, ldiff
+    pavgb                m1, m%1, m3 ; Calculating tldiff normally requires
+    pxor                 m0, m%1, m3 ; 10-bit intermediates, but we can do it
+    pand                 m0, m4      ; in 8-bit with some tricks which avoids
+    psubusb              m2, m5, m1  ; having to unpack everything to 16-bit:
+    psubusb              m1, m0      ; tldiff = 2 * (max(floor_avg - tl, 0) |
+    psubusb              m1, m5      ;               max(tl - ceil_avg,  0))
+    por                  m1, m2      ;          + ((top ^ left) & 1)
+    paddusb              m1, m1
+    por                  m1, m0      ; min(tldiff, 255)
+    psubusb              m2, m5, m3
+    psubusb              m0, m3, m5
+    por                  m2, m0      ; tdiff
+    pminub               m2, m%2
+    pcmpeqb              m0, m%2, m2 ; ldiff <= tdiff
+    vpblendvb            m0, m%1, m3, m0
+    pminub               m1, m2
+    pcmpeqb              m1, m2      ; ldiff <= tldiff || tdiff <= tldiff
+    vpblendvb            m0, m5, m0, m1
+%endmacro
+
+; ldiff = abs(top - topleft), which is invariant for a given column
+%macro PAETH_LDIFF 2 ; dst, top
+    psubusb             m%1, m5, m%2
+    psubusb              m0, m%2, m5
+    por                 m%1, m0
+%endmacro
+
+INIT_YMM avx2
+cglobal ipred_paeth, 3, 7, 10, dst, stride, tl, w, h, stride3
+    vpbroadcastd         m4, [pb_1]
+    vpbroadcastb         m5, [tlq]   ; topleft
+    lea            stride3q, [strideq*3]
+    jmp                  wq
+.w4:
+    vpbroadcastd         m6, [tlq+1] ; top
+    mova                 m8, [paeth_shuf4]
+    PAETH_LDIFF           7, 6
+.w4_loop:
+    sub                 tlq, 8
+    vpbroadcastq         m3, [tlq]
+    pshufb               m3, m8      ; left
+    PAETH                 6, 7
+    vextracti128        xm1, m0, 1
+    movd   [dstq+strideq*0], xm0
+    pextrd [dstq+strideq*1], xm0, 1
+    pextrd [dstq+strideq*2], xm0, 2
+    pextrd [dstq+stride3q ], xm0, 3
+    sub                  hd, 8
+    jl .w4_ret
+    lea                dstq, [dstq+strideq*4]
+    movd   [dstq+strideq*0], xm1
+    pextrd [dstq+strideq*1], xm1, 1
+    pextrd [dstq+strideq*2], xm1, 2
+    pextrd [dstq+stride3q ], xm1, 3
+    lea                dstq, [dstq+strideq*4]
+    jg .w4_loop
+.w4_ret:
+    RET
+.w8:
+    vpbroadcastq         m6, [tlq+1]
+    mova                 m8, [paeth_shuf8]
+    PAETH_LDIFF           7, 6
+.w8_loop:
+    sub                 tlq, 4
+    vpbroadcastd         m3, [tlq]
+    pshufb               m3, m8
+    PAETH                 6, 7
+    vextracti128        xm1, m0, 1
+    movq   [dstq+strideq*0], xm0
+    movhps [dstq+strideq*1], xm0
+    movq   [dstq+strideq*2], xm1
+    movhps [dstq+stride3q ], xm1
+    lea                dstq, [dstq+strideq*4]
+    sub                  hd, 4
+    jg .w8_loop
+    RET
+.w16:
+    vbroadcasti128       m6, [tlq+1]
+    mova                 m8, [paeth_shuf16]
+    PAETH_LDIFF           7, 6
+.w16_loop:
+    sub                 tlq, 2
+    vpbroadcastw         m3, [tlq]
+    pshufb               m3, m8
+    PAETH                 6, 7
+    mova         [dstq+strideq*0], xm0
+    vextracti128 [dstq+strideq*1], m0, 1
+    lea                dstq, [dstq+strideq*2]
+    sub                  hd, 2
+    jg .w16_loop
+    RET
+.w32:
+    movu                 m6, [tlq+1]
+    PAETH_LDIFF           7, 6
+.w32_loop:
+    dec                 tlq
+    vpbroadcastb         m3, [tlq]
+    PAETH                 6, 7
+    mova             [dstq], m0
+    add                dstq, strideq
+    dec                  hd
+    jg .w32_loop
+    RET
+.w64:
+    movu                 m6, [tlq+ 1]
+    movu                 m7, [tlq+33]
+    PAETH_LDIFF           8, 6
+    PAETH_LDIFF           9, 7
+.w64_loop:
+    dec                 tlq
+    vpbroadcastb         m3, [tlq]
+    PAETH                 6, 8
+    mova        [dstq+32*0], m0
+    PAETH                 7, 9
+    mova        [dstq+32*1], m0
+    add                dstq, strideq
+    dec                  hd
+    jg .w64_loop
+    RET
+
+IPRED_FNS paeth
+
+; pred = bottom + ((top - bottom) * w_y + 128) >> 8, computed with pmulhrsw
+; using the pre-scaled weights
+cglobal ipred_smooth_v, 3, 7, 10, dst, stride, tl, w, h, weights, stride3
+    lea            weightsq, [smooth_weights]
+    mov                  r6, tlq
+    sub                  r6, hq
+    vpbroadcastb        xm5, [r6]
+    pmovzxbw             m5, xm5     ; bottom
+    lea            weightsq, [weightsq+hq*2]
+    lea            stride3q, [strideq*3]
+    jmp                  wq
+.w4:
+    vpbroadcastd        xm6, [tlq+1]
+    mova                 m4, [smooth_v_shuf4]
+    pmovzxbw             m6, xm6
+    psubw                m6, m5      ; top - bottom
+.w4_loop:
+    vpbroadcastq         m0, [weightsq]
+    add            weightsq, 8
+    pshufb               m0, m4
+    pmulhrsw             m0, m6
+    paddw                m0, m5
+    vextracti128        xm1, m0, 1
+    packuswb            xm0, xm1
+    movd   [dstq+strideq*0], xm0
+    pextrd [dstq+strideq*1], xm0, 1
+    pextrd [dstq+strideq*2], xm0, 2
+    pextrd [dstq+stride3q ], xm0, 3
+    lea                dstq, [dstq+strideq*4]
+    sub                  hd, 4
+    jg .w4_loop
+    RET
+.w8:
+    vpbroadcastq         m6, [tlq+1]
+    mova                 m4, [smooth_v_shuf8]
+    pmovzxbw             m6, xm6
+    psubw                m6, m5
+.w8_loop:
+    vpbroadcastd         m0, [weightsq]
+    add            weightsq, 4
+    pshufb               m0, m4
+    pmulhrsw             m0, m6
+    paddw                m0, m5
+    vextracti128        xm1, m0, 1
+    packuswb            xm0, xm1
+    movq   [dstq+strideq*0], xm0
+    movhps [dstq+strideq*1], xm0
+    lea                dstq, [dstq+strideq*2]
+    sub                  hd, 2
+    jg .w8_loop
+    RET
+.w16:
+    pmovzxbw             m6, [tlq+1]
+    psubw                m6, m5
+.w16_loop:
+    vpbroadcastw         m0, [weightsq+2*0]
+    vpbroadcastw         m1, [weightsq+2*1]
+    add            weightsq, 4
+    pmulhrsw             m0, m6
+    pmulhrsw             m1, m6
+    paddw                m0, m5
+    paddw                m1, m5
+    packuswb             m0, m1
+    vpermq               m0, m0, q3120
+    mova         [dstq+strideq*0], xm0
+    vextracti128 [dstq+strideq*1], m0, 1
+    lea                dstq, [dstq+strideq*2]
+    sub                  hd, 2
+    jg .w16_loop
+    RET
+.w32:
+    pmovzxbw             m6, [tlq+ 1]
+    pmovzxbw             m7, [tlq+17]
+    psubw                m6, m5
+    psubw                m7, m5
+.w32_loop:
+    vpbroadcastw         m1, [weightsq]
+    add            weightsq, 2
+    pmulhrsw             m0, m6, m1
+    pmulhrsw             m1, m7
+    paddw                m0, m5
+    paddw                m1, m5
+    packuswb             m0, m1
+    vpermq               m0, m0, q3120
+    mova             [dstq], m0
+    add                dstq, strideq
+    dec                  hd
+    jg .w32_loop
+    RET
+.w64:
+    pmovzxbw             m6, [tlq+ 1]
+    pmovzxbw             m7, [tlq+17]
+    pmovzxbw             m8, [tlq+33]
+    pmovzxbw             m9, [tlq+49]
+    psubw                m6, m5
+    psubw                m7, m5
+    psubw                m8, m5
+    psubw                m9, m5
+.w64_loop:
+    vpbroadcastw         m3, [weightsq]
+    add            weightsq, 2
+    pmulhrsw             m0, m6, m3
+    pmulhrsw             m1, m7, m3
+    paddw                m0, m5
+    paddw                m1, m5
+    packuswb             m0, m1
+    vpermq               m0, m0, q3120
+    mova        [dstq+32*0], m0
+    pmulhrsw             m0, m8, m3
+    pmulhrsw             m1, m9, m3
+    paddw                m0, m5
+    paddw                m1, m5
+    packuswb             m0, m1
+    vpermq               m0, m0, q3120
+    mova        [dstq+32*1], m0
+    add                dstq, strideq
+    dec                  hd
+    jg .w64_loop
+    RET
+
+IPRED_FNS smooth_v
+
+; pred = right + ((left - right) * w_x + 128) >> 8
+%macro SMOOTH_H_ROW 3 ; dst, left - right, w
+    pmulhrsw             m0, m%2, m6
+    pmulhrsw             m1, m%2, m7
+    paddw                m0, m5
+    paddw                m1, m5
+    packuswb             m0, m1
+    vpermq               m0, m0, q3120
+    mova   [%1+32*0], m0
+%if %3 == 64
+    pmulhrsw             m0, m%2, m8
+    pmulhrsw             m1, m%2, m9
+    paddw                m0, m5
+    paddw                m1, m5
+    packuswb             m0, m1
+    vpermq               m0, m0, q3120
+    mova   [%1+32*1], m0
+%endif
+%endmacro
+
+cglobal ipred_smooth_h, 3, 7, 12, dst, stride, tl, w, h, stride3
+    lea            stride3q, [strideq*3]
+    jmp                  wq
+.w4:
+    vpbroadcastb        xm5, [tlq+4]
+    vpbroadcastq         m6, [smooth_weights+4*2]
+    mova                 m4, [smooth_h_shuf4]
+    pmovzxbw             m5, xm5     ; right
+.w4_loop:
+    vpbroadcastd         m0, [tlq-4]
+    sub                 tlq, 4
+    pshufb               m0, m4
+    psubw                m0, m5
+    pmulhrsw             m0, m6
+    paddw                m0, m5
+    vextracti128        xm1, m0, 1
+    packuswb            xm0, xm1
+    movd   [dstq+strideq*0], xm0
+    pextrd [dstq+strideq*1], xm0, 1
+    pextrd [dstq+strideq*2], xm0, 2
+    pextrd [dstq+stride3q ], xm0, 3
+    lea                dstq, [dstq+strideq*4]
+    sub                  hd, 4
+    jg .w4_loop
+    RET
+.w8:
+    vpbroadcastb        xm5, [tlq+8]
+    vbroadcasti128       m6, [smooth_weights+8*2]
+    mova                 m4, [smooth_h_shuf8]
+    pmovzxbw             m5, xm5
+.w8_loop:
+    vpbroadcastw         m0, [tlq-2]
+    sub                 tlq, 2
+    pshufb               m0, m4
+    psubw                m0, m5
+    pmulhrsw             m0, m6
+    paddw                m0, m5
+    vextracti128        xm1, m0, 1
+    packuswb            xm0, xm1
+    movq   [dstq+strideq*0], xm0
+    movhps [dstq+strideq*1], xm0
+    lea                dstq, [dstq+strideq*2]
+    sub                  hd, 2
+    jg .w8_loop
+    RET
+.w16:
+    vpbroadcastb        xm5, [tlq+16]
+    movu                 m6, [smooth_weights+16*2]
+    vpbroadcastd        m10, [pb_row0_words]
+    vpbroadcastd        m11, [pb_row1_words]
+    pmovzxbw             m5, xm5
+.w16_loop:
+    vpbroadcastw         m1, [tlq-2]
+    sub                 tlq, 2
+    pshufb               m0, m1, m10
+    pshufb               m1, m11
+    psubw                m0, m5
+    psubw                m1, m5
+    pmulhrsw             m0, m6
+    pmulhrsw             m1, m6
+    paddw                m0, m5
+    paddw                m1, m5
+    packuswb             m0, m1
+    vpermq               m0, m0, q3120
+    mova         [dstq+strideq*0], xm0
+    vextracti128 [dstq+strideq*1], m0, 1
+    lea                dstq, [dstq+strideq*2]
+    sub                  hd, 2
+    jg .w16_loop
+    RET
+.w32:
+    vpbroadcastb        xm5, [tlq+32]
+    movu                 m6, [smooth_weights+32*2+32*0]
+    movu                 m7, [smooth_weights+32*2+32*1]
+    vpbroadcastd        m10, [pb_row0_words]
+    vpbroadcastd        m11, [pb_row1_words]
+    pmovzxbw             m5, xm5
+.w32_loop:
+    vpbroadcastw         m3, [tlq-2]
+    sub                 tlq, 2
+    pshufb               m2, m3, m10
+    pshufb               m3, m11
+    psubw                m2, m5
+    psubw                m3, m5
+    SMOOTH_H_ROW         dstq+strideq*0, 2, 32
+    SMOOTH_H_ROW         dstq+strideq*1, 3, 32
+    lea                dstq, [dstq+strideq*2]
+    sub                  hd, 2
+    jg .w32_loop
+    RET
+.w64:
+    vpbroadcastb        xm5, [tlq+64]
+    movu                 m6, [smooth_weights+64*2+32*0]
+    movu                 m7, [smooth_weights+64*2+32*1]
+    movu                 m8, [smooth_weights+64*2+32*2]
+    movu                 m9, [smooth_weights+64*2+32*3]
+    vpbroadcastd        m10, [pb_row0_words]
+    vpbroadcastd        m11, [pb_row1_words]
+    pmovzxbw             m5, xm5
+.w64_loop:
+    vpbroadcastw         m3, [tlq-2]
+    sub                 tlq, 2
+    pshufb               m2, m3, m10
+    pshufb               m3, m11
+    psubw                m2, m5
+    psubw                m3, m5
+    SMOOTH_H_ROW         dstq+strideq*0, 2, 64
+    SMOOTH_H_ROW         dstq+strideq*1, 3, 64
+    lea                dstq, [dstq+strideq*2]
+    sub                  hd, 2
+    jg .w64_loop
+    RET
+
+IPRED_FNS smooth_h
+
+; The 2D smooth predictor is evaluated as a single pmaddwd per 4 pixels:
+;   (top - bottom) * w_y + (left - right) * w_x + 256 * (bottom + right + 1)
+; with per-column pairs (top - bottom, w_x) and a per-row pair (w_y, left - right).
+; The weights are pre-scaled by 128, so the result is shifted down by 16.
+%macro SMOOTH_COLS 3 ; dst, offset, w
+    pmovzxbw            xm0, [tlq+1+%2]
+    movu                xm1, [smooth_weights+%3*2+%2*2]
+    psubw               xm0, xm5     ; top - bottom
+    punpcklwd           xm2, xm0, xm1
+    punpckhwd           xm0, xm1
+    vinserti128         m%1, m2, xm0, 1
+%endmacro
+
+; per-row (w_y, left - right) pair in m4
+%macro SMOOTH_ROW_PAIR 0
+    dec                 tlq
+    movzx               r7d, byte [tlq]
+    movzx               r8d, word [weightsq]
+    add            weightsq, 2
+    sub                 r7d, rightd
+    shl                 r7d, 16
+    or                  r7d, r8d
+    movd                xm4, r7d
+    vpbroadcastd         m4, xm4
+%endmacro
+
+%macro SMOOTH_2D_DOTS 4 ; A regs
+    pmaddwd              m0, m%1, m4
+    pmaddwd              m1, m%2, m4
+    pmaddwd              m2, m%3, m4
+    pmaddwd              m5, m%4, m4
+    paddd                m0, m3
+    paddd                m1, m3
+    paddd                m2, m3
+    paddd                m5, m3
+    psrad                m0, 16
+    psrad                m1, 16
+    psrad                m2, 16
+    psrad                m5, 16
+    packssdw             m0, m1
+    packssdw             m2, m5
+    packuswb             m0, m2
+    vpermd               m0, m14, m0
+%endmacro
+
+cglobal ipred_smooth, 3, 9, 15, dst, stride, tl, w, h, weights, right
+    lea            weightsq, [smooth_weights]
+    mov                  r7, tlq
+    sub                  r7, hq
+    movzx               r7d, byte [r7] ; bottom
+    movd                xm5, r7d
+    vpbroadcastw         m5, xm5
+    lea            weightsq, [weightsq+hq*2]
+    jmp                  wq
+.w4:
+    movzx            rightd, byte [tlq+4]
+    pmovzxbw            xm0, [tlq+1]
+    movq                xm1, [smooth_weights+4*2]
+    psubw               xm0, xm5
+    punpcklwd           xm6, xm0, xm1
+    lea                 r8d, [r7+rightq+1]
+    shl                 r8d, 15
+    movd                xm3, r8d
+    vpbroadcastd         m3, xm3
+.w4_loop:
+    SMOOTH_ROW_PAIR
+    pmaddwd             xm0, xm6, xm4
+    paddd               xm0, xm3
+    psrad               xm0, 16
+    packssdw            xm0, xm0
+    packuswb            xm0, xm0
+    movd             [dstq], xm0
+    add                dstq, strideq
+    dec                  hd
+    jg .w4_loop
+    RET
+.w8:
+    movzx            rightd, byte [tlq+8]
+    SMOOTH_COLS           6, 0, 8
+    lea                 r8d, [r7+rightq+1]
+    shl                 r8d, 15
+    movd                xm3, r8d
+    vpbroadcastd         m3, xm3
+.w8_loop:
+    SMOOTH_ROW_PAIR
+    pmaddwd              m0, m6, m4
+    paddd                m0, m3
+    psrad                m0, 16
+    vextracti128        xm1, m0, 1
+    packssdw            xm0, xm1
+    packuswb            xm0, xm0
+    movq             [dstq], xm0
+    add                dstq, strideq
+    dec                  hd
+    jg .w8_loop
+    RET
+.w16:
+    movzx            rightd, byte [tlq+16]
+    SMOOTH_COLS           6, 0, 16
+    SMOOTH_COLS           7, 8, 16
+    lea                 r8d, [r7+rightq+1]
+    shl                 r8d, 15
+    movd                xm3, r8d
+    vpbroadcastd         m3, xm3
+.w16_loop:
+    SMOOTH_ROW_PAIR
+    pmaddwd              m0, m6, m4
+    pmaddwd              m1, m7, m4
+    paddd                m0, m3
+    paddd                m1, m3
+    psrad                m0, 16
+    psrad                m1, 16
+    packssdw             m0, m1
+    vextracti128        xm1, m0, 1
+    packuswb            xm0, xm1
+    pshufd              xm0, xm0, q3120
+    mova             [dstq], xm0
+    add                dstq, strideq
+    dec                  hd
+    jg .w16_loop
+    RET
+.w32:
+    movzx            rightd, byte [tlq+32]
+    SMOOTH_COLS           6,  0, 32
+    SMOOTH_COLS           7,  8, 32
+    SMOOTH_COLS           8, 16, 32
+    SMOOTH_COLS           9, 24, 32
+    lea                 r8d, [r7+rightq+1]
+    shl                 r8d, 15
+    movd                xm3, r8d
+    vpbroadcastd         m3, xm3
+    mova                m14, [smooth_perm]
+.w32_loop:
+    SMOOTH_ROW_PAIR
+    SMOOTH_2D_DOTS        6, 7, 8, 9
+    mova             [dstq], m0
+    add                dstq, strideq
+    dec                  hd
+    jg .w32_loop
+    RET
+.w64:
+    movzx            rightd, byte [tlq+64]
+    SMOOTH_COLS           6,  0, 64
+    SMOOTH_COLS           7,  8, 64
+    SMOOTH_COLS           8, 16, 64
+    SMOOTH_COLS           9, 24, 64
+    SMOOTH_COLS          10, 32, 64
+    SMOOTH_COLS          11, 40, 64
+    SMOOTH_COLS          12, 48, 64
+    SMOOTH_COLS          13, 56, 64
+    lea                 r8d, [r7+rightq+1]
+    shl                 r8d, 15
+    movd                xm3, r8d
+    vpbroadcastd         m3, xm3
+    mova                m14, [smooth_perm]
+.w64_loop:
+    SMOOTH_ROW_PAIR
+    SMOOTH_2D_DOTS        6, 7, 8, 9
+    mova        [dstq+32*0], m0
+    SMOOTH_2D_DOTS       10, 11, 12, 13
+    mova        [dstq+32*1], m0
+    add                dstq, strideq
+    dec                  hd
+    jg .w64_loop
+    RET
+
+IPRED_FNS smooth
+
+; dst = dc + sign(alpha * ac) * ((abs(alpha * ac) + 32) >> 6)
+%macro CFL_APPLY 5 ; dst, ac, alpha, abs(alpha) << 9, dc
+    pabsw               m%1, m%2
+    pmulhrsw            m%1, m%4
+    psignw               m7, m%2, m%3
+    psignw              m%1, m7
+    paddw               m%1, m%5
+%endmacro
+
+; store 32 bytes of packed output covering 32 / w rows
+%macro CFL_STORE 2 ; w, dst
+%if %1 == 4
+    vextracti128        xm7, m0, 1
+    packuswb            xm0, xm7
+    movd   [%2+strideq*0], xm0
+    pextrd [%2+strideq*1], xm0, 1
+    pextrd [%2+strideq*2], xm0, 2
+    pextrd [%2+stride3q ], xm0, 3
+%elif %1 == 8
+    vextracti128        xm7, m0, 1
+    packuswb            xm0, xm7
+    movq   [%2+strideq*0], xm0
+    movhps [%2+strideq*1], xm0
+%else
+    packuswb             m0, m1
+    vpermq               m0, m0, q3120
+  %if %1 == 16
+    mova         [%2+strideq*0], xm0
+    vextracti128 [%2+strideq*1], m0, 1
+  %else
+    mova                  [%2], m0
+  %endif
+%endif
+%endmacro
+
+; rows per loop iteration
+%macro CFL_ROWS 1
+  %if %1 == 4
+    %assign cfl_rows 4
+  %elif %1 == 32
+    %assign cfl_rows 1
+  %else
+    %assign cfl_rows 2
+  %endif
+%endmacro
+
+%macro CFL_PRED_1_FN 1 ; w
+cglobal cfl_pred_1_%1xN, 4, 6, 8, dst, stride, ac, alpha, h, stride3
+    movifnidn            hd, hm
+    movsx            alphad, alphab
+    movzx              r5d, byte [dstq]
+    movd                xm4, r5d
+    vpbroadcastw         m4, xm4     ; dc
+    movd                xm2, alphad
+    vpbroadcastw         m2, xm2     ; alpha
+    pabsw                m3, m2
+    psllw                m3, 9
+    lea            stride3q, [strideq*3]
+    CFL_ROWS             %1
+.loop:
+    movu                 m5, [acq+32*0]
+%if %1 >= 16
+    movu                 m6, [acq+32*1]
+%endif
+    CFL_APPLY             0, 5, 2, 3, 4
+%if %1 >= 16
+    CFL_APPLY             1, 6, 2, 3, 4
+    add                 acq, 64
+%else
+    add                 acq, 32
+%endif
+    CFL_STORE            %1, dstq
+    lea                dstq, [dstq+strideq*cfl_rows]
+    sub                  hd, cfl_rows
+    jg .loop
+    RET
+%endmacro
+
+%macro CFL_PRED_FN 1 ; w
+cglobal cfl_pred_%1xN, 6, 7, 11, dstu, dstv, stride, ac, alphas, h, stride3
+    movsx          stride3d, byte [alphasq+0]
+    movd                xm2, stride3d
+    movsx          stride3d, byte [alphasq+1]
+    movd                xm8, stride3d
+    movzx          stride3d, byte [dstuq]
+    movd                xm4, stride3d
+    movzx          stride3d, byte [dstvq]
+    movd               xm10, stride3d
+    vpbroadcastw         m2, xm2     ; alpha_u
+    vpbroadcastw         m8, xm8     ; alpha_v
+    vpbroadcastw         m4, xm4     ; dc_u
+    vpbroadcastw        m10, xm10    ; dc_v
+    pabsw                m3, m2
+    pabsw                m9, m8
+    psllw                m3, 9
+    psllw                m9, 9
+    lea            stride3q, [strideq*3]
+    CFL_ROWS             %1
+.loop:
+    movu                 m5, [acq+32*0]
+%if %1 >= 16
+    movu                 m6, [acq+32*1]
+%endif
+    CFL_APPLY             0, 5, 2, 3, 4
+%if %1 >= 16
+    CFL_APPLY             1, 6, 2, 3, 4
+%endif
+    CFL_STORE            %1, dstuq
+    CFL_APPLY             0, 5, 8, 9, 10
+%if %1 >= 16
+    CFL_APPLY             1, 6, 8, 9, 10
+    add                 acq, 64
+%else
+    add                 acq, 32
+%endif
+    CFL_STORE            %1, dstvq
+    lea               dstuq, [dstuq+strideq*cfl_rows]
+    lea               dstvq, [dstvq+strideq*cfl_rows]
+    sub                  hd, cfl_rows
+    jg .loop
+    RET
+%endmacro
+
+CFL_PRED_1_FN  4
+CFL_PRED_1_FN  8
+CFL_PRED_1_FN 16
+CFL_PRED_1_FN 32
+CFL_PRED_FN    4
+CFL_PRED_FN    8
+CFL_PRED_FN   16
+CFL_PRED_FN   32
+
+cglobal pal_pred, 4, 6, 5, dst, stride, pal, idx, w, h
+    vbroadcasti128       m4, [palq]
+    lea                  r2, [pal_pred_avx2_table]
+    tzcnt                wd, wm
+    movifnidn            hd, hm
+    movsxd               wq, dword [r2+wq*4]
+    packuswb             m4, m4
+    add                  wq, r2
+    lea                  r2, [strideq*3]
+    jmp                  wq
+.w4:
+    pshufb              xm0, xm4, [idxq]
+    add                idxq, 16
+    movd   [dstq+strideq*0], xm0
+    pextrd [dstq+strideq*1], xm0, 1
+    pextrd [dstq+strideq*2], xm0, 2
+    pextrd [dstq+r2       ], xm0, 3
+    lea                dstq, [dstq+strideq*4]
+    sub                  hd, 4
+    jg .w4
+    RET
+ALIGN function_align
+.w8:
+    pshufb              xm0, xm4, [idxq+16*0]
+    pshufb              xm1, xm4, [idxq+16*1]
+    add                idxq, 16*2
+    movq   [dstq+strideq*0], xm0
+    movhps [dstq+strideq*1], xm0
+    movq   [dstq+strideq*2], xm1
+    movhps [dstq+r2       ], xm1
+    lea                dstq, [dstq+strideq*4]
+    sub                  hd, 4
+    jg .w8
+    RET
+ALIGN function_align
+.w16:
+    pshufb               m0, m4, [idxq+32*0]
+    pshufb               m1, m4, [idxq+32*1]
+    add                idxq, 32*2
+    mova         [dstq+strideq*0], xm0
+    vextracti128 [dstq+strideq*1], m0, 1
+    mova         [dstq+strideq*2], xm1
+    vextracti128 [dstq+r2       ], m1, 1
+    lea                dstq, [dstq+strideq*4]
+    sub                  hd, 4
+    jg .w16
+    RET
+ALIGN function_align
+.w32:
+    pshufb               m0, m4, [idxq+32*0]
+    pshufb               m1, m4, [idxq+32*1]
+    pshufb               m2, m4, [idxq+32*2]
+    pshufb               m3, m4, [idxq+32*3]
+    add                idxq, 32*4
+    mova   [dstq+strideq*0], m0
+    mova   [dstq+strideq*1], m1
+    mova   [dstq+strideq*2], m2
+    mova   [dstq+r2       ], m3
+    lea                dstq, [dstq+strideq*4]
+    sub                  hd, 4
+    jg .w32
+    RET
+ALIGN function_align
+.w64:
+    pshufb               m0, m4, [idxq+32*0]
+    pshufb               m1, m4, [idxq+32*1]
+    pshufb               m2, m4, [idxq+32*2]
+    pshufb               m3, m4, [idxq+32*3]
+    add                idxq, 32*4
+    mova [dstq+strideq*0+32*0], m0
+    mova [dstq+strideq*0+32*1], m1
+    mova [dstq+strideq*1+32*0], m2
+    mova [dstq+strideq*1+32*1], m3
+    lea                dstq, [dstq+strideq*2]
+    sub                  hd, 2
+    jg .w64
+    RET
+
+; copies %2 (>= 0) bytes from %3 to %1 without touching anything around them,
+; using overlapping moves for sizes which aren't a multiple of the width
+%macro EDGE_COPY 3 ; dst, n, src
+    cmp                  %2, 32
+    jl %%w16
+    lea               lastq, [%2-32]
+    xor                offd, offd
+%%w32_loop:
+    movu                 m0, [%3+offq]
+    movu        [%1+offq], m0
+    add                offq, 32
+    cmp                offq, lastq
+    jl %%w32_loop
+    movu                 m0, [%3+lastq]
+    movu       [%1+lastq], m0
+    jmp %%end
+%%w16:
+    cmp                  %2, 16
+    jl %%w8
+    movu                xm0, [%3]
+    movu                xm1, [%3+%2-16]
+    movu               [%1], xm0
+    movu         [%1+%2-16], xm1
+    jmp %%end
+%%w8:
+    cmp                  %2, 8
+    jl %%w4
+    movq                xm0, [%3]
+    movq                xm1, [%3+%2-8]
+    movq               [%1], xm0
+    movq          [%1+%2-8], xm1
+    jmp %%end
+%%w4:
+    cmp                  %2, 4
+    jl %%w2
+    movd                xm0, [%3]
+    movd                xm1, [%3+%2-4]
+    movd               [%1], xm0
+    movd          [%1+%2-4], xm1
+    jmp %%end
+%%w2:
+    cmp                  %2, 2
+    jl %%w1
+    movzx              offd, word [%3]
+    movzx             lastd, word [%3+%2-2]
+    mov                [%1], offw
+    mov           [%1+%2-2], lastw
+    jmp %%end
+%%w1:
+    test                 %2, %2
+    jz %%end
+    movzx              offd, byte [%3]
+    mov                [%1], offb
+%%end:
+%endmacro
+
+; writes in[iclip(k - %1, from, to - 1)] to [rsp+k] for k < n (and some
+; more bytes after that), reading only in[from] to in[to - 1]
+%macro EDGE_PAD 1 ; pad
+    movsxd            fromq, fromd
+    movsxd              toq, tod
+    xor                offd, offd
+    ; the first entries replicate in[from], the last ones in[to - 1], and
+    ; [lo, hi) is copied: lo = iclip(from + pad, 0, n), hi = iclip(to + pad, lo, n)
+    lea                 loq, [fromq+%1]
+    cmp                 loq, offq
+    cmovl               loq, offq
+    cmp                 loq, nq
+    cmovg               loq, nq
+    lea                 hiq, [toq+%1]
+    cmp                 hiq, loq
+    cmovl               hiq, loq
+    cmp                 hiq, nq
+    cmovg               hiq, nq
+    vpbroadcastb         m1, [inq+fromq]
+    vpbroadcastb         m2, [inq+toq-1]
+%%left:
+    cmp                offq, loq
+    jge %%center
+    mova        [rsp+offq], m1
+    add                offq, 32
+    jmp %%left
+%%center:
+    lea               fromq, [inq+loq-%1]
+    mov                 toq, hiq
+    sub                 toq, loq
+    add                 loq, rsp
+    EDGE_COPY           loq, toq, fromq
+%%right:
+    cmp                 hiq, nq
+    jge %%end
+    movu         [rsp+hiq], m2
+    add                 hiq, 32
+    jmp %%right
+%%end:
+%endmacro
+
+; the padded input at [rsp], the output at [rsp+32*6], before copying sz
+; bytes of it to out
+cglobal ipred_filter_edge, 6, 11, 8, 32*11, out, sz, in, from, to, strength, \
+                                             lo, hi, n, off, last
+    movsxd               szq, szd
+    lea                  nq, [szq+4]
+    EDGE_PAD              2
+    lea                  loq, [filter_edge_kernels-6]
+    lea            strengthd, [strengthq*3]
+    vpbroadcastw         m5, [loq+strengthq*2+0]
+    vpbroadcastw         m6, [loq+strengthq*2+2]
+    vpbroadcastw         m7, [loq+strengthq*2+4]
+    vpbroadcastd         m4, [pw_2048]
+    xor                offd, offd
+.loop:
+    vpmovzxbw            m0, [rsp+offq+0]
+    vpmovzxbw            m1, [rsp+offq+4]
+    vpmovzxbw            m2, [rsp+offq+1]
+    vpmovzxbw            m3, [rsp+offq+3]
+    paddw                m0, m1
+    paddw                m2, m3
+    vpmovzxbw            m1, [rsp+offq+2]
+    pmullw               m0, m5
+    pmullw               m2, m6
+    pmullw               m1, m7
+    paddw                m0, m2
+    paddw                m0, m1
+    pmulhrsw             m0, m4 ; (x + 8) >> 4
+    vextracti128        xm1, m0, 1
+    packuswb            xm0, xm1
+    mova   [rsp+32*6+offq], xm0
+    add                offq, 16
+    cmp                offq, szq
+    jl .loop
+    lea                 inq, [rsp+32*6]
+    EDGE_COPY          outq, szq, inq
+    RET
+
+; the padded input at [rsp], the output at [rsp+64], before copying its
+; 2 * hsz - 1 bytes to out; hsz is at most 16
+cglobal ipred_upsample_edge, 5, 10, 7, 32*3, out, hsz, in, from, to, \
+                                            lo, hi, n, off, last
+    movsxd              hszq, hszd
+    lea                  nq, [hszq+2]
+    EDGE_PAD              1
+    vpmovzxbw            m0, [rsp+0]
+    vpmovzxbw            m1, [rsp+1]
+    vpmovzxbw            m2, [rsp+2]
+    vpmovzxbw            m3, [rsp+3]
+    vpbroadcastd         m4, [pw_2048]
+    paddw                m1, m2
+    paddw                m0, m3
+    psllw                m2, m1, 3
+    paddw                m1, m2 ; 9 * (in[i] + in[i + 1])
+    psubw                m1, m0
+    pmulhrsw             m1, m4 ; (x + 8) >> 4
+    vextracti128        xm2, m1, 1
+    packuswb            xm1, xm2
+    movu                xm0, [rsp+1]
+    punpcklbw           xm2, xm0, xm1
+    punpckhbw           xm0, xm1
+    mova          [rsp+64], xm2
+    mova          [rsp+80], xm0
+    lea                 inq, [rsp+64]
+    lea                hszq, [hszq*2-1]
+    EDGE_COPY          outq, hszq, inq
+    RET
+
+%endif
@@ -0,0 +1,129 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * Copyright © 2018, Two Orioles, LLC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "src/cpu.h"
+#include "src/ipred.h"
+
+#define decl_ipred_fns(type, opt) \
+decl_angular_ipred_fn(dav1d_ipred_##type##_4x4_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_4x8_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_4x16_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_8x4_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_8x8_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_8x16_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_8x32_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_16x4_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_16x8_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_16x16_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_16x32_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_16x64_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_32x8_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_32x16_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_32x32_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_32x64_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_64x16_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_64x32_##opt); \
+decl_angular_ipred_fn(dav1d_ipred_##type##_64x64_##opt)
+
+decl_ipred_fns(dc,       avx2);
+decl_ipred_fns(dc_128,   avx2);
+decl_ipred_fns(dc_top,   avx2);
+decl_ipred_fns(dc_left,  avx2);
+decl_ipred_fns(h,        avx2);
+decl_ipred_fns(v,        avx2);
+decl_ipred_fns(paeth,    avx2);
+decl_ipred_fns(smooth,   avx2);
+decl_ipred_fns(smooth_v, avx2);
+decl_ipred_fns(smooth_h, avx2);
+
+decl_cfl_pred_1_fn(dav1d_cfl_pred_1_4xN_avx2);
+decl_cfl_pred_1_fn(dav1d_cfl_pred_1_8xN_avx2);
+decl_cfl_pred_1_fn(dav1d_cfl_pred_1_16xN_avx2);
+decl_cfl_pred_1_fn(dav1d_cfl_pred_1_32xN_avx2);
+
+decl_cfl_pred_fn(dav1d_cfl_pred_4xN_avx2);
+decl_cfl_pred_fn(dav1d_cfl_pred_8xN_avx2);
+decl_cfl_pred_fn(dav1d_cfl_pred_16xN_avx2);
+decl_cfl_pred_fn(dav1d_cfl_pred_32xN_avx2);
+
+decl_pal_pred_fn(dav1d_pal_pred_avx2);
+
+void bitfn(dav1d_intra_pred_dsp_init_x86)(Dav1dIntraPredDSPContext *const c) {
+#define assign_ipred_fn(w, h, mode, type, pfx, ext) \
+    c->intra_pred[pfx##TX_##w##X##h][mode##_PRED] = \
+        dav1d_ipred_##type##_##w##x##h##_##ext
+
+#define assign_ipred_fns(mode, type, ext) \
+    assign_ipred_fn( 4,  4, mode, type,  , ext); \
+    assign_ipred_fn( 4,  8, mode, type, R, ext); \
+    assign_ipred_fn( 4, 16, mode, type, R, ext); \
+    assign_ipred_fn( 8,  4, mode, type, R, ext); \
+    assign_ipred_fn( 8,  8, mode, type,  , ext); \
+    assign_ipred_fn( 8, 16, mode, type, R, ext); \
+    assign_ipred_fn( 8, 32, mode, type, R, ext); \
+    assign_ipred_fn(16,  4, mode, type, R, ext); \
+    assign_ipred_fn(16,  8, mode, type, R, ext); \
+    assign_ipred_fn(16, 16, mode, type,  , ext); \
+    assign_ipred_fn(16, 32, mode, type, R, ext); \
+    assign_ipred_fn(16, 64, mode, type, R, ext); \
+    assign_ipred_fn(32,  8, mode, type, R, ext); \
+    assign_ipred_fn(32, 16, mode, type, R, ext); \
+    assign_ipred_fn(32, 32, mode, type,  , ext); \
+    assign_ipred_fn(32, 64, mode, type, R, ext); \
+    assign_ipred_fn(64, 16, mode, type, R, ext); \
+    assign_ipred_fn(64, 32, mode, type, R, ext); \
+    assign_ipred_fn(64, 64, mode, type,  , ext)
+
+    const unsigned flags = dav1d_get_cpu_flags();
+
+    if (!(flags & DAV1D_X86_CPU_FLAG_AVX2)) return;
+
+#if BITDEPTH == 8 && ARCH_X86_64
+    assign_ipred_fns(DC,       dc,       avx2);
+    assign_ipred_fns(DC_128,   dc_128,   avx2);
+    assign_ipred_fns(TOP_DC,   dc_top,   avx2);
+    assign_ipred_fns(LEFT_DC,  dc_left,  avx2);
+    assign_ipred_fns(HOR,      h,        avx2);
+    assign_ipred_fns(VERT,     v,        avx2);
+    assign_ipred_fns(PAETH,    paeth,    avx2);
+    assign_ipred_fns(SMOOTH,   smooth,   avx2);
+    assign_ipred_fns(SMOOTH_V, smooth_v, avx2);
+    assign_ipred_fns(SMOOTH_H, smooth_h, avx2);
+
+    c->cfl_pred_1[0] = dav1d_cfl_pred_1_4xN_avx2;
+    c->cfl_pred_1[1] = dav1d_cfl_pred_1_8xN_avx2;
+    c->cfl_pred_1[2] = dav1d_cfl_pred_1_16xN_avx2;
+    c->cfl_pred_1[3] = dav1d_cfl_pred_1_32xN_avx2;
+
+    c->cfl_pred[0] = dav1d_cfl_pred_4xN_avx2;
+    c->cfl_pred[1] = dav1d_cfl_pred_8xN_avx2;
+    c->cfl_pred[2] = dav1d_cfl_pred_16xN_avx2;
+    c->cfl_pred[3] = dav1d_cfl_pred_32xN_avx2;
+
+    c->pal_pred = dav1d_pal_pred_avx2;
+#endif
+}
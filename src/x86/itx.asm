@@ -0,0 +1,762 @@
+; Copyright © 2018, VideoLAN and dav1d authors
+; Copyright © 2018, Two Orioles, LLC
+; All rights reserved.
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice, this
+;    list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+; ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+; WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+; DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+; ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+; (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+; ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+; (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+; SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+%include "config.asm"
+%include "ext/x86/x86inc.asm"
+
+%if ARCH_X86_64
+
+SECTION_RODATA 16
+
+; coefficient pairs for pmaddwd, (a, b) dot (pw_x_y) = a * x + b * y
+%macro COEF_PAIR 2
+pw_%1_m%2: dw  %1, -%2
+pw_%2_%1:  dw  %2,  %1
+%endmacro
+
+COEF_PAIR 2896, 2896
+COEF_PAIR 1567, 3784
+COEF_PAIR 3784, 1567
+COEF_PAIR  799, 4017
+COEF_PAIR 3406, 2276
+COEF_PAIR  401, 4076
+COEF_PAIR 1931, 3612
+COEF_PAIR 3166, 2598
+COEF_PAIR 3920, 1189
+
+; adst4
+pw_1321_3803:   dw  1321,  3803
+pw_2482_m1321:  dw  2482, -1321
+pw_3344_2482:   dw  3344,  2482
+pw_3344_m3803:  dw  3344, -3803
+pw_3344_m3344:  dw  3344, -3344
+pw_0_3344:      dw     0,  3344
+pw_3803_2482:   dw  3803,  2482
+pw_m3344_m1321: dw -3344, -1321
+
+pw_2048:   times 2 dw 2048
+pw_16384:  times 2 dw 16384
+pw_1697x8: times 2 dw 1697*8
+pw_2896x8: times 2 dw 2896*8
+pd_2048:   dd 2048
+
+%define m(x) mangle(private_prefix %+ _ %+ x %+ SUFFIX)
+
+SECTION .text
+
+; Macro for applying an instruction to a list of registers,
+; e.g. REPX {psrad x, 12}, m0, m1, m2
+%macro REPX 2-*
+    %xdefine %%f(x) %1
+%rep %0 - 1
+    %rotate 1
+    %%f(%1)
+%endrep
+%endmacro
+
+; The 2D transforms are split into two passes, each implemented as an
+; internal function per (1D transform type, block size). The public entry
+; points only load the address of the second pass into tx2q and jump to
+; the first pass, which jumps to tx2q when done. All internal functions of
+; a given block size share the same prologue, so they can freely jump into
+; one another.
+; dct_dct blocks with only the DC coefficient set (eob == 0) are instead
+; handled in the entry point itself: both passes scale the DC by 2896/4096
+; (after the 1/sqrt(2) prescale of 2:1 blocks, and with the intermediate
+; shift of 8x8 in between), and the resulting constant is added to every
+; pixel. This only uses m0-m2, so it needs no xmm registers saved.
+%macro INV_TXFM_FN 4 ; type1, type2, w, h
+cglobal inv_txfm_add_%1_%2_%{3}x%{4}, 4, 5, 0, dst, stride, c, eob, tx2
+    lea                tx2q, [m(i%2_%{3}x%{4}_internal).pass2]
+%ifidn %1_%2, dct_dct
+    test               eobd, eobd
+    jz .dconly
+%endif
+    jmp m(i%1_%{3}x%{4}_internal)
+%ifidn %1_%2, dct_dct
+.dconly:
+    vpbroadcastw         m0, [cq]
+    vpbroadcastd         m1, [pw_2896x8]
+    mov                [cq], eobd ; 0
+%if %3 != %4
+    pmulhrsw             m0, m1
+%endif
+    pmulhrsw             m0, m1
+%if %3 == 8 && %4 == 8
+    vpbroadcastd         m2, [pw_16384]
+    pmulhrsw             m0, m2
+%endif
+    pmulhrsw             m0, m1
+    vpbroadcastd         m2, [pw_2048]
+    pmulhrsw             m0, m2
+    mov                 r3d, %4
+.dconly_loop:
+%if %3 == 4
+    movd                 m1, [dstq]
+    pmovzxbw             m1, m1
+    paddw                m1, m0
+    packuswb             m1, m1
+    movd             [dstq], m1
+%else
+    movq                 m1, [dstq]
+    pmovzxbw             m1, m1
+    paddw                m1, m0
+    packuswb             m1, m1
+    movq             [dstq], m1
+%endif
+    add                dstq, strideq
+    dec                 r3d
+    jg .dconly_loop
+    RET
+%endif
+%endmacro
+
+%macro INV_TXFM_FN_ALL 2 ; w, h
+INV_TXFM_FN      dct,      dct, %1, %2
+INV_TXFM_FN     adst,      dct, %1, %2
+INV_TXFM_FN      dct,     adst, %1, %2
+INV_TXFM_FN     adst,     adst, %1, %2
+INV_TXFM_FN flipadst,      dct, %1, %2
+INV_TXFM_FN      dct, flipadst, %1, %2
+INV_TXFM_FN flipadst, flipadst, %1, %2
+INV_TXFM_FN     adst, flipadst, %1, %2
+INV_TXFM_FN flipadst,     adst, %1, %2
+INV_TXFM_FN identity, identity, %1, %2
+INV_TXFM_FN identity,      dct, %1, %2
+INV_TXFM_FN      dct, identity, %1, %2
+INV_TXFM_FN identity,     adst, %1, %2
+INV_TXFM_FN     adst, identity, %1, %2
+INV_TXFM_FN identity, flipadst, %1, %2
+INV_TXFM_FN flipadst, identity, %1, %2
+%endmacro
+
+; dst1 = (src1 * coef1 - src2 * coef2 + rnd) >> 12
+; dst2 = (src1 * coef2 + src2 * coef1 + rnd) >> 12
+%macro ITX_MULSUB_2W 7 ; dst/src[1-2], tmp[1-2], rnd, coef[1-2]
+    punpckhwd           m%3, m%1, m%2
+    punpcklwd           m%2, m%1, m%2
+    vpbroadcastd        m%4, [pw_%6_m%7]
+    pmaddwd             m%1, m%2, m%4
+    pmaddwd             m%4, m%3
+    paddd               m%1, m%5
+    paddd               m%4, m%5
+    psrad               m%1, 12
+    psrad               m%4, 12
+    packssdw            m%1, m%4
+    vpbroadcastd        m%4, [pw_%7_%6]
+    pmaddwd             m%2, m%4
+    pmaddwd             m%3, m%4
+    paddd               m%2, m%5
+    paddd               m%3, m%5
+    psrad               m%2, 12
+    psrad               m%3, 12
+    packssdw            m%2, m%3
+%endmacro
+
+;
+; 4x4 blocks are processed with two 4-point vectors packed per
+; register, i.e. m0 = [in0 in1] and m1 = [in2 in3], using m5 as
+; rounding constant.
+;
+
+%macro IDCT4_1D_PACKED 0
+    punpckhwd            m2, m0, m1 ; in1 in3
+    punpcklwd            m0, m1     ; in0 in2
+    vpbroadcastd         m4, [pw_2896_m2896]
+    pmaddwd              m1, m0, m4
+    vpbroadcastd         m4, [pw_2896_2896]
+    pmaddwd              m0, m4
+    vpbroadcastd         m4, [pw_1567_m3784]
+    pmaddwd              m3, m2, m4
+    vpbroadcastd         m4, [pw_3784_1567]
+    pmaddwd              m2, m4
+    REPX   {paddd x, m5}, m0, m1, m2, m3
+    REPX   {psrad x, 12}, m0, m1, m2, m3
+    packssdw             m0, m1     ; t0 t1
+    packssdw             m2, m3     ; t3 t2
+    psubw                m1, m0, m2 ; out3 out2
+    paddw                m0, m2     ; out0 out1
+    pshufd               m1, m1, q1032
+%endmacro
+
+%macro IADST4_1D_PACKED 0
+    punpcklwd            m2, m0, m1 ; in0 in2
+    punpckhwd            m3, m0, m1 ; in1 in3
+    vpbroadcastd         m4, [pw_1321_3803]
+    pmaddwd              m0, m2, m4
+    vpbroadcastd         m4, [pw_3344_2482]
+    pmaddwd              m4, m3
+    paddd                m0, m4     ; out0
+    vpbroadcastd         m4, [pw_2482_m1321]
+    pmaddwd              m1, m2, m4
+    vpbroadcastd         m4, [pw_3344_m3803]
+    pmaddwd              m4, m3
+    paddd                m1, m4     ; out1
+    paddd                m0, m5
+    paddd                m1, m5
+    psrad                m0, 12
+    psrad                m1, 12
+    packssdw             m0, m1     ; out0 out1
+    vpbroadcastd         m4, [pw_3344_m3344]
+    pmaddwd              m1, m2, m4
+    vpbroadcastd         m4, [pw_0_3344]
+    pmaddwd              m4, m3
+    paddd                m1, m4     ; out2
+    vpbroadcastd         m4, [pw_3803_2482]
+    pmaddwd              m2, m4
+    vpbroadcastd         m4, [pw_m3344_m1321]
+    pmaddwd              m3, m4
+    paddd                m2, m3     ; out3
+    paddd                m1, m5
+    paddd                m2, m5
+    psrad                m1, 12
+    psrad                m2, 12
+    packssdw             m1, m2     ; out2 out3
+%endmacro
+
+%macro IIDENTITY4_1D_PACKED 0
+    vpbroadcastd         m3, [pw_1697x8]
+    pmulhrsw             m2, m0, m3
+    pmulhrsw             m3, m1
+    paddw                m0, m2
+    paddw                m1, m3
+%endmacro
+
+; [c0 c1] [c2 c3] -> [r0 r1] [r2 r3]
+%macro TRANSPOSE_4X4_PACKED 0
+    punpckhwd            m2, m0, m1
+    punpcklwd            m0, m1
+    punpckhwd            m1, m0, m2
+    punpcklwd            m0, m2
+%endmacro
+
+INIT_XMM avx2
+cglobal inv_txfm_add_wht_wht_4x4, 3, 4, 6, dst, stride, c
+    mova                 m0, [cq+16*0]
+    mova                 m1, [cq+16*1]
+    psraw                m0, 2
+    psraw                m1, 2
+    call .main
+    TRANSPOSE_4X4_PACKED
+    call .main
+    jmp m(idct_4x4_internal).end2
+ALIGN function_align
+.main:
+    punpckhqdq           m2, m0, m0 ; in1
+    punpckhqdq           m3, m1, m1 ; in3
+    paddw                m0, m2     ; t0
+    psubw                m1, m3     ; t2
+    psubw                m4, m0, m1
+    psraw                m4, 1      ; t4
+    psubw                m3, m4, m3 ; t3
+    psubw                m2, m4, m2 ; t1
+    psubw                m0, m3     ; out0
+    paddw                m1, m2     ; out3
+    punpcklqdq           m0, m3     ; out0 out1
+    punpcklqdq           m1, m2, m1 ; out2 out3
+    ret
+
+INV_TXFM_FN_ALL 4, 4
+
+cglobal idct_4x4_internal, 0, 5, 6, dst, stride, c, eob, tx2
+    mova                 m0, [cq+16*0]
+    mova                 m1, [cq+16*1]
+    vpbroadcastd         m5, [pd_2048]
+    IDCT4_1D_PACKED
+    TRANSPOSE_4X4_PACKED
+    jmp                tx2q
+.pass2:
+    IDCT4_1D_PACKED
+.end:
+    vpbroadcastd         m2, [pw_2048]
+    pmulhrsw             m0, m2
+    pmulhrsw             m1, m2
+.end2:
+    lea                  r3, [strideq*3]
+    movd                 m2, [dstq+strideq*0]
+    pinsrd               m2, [dstq+strideq*1], 1
+    movd                 m3, [dstq+strideq*2]
+    pinsrd               m3, [dstq+r3       ], 1
+    pxor                 m4, m4
+    mova          [cq+16*0], m4
+    mova          [cq+16*1], m4
+    pmovzxbw             m2, m2
+    pmovzxbw             m3, m3
+    paddw                m0, m2
+    paddw                m1, m3
+    packuswb             m0, m1
+    movd   [dstq+strideq*0], m0
+    pextrd [dstq+strideq*1], m0, 1
+    pextrd [dstq+strideq*2], m0, 2
+    pextrd [dstq+r3       ], m0, 3
+    RET
+
+cglobal iadst_4x4_internal, 0, 5, 6, dst, stride, c, eob, tx2
+    mova                 m0, [cq+16*0]
+    mova                 m1, [cq+16*1]
+    vpbroadcastd         m5, [pd_2048]
+    IADST4_1D_PACKED
+    TRANSPOSE_4X4_PACKED
+    jmp                tx2q
+.pass2:
+    IADST4_1D_PACKED
+    jmp m(idct_4x4_internal).end
+
+cglobal iflipadst_4x4_internal, 0, 5, 6, dst, stride, c, eob, tx2
+    mova                 m0, [cq+16*0]
+    mova                 m1, [cq+16*1]
+    vpbroadcastd         m5, [pd_2048]
+    IADST4_1D_PACKED
+    pshufd               m2, m0, q1032 ; out1 out0
+    pshufd               m0, m1, q1032 ; out3 out2
+    mova                 m1, m2
+    TRANSPOSE_4X4_PACKED
+    jmp                tx2q
+.pass2:
+    IADST4_1D_PACKED
+    pshufd               m2, m0, q1032
+    pshufd               m0, m1, q1032
+    mova                 m1, m2
+    jmp m(idct_4x4_internal).end
+
+cglobal iidentity_4x4_internal, 0, 5, 6, dst, stride, c, eob, tx2
+    mova                 m0, [cq+16*0]
+    mova                 m1, [cq+16*1]
+    vpbroadcastd         m5, [pd_2048]
+    IIDENTITY4_1D_PACKED
+    TRANSPOSE_4X4_PACKED
+    jmp                tx2q
+.pass2:
+    IIDENTITY4_1D_PACKED
+    jmp m(idct_4x4_internal).end
+
+;
+; Larger blocks use one vector per register, i.e. m0-m7 = in0-in7, with
+; m8-m14 as temporaries and m15 as rounding constant. 4-point vectors
+; only use the lower half of the register.
+;
+
+%macro IDCT4_1D 6 ; src/dst[1-4], tmp[1-2]
+    ITX_MULSUB_2W        %1, %3, %5, %6, 15, 2896, 2896 ; t1, t0
+    ITX_MULSUB_2W        %2, %4, %5, %6, 15, 1567, 3784 ; t2, t3
+    psubw               m%5, m%3, m%4 ; out3
+    paddw               m%3, m%4      ; out0
+    psubw               m%4, m%1, m%2 ; out2
+    paddw               m%2, m%1      ; out1
+    mova                m%1, m%3
+    mova                m%3, m%4
+    mova                m%4, m%5
+%endmacro
+
+; dst = (in0 * coef[1] + in2 * coef[2] + in1 * coef[3] + in3 * coef[4] + rnd) >> 12
+; with the interleaved inputs in m8-m11
+%macro IADST4_MADD 3 ; dst, coef[12-34]
+    vpbroadcastd        m12, [pw_%2]
+    vpbroadcastd        m13, [pw_%3]
+    pmaddwd             m%1, m8, m12
+    pmaddwd             m12, m9
+    pmaddwd             m14, m10, m13
+    pmaddwd             m13, m11
+    paddd               m%1, m14
+    paddd               m12, m13
+    paddd               m%1, m15
+    paddd               m12, m15
+    psrad               m%1, 12
+    psrad               m12, 12
+    packssdw            m%1, m12
+%endmacro
+
+%macro IADST4_1D 4 ; dst[1-4]
+    punpcklwd            m8, m0, m2 ; in0 in2
+    punpckhwd            m9, m0, m2
+    punpcklwd           m10, m1, m3 ; in1 in3
+    punpckhwd           m11, m1, m3
+    IADST4_MADD          %1, 1321_3803,  3344_2482
+    IADST4_MADD          %2, 2482_m1321, 3344_m3803
+    IADST4_MADD          %3, 3344_m3344, 0_3344
+    IADST4_MADD          %4, 3803_2482,  m3344_m1321
+%endmacro
+
+%macro IIDENTITY4_1D 0
+    vpbroadcastd         m8, [pw_1697x8]
+    pmulhrsw             m9, m0, m8
+    pmulhrsw            m10, m1, m8
+    pmulhrsw            m11, m2, m8
+    pmulhrsw             m8, m3
+    paddw                m0, m9
+    paddw                m1, m10
+    paddw                m2, m11
+    paddw                m3, m8
+%endmacro
+
+%macro IDCT8_1D 0
+    ITX_MULSUB_2W         1, 7, 8, 9, 15,  799, 4017 ; t4a, t7a
+    ITX_MULSUB_2W         5, 3, 8, 9, 15, 3406, 2276 ; t5a, t6a
+    psubw                m8, m1, m5 ; t5a
+    paddw                m1, m5     ; t4
+    psubw                m5, m7, m3 ; t6a
+    paddw                m7, m3     ; t7
+    ITX_MULSUB_2W         5, 8, 9, 10, 15, 2896, 2896 ; t5, t6
+    IDCT4_1D              0, 2, 4, 6, 9, 10
+    psubw                m9, m0, m7 ; out7
+    paddw                m0, m7     ; out0
+    psubw                m7, m2, m8 ; out6
+    paddw                m8, m2     ; out1
+    paddw                m2, m4, m5 ; out2
+    psubw               m10, m4, m5 ; out5
+    psubw                m4, m6, m1 ; out4
+    paddw                m3, m6, m1 ; out3
+    mova                 m1, m8
+    mova                 m5, m10
+    mova                 m6, m7
+    mova                 m7, m9
+%endmacro
+
+%macro IADST8_1D 1 ; flip
+    ITX_MULSUB_2W         7, 0, 8, 9, 15,  401, 4076 ; t1a, t0a
+    ITX_MULSUB_2W         5, 2, 8, 9, 15, 1931, 3612 ; t3a, t2a
+    ITX_MULSUB_2W         3, 4, 8, 9, 15, 3166, 2598 ; t5a, t4a
+    ITX_MULSUB_2W         1, 6, 8, 9, 15, 3920, 1189 ; t7a, t6a
+    psubw                m8, m0, m4 ; t4
+    paddw                m0, m4     ; t0
+    psubw                m4, m7, m3 ; t5
+    paddw                m7, m3     ; t1
+    psubw                m3, m2, m6 ; t6
+    paddw                m2, m6     ; t2
+    psubw                m6, m5, m1 ; t7
+    paddw                m5, m1     ; t3
+    ITX_MULSUB_2W         8, 4, 1, 9, 15, 1567, 3784 ; t5a, t4a
+    ITX_MULSUB_2W         6, 3, 1, 9, 15, 3784, 1567 ; t6a, t7a
+    psubw                m1, m0, m2 ; t2
+    paddw                m0, m2     ; out0
+    psubw                m2, m7, m5 ; t3
+    paddw                m7, m5     ; -out7
+    psubw                m5, m4, m6 ; t6
+    paddw                m4, m6     ; -out1
+    psubw                m6, m8, m3 ; t7
+    paddw                m8, m3     ; out6
+    ITX_MULSUB_2W         1, 2, 3, 9, 15, 2896, 2896 ; out4, -out3
+    ITX_MULSUB_2W         5, 6, 3, 9, 15, 2896, 2896 ; -out5, out2
+    pxor                 m9, m9
+%if %1 == 0
+    psubw                m3, m9, m2
+    mova                 m2, m6
+    mova                 m6, m8
+    psubw                m8, m9, m4
+    mova                 m4, m1
+    mova                 m1, m8
+    psubw                m5, m9, m5
+    psubw                m7, m9, m7
+%else
+    psubw               m10, m9, m7
+    mova                 m7, m0
+    mova                 m0, m10
+    psubw               m10, m9, m4
+    psubw                m4, m9, m2
+    psubw                m2, m9, m5
+    mova                 m5, m6
+    mova                 m6, m10
+    mova                 m3, m1
+    mova                 m1, m8
+%endif
+%endmacro
+
+%macro IIDENTITY8_1D 0
+    REPX      {paddw x, x}, m0, m1, m2, m3, m4, m5, m6, m7
+%endmacro
+
+; 4 vectors of 8 coefficients -> 8 vectors of 4 coefficients
+%macro TRANSPOSE_4X8 0
+    punpckhwd            m4, m0, m1
+    punpcklwd            m0, m1
+    punpckhwd            m5, m2, m3
+    punpcklwd            m2, m3
+    punpckhdq            m6, m4, m5
+    punpckldq            m4, m5
+    punpckhdq            m5, m0, m2
+    punpckldq            m0, m2
+    punpckhqdq           m1, m0, m0
+    punpckhqdq           m3, m5, m5
+    mova                 m2, m5
+    punpckhqdq           m5, m4, m4
+    punpckhqdq           m7, m6, m6
+%endmacro
+
+; 8 vectors of 4 coefficients -> 4 vectors of 8 coefficients
+%macro TRANSPOSE_8X4 0
+    punpcklwd            m0, m1
+    punpcklwd            m2, m3
+    punpcklwd            m4, m5
+    punpcklwd            m6, m7
+    punpckhdq            m1, m0, m2
+    punpckldq            m0, m2
+    punpckhdq            m3, m4, m6
+    punpckldq            m4, m6
+    punpcklqdq           m2, m1, m3
+    punpckhqdq           m3, m1, m3
+    punpckhqdq           m1, m0, m4
+    punpcklqdq           m0, m4
+%endmacro
+
+%macro TRANSPOSE_8X8 0
+    punpckhwd            m8, m0, m1
+    punpcklwd            m0, m1
+    punpckhwd            m1, m2, m3
+    punpcklwd            m2, m3
+    punpckhwd            m3, m4, m5
+    punpcklwd            m4, m5
+    punpckhwd            m5, m6, m7
+    punpcklwd            m6, m7
+    punpckhdq            m7, m0, m2
+    punpckldq            m0, m2
+    punpckhdq            m2, m4, m6
+    punpckldq            m4, m6
+    punpckhdq            m6, m8, m1
+    punpckldq            m8, m1
+    punpckhdq            m1, m3, m5
+    punpckldq            m3, m5
+    punpckhqdq           m5, m8, m3
+    punpcklqdq           m8, m3
+    punpckhqdq           m3, m7, m2
+    punpcklqdq           m7, m2
+    punpckhqdq           m9, m6, m1
+    punpcklqdq           m6, m1
+    punpckhqdq           m1, m0, m4
+    punpcklqdq           m0, m4
+    mova                 m2, m7
+    mova                 m4, m8
+    mova                 m7, m9
+%endmacro
+
+; add 4 rows of 4 pixels, packed as [r0 r1] [r2 r3] in m%1-m%2
+%macro WRITE_4X4 2 ; src[1-2]
+    movd                 m8, [dstq+strideq*0]
+    pinsrd               m8, [dstq+strideq*1], 1
+    movd                 m9, [dstq+strideq*2]
+    pinsrd               m9, [dstq+r3       ], 1
+    pmovzxbw             m8, m8
+    pmovzxbw             m9, m9
+    paddw               m%1, m8
+    paddw               m%2, m9
+    packuswb            m%1, m%2
+    movd   [dstq+strideq*0], m%1
+    pextrd [dstq+strideq*1], m%1, 1
+    pextrd [dstq+strideq*2], m%1, 2
+    pextrd [dstq+r3       ], m%1, 3
+%endmacro
+
+; add 1 row of 8 pixels
+%macro WRITE_8X1 2 ; src, dst offset
+    movq                 m8, [dstq+%2]
+    pmovzxbw             m8, m8
+    paddw               m%1, m8
+    packuswb            m%1, m%1
+    movq          [dstq+%2], m%1
+%endmacro
+
+INV_TXFM_FN_ALL 4, 8
+
+%macro LOAD_4X8_RECT2 0
+    vpbroadcastd         m8, [pw_2896x8]
+    pmulhrsw             m0, m8, [cq+16*0]
+    pmulhrsw             m1, m8, [cq+16*1]
+    pmulhrsw             m2, m8, [cq+16*2]
+    pmulhrsw             m3, m8, [cq+16*3]
+    vpbroadcastd        m15, [pd_2048]
+%endmacro
+
+cglobal idct_4x8_internal, 0, 5, 16, dst, stride, c, eob, tx2
+    LOAD_4X8_RECT2
+    IDCT4_1D              0, 1, 2, 3, 4, 5
+.pass1_end:
+    TRANSPOSE_4X8
+    jmp                tx2q
+.pass2:
+    IDCT8_1D
+.end:
+    vpbroadcastd         m8, [pw_2048]
+    REPX   {pmulhrsw x, m8}, m0, m1, m2, m3, m4, m5, m6, m7
+    punpcklqdq           m0, m1
+    punpcklqdq           m2, m3
+    punpcklqdq           m4, m5
+    punpcklqdq           m6, m7
+    pxor                 m1, m1
+    REPX {mova [cq+16*x], m1}, 0, 1, 2, 3
+    lea                  r3, [strideq*3]
+    WRITE_4X4             0, 2
+    lea                dstq, [dstq+strideq*4]
+    WRITE_4X4             4, 6
+    RET
+
+cglobal iadst_4x8_internal, 0, 5, 16, dst, stride, c, eob, tx2
+    LOAD_4X8_RECT2
+    IADST4_1D             0, 1, 2, 3
+    jmp m(idct_4x8_internal).pass1_end
+.pass2:
+    IADST8_1D             0
+    jmp m(idct_4x8_internal).end
+
+cglobal iflipadst_4x8_internal, 0, 5, 16, dst, stride, c, eob, tx2
+    LOAD_4X8_RECT2
+    IADST4_1D             3, 2, 1, 0
+    jmp m(idct_4x8_internal).pass1_end
+.pass2:
+    IADST8_1D             1
+    jmp m(idct_4x8_internal).end
+
+cglobal iidentity_4x8_internal, 0, 5, 16, dst, stride, c, eob, tx2
+    LOAD_4X8_RECT2
+    IIDENTITY4_1D
+    jmp m(idct_4x8_internal).pass1_end
+.pass2:
+    IIDENTITY8_1D
+    jmp m(idct_4x8_internal).end
+
+INV_TXFM_FN_ALL 8, 4
+
+%macro LOAD_8X4_RECT2 0
+    movq                 m0, [cq+8*0]
+    movq                 m1, [cq+8*1]
+    movq                 m2, [cq+8*2]
+    movq                 m3, [cq+8*3]
+    movq                 m4, [cq+8*4]
+    movq                 m5, [cq+8*5]
+    movq                 m6, [cq+8*6]
+    movq                 m7, [cq+8*7]
+    vpbroadcastd         m8, [pw_2896x8]
+    REPX   {pmulhrsw x, m8}, m0, m1, m2, m3, m4, m5, m6, m7
+    vpbroadcastd        m15, [pd_2048]
+%endmacro
+
+cglobal idct_8x4_internal, 0, 5, 16, dst, stride, c, eob, tx2
+    LOAD_8X4_RECT2
+    IDCT8_1D
+.pass1_end:
+    TRANSPOSE_8X4
+    jmp                tx2q
+.pass2:
+    IDCT4_1D              0, 1, 2, 3, 4, 5
+.end:
+    vpbroadcastd         m8, [pw_2048]
+    REPX   {pmulhrsw x, m8}, m0, m1, m2, m3
+    pxor                 m4, m4
+    REPX {mova [cq+16*x], m4}, 0, 1, 2, 3
+    lea                  r3, [strideq*3]
+    WRITE_8X1             0, strideq*0
+    WRITE_8X1             1, strideq*1
+    WRITE_8X1             2, strideq*2
+    WRITE_8X1             3, r3
+    RET
+
+cglobal iadst_8x4_internal, 0, 5, 16, dst, stride, c, eob, tx2
+    LOAD_8X4_RECT2
+    IADST8_1D             0
+    jmp m(idct_8x4_internal).pass1_end
+.pass2:
+    IADST4_1D             0, 1, 2, 3
+    jmp m(idct_8x4_internal).end
+
+cglobal iflipadst_8x4_internal, 0, 5, 16, dst, stride, c, eob, tx2
+    LOAD_8X4_RECT2
+    IADST8_1D             1
+    jmp m(idct_8x4_internal).pass1_end
+.pass2:
+    IADST4_1D             3, 2, 1, 0
+    jmp m(idct_8x4_internal).end
+
+cglobal iidentity_8x4_internal, 0, 5, 16, dst, stride, c, eob, tx2
+    LOAD_8X4_RECT2
+    IIDENTITY8_1D
+    jmp m(idct_8x4_internal).pass1_end
+.pass2:
+    IIDENTITY4_1D
+    jmp m(idct_8x4_internal).end
+
+INV_TXFM_FN_ALL 8, 8
+
+%macro LOAD_8X8 0
+    mova                 m0, [cq+16*0]
+    mova                 m1, [cq+16*1]
+    mova                 m2, [cq+16*2]
+    mova                 m3, [cq+16*3]
+    mova                 m4, [cq+16*4]
+    mova                 m5, [cq+16*5]
+    mova                 m6, [cq+16*6]
+    mova                 m7, [cq+16*7]
+    vpbroadcastd        m15, [pd_2048]
+%endmacro
+
+cglobal idct_8x8_internal, 0, 5, 16, dst, stride, c, eob, tx2
+    LOAD_8X8
+    IDCT8_1D
+.pass1_end:
+    vpbroadcastd         m8, [pw_16384]
+    REPX   {pmulhrsw x, m8}, m0, m1, m2, m3, m4, m5, m6, m7
+    TRANSPOSE_8X8
+    jmp                tx2q
+.pass2:
+    IDCT8_1D
+.end:
+    vpbroadcastd         m8, [pw_2048]
+    REPX   {pmulhrsw x, m8}, m0, m1, m2, m3, m4, m5, m6, m7
+    pxor                 m8, m8
+    REPX {mova [cq+16*x], m8}, 0, 1, 2, 3, 4, 5, 6, 7
+    lea                  r3, [strideq*3]
+    WRITE_8X1             0, strideq*0
+    WRITE_8X1             1, strideq*1
+    WRITE_8X1             2, strideq*2
+    WRITE_8X1             3, r3
+    lea                dstq, [dstq+strideq*4]
+    WRITE_8X1             4, strideq*0
+    WRITE_8X1             5, strideq*1
+    WRITE_8X1             6, strideq*2
+    WRITE_8X1             7, r3
+    RET
+
+cglobal iadst_8x8_internal, 0, 5, 16, dst, stride, c, eob, tx2
+    LOAD_8X8
+    IADST8_1D             0
+    jmp m(idct_8x8_internal).pass1_end
+.pass2:
+    IADST8_1D             0
+    jmp m(idct_8x8_internal).end
+
+cglobal iflipadst_8x8_internal, 0, 5, 16, dst, stride, c, eob, tx2
+    LOAD_8X8
+    IADST8_1D             1
+    jmp m(idct_8x8_internal).pass1_end
+.pass2:
+    IADST8_1D             1
+    jmp m(idct_8x8_internal).end
+
+cglobal iidentity_8x8_internal, 0, 5, 16, dst, stride, c, eob, tx2
+    LOAD_8X8
+    IIDENTITY8_1D
+    jmp m(idct_8x8_internal).pass1_end
+.pass2:
+    IIDENTITY8_1D
+    jmp m(idct_8x8_internal).end
+
+%endif ; ARCH_X86_64
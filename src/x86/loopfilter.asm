@@ -0,0 +1,871 @@
+; Copyright © 2018, VideoLAN and dav1d authors
+; Copyright © 2018, Two Orioles, LLC
+; All rights reserved.
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice, this
+;    list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+; ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+; WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+; DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+; ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+; (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+; ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+; (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+; SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+%include "config.asm"
+%include "ext/x86/x86inc.asm"
+
+%if ARCH_X86_64
+
+SECTION_RODATA 32
+
+pb_mask:       db  1,  1,  1,  1,  2,  2,  2,  2,  4,  4,  4,  4,  8,  8,  8,  8
+pb_3_shuf:     db  3,  3,  3,  3,  7,  7,  7,  7, 11, 11, 11, 11, 15, 15, 15, 15
+pb_0_shuf:     db  0,  0,  0,  0,  4,  4,  4,  4,  8,  8,  8,  8, 12, 12, 12, 12
+pb_1:          times 16 db 1
+pb_2:          times 16 db 2
+pb_3:          times 16 db 3
+pb_4:          times 16 db 4
+pb_15:         times 16 db 15
+pb_16:         times 16 db 16
+pb_31:         times 16 db 31
+pb_63:         times 16 db 63
+pb_127:        times 16 db 127
+pb_128:        times 16 db 128
+pw_2048:       times 16 dw 2048
+pw_4096:       times 16 dw 4096
+
+SECTION .text
+
+; Each function filters the edges along one column (h) or row (v) of a
+; superblock, 16 pixels (4 edge segments, one nibble of the masks) at a
+; time. The pixels of such a group are placed in 16 rows of 16 lanes each,
+; named P6-P0/Q0-Q6 below, which for v point straight into the picture and
+; for h into a transposed copy on the stack. Lanes that don't need a given
+; filter width are masked out, so a group only runs the widest filter any
+; of its segments needs.
+
+%macro ABSSUB 4 ; dst, a, b, tmp
+    psubusb              %4, %2, %3
+    psubusb              %1, %3, %2
+    por                  %1, %4
+%endmacro
+
+%macro MAXABS 4 ; acc, a, b, tmp
+    psubusb              %4, %2, %3
+    pmaxub               %1, %4
+    psubusb              %4, %3, %2
+    pmaxub               %1, %4
+%endmacro
+
+%macro LANE_MASK 2 ; dst, bits
+    movd                 %1, %2
+    vpbroadcastb         %1, %1
+    pand                 %1, [pb_mask]
+    pcmpeqb              %1, [pb_mask]
+%endmacro
+
+%macro SRA3 1 ; signed bytes >> 3
+    psrlw                %1, 3
+    pand                 %1, [pb_31]
+    pxor                 %1, [pb_16]
+    psubb                %1, [pb_16]
+%endmacro
+
+; sum += add1 + add2 - sub1 - sub2, then write out (sum + rnd) >> shift
+%macro FLAT_STEP 5-6 ; add1, add2, sub1, sub2, rnd, [out16 idx]
+    pmovzxbw             m9, %1
+    pmovzxbw            m14, %2
+    paddw                m9, m14
+    pmovzxbw            m14, %3
+    pmovzxbw            m15, %4
+    paddw               m14, m15
+    psubw                m9, m14
+    paddw               m10, m9
+%if %0 == 6
+    FLAT_OUT             %5, %6
+%else
+    FLAT_OUT             %5
+%endif
+%endmacro
+
+%macro FLAT_OUT 1-2 ; rnd, [out16 idx]
+    pmulhrsw             m9, m10, [%1]
+    vextracti128       xm14, m9, 1
+    packuswb            xm9, xm14
+%if %0 == 2
+    mova  [OUT16+16*%2], xm9
+%endif
+%endmacro
+
+%macro FLAT16_BLEND 2 ; row, out16 idx
+    movu                xm9, %1
+    vpblendvb           xm9, xm9, [OUT16+16*%2], xm13
+    movu                 %1, xm9
+%endmacro
+
+%macro LOAD_LEVELS 1 ; dir
+    ; lq points to the level of the first segment; a level of zero means
+    ; the level of the neighbouring block on the other side of the edge
+    ; is used instead. The loads are arranged so that they never read
+    ; outside of the level array.
+%ifidn %1, v
+    movu                xm8, [lq-3]
+    movu                xm9, [lq+l_strideq]
+%else
+    movd                xm8, [lq-3]
+    pinsrd              xm8, [lq+l_strideq*1-3], 1
+    pinsrd              xm8, [lq+l_strideq*2-3], 2
+    pinsrd              xm8, [lq+l_stride3q -3], 3
+    movd                xm9, [lq-4]
+    pinsrd              xm9, [lq+l_strideq*1-4], 1
+    pinsrd              xm9, [lq+l_strideq*2-4], 2
+    pinsrd              xm9, [lq+l_stride3q -4], 3
+%endif
+    pshufb              xm8, [pb_3_shuf]
+    pshufb              xm9, [pb_0_shuf]
+    pxor               xm10, xm10
+    pcmpeqb            xm10, xm8
+    pand                xm9, xm10
+    por                 xm8, xm9
+%endmacro
+
+%macro FILTER 2 ; width [4/6/8/16], dir [h/v]
+%ifidn %2, v
+    lea                tmpq, [dstq+mstrideq*4]
+%if %1 == 16
+    lea               tmp2q, [dstq+strideq*4]
+    lea               tmp3q, [dstq+mstrideq*8]
+%endif
+%endif
+%if %1 >= 8
+    movu                xm0, P3
+%endif
+%if %1 >= 6
+    movu                xm1, P2
+%endif
+    movu                xm2, P1
+    movu                xm3, P0
+    movu                xm4, Q0
+    movu                xm5, Q1
+%if %1 >= 6
+    movu                xm6, Q2
+%endif
+%if %1 >= 8
+    movu                xm7, Q3
+%endif
+
+    ; thresholds: E/I/H in m10/m9/m11
+    LOAD_LEVELS          %2
+    psrlq              xm11, xm8, 4
+    pand               xm11, [pb_15]                 ; H
+    vpbroadcastb       xm10, [lutq+136]
+    psrlq               xm9, xm8, [lutq+128]
+    pand                xm9, [pb_63]
+    pminub              xm9, xm10
+    pmaxub              xm9, [pb_1]                  ; I
+    paddb              xm10, xm8, [pb_2]
+    paddb              xm10, xm10
+    paddb              xm10, xm9                     ; E
+
+    ; m12 gathers the lanes where any of the filter conditions fail
+    ABSSUB             xm12, xm3, xm4, xm13          ; abs(p0-q0)
+    paddusb            xm12, xm12
+    ABSSUB             xm13, xm2, xm5, xm14          ; abs(p1-q1)
+    psrlq              xm13, 1
+    pand               xm13, [pb_127]
+    paddusb            xm12, xm13
+    psubusb            xm12, xm10
+
+    ; active lanes have an edge and a non-zero level
+    pxor               xm13, xm13
+    pcmpeqb             xm8, xm13
+    LANE_MASK          xm14, vmd
+    pandn               xm8, xm14
+
+    ABSSUB             xm10, xm2, xm3, xm13          ; abs(p1-p0)
+    MAXABS             xm10, xm5, xm4, xm13          ; abs(q1-q0)
+    psubusb            xm11, xm10, xm11              ; hev if non-zero
+    psubusb            xm13, xm10, xm9
+    por                xm12, xm13
+%if %1 >= 6
+    ABSSUB             xm13, xm1, xm2, xm14          ; abs(p2-p1)
+    MAXABS             xm13, xm6, xm5, xm14          ; abs(q2-q1)
+%if %1 >= 8
+    MAXABS             xm13, xm0, xm1, xm14          ; abs(p3-p2)
+    MAXABS             xm13, xm7, xm6, xm14          ; abs(q3-q2)
+%endif
+    psubusb            xm13, xm9
+    LANE_MASK           xm9, w8d
+    pand               xm13, xm9
+    por                xm12, xm13
+%endif
+    pxor               xm13, xm13
+    pcmpeqb            xm12, xm13
+    pand                xm8, xm12                    ; fm
+    pcmpeqb            xm11, xm13                    ; !hev
+
+%if %1 >= 6
+    ; flat8in
+    MAXABS             xm10, xm1, xm3, xm13          ; abs(p2-p0)
+    MAXABS             xm10, xm6, xm4, xm13          ; abs(q2-q0)
+%if %1 >= 8
+    MAXABS             xm10, xm0, xm3, xm13          ; abs(p3-p0)
+    MAXABS             xm10, xm7, xm4, xm13          ; abs(q3-q0)
+%endif
+    psubusb            xm10, [pb_1]
+    pxor               xm13, xm13
+    pcmpeqb            xm10, xm13
+    pand                xm9, xm8
+    pand               xm12, xm9, xm10               ; flat8
+%endif
+
+%if %1 == 16
+    ; flat8out
+    movu                xm9, P6
+    ABSSUB             xm10, xm9, xm3, xm13
+    movu                xm9, P5
+    MAXABS             xm10, xm9, xm3, xm13
+    movu                xm9, P4
+    MAXABS             xm10, xm9, xm3, xm13
+    movu                xm9, Q4
+    MAXABS             xm10, xm9, xm4, xm13
+    movu                xm9, Q5
+    MAXABS             xm10, xm9, xm4, xm13
+    movu                xm9, Q6
+    MAXABS             xm10, xm9, xm4, xm13
+    psubusb            xm10, [pb_1]
+    pxor               xm13, xm13
+    pcmpeqb            xm10, xm13
+    LANE_MASK          xm13, w16d
+    pand               xm13, xm10
+    pand               xm13, xm12                    ; flat16
+
+    ; 15-tap filter into the temporary buffer
+    ptest              xm13, xm13
+    jz %%no_flat16
+    pmovzxbw             m9, P6
+    psllw               m10, m9, 3
+    psubw               m10, m9                      ; p6*7
+    pmovzxbw             m9, P5
+    pmovzxbw            m14, P4
+    paddw                m9, m14
+    paddw                m9, m9
+    paddw               m10, m9                      ; +p5*2+p4*2
+    pmovzxbw             m9, xm0
+    pmovzxbw            m14, xm1
+    paddw                m9, m14
+    paddw               m10, m9
+    pmovzxbw             m9, xm2
+    pmovzxbw            m14, xm3
+    paddw                m9, m14
+    paddw               m10, m9
+    pmovzxbw             m9, xm4
+    paddw               m10, m9                      ; +p3+p2+p1+p0+q0
+    FLAT_OUT       pw_2048, 0                        ; p5
+    FLAT_STEP  xm5, xm0,  P6,  P6, pw_2048, 1        ; p4
+    FLAT_STEP  xm6, xm1,  P6,  P5, pw_2048, 2        ; p3
+    FLAT_STEP  xm7, xm2,  P6,  P4, pw_2048, 3        ; p2
+    FLAT_STEP   Q4, xm3,  P6, xm0, pw_2048, 4        ; p1
+    FLAT_STEP   Q5, xm4,  P6, xm1, pw_2048, 5        ; p0
+    FLAT_STEP   Q6, xm5,  P6, xm2, pw_2048, 6        ; q0
+    FLAT_STEP   Q6, xm6,  P5, xm3, pw_2048, 7        ; q1
+    FLAT_STEP   Q6, xm7,  P4, xm4, pw_2048, 8        ; q2
+    FLAT_STEP   Q6,  Q4, xm0, xm5, pw_2048, 9        ; q3
+    FLAT_STEP   Q6,  Q5, xm1, xm6, pw_2048, 10       ; q4
+    FLAT_STEP   Q6,  Q6, xm2, xm7, pw_2048, 11       ; q5
+%%no_flat16:
+%endif
+
+%if %1 >= 8
+    ; 7-tap filter, p2/q2 are final, p1-q1 get merged with the 4-tap results
+    ptest              xm12, xm12
+    jz %%no_flat
+    pmovzxbw             m9, xm0
+    paddw               m10, m9, m9
+    paddw               m10, m9                      ; p3*3
+    pmovzxbw             m9, xm1
+    paddw               m10, m9
+    paddw               m10, m9                      ; +p2*2
+    pmovzxbw             m9, xm2
+    pmovzxbw            m14, xm3
+    paddw                m9, m14
+    paddw               m10, m9
+    pmovzxbw             m9, xm4
+    paddw               m10, m9                      ; +p1+p0+q0
+    FLAT_OUT       pw_4096
+    vpblendvb           xm9, xm1, xm9, xm12
+    movu                 P2, xm9
+    FLAT_STEP  xm5, xm2, xm0, xm1, pw_4096
+    movu                 P1, xm9
+    FLAT_STEP  xm6, xm3, xm0, xm2, pw_4096
+    movu                 P0, xm9
+    FLAT_STEP  xm7, xm4, xm0, xm3, pw_4096
+    movu                 Q0, xm9
+    FLAT_STEP  xm7, xm5, xm1, xm4, pw_4096
+    movu                 Q1, xm9
+    FLAT_STEP  xm7, xm6, xm2, xm5, pw_4096
+    vpblendvb           xm9, xm6, xm9, xm12
+    movu                 Q2, xm9
+%%no_flat:
+%elif %1 == 6
+    ; 5-tap filter, merged with the 4-tap results
+    ptest              xm12, xm12
+    jz %%no_flat
+    pmovzxbw             m9, xm1
+    paddw               m10, m9, m9
+    paddw               m10, m9                      ; p2*3
+    pmovzxbw             m9, xm2
+    pmovzxbw            m14, xm3
+    paddw                m9, m14
+    paddw                m9, m9
+    paddw               m10, m9                      ; +p1*2+p0*2
+    pmovzxbw             m9, xm4
+    paddw               m10, m9                      ; +q0
+    FLAT_OUT       pw_4096
+    movu                 P1, xm9
+    FLAT_STEP  xm4, xm5, xm1, xm1, pw_4096
+    movu                 P0, xm9
+    FLAT_STEP  xm5, xm6, xm1, xm2, pw_4096
+    movu                 Q0, xm9
+    FLAT_STEP  xm6, xm6, xm2, xm3, pw_4096
+    movu                 Q1, xm9
+%%no_flat:
+%endif
+
+    ; 4-tap filter
+    mova               xm15, [pb_128]
+    pxor                xm2, xm15
+    pxor                xm3, xm15
+    pxor                xm4, xm15
+    pxor                xm5, xm15
+    psubsb             xm14, xm2, xm5                ; p1-q1
+    pandn              xm14, xm11, xm14              ; only if hev
+    psubsb              xm9, xm4, xm3                ; q0-p0
+    paddsb             xm14, xm9
+    paddsb             xm14, xm9
+    paddsb             xm14, xm9
+    pand               xm14, xm8                     ; f
+    paddsb              xm9, xm14, [pb_4]
+    paddsb             xm10, xm14, [pb_3]
+    SRA3                xm9                          ; f1
+    SRA3               xm10                          ; f2
+    paddsb              xm3, xm10
+    psubsb              xm4, xm9
+    pxor                xm9, xm15
+    pavgb               xm9, xm15
+    pxor                xm9, xm15                    ; (f1+1)>>1
+    pand                xm9, xm11                    ; only if !hev
+    paddsb              xm2, xm9
+    psubsb              xm5, xm9
+    pxor                xm2, xm15
+    pxor                xm3, xm15
+    pxor                xm4, xm15
+    pxor                xm5, xm15
+%if %1 >= 6
+    vpblendvb           xm2, xm2, P1, xm12
+    vpblendvb           xm3, xm3, P0, xm12
+    vpblendvb           xm4, xm4, Q0, xm12
+    vpblendvb           xm5, xm5, Q1, xm12
+%endif
+    movu                 P1, xm2
+    movu                 P0, xm3
+    movu                 Q0, xm4
+    movu                 Q1, xm5
+
+%if %1 == 16
+    ptest              xm13, xm13
+    jz %%end
+    FLAT16_BLEND         P5, 0
+    FLAT16_BLEND         P4, 1
+    FLAT16_BLEND         P3, 2
+    FLAT16_BLEND         P2, 3
+    FLAT16_BLEND         P1, 4
+    FLAT16_BLEND         P0, 5
+    FLAT16_BLEND         Q0, 6
+    FLAT16_BLEND         Q1, 7
+    FLAT16_BLEND         Q2, 8
+    FLAT16_BLEND         Q3, 9
+    FLAT16_BLEND         Q4, 10
+    FLAT16_BLEND         Q5, 11
+%%end:
+%endif
+%endmacro
+
+%macro TRANSPOSE_16X16B 0 ; in: m0-7 = rows n|n+8, out: m0/5/7/4/8/1/2/3 = rows 2n|2n+1
+    punpckhbw            m8, m0, m1
+    punpcklbw            m0, m1
+    punpckhbw            m1, m2, m3
+    punpcklbw            m2, m3
+    punpckhbw            m3, m4, m5
+    punpcklbw            m4, m5
+    punpckhbw            m5, m6, m7
+    punpcklbw            m6, m7
+    punpckhwd            m7, m0, m2
+    punpcklwd            m0, m2
+    punpckhwd            m2, m8, m1
+    punpcklwd            m8, m1
+    punpckhwd            m1, m4, m6
+    punpcklwd            m4, m6
+    punpckhwd            m6, m3, m5
+    punpcklwd            m3, m5
+    punpckhdq            m5, m0, m4
+    punpckldq            m0, m4
+    punpckhdq            m4, m7, m1
+    punpckldq            m7, m1
+    punpckhdq            m1, m8, m3
+    punpckldq            m8, m3
+    punpckhdq            m3, m2, m6
+    punpckldq            m2, m6
+    vpermq               m0, m0, q3120
+    vpermq               m5, m5, q3120
+    vpermq               m7, m7, q3120
+    vpermq               m4, m4, q3120
+    vpermq               m8, m8, q3120
+    vpermq               m1, m1, q3120
+    vpermq               m2, m2, q3120
+    vpermq               m3, m3, q3120
+%endmacro
+
+; h: tmpq/tmp2q/tmp3q point to rows 8/4/12 of the group
+
+%macro TRANSPOSE_LOAD_16 0
+    movu                xm0, [dstq +strideq*0-8]
+    vinserti128          m0, m0, [tmpq +strideq*0-8], 1
+    movu                xm1, [dstq +strideq*1-8]
+    vinserti128          m1, m1, [tmpq +strideq*1-8], 1
+    movu                xm2, [dstq +strideq*2-8]
+    vinserti128          m2, m2, [tmpq +strideq*2-8], 1
+    movu                xm3, [dstq +stride3q -8]
+    vinserti128          m3, m3, [tmpq +stride3q -8], 1
+    movu                xm4, [tmp2q+strideq*0-8]
+    vinserti128          m4, m4, [tmp3q+strideq*0-8], 1
+    movu                xm5, [tmp2q+strideq*1-8]
+    vinserti128          m5, m5, [tmp3q+strideq*1-8], 1
+    movu                xm6, [tmp2q+strideq*2-8]
+    vinserti128          m6, m6, [tmp3q+strideq*2-8], 1
+    movu                xm7, [tmp2q+stride3q -8]
+    vinserti128          m7, m7, [tmp3q+stride3q -8], 1
+    TRANSPOSE_16X16B
+    mova        [rsp+16* 0], xm0
+    vextracti128 [rsp+16* 1], m0, 1
+    mova        [rsp+16* 2], xm5
+    vextracti128 [rsp+16* 3], m5, 1
+    mova        [rsp+16* 4], xm7
+    vextracti128 [rsp+16* 5], m7, 1
+    mova        [rsp+16* 6], xm4
+    vextracti128 [rsp+16* 7], m4, 1
+    mova        [rsp+16* 8], xm8
+    vextracti128 [rsp+16* 9], m8, 1
+    mova        [rsp+16*10], xm1
+    vextracti128 [rsp+16*11], m1, 1
+    mova        [rsp+16*12], xm2
+    vextracti128 [rsp+16*13], m2, 1
+    mova        [rsp+16*14], xm3
+    vextracti128 [rsp+16*15], m3, 1
+%endmacro
+
+%macro TRANSPOSE_STORE_16 0
+    mova                xm0, [rsp+16* 0]
+    vinserti128          m0, m0, [rsp+16* 8], 1
+    mova                xm1, [rsp+16* 1]
+    vinserti128          m1, m1, [rsp+16* 9], 1
+    mova                xm2, [rsp+16* 2]
+    vinserti128          m2, m2, [rsp+16*10], 1
+    mova                xm3, [rsp+16* 3]
+    vinserti128          m3, m3, [rsp+16*11], 1
+    mova                xm4, [rsp+16* 4]
+    vinserti128          m4, m4, [rsp+16*12], 1
+    mova                xm5, [rsp+16* 5]
+    vinserti128          m5, m5, [rsp+16*13], 1
+    mova                xm6, [rsp+16* 6]
+    vinserti128          m6, m6, [rsp+16*14], 1
+    mova                xm7, [rsp+16* 7]
+    vinserti128          m7, m7, [rsp+16*15], 1
+    TRANSPOSE_16X16B
+    movu [dstq +strideq*0-8], xm0
+    vextracti128 [dstq +strideq*1-8], m0, 1
+    movu [dstq +strideq*2-8], xm5
+    vextracti128 [dstq +stride3q -8], m5, 1
+    movu [tmp2q+strideq*0-8], xm7
+    vextracti128 [tmp2q+strideq*1-8], m7, 1
+    movu [tmp2q+strideq*2-8], xm4
+    vextracti128 [tmp2q+stride3q -8], m4, 1
+    movu [tmpq +strideq*0-8], xm8
+    vextracti128 [tmpq +strideq*1-8], m8, 1
+    movu [tmpq +strideq*2-8], xm1
+    vextracti128 [tmpq +stride3q -8], m1, 1
+    movu [tmp3q+strideq*0-8], xm2
+    vextracti128 [tmp3q+strideq*1-8], m2, 1
+    movu [tmp3q+strideq*2-8], xm3
+    vextracti128 [tmp3q+stride3q -8], m3, 1
+%endmacro
+
+%macro TRANSPOSE_LOAD_8 0
+    movq                xm0, [dstq +strideq*0-4]
+    movq                xm8, [dstq +strideq*1-4]
+    punpcklbw           xm0, xm8
+    movq                xm1, [dstq +strideq*2-4]
+    movq                xm8, [dstq +stride3q -4]
+    punpcklbw           xm1, xm8
+    movq                xm2, [tmp2q+strideq*0-4]
+    movq                xm8, [tmp2q+strideq*1-4]
+    punpcklbw           xm2, xm8
+    movq                xm3, [tmp2q+strideq*2-4]
+    movq                xm8, [tmp2q+stride3q -4]
+    punpcklbw           xm3, xm8
+    movq                xm4, [tmpq +strideq*0-4]
+    movq                xm8, [tmpq +strideq*1-4]
+    punpcklbw           xm4, xm8
+    movq                xm5, [tmpq +strideq*2-4]
+    movq                xm8, [tmpq +stride3q -4]
+    punpcklbw           xm5, xm8
+    movq                xm6, [tmp3q+strideq*0-4]
+    movq                xm8, [tmp3q+strideq*1-4]
+    punpcklbw           xm6, xm8
+    movq                xm7, [tmp3q+strideq*2-4]
+    movq                xm8, [tmp3q+stride3q -4]
+    punpcklbw           xm7, xm8
+    punpckhwd           xm8, xm0, xm1
+    punpcklwd           xm0, xm1
+    punpckhwd           xm1, xm2, xm3
+    punpcklwd           xm2, xm3
+    punpckhwd           xm3, xm4, xm5
+    punpcklwd           xm4, xm5
+    punpckhwd           xm5, xm6, xm7
+    punpcklwd           xm6, xm7
+    punpckhdq           xm7, xm0, xm2
+    punpckldq           xm0, xm2
+    punpckhdq           xm2, xm8, xm1
+    punpckldq           xm8, xm1
+    punpckhdq           xm1, xm4, xm6
+    punpckldq           xm4, xm6
+    punpckhdq           xm6, xm3, xm5
+    punpckldq           xm3, xm5
+    punpckhqdq          xm5, xm0, xm4
+    punpcklqdq          xm0, xm4
+    punpckhqdq          xm4, xm7, xm1
+    punpcklqdq          xm7, xm1
+    punpckhqdq          xm1, xm8, xm3
+    punpcklqdq          xm8, xm3
+    punpckhqdq          xm3, xm2, xm6
+    punpcklqdq          xm2, xm6
+    mova                 P3, xm0
+    mova                 P2, xm5
+    mova                 P1, xm7
+    mova                 P0, xm4
+    mova                 Q0, xm8
+    mova                 Q1, xm1
+    mova                 Q2, xm2
+    mova                 Q3, xm3
+%endmacro
+
+%macro TRANSPOSE_STORE_8 0
+    mova                xm0, P3
+    mova                xm1, P2
+    mova                xm2, P1
+    mova                xm3, P0
+    mova                xm4, Q0
+    mova                xm5, Q1
+    mova                xm6, Q2
+    mova                xm7, Q3
+    punpckhbw           xm8, xm0, xm1
+    punpcklbw           xm0, xm1
+    punpckhbw           xm1, xm2, xm3
+    punpcklbw           xm2, xm3
+    punpckhbw           xm3, xm4, xm5
+    punpcklbw           xm4, xm5
+    punpckhbw           xm5, xm6, xm7
+    punpcklbw           xm6, xm7
+    punpckhwd           xm7, xm0, xm2
+    punpcklwd           xm0, xm2
+    punpckhwd           xm2, xm8, xm1
+    punpcklwd           xm8, xm1
+    punpckhwd           xm1, xm4, xm6
+    punpcklwd           xm4, xm6
+    punpckhwd           xm6, xm3, xm5
+    punpcklwd           xm3, xm5
+    punpckhdq           xm5, xm0, xm4
+    punpckldq           xm0, xm4
+    punpckhdq           xm4, xm7, xm1
+    punpckldq           xm7, xm1
+    punpckhdq           xm1, xm8, xm3
+    punpckldq           xm8, xm3
+    punpckhdq           xm3, xm2, xm6
+    punpckldq           xm2, xm6
+    movq   [dstq +strideq*0-4], xm0
+    movhps [dstq +strideq*1-4], xm0
+    movq   [dstq +strideq*2-4], xm5
+    movhps [dstq +stride3q -4], xm5
+    movq   [tmp2q+strideq*0-4], xm7
+    movhps [tmp2q+strideq*1-4], xm7
+    movq   [tmp2q+strideq*2-4], xm4
+    movhps [tmp2q+stride3q -4], xm4
+    movq   [tmpq +strideq*0-4], xm8
+    movhps [tmpq +strideq*1-4], xm8
+    movq   [tmpq +strideq*2-4], xm1
+    movhps [tmpq +stride3q -4], xm1
+    movq   [tmp3q+strideq*0-4], xm2
+    movhps [tmp3q+strideq*1-4], xm2
+    movq   [tmp3q+strideq*2-4], xm3
+    movhps [tmp3q+stride3q -4], xm3
+%endmacro
+
+%macro TRANSPOSE_LOAD_4 0
+    movd                xm0, [dstq +strideq*0-2]
+    movd                xm8, [dstq +strideq*1-2]
+    punpcklbw           xm0, xm8
+    movd                xm1, [dstq +strideq*2-2]
+    movd                xm8, [dstq +stride3q -2]
+    punpcklbw           xm1, xm8
+    movd                xm2, [tmp2q+strideq*0-2]
+    movd                xm8, [tmp2q+strideq*1-2]
+    punpcklbw           xm2, xm8
+    movd                xm3, [tmp2q+strideq*2-2]
+    movd                xm8, [tmp2q+stride3q -2]
+    punpcklbw           xm3, xm8
+    movd                xm4, [tmpq +strideq*0-2]
+    movd                xm8, [tmpq +strideq*1-2]
+    punpcklbw           xm4, xm8
+    movd                xm5, [tmpq +strideq*2-2]
+    movd                xm8, [tmpq +stride3q -2]
+    punpcklbw           xm5, xm8
+    movd                xm6, [tmp3q+strideq*0-2]
+    movd                xm8, [tmp3q+strideq*1-2]
+    punpcklbw           xm6, xm8
+    movd                xm7, [tmp3q+strideq*2-2]
+    movd                xm8, [tmp3q+stride3q -2]
+    punpcklbw           xm7, xm8
+    punpcklwd           xm0, xm1
+    punpcklwd           xm2, xm3
+    punpcklwd           xm4, xm5
+    punpcklwd           xm6, xm7
+    punpckhdq           xm1, xm0, xm2
+    punpckldq           xm0, xm2
+    punpckhdq           xm3, xm4, xm6
+    punpckldq           xm4, xm6
+    punpckhqdq          xm2, xm0, xm4
+    punpcklqdq          xm0, xm4
+    punpckhqdq          xm4, xm1, xm3
+    punpcklqdq          xm1, xm3
+    mova                 P1, xm0
+    mova                 P0, xm2
+    mova                 Q0, xm1
+    mova                 Q1, xm4
+%endmacro
+
+%macro TRANSPOSE_STORE_4 0
+    mova                xm0, P1
+    mova                xm1, P0
+    mova                xm2, Q0
+    mova                xm3, Q1
+    punpckhbw           xm4, xm0, xm1
+    punpcklbw           xm0, xm1
+    punpckhbw           xm1, xm2, xm3
+    punpcklbw           xm2, xm3
+    punpckhwd           xm3, xm0, xm2
+    punpcklwd           xm0, xm2
+    punpckhwd           xm2, xm4, xm1
+    punpcklwd           xm4, xm1
+    movd   [dstq +strideq*0-2], xm0
+    pextrd [dstq +strideq*1-2], xm0, 1
+    pextrd [dstq +strideq*2-2], xm0, 2
+    pextrd [dstq +stride3q -2], xm0, 3
+    movd   [tmp2q+strideq*0-2], xm3
+    pextrd [tmp2q+strideq*1-2], xm3, 1
+    pextrd [tmp2q+strideq*2-2], xm3, 2
+    pextrd [tmp2q+stride3q -2], xm3, 3
+    movd   [tmpq +strideq*0-2], xm4
+    pextrd [tmpq +strideq*1-2], xm4, 1
+    pextrd [tmpq +strideq*2-2], xm4, 2
+    pextrd [tmpq +stride3q -2], xm4, 3
+    movd   [tmp3q+strideq*0-2], xm2
+    pextrd [tmp3q+strideq*1-2], xm2, 1
+    pextrd [tmp3q+strideq*2-2], xm2, 2
+    pextrd [tmp3q+stride3q -2], xm2, 3
+%endmacro
+
+%macro LPF_MASKS 1 ; is_luma
+%if %1
+    mov                w16d, [maskq+8]
+    mov                 w8d, [maskq+4]
+    or                  w8d, w16d
+%else
+    mov                 w8d, [maskq+4]
+%endif
+    mov                 vmd, [maskq+0]
+    or                  vmd, w8d
+%endmacro
+
+%macro LPF_NEXT 1 ; is_luma
+%if %1
+    shr                w16d, 4
+%endif
+    shr                 w8d, 4
+    shr                 vmd, 4
+    jnz .loop
+%endmacro
+
+INIT_YMM avx2
+; v filters work in place on the picture
+%define P6 [tmp3q+strideq*1]
+%define P5 [tmp3q+strideq*2]
+%define P4 [tmp3q+stride3q ]
+%define P3 [tmpq +strideq*0]
+%define P2 [tmpq +strideq*1]
+%define P1 [tmpq +strideq*2]
+%define P0 [tmpq +stride3q ]
+%define Q0 [dstq +strideq*0]
+%define Q1 [dstq +strideq*1]
+%define Q2 [dstq +strideq*2]
+%define Q3 [dstq +stride3q ]
+%define Q4 [tmp2q+strideq*0]
+%define Q5 [tmp2q+strideq*1]
+%define Q6 [tmp2q+strideq*2]
+%define OUT16 rsp
+
+cglobal lpf_v_sb_y, 6, 14, 16, 16*12, dst, stride, mask, l, l_stride, lut, \
+                                      vm, w8, w16, stride3, mstride, tmp, tmp2, tmp3
+    LPF_MASKS             1
+    shl           l_strideq, 2
+    neg           l_strideq
+    lea            stride3q, [strideq*3]
+    mov            mstrideq, strideq
+    neg            mstrideq
+.loop:
+    test                vmd, 0xf
+    jz .no_filter
+    test               w16d, 0xf
+    jnz .filter16
+    test                w8d, 0xf
+    jnz .filter8
+    FILTER                4, v
+    jmp .no_filter
+.filter8:
+    FILTER                8, v
+    jmp .no_filter
+.filter16:
+    FILTER               16, v
+.no_filter:
+    add                dstq, 16
+    add                  lq, 16
+    LPF_NEXT              1
+    RET
+
+cglobal lpf_v_sb_uv, 6, 11, 16, dst, stride, mask, l, l_stride, lut, \
+                                vm, w8, stride3, mstride, tmp
+    LPF_MASKS             0
+    shl           l_strideq, 2
+    neg           l_strideq
+    lea            stride3q, [strideq*3]
+    mov            mstrideq, strideq
+    neg            mstrideq
+.loop:
+    test                vmd, 0xf
+    jz .no_filter
+    test                w8d, 0xf
+    jnz .filter6
+    FILTER                4, v
+    jmp .no_filter
+.filter6:
+    FILTER                6, v
+.no_filter:
+    add                dstq, 16
+    add                  lq, 16
+    LPF_NEXT              0
+    RET
+
+; h filters work on a transposed copy, P7 is at rsp and Q7 at rsp+15*16
+%define P6 [rsp+16* 1]
+%define P5 [rsp+16* 2]
+%define P4 [rsp+16* 3]
+%define P3 [rsp+16* 4]
+%define P2 [rsp+16* 5]
+%define P1 [rsp+16* 6]
+%define P0 [rsp+16* 7]
+%define Q0 [rsp+16* 8]
+%define Q1 [rsp+16* 9]
+%define Q2 [rsp+16*10]
+%define Q3 [rsp+16*11]
+%define Q4 [rsp+16*12]
+%define Q5 [rsp+16*13]
+%define Q6 [rsp+16*14]
+%define OUT16 rsp+16*16
+
+cglobal lpf_h_sb_y, 6, 14, 16, 16*28, dst, stride, mask, l, l_stride, lut, \
+                                      vm, w8, w16, stride3, l_stride3, tmp, tmp2, tmp3
+    LPF_MASKS             1
+    shl           l_strideq, 2
+    lea          l_stride3q, [l_strideq*3]
+    lea            stride3q, [strideq*3]
+.loop:
+    test                vmd, 0xf
+    jz .no_filter
+    lea               tmp2q, [dstq+strideq*4]
+    lea                tmpq, [dstq+strideq*8]
+    lea               tmp3q, [tmp2q+strideq*8]
+    test               w16d, 0xf
+    jnz .filter16
+    test                w8d, 0xf
+    jnz .filter8
+    TRANSPOSE_LOAD_4
+    FILTER                4, h
+    TRANSPOSE_STORE_4
+    jmp .no_filter
+.filter8:
+    TRANSPOSE_LOAD_8
+    FILTER                8, h
+    TRANSPOSE_STORE_8
+    jmp .no_filter
+.filter16:
+    TRANSPOSE_LOAD_16
+    FILTER               16, h
+    TRANSPOSE_STORE_16
+.no_filter:
+    lea                dstq, [dstq+strideq*8]
+    lea                dstq, [dstq+strideq*8]
+    lea                  lq, [lq+l_strideq*4]
+    LPF_NEXT              1
+    RET
+
+cglobal lpf_h_sb_uv, 6, 13, 16, 16*12, dst, stride, mask, l, l_stride, lut, \
+                                       vm, w8, stride3, l_stride3, tmp, tmp2, tmp3
+    LPF_MASKS             0
+    shl           l_strideq, 2
+    lea          l_stride3q, [l_strideq*3]
+    lea            stride3q, [strideq*3]
+.loop:
+    test                vmd, 0xf
+    jz .no_filter
+    lea               tmp2q, [dstq+strideq*4]
+    lea                tmpq, [dstq+strideq*8]
+    lea               tmp3q, [tmp2q+strideq*8]
+    test                w8d, 0xf
+    jnz .filter6
+    TRANSPOSE_LOAD_4
+    FILTER                4, h
+    TRANSPOSE_STORE_4
+    jmp .no_filter
+.filter6:
+    TRANSPOSE_LOAD_8
+    FILTER                6, h
+    TRANSPOSE_STORE_8
+.no_filter:
+    lea                dstq, [dstq+strideq*8]
+    lea                dstq, [dstq+strideq*8]
+    lea                  lq, [lq+l_strideq*4]
+    LPF_NEXT              0
+    RET
+
+%endif ; ARCH_X86_64
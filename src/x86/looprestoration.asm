@@ -0,0 +1,593 @@
+; Copyright © 2018, VideoLAN and dav1d authors
+; Copyright © 2018, Two Orioles, LLC
+; All rights reserved.
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice, this
+;    list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+; ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+; WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+; DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+; ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+; (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+; ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+; (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+; SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+%include "config.asm"
+%include "ext/x86/x86inc.asm"
+
+%if ARCH_X86_64
+
+SECTION_RODATA 32
+
+pw_0_128:      times 8 dw 0, 128
+pw_8192:       times 2 dw 8192
+pd_16388:      dd 16388 ; (1 << 14) + (1 << 2)
+pd_m261120:    dd -261120 ; (1 << 10) - (1 << 18)
+pd_1024:       dd 1024
+pd_255:        dd 255
+pd_256:        dd 256
+pd_2048:       dd 2048
+pd_0x80000:    dd 0x80000
+pd_9:          dd 9
+pd_25:         dd 25
+pd_455:        dd 455 ; sgr_one_by_x[8]
+pd_164:        dd 164 ; sgr_one_by_x[24]
+
+; sgr_x_by_xplus1 from tables.c, expanded to dwords for vpgatherdd
+sgr_x_by_xplus1: dd   1, 128, 171, 192, 205, 213, 219, 224, 228, 230, 233, 235, 236, 238, 239, 240
+                 dd 241, 242, 243, 243, 244, 244, 245, 245, 246, 246, 247, 247, 247, 247, 248, 248
+                 dd 248, 248, 249, 249, 249, 249, 249, 250, 250, 250, 250, 250, 250, 250, 251, 251
+                 dd 251, 251, 251, 251, 251, 251, 251, 251, 252, 252, 252, 252, 252, 252, 252, 252
+                 dd 252, 252, 252, 252, 252, 252, 252, 252, 252, 253, 253, 253, 253, 253, 253, 253
+                 dd 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253
+                 dd 253, 253, 253, 253, 253, 253, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254
+                 dd 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254
+                 dd 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254
+                 dd 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254
+                 dd 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 255, 255, 255, 255, 255, 255
+                 dd 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255
+                 dd 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255
+                 dd 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255
+                 dd 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255
+                 dd 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 256
+
+SECTION .text
+
+%define REST_UNIT_STRIDE 390
+%define SGR_STRIDE (384 + 32)
+
+; The padded unit, the intermediate buffers and the box sums are laid out
+; as described in looprestoration_init.c. All functions process blocks of
+; 16 (or 8) pixels and may read and write past w.
+
+INIT_YMM avx2
+cglobal wiener_filter_h, 5, 6, 16, dst, src, fh, w, h, x
+    vpbroadcastd    m14, [fhq+0]     ; f0 f1
+    vpbroadcastd    m15, [fhq+4]     ; f2 f3
+    paddw           m15, [pw_0_128]  ; f2 f3+128
+    vpbroadcastd    m13, [pd_16388]
+    vpbroadcastd    m11, [pw_8192]
+    pxor            m12, m12
+.loop_y:
+    xor              xd, xd
+.loop_x:
+    pmovzxbw         m0, [srcq+xq+0]
+    pmovzxbw         m1, [srcq+xq+1]
+    pmovzxbw         m2, [srcq+xq+2]
+    pmovzxbw         m3, [srcq+xq+3]
+    pmovzxbw         m4, [srcq+xq+4]
+    pmovzxbw         m5, [srcq+xq+5]
+    pmovzxbw         m6, [srcq+xq+6]
+    ; the filter is symmetric, so pair up the taps on either side
+    paddw            m0, m6
+    paddw            m1, m5
+    paddw            m2, m4
+    punpcklwd        m4, m0, m1
+    punpckhwd        m0, m1
+    punpcklwd        m5, m2, m3
+    punpckhwd        m2, m3
+    pmaddwd          m4, m14
+    pmaddwd          m0, m14
+    pmaddwd          m5, m15
+    pmaddwd          m2, m15
+    paddd            m4, m5
+    paddd            m0, m2
+    paddd            m4, m13
+    paddd            m0, m13
+    psrad            m4, 3
+    psrad            m0, 3
+    packssdw         m4, m0
+    pmaxsw           m4, m12
+    pminsw           m4, m11
+    movu    [dstq+xq*2], m4
+    add              xd, 16
+    cmp              xd, wd
+    jl .loop_x
+    add            srcq, REST_UNIT_STRIDE
+    add            dstq, 384*2
+    dec              hd
+    jg .loop_y
+    RET
+
+cglobal wiener_filter_v, 6, 9, 16, dst, stride, mid, w, h, fv, dptr, mptr, y
+    vpbroadcastd    m14, [fvq+0]
+    vpbroadcastd    m15, [fvq+4]
+    paddw           m15, [pw_0_128]
+    vpbroadcastd    m13, [pd_m261120]
+.loop_x:
+    mov  dptrq, dstq
+    mov  mptrq, midq
+    mov              yd, hd
+    movu             m0, [mptrq+384*2*0]
+    movu             m1, [mptrq+384*2*1]
+    movu             m2, [mptrq+384*2*2]
+    movu             m3, [mptrq+384*2*3]
+    movu             m4, [mptrq+384*2*4]
+    movu             m5, [mptrq+384*2*5]
+    add  mptrq, 384*2*6
+.loop_y:
+    movu             m6, [mptrq]
+    paddw            m7, m0, m6
+    paddw            m8, m1, m5
+    paddw            m9, m2, m4
+    punpcklwd       m10, m7, m8
+    punpckhwd        m7, m8
+    punpcklwd        m8, m9, m3
+    punpckhwd        m9, m3
+    pmaddwd         m10, m14
+    pmaddwd          m7, m14
+    pmaddwd          m8, m15
+    pmaddwd          m9, m15
+    paddd           m10, m8
+    paddd            m7, m9
+    paddd           m10, m13
+    paddd            m7, m13
+    psrad           m10, 11
+    psrad            m7, 11
+    packssdw        m10, m7
+    vextracti128    xm7, m10, 1
+    packuswb       xm10, xm7
+    movu           [dptrq], xm10
+    mova             m0, m1
+    mova             m1, m2
+    mova             m2, m3
+    mova             m3, m4
+    mova             m4, m5
+    mova             m5, m6
+    add  mptrq, 384*2
+    add  dptrq, strideq
+    dec              yd
+    jg .loop_y
+    add            dstq, 16
+    add            midq, 16*2
+    sub              wd, 16
+    jg .loop_x
+    RET
+
+; Horizontal box sums over 2*r+1 pixels for rows -1-r to h+1+r and
+; columns -1 to w+1
+%macro SGR_BOX_H 1 ; r
+cglobal sgr_box%1_h, 5, 6, 8, sumsq, sum, src, w, h, x
+%assign r ((%1 - 1) / 2)
+    add            srcq, (2 - r) * REST_UNIT_STRIDE + 2 - r
+    sub            sumq, ((1 + r) * SGR_STRIDE + 1) * 2
+    sub          sumsqq, ((1 + r) * SGR_STRIDE + 1) * 4
+    add              hd, 2 + 2 * r
+    add              wd, 2
+.loop_y:
+    xor              xd, xd
+.loop_x:
+    pmovzxbw         m0, [srcq+xq+0]
+    pmovzxbw         m1, [srcq+xq+1]
+    pmovzxbw         m2, [srcq+xq+2]
+    paddw            m0, m1
+    paddw            m0, m2
+%if r == 2
+    pmovzxbw         m1, [srcq+xq+3]
+    pmovzxbw         m2, [srcq+xq+4]
+    paddw            m0, m1
+    paddw            m0, m2
+%endif
+    movu    [sumq+xq*2], m0
+%assign i 0
+%rep 2
+    pmovzxbd         m0, [srcq+xq+i+0]
+    pmovzxbd         m1, [srcq+xq+i+1]
+    pmovzxbd         m2, [srcq+xq+i+2]
+    pmaddwd          m0, m0
+    pmaddwd          m1, m1
+    pmaddwd          m2, m2
+    paddd            m0, m1
+    paddd            m0, m2
+%if r == 2
+    pmovzxbd         m1, [srcq+xq+i+3]
+    pmovzxbd         m2, [srcq+xq+i+4]
+    pmaddwd          m1, m1
+    pmaddwd          m2, m2
+    paddd            m0, m1
+    paddd            m0, m2
+%endif
+    movu [sumsqq+xq*4+i*4], m0
+%assign i i+8
+%endrep
+    add              xd, 16
+    cmp              xd, wd
+    jl .loop_x
+    add            srcq, REST_UNIT_STRIDE
+    add            sumq, SGR_STRIDE*2
+    add          sumsqq, SGR_STRIDE*4
+    dec              hd
+    jg .loop_y
+    RET
+%endmacro
+
+SGR_BOX_H 3
+SGR_BOX_H 5
+
+; Vertical sums over 2*r+1 rows of the horizontal sums, in place, for
+; rows -1 to h+1 (every other row for r=2) and columns -1 to w+1
+%macro SGR_BOX_V_PASS 4 ; buf, elem size, add op, r
+    mov              xq, %1q
+    mov              wd, w2d
+.loop_x_%2:
+    mov              pq, xq
+    mov              yd, cntd
+    movu             m0, [pq+SGR_STRIDE*%2*0]
+    movu             m1, [pq+SGR_STRIDE*%2*1]
+%if %4 == 2
+    movu             m2, [pq+SGR_STRIDE*%2*2]
+%endif
+.loop_y_%2:
+%if %4 == 1
+    movu             m2, [pq+SGR_STRIDE*%2*2]
+    %3               m3, m0, m1
+    %3               m3, m2
+    movu [pq+SGR_STRIDE*%2*1], m3
+    mova             m0, m1
+    mova             m1, m2
+    add              pq, SGR_STRIDE*%2
+%else
+    movu             m3, [pq+SGR_STRIDE*%2*3]
+    movu             m4, [pq+SGR_STRIDE*%2*4]
+    %3               m5, m0, m1
+    %3               m5, m2
+    %3               m5, m3
+    %3               m5, m4
+    movu [pq+SGR_STRIDE*%2*2], m5
+    mova             m0, m2
+    mova             m1, m3
+    mova             m2, m4
+    add              pq, SGR_STRIDE*%2*2
+%endif
+    dec              yd
+    jg .loop_y_%2
+    add              xq, mmsize
+    sub              wd, mmsize / %2
+    jg .loop_x_%2
+%endmacro
+
+%macro SGR_BOX_V 1 ; r
+cglobal sgr_box%1_v, 4, 9, 8, sumsq, sum, w, h, x, p, y, w2, cnt
+%assign r ((%1 - 1) / 2)
+    sub            sumq, ((1 + r) * SGR_STRIDE + 1) * 2
+    sub          sumsqq, ((1 + r) * SGR_STRIDE + 1) * 4
+    lea             w2d, [wq+2]
+%if r == 1
+    lea            cntd, [hq+2]
+%else
+    lea            cntd, [hq+3]
+    shr            cntd, 1
+%endif
+    SGR_BOX_V_PASS  sum, 2, paddw, r
+    SGR_BOX_V_PASS sumsq, 4, paddd, r
+    RET
+%endmacro
+
+SGR_BOX_V 3
+SGR_BOX_V 5
+
+; Computes, for rows -1 to h+1 (every other row for n=25) and columns -1
+; to w+1, the a and b coefficients of the self-guided filter from the box
+; sums, in place: sumsq is replaced by a and sum by b
+%macro SGR_CALC_AB 3 ; idx, n, one_by_x
+cglobal sgr_calc_ab%1, 5, 7, 16, a, b, w, h, s, x, t
+    movd           xm15, sd
+    vpbroadcastd    m15, xm15
+    vpbroadcastd    m14, [pd_%2]
+    vpbroadcastd    m13, [pd_0x80000]
+    vpbroadcastd    m12, [pd_255]
+    vpbroadcastd    m11, [pd_256]
+    vpbroadcastd    m10, [pd_%3]
+    vpbroadcastd     m9, [pd_2048]
+    pxor             m8, m8
+    lea              tq, [sgr_x_by_xplus1]
+    sub              aq, (SGR_STRIDE + 1) * 4
+    sub              bq, (SGR_STRIDE + 1) * 2
+    add              wd, 2
+%if %2 == 9
+    add              hd, 2
+%else
+    add              hd, 3
+    shr              hd, 1
+%endif
+.loop_y:
+    xor              xd, xd
+.loop_x:
+    movu             m0, [aq+xq*4]
+    pmovzxwd         m1, [bq+xq*2]
+    pmulld           m0, m14
+    pmaddwd          m2, m1, m1
+    psubd            m0, m2
+    pmaxsd           m0, m8           ; p
+    pmulld           m0, m15
+    paddd            m0, m13
+    psrld            m0, 20
+    pminud           m0, m12          ; z
+    pcmpeqd          m3, m3
+    vpgatherdd       m2, [tq+m0*4], m3 ; x
+    psubd            m0, m11, m2
+    pmulld           m0, m1
+    pmulld           m0, m10
+    paddd            m0, m9
+    psrld            m0, 12
+    movu    [aq+xq*4], m0
+    vextracti128    xm3, m2, 1
+    packusdw        xm2, xm3
+    movu    [bq+xq*2], xm2
+    add              xd, 8
+    cmp              xd, wd
+    jl .loop_x
+%if %2 == 9
+    add              aq, SGR_STRIDE*4
+    add              bq, SGR_STRIDE*2
+%else
+    add              aq, SGR_STRIDE*4*2
+    add              bq, SGR_STRIDE*2*2
+%endif
+    dec              hd
+    jg .loop_y
+    RET
+%endmacro
+
+SGR_CALC_AB 1,  9, 455
+SGR_CALC_AB 2, 25, 164
+
+; Sum of the pixel at (row, col) and its left and right neighbours, as
+; dwords, for 8 columns
+%macro SUM3 4 ; dst, tmp, row offset, load (0 = a, 1 = b)
+%if %4
+    pmovzxwd         %1, [bq+xq*2+%3*SGR_STRIDE*2-2]
+    pmovzxwd         %2, [bq+xq*2+%3*SGR_STRIDE*2+0]
+    paddd            %1, %2
+    pmovzxwd         %2, [bq+xq*2+%3*SGR_STRIDE*2+2]
+%else
+    movu             %1, [aq+xq*4+%3*SGR_STRIDE*4-4]
+    paddd            %1, [aq+xq*4+%3*SGR_STRIDE*4+0]
+    movu             %2, [aq+xq*4+%3*SGR_STRIDE*4+4]
+%endif
+    paddd            %1, %2
+%endmacro
+
+; Weighted 3x3 sum, with weights 4 for the centre and the direct
+; neighbours and 3 for the diagonals: 3 * box + cross
+%macro EIGHT 2 ; dst, load (0 = a, 1 = b)
+    SUM3             m0, m1, -1, %2
+    SUM3             m2, m1,  0, %2
+    SUM3             m3, m1,  1, %2
+    paddd            m0, m3
+    paddd            m0, m2           ; box
+%if %2
+    pmovzxwd         m1, [bq+xq*2-SGR_STRIDE*2]
+    pmovzxwd         m3, [bq+xq*2+SGR_STRIDE*2]
+%else
+    movu             m1, [aq+xq*4-SGR_STRIDE*4]
+    movu             m3, [aq+xq*4+SGR_STRIDE*4]
+%endif
+    paddd            m2, m1
+    paddd            m2, m3           ; cross
+    pslld            %1, m0, 1
+    paddd            %1, m0
+    paddd            %1, m2
+%endmacro
+
+INIT_YMM avx2
+cglobal sgr_finish_filter1, 6, 7, 8, t, src, a, b, w, h, x
+    add            srcq, 3 * REST_UNIT_STRIDE + 3
+    vpbroadcastd     m7, [pd_256]
+.loop_y:
+    xor              xd, xd
+.loop_x:
+    EIGHT            m4, 1
+    EIGHT            m5, 0
+    pmovzxbd         m0, [srcq+xq]
+    pmulld           m4, m0
+    paddd            m4, m5
+    paddd            m4, m7
+    psrad            m4, 9
+    vextracti128    xm0, m4, 1
+    packssdw        xm4, xm0
+    movu      [tq+xq*2], xm4
+    add              xd, 8
+    cmp              xd, wd
+    jl .loop_x
+    add            srcq, REST_UNIT_STRIDE
+    add              aq, SGR_STRIDE*4
+    add              bq, SGR_STRIDE*2
+    add              tq, 384*2
+    dec              hd
+    jg .loop_y
+    RET
+
+; Rows with the box sums above and below: 6 for the pixels directly above
+; and below, 5 for the diagonals, i.e. 5 * (row above + row below) + cross
+%macro SIX 2 ; dst, load (0 = a, 1 = b)
+    SUM3             m0, m1, -1, %2
+    SUM3             m2, m1,  1, %2
+    paddd            m0, m2
+%if %2
+    pmovzxwd         m1, [bq+xq*2-SGR_STRIDE*2]
+    pmovzxwd         m3, [bq+xq*2+SGR_STRIDE*2]
+%else
+    movu             m1, [aq+xq*4-SGR_STRIDE*4]
+    movu             m3, [aq+xq*4+SGR_STRIDE*4]
+%endif
+    paddd            m1, m3
+    pslld            %1, m0, 2
+    paddd            %1, m0
+    paddd            %1, m1
+%endmacro
+
+; Rows with box sums: 6 for the centre, 5 for the left and right
+%macro SIX_ODD 2 ; dst, load (0 = a, 1 = b)
+    SUM3             m0, m1, 0, %2
+%if %2
+    pmovzxwd         m1, [bq+xq*2]
+%else
+    movu             m1, [aq+xq*4]
+%endif
+    pslld            %1, m0, 2
+    paddd            %1, m0
+    paddd            %1, m1
+%endmacro
+
+cglobal sgr_finish_filter2, 6, 7, 8, t, src, a, b, w, h, x
+    add            srcq, 3 * REST_UNIT_STRIDE + 3
+    vpbroadcastd     m7, [pd_256]
+    psrld            m6, m7, 1
+.loop_y:
+    xor              xd, xd
+.loop_x_even:
+    SIX              m4, 1
+    SIX              m5, 0
+    pmovzxbd         m0, [srcq+xq]
+    pmulld           m4, m0
+    paddd            m4, m5
+    paddd            m4, m7
+    psrad            m4, 9
+    vextracti128    xm0, m4, 1
+    packssdw        xm4, xm0
+    movu      [tq+xq*2], xm4
+    add              xd, 8
+    cmp              xd, wd
+    jl .loop_x_even
+    dec              hd
+    jz .end
+    add            srcq, REST_UNIT_STRIDE
+    add              aq, SGR_STRIDE*4
+    add              bq, SGR_STRIDE*2
+    add              tq, 384*2
+    xor              xd, xd
+.loop_x_odd:
+    SIX_ODD          m4, 1
+    SIX_ODD          m5, 0
+    pmovzxbd         m0, [srcq+xq]
+    pmulld           m4, m0
+    paddd            m4, m5
+    paddd            m4, m6
+    psrad            m4, 8
+    vextracti128    xm0, m4, 1
+    packssdw        xm4, xm0
+    movu      [tq+xq*2], xm4
+    add              xd, 8
+    cmp              xd, wd
+    jl .loop_x_odd
+    add            srcq, REST_UNIT_STRIDE
+    add              aq, SGR_STRIDE*4
+    add              bq, SGR_STRIDE*2
+    add              tq, 384*2
+    dec              hd
+    jg .loop_y
+.end:
+    RET
+
+cglobal sgr_weighted1, 6, 7, 8, dst, stride, t, w, h, wt, x
+    shl             wtd, 16
+    or              wtd, 1 << 7
+    movd            xm5, wtd
+    vpbroadcastd     m5, xm5          ; 128 wt
+    vpbroadcastd     m4, [pd_1024]
+.loop_y:
+    xor              xd, xd
+.loop_x:
+    pmovzxbw         m0, [dstq+xq]
+    psllw            m0, 4            ; u
+    movu             m1, [tq+xq*2]
+    psubw            m1, m0
+    punpcklwd        m2, m0, m1
+    punpckhwd        m0, m1
+    pmaddwd          m2, m5
+    pmaddwd          m0, m5
+    paddd            m2, m4
+    paddd            m0, m4
+    psrad            m2, 11
+    psrad            m0, 11
+    packssdw         m2, m0
+    vextracti128    xm0, m2, 1
+    packuswb        xm2, xm0
+    movu    [dstq+xq], xm2
+    add              xd, 16
+    cmp              xd, wd
+    jl .loop_x
+    add            dstq, strideq
+    add              tq, 384*2
+    dec              hd
+    jg .loop_y
+    RET
+
+cglobal sgr_weighted2, 8, 9, 8, dst, stride, t1, t2, w, h, w0, w1, x
+    shl             w1d, 16
+    movzx           w0d, w0w
+    or              w0d, w1d
+    movd            xm5, w0d
+    vpbroadcastd     m5, xm5          ; w0 w1
+    vpbroadcastd     m4, [pd_1024]
+    pxor             m6, m6
+.loop_y:
+    xor              xd, xd
+.loop_x:
+    pmovzxbw         m0, [dstq+xq]
+    psllw            m0, 4            ; u
+    movu             m1, [t1q+xq*2]
+    movu             m2, [t2q+xq*2]
+    psubw            m1, m0
+    psubw            m2, m0
+    punpcklwd        m3, m1, m2
+    punpckhwd        m1, m2
+    pmaddwd          m3, m5
+    pmaddwd          m1, m5
+    punpcklwd        m2, m0, m6
+    punpckhwd        m0, m6
+    pslld            m2, 7
+    pslld            m0, 7
+    paddd            m3, m2
+    paddd            m1, m0
+    paddd            m3, m4
+    paddd            m1, m4
+    psrad            m3, 11
+    psrad            m1, 11
+    packssdw         m3, m1
+    vextracti128    xm1, m3, 1
+    packuswb        xm3, xm1
+    movu    [dstq+xq], xm3
+    add              xd, 16
+    cmp              xd, wd
+    jl .loop_x
+    add            dstq, strideq
+    add             t1q, 384*2
+    add             t2q, 384*2
+    dec              hd
+    jg .loop_y
+    RET
+
+%endif ; ARCH_X86_64
@@ -38,35 +38,55 @@ subpel_h_shufC: db 8,  9, 10, 11,  9, 10, 11, 12, 10, 11, 12, 13, 11, 12, 13, 14
 bilin_h_shuf4:  db 1,  0,  2,  1,  3,  2,  4,  3,  9,  8, 10,  9, 11, 10, 12, 11
 bilin_h_shuf8:  db 1,  0,  2,  1,  3,  2,  4,  3,  5,  4,  6,  5,  7,  6,  8,  7
 deint_shuf4:    db 0,  4,  1,  5,  2,  6,  3,  7,  4,  8,  5,  9,  6, 10,  7, 11
+warp_8x8_shufA: db 0,  2,  1,  3,  2,  4,  3,  5,  4,  6,  5,  7,  6,  8,  7,  9
+                db 0,  2,  1,  3,  2,  4,  3,  5,  4,  6,  5,  7,  6,  8,  7,  9
+warp_8x8_shufB: db 1,  3,  2,  4,  3,  5,  4,  6,  5,  7,  6,  8,  7,  9,  8, 10
+                db 1,  3,  2,  4,  3,  5,  4,  6,  5,  7,  6,  8,  7,  9,  8, 10
+warp_8x8_shufC: db 0,  2,  1,  3,  4,  6,  5,  7,  8, 10,  9, 11, 12, 14, 13, 15
+                db 0,  2,  1,  3,  4,  6,  5,  7,  8, 10,  9, 11, 12, 14, 13, 15
+warp_8x8_shufD: db 0,  1,  8,  9,  2,  3, 10, 11,  4,  5, 12, 13,  6,  7, 14, 15
+                db 0,  1,  8,  9,  2,  3, 10, 11,  4,  5, 12, 13,  6,  7, 14, 15
 
+pb_64:   times 4 db 64
 pw_8:    times 2 dw 8
 pw_26:   times 2 dw 26
 pw_34:   times 2 dw 34
+pw_129:  times 2 dw 129
 pw_258:  times 2 dw 258
 pw_512:  times 2 dw 512
 pw_1024: times 2 dw 1024
 pw_2048: times 2 dw 2048
 pw_8192: times 2 dw 8192
+pw_16388: times 2 dw 16388
 pd_32:   dd 32
 pd_512:  dd 512
+pd_m261120: dd -261120
+pd_m262080: dd -262080
 
 cextern mc_subpel_filters
+cextern mc_warp_filter
 %define subpel_filters (mangle(private_prefix %+ _mc_subpel_filters)-8)
+%define warp_filters (mangle(private_prefix %+ _mc_warp_filter)+64*8)
 
-%macro BIDIR_JMP_TABLE 1-7 4, 8, 16, 32, 64, 128
-    %xdefine %1_table (%%table - 2*4)
+%macro BIDIR_JMP_TABLE 1-*
+    %xdefine %1_table (%%table - 2*%2)
+    %xdefine %%base %1_table
     %xdefine %%prefix mangle(private_prefix %+ _%1)
     %%table:
-    %rep 6
-        dd %%prefix %+ .w%2 - (%%table - 2*4)
+    %rep %0 - 1
+        dd %%prefix %+ .w%2 - %%base
         %rotate 1
     %endrep
 %endmacro
 
-BIDIR_JMP_TABLE avg_avx2
-BIDIR_JMP_TABLE w_avg_avx2
-BIDIR_JMP_TABLE mask_avx2
-BIDIR_JMP_TABLE w_mask_420_avx2
+BIDIR_JMP_TABLE avg_avx2,        4, 8, 16, 32, 64, 128
+BIDIR_JMP_TABLE w_avg_avx2,      4, 8, 16, 32, 64, 128
+BIDIR_JMP_TABLE mask_avx2,       4, 8, 16, 32, 64, 128
+BIDIR_JMP_TABLE w_mask_420_avx2, 4, 8, 16, 32, 64, 128
+BIDIR_JMP_TABLE w_mask_422_avx2, 4, 8, 16, 32, 64, 128
+BIDIR_JMP_TABLE w_mask_444_avx2, 4, 8, 16, 32, 64, 128
+BIDIR_JMP_TABLE blend_avx2,      2, 4, 8, 16, 32, 64, 128, \
+                                 2_h, 4_h, 8_h, 16_h, 32_h, 64_h, 128_h
 
 %macro BASE_JMP_TABLE 3-*
     %xdefine %1_%2_table (%%table - %3)
@@ -2834,7 +2854,7 @@ cglobal mask, 4, 8, 6, dst, stride, tmp1, tmp2, w, h, mask, stride3
     add                  wq, r7
     BIDIR_FN           MASK
 
-%macro W_MASK_420 2 ; src_offset, mask_out
+%macro W_MASK 2-3 0 ; src_offset, mask_out, 4:4:4
     mova                 m0, [tmp1q+(%1+0)*mmsize]
     mova                 m1, [tmp2q+(%1+0)*mmsize]
     psubw                m1, m0
@@ -2852,7 +2872,11 @@ cglobal mask, 4, 8, 6, dst, stride, tmp1, tmp2, w, h, mask, stride3
     paddw                m3, m6
     psrlw                m3, 8
     psubusw              m3, m7, m3
+%if %3
+    packuswb            m%2, m3
+%else
     phaddw              m%2, m3
+%endif
     psllw                m3, 10
     pmulhw               m2, m3
     paddw                m1, m2
@@ -2861,6 +2885,63 @@ cglobal mask, 4, 8, 6, dst, stride, tmp1, tmp2, w, h, mask, stride3
     packuswb             m0, m1
 %endmacro
 
+%macro W_MASK_444 1 ; src_offset
+    W_MASK               %1, 4, 1
+    psubb                m4, m9, m4
+    vpermq               m4, m4, q3120
+    movu [maskq+(%1+0)*16], m4
+%endmacro
+
+%macro W_MASK_444_INC_PTR 1
+    add               maskq, %1*16
+    add               tmp1q, %1*mmsize
+    add               tmp2q, %1*mmsize
+%endmacro
+
+cglobal w_mask_444, 4, 8, 10, dst, stride, tmp1, tmp2, w, h, mask, stride3
+    lea                  r7, [w_mask_444_avx2_table]
+    tzcnt                wd, wm
+    movifnidn            hd, hm
+    mov               maskq, maskmp
+    movsxd               wq, dword [r7+wq*4]
+    vpbroadcastd         m6, [pw_8       +r7-w_mask_444_avx2_table]
+    vpbroadcastd         m7, [pw_26      +r7-w_mask_444_avx2_table] ; 64 - 38
+    vpbroadcastd         m8, [pw_2048    +r7-w_mask_444_avx2_table]
+    vpbroadcastd         m9, [pb_64      +r7-w_mask_444_avx2_table]
+    add                  wq, r7
+    BIDIR_FN     W_MASK_444
+
+%macro W_MASK_422 1 ; src_offset
+    W_MASK               %1, 4
+    psubw                m4, m9, m4
+    psrlw                m4, 1
+    packuswb             m4, m4
+    vpermd               m4, m10, m4
+    movu  [maskq+(%1+0)*8], xm4
+%endmacro
+
+%macro W_MASK_422_INC_PTR 1
+    add               maskq, %1*8
+    add               tmp1q, %1*mmsize
+    add               tmp2q, %1*mmsize
+%endmacro
+
+cglobal w_mask_422, 4, 8, 11, dst, stride, tmp1, tmp2, w, h, mask, stride3
+    lea                  r7, [w_mask_422_avx2_table]
+    tzcnt                wd, wm
+    movifnidn            hd, hm
+    mov               maskq, maskmp
+    vpbroadcastw         m0, r7m ; sign
+    movsxd               wq, dword [r7+wq*4]
+    vpbroadcastd         m6, [pw_8       +r7-w_mask_422_avx2_table]
+    vpbroadcastd         m7, [pw_26      +r7-w_mask_422_avx2_table] ; 64 - 38
+    vpbroadcastd         m8, [pw_2048    +r7-w_mask_422_avx2_table]
+    vpbroadcastd         m9, [pw_129     +r7-w_mask_422_avx2_table] ; 64 * 2 + 1
+    pmovzxbd            m10, [deint_shuf4+r7-w_mask_422_avx2_table]
+    psubw                m9, m0
+    add                  wq, r7
+    BIDIR_FN     W_MASK_422
+
 cglobal w_mask_420, 4, 8, 15, dst, stride, tmp1, tmp2, w, h, mask, stride3
     lea                  r7, [w_mask_420_avx2_table]
     tzcnt                wd, wm
@@ -2875,7 +2956,7 @@ cglobal w_mask_420, 4, 8, 15, dst, stride, tmp1, tmp2, w, h, mask, stride3
     pmovzxbd            m10, [deint_shuf4+r7-w_mask_420_avx2_table]
     psubw                m9, m0
     add                  wq, r7
-    W_MASK_420            0, 4
+    W_MASK                0, 4
     lea            stride3q, [strideq*3]
     jmp                  wq
 .w4:
@@ -2905,7 +2986,7 @@ cglobal w_mask_420, 4, 8, 15, dst, stride, tmp1, tmp2, w, h, mask, stride3
     movq            [maskq], xm4
     RET
 .w4_h16:
-    W_MASK_420            2, 5
+    W_MASK                2, 5
     lea                dstq, [dstq+strideq*4]
     phaddd               m4, m5
     vextracti128        xm1, m0, 1
@@ -2928,7 +3009,7 @@ cglobal w_mask_420, 4, 8, 15, dst, stride, tmp1, tmp2, w, h, mask, stride3
 .w8_loop:
     add               tmp1q, 2*32
     add               tmp2q, 2*32
-    W_MASK_420            0, 4
+    W_MASK                0, 4
     lea                dstq, [dstq+strideq*4]
     add               maskq, 8
 .w8:
@@ -2949,14 +3030,14 @@ cglobal w_mask_420, 4, 8, 15, dst, stride, tmp1, tmp2, w, h, mask, stride3
 .w16_loop:
     add               tmp1q, 4*32
     add               tmp2q, 4*32
-    W_MASK_420            0, 4
+    W_MASK                0, 4
     lea                dstq, [dstq+strideq*4]
     add               maskq, 16
 .w16:
     vpermq               m0, m0, q3120
     mova         [dstq          ], xm0
     vextracti128 [dstq+strideq*1], m0, 1
-    W_MASK_420            2, 5
+    W_MASK                2, 5
     punpckhqdq           m1, m4, m5
     punpcklqdq           m4, m5
     psubw                m1, m9, m1
@@ -2974,13 +3055,13 @@ cglobal w_mask_420, 4, 8, 15, dst, stride, tmp1, tmp2, w, h, mask, stride3
 .w32_loop:
     add               tmp1q, 4*32
     add               tmp2q, 4*32
-    W_MASK_420            0, 4
+    W_MASK                0, 4
     lea                dstq, [dstq+strideq*2]
     add               maskq, 16
 .w32:
     vpermq               m0, m0, q3120
     mova             [dstq], m0
-    W_MASK_420            2, 5
+    W_MASK                2, 5
     psubw                m4, m9, m4
     psubw                m4, m5
     psrlw                m4, 2
@@ -2999,12 +3080,12 @@ cglobal w_mask_420, 4, 8, 15, dst, stride, tmp1, tmp2, w, h, mask, stride3
 .w64_loop:
     add               tmp1q, 4*32
     add               tmp2q, 4*32
-    W_MASK_420            0, 4
+    W_MASK                0, 4
     add                dstq, strideq
 .w64:
     vpermq               m0, m0, q3120
     mova             [dstq], m0
-    W_MASK_420            2, 5
+    W_MASK                2, 5
     vpermq               m0, m0, q3120
     mova          [dstq+32], m0
     test                 hd, 1
@@ -3025,12 +3106,12 @@ cglobal w_mask_420, 4, 8, 15, dst, stride, tmp1, tmp2, w, h, mask, stride3
     psubw               m14, m9, m5
     dec                  hd
 .w128_loop:
-    W_MASK_420            0, 4
+    W_MASK                0, 4
     add                dstq, strideq
 .w128:
     vpermq               m0, m0, q3120
     mova        [dstq+0*32], m0
-    W_MASK_420            2, 5
+    W_MASK                2, 5
     vpermq               m0, m0, q3120
     mova        [dstq+1*32], m0
     add               tmp1q, 8*32
@@ -3049,10 +3130,10 @@ cglobal w_mask_420, 4, 8, 15, dst, stride, tmp1, tmp2, w, h, mask, stride3
     psubw               m11, m9, m4
     psubw               m12, m9, m5
 .w128_odd:
-    W_MASK_420           -4, 4
+    W_MASK               -4, 4
     vpermq               m0, m0, q3120
     mova        [dstq+2*32], m0
-    W_MASK_420           -2, 5
+    W_MASK               -2, 5
     vpermq               m0, m0, q3120
     mova        [dstq+3*32], m0
     test                 hd, 1
@@ -3069,4 +3150,515 @@ cglobal w_mask_420, 4, 8, 15, dst, stride, tmp1, tmp2, w, h, mask, stride3
     jg .w128_loop
     RET
 
+%macro BLEND_PX 0 ; in: m0 = dst, m1 = tmp, m2 = mask; out: m0
+    psubb                m3, m4, m2 ; 64 - m
+    punpcklbw            m6, m3, m2
+    punpckhbw            m3, m2
+    punpcklbw            m7, m0, m1
+    punpckhbw            m0, m1
+    pmaddubsw            m7, m6
+    pmaddubsw            m0, m3
+    pmulhrsw             m7, m5
+    pmulhrsw             m0, m5
+    packuswb             m0, m7, m0
+%endmacro
+
+%macro BLEND_2ROWS 1-2 0 ; w, per-row mask
+%%loop:
+%if %1 == 2
+    pinsrw              xm0, [dstq+dsq*0], 0
+    pinsrw              xm0, [dstq+dsq*1], 1
+    pinsrw              xm1, [tmpq+tsq*0], 0
+    pinsrw              xm1, [tmpq+tsq*1], 1
+%elif %1 == 4
+    movd                xm0, [dstq+dsq*0]
+    pinsrd              xm0, [dstq+dsq*1], 1
+    movd                xm1, [tmpq+tsq*0]
+    pinsrd              xm1, [tmpq+tsq*1], 1
+%elif %1 == 8
+    movq                xm0, [dstq+dsq*0]
+    movhps              xm0, [dstq+dsq*1]
+    movq                xm1, [tmpq+tsq*0]
+    movhps              xm1, [tmpq+tsq*1]
+%else
+    movu                xm0, [dstq+dsq*0]
+    vinserti128          m0, m0, [dstq+dsq*1], 1
+    movu                xm1, [tmpq+tsq*0]
+    vinserti128          m1, m1, [tmpq+tsq*1], 1
+%endif
+%if %2 && %1 == 16
+    vpbroadcastb        xm2, [maskq+0]
+    vpbroadcastb        xm3, [maskq+1]
+    vinserti128          m2, m2, xm3, 1
+%elif %2
+    vpbroadcastw        xm2, [maskq]
+    punpcklbw           xm2, xm2
+ %if %1 >= 4
+    punpcklbw           xm2, xm2
+ %endif
+ %if %1 == 8
+    punpcklbw           xm2, xm2
+ %endif
+%elif %1 == 2
+    pinsrw              xm2, [maskq+msq*0], 0
+    pinsrw              xm2, [maskq+msq*1], 1
+%elif %1 == 4
+    movd                xm2, [maskq+msq*0]
+    pinsrd              xm2, [maskq+msq*1], 1
+%elif %1 == 8
+    movq                xm2, [maskq+msq*0]
+    movhps              xm2, [maskq+msq*1]
+%else
+    movu                xm2, [maskq+msq*0]
+    vinserti128          m2, m2, [maskq+msq*1], 1
+%endif
+    BLEND_PX
+%if %1 == 2
+    pextrw     [dstq+dsq*0], xm0, 0
+    pextrw     [dstq+dsq*1], xm0, 1
+%elif %1 == 4
+    movd       [dstq+dsq*0], xm0
+    pextrd     [dstq+dsq*1], xm0, 1
+%elif %1 == 8
+    movq       [dstq+dsq*0], xm0
+    movhps     [dstq+dsq*1], xm0
+%else
+    movu       [dstq+dsq*0], xm0
+    vextracti128 [dstq+dsq*1], m0, 1
+%endif
+    lea                dstq, [dstq+dsq*2]
+    lea                tmpq, [tmpq+tsq*2]
+    lea               maskq, [maskq+msq*2]
+    sub                  hd, 2
+    jg %%loop
+    RET
+%endmacro
+
+%macro BLEND_ROW 1-2 0 ; w, per-row mask
+%%loop:
+%if %2
+    vpbroadcastb         m2, [maskq]
+%endif
+%assign %%i 0
+%rep %1 / 32
+    movu                 m0, [dstq+%%i]
+    movu                 m1, [tmpq+%%i]
+ %if %2 == 0
+    movu                 m2, [maskq+%%i]
+ %endif
+    BLEND_PX
+    movu         [dstq+%%i], m0
+ %assign %%i %%i+32
+%endrep
+    add                dstq, dsq
+    add                tmpq, tsq
+    add               maskq, msq
+    dec                  hd
+    jg %%loop
+    RET
+%endmacro
+
+cglobal blend, 4, 9, 8, dst, ds, tmp, ts, w, h, mask, ms
+    lea                  r8, [blend_avx2_table]
+    tzcnt                wd, wm
+    movifnidn            hd, hm
+    mov               maskq, maskmp
+    mov                 msq, msmp
+    vpbroadcastd         m4, [pb_64 +r8-blend_avx2_table]
+    vpbroadcastd         m5, [pw_512+r8-blend_avx2_table]
+    cmp                 msq, 1
+    jne .jmp
+    add                  wd, 7 ; one mask value per row
+.jmp:
+    movsxd               wq, dword [r8+wq*4]
+    add                  wq, r8
+    jmp                  wq
+.w2:
+    BLEND_2ROWS           2
+.w4:
+    BLEND_2ROWS           4
+.w8:
+    BLEND_2ROWS           8
+.w16:
+    BLEND_2ROWS          16
+.w32:
+    BLEND_ROW            32
+.w64:
+    BLEND_ROW            64
+.w128:
+    BLEND_ROW           128
+.w2_h:
+    BLEND_2ROWS           2, 1
+.w4_h:
+    BLEND_2ROWS           4, 1
+.w8_h:
+    BLEND_2ROWS           8, 1
+.w16_h:
+    BLEND_2ROWS          16, 1
+.w32_h:
+    BLEND_ROW            32, 1
+.w64_h:
+    BLEND_ROW            64, 1
+.w128_h:
+    BLEND_ROW           128, 1
+
+%macro WARP_FILTER 2 ; load_op, dst
+    lea                idxq, [tmxq+512]
+    add                tmxq, stepq
+    sar                idxq, 10
+    %1                 xm%2, [filterq+idxq*8]
+%endmacro
+
+%macro WARP_FILTERS 0 ; 8 filters starting at tmx in m8-m11
+    WARP_FILTER        movq,  8
+    WARP_FILTER      movhps,  8
+    WARP_FILTER        movq,  9
+    WARP_FILTER      movhps,  9
+    WARP_FILTER        movq, 10
+    WARP_FILTER      movhps, 10
+    WARP_FILTER        movq, 11
+    WARP_FILTER      movhps, 11
+%endmacro
+
+%macro WARP_TRANSPOSE 0 ; m8-m11 -> m10, m11, m9, m12 (tap pairs 0-3)
+    punpcklwd           m12, m8, m9
+    punpckhwd            m8, m9
+    punpcklwd            m9, m10, m11
+    punpckhwd           m10, m11
+    punpckldq           m11, m12, m9
+    punpckhdq           m12, m9
+    punpckldq            m9, m8, m10
+    punpckhdq            m8, m10
+    punpcklwd           m10, m11, m9
+    punpckhwd           m11, m9
+    punpcklwd            m9, m12, m8
+    punpckhwd           m12, m8
+%endmacro
+
+%macro WARP_H 0 ; 2 rows (one per lane) -> m14, biased by 2048
+    movsx             stepq, word [abcdq+2*0] ; alpha
+    mov                tmxq, mxq
+    WARP_FILTERS
+    movsx              idxq, word [abcdq+2*1] ; beta
+    add                 mxq, idxq
+    mov                tmxq, mxq
+    WARP_FILTER        movq, 12
+    WARP_FILTER      movhps, 12
+    vinserti128          m8, m8, xm12, 1
+    WARP_FILTER        movq, 12
+    WARP_FILTER      movhps, 12
+    vinserti128          m9, m9, xm12, 1
+    WARP_FILTER        movq, 12
+    WARP_FILTER      movhps, 12
+    vinserti128         m10, m10, xm12, 1
+    WARP_FILTER        movq, 12
+    WARP_FILTER      movhps, 12
+    vinserti128         m11, m11, xm12, 1
+    movsx              idxq, word [abcdq+2*1]
+    add                 mxq, idxq
+    ; taps 0,2 / 1,3 / 4,6 / 5,7 are paired to avoid pmaddubsw saturation
+    pshufb               m8, [warp_8x8_shufC]
+    pshufb               m9, [warp_8x8_shufC]
+    pshufb              m10, [warp_8x8_shufC]
+    pshufb              m11, [warp_8x8_shufC]
+    WARP_TRANSPOSE
+    movu               xm13, [srcq]
+    vinserti128         m13, m13, [srcq+ss1q], 1
+    lea                srcq, [srcq+ssq*2]
+    pshufb              m14, m13, [warp_8x8_shufA]
+    pmaddubsw           m14, m10
+    pshufb              m15, m13, [warp_8x8_shufB]
+    pmaddubsw           m15, m11
+    paddw               m14, m15
+    psrldq              m13, 4
+    pshufb              m15, m13, [warp_8x8_shufA]
+    pmaddubsw           m15, m9
+    paddw               m14, m15
+    pshufb              m13, [warp_8x8_shufB]
+    pmaddubsw           m13, m12
+    paddw               m14, m13
+    paddw               m14, m7 ; the bias keeps the sum positive
+    psrlw               m14, 3
+%endmacro
+
+%macro WARP_V 5 ; dst, src[1-4]
+    movsx             stepq, word [abcdq+2*2] ; gamma
+    mov                tmxq, myq
+    WARP_FILTERS
+    movsx              idxq, word [abcdq+2*3] ; delta
+    add                 myq, idxq
+    WARP_TRANSPOSE
+    pmovsxbw            m10, xm10
+    pmovsxbw            m11, xm11
+    pmovsxbw             m9, xm9
+    pmovsxbw            m12, xm12
+    pmaddwd             m%1, m%2, m10
+    pmaddwd             m11, m%3
+    paddd               m%1, m11
+    pmaddwd              m9, m%4
+    paddd               m%1, m9
+    pmaddwd             m12, m%5
+    paddd               m%1, m12
+%endmacro
+
+%macro WARP_V_PAIR 2 ; dst, src (two rows of h in lanes -> interleaved columns)
+    vpermq              m%1, m%2, q3120
+    pshufb              m%1, m12
+%endmacro
+
+%macro WARP_AFFINE_8X8 1 ; 8x8t
+    movifnidn         abcdq, abcdmp
+    movsxd              mxq, mxm
+    movsxd              myq, mym
+    lea             filterq, [warp_filters]
+    lea                tmxq, [ssq*3+3]
+    sub                srcq, tmxq
+    mov                ss1q, ssq
+    vpbroadcastd         m7, [pw_16388] ; 4 + (2048 << 3)
+    WARP_H
+    mova                 m0, m14
+    WARP_H
+    vperm2i128           m1, m0, m14, 0x21
+    mova                 m2, m14
+    WARP_H
+    vperm2i128           m3, m2, m14, 0x21
+    mova                 m4, m14
+    WARP_H
+    vperm2i128           m5, m4, m14, 0x21
+    mova                 m6, m14
+    mova                m12, [warp_8x8_shufD]
+    WARP_V_PAIR           0, 0
+    WARP_V_PAIR           1, 1
+    WARP_V_PAIR           2, 2
+    WARP_V_PAIR           3, 3
+    WARP_V_PAIR           4, 4
+    WARP_V_PAIR           5, 5
+    mov                cntd, 4
+.loop:
+    cmp                cntd, 1
+    jne .h
+    xor                ss1d, ss1d ; row 15 is never used
+.h:
+    WARP_H
+    vperm2i128          m13, m6, m14, 0x21
+    mova                m12, [warp_8x8_shufD]
+    WARP_V_PAIR          15, 6
+    WARP_V_PAIR          13, 13
+    mova                 m6, m14
+    WARP_V               14, 0, 2, 4, 15
+    WARP_V                8, 1, 3, 5, 13
+%if %1
+    vpbroadcastd         m9, [pd_m262080] ; 64 - (2048 << 7)
+    paddd               m14, m9
+    paddd                m8, m9
+    psrad               m14, 7
+    psrad                m8, 7
+    packssdw            m14, m8
+    vpermq              m14, m14, q3120
+    mova         [tmpq+tsq*0], xm14
+    vextracti128 [tmpq+tsq*2], m14, 1
+    lea                tmpq, [tmpq+tsq*4]
+%else
+    vpbroadcastd         m9, [pd_m261120] ; 1024 - (2048 << 7)
+    paddd               m14, m9
+    paddd                m8, m9
+    psrad               m14, 11
+    psrad                m8, 11
+    packssdw            m14, m8
+    vpermq              m14, m14, q3120
+    vextracti128        xm8, m14, 1
+    packuswb            xm14, xm8
+    movq       [dstq+dsq*0], xm14
+    movhps     [dstq+dsq*1], xm14
+    lea                dstq, [dstq+dsq*2]
+%endif
+    mova                 m0, m2
+    mova                 m1, m3
+    mova                 m2, m4
+    mova                 m3, m5
+    mova                 m4, m15
+    mova                 m5, m13
+    dec                cntd
+    jg .loop
+    RET
+%endmacro
+
+cglobal warp_affine_8x8, 4, 13, 16, dst, ds, src, ss, abcd, mx, my, \
+                                    filter, tmx, idx, step, cnt, ss1
+    WARP_AFFINE_8X8       0
+
+cglobal warp_affine_8x8t, 4, 13, 16, tmp, ts, src, ss, abcd, mx, my, \
+                                     filter, tmx, idx, step, cnt, ss1
+    WARP_AFFINE_8X8       1
+
+%macro EMU_EDGE_COPY 2-3 ; dst, w, src (fills with m0 if src is omitted)
+    cmp                  %2, 32
+    jl %%w16
+    lea               lastq, [%2-32]
+    xor                offd, offd
+%%w32_loop:
+    cmp                offq, lastq
+    jge %%w32_last
+%if %0 == 3
+    movu                 m1, [%3+offq]
+    movu        [%1+offq], m1
+%else
+    movu        [%1+offq], m0
+%endif
+    add                offq, 32
+    jmp %%w32_loop
+%%w32_last:
+%if %0 == 3
+    movu                 m1, [%3+lastq]
+    movu       [%1+lastq], m1
+%else
+    movu       [%1+lastq], m0
+%endif
+    jmp %%end
+%%w16:
+    cmp                  %2, 16
+    jl %%w8
+%if %0 == 3
+    movu                xm1, [%3]
+    movu                xm2, [%3+%2-16]
+    movu              [%1], xm1
+    movu         [%1+%2-16], xm2
+%else
+    movu              [%1], xm0
+    movu         [%1+%2-16], xm0
+%endif
+    jmp %%end
+%%w8:
+    cmp                  %2, 8
+    jl %%w4
+%if %0 == 3
+    movq                xm1, [%3]
+    movq                xm2, [%3+%2-8]
+    movq              [%1], xm1
+    movq          [%1+%2-8], xm2
+%else
+    movq              [%1], xm0
+    movq          [%1+%2-8], xm0
+%endif
+    jmp %%end
+%%w4:
+    cmp                  %2, 4
+    jl %%w2
+%if %0 == 3
+    movd                xm1, [%3]
+    movd                xm2, [%3+%2-4]
+    movd              [%1], xm1
+    movd          [%1+%2-4], xm2
+%else
+    movd              [%1], xm0
+    movd          [%1+%2-4], xm0
+%endif
+    jmp %%end
+%%w2:
+    cmp                  %2, 2
+    jl %%w1
+%if %0 == 3
+    movzx              offd, word [%3]
+    movzx             lastd, word [%3+%2-2]
+    mov               [%1], offw
+    mov           [%1+%2-2], lastw
+%else
+    pextrw            [%1], xm0, 0
+    pextrw        [%1+%2-2], xm0, 0
+%endif
+    jmp %%end
+%%w1:
+%if %0 == 3
+    movzx              offd, byte [%3]
+    mov               [%1], offb
+%else
+    pextrb            [%1], xm0, 0
+%endif
+%%end:
+%endmacro
+
+cglobal emu_edge, 10, 13, 3, bw, bh, iw, ih, x, y, dst, dstride, src, sstride, \
+                             blk, off, last
+    xor                lastd, lastd
+    ; ref += iclip(y, 0, ih - 1) * PXSTRIDE(ref_stride)
+    lea                blkq, [ihq-1]
+    cmp                  yq, ihq
+    cmovl              blkq, yq
+    test                 yq, yq
+    cmovs              blkq, lastq
+    imul               blkq, sstrideq
+    add                srcq, blkq
+    ; ref += iclip(x, 0, iw - 1)
+    lea                blkq, [iwq-1]
+    cmp                  xq, iwq
+    cmovl              blkq, xq
+    test                 xq, xq
+    cmovs              blkq, lastq
+    add                srcq, blkq
+    ; bottom_ext = iclip(y + bh - ih, 0, bh - 1)
+    lea                blkq, [yq+bhq]
+    sub                blkq, ihq
+    lea                offq, [bhq-1]
+    cmp                blkq, offq
+    cmovg              blkq, offq
+    test               blkq, blkq
+    cmovs              blkq, lastq
+    ; top_ext = iclip(-y, 0, bh - 1)
+    neg                  yq
+    cmp                  yq, offq
+    cmovg                yq, offq
+    test                 yq, yq
+    cmovs                yq, lastq
+    ; number of source row increments: center_h - 1
+    mov                 ihq, offq
+    sub                 ihq, yq
+    sub                 ihq, blkq
+    ; right_ext = iclip(x + bw - iw, 0, bw - 1)
+    lea                blkq, [xq+bwq]
+    sub                blkq, iwq
+    lea                offq, [bwq-1]
+    cmp                blkq, offq
+    cmovg              blkq, offq
+    test               blkq, blkq
+    cmovs              blkq, lastq
+    ; left_ext = iclip(-x, 0, bw - 1)
+    neg                  xq
+    cmp                  xq, offq
+    cmovg                xq, offq
+    test                 xq, xq
+    cmovs                xq, lastq
+    mov                 iwq, blkq
+    ; center_w = bw - left_ext - right_ext
+    sub                 bwq, xq
+    sub                 bwq, iwq
+    DEFINE_ARGS w, h, right, adv, left, top, dst, dstride, src, sstride, \
+                blk, off, last
+.loop:
+    test              leftq, leftq
+    jz .center
+    vpbroadcastb         m0, [srcq]
+    EMU_EDGE_COPY      dstq, leftq
+.center:
+    lea                blkq, [dstq+leftq]
+    EMU_EDGE_COPY      blkq, wq, srcq
+    test             rightq, rightq
+    jz .next
+    vpbroadcastb         m0, [srcq+wq-1]
+    add                blkq, wq
+    EMU_EDGE_COPY      blkq, rightq
+.next:
+    add                dstq, dstrideq
+    ; the top rows all replicate the first visible row, and the bottom
+    ; rows the last one, so only advance the source for the center rows
+    dec                topq
+    jns .next_row
+    test               advq, advq
+    jz .next_row
+    dec                advq
+    add                srcq, sstrideq
+.next_row:
+    dec                  hq
+    jg .loop
+    RET
+
 %endif ; ARCH_X86_64
@@ -0,0 +1,1367 @@
+; Copyright © 2018, VideoLAN and dav1d authors
+; Copyright © 2018, Two Orioles, LLC
+; All rights reserved.
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice, this
+;    list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+; ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+; WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+; DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+; ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+; (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+; ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+; (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+; SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+%include "config.asm"
+%include "ext/x86/x86inc.asm"
+
+%if ARCH_X86_64
+
+SECTION_RODATA 32
+
+pw_1023: times 16 dw 1023
+pw_2048: times 16 dw 2048
+pd_2:    times 8 dd 2
+pd_8:    times 8 dd 8
+pd_16:   times 8 dd 16
+pd_32:   times 8 dd 32
+pd_34:   times 8 dd 34
+pd_38:   times 8 dd 38
+pd_64:   times 8 dd 64
+pd_128:  times 8 dd 128
+pd_512:  times 8 dd 512
+
+cextern mc_subpel_filters
+%define subpel_filters (mangle(private_prefix %+ _mc_subpel_filters)-8)
+
+%macro BIDIR_JMP_TABLE 1-7 4, 8, 16, 32, 64, 128
+    %xdefine %1_table (%%table - 2*4)
+    %xdefine %%prefix mangle(private_prefix %+ _%1)
+    %%table:
+    %rep 6
+        dd %%prefix %+ .w%2 - (%%table - 2*4)
+        %rotate 1
+    %endrep
+%endmacro
+
+BIDIR_JMP_TABLE avg_10bpc_avx2
+BIDIR_JMP_TABLE w_avg_10bpc_avx2
+BIDIR_JMP_TABLE mask_10bpc_avx2
+
+SECTION .text
+
+; All kernels operate on 8-pixel wide columns, two rows at a time, with
+; the first row in the low and the second row in the high 128-bit lane.
+; Intermediates are kept at dword precision wherever 16 bits would not
+; be enough for 10-bit input.
+
+INIT_YMM avx2
+%macro PUT_COPY 0
+    cmp                  wd, 4
+    jl .put_w2
+    je .put_w4
+    cmp                  wd, 8
+    je .put_w8
+    lea                  wd, [wq*2]
+    add                srcq, wq
+    add                dstq, wq
+    neg                  wq
+.put_w16:
+    mov                cntq, wq
+.put_w16_loop:
+    movu                 m0, [srcq+cntq]
+    mova      [dstq+cntq], m0
+    add                cntq, 32
+    jl .put_w16_loop
+    add                srcq, ssq
+    add                dstq, dsq
+    dec                  hd
+    jg .put_w16
+    RET
+.put_w2:
+    movd                xm0, [srcq+ssq*0]
+    movd                xm1, [srcq+ssq*1]
+    lea                srcq, [srcq+ssq*2]
+    movd       [dstq+dsq*0], xm0
+    movd       [dstq+dsq*1], xm1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .put_w2
+    RET
+.put_w4:
+    movq                xm0, [srcq+ssq*0]
+    movq                xm1, [srcq+ssq*1]
+    lea                srcq, [srcq+ssq*2]
+    movq       [dstq+dsq*0], xm0
+    movq       [dstq+dsq*1], xm1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .put_w4
+    RET
+.put_w8:
+    movu                xm0, [srcq+ssq*0]
+    movu                xm1, [srcq+ssq*1]
+    lea                srcq, [srcq+ssq*2]
+    mova       [dstq+dsq*0], xm0
+    mova       [dstq+dsq*1], xm1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .put_w8
+    RET
+%endmacro
+
+%macro PREP_COPY 0
+    cmp                  wd, 4
+    je .prep_w4
+.prep_w8:
+    xor                cntd, cntd
+.prep_w8_loop:
+    pmovzxwd             m0, [srcq+cntq*2]
+    pslld                m0, 4
+    mova    [tmpq+cntq*4], m0
+    add                cntd, 8
+    cmp                cntd, wd
+    jl .prep_w8_loop
+    add                srcq, ssq
+    lea                tmpq, [tmpq+wq*4]
+    dec                  hd
+    jg .prep_w8
+    RET
+.prep_w4:
+    pmovzxwd            xm0, [srcq+ssq*0]
+    pmovzxwd            xm1, [srcq+ssq*1]
+    lea                srcq, [srcq+ssq*2]
+    vinserti128          m0, m0, xm1, 1
+    pslld                m0, 4
+    mova             [tmpq], m0
+    add                tmpq, 32
+    sub                  hd, 2
+    jg .prep_w4
+    RET
+%endmacro
+
+; stores two rows of 8 dwords, split in 4-pixel halves across the lanes
+; as produced by the filters below
+%macro PREP_STORE_W8 3 ; src[1-2], tmp
+    vinserti128         m%3, m%1, xm%2, 1
+    vperm2i128          m%1, m%1, m%2, 0x31
+    mova        [tmpq+wq*0], m%3
+    mova        [tmpq+wq*4], m%1
+    lea                tmpq, [tmpq+wq*8]
+%endmacro
+
+; bilinear: 16*a + mxy*(b-a) always fits in 16 bits at 10 bpc
+%macro BILIN_H 2 ; dst, row1 offset
+    movu               xm%1, [srcq+ssq*0+0]
+    vinserti128         m%1, m%1, [srcq+ssq*%2+0], 1
+    movu                xm7, [srcq+ssq*0+2]
+    vinserti128          m7, m7, [srcq+ssq*%2+2], 1
+    psubw                m7, m%1
+    pmullw               m7, m8
+    psllw               m%1, 4
+    paddw               m%1, m7
+%endmacro
+
+%macro BILIN_V 1 ; dst
+    movu               xm%1, [srcq+ssq*0]
+    vinserti128         m%1, m%1, [srcq+ssq*1], 1
+    movu                xm7, [srcq+ssq*1]
+    vinserti128          m7, m7, [srcq+ssq*2], 1
+    psubw                m7, m%1
+    pmullw               m7, m8
+    psllw               m%1, 4
+    paddw               m%1, m7
+%endmacro
+
+; (16-my)*a + my*b needs 20 bits when both inputs are intermediates
+%macro BILIN_HV 0 ; m0 = [a0 a1] m1 = [a1 a2], outputs in m0/m1
+    punpcklwd            m2, m0, m1
+    punpckhwd            m1, m0, m1
+    pmaddwd              m0, m2, m9
+    pmaddwd              m1, m9
+    paddd                m0, m10
+    paddd                m1, m10
+%endmacro
+
+%macro BILIN_HV_NEXT 0
+    lea                srcq, [srcq+ssq*2]
+    BILIN_H               1, 1
+    vperm2i128           m0, m6, m1, 0x21
+    mova                 m6, m1
+    BILIN_HV
+%endmacro
+
+cglobal put_bilin_10bpc, 4, 10, 11, dst, ds, src, ss, w, h, mxy, cnt, src0, dst0
+    movifnidn          mxyd, r6m ; mx
+    movsxd               wq, wm
+    movifnidn            hd, hm
+    test               mxyd, mxyd
+    jnz .h
+    mov                mxyd, r7m ; my
+    test               mxyd, mxyd
+    jnz .v
+    PUT_COPY
+.h:
+    movd                xm8, mxyd
+    vpbroadcastw         m8, xm8
+    mov                mxyd, r7m ; my
+    test               mxyd, mxyd
+    jnz .hv
+    mova                 m9, [pw_2048]
+    cmp                  wd, 4
+    jl .h_w2
+    je .h_w4
+    mov                mxyd, hd
+    mov                cntd, wd
+    shr                cntd, 3
+    mov               src0q, srcq
+    mov               dst0q, dstq
+.h_w8:
+    BILIN_H               0, 1
+    lea                srcq, [srcq+ssq*2]
+    pmulhrsw             m0, m9
+    mova       [dstq+dsq*0], xm0
+    vextracti128 [dstq+dsq*1], m0, 1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .h_w8
+    add               src0q, 16
+    add               dst0q, 16
+    mov                srcq, src0q
+    mov                dstq, dst0q
+    mov                  hd, mxyd
+    dec                cntd
+    jg .h_w8
+    RET
+.h_w2:
+    BILIN_H               0, 1
+    lea                srcq, [srcq+ssq*2]
+    pmulhrsw             m0, m9
+    vextracti128        xm1, m0, 1
+    movd       [dstq+dsq*0], xm0
+    movd       [dstq+dsq*1], xm1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .h_w2
+    RET
+.h_w4:
+    BILIN_H               0, 1
+    lea                srcq, [srcq+ssq*2]
+    pmulhrsw             m0, m9
+    vextracti128        xm1, m0, 1
+    movq       [dstq+dsq*0], xm0
+    movq       [dstq+dsq*1], xm1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .h_w4
+    RET
+.v:
+    movd                xm8, mxyd
+    vpbroadcastw         m8, xm8
+    mova                 m9, [pw_2048]
+    cmp                  wd, 4
+    jl .v_w2
+    je .v_w4
+    mov                mxyd, hd
+    mov                cntd, wd
+    shr                cntd, 3
+    mov               src0q, srcq
+    mov               dst0q, dstq
+.v_w8:
+    BILIN_V               0
+    lea                srcq, [srcq+ssq*2]
+    pmulhrsw             m0, m9
+    mova       [dstq+dsq*0], xm0
+    vextracti128 [dstq+dsq*1], m0, 1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .v_w8
+    add               src0q, 16
+    add               dst0q, 16
+    mov                srcq, src0q
+    mov                dstq, dst0q
+    mov                  hd, mxyd
+    dec                cntd
+    jg .v_w8
+    RET
+.v_w2:
+    BILIN_V               0
+    lea                srcq, [srcq+ssq*2]
+    pmulhrsw             m0, m9
+    vextracti128        xm1, m0, 1
+    movd       [dstq+dsq*0], xm0
+    movd       [dstq+dsq*1], xm1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .v_w2
+    RET
+.v_w4:
+    BILIN_V               0
+    lea                srcq, [srcq+ssq*2]
+    pmulhrsw             m0, m9
+    vextracti128        xm1, m0, 1
+    movq       [dstq+dsq*0], xm0
+    movq       [dstq+dsq*1], xm1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .v_w4
+    RET
+.hv:
+    imul               mxyd, 0xffff
+    add                mxyd, 16
+    movd                xm9, mxyd
+    vpbroadcastd         m9, xm9 ; 16-my, my
+    mova                m10, [pd_128]
+    cmp                  wd, 4
+    jl .hv_w2
+    je .hv_w4
+    mov                mxyd, hd
+    mov                cntd, wd
+    shr                cntd, 3
+    mov               src0q, srcq
+    mov               dst0q, dstq
+.hv_w8:
+    BILIN_H               6, 0
+    sub                srcq, ssq
+.hv_w8_loop:
+    BILIN_HV_NEXT
+    psrad                m0, 8
+    psrad                m1, 8
+    packusdw             m0, m1
+    mova       [dstq+dsq*0], xm0
+    vextracti128 [dstq+dsq*1], m0, 1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .hv_w8_loop
+    add               src0q, 16
+    add               dst0q, 16
+    mov                srcq, src0q
+    mov                dstq, dst0q
+    mov                  hd, mxyd
+    dec                cntd
+    jg .hv_w8
+    RET
+.hv_w2:
+    BILIN_H               6, 0
+    sub                srcq, ssq
+.hv_w2_loop:
+    BILIN_HV_NEXT
+    psrad                m0, 8
+    psrad                m1, 8
+    packusdw             m0, m1
+    vextracti128        xm1, m0, 1
+    movd       [dstq+dsq*0], xm0
+    movd       [dstq+dsq*1], xm1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .hv_w2_loop
+    RET
+.hv_w4:
+    BILIN_H               6, 0
+    sub                srcq, ssq
+.hv_w4_loop:
+    BILIN_HV_NEXT
+    psrad                m0, 8
+    psrad                m1, 8
+    packusdw             m0, m1
+    vextracti128        xm1, m0, 1
+    movq       [dstq+dsq*0], xm0
+    movq       [dstq+dsq*1], xm1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .hv_w4_loop
+    RET
+
+cglobal prep_bilin_10bpc, 3, 9, 11, tmp, src, ss, w, h, mxy, cnt, src0, tmp0
+    movifnidn          mxyd, r5m ; mx
+    movsxd               wq, wm
+    movifnidn            hd, hm
+    test               mxyd, mxyd
+    jnz .h
+    mov                mxyd, r6m ; my
+    test               mxyd, mxyd
+    jnz .v
+    PREP_COPY
+.h:
+    movd                xm8, mxyd
+    vpbroadcastw         m8, xm8
+    mov                mxyd, r6m ; my
+    test               mxyd, mxyd
+    jnz .hv
+    pxor                 m9, m9
+    cmp                  wd, 4
+    je .h_w4
+    mov                mxyd, hd
+    mov                cntd, wd
+    shr                cntd, 3
+    mov               src0q, srcq
+    mov               tmp0q, tmpq
+.h_w8:
+    BILIN_H               0, 1
+    lea                srcq, [srcq+ssq*2]
+    punpcklwd            m1, m0, m9
+    punpckhwd            m0, m9
+    PREP_STORE_W8          1, 0, 2
+    sub                  hd, 2
+    jg .h_w8
+    add               src0q, 16
+    add               tmp0q, 32
+    mov                srcq, src0q
+    mov                tmpq, tmp0q
+    mov                  hd, mxyd
+    dec                cntd
+    jg .h_w8
+    RET
+.h_w4:
+    BILIN_H               0, 1
+    lea                srcq, [srcq+ssq*2]
+    punpcklwd            m0, m9
+    mova             [tmpq], m0
+    add                tmpq, 32
+    sub                  hd, 2
+    jg .h_w4
+    RET
+.v:
+    movd                xm8, mxyd
+    vpbroadcastw         m8, xm8
+    pxor                 m9, m9
+    cmp                  wd, 4
+    je .v_w4
+    mov                mxyd, hd
+    mov                cntd, wd
+    shr                cntd, 3
+    mov               src0q, srcq
+    mov               tmp0q, tmpq
+.v_w8:
+    BILIN_V               0
+    lea                srcq, [srcq+ssq*2]
+    punpcklwd            m1, m0, m9
+    punpckhwd            m0, m9
+    PREP_STORE_W8          1, 0, 2
+    sub                  hd, 2
+    jg .v_w8
+    add               src0q, 16
+    add               tmp0q, 32
+    mov                srcq, src0q
+    mov                tmpq, tmp0q
+    mov                  hd, mxyd
+    dec                cntd
+    jg .v_w8
+    RET
+.v_w4:
+    BILIN_V               0
+    lea                srcq, [srcq+ssq*2]
+    punpcklwd            m0, m9
+    mova             [tmpq], m0
+    add                tmpq, 32
+    sub                  hd, 2
+    jg .v_w4
+    RET
+.hv:
+    imul               mxyd, 0xffff
+    add                mxyd, 16
+    movd                xm9, mxyd
+    vpbroadcastd         m9, xm9 ; 16-my, my
+    mova                m10, [pd_8]
+    cmp                  wd, 4
+    je .hv_w4
+    mov                mxyd, hd
+    mov                cntd, wd
+    shr                cntd, 3
+    mov               src0q, srcq
+    mov               tmp0q, tmpq
+.hv_w8:
+    BILIN_H               6, 0
+    sub                srcq, ssq
+.hv_w8_loop:
+    BILIN_HV_NEXT
+    psrad                m0, 4
+    psrad                m1, 4
+    PREP_STORE_W8          0, 1, 2
+    sub                  hd, 2
+    jg .hv_w8_loop
+    add               src0q, 16
+    add               tmp0q, 32
+    mov                srcq, src0q
+    mov                tmpq, tmp0q
+    mov                  hd, mxyd
+    dec                cntd
+    jg .hv_w8
+    RET
+.hv_w4:
+    BILIN_H               6, 0
+    sub                srcq, ssq
+.hv_w4_loop:
+    BILIN_HV_NEXT
+    psrad                m0, 4
+    mova             [tmpq], m0
+    add                tmpq, 32
+    sub                  hd, 2
+    jg .hv_w4_loop
+    RET
+
+%assign FILTER_REGULAR (0*15 << 16) | 3*15
+%assign FILTER_SMOOTH  (1*15 << 16) | 4*15
+%assign FILTER_SHARP   (2*15 << 16) | 3*15
+
+; Loads the 8-tap filter selected by %2 as pairs of words into m8-m11.
+%macro LOAD_FILTER 2 ; coef, size
+    movzx              cntd, %1b
+    shr                 %1d, 16
+    cmp                 %2d, 4
+    cmovle              %1d, cntd
+    lea                cntq, [subpel_filters]
+    vpbroadcastq        xm8, [cntq+%1q*8]
+    pmovsxbw             m8, xm8
+    pshufd               m9, m8, q1111
+    pshufd              m10, m8, q2222
+    pshufd              m11, m8, q3333
+    pshufd               m8, m8, q0000
+%endmacro
+
+; Horizontal 8-tap filter: %1 holds pixels -3..4 and %2 pixels 5..12 of
+; each row. Returns the even outputs in %3 and the odd outputs in %4.
+%macro FILTER_8TAP_H 5-9 m8, m9, m10, m11 ; src[1-2], dst[1-2], tmp, coef[1-4]
+    pmaddwd             m%3, m%1, %6
+    palignr             m%5, m%2, m%1, 4
+    pmaddwd             m%5, %7
+    paddd               m%3, m%5
+    palignr             m%5, m%2, m%1, 8
+    pmaddwd             m%5, %8
+    paddd               m%3, m%5
+    palignr             m%5, m%2, m%1, 12
+    pmaddwd             m%5, %9
+    paddd               m%3, m%5
+    palignr             m%4, m%2, m%1, 2
+    pmaddwd             m%4, %6
+    palignr             m%5, m%2, m%1, 6
+    pmaddwd             m%5, %7
+    paddd               m%4, m%5
+    palignr             m%5, m%2, m%1, 10
+    pmaddwd             m%5, %8
+    paddd               m%4, m%5
+    palignr             m%2, m%2, m%1, 14
+    pmaddwd             m%2, %9
+    paddd               m%4, m%2
+%endmacro
+
+%macro LOAD_H_ROWS 3 ; dst[1-2], row1 offset
+    movu               xm%1, [srcq+ssq*0+ 0]
+    vinserti128         m%1, m%1, [srcq+ssq*%3+ 0], 1
+    movu               xm%2, [srcq+ssq*0+16]
+    vinserti128         m%2, m%2, [srcq+ssq*%3+16], 1
+%endmacro
+
+%macro PUT_8TAP_H 0 ; m0 = 2 rows of 8 pixels
+    LOAD_H_ROWS           0, 1, 1
+    lea                srcq, [srcq+ssq*2]
+    FILTER_8TAP_H         0, 1, 2, 3, 4
+    paddd                m2, m12
+    paddd                m3, m12
+    psrad                m2, 6
+    psrad                m3, 6
+    pslld                m3, 16
+    pblendw              m0, m2, m3, 0xaa
+    pmaxsw               m0, m13
+    pminsw               m0, m14
+%endmacro
+
+%macro PREP_8TAP_H 0 ; m0/m1 = 2 rows of 8 dwords
+    LOAD_H_ROWS           0, 1, 1
+    lea                srcq, [srcq+ssq*2]
+    FILTER_8TAP_H         0, 1, 2, 3, 4
+    paddd                m2, m12
+    paddd                m3, m12
+    psrad                m2, 2
+    psrad                m3, 2
+    punpckldq            m0, m2, m3
+    punpckhdq            m1, m2, m3
+%endmacro
+
+; The vertical filter keeps rows 0-6 interleaved in pairs in m0-m5 and
+; consumes two new rows per iteration. The first output row is computed
+; in the low and the second one in the high lane.
+%macro V_INIT 0
+    movu                xm0, [srcq+ssq*0]
+    movu                xm1, [srcq+ssq*1]
+    lea                srcq, [srcq+ssq*2]
+    movu                xm2, [srcq+ssq*0]
+    movu                xm3, [srcq+ssq*1]
+    lea                srcq, [srcq+ssq*2]
+    movu                xm4, [srcq+ssq*0]
+    movu                xm5, [srcq+ssq*1]
+    lea                srcq, [srcq+ssq*2]
+    movu                xm6, [srcq+ssq*0]
+    add                srcq, ssq
+    vinserti128          m0, m0, xm1, 1 ; 0 1
+    vinserti128          m1, m1, xm2, 1 ; 1 2
+    vinserti128          m2, m2, xm3, 1 ; 2 3
+    vinserti128          m3, m3, xm4, 1 ; 3 4
+    vinserti128          m4, m4, xm5, 1 ; 4 5
+    vinserti128          m5, m5, xm6, 1 ; 5 6
+    V_INTERLEAVE
+%endmacro
+
+%macro V_INTERLEAVE 0
+    punpcklwd            m7, m0, m1
+    punpckhwd            m1, m0, m1
+    mova                 m0, m7
+    punpcklwd            m7, m2, m3
+    punpckhwd            m3, m2, m3
+    mova                 m2, m7
+    punpcklwd            m7, m4, m5
+    punpckhwd            m5, m4, m5
+    mova                 m4, m7
+%endmacro
+
+%macro FILTER_8TAP_V 3 ; 67_lo, 67_hi, tmp
+    pmaddwd             m14, m0, m8
+    pmaddwd             m15, m2, m9
+    paddd               m14, m15
+    pmaddwd             m15, m4, m10
+    paddd               m14, m15
+    pmaddwd             m15, m%1, m11
+    paddd               m14, m15
+    pmaddwd             m15, m1, m8
+    pmaddwd             m%3, m3, m9
+    paddd               m15, m%3
+    pmaddwd             m%3, m5, m10
+    paddd               m15, m%3
+    pmaddwd             m%3, m%2, m11
+    paddd               m15, m%3
+    mova                 m0, m2
+    mova                 m1, m3
+    mova                 m2, m4
+    mova                 m3, m5
+    mova                 m4, m%1
+    mova                 m5, m%2
+%endmacro
+
+%macro V_NEXT 0 ; m14/m15 = lo/hi sums of 2 rows
+    movu               xm13, [srcq+ssq*0]
+    vinserti128         m12, m6, xm13, 1
+    vinserti128         m13, m13, [srcq+ssq*1], 1
+    lea                srcq, [srcq+ssq*2]
+    vextracti128        xm6, m13, 1
+    punpcklwd            m7, m12, m13
+    punpckhwd           m12, m13
+    FILTER_8TAP_V         7, 12, 13
+%endmacro
+
+; The 2D filter uses the same layout with the intermediates of the
+; horizontal pass; the horizontal coefficients live on the stack.
+%macro HV_H 2 ; dst, row1 offset
+    LOAD_H_ROWS          12, 13, %2
+    FILTER_8TAP_H        12, 13, 14, 15, 7, [rsp+32*0], [rsp+32*1], \
+                                            [rsp+32*2], [rsp+32*3]
+    paddd               m14, [pd_2]
+    paddd               m15, [pd_2]
+    psrad               m14, 2
+    psrad               m15, 2
+    pslld               m15, 16
+    pblendw             m%1, m14, m15, 0xaa
+%endmacro
+
+%macro HV_INIT 0
+    HV_H                  0, 1
+    lea                srcq, [srcq+ssq*2]
+    HV_H                  2, 1
+    lea                srcq, [srcq+ssq*2]
+    HV_H                  4, 1
+    lea                srcq, [srcq+ssq*2]
+    HV_H                  6, 0
+    add                srcq, ssq
+    vperm2i128           m1, m0, m2, 0x21 ; 1 2
+    vperm2i128           m3, m2, m4, 0x21 ; 3 4
+    vperm2i128           m5, m4, m6, 0x21 ; 5 6
+    V_INTERLEAVE
+%endmacro
+
+%macro HV_NEXT 0 ; m14/m15 = lo/hi sums of 2 rows
+    HV_H                 14, 1
+    lea                srcq, [srcq+ssq*2]
+    vperm2i128          m12, m6, m14, 0x21
+    mova                 m6, m14
+    punpcklwd           m13, m12, m14
+    punpckhwd           m12, m14
+    FILTER_8TAP_V        13, 12, 7
+%endmacro
+
+%macro HV_LOAD_FILTERS 0
+    LOAD_FILTER          mx, w
+    mova          [rsp+32*0], m8
+    mova          [rsp+32*1], m9
+    mova          [rsp+32*2], m10
+    mova          [rsp+32*3], m11
+    LOAD_FILTER          my, h
+    lea                cntq, [ssq*3+6]
+    sub                srcq, cntq
+%endmacro
+
+%if WIN64
+DECLARE_REG_TMP 4, 5
+%else
+DECLARE_REG_TMP 7, 8
+%endif
+%macro PUT_8TAP_FN 3 ; type, type_h, type_v
+cglobal put_8tap_%1_10bpc
+    mov                 t0d, FILTER_%2
+    mov                 t1d, FILTER_%3
+%ifnidn %1, sharp_smooth ; skip the jump in the last filter
+    jmp mangle(private_prefix %+ _put_8tap_10bpc %+ SUFFIX)
+%endif
+%endmacro
+
+PUT_8TAP_FN regular,        REGULAR, REGULAR
+PUT_8TAP_FN regular_sharp,  REGULAR, SHARP
+PUT_8TAP_FN regular_smooth, REGULAR, SMOOTH
+PUT_8TAP_FN smooth_regular, SMOOTH,  REGULAR
+PUT_8TAP_FN smooth,         SMOOTH,  SMOOTH
+PUT_8TAP_FN smooth_sharp,   SMOOTH,  SHARP
+PUT_8TAP_FN sharp_regular,  SHARP,   REGULAR
+PUT_8TAP_FN sharp,          SHARP,   SHARP
+PUT_8TAP_FN sharp_smooth,   SHARP,   SMOOTH
+
+cglobal put_8tap_10bpc, 4, 11, 16, 32*4, dst, ds, src, ss, w, h, mx, my, cnt, src0, dst0
+    imul                mxd, mxm, 0x010101
+    add                 mxd, t0d ; 8tap_h, mx, 4tap_h
+    imul                myd, mym, 0x010101
+    add                 myd, t1d ; 8tap_v, my, 4tap_v
+    movsxd               wq, wm
+    movifnidn            hd, hm
+    test                mxd, 0xf00
+    jnz .h
+    test                myd, 0xf00
+    jnz .v
+    PUT_COPY
+.h:
+    test                myd, 0xf00
+    jnz .hv
+    LOAD_FILTER          mx, w
+    mova                m12, [pd_34] ; 2 + (8 << 2)
+    pxor                m13, m13
+    mova                m14, [pw_1023]
+    sub                srcq, 6
+    cmp                  wd, 4
+    jl .h_w2
+    je .h_w4
+    mov                 mxd, hd
+    mov                cntd, wd
+    shr                cntd, 3
+    mov               src0q, srcq
+    mov               dst0q, dstq
+.h_w8:
+    PUT_8TAP_H
+    mova       [dstq+dsq*0], xm0
+    vextracti128 [dstq+dsq*1], m0, 1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .h_w8
+    add               src0q, 16
+    add               dst0q, 16
+    mov                srcq, src0q
+    mov                dstq, dst0q
+    mov                  hd, mxd
+    dec                cntd
+    jg .h_w8
+    RET
+.h_w2:
+    PUT_8TAP_H
+    vextracti128        xm1, m0, 1
+    movd       [dstq+dsq*0], xm0
+    movd       [dstq+dsq*1], xm1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .h_w2
+    RET
+.h_w4:
+    PUT_8TAP_H
+    vextracti128        xm1, m0, 1
+    movq       [dstq+dsq*0], xm0
+    movq       [dstq+dsq*1], xm1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .h_w4
+    RET
+.v:
+    LOAD_FILTER          my, h
+    lea                cntq, [ssq*3]
+    sub                srcq, cntq
+    cmp                  wd, 4
+    jl .v_w2
+    je .v_w4
+    mov                 mxd, hd
+    mov                cntd, wd
+    shr                cntd, 3
+    mov               src0q, srcq
+    mov               dst0q, dstq
+.v_w8:
+    V_INIT
+.v_w8_loop:
+    V_NEXT
+    paddd               m14, [pd_32]
+    paddd               m15, [pd_32]
+    psrad               m14, 6
+    psrad               m15, 6
+    packusdw            m14, m15
+    pminsw              m14, [pw_1023]
+    mova       [dstq+dsq*0], xm14
+    vextracti128 [dstq+dsq*1], m14, 1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .v_w8_loop
+    add               src0q, 16
+    add               dst0q, 16
+    mov                srcq, src0q
+    mov                dstq, dst0q
+    mov                  hd, mxd
+    dec                cntd
+    jg .v_w8
+    RET
+.v_w2:
+    V_INIT
+.v_w2_loop:
+    V_NEXT
+    paddd               m14, [pd_32]
+    paddd               m15, [pd_32]
+    psrad               m14, 6
+    psrad               m15, 6
+    packusdw            m14, m15
+    pminsw              m14, [pw_1023]
+    vextracti128       xm15, m14, 1
+    movd       [dstq+dsq*0], xm14
+    movd       [dstq+dsq*1], xm15
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .v_w2_loop
+    RET
+.v_w4:
+    V_INIT
+.v_w4_loop:
+    V_NEXT
+    paddd               m14, [pd_32]
+    paddd               m15, [pd_32]
+    psrad               m14, 6
+    psrad               m15, 6
+    packusdw            m14, m15
+    pminsw              m14, [pw_1023]
+    vextracti128       xm15, m14, 1
+    movq       [dstq+dsq*0], xm14
+    movq       [dstq+dsq*1], xm15
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .v_w4_loop
+    RET
+.hv:
+    HV_LOAD_FILTERS
+    cmp                  wd, 4
+    jl .hv_w2
+    je .hv_w4
+    mov                 mxd, hd
+    mov                cntd, wd
+    shr                cntd, 3
+    mov               src0q, srcq
+    mov               dst0q, dstq
+.hv_w8:
+    HV_INIT
+.hv_w8_loop:
+    HV_NEXT
+    paddd               m14, [pd_512]
+    paddd               m15, [pd_512]
+    psrad               m14, 10
+    psrad               m15, 10
+    packusdw            m14, m15
+    pminsw              m14, [pw_1023]
+    mova       [dstq+dsq*0], xm14
+    vextracti128 [dstq+dsq*1], m14, 1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .hv_w8_loop
+    add               src0q, 16
+    add               dst0q, 16
+    mov                srcq, src0q
+    mov                dstq, dst0q
+    mov                  hd, mxd
+    dec                cntd
+    jg .hv_w8
+    RET
+.hv_w2:
+    HV_INIT
+.hv_w2_loop:
+    HV_NEXT
+    paddd               m14, [pd_512]
+    paddd               m15, [pd_512]
+    psrad               m14, 10
+    psrad               m15, 10
+    packusdw            m14, m15
+    pminsw              m14, [pw_1023]
+    vextracti128       xm15, m14, 1
+    movd       [dstq+dsq*0], xm14
+    movd       [dstq+dsq*1], xm15
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .hv_w2_loop
+    RET
+.hv_w4:
+    HV_INIT
+.hv_w4_loop:
+    HV_NEXT
+    paddd               m14, [pd_512]
+    paddd               m15, [pd_512]
+    psrad               m14, 10
+    psrad               m15, 10
+    packusdw            m14, m15
+    pminsw              m14, [pw_1023]
+    vextracti128       xm15, m14, 1
+    movq       [dstq+dsq*0], xm14
+    movq       [dstq+dsq*1], xm15
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .hv_w4_loop
+    RET
+
+%if WIN64
+DECLARE_REG_TMP 6, 4
+%else
+DECLARE_REG_TMP 6, 7
+%endif
+%macro PREP_8TAP_FN 3 ; type, type_h, type_v
+cglobal prep_8tap_%1_10bpc
+    mov                 t0d, FILTER_%2
+    mov                 t1d, FILTER_%3
+%ifnidn %1, sharp_smooth ; skip the jump in the last filter
+    jmp mangle(private_prefix %+ _prep_8tap_10bpc %+ SUFFIX)
+%endif
+%endmacro
+
+PREP_8TAP_FN regular,        REGULAR, REGULAR
+PREP_8TAP_FN regular_sharp,  REGULAR, SHARP
+PREP_8TAP_FN regular_smooth, REGULAR, SMOOTH
+PREP_8TAP_FN smooth_regular, SMOOTH,  REGULAR
+PREP_8TAP_FN smooth,         SMOOTH,  SMOOTH
+PREP_8TAP_FN smooth_sharp,   SMOOTH,  SHARP
+PREP_8TAP_FN sharp_regular,  SHARP,   REGULAR
+PREP_8TAP_FN sharp,          SHARP,   SHARP
+PREP_8TAP_FN sharp_smooth,   SHARP,   SMOOTH
+
+cglobal prep_8tap_10bpc, 3, 10, 16, 32*4, tmp, src, ss, w, h, mx, my, cnt, src0, tmp0
+    imul                mxd, mxm, 0x010101
+    add                 mxd, t0d ; 8tap_h, mx, 4tap_h
+    imul                myd, mym, 0x010101
+    add                 myd, t1d ; 8tap_v, my, 4tap_v
+    movsxd               wq, wm
+    movifnidn            hd, hm
+    test                mxd, 0xf00
+    jnz .h
+    test                myd, 0xf00
+    jnz .v
+    PREP_COPY
+.h:
+    test                myd, 0xf00
+    jnz .hv
+    LOAD_FILTER          mx, w
+    mova                m12, [pd_2]
+    sub                srcq, 6
+    cmp                  wd, 4
+    je .h_w4
+    mov                 mxd, hd
+    mov                cntd, wd
+    shr                cntd, 3
+    mov               src0q, srcq
+    mov               tmp0q, tmpq
+.h_w8:
+    PREP_8TAP_H
+    PREP_STORE_W8          0, 1, 2
+    sub                  hd, 2
+    jg .h_w8
+    add               src0q, 16
+    add               tmp0q, 32
+    mov                srcq, src0q
+    mov                tmpq, tmp0q
+    mov                  hd, mxd
+    dec                cntd
+    jg .h_w8
+    RET
+.h_w4:
+    PREP_8TAP_H
+    mova             [tmpq], m0
+    add                tmpq, 32
+    sub                  hd, 2
+    jg .h_w4
+    RET
+.v:
+    LOAD_FILTER          my, h
+    lea                cntq, [ssq*3]
+    sub                srcq, cntq
+    cmp                  wd, 4
+    je .v_w4
+    mov                 mxd, hd
+    mov                cntd, wd
+    shr                cntd, 3
+    mov               src0q, srcq
+    mov               tmp0q, tmpq
+.v_w8:
+    V_INIT
+.v_w8_loop:
+    V_NEXT
+    paddd               m14, [pd_2]
+    paddd               m15, [pd_2]
+    psrad               m14, 2
+    psrad               m15, 2
+    PREP_STORE_W8         14, 15, 13
+    sub                  hd, 2
+    jg .v_w8_loop
+    add               src0q, 16
+    add               tmp0q, 32
+    mov                srcq, src0q
+    mov                tmpq, tmp0q
+    mov                  hd, mxd
+    dec                cntd
+    jg .v_w8
+    RET
+.v_w4:
+    V_INIT
+.v_w4_loop:
+    V_NEXT
+    paddd               m14, [pd_2]
+    psrad               m14, 2
+    mova             [tmpq], m14
+    add                tmpq, 32
+    sub                  hd, 2
+    jg .v_w4_loop
+    RET
+.hv:
+    HV_LOAD_FILTERS
+    cmp                  wd, 4
+    je .hv_w4
+    mov                 mxd, hd
+    mov                cntd, wd
+    shr                cntd, 3
+    mov               src0q, srcq
+    mov               tmp0q, tmpq
+.hv_w8:
+    HV_INIT
+.hv_w8_loop:
+    HV_NEXT
+    paddd               m14, [pd_32]
+    paddd               m15, [pd_32]
+    psrad               m14, 6
+    psrad               m15, 6
+    PREP_STORE_W8         14, 15, 13
+    sub                  hd, 2
+    jg .hv_w8_loop
+    add               src0q, 16
+    add               tmp0q, 32
+    mov                srcq, src0q
+    mov                tmpq, tmp0q
+    mov                  hd, mxd
+    dec                cntd
+    jg .hv_w8
+    RET
+.hv_w4:
+    HV_INIT
+.hv_w4_loop:
+    HV_NEXT
+    paddd               m14, [pd_32]
+    psrad               m14, 6
+    mova             [tmpq], m14
+    add                tmpq, 32
+    sub                  hd, 2
+    jg .hv_w4_loop
+    RET
+
+%macro BIDIR_FN 1 ; op
+    %1                    0
+    lea            stride3q, [strideq*3]
+    jmp                  wq
+.w4_loop:
+    %1_INC_PTR            2
+    %1                    0
+    lea                dstq, [dstq+strideq*4]
+.w4:
+    vextracti128        xm1, m0, 1
+    movq   [dstq          ], xm0
+    movhps [dstq+strideq*1], xm0
+    movq   [dstq+strideq*2], xm1
+    movhps [dstq+stride3q ], xm1
+    sub                  hd, 4
+    jg .w4_loop
+    RET
+.w8_loop:
+    %1_INC_PTR            2
+    %1                    0
+    lea                dstq, [dstq+strideq*2]
+.w8:
+    mova         [dstq          ], xm0
+    vextracti128 [dstq+strideq*1], m0, 1
+    sub                  hd, 2
+    jg .w8_loop
+    RET
+.w16_loop:
+    %1_INC_PTR            2
+    %1                    0
+    add                dstq, strideq
+.w16:
+    mova             [dstq], m0
+    dec                  hd
+    jg .w16_loop
+    RET
+.w32_loop:
+    %1_INC_PTR            4
+    %1                    0
+    add                dstq, strideq
+.w32:
+    mova          [dstq+ 0], m0
+    %1                    2
+    mova          [dstq+32], m0
+    dec                  hd
+    jg .w32_loop
+    RET
+.w64_loop:
+    %1_INC_PTR            8
+    %1                    0
+    add                dstq, strideq
+.w64:
+    mova        [dstq+0*32], m0
+    %1                    2
+    mova        [dstq+1*32], m0
+    %1                    4
+    mova        [dstq+2*32], m0
+    %1                    6
+    mova        [dstq+3*32], m0
+    dec                  hd
+    jg .w64_loop
+    RET
+.w128_loop:
+    %1_INC_PTR           16
+    %1                    0
+    add                dstq, strideq
+.w128:
+    mova        [dstq+0*32], m0
+    %1                    2
+    mova        [dstq+1*32], m0
+    %1                    4
+    mova        [dstq+2*32], m0
+    %1                    6
+    mova        [dstq+3*32], m0
+    %1                    8
+    mova        [dstq+4*32], m0
+    %1                   10
+    mova        [dstq+5*32], m0
+    %1                   12
+    mova        [dstq+6*32], m0
+    %1                   14
+    mova        [dstq+7*32], m0
+    dec                  hd
+    jg .w128_loop
+    RET
+%endmacro
+
+; each op produces 16 pixels in m0, from 2 registers of dword intermediates
+%macro BIDIR_PACK 1 ; shift
+    psrad                m0, %1
+    psrad                m1, %1
+    packusdw             m0, m1
+    pminsw               m0, m3
+    vpermq               m0, m0, q3120
+%endmacro
+
+%macro AVG 1 ; src_offset
+    mova                 m0, [tmp1q+(%1+0)*mmsize]
+    paddd                m0, [tmp2q+(%1+0)*mmsize]
+    mova                 m1, [tmp1q+(%1+1)*mmsize]
+    paddd                m1, [tmp2q+(%1+1)*mmsize]
+    paddd                m0, m2
+    paddd                m1, m2
+    BIDIR_PACK            5
+%endmacro
+
+%macro AVG_INC_PTR 1
+    add               tmp1q, %1*mmsize
+    add               tmp2q, %1*mmsize
+%endmacro
+
+cglobal avg_10bpc, 4, 7, 4, dst, stride, tmp1, tmp2, w, h, stride3
+    lea                  r6, [avg_10bpc_avx2_table]
+    tzcnt                wd, wm
+    movifnidn            hd, hm
+    movsxd               wq, dword [r6+wq*4]
+    mova                 m2, [pd_16]
+    mova                 m3, [pw_1023]
+    add                  wq, r6
+    BIDIR_FN            AVG
+
+%macro W_AVG 1 ; src_offset
+    ; (a * weight + b * (16 - weight) + 128) >> 8
+    ; = ((a - b) * weight + (b << 4) + 128) >> 8
+    mova                 m0, [tmp1q+(%1+0)*mmsize]
+    mova                 m5, [tmp2q+(%1+0)*mmsize]
+    mova                 m1, [tmp1q+(%1+1)*mmsize]
+    mova                 m6, [tmp2q+(%1+1)*mmsize]
+    psubd                m0, m5
+    psubd                m1, m6
+    pmulld               m0, m4
+    pmulld               m1, m4
+    pslld                m5, 4
+    pslld                m6, 4
+    paddd                m0, m5
+    paddd                m1, m6
+    paddd                m0, m2
+    paddd                m1, m2
+    BIDIR_PACK            8
+%endmacro
+
+%define W_AVG_INC_PTR AVG_INC_PTR
+
+cglobal w_avg_10bpc, 4, 7, 7, dst, stride, tmp1, tmp2, w, h, stride3
+    lea                  r6, [w_avg_10bpc_avx2_table]
+    tzcnt                wd, wm
+    movifnidn            hd, hm
+    vpbroadcastd         m4, r6m ; weight
+    movsxd               wq, dword [r6+wq*4]
+    mova                 m2, [pd_128]
+    mova                 m3, [pw_1023]
+    add                  wq, r6
+    BIDIR_FN          W_AVG
+
+%macro MASK 1 ; src_offset
+    ; (a * m + b * (64 - m) + 512) >> 10
+    ; = ((a - b) * m + (b << 6) + 512) >> 10
+    pmovzxbd             m4, [maskq+(%1+0)*8]
+    mova                 m0, [tmp1q+(%1+0)*mmsize]
+    mova                 m5, [tmp2q+(%1+0)*mmsize]
+    psubd                m0, m5
+    pmulld               m0, m4
+    pslld                m5, 6
+    paddd                m0, m5
+    pmovzxbd             m4, [maskq+(%1+1)*8]
+    mova                 m1, [tmp1q+(%1+1)*mmsize]
+    mova                 m5, [tmp2q+(%1+1)*mmsize]
+    psubd                m1, m5
+    pmulld               m1, m4
+    pslld                m5, 6
+    paddd                m1, m5
+    paddd                m0, m2
+    paddd                m1, m2
+    BIDIR_PACK           10
+%endmacro
+
+%macro MASK_INC_PTR 1
+    add               maskq, %1*8
+    add               tmp2q, %1*mmsize
+    add               tmp1q, %1*mmsize
+%endmacro
+
+cglobal mask_10bpc, 4, 8, 6, dst, stride, tmp1, tmp2, w, h, mask, stride3
+    lea                  r7, [mask_10bpc_avx2_table]
+    tzcnt                wd, wm
+    movifnidn            hd, hm
+    mov               maskq, maskmp
+    movsxd               wq, dword [r7+wq*4]
+    mova                 m2, [pd_512]
+    mova                 m3, [pw_1023]
+    add                  wq, r7
+    BIDIR_FN           MASK
+
+; m = min(38 + ((abs(a - b) + 32) >> 10), 64)
+%macro W_MASK_420_PX 3 ; tmp1/mask, tmp2, dst
+    psubd               m%3, m%1, m%2
+    pabsd               m%1, m%3
+    paddd               m%1, m10
+    psrld               m%1, 10
+    paddd               m%1, m11
+    pminsd              m%1, m12
+    pmulld              m%3, m%1
+    pslld               m%2, 6
+    paddd               m%3, m%2
+    paddd               m%3, m13
+    psrad               m%3, 10
+%endmacro
+
+cglobal w_mask_420_10bpc, 4, 9, 16, dst, stride, tmp1, tmp2, w, h, mask, cnt, dst0
+    movsxd               wq, wm
+    movifnidn            hd, hm
+    mov               maskq, maskmp
+    mov                cntd, 2
+    sub                cntd, r7m ; 2 - sign
+    movd               xm15, cntd
+    vpbroadcastd        m15, xm15
+    mova                m10, [pd_32]
+    mova                m11, [pd_38]
+    mova                m12, [pd_64]
+    mova                m13, [pd_512]
+    mova                m14, [pw_1023]
+    cmp                  wd, 4
+    je .w4
+.w8:
+    mov               dst0q, dstq
+    mov                cntd, wd
+.w8_loop:
+    mova                 m0, [tmp1q+wq*0]
+    mova                 m1, [tmp2q+wq*0]
+    mova                 m3, [tmp1q+wq*4]
+    mova                 m4, [tmp2q+wq*4]
+    W_MASK_420_PX         0, 1, 2
+    W_MASK_420_PX         3, 4, 5
+    packusdw             m2, m5
+    pminsw               m2, m14
+    vpermq               m2, m2, q3120
+    mova   [dstq+strideq*0], xm2
+    vextracti128 [dstq+strideq*1], m2, 1
+    paddd                m0, m3
+    phaddd               m0, m0
+    vpermq               m0, m0, q3120
+    paddd               xm0, xm15
+    psrld               xm0, 2
+    packusdw            xm0, xm0
+    packuswb            xm0, xm0
+    movd            [maskq], xm0
+    add               tmp1q, 32
+    add               tmp2q, 32
+    add                dstq, 16
+    add               maskq, 4
+    sub                cntd, 8
+    jg .w8_loop
+    lea               tmp1q, [tmp1q+wq*4]
+    lea               tmp2q, [tmp2q+wq*4]
+    lea                dstq, [dst0q+strideq*2]
+    sub                  hd, 2
+    jg .w8
+    RET
+.w4:
+    mova                 m0, [tmp1q]
+    mova                 m1, [tmp2q]
+    W_MASK_420_PX         0, 1, 2
+    packusdw             m2, m2
+    pminsw               m2, m14
+    vextracti128        xm1, m2, 1
+    movq   [dstq+strideq*0], xm2
+    movq   [dstq+strideq*1], xm1
+    vextracti128        xm1, m0, 1
+    paddd               xm0, xm1
+    phaddd              xm0, xm0
+    paddd               xm0, xm15
+    psrld               xm0, 2
+    packusdw            xm0, xm0
+    packuswb            xm0, xm0
+    pextrw          [maskq], xm0, 0
+    add               tmp1q, 32
+    add               tmp2q, 32
+    add               maskq, 2
+    lea                dstq, [dstq+strideq*2]
+    sub                  hd, 2
+    jg .w4
+    RET
+
+%endif ; ARCH_X86_64
@@ -0,0 +1,923 @@
+; Copyright © 2018, VideoLAN and dav1d authors
+; Copyright © 2018, Two Orioles, LLC
+; All rights reserved.
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice, this
+;    list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+; ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+; WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+; DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+; ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+; (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+; ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+; (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+; SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+%include "config.asm"
+%include "ext/x86/x86inc.asm"
+
+%if ARCH_X86_64
+
+SECTION_RODATA 64
+
+; The 512-bit versions only handle blocks that are at least 32 pixels wide,
+; anything narrower is passed on to the AVX2 versions. The intermediate
+; buffers are only guaranteed to be 32-byte aligned, so all accesses to
+; those use unaligned loads and stores.
+
+pq_h_perm:      dq 0, 1, 1, 2, 2, 3, 3, 5
+pq_pack:        dq 0, 2, 4, 6, 1, 3, 5, 7
+pq_unpack:      dq 0, 4, 1, 5, 2, 6, 3, 7
+subpel_h_shufA: db 0,  1,  2,  3,  1,  2,  3,  4,  2,  3,  4,  5,  3,  4,  5,  6
+subpel_h_shufB: db 4,  5,  6,  7,  5,  6,  7,  8,  6,  7,  8,  9,  7,  8,  9, 10
+subpel_h_shufC: db 8,  9, 10, 11,  9, 10, 11, 12, 10, 11, 12, 13, 11, 12, 13, 14
+
+pw_1:    times 2 dw 1
+pw_8:    times 2 dw 8
+pw_26:   times 2 dw 26
+pw_34:   times 2 dw 34
+pw_512:  times 2 dw 512
+pw_1024: times 2 dw 1024
+pw_2048: times 2 dw 2048
+pw_8192: times 2 dw 8192
+pd_32:   dd 32
+pd_258:  dd 258
+pd_512:  dd 512
+
+cextern mc_subpel_filters
+%define subpel_filters (mangle(private_prefix %+ _mc_subpel_filters)-8)
+
+%macro BIDIR_JMP_TABLE 1-4 32, 64, 128
+    %xdefine %1_table (%%table - 5*4)
+    %xdefine %%prefix mangle(private_prefix %+ _%1)
+    %%table:
+    %rep 3
+        dd %%prefix %+ .w%2 - (%%table - 5*4)
+        %rotate 1
+    %endrep
+%endmacro
+
+BIDIR_JMP_TABLE avg_avx512
+BIDIR_JMP_TABLE w_avg_avx512
+BIDIR_JMP_TABLE mask_avx512
+
+SECTION .text
+
+INIT_ZMM avx512
+
+; Loads two 32-pixel rows into the lower and upper half of a register
+%macro MOVU_ROW_PAIR 3 ; dst, src[1-2]
+    movu               ym%1, [%2]
+    vinserti32x8        m%1, m%1, [%3], 1
+%endmacro
+
+; 8-tap horizontal filter of 32 pixels, the output words are in order
+%macro FILTER_8TAP_H 5 ; dst, src, tmp[1-3]
+    movu               ym%1, [%2+ 0]
+    vinserti32x4        m%1, m%1, [%2+24], 2
+    vpermq              m%1, m4, m%1
+    pshufb              m%3, m%1, m5
+    pshufb              m%4, m%1, m6
+    pshufb              m%1, m7
+    pmaddubsw           m%3, m9
+    pmaddubsw           m%5, m%4, m10
+    pmaddubsw           m%4, m9
+    pmaddubsw           m%1, m10
+    paddw               m%3, m%5
+    paddw               m%1, m%4
+    pmaddwd             m%3, m11
+    pmaddwd             m%1, m11
+    packssdw            m%1, m%3, m%1
+%endmacro
+
+; 8-tap vertical filter of 64 pixels, the low/high output halves contain the
+; low/high 8 pixels of each 128-bit lane respectively
+%macro FILTER_8TAP_V 11 ; dst_lo, dst_hi, src[0-7], tmp
+    punpcklbw           m%1, m%3, m%4
+    punpckhbw           m%2, m%3, m%4
+    pmaddubsw           m%1, m12
+    pmaddubsw           m%2, m12
+    punpcklbw          m%11, m%5, m%6
+    pmaddubsw          m%11, m13
+    paddw               m%1, m%11
+    punpckhbw          m%11, m%5, m%6
+    pmaddubsw          m%11, m13
+    paddw               m%2, m%11
+    punpcklbw          m%11, m%7, m%8
+    pmaddubsw          m%11, m14
+    paddw               m%1, m%11
+    punpckhbw          m%11, m%7, m%8
+    pmaddubsw          m%11, m14
+    paddw               m%2, m%11
+    punpcklbw          m%11, m%9, m%10
+    pmaddubsw          m%11, m15
+    paddw               m%1, m%11
+    punpckhbw          m%11, m%9, m%10
+    pmaddubsw          m%11, m15
+    paddw               m%2, m%11
+%endmacro
+
+; 8-tap vertical filter of 32 intermediate pixels, the output is in order
+%macro FILTER_8TAP_HV_V 12 ; dst, src[0-7], tmp[1-2], shift
+    punpcklwd          m%10, m%2, m%3
+    punpckhwd           m%1, m%2, m%3
+    pmaddwd            m%10, m12
+    pmaddwd             m%1, m12
+    punpcklwd          m%11, m%4, m%5
+    pmaddwd            m%11, m13
+    paddd              m%10, m%11
+    punpckhwd          m%11, m%4, m%5
+    pmaddwd            m%11, m13
+    paddd               m%1, m%11
+    punpcklwd          m%11, m%6, m%7
+    pmaddwd            m%11, m14
+    paddd              m%10, m%11
+    punpckhwd          m%11, m%6, m%7
+    pmaddwd            m%11, m14
+    paddd               m%1, m%11
+    punpcklwd          m%11, m%8, m%9
+    pmaddwd            m%11, m15
+    paddd              m%10, m%11
+    punpckhwd          m%11, m%8, m%9
+    pmaddwd            m%11, m15
+    paddd               m%1, m%11
+    paddd              m%10, m16
+    paddd               m%1, m16
+    psrad              m%10, %12
+    psrad               m%1, %12
+    packssdw            m%1, m%10, m%1
+%endmacro
+
+%macro SHIFT_WINDOW 2-* ; dst, src, ...
+%rep %0 / 2
+    mova                m%1, m%2
+    %rotate 2
+%endrep
+%endmacro
+
+%macro HV_LOAD_FILTERS 0
+    movzx              cntd, myb ; 4tap_v
+    shr                 myd, 16  ; 8tap_v
+    cmp                  hd, 4
+    cmovle              myd, cntd
+    shr                 mxd, 16
+    lea                cntq, [subpel_filters]
+    vpbroadcastd         m9, [cntq+mxq*8+0]
+    vpbroadcastd        m10, [cntq+mxq*8+4]
+    vpbroadcastq         m0, [cntq+myq*8]
+    punpcklbw            m0, m0
+    psraw                m0, 8 ; sign-extend
+    pshufd              m12, m0, q0000
+    pshufd              m13, m0, q1111
+    pshufd              m14, m0, q2222
+    pshufd              m15, m0, q3333
+    mova                 m4, [pq_h_perm]
+    vbroadcasti32x4      m5, [subpel_h_shufA]
+    vbroadcasti32x4      m6, [subpel_h_shufB]
+    vbroadcasti32x4      m7, [subpel_h_shufC]
+    vpbroadcastd         m8, [pw_8192]
+    vpbroadcastd        m11, [pw_1]
+%endmacro
+
+; filters the first 7 rows of the vertical window for a column of 32 pixels,
+; leaving srcp pointing at the row following them
+%macro HV_LOAD_ROWS 0
+    FILTER_8TAP_H        18, srcpq, 0, 1, 2
+    pmulhrsw            m18, m8
+    add               srcpq, ssq
+    FILTER_8TAP_H        19, srcpq, 0, 1, 2
+    pmulhrsw            m19, m8
+    add               srcpq, ssq
+    FILTER_8TAP_H        20, srcpq, 0, 1, 2
+    pmulhrsw            m20, m8
+    add               srcpq, ssq
+    FILTER_8TAP_H        21, srcpq, 0, 1, 2
+    pmulhrsw            m21, m8
+    add               srcpq, ssq
+    FILTER_8TAP_H        22, srcpq, 0, 1, 2
+    pmulhrsw            m22, m8
+    add               srcpq, ssq
+    FILTER_8TAP_H        23, srcpq, 0, 1, 2
+    pmulhrsw            m23, m8
+    add               srcpq, ssq
+    FILTER_8TAP_H        24, srcpq, 0, 1, 2
+    pmulhrsw            m24, m8
+    add               srcpq, ssq
+%endmacro
+
+%assign FILTER_REGULAR (0*15 << 16) | 3*15
+%assign FILTER_SMOOTH  (1*15 << 16) | 4*15
+%assign FILTER_SHARP   (2*15 << 16) | 3*15
+
+; these need to match the AVX2 versions, which handle narrow blocks
+%if WIN64
+DECLARE_REG_TMP 4, 5
+%else
+DECLARE_REG_TMP 7, 8
+%endif
+%macro PUT_8TAP_FN 3 ; type, type_h, type_v
+cglobal put_8tap_%1
+    mov                 t0d, FILTER_%2
+    mov                 t1d, FILTER_%3
+%ifnidn %1, sharp_smooth ; skip the jump in the last filter
+    jmp mangle(private_prefix %+ _put_8tap %+ SUFFIX)
+%endif
+%endmacro
+
+PUT_8TAP_FN regular,        REGULAR, REGULAR
+PUT_8TAP_FN regular_sharp,  REGULAR, SHARP
+PUT_8TAP_FN regular_smooth, REGULAR, SMOOTH
+PUT_8TAP_FN smooth_regular, SMOOTH,  REGULAR
+PUT_8TAP_FN smooth,         SMOOTH,  SMOOTH
+PUT_8TAP_FN smooth_sharp,   SMOOTH,  SHARP
+PUT_8TAP_FN sharp_regular,  SHARP,   REGULAR
+PUT_8TAP_FN sharp,          SHARP,   SHARP
+PUT_8TAP_FN sharp_smooth,   SHARP,   SMOOTH
+
+cglobal put_8tap
+    mov                 r6d, r4m ; w
+    cmp                 r6d, 32
+    jl mangle(private_prefix %+ _put_8tap_avx2)
+    PROLOGUE              4, 10, 29, dst, ds, src, ss, w, h, mx, my, cnt, srcp
+    imul                mxd, mxm, 0x010101
+    add                 mxd, t0d ; 8tap_h, mx, 4tap_h
+    imul                myd, mym, 0x010101
+    add                 myd, t1d ; 8tap_v, my, 4tap_v
+    movsxd               wq, wm
+    movifnidn            hd, hm
+    test                mxd, 0xf00
+    jnz .h
+    test                myd, 0xf00
+    jnz .v
+    cmp                  wd, 32
+    jg .copy_w64
+.copy_w32:
+    movu                ym0, [srcq+ssq*0]
+    movu                ym1, [srcq+ssq*1]
+    lea                srcq, [srcq+ssq*2]
+    movu       [dstq+dsq*0], ym0
+    movu       [dstq+dsq*1], ym1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .copy_w32
+    RET
+.copy_w64:
+    cmp                  wd, 64
+    jg .copy_w128
+.copy_w64_loop:
+    movu                 m0, [srcq+ssq*0]
+    movu                 m1, [srcq+ssq*1]
+    lea                srcq, [srcq+ssq*2]
+    movu       [dstq+dsq*0], m0
+    movu       [dstq+dsq*1], m1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .copy_w64_loop
+    RET
+.copy_w128:
+    movu                 m0, [srcq+64*0]
+    movu                 m1, [srcq+64*1]
+    add                srcq, ssq
+    movu        [dstq+64*0], m0
+    movu        [dstq+64*1], m1
+    add                dstq, dsq
+    dec                  hd
+    jg .copy_w128
+    RET
+.h:
+    test                myd, 0xf00
+    jnz .hv
+    shr                 mxd, 16
+    lea                cntq, [subpel_filters]
+    vpbroadcastd         m9, [cntq+mxq*8+0]
+    vpbroadcastd        m10, [cntq+mxq*8+4]
+    mova                 m4, [pq_h_perm]
+    vbroadcasti32x4      m5, [subpel_h_shufA]
+    vbroadcasti32x4      m6, [subpel_h_shufB]
+    vbroadcasti32x4      m7, [subpel_h_shufC]
+    vpbroadcastd         m8, [pw_34] ; 2 + (8 << 2)
+    vpbroadcastd        m11, [pw_1]
+    mova                m17, [pq_pack]
+    sub                srcq, 3
+    cmp                  wd, 32
+    jg .h_w64
+.h_w32:
+    FILTER_8TAP_H         0, srcq+ssq*0, 2, 3, 27
+    FILTER_8TAP_H         1, srcq+ssq*1, 2, 3, 27
+    lea                srcq, [srcq+ssq*2]
+    paddw                m0, m8
+    paddw                m1, m8
+    psraw                m0, 6
+    psraw                m1, 6
+    packuswb             m0, m1
+    vpermq               m0, m17, m0
+    movu       [dstq+dsq*0], ym0
+    vextracti32x8 [dstq+dsq*1], m0, 1
+    lea                dstq, [dstq+dsq*2]
+    sub                  hd, 2
+    jg .h_w32
+    RET
+.h_w64:
+    xor                cntd, cntd
+.h_w64_loop:
+    FILTER_8TAP_H         0, srcq+cntq+32*0, 2, 3, 27
+    FILTER_8TAP_H         1, srcq+cntq+32*1, 2, 3, 27
+    paddw                m0, m8
+    paddw                m1, m8
+    psraw                m0, 6
+    psraw                m1, 6
+    packuswb             m0, m1
+    vpermq               m0, m17, m0
+    movu        [dstq+cntq], m0
+    add                cntd, 64
+    cmp                cntd, wd
+    jl .h_w64_loop
+    add                srcq, ssq
+    add                dstq, dsq
+    dec                  hd
+    jg .h_w64
+    RET
+.v:
+    movzx               mxd, myb ; 4tap_v
+    shr                 myd, 16  ; 8tap_v
+    cmp                  hd, 4
+    cmovle              myd, mxd
+    lea                cntq, [subpel_filters]
+    vpbroadcastw        m12, [cntq+myq*8+0]
+    vpbroadcastw        m13, [cntq+myq*8+2]
+    vpbroadcastw        m14, [cntq+myq*8+4]
+    vpbroadcastw        m15, [cntq+myq*8+6]
+    vpbroadcastd        m16, [pw_512]
+    DEFINE_ARGS dst, ds, src, ss, w, h, dstp, ss3, cnt, srcp
+    lea                ss3q, [ssq*3]
+    sub                srcq, ss3q
+    cmp                  wd, 32
+    jg .v_w64
+    ; each register holds two consecutive rows, which allows for filtering
+    ; two output rows at a time
+    MOVU_ROW_PAIR        18, srcq+ssq*0, srcq+ssq*1
+    MOVU_ROW_PAIR        19, srcq+ssq*1, srcq+ssq*2
+    MOVU_ROW_PAIR        20, srcq+ssq*2, srcq+ss3q
+    add                srcq, ss3q
+    MOVU_ROW_PAIR        21, srcq+ssq*0, srcq+ssq*1
+    MOVU_ROW_PAIR        22, srcq+ssq*1, srcq+ssq*2
+    MOVU_ROW_PAIR        23, srcq+ssq*2, srcq+ss3q
+    add                srcq, ss3q
+.v_w32_loop:
+    MOVU_ROW_PAIR        24, srcq+ssq*0, srcq+ssq*1
+    MOVU_ROW_PAIR        25, srcq+ssq*1, srcq+ssq*2
+    lea                srcq, [srcq+ssq*2]
+    FILTER_8TAP_V         0, 1, 18, 19, 20, 21, 22, 23, 24, 25, 2
+    pmulhrsw             m0, m16
+    pmulhrsw             m1, m16
+    packuswb             m0, m1
+    movu       [dstq+dsq*0], ym0
+    vextracti32x8 [dstq+dsq*1], m0, 1
+    lea                dstq, [dstq+dsq*2]
+    SHIFT_WINDOW         18, 20, 19, 21, 20, 22, 21, 23, 22, 24, 23, 25
+    sub                  hd, 2
+    jg .v_w32_loop
+    RET
+.v_w64:
+    mov               srcpq, srcq
+    mov               dstpq, dstq
+    mov                cntd, hd
+    movu                m18, [srcpq+ssq*0]
+    movu                m19, [srcpq+ssq*1]
+    movu                m20, [srcpq+ssq*2]
+    add               srcpq, ss3q
+    movu                m21, [srcpq+ssq*0]
+    movu                m22, [srcpq+ssq*1]
+    movu                m23, [srcpq+ssq*2]
+    add               srcpq, ss3q
+    movu                m24, [srcpq+ssq*0]
+    add               srcpq, ssq
+.v_w64_loop:
+    movu                m25, [srcpq+ssq*0]
+    movu                m26, [srcpq+ssq*1]
+    lea               srcpq, [srcpq+ssq*2]
+    FILTER_8TAP_V         0, 1, 18, 19, 20, 21, 22, 23, 24, 25, 27
+    FILTER_8TAP_V         2, 3, 19, 20, 21, 22, 23, 24, 25, 26, 28
+    pmulhrsw             m0, m16
+    pmulhrsw             m1, m16
+    pmulhrsw             m2, m16
+    pmulhrsw             m3, m16
+    packuswb             m0, m1
+    packuswb             m2, m3
+    movu      [dstpq+dsq*0], m0
+    movu      [dstpq+dsq*1], m2
+    lea               dstpq, [dstpq+dsq*2]
+    SHIFT_WINDOW         18, 20, 19, 21, 20, 22, 21, 23, 22, 24, 23, 25, 24, 26
+    sub                cntd, 2
+    jg .v_w64_loop
+    add                srcq, 64
+    add                dstq, 64
+    sub                  wd, 64
+    jg .v_w64
+    RET
+.hv:
+    DEFINE_ARGS dst, ds, src, ss, w, h, mx, my, cnt, srcp
+    HV_LOAD_FILTERS
+    vpbroadcastd        m16, [pd_512]
+    mova                m17, [pq_pack]
+    DEFINE_ARGS dst, ds, src, ss, w, h, dstp, ss3, cnt, srcp
+    lea                ss3q, [ssq*3]
+    sub                srcq, ss3q
+    sub                srcq, 3
+.hv_w32:
+    mov               srcpq, srcq
+    mov               dstpq, dstq
+    mov                cntd, hd
+    HV_LOAD_ROWS
+.hv_w32_loop:
+    FILTER_8TAP_H        25, srcpq+ssq*0, 0, 1, 2
+    FILTER_8TAP_H        26, srcpq+ssq*1, 0, 1, 2
+    lea               srcpq, [srcpq+ssq*2]
+    pmulhrsw            m25, m8
+    pmulhrsw            m26, m8
+    FILTER_8TAP_HV_V      0, 18, 19, 20, 21, 22, 23, 24, 25, 2, 3, 10
+    FILTER_8TAP_HV_V      1, 19, 20, 21, 22, 23, 24, 25, 26, 2, 3, 10
+    packuswb             m0, m1
+    vpermq               m0, m17, m0
+    movu      [dstpq+dsq*0], ym0
+    vextracti32x8 [dstpq+dsq*1], m0, 1
+    lea               dstpq, [dstpq+dsq*2]
+    SHIFT_WINDOW         18, 20, 19, 21, 20, 22, 21, 23, 22, 24, 23, 25, 24, 26
+    sub                cntd, 2
+    jg .hv_w32_loop
+    add                srcq, 32
+    add                dstq, 32
+    sub                  wd, 32
+    jg .hv_w32
+    RET
+
+%if WIN64
+DECLARE_REG_TMP 6, 4
+%else
+DECLARE_REG_TMP 6, 7
+%endif
+%macro PREP_8TAP_FN 3 ; type, type_h, type_v
+cglobal prep_8tap_%1
+    mov                 t0d, FILTER_%2
+    mov                 t1d, FILTER_%3
+%ifnidn %1, sharp_smooth ; skip the jump in the last filter
+    jmp mangle(private_prefix %+ _prep_8tap %+ SUFFIX)
+%endif
+%endmacro
+
+PREP_8TAP_FN regular,        REGULAR, REGULAR
+PREP_8TAP_FN regular_sharp,  REGULAR, SHARP
+PREP_8TAP_FN regular_smooth, REGULAR, SMOOTH
+PREP_8TAP_FN smooth_regular, SMOOTH,  REGULAR
+PREP_8TAP_FN smooth,         SMOOTH,  SMOOTH
+PREP_8TAP_FN smooth_sharp,   SMOOTH,  SHARP
+PREP_8TAP_FN sharp_regular,  SHARP,   REGULAR
+PREP_8TAP_FN sharp,          SHARP,   SHARP
+PREP_8TAP_FN sharp_smooth,   SHARP,   SMOOTH
+
+cglobal prep_8tap
+    cmp                 r3d, 32 ; w
+    jl mangle(private_prefix %+ _prep_8tap_avx2)
+    PROLOGUE              4, 11, 29, tmp, src, ss, w, h, mx, my, cnt, srcp, tmpp, ss3
+    imul                mxd, mxm, 0x010101
+    add                 mxd, t0d ; 8tap_h, mx, 4tap_h
+    imul                myd, mym, 0x010101
+    add                 myd, t1d ; 8tap_v, my, 4tap_v
+    movsxd               wq, wd
+    movifnidn            hd, hm
+    test                mxd, 0xf00
+    jnz .h
+    test                myd, 0xf00
+    jnz .v
+    cmp                  wd, 32
+    jg .copy_w64
+.copy_w32:
+    pmovzxbw             m0, [srcq+ssq*0]
+    pmovzxbw             m1, [srcq+ssq*1]
+    lea                srcq, [srcq+ssq*2]
+    psllw                m0, 4
+    psllw                m1, 4
+    movu        [tmpq+64*0], m0
+    movu        [tmpq+64*1], m1
+    add                tmpq, 64*2
+    sub                  hd, 2
+    jg .copy_w32
+    RET
+.copy_w64:
+    xor                cntd, cntd
+.copy_w64_loop:
+    pmovzxbw             m0, [srcq+cntq+32*0]
+    pmovzxbw             m1, [srcq+cntq+32*1]
+    psllw                m0, 4
+    psllw                m1, 4
+    movu        [tmpq+64*0], m0
+    movu        [tmpq+64*1], m1
+    add                tmpq, 64*2
+    add                cntd, 64
+    cmp                cntd, wd
+    jl .copy_w64_loop
+    add                srcq, ssq
+    dec                  hd
+    jg .copy_w64
+    RET
+.h:
+    test                myd, 0xf00
+    jnz .hv
+    shr                 mxd, 16
+    lea                cntq, [subpel_filters]
+    vpbroadcastd         m9, [cntq+mxq*8+0]
+    vpbroadcastd        m10, [cntq+mxq*8+4]
+    mova                 m4, [pq_h_perm]
+    vbroadcasti32x4      m5, [subpel_h_shufA]
+    vbroadcasti32x4      m6, [subpel_h_shufB]
+    vbroadcasti32x4      m7, [subpel_h_shufC]
+    vpbroadcastd         m8, [pw_8192]
+    vpbroadcastd        m11, [pw_1]
+    sub                srcq, 3
+    cmp                  wd, 32
+    jg .h_w64
+.h_w32:
+    FILTER_8TAP_H         0, srcq+ssq*0, 2, 3, 27
+    FILTER_8TAP_H         1, srcq+ssq*1, 2, 3, 27
+    lea                srcq, [srcq+ssq*2]
+    pmulhrsw             m0, m8
+    pmulhrsw             m1, m8
+    movu        [tmpq+64*0], m0
+    movu        [tmpq+64*1], m1
+    add                tmpq, 64*2
+    sub                  hd, 2
+    jg .h_w32
+    RET
+.h_w64:
+    xor                cntd, cntd
+.h_w64_loop:
+    FILTER_8TAP_H         0, srcq+cntq+32*0, 2, 3, 27
+    FILTER_8TAP_H         1, srcq+cntq+32*1, 2, 3, 27
+    pmulhrsw             m0, m8
+    pmulhrsw             m1, m8
+    movu        [tmpq+64*0], m0
+    movu        [tmpq+64*1], m1
+    add                tmpq, 64*2
+    add                cntd, 64
+    cmp                cntd, wd
+    jl .h_w64_loop
+    add                srcq, ssq
+    dec                  hd
+    jg .h_w64
+    RET
+.v:
+    movzx               mxd, myb ; 4tap_v
+    shr                 myd, 16  ; 8tap_v
+    cmp                  hd, 4
+    cmovle              myd, mxd
+    lea                cntq, [subpel_filters]
+    vpbroadcastw        m12, [cntq+myq*8+0]
+    vpbroadcastw        m13, [cntq+myq*8+2]
+    vpbroadcastw        m14, [cntq+myq*8+4]
+    vpbroadcastw        m15, [cntq+myq*8+6]
+    vpbroadcastd        m16, [pw_8192]
+    DEFINE_ARGS tmp, src, ss, w, h, col, my, cnt, srcp, tmpp, ss3
+    ; the source rows are permuted such that the low and high halves of the
+    ; filter output contain the first and last 32 pixels respectively
+    mova                m17, [pq_unpack]
+    lea                ss3q, [ssq*3]
+    sub                srcq, ss3q
+    cmp                  wd, 32
+    jg .v_w64
+    MOVU_ROW_PAIR        18, srcq+ssq*0, srcq+ssq*1
+    MOVU_ROW_PAIR        19, srcq+ssq*1, srcq+ssq*2
+    MOVU_ROW_PAIR        20, srcq+ssq*2, srcq+ss3q
+    add                srcq, ss3q
+    MOVU_ROW_PAIR        21, srcq+ssq*0, srcq+ssq*1
+    MOVU_ROW_PAIR        22, srcq+ssq*1, srcq+ssq*2
+    MOVU_ROW_PAIR        23, srcq+ssq*2, srcq+ss3q
+    add                srcq, ss3q
+    vpermq              m18, m17, m18
+    vpermq              m19, m17, m19
+    vpermq              m20, m17, m20
+    vpermq              m21, m17, m21
+    vpermq              m22, m17, m22
+    vpermq              m23, m17, m23
+.v_w32_loop:
+    MOVU_ROW_PAIR        24, srcq+ssq*0, srcq+ssq*1
+    MOVU_ROW_PAIR        25, srcq+ssq*1, srcq+ssq*2
+    lea                srcq, [srcq+ssq*2]
+    vpermq              m24, m17, m24
+    vpermq              m25, m17, m25
+    FILTER_8TAP_V         0, 1, 18, 19, 20, 21, 22, 23, 24, 25, 2
+    pmulhrsw             m0, m16
+    pmulhrsw             m1, m16
+    movu        [tmpq+64*0], m0
+    movu        [tmpq+64*1], m1
+    add                tmpq, 64*2
+    SHIFT_WINDOW         18, 20, 19, 21, 20, 22, 21, 23, 22, 24, 23, 25
+    sub                  hd, 2
+    jg .v_w32_loop
+    RET
+.v_w64:
+    mov                colq, wq
+.v_w64_loop0:
+    mov               srcpq, srcq
+    mov               tmppq, tmpq
+    mov                cntd, hd
+    vpermq              m18, m17, [srcpq+ssq*0]
+    vpermq              m19, m17, [srcpq+ssq*1]
+    vpermq              m20, m17, [srcpq+ssq*2]
+    add               srcpq, ss3q
+    vpermq              m21, m17, [srcpq+ssq*0]
+    vpermq              m22, m17, [srcpq+ssq*1]
+    vpermq              m23, m17, [srcpq+ssq*2]
+    add               srcpq, ss3q
+    vpermq              m24, m17, [srcpq+ssq*0]
+    add               srcpq, ssq
+.v_w64_loop:
+    vpermq              m25, m17, [srcpq+ssq*0]
+    vpermq              m26, m17, [srcpq+ssq*1]
+    lea               srcpq, [srcpq+ssq*2]
+    FILTER_8TAP_V         0, 1, 18, 19, 20, 21, 22, 23, 24, 25, 27
+    FILTER_8TAP_V         2, 3, 19, 20, 21, 22, 23, 24, 25, 26, 28
+    pmulhrsw             m0, m16
+    pmulhrsw             m1, m16
+    pmulhrsw             m2, m16
+    pmulhrsw             m3, m16
+    movu   [tmppq+64*0], m0
+    movu   [tmppq+64*1], m1
+    movu   [tmppq+wq*2+64*0], m2
+    movu   [tmppq+wq*2+64*1], m3
+    lea               tmppq, [tmppq+wq*4]
+    SHIFT_WINDOW         18, 20, 19, 21, 20, 22, 21, 23, 22, 24, 23, 25, 24, 26
+    sub                cntd, 2
+    jg .v_w64_loop
+    add                srcq, 64
+    add                tmpq, 64*2
+    sub                cold, 64
+    jg .v_w64_loop0
+    RET
+.hv:
+    DEFINE_ARGS tmp, src, ss, w, h, mx, my, cnt, srcp, tmpp, ss3
+    HV_LOAD_FILTERS
+    vpbroadcastd        m16, [pd_32]
+    DEFINE_ARGS tmp, src, ss, w, h, col, my, cnt, srcp, tmpp, ss3
+    lea                ss3q, [ssq*3]
+    sub                srcq, ss3q
+    sub                srcq, 3
+    mov                colq, wq
+.hv_w32:
+    mov               srcpq, srcq
+    mov               tmppq, tmpq
+    mov                cntd, hd
+    HV_LOAD_ROWS
+.hv_w32_loop:
+    FILTER_8TAP_H        25, srcpq+ssq*0, 0, 1, 2
+    FILTER_8TAP_H        26, srcpq+ssq*1, 0, 1, 2
+    lea               srcpq, [srcpq+ssq*2]
+    pmulhrsw            m25, m8
+    pmulhrsw            m26, m8
+    FILTER_8TAP_HV_V      0, 18, 19, 20, 21, 22, 23, 24, 25, 2, 3, 6
+    FILTER_8TAP_HV_V      1, 19, 20, 21, 22, 23, 24, 25, 26, 2, 3, 6
+    movu            [tmppq], m0
+    movu      [tmppq+wq*2], m1
+    lea               tmppq, [tmppq+wq*4]
+    SHIFT_WINDOW         18, 20, 19, 21, 20, 22, 21, 23, 22, 24, 23, 25, 24, 26
+    sub                cntd, 2
+    jg .hv_w32_loop
+    add                srcq, 32
+    add                tmpq, 64
+    sub                cold, 32
+    jg .hv_w32
+    RET
+
+%macro BIDIR_FN 1 ; op
+    %1                    0
+    jmp                  wq
+.w32_loop:
+    %1_INC_PTR            2
+    %1                    0
+    lea                dstq, [dstq+strideq*2]
+.w32:
+    vpermq               m0, m8, m0
+    movu   [dstq+strideq*0], ym0
+    vextracti32x8 [dstq+strideq*1], m0, 1
+    sub                  hd, 2
+    jg .w32_loop
+    RET
+.w64_loop:
+    %1_INC_PTR            2
+    %1                    0
+    add                dstq, strideq
+.w64:
+    vpermq               m0, m8, m0
+    movu             [dstq], m0
+    dec                  hd
+    jg .w64_loop
+    RET
+.w128_loop:
+    %1                    0
+    add                dstq, strideq
+.w128:
+    vpermq               m0, m8, m0
+    movu        [dstq+0*64], m0
+    %1                    2
+    vpermq               m0, m8, m0
+    movu        [dstq+1*64], m0
+    %1_INC_PTR            4
+    dec                  hd
+    jg .w128_loop
+    RET
+%endmacro
+
+%macro AVG 1 ; src_offset
+    movu                 m0, [tmp1q+(%1+0)*mmsize]
+    paddw                m0, [tmp2q+(%1+0)*mmsize]
+    movu                 m1, [tmp1q+(%1+1)*mmsize]
+    paddw                m1, [tmp2q+(%1+1)*mmsize]
+    pmulhrsw             m0, m2
+    pmulhrsw             m1, m2
+    packuswb             m0, m1
+%endmacro
+
+%macro AVG_INC_PTR 1
+    add               tmp1q, %1*mmsize
+    add               tmp2q, %1*mmsize
+%endmacro
+
+cglobal avg
+    mov                 r6d, r4m ; w
+    cmp                 r6d, 32
+    jl mangle(private_prefix %+ _avg_avx2)
+    PROLOGUE              4, 7, 9, dst, stride, tmp1, tmp2, w, h
+    lea                  r6, [avg_avx512_table]
+    tzcnt                wd, wm
+    movifnidn            hd, hm
+    movsxd               wq, dword [r6+wq*4]
+    vpbroadcastd         m2, [pw_1024]
+    mova                 m8, [pq_pack]
+    add                  wq, r6
+    BIDIR_FN            AVG
+
+%macro W_AVG 1 ; src_offset
+    ; (a * weight + b * (16 - weight) + 128) >> 8
+    ; = ((a - b) * weight + (b << 4) + 128) >> 8
+    ; = ((((b - a) * (-weight << 12)) >> 16) + b + 8) >> 4
+    movu                 m0,     [tmp2q+(%1+0)*mmsize]
+    psubw                m2, m0, [tmp1q+(%1+0)*mmsize]
+    movu                 m1,     [tmp2q+(%1+1)*mmsize]
+    psubw                m3, m1, [tmp1q+(%1+1)*mmsize]
+    paddw                m2, m2 ; compensate for the weight only being half
+    paddw                m3, m3 ; of what it should be
+    pmulhw               m2, m4
+    pmulhw               m3, m4
+    paddw                m0, m2
+    paddw                m1, m3
+    pmulhrsw             m0, m5
+    pmulhrsw             m1, m5
+    packuswb             m0, m1
+%endmacro
+
+%define W_AVG_INC_PTR AVG_INC_PTR
+
+cglobal w_avg
+    mov                 r6d, r4m ; w
+    cmp                 r6d, 32
+    jl mangle(private_prefix %+ _w_avg_avx2)
+    PROLOGUE              4, 7, 9, dst, stride, tmp1, tmp2, w, h
+    lea                  r6, [w_avg_avx512_table]
+    tzcnt                wd, wm
+    movifnidn            hd, hm
+    vpbroadcastw         m0, r6m ; weight
+    movsxd               wq, dword [r6+wq*4]
+    pxor                 m4, m4
+    psllw                m0, 11 ; can't shift by 12, sign bit must be preserved
+    psubw                m4, m0
+    vpbroadcastd         m5, [pw_2048]
+    mova                 m8, [pq_pack]
+    add                  wq, r6
+    BIDIR_FN          W_AVG
+
+%macro MASK 1 ; src_offset
+    ; (a * m + b * (64 - m) + 512) >> 10
+    ; = ((a - b) * m + (b << 6) + 512) >> 10
+    ; = ((((b - a) * (-m << 10)) >> 16) + b + 8) >> 4
+    vpermq               m3, m9, [maskq+(%1+0)*(mmsize/2)]
+    movu                 m0,     [tmp2q+(%1+0)*mmsize]
+    psubw                m1, m0, [tmp1q+(%1+0)*mmsize]
+    psubb                m3, m4, m3
+    paddw                m1, m1     ; (b - a) << 1
+    paddb                m3, m3
+    punpcklbw            m2, m4, m3 ; -m << 9
+    pmulhw               m1, m2
+    paddw                m0, m1
+    movu                 m1,     [tmp2q+(%1+1)*mmsize]
+    psubw                m2, m1, [tmp1q+(%1+1)*mmsize]
+    paddw                m2, m2
+    punpckhbw            m3, m4, m3
+    pmulhw               m2, m3
+    paddw                m1, m2
+    pmulhrsw             m0, m5
+    pmulhrsw             m1, m5
+    packuswb             m0, m1
+%endmacro
+
+%macro MASK_INC_PTR 1
+    add               maskq, %1*mmsize/2
+    add               tmp1q, %1*mmsize
+    add               tmp2q, %1*mmsize
+%endmacro
+
+cglobal mask
+    mov                 r6d, r4m ; w
+    cmp                 r6d, 32
+    jl mangle(private_prefix %+ _mask_avx2)
+    PROLOGUE              4, 8, 10, dst, stride, tmp1, tmp2, w, h, mask
+    lea                  r7, [mask_avx512_table]
+    tzcnt                wd, wm
+    movifnidn            hd, hm
+    mov               maskq, maskmp
+    movsxd               wq, dword [r7+wq*4]
+    pxor                 m4, m4
+    vpbroadcastd         m5, [pw_2048]
+    mova                 m8, [pq_pack]
+    mova                 m9, [pq_unpack]
+    add                  wq, r7
+    BIDIR_FN           MASK
+
+; processes 32 pixels of two consecutive rows
+%macro W_MASK_420 0
+    movu                 m0, [tmp1q]
+    movu                 m1, [tmp2q]
+    psubw                m1, m0
+    pabsw                m4, m1
+    paddw                m4, m6
+    psrlw                m4, 8      ; (abs(tmp1 - tmp2) + 8) >> 8
+    psubusw              m4, m7, m4 ; 64 - min(m, 64)
+    psllw                m2, m4, 10
+    pmulhw               m1, m2
+    paddw                m0, m1
+    movu                 m1, [tmp1q+wq*2]
+    movu                 m2, [tmp2q+wq*2]
+    psubw                m2, m1
+    pabsw                m3, m2
+    paddw                m3, m6
+    psrlw                m3, 8
+    psubusw              m3, m7, m3
+    paddw                m4, m3
+    psllw                m3, 10
+    pmulhw               m2, m3
+    paddw                m1, m2
+    pmulhrsw             m0, m8
+    pmulhrsw             m1, m8
+    packuswb             m0, m1
+    pmaddwd              m4, m10    ; sum of (64 - m) over each 2x2 block
+    psubd                m4, m9, m4
+    psrld                m4, 2
+%endmacro
+
+cglobal w_mask_420
+    mov                 r6d, r4m ; w
+    cmp                 r6d, 32
+    jl mangle(private_prefix %+ _w_mask_420_avx2)
+    PROLOGUE              4, 8, 12, dst, stride, tmp1, tmp2, w, h, mask, cnt
+    movsxd               wq, wm
+    movifnidn            hd, hm
+    mov               maskq, maskmp
+    vpbroadcastd         m0, r7m ; sign
+    vpbroadcastd         m6, [pw_8]
+    vpbroadcastd         m7, [pw_26]  ; 64 - 38
+    vpbroadcastd         m8, [pw_2048]
+    vpbroadcastd         m9, [pd_258] ; 64 * 4 + 2
+    vpbroadcastd        m10, [pw_1]
+    mova                m11, [pq_pack]
+    psubd                m9, m0
+.loop:
+    mov                cntd, wd
+.loop_x:
+    W_MASK_420
+    vpermq               m0, m11, m0
+    movu   [dstq+strideq*0], ym0
+    vextracti32x8 [dstq+strideq*1], m0, 1
+    vpmovdb          [maskq], m4
+    add                dstq, 32
+    add               tmp1q, 64
+    add               tmp2q, 64
+    add               maskq, 16
+    sub                cntd, 32
+    jg .loop_x
+    lea               tmp1q, [tmp1q+wq*2]
+    lea               tmp2q, [tmp2q+wq*2]
+    lea                dstq, [dstq+strideq*2]
+    sub                dstq, wq
+    sub                  hd, 2
+    jg .loop
+    RET
+
+%endif ; ARCH_X86_64
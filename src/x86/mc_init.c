@@ -28,6 +28,32 @@
 #include "src/cpu.h"
 #include "src/mc.h"
 
+decl_mc_fn(dav1d_put_8tap_regular_ssse3);
+decl_mc_fn(dav1d_put_8tap_regular_smooth_ssse3);
+decl_mc_fn(dav1d_put_8tap_regular_sharp_ssse3);
+decl_mc_fn(dav1d_put_8tap_smooth_ssse3);
+decl_mc_fn(dav1d_put_8tap_smooth_regular_ssse3);
+decl_mc_fn(dav1d_put_8tap_smooth_sharp_ssse3);
+decl_mc_fn(dav1d_put_8tap_sharp_ssse3);
+decl_mc_fn(dav1d_put_8tap_sharp_regular_ssse3);
+decl_mc_fn(dav1d_put_8tap_sharp_smooth_ssse3);
+decl_mc_fn(dav1d_put_bilin_ssse3);
+
+decl_mct_fn(dav1d_prep_8tap_regular_ssse3);
+decl_mct_fn(dav1d_prep_8tap_regular_smooth_ssse3);
+decl_mct_fn(dav1d_prep_8tap_regular_sharp_ssse3);
+decl_mct_fn(dav1d_prep_8tap_smooth_ssse3);
+decl_mct_fn(dav1d_prep_8tap_smooth_regular_ssse3);
+decl_mct_fn(dav1d_prep_8tap_smooth_sharp_ssse3);
+decl_mct_fn(dav1d_prep_8tap_sharp_ssse3);
+decl_mct_fn(dav1d_prep_8tap_sharp_regular_ssse3);
+decl_mct_fn(dav1d_prep_8tap_sharp_smooth_ssse3);
+decl_mct_fn(dav1d_prep_bilin_ssse3);
+
+decl_avg_fn(dav1d_avg_ssse3);
+decl_w_avg_fn(dav1d_w_avg_ssse3);
+decl_mask_fn(dav1d_mask_ssse3);
+
 decl_mc_fn(dav1d_put_8tap_regular_avx2);
 decl_mc_fn(dav1d_put_8tap_regular_smooth_avx2);
 decl_mc_fn(dav1d_put_8tap_regular_sharp_avx2);
@@ -53,7 +79,65 @@ decl_mct_fn(dav1d_prep_bilin_avx2);
 decl_avg_fn(dav1d_avg_avx2);
 decl_w_avg_fn(dav1d_w_avg_avx2);
 decl_mask_fn(dav1d_mask_avx2);
+decl_w_mask_fn(dav1d_w_mask_444_avx2);
+decl_w_mask_fn(dav1d_w_mask_422_avx2);
 decl_w_mask_fn(dav1d_w_mask_420_avx2);
+decl_blend_fn(dav1d_blend_avx2);
+decl_warp8x8_fn(dav1d_warp_affine_8x8_avx2);
+decl_warp8x8t_fn(dav1d_warp_affine_8x8t_avx2);
+decl_emu_edge_fn(dav1d_emu_edge_avx2);
+
+decl_mc_fn(dav1d_put_8tap_regular_10bpc_avx2);
+decl_mc_fn(dav1d_put_8tap_regular_smooth_10bpc_avx2);
+decl_mc_fn(dav1d_put_8tap_regular_sharp_10bpc_avx2);
+decl_mc_fn(dav1d_put_8tap_smooth_10bpc_avx2);
+decl_mc_fn(dav1d_put_8tap_smooth_regular_10bpc_avx2);
+decl_mc_fn(dav1d_put_8tap_smooth_sharp_10bpc_avx2);
+decl_mc_fn(dav1d_put_8tap_sharp_10bpc_avx2);
+decl_mc_fn(dav1d_put_8tap_sharp_regular_10bpc_avx2);
+decl_mc_fn(dav1d_put_8tap_sharp_smooth_10bpc_avx2);
+decl_mc_fn(dav1d_put_bilin_10bpc_avx2);
+
+decl_mct_fn(dav1d_prep_8tap_regular_10bpc_avx2);
+decl_mct_fn(dav1d_prep_8tap_regular_smooth_10bpc_avx2);
+decl_mct_fn(dav1d_prep_8tap_regular_sharp_10bpc_avx2);
+decl_mct_fn(dav1d_prep_8tap_smooth_10bpc_avx2);
+decl_mct_fn(dav1d_prep_8tap_smooth_regular_10bpc_avx2);
+decl_mct_fn(dav1d_prep_8tap_smooth_sharp_10bpc_avx2);
+decl_mct_fn(dav1d_prep_8tap_sharp_10bpc_avx2);
+decl_mct_fn(dav1d_prep_8tap_sharp_regular_10bpc_avx2);
+decl_mct_fn(dav1d_prep_8tap_sharp_smooth_10bpc_avx2);
+decl_mct_fn(dav1d_prep_bilin_10bpc_avx2);
+
+decl_avg_fn(dav1d_avg_10bpc_avx2);
+decl_w_avg_fn(dav1d_w_avg_10bpc_avx2);
+decl_mask_fn(dav1d_mask_10bpc_avx2);
+decl_w_mask_fn(dav1d_w_mask_420_10bpc_avx2);
+
+decl_mc_fn(dav1d_put_8tap_regular_avx512);
+decl_mc_fn(dav1d_put_8tap_regular_smooth_avx512);
+decl_mc_fn(dav1d_put_8tap_regular_sharp_avx512);
+decl_mc_fn(dav1d_put_8tap_smooth_avx512);
+decl_mc_fn(dav1d_put_8tap_smooth_regular_avx512);
+decl_mc_fn(dav1d_put_8tap_smooth_sharp_avx512);
+decl_mc_fn(dav1d_put_8tap_sharp_avx512);
+decl_mc_fn(dav1d_put_8tap_sharp_regular_avx512);
+decl_mc_fn(dav1d_put_8tap_sharp_smooth_avx512);
+
+decl_mct_fn(dav1d_prep_8tap_regular_avx512);
+decl_mct_fn(dav1d_prep_8tap_regular_smooth_avx512);
+decl_mct_fn(dav1d_prep_8tap_regular_sharp_avx512);
+decl_mct_fn(dav1d_prep_8tap_smooth_avx512);
+decl_mct_fn(dav1d_prep_8tap_smooth_regular_avx512);
+decl_mct_fn(dav1d_prep_8tap_smooth_sharp_avx512);
+decl_mct_fn(dav1d_prep_8tap_sharp_avx512);
+decl_mct_fn(dav1d_prep_8tap_sharp_regular_avx512);
+decl_mct_fn(dav1d_prep_8tap_sharp_smooth_avx512);
+
+decl_avg_fn(dav1d_avg_avx512);
+decl_w_avg_fn(dav1d_w_avg_avx512);
+decl_mask_fn(dav1d_mask_avx512);
+decl_w_mask_fn(dav1d_w_mask_420_avx512);
 
 void bitfn(dav1d_mc_dsp_init_x86)(Dav1dMCDSPContext *const c) {
 #define init_mc_fn(type, name, suffix) \
@@ -62,6 +146,36 @@ void bitfn(dav1d_mc_dsp_init_x86)(Dav1dMCDSPContext *const c) {
     c->mct[type] = dav1d_prep_##name##_##suffix
     const unsigned flags = dav1d_get_cpu_flags();
 
+    if (!(flags & DAV1D_X86_CPU_FLAG_SSSE3)) return;
+
+#if BITDEPTH == 8
+    init_mc_fn (FILTER_2D_8TAP_REGULAR,        8tap_regular,        ssse3);
+    init_mc_fn (FILTER_2D_8TAP_REGULAR_SMOOTH, 8tap_regular_smooth, ssse3);
+    init_mc_fn (FILTER_2D_8TAP_REGULAR_SHARP,  8tap_regular_sharp,  ssse3);
+    init_mc_fn (FILTER_2D_8TAP_SMOOTH_REGULAR, 8tap_smooth_regular, ssse3);
+    init_mc_fn (FILTER_2D_8TAP_SMOOTH,         8tap_smooth,         ssse3);
+    init_mc_fn (FILTER_2D_8TAP_SMOOTH_SHARP,   8tap_smooth_sharp,   ssse3);
+    init_mc_fn (FILTER_2D_8TAP_SHARP_REGULAR,  8tap_sharp_regular,  ssse3);
+    init_mc_fn (FILTER_2D_8TAP_SHARP_SMOOTH,   8tap_sharp_smooth,   ssse3);
+    init_mc_fn (FILTER_2D_8TAP_SHARP,          8tap_sharp,          ssse3);
+    init_mc_fn (FILTER_2D_BILINEAR,            bilin,               ssse3);
+
+    init_mct_fn(FILTER_2D_8TAP_REGULAR,        8tap_regular,        ssse3);
+    init_mct_fn(FILTER_2D_8TAP_REGULAR_SMOOTH, 8tap_regular_smooth, ssse3);
+    init_mct_fn(FILTER_2D_8TAP_REGULAR_SHARP,  8tap_regular_sharp,  ssse3);
+    init_mct_fn(FILTER_2D_8TAP_SMOOTH_REGULAR, 8tap_smooth_regular, ssse3);
+    init_mct_fn(FILTER_2D_8TAP_SMOOTH,         8tap_smooth,         ssse3);
+    init_mct_fn(FILTER_2D_8TAP_SMOOTH_SHARP,   8tap_smooth_sharp,   ssse3);
+    init_mct_fn(FILTER_2D_8TAP_SHARP_REGULAR,  8tap_sharp_regular,  ssse3);
+    init_mct_fn(FILTER_2D_8TAP_SHARP_SMOOTH,   8tap_sharp_smooth,   ssse3);
+    init_mct_fn(FILTER_2D_8TAP_SHARP,          8tap_sharp,          ssse3);
+    init_mct_fn(FILTER_2D_BILINEAR,            bilin,               ssse3);
+
+    c->avg = dav1d_avg_ssse3;
+    c->w_avg = dav1d_w_avg_ssse3;
+    c->mask = dav1d_mask_ssse3;
+#endif
+
     if (!(flags & DAV1D_X86_CPU_FLAG_AVX2)) return;
 
 #if BITDEPTH == 8 && ARCH_X86_64
@@ -90,6 +204,70 @@ void bitfn(dav1d_mc_dsp_init_x86)(Dav1dMCDSPContext *const c) {
     c->avg = dav1d_avg_avx2;
     c->w_avg = dav1d_w_avg_avx2;
     c->mask = dav1d_mask_avx2;
+    c->w_mask[0] = dav1d_w_mask_444_avx2;
+    c->w_mask[1] = dav1d_w_mask_422_avx2;
     c->w_mask[2] = dav1d_w_mask_420_avx2;
+    c->blend = dav1d_blend_avx2;
+
+    c->warp8x8  = dav1d_warp_affine_8x8_avx2;
+    c->warp8x8t = dav1d_warp_affine_8x8t_avx2;
+
+    c->emu_edge = dav1d_emu_edge_avx2;
+#elif BITDEPTH == 10 && ARCH_X86_64
+    init_mc_fn (FILTER_2D_8TAP_REGULAR,        8tap_regular_10bpc,        avx2);
+    init_mc_fn (FILTER_2D_8TAP_REGULAR_SMOOTH, 8tap_regular_smooth_10bpc, avx2);
+    init_mc_fn (FILTER_2D_8TAP_REGULAR_SHARP,  8tap_regular_sharp_10bpc,  avx2);
+    init_mc_fn (FILTER_2D_8TAP_SMOOTH_REGULAR, 8tap_smooth_regular_10bpc, avx2);
+    init_mc_fn (FILTER_2D_8TAP_SMOOTH,         8tap_smooth_10bpc,         avx2);
+    init_mc_fn (FILTER_2D_8TAP_SMOOTH_SHARP,   8tap_smooth_sharp_10bpc,   avx2);
+    init_mc_fn (FILTER_2D_8TAP_SHARP_REGULAR,  8tap_sharp_regular_10bpc,  avx2);
+    init_mc_fn (FILTER_2D_8TAP_SHARP_SMOOTH,   8tap_sharp_smooth_10bpc,   avx2);
+    init_mc_fn (FILTER_2D_8TAP_SHARP,          8tap_sharp_10bpc,          avx2);
+    init_mc_fn (FILTER_2D_BILINEAR,            bilin_10bpc,               avx2);
+
+    init_mct_fn(FILTER_2D_8TAP_REGULAR,        8tap_regular_10bpc,        avx2);
+    init_mct_fn(FILTER_2D_8TAP_REGULAR_SMOOTH, 8tap_regular_smooth_10bpc, avx2);
+    init_mct_fn(FILTER_2D_8TAP_REGULAR_SHARP,  8tap_regular_sharp_10bpc,  avx2);
+    init_mct_fn(FILTER_2D_8TAP_SMOOTH_REGULAR, 8tap_smooth_regular_10bpc, avx2);
+    init_mct_fn(FILTER_2D_8TAP_SMOOTH,         8tap_smooth_10bpc,         avx2);
+    init_mct_fn(FILTER_2D_8TAP_SMOOTH_SHARP,   8tap_smooth_sharp_10bpc,   avx2);
+    init_mct_fn(FILTER_2D_8TAP_SHARP_REGULAR,  8tap_sharp_regular_10bpc,  avx2);
+    init_mct_fn(FILTER_2D_8TAP_SHARP_SMOOTH,   8tap_sharp_smooth_10bpc,   avx2);
+    init_mct_fn(FILTER_2D_8TAP_SHARP,          8tap_sharp_10bpc,          avx2);
+    init_mct_fn(FILTER_2D_BILINEAR,            bilin_10bpc,               avx2);
+
+    c->avg = dav1d_avg_10bpc_avx2;
+    c->w_avg = dav1d_w_avg_10bpc_avx2;
+    c->mask = dav1d_mask_10bpc_avx2;
+    c->w_mask[2] = dav1d_w_mask_420_10bpc_avx2;
+#endif
+
+    if (!(flags & DAV1D_X86_CPU_FLAG_AVX512)) return;
+
+#if BITDEPTH == 8 && ARCH_X86_64
+    init_mc_fn (FILTER_2D_8TAP_REGULAR,        8tap_regular,        avx512);
+    init_mc_fn (FILTER_2D_8TAP_REGULAR_SMOOTH, 8tap_regular_smooth, avx512);
+    init_mc_fn (FILTER_2D_8TAP_REGULAR_SHARP,  8tap_regular_sharp,  avx512);
+    init_mc_fn (FILTER_2D_8TAP_SMOOTH_REGULAR, 8tap_smooth_regular, avx512);
+    init_mc_fn (FILTER_2D_8TAP_SMOOTH,         8tap_smooth,         avx512);
+    init_mc_fn (FILTER_2D_8TAP_SMOOTH_SHARP,   8tap_smooth_sharp,   avx512);
+    init_mc_fn (FILTER_2D_8TAP_SHARP_REGULAR,  8tap_sharp_regular,  avx512);
+    init_mc_fn (FILTER_2D_8TAP_SHARP_SMOOTH,   8tap_sharp_smooth,   avx512);
+    init_mc_fn (FILTER_2D_8TAP_SHARP,          8tap_sharp,          avx512);
+
+    init_mct_fn(FILTER_2D_8TAP_REGULAR,        8tap_regular,        avx512);
+    init_mct_fn(FILTER_2D_8TAP_REGULAR_SMOOTH, 8tap_regular_smooth, avx512);
+    init_mct_fn(FILTER_2D_8TAP_REGULAR_SHARP,  8tap_regular_sharp,  avx512);
+    init_mct_fn(FILTER_2D_8TAP_SMOOTH_REGULAR, 8tap_smooth_regular, avx512);
+    init_mct_fn(FILTER_2D_8TAP_SMOOTH,         8tap_smooth,         avx512);
+    init_mct_fn(FILTER_2D_8TAP_SMOOTH_SHARP,   8tap_smooth_sharp,   avx512);
+    init_mct_fn(FILTER_2D_8TAP_SHARP_REGULAR,  8tap_sharp_regular,  avx512);
+    init_mct_fn(FILTER_2D_8TAP_SHARP_SMOOTH,   8tap_sharp_smooth,   avx512);
+    init_mct_fn(FILTER_2D_8TAP_SHARP,          8tap_sharp,          avx512);
+
+    c->avg = dav1d_avg_avx512;
+    c->w_avg = dav1d_w_avg_avx512;
+    c->mask = dav1d_mask_avx512;
+    c->w_mask[2] = dav1d_w_mask_420_avx512;
 #endif
 }
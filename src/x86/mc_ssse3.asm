@@ -0,0 +1,839 @@
+; Copyright © 2018, VideoLAN and dav1d authors
+; Copyright © 2018, Two Orioles, LLC
+; All rights reserved.
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice, this
+;    list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+; ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+; WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+; DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+; ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+; (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+; ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+; (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+; SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+%include "config.asm"
+%include "ext/x86/x86inc.asm"
+
+; Unlike the AVX2 versions, everything in this file is written to run on
+; x86-32 as well, i.e. with 7 gprs and 8 xmm registers. The subpel functions
+; therefore keep their parameters in a small stack frame and process blocks
+; in columns of 8 (or 4) pixels, one row at a time.
+
+SECTION_RODATA 16
+
+subpel_h_shufA: db 0,  1,  2,  3,  1,  2,  3,  4,  2,  3,  4,  5,  3,  4,  5,  6
+subpel_h_shufB: db 4,  5,  6,  7,  5,  6,  7,  8,  6,  7,  8,  9,  7,  8,  9, 10
+subpel_h_shufC: db 8,  9, 10, 11,  9, 10, 11, 12, 10, 11, 12, 13, 11, 12, 13, 14
+
+pw_34:   times 8 dw 34
+pw_512:  times 8 dw 512
+pw_1024: times 8 dw 1024
+pw_2048: times 8 dw 2048
+pw_8192: times 8 dw 8192
+pd_8:    times 4 dd 8
+pd_32:   times 4 dd 32
+pd_128:  times 4 dd 128
+pd_512:  times 4 dd 512
+
+cextern mc_subpel_filters
+%define subpel_filters (mangle(private_prefix %+ _mc_subpel_filters)-8)
+
+SECTION .text
+
+INIT_XMM ssse3
+
+; stack frame layout of the put/prep functions
+%define FH0          [rsp+16*0]  ; horizontal filter, taps 0-3 (or the
+%define FH1          [rsp+16*1]  ; 4-tap filter in FH0 for w <= 4)
+%define FV(n)        [rsp+16*(2+n)] ; vertical filter, tap pair n
+%define stk_ds       [rsp+16*6+gprsize*0] ; dst stride in bytes
+%define stk_w        [rsp+16*6+gprsize*1]
+%define stk_h        [rsp+16*6+gprsize*2]
+%define stk_n        [rsp+16*6+gprsize*3] ; remaining 8-pixel columns
+%define stk_mx       [rsp+16*6+gprsize*4]
+%define stk_my       [rsp+16*6+gprsize*5]
+%define mid_buf       rsp+16*10  ; 16 bytes per row, (128 + 7) rows
+%assign mc_stack_size 16*10+16*135
+
+%if ARCH_X86_32
+DECLARE_REG_TMP 1, 2, 3
+%elif WIN64
+DECLARE_REG_TMP 4, 5, 6
+%else
+DECLARE_REG_TMP 7, 8, 6
+%endif
+
+; Moves all parameters to the stack frame (t0/t1 hold the filter types of
+; the 8-tap functions) and leaves src and the source stride in registers.
+%macro MC_SETUP 2 ; put/prep, 8tap/bilin
+%ifidn %2, 8tap
+    imul                t2d, mxm, 0x010101
+    add                 t2d, t0d ; 8tap_h, mx, 4tap_h
+    mov             stk_mx, t2q
+    imul                t2d, mym, 0x010101
+    add                 t2d, t1d ; 8tap_v, my, 4tap_v
+    mov             stk_my, t2q
+%else
+    mov                 t2d, mxm
+    mov             stk_mx, t2q
+    mov                 t2d, mym
+    mov             stk_my, t2q
+%endif
+    mov                 t2d, wm
+    mov              stk_w, t2q
+%ifidn %1, PUT
+    mov                 t2d, hm
+    mov              stk_h, t2q
+    mov                 t2q, dsmp
+    mov             stk_ds, t2q
+    mov                  r5, srcmp
+    mov                  r1, ssmp
+%else
+    add                 t2d, t2d
+    mov             stk_ds, t2q
+    mov                 t2d, hm
+    mov              stk_h, t2q
+    mov                  r5, srcmp
+    mov                  r1, stridemp
+%endif
+    mov                  r6, r0
+    DEFINE_ARGS d, ss, p, t, cnt, srcs, dsts
+%endmacro
+
+%macro LOADP 3 ; width, dst, src
+%if %1 == 8
+    movq                %2, %3
+%else
+    movd                %2, %3
+%endif
+%endmacro
+
+; Loads the filter coefficients for one direction into the stack frame.
+; Columns of 8 use the 8-tap filter, columns of 4 (w or h <= 4) the 4-tap one.
+%macro LOAD_8TAP_FILTER 1 ; h/v/hv
+    lea                  pq, [subpel_filters]
+%ifidn %1, h
+    mov                  td, stk_mx
+    cmp          dword stk_w, 4
+    jle %%w4
+    shr                  td, 16
+    movzx                td, tb
+    movq                 m0, [pq+tq*8]
+    pshufd               m1, m0, q0000
+    pshufd               m0, m0, q1111
+    mova               FH0, m1
+    mova               FH1, m0
+    jmp %%end
+%%w4:
+    movzx                td, tb
+    movd                 m0, [pq+tq*8+2]
+    pshufd               m0, m0, q0000
+    mova               FH0, m0
+%%end:
+%else
+    mov                  td, stk_my
+    cmp          dword stk_h, 4
+    jle %%h4
+    shr                  td, 16
+%%h4:
+    movzx                td, tb
+    movq                 m0, [pq+tq*8]
+%ifidn %1, hv
+    punpcklbw            m0, m0
+    psraw                m0, 8 ; sign-extend
+    pshufd               m1, m0, q0000
+    mova             FV(0), m1
+    pshufd               m1, m0, q1111
+    mova             FV(1), m1
+    pshufd               m1, m0, q2222
+    mova             FV(2), m1
+    pshufd               m0, m0, q3333
+    mova             FV(3), m0
+%else
+    pshuflw              m1, m0, q0000
+    punpcklqdq           m1, m1
+    mova             FV(0), m1
+    pshuflw              m1, m0, q1111
+    punpcklqdq           m1, m1
+    mova             FV(1), m1
+    pshuflw              m1, m0, q2222
+    punpcklqdq           m1, m1
+    mova             FV(2), m1
+    pshuflw              m0, m0, q3333
+    punpcklqdq           m0, m0
+    mova             FV(3), m0
+%endif
+%endif
+%endmacro
+
+; m5-m7 = subpel_h_shuf[A-C], returns 8 (or 4) words in m0
+%macro FILTER_8TAP_H 1 ; width
+%if %1 == 8
+    movu                 m0, [pq-3]
+    pshufb               m1, m0, m6
+    pshufb               m2, m0, m7
+    pshufb               m0, m5
+    pmaddubsw            m3, m1, FH0
+    pmaddubsw            m1, FH1
+    pmaddubsw            m2, FH1
+    pmaddubsw            m0, FH0
+    paddw                m2, m3
+    paddw                m0, m1
+    phaddw               m0, m2
+%else
+    movq                 m0, [pq-1]
+    pshufb               m0, m5
+    pmaddubsw            m0, FH0
+    phaddw               m0, m0
+%endif
+%endmacro
+
+%macro FILTER_8TAP_V 1 ; width
+    LOADP                %1, m0, [pq+ssq*0]
+    LOADP                %1, m4, [pq+ssq*1]
+    lea                  tq, [pq+ssq*2]
+    punpcklbw            m0, m4
+    LOADP                %1, m1, [tq+ssq*0]
+    LOADP                %1, m4, [tq+ssq*1]
+    lea                  tq, [tq+ssq*2]
+    punpcklbw            m1, m4
+    LOADP                %1, m2, [tq+ssq*0]
+    LOADP                %1, m4, [tq+ssq*1]
+    lea                  tq, [tq+ssq*2]
+    punpcklbw            m2, m4
+    LOADP                %1, m3, [tq+ssq*0]
+    LOADP                %1, m4, [tq+ssq*1]
+    punpcklbw            m3, m4
+    pmaddubsw            m0, FV(0)
+    pmaddubsw            m1, FV(1)
+    pmaddubsw            m2, FV(2)
+    pmaddubsw            m3, FV(3)
+    paddw                m0, m1
+    paddw                m2, m3
+    paddw                m0, m2
+%endmacro
+
+%macro HV_V_PAIR 5 ; width, row, filter, dst_lo, dst_hi
+    mova                m%4, [pq+16*%2]
+    mova                 m4, [pq+16*(%2+1)]
+%if %1 == 8
+    punpckhwd           m%5, m%4, m4
+    pmaddwd             m%5, FV(%3)
+%endif
+    punpcklwd           m%4, m4
+    pmaddwd             m%4, FV(%3)
+%endmacro
+
+; returns dwords in m0 (and m2 for width 8)
+%macro FILTER_8TAP_HV_V 1 ; width
+    HV_V_PAIR            %1, 0, 0, 0, 2
+    HV_V_PAIR            %1, 2, 1, 1, 3
+    paddd                m0, m1
+%if %1 == 8
+    paddd                m2, m3
+%endif
+    HV_V_PAIR            %1, 4, 2, 1, 3
+    paddd                m0, m1
+%if %1 == 8
+    paddd                m2, m3
+%endif
+    HV_V_PAIR            %1, 6, 3, 1, 3
+    paddd                m0, m1
+%if %1 == 8
+    paddd                m2, m3
+%endif
+%endmacro
+
+%macro HV_PACK 3 ; width, round, shift
+    paddd                m0, %2
+    psrad                m0, %3
+%if %1 == 8
+    paddd                m2, %2
+    psrad                m2, %3
+    packssdw             m0, m2
+%else
+    packssdw             m0, m0
+%endif
+%endmacro
+
+; m5 = bilinear coefficients as byte pairs
+%macro FILTER_BILIN_H 1 ; width
+    LOADP                %1, m0, [pq+0]
+    LOADP                %1, m1, [pq+1]
+    punpcklbw            m0, m1
+    pmaddubsw            m0, m5
+%endmacro
+
+%macro FILTER_BILIN_V 1 ; width
+    LOADP                %1, m0, [pq+ssq*0]
+    LOADP                %1, m1, [pq+ssq*1]
+    punpcklbw            m0, m1
+    pmaddubsw            m0, m5
+%endmacro
+
+; m6 = bilinear coefficients as word pairs, returns dwords in m0 (and m2)
+%macro FILTER_BILIN_HV_V 1 ; width
+    mova                 m0, [pq+16*0]
+    mova                 m4, [pq+16*1]
+%if %1 == 8
+    punpckhwd            m2, m0, m4
+    pmaddwd              m2, m6
+%endif
+    punpcklwd            m0, m4
+    pmaddwd              m0, m6
+%endmacro
+
+; row kernels, with rounding
+%macro PUT_8TAP_H 1
+    FILTER_8TAP_H        %1
+    paddw                m0, m4
+    psraw                m0, 6
+%endmacro
+
+%macro PREP_8TAP_H 1
+    FILTER_8TAP_H        %1
+    pmulhrsw             m0, m4
+%endmacro
+
+%macro HV_8TAP_H 1
+    FILTER_8TAP_H        %1
+    pmulhrsw             m0, [pw_8192]
+%endmacro
+
+%macro MC_8TAP_V 1
+    FILTER_8TAP_V        %1
+    pmulhrsw             m0, m7
+%endmacro
+
+%macro PUT_8TAP_HV_V 1
+    FILTER_8TAP_HV_V     %1
+    HV_PACK              %1, [pd_512], 10
+%endmacro
+
+%macro PREP_8TAP_HV_V 1
+    FILTER_8TAP_HV_V     %1
+    HV_PACK              %1, [pd_32], 6
+%endmacro
+
+%macro PUT_BILIN_H 1
+    FILTER_BILIN_H       %1
+    pmulhrsw             m0, m7
+%endmacro
+
+%macro PUT_BILIN_V 1
+    FILTER_BILIN_V       %1
+    pmulhrsw             m0, m7
+%endmacro
+
+%macro PUT_BILIN_HV_V 1
+    FILTER_BILIN_HV_V    %1
+    HV_PACK              %1, m7, 8
+%endmacro
+
+%macro PREP_BILIN_HV_V 1
+    FILTER_BILIN_HV_V    %1
+    HV_PACK              %1, m7, 4
+%endmacro
+
+%macro PREP_COPY_ROW 1
+    LOADP                %1, m0, [pq]
+    punpcklbw            m0, m4
+    psllw                m0, 4
+%endmacro
+
+; stores the words in m0
+%macro STORE_PUT 1 ; width
+    packuswb             m0, m0
+%if %1 == 8
+    movq               [dq], m0
+%elif %1 == 4
+    movd               [dq], m0
+%else
+    movd                 td, m0
+    mov                [dq], tw
+%endif
+%endmacro
+
+%macro STORE_PREP 1 ; width
+%if %1 == 8
+    mova               [dq], m0
+%else
+    movq               [dq], m0
+%endif
+%endmacro
+
+%macro STORE_MID 1 ; width
+    mova               [dq], m0
+%endmacro
+
+%macro MC_PASS 5 ; kernel, width, store, src_step, dst_step
+%%loop:
+    %1                   %2
+    %3                   %2
+    add                  pq, %4
+    add                  dq, %5
+    dec                cntd
+    jg %%loop
+%endmacro
+
+%macro MC_W_DISPATCH 2 ; name, PUT/PREP
+    cmp          dword stk_w, 4
+%ifidn %2, PUT
+    jl .%1_w2
+%endif
+    je .%1_w4
+%endmacro
+
+%macro MC_PATH 3 ; name, kernel, PUT/PREP
+.%1_w8:
+    mov                  td, stk_w
+    shr                  td, 3
+    mov              stk_n, tq
+.%1_w8_loop:
+    mov                  pq, srcsq
+    mov                  dq, dstsq
+    mov                cntd, stk_h
+    MC_PASS              %2, 8, STORE_%3, ssq, stk_ds
+    add               srcsq, 8
+%ifidn %3, PUT
+    add               dstsq, 8
+%else
+    add               dstsq, 16
+%endif
+    dec          dword stk_n
+    jg .%1_w8_loop
+    RET
+.%1_w4:
+    mov                  pq, srcsq
+    mov                  dq, dstsq
+    mov                cntd, stk_h
+    MC_PASS              %2, 4, STORE_%3, ssq, stk_ds
+    RET
+%ifidn %3, PUT
+.%1_w2:
+    mov                  pq, srcsq
+    mov                  dq, dstsq
+    mov                cntd, stk_h
+    MC_PASS              %2, 2, STORE_%3, ssq, stk_ds
+    RET
+%endif
+%endmacro
+
+; The first pass filters h + extra rows horizontally into mid_buf, the
+; second one filters them vertically into dst.
+%macro MC_HV_COLUMN 5 ; h_kernel, v_kernel, PUT/PREP, width, extra_rows
+    mov                  pq, srcsq
+    lea                  dq, [mid_buf]
+    mov                cntd, stk_h
+    add                cntd, %5
+    MC_PASS              %1, %4, STORE_MID, ssq, 16
+    lea                  pq, [mid_buf]
+    mov                  dq, dstsq
+    mov                cntd, stk_h
+    MC_PASS              %2, %4, STORE_%3, 16, stk_ds
+%endmacro
+
+%macro MC_HV_PATH 4 ; h_kernel, v_kernel, PUT/PREP, extra_rows
+.hv_w8:
+    mov                  td, stk_w
+    shr                  td, 3
+    mov              stk_n, tq
+.hv_w8_loop:
+    MC_HV_COLUMN         %1, %2, %3, 8, %4
+    add               srcsq, 8
+%ifidn %3, PUT
+    add               dstsq, 8
+%else
+    add               dstsq, 16
+%endif
+    dec          dword stk_n
+    jg .hv_w8_loop
+    RET
+.hv_w4:
+    MC_HV_COLUMN         %1, %2, %3, 4, %4
+    RET
+%ifidn %3, PUT
+.hv_w2:
+    MC_HV_COLUMN         %1, %2, %3, 2, %4
+    RET
+%endif
+%endmacro
+
+%macro PUT_COPY 0
+    cmp          dword stk_w, 4
+    jl .copy_w2
+    je .copy_w4
+    cmp          dword stk_w, 8
+    je .copy_w8
+    mov                  td, stk_w
+    shr                  td, 4
+    mov              stk_n, tq
+.copy_w16_loop:
+    mov                  pq, srcsq
+    mov                  dq, dstsq
+    mov                cntd, stk_h
+.copy_w16:
+    movu                 m0, [pq]
+    movu               [dq], m0
+    add                  pq, ssq
+    add                  dq, stk_ds
+    dec                cntd
+    jg .copy_w16
+    add               srcsq, 16
+    add               dstsq, 16
+    dec          dword stk_n
+    jg .copy_w16_loop
+    RET
+.copy_w8:
+    movq                 m0, [srcsq]
+    movq             [dstsq], m0
+    add               srcsq, ssq
+    add               dstsq, stk_ds
+    dec          dword stk_h
+    jg .copy_w8
+    RET
+.copy_w4:
+    movd                 m0, [srcsq]
+    movd             [dstsq], m0
+    add               srcsq, ssq
+    add               dstsq, stk_ds
+    dec          dword stk_h
+    jg .copy_w4
+    RET
+.copy_w2:
+    movzx                td, word [srcsq]
+    mov            [dstsq], tw
+    add               srcsq, ssq
+    add               dstsq, stk_ds
+    dec          dword stk_h
+    jg .copy_w2
+    RET
+%endmacro
+
+%macro PREP_COPY 0
+    pxor                 m4, m4
+    MC_W_DISPATCH      copy, PREP
+    MC_PATH            copy, PREP_COPY_ROW, PREP
+%endmacro
+
+%macro BILIN_COEF 2 ; dst, mx/my
+    mov                  td, %2
+    imul                 td, 255
+    add                  td, 16 ; (16 - mxy) | (mxy << 8)
+    movd                 %1, td
+    pshuflw              %1, %1, q0000
+    punpcklqdq           %1, %1
+%endmacro
+
+cglobal put_bilin, 1, 7, 8, -mc_stack_size, dst, ds, src, ss, w, h, mx, my
+    MC_SETUP            PUT, bilin
+    cmp         dword stk_mx, 0
+    jne .h
+    cmp         dword stk_my, 0
+    jne .v
+    PUT_COPY
+.h:
+    cmp         dword stk_my, 0
+    jne .hv
+    BILIN_COEF           m5, stk_mx
+    mova                 m7, [pw_2048]
+    MC_W_DISPATCH         h, PUT
+    MC_PATH               h, PUT_BILIN_H, PUT
+.v:
+    BILIN_COEF           m5, stk_my
+    mova                 m7, [pw_2048]
+    MC_W_DISPATCH         v, PUT
+    MC_PATH               v, PUT_BILIN_V, PUT
+.hv:
+    BILIN_COEF           m5, stk_mx
+    mov                  td, stk_my
+    imul                 td, 0xffff
+    add                  td, 16 ; (16 - my) | (my << 16)
+    movd                 m6, td
+    pshufd               m6, m6, q0000
+    mova                 m7, [pd_128]
+    MC_W_DISPATCH        hv, PUT
+    MC_HV_PATH           FILTER_BILIN_H, PUT_BILIN_HV_V, PUT, 1
+
+cglobal prep_bilin, 1, 7, 8, -mc_stack_size, tmp, src, stride, w, h, mx, my
+    MC_SETUP           PREP, bilin
+    cmp         dword stk_mx, 0
+    jne .h
+    cmp         dword stk_my, 0
+    jne .v
+    PREP_COPY
+.h:
+    cmp         dword stk_my, 0
+    jne .hv
+    BILIN_COEF           m5, stk_mx
+    MC_W_DISPATCH         h, PREP
+    MC_PATH               h, FILTER_BILIN_H, PREP
+.v:
+    BILIN_COEF           m5, stk_my
+    MC_W_DISPATCH         v, PREP
+    MC_PATH               v, FILTER_BILIN_V, PREP
+.hv:
+    BILIN_COEF           m5, stk_mx
+    mov                  td, stk_my
+    imul                 td, 0xffff
+    add                  td, 16
+    movd                 m6, td
+    pshufd               m6, m6, q0000
+    mova                 m7, [pd_8]
+    MC_W_DISPATCH        hv, PREP
+    MC_HV_PATH           FILTER_BILIN_H, PREP_BILIN_HV_V, PREP, 1
+
+%assign FILTER_REGULAR (0*15 << 16) | 3*15
+%assign FILTER_SMOOTH  (1*15 << 16) | 4*15
+%assign FILTER_SHARP   (2*15 << 16) | 3*15
+
+%macro MC_8TAP_FN 4 ; put/prep, type, type_h, type_v
+cglobal %1_8tap_%2
+    mov                 t0d, FILTER_%3
+    mov                 t1d, FILTER_%4
+%ifnidn %2, sharp_smooth ; skip the jump in the last filter
+    jmp mangle(private_prefix %+ _%1_8tap %+ SUFFIX)
+%endif
+%endmacro
+
+%macro MC_8TAP_FNS 1 ; put/prep
+MC_8TAP_FN %1, regular,        REGULAR, REGULAR
+MC_8TAP_FN %1, regular_sharp,  REGULAR, SHARP
+MC_8TAP_FN %1, regular_smooth, REGULAR, SMOOTH
+MC_8TAP_FN %1, smooth_regular, SMOOTH,  REGULAR
+MC_8TAP_FN %1, smooth,         SMOOTH,  SMOOTH
+MC_8TAP_FN %1, smooth_sharp,   SMOOTH,  SHARP
+MC_8TAP_FN %1, sharp_regular,  SHARP,   REGULAR
+MC_8TAP_FN %1, sharp,          SHARP,   SHARP
+MC_8TAP_FN %1, sharp_smooth,   SHARP,   SMOOTH
+%endmacro
+
+%macro SUBPEL_H_SHUF 0
+    mova                 m5, [subpel_h_shufA]
+    mova                 m6, [subpel_h_shufB]
+    mova                 m7, [subpel_h_shufC]
+%endmacro
+
+%macro SRC_BACK_3_ROWS 0
+    lea                  tq, [ssq*3]
+    sub               srcsq, tq
+%endmacro
+
+MC_8TAP_FNS put
+
+cglobal put_8tap, 1, 7, 8, -mc_stack_size, dst, ds, src, ss, w, h, mx, my
+    MC_SETUP            PUT, 8tap
+    test        dword stk_mx, 0xf00
+    jnz .h
+    test        dword stk_my, 0xf00
+    jnz .v
+    PUT_COPY
+.h:
+    test        dword stk_my, 0xf00
+    jnz .hv
+    SUBPEL_H_SHUF
+    mova                 m4, [pw_34] ; 2 + (8 << 2)
+    LOAD_8TAP_FILTER      h
+    MC_W_DISPATCH         h, PUT
+    MC_PATH               h, PUT_8TAP_H, PUT
+.v:
+    mova                 m7, [pw_512]
+    LOAD_8TAP_FILTER      v
+    SRC_BACK_3_ROWS
+    MC_W_DISPATCH         v, PUT
+    MC_PATH               v, MC_8TAP_V, PUT
+.hv:
+    SUBPEL_H_SHUF
+    LOAD_8TAP_FILTER      h
+    LOAD_8TAP_FILTER     hv
+    SRC_BACK_3_ROWS
+    MC_W_DISPATCH        hv, PUT
+    MC_HV_PATH           HV_8TAP_H, PUT_8TAP_HV_V, PUT, 7
+
+MC_8TAP_FNS prep
+
+cglobal prep_8tap, 1, 7, 8, -mc_stack_size, tmp, src, stride, w, h, mx, my
+    MC_SETUP           PREP, 8tap
+    test        dword stk_mx, 0xf00
+    jnz .h
+    test        dword stk_my, 0xf00
+    jnz .v
+    PREP_COPY
+.h:
+    test        dword stk_my, 0xf00
+    jnz .hv
+    SUBPEL_H_SHUF
+    mova                 m4, [pw_8192]
+    LOAD_8TAP_FILTER      h
+    MC_W_DISPATCH         h, PREP
+    MC_PATH               h, PREP_8TAP_H, PREP
+.v:
+    mova                 m7, [pw_8192]
+    LOAD_8TAP_FILTER      v
+    SRC_BACK_3_ROWS
+    MC_W_DISPATCH         v, PREP
+    MC_PATH               v, MC_8TAP_V, PREP
+.hv:
+    SUBPEL_H_SHUF
+    LOAD_8TAP_FILTER      h
+    LOAD_8TAP_FILTER     hv
+    SRC_BACK_3_ROWS
+    MC_W_DISPATCH        hv, PREP
+    MC_HV_PATH           HV_8TAP_H, PREP_8TAP_HV_V, PREP, 7
+
+; Each op produces 16 pixels in m0 from 2*mmsize bytes of both tmp buffers,
+; which is 4 rows of w4, 2 rows of w8 or a part of a single row otherwise.
+%macro BIDIR_FN 1 ; op
+    cmp                  wd, 8
+    jg .w16
+    je .w8
+.w4_loop:
+    %1                    0
+    movd             [dstq], m0
+    add                dstq, strideq
+    pshuflw              m1, m0, q1032
+    movd             [dstq], m1
+    add                dstq, strideq
+    punpckhqdq           m0, m0
+    movd             [dstq], m0
+    add                dstq, strideq
+    psrlq                m0, 32
+    movd             [dstq], m0
+    add                dstq, strideq
+    %1_INC_PTR            2
+    sub                  hd, 4
+    jg .w4_loop
+    RET
+.w8:
+    %1                    0
+    movq   [dstq          ], m0
+    movhps [dstq+strideq*1], m0
+    lea                dstq, [dstq+strideq*2]
+    %1_INC_PTR            2
+    sub                  hd, 2
+    jg .w8
+    RET
+.w16:
+%if ARCH_X86_32
+    DEFINE_ARGS dst, x, tmp1, tmp2, w, h, mask
+%else
+    DEFINE_ARGS dst, stride, tmp1, tmp2, w, h, mask, x
+%endif
+.w16_loop_y:
+    xor                  xd, xd
+.w16_loop_x:
+    %1                    0
+    mova        [dstq+xq], m0
+    %1_INC_PTR            2
+    add                  xd, 16
+    cmp                  xd, wd
+    jl .w16_loop_x
+    add                dstq, r1mp ; stride
+    dec                  hd
+    jg .w16_loop_y
+    RET
+%endmacro
+
+%macro AVG 1 ; src_offset
+    mova                 m0, [tmp1q+(%1+0)*mmsize]
+    paddw                m0, [tmp2q+(%1+0)*mmsize]
+    mova                 m1, [tmp1q+(%1+1)*mmsize]
+    paddw                m1, [tmp2q+(%1+1)*mmsize]
+    pmulhrsw             m0, m2
+    pmulhrsw             m1, m2
+    packuswb             m0, m1
+%endmacro
+
+%macro AVG_INC_PTR 1
+    add               tmp1q, %1*mmsize
+    add               tmp2q, %1*mmsize
+%endmacro
+
+cglobal avg, 4, 7+ARCH_X86_64, 3, dst, stride, tmp1, tmp2, w, h
+    movifnidn            wd, wm
+    movifnidn            hd, hm
+    mova                 m2, [pw_1024]
+    BIDIR_FN            AVG
+
+%macro W_AVG 1 ; src_offset
+    ; (a * weight + b * (16 - weight) + 128) >> 8
+    ; = ((a - b) * weight + (b << 4) + 128) >> 8
+    ; = ((((b - a) * (-weight << 12)) >> 16) + b + 8) >> 4
+    mova                 m0,     [tmp2q+(%1+0)*mmsize]
+    psubw                m2, m0, [tmp1q+(%1+0)*mmsize]
+    mova                 m1,     [tmp2q+(%1+1)*mmsize]
+    psubw                m3, m1, [tmp1q+(%1+1)*mmsize]
+    paddw                m2, m2 ; compensate for the weight only being half
+    paddw                m3, m3 ; of what it should be
+    pmulhw               m2, m4
+    pmulhw               m3, m4
+    paddw                m0, m2
+    paddw                m1, m3
+    pmulhrsw             m0, m5
+    pmulhrsw             m1, m5
+    packuswb             m0, m1
+%endmacro
+
+%define W_AVG_INC_PTR AVG_INC_PTR
+
+cglobal w_avg, 4, 7+ARCH_X86_64, 6, dst, stride, tmp1, tmp2, w, h
+    movifnidn            wd, wm
+    movifnidn            hd, hm
+    movd                 m0, r6m ; weight
+    pshuflw              m0, m0, q0000
+    punpcklqdq           m0, m0
+    pxor                 m4, m4
+    psllw                m0, 11 ; can't shift by 12, sign bit must be preserved
+    psubw                m4, m0
+    mova                 m5, [pw_2048]
+    BIDIR_FN          W_AVG
+
+%macro MASK 1 ; src_offset
+    ; (a * m + b * (64 - m) + 512) >> 10
+    ; = ((a - b) * m + (b << 6) + 512) >> 10
+    ; = ((((b - a) * (-m << 10)) >> 16) + b + 8) >> 4
+    movu                 m3,     [maskq+(%1+0)*(mmsize/2)]
+    mova                 m0,     [tmp2q+(%1+0)*mmsize]
+    psubw                m1, m0, [tmp1q+(%1+0)*mmsize]
+    psubb                m6, m4, m3
+    paddw                m1, m1     ; (b - a) << 1
+    paddb                m6, m6
+    punpcklbw            m2, m4, m6 ; -m << 9
+    pmulhw               m1, m2
+    paddw                m0, m1
+    mova                 m1,     [tmp2q+(%1+1)*mmsize]
+    psubw                m2, m1, [tmp1q+(%1+1)*mmsize]
+    paddw                m2, m2
+    punpckhbw            m3, m4, m6
+    pmulhw               m2, m3
+    paddw                m1, m2
+    pmulhrsw             m0, m5
+    pmulhrsw             m1, m5
+    packuswb             m0, m1
+%endmacro
+
+%macro MASK_INC_PTR 1
+    add               maskq, %1*mmsize/2
+    add               tmp1q, %1*mmsize
+    add               tmp2q, %1*mmsize
+%endmacro
+
+cglobal mask, 4, 7+ARCH_X86_64, 7, dst, stride, tmp1, tmp2, w, h, mask
+    movifnidn            wd, wm
+    movifnidn            hd, hm
+    mov               maskq, maskmp
+    pxor                 m4, m4
+    mova                 m5, [pw_2048]
+    BIDIR_FN           MASK
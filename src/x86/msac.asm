@@ -0,0 +1,254 @@
+; Copyright © 2018, VideoLAN and dav1d authors
+; Copyright © 2018, Two Orioles, LLC
+; All rights reserved.
+;
+; Redistribution and use in source and binary forms, with or without
+; modification, are permitted provided that the following conditions are met:
+;
+; 1. Redistributions of source code must retain the above copyright notice, this
+;    list of conditions and the following disclaimer.
+;
+; 2. Redistributions in binary form must reproduce the above copyright notice,
+;    this list of conditions and the following disclaimer in the documentation
+;    and/or other materials provided with the distribution.
+;
+; THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+; ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+; WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+; DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+; ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+; (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+; ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+; (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+; SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+%include "config.asm"
+%include "ext/x86/x86inc.asm"
+
+%if ARCH_X86_64
+
+SECTION_RODATA 16
+
+min_prob:  dw 60, 56, 52, 48, 44, 40, 36, 32, 28, 24, 20, 16, 12, 8, 4, 0
+lane_idx:  dw  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15
+pw_0x8000: times 8 dw 0x8000
+
+struc msac
+    .buf:       resq 1
+    .end:       resq 1
+    .bptr:      resq 1
+    .tell_offs: resd 1
+    .dif:       resd 1
+    .rng:       resw 1
+    .cnt:       resw 1
+    .error:     resd 1
+endstruc
+
+SECTION .text
+
+; unsigned msac_decode_symbol_adapt4/8/16(MsacContext *s, uint16_t *cdf,
+;                                         unsigned n_symbols)
+;
+; The cdf holds n_symbols - 1 inverse CDF values, a terminating 0 and the
+; adaptation counter, without any padding, so a full vector is loaded but
+; only the first n_symbols - 1 are stored back. The variants differ in the
+; upper bound of n_symbols, which decides how many words are processed.
+%macro DECODE_SYMBOL_ADAPT 1 ; max_symbols
+cglobal msac_decode_symbol_adapt%1, 3, 8, 8, 48, s, cdf, ns
+    ; keep rcx free for the variable shifts
+%if WIN64
+    mov                  r3, r0
+    DEFINE_ARGS sh, cdf, ns, s, dif, rng, ret, t0
+%else
+    DEFINE_ARGS s, cdf, ns, sh, dif, rng, ret, t0
+%endif
+    mov                 nsd, nsd
+    movzx              rngd, word [sq+msac.rng]
+    mov                difd, [sq+msac.dif]
+%if %1 == 4
+    movq                 m0, [cdfq]
+%else
+    movu                 m0, [cdfq+16*0]
+%endif
+%if %1 == 16
+    movu                 m1, [cdfq+16*1]
+%endif
+    ; v[i] = ((rng >> 8) * (icdf[i] >> 6) >> 1) + EC_MIN_PROB * (N - i),
+    ; with the product computed as (rng & 0xff00) * ((icdf[i] >> 6) << 7) >> 16
+    mov                 t0d, rngd
+    and                 t0d, 0xff00
+    movd                 m4, t0d
+    pshuflw              m4, m4, q0000
+    punpcklqdq           m4, m4
+    psrlw                m2, m0, 6
+    psllw                m2, 7
+    pmulhuw              m2, m4
+%if %1 == 16
+    psrlw                m3, m1, 6
+    psllw                m3, 7
+    pmulhuw              m3, m4
+%endif
+    lea                 t0d, [nsq*4-64]
+    movd                 m4, t0d
+    pshuflw              m4, m4, q0000
+    punpcklqdq           m4, m4
+    paddw                m2, m4
+    paddw                m2, [min_prob+16*0]
+%if %1 == 16
+    paddw                m3, m4
+    paddw                m3, [min_prob+16*1]
+%endif
+    ; the decoded symbol is the first i with v[i] <= c, which always
+    ; exists since v[N] == 0
+    mov                 t0d, difd
+    shr                 t0d, 16
+    movd                 m4, t0d
+    pshuflw              m4, m4, q0000
+    punpcklqdq           m4, m4
+    pxor                 m7, m7
+    psubusw              m5, m2, m4
+    pcmpeqw              m5, m7
+%if %1 == 16
+    psubusw              m6, m3, m4
+    pcmpeqw              m6, m7
+    packsswb             m5, m6
+%else
+    packsswb             m5, m5
+%endif
+    pmovmskb           retd, m5
+    bsf                retd, retd
+    ; u = ret ? v[ret - 1] : rng, v = v[ret]
+    mova        [rsp+16*1], m2
+%if %1 == 16
+    mova        [rsp+16*2], m3
+%endif
+    mov       [rsp+16*1-2], rngw
+    movzx               t0d, word [rsp+retq*2+16*1-2]
+    movzx              rngd, word [rsp+retq*2+16*1]
+    sub                 t0d, rngd
+    shl                rngd, 16
+    sub                difd, rngd
+
+    ; adapt the cdf, with rate = 4 + (n > 3) + (count > 15) + (count > 31)
+    movzx              rngd, word [cdfq+nsq*2]
+    xor                 shd, shd
+    cmp                 nsd, 4
+    setae               shb
+    add                 shd, 4
+    cmp                rngd, 16
+    sbb                 shd, -1
+    cmp                rngd, 32
+    sbb                 shd, -1
+    cmp                rngd, 32
+    adc                rngd, 0
+    mov     [cdfq+nsq*2], rngw
+    movd                 m4, shd
+    movd                 m5, retd
+    pshuflw              m5, m5, q0000
+    punpcklqdq           m5, m5
+    mova                 m7, [pw_0x8000]
+    mova                 m6, m5
+    pcmpgtw              m6, [lane_idx+16*0] ; i < ret
+    psubw                m2, m7, m0
+    psrlw                m2, m4
+    paddw                m2, m0              ; cdf + ((32768 - cdf) >> rate)
+%if %1 == 16
+    pcmpgtw              m5, [lane_idx+16*1]
+    psubw                m3, m7, m1
+    psrlw                m3, m4
+    paddw                m3, m1
+%endif
+    psrlw                m7, m0, m4
+    psubw                m0, m7              ; cdf - (cdf >> rate)
+    pand                 m2, m6
+    pandn                m6, m0
+    por                  m2, m6
+%if %1 == 16
+    psrlw                m7, m1, m4
+    psubw                m1, m7
+    pand                 m3, m5
+    pandn                m5, m1
+    por                  m3, m5
+%endif
+    ; store exactly N values
+    dec                 nsd
+%if %1 == 16
+    test                nsd, 8
+    jz .store4
+    movu             [cdfq], m2
+    add                cdfq, 16
+    mova                 m2, m3
+.store4:
+%endif
+%if %1 >= 8
+    test                nsd, 4
+    jz .store2
+    movq             [cdfq], m2
+    psrldq               m2, 8
+    add                cdfq, 8
+.store2:
+%endif
+    test                nsd, 2
+    jz .store1
+    movd             [cdfq], m2
+    psrldq               m2, 4
+    add                cdfq, 4
+.store1:
+    test                nsd, 1
+    jz .renorm
+    movd                nsd, m2
+    mov              [cdfq], nsw
+.renorm:
+    bsr                 shd, t0d
+    xor                 shd, 15
+    shl                 t0d, shb
+    mov       [sq+msac.rng], t0w
+    inc                difd
+    shl                difd, shb
+    dec                difd
+    movsx               t0d, word [sq+msac.cnt]
+    sub                 t0d, shd
+    js .refill
+    mov       [sq+msac.dif], difd
+    mov       [sq+msac.cnt], t0w
+    RET
+.refill:
+    ; as od_ec_dec_refill(), shifting in bytes at s = 8 - cnt
+    mov                 shd, 8
+    sub                 shd, t0d
+    mov                 nsq, [sq+msac.bptr]
+    mov                cdfq, [sq+msac.end]
+.refill_loop:
+    test                shd, shd
+    js .refill_end
+    cmp                 nsq, cdfq
+    jae .refill_end
+    movzx              rngd, byte [nsq]
+    inc                 nsq
+    shl                rngd, shb
+    xor                difd, rngd
+    add                 t0d, 8
+    sub                 shd, 8
+    jmp .refill_loop
+.refill_end:
+    cmp                 nsq, cdfq
+    jb .refill_done
+    mov                rngd, 0x4000
+    sub                rngd, t0d
+    add [sq+msac.tell_offs], rngd
+    mov                 t0d, 0x4000
+.refill_done:
+    mov      [sq+msac.bptr], nsq
+    mov       [sq+msac.dif], difd
+    mov       [sq+msac.cnt], t0w
+    RET
+%endmacro
+
+INIT_XMM sse2
+DECODE_SYMBOL_ADAPT 4
+DECODE_SYMBOL_ADAPT 8
+DECODE_SYMBOL_ADAPT 16
+
+%endif ; ARCH_X86_64
@@ -0,0 +1,131 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * Copyright © 2018, Two Orioles, LLC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "tests/checkasm/checkasm.h"
+
+#include <string.h>
+
+#include "src/cdef.h"
+
+static void init_pixels(pixel *const buf, const int n) {
+    const int bitdepth_max = (1 << BITDEPTH) - 1;
+    const int base = rand() & bitdepth_max;
+    const int amp = 1 + (rand() & 31);
+    const int noise = !(rand() & 3);
+
+    for (int i = 0; i < n; i++)
+        buf[i] = noise ? rand() & bitdepth_max :
+                 iclip(base + (rand() % (2 * amp + 1)) - amp, 0, bitdepth_max);
+}
+
+static void check_cdef_filter(const cdef_fn fn, const int w, const int h,
+                              const char *const name)
+{
+    ALIGN_STK_32(pixel, c_dst_mem, 16 * 16,);
+    ALIGN_STK_32(pixel, a_dst_mem, 16 * 16,);
+    pixel top_mem[2][16];
+    pixel *const top[2] = { top_mem[0] + 4, top_mem[1] + 4 };
+    pixel left[8][2];
+    const ptrdiff_t stride = 16 * sizeof(pixel);
+    pixel *const c_dst = c_dst_mem + 4 * 16 + 4;
+    pixel *const a_dst = a_dst_mem + 4 * 16 + 4;
+
+    declare_func(void, pixel *dst, ptrdiff_t stride, const pixel (*left)[2],
+                 pixel *const top[2], int pri_strength, int sec_strength,
+                 int dir, int damping, enum CdefEdgeFlags edges);
+
+    if (check_func(fn, "%s_%dbpc", name, BITDEPTH)) {
+        for (int edges = 0; edges < 16; edges++) {
+            for (int i = 0; i < 4; i++) {
+                const int pri_strength = (rand() & 15) << (BITDEPTH - 8);
+                const int sec_strength = ((1 << (rand() % 3)) &
+                                          -!!(rand() & 3)) << (BITDEPTH - 8);
+                const int dir = rand() & 7;
+                const int damping = 3 + (rand() & 3) + (BITDEPTH - 8);
+
+                init_pixels(c_dst_mem, 16 * 16);
+                init_pixels(top_mem[0], 2 * 16);
+                init_pixels(left[0], 8 * 2);
+                memcpy(a_dst_mem, c_dst_mem, 16 * 16 * sizeof(pixel));
+
+                call_ref(c_dst, stride, left, top, pri_strength, sec_strength,
+                         dir, damping, edges);
+                call_new(a_dst, stride, left, top, pri_strength, sec_strength,
+                         dir, damping, edges);
+                if (memcmp(c_dst_mem, a_dst_mem, 16 * 16 * sizeof(pixel)))
+                    fail();
+            }
+        }
+        bench_new(a_dst, stride, left, top, 12 << (BITDEPTH - 8),
+                  2 << (BITDEPTH - 8), 3, 5 + (BITDEPTH - 8), 15);
+    }
+}
+
+static void check_cdef_direction(const cdef_dir_fn fn) {
+    ALIGN_STK_32(pixel, src, 8 * 8,);
+
+    declare_func(int, const pixel *src, ptrdiff_t stride, unsigned *var);
+
+    if (check_func(fn, "cdef_dir_%dbpc", BITDEPTH)) {
+        unsigned c_var, a_var;
+
+        for (int i = 0; i < 64; i++) {
+            init_pixels(src, 8 * 8);
+            if (i & 1) {
+                /* a straight line in a random direction */
+                const int dx = (rand() % 7) - 3, dy = (rand() % 7) - 3;
+                for (int y = 0; y < 8; y++)
+                    for (int x = 0; x < 8; x++)
+                        if (!((x * dy - y * dx) & 3))
+                            src[y * 8 + x] = (1 << BITDEPTH) - 1;
+            }
+
+            const int c_dir = call_ref(src, 8 * sizeof(pixel), &c_var);
+            const int a_dir = call_new(src, 8 * sizeof(pixel), &a_var);
+            if (c_var != a_var || c_dir != a_dir) {
+                fail();
+                break;
+            }
+        }
+        bench_new(src, 8 * sizeof(pixel), &a_var);
+    }
+    report("cdef_dir");
+}
+
+void bitfn(checkasm_check_cdef)(void) {
+    Dav1dCdefDSPContext c;
+    memset(&c, 0, sizeof(c));
+    bitfn(dav1d_cdef_dsp_init)(&c);
+
+    check_cdef_direction(c.dir);
+
+    check_cdef_filter(c.fb[0], 8, 8, "cdef_filter_8x8");
+    check_cdef_filter(c.fb[1], 4, 8, "cdef_filter_4x8");
+    check_cdef_filter(c.fb[2], 4, 4, "cdef_filter_4x4");
+    report("cdef_filter");
+}
@@ -24,6 +24,9 @@
  * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+#ifdef __linux__
+#define _GNU_SOURCE /* syscall() */
+#endif
 #include "tests/checkasm/checkasm.h"
 
 #include <math.h>
@@ -51,8 +54,19 @@ static const struct {
     const char *name;
     void (*func)(void);
 } tests[] = {
+    { "cdef_8bpc", checkasm_check_cdef_8bpc },
+    { "cdef_10bpc", checkasm_check_cdef_10bpc },
+    { "ipred_8bpc", checkasm_check_ipred_8bpc },
+    { "ipred_10bpc", checkasm_check_ipred_10bpc },
+    { "itx_8bpc", checkasm_check_itx_8bpc },
+    { "itx_10bpc", checkasm_check_itx_10bpc },
+    { "lf_8bpc", checkasm_check_lf_8bpc },
+    { "lf_10bpc", checkasm_check_lf_10bpc },
+    { "looprestoration_8bpc", checkasm_check_looprestoration_8bpc },
+    { "looprestoration_10bpc", checkasm_check_looprestoration_10bpc },
     { "mc_8bpc", checkasm_check_mc_8bpc },
     { "mc_10bpc", checkasm_check_mc_10bpc },
+    { "msac", checkasm_check_msac },
     { 0 }
 };
 
@@ -78,6 +92,19 @@ static const struct {
     { 0 }
 };
 
+enum BenchFormat {
+    BENCH_FORMAT_TEXT,
+    BENCH_FORMAT_CSV,
+    BENCH_FORMAT_JSON,
+};
+
+/* Benchmark result loaded from a --compare baseline */
+typedef struct CheckasmBaseline {
+    char name[256];
+    char suffix[16];
+    double cycles;
+} CheckasmBaseline;
+
 typedef struct CheckasmFuncVersion {
     struct CheckasmFuncVersion *next;
     void *func;
@@ -103,6 +130,12 @@ static struct {
     const char *current_test_name;
     const char *bench_pattern;
     int bench_pattern_len;
+    enum BenchFormat bench_format;
+    int num_benched;
+    CheckasmBaseline *baseline;
+    int num_baseline;
+    double compare_threshold;
+    int num_regressed;
     int num_checked;
     int num_failed;
     int nop_time;
@@ -260,6 +293,45 @@ static const char *cpu_suffix(const unsigned cpu) {
     return "c";
 }
 
+#if (ARCH_AARCH64 || ARCH_ARM) && defined(__linux__) && defined(readtime)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+
+int checkasm_perf_fd = -1;
+
+/* Open a perf event counting the user space cycles of this thread.
+ * Returns 0 if the fallback timer can be used instead of it. */
+static int perf_init(void) {
+    struct perf_event_attr attr = {
+        .type           = PERF_TYPE_HARDWARE,
+        .size           = sizeof(struct perf_event_attr),
+        .config         = PERF_COUNT_HW_CPU_CYCLES,
+        .disabled       = 0,
+        .exclude_kernel = 1,
+        .exclude_hv     = 1,
+    };
+
+    checkasm_perf_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (checkasm_perf_fd >= 0)
+        return 0;
+#if ARCH_AARCH64
+    fprintf(stderr, "checkasm: perf_event_open failed, falling back to "
+            "cntvct_el0 (timings are in timer ticks)\n");
+    return 0;
+#else
+    fprintf(stderr, "checkasm: perf_event_open failed, --bench is not "
+            "supported on your system\n");
+    return 1;
+#endif
+}
+
+static void perf_uninit(void) {
+    if (checkasm_perf_fd >= 0)
+        close(checkasm_perf_fd);
+    checkasm_perf_fd = -1;
+}
+#endif
+
 #ifdef readtime
 static int cmp_nop(const void *a, const void *b) {
     return *(const uint16_t*)a - *(const uint16_t*)b;
@@ -282,6 +354,36 @@ static int measure_nop_time(void) {
     return nop_sum / 500;
 }
 
+/* Get the benchmark result of a function version (in decicycles) */
+static int get_decicycles(const CheckasmFuncVersion *const v) {
+    const int64_t decicycles =
+        (int64_t) (10*v->cycles/v->iterations) - state.nop_time;
+    /* the timing overhead can exceed the time of trivial functions; the
+     * formats print the value as "%d.%d", which needs it to be positive */
+    return decicycles > 0 ? (int) (decicycles / 4) : 0;
+}
+
+/* Flag a benchmark result that is slower than the --compare baseline */
+static void compare_bench(const char *const name, const char *const suffix,
+                          const int decicycles)
+{
+    for (int i = 0; i < state.num_baseline; i++) {
+        const CheckasmBaseline *const b = &state.baseline[i];
+        if (strcmp(b->name, name) || strcmp(b->suffix, suffix))
+            continue;
+        if (b->cycles > 0 &&
+            decicycles / 10.0 > b->cycles * (1 + state.compare_threshold / 100))
+        {
+            color_printf(COLOR_RED, "regression");
+            fprintf(stderr, ": %s_%s: %d.%d (baseline %.1f, %+.1f%%)\n",
+                    name, suffix, decicycles/10, decicycles%10, b->cycles,
+                    (decicycles / (10 * b->cycles) - 1) * 100);
+            state.num_regressed++;
+        }
+        return;
+    }
+}
+
 /* Print benchmark results */
 static void print_benchs(const CheckasmFunc *const f) {
     if (f) {
@@ -290,12 +392,43 @@ static void print_benchs(const CheckasmFunc *const f) {
         /* Only print functions with at least one assembly version */
         if (f->versions.cpu || f->versions.next) {
             const CheckasmFuncVersion *v = &f->versions;
+            int c_decicycles = 0;
+            do {
+                if (!v->cpu && v->iterations)
+                    c_decicycles = get_decicycles(v);
+            } while ((v = v->next));
+
+            v = &f->versions;
             do {
                 if (v->iterations) {
-                    int decicycles = (10*v->cycles/v->iterations -
-                                      state.nop_time) / 4;
-                    printf("%s_%s: %d.%d\n", f->name, cpu_suffix(v->cpu),
-                           decicycles/10, decicycles%10);
+                    const int decicycles = get_decicycles(v);
+                    const char *const suffix = cpu_suffix(v->cpu);
+                    const double speedup = c_decicycles > 0 && decicycles > 0 ?
+                        (double) c_decicycles / decicycles : 0;
+
+                    switch (state.bench_format) {
+                    case BENCH_FORMAT_TEXT:
+                        printf("%s_%s: %d.%d\n", f->name, suffix,
+                               decicycles/10, decicycles%10);
+                        break;
+                    case BENCH_FORMAT_CSV:
+                        printf("%s,%s,%d.%d,%d,%.2f\n", f->name, suffix,
+                               decicycles/10, decicycles%10, v->iterations,
+                               speedup);
+                        break;
+                    case BENCH_FORMAT_JSON:
+                        printf("%s\n    { \"function\": \"%s\", \"isa\": \"%s\", "
+                               "\"cycles\": %d.%d, \"iterations\": %d, "
+                               "\"speedup\": %.2f }",
+                               state.num_benched ? "," : "", f->name, suffix,
+                               decicycles/10, decicycles%10, v->iterations,
+                               speedup);
+                        break;
+                    }
+                    state.num_benched++;
+
+                    if (state.num_baseline)
+                        compare_bench(f->name, suffix, decicycles);
                 }
             } while ((v = v->next));
         }
@@ -303,6 +436,73 @@ static void print_benchs(const CheckasmFunc *const f) {
         print_benchs(f->child[1]);
     }
 }
+
+/* Find the string value of the specified key within [p, end) */
+static int parse_json_string(const char *const p, const char *const end,
+                             const char *const key, char *const dst,
+                             const size_t dst_size)
+{
+    const char *s = strstr(p, key);
+    if (!s || s >= end || !(s = strchr(s + strlen(key), '"')) || s >= end)
+        return 0;
+    s++;
+    const char *const e = strchr(s, '"');
+    if (!e || e >= end || (size_t)(e - s) >= dst_size)
+        return 0;
+    memcpy(dst, s, e - s);
+    dst[e - s] = 0;
+    return 1;
+}
+
+/* Load the results of a previous --bench-format=json run */
+static int load_baseline(const char *const filename) {
+    FILE *const f = fopen(filename, "rb");
+    if (!f) {
+        fprintf(stderr, "checkasm: failed to open '%s'\n", filename);
+        return -1;
+    }
+
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *const buf = checkasm_malloc(size + 1);
+    const size_t len = fread(buf, 1, size, f);
+    fclose(f);
+    buf[len] = 0;
+
+    int num = 0;
+    for (const char *p = buf; (p = strchr(p, '{')); p++)
+        num++;
+    state.baseline = checkasm_malloc((num + 1) * sizeof(*state.baseline));
+
+    for (const char *p = buf; (p = strstr(p, "\"function\"")); ) {
+        const char *end = strchr(p, '}');
+        if (!end)
+            break;
+        CheckasmBaseline *const b = &state.baseline[state.num_baseline];
+        const char *const cycles = strstr(p, "\"cycles\"");
+        if (parse_json_string(p, end, "\"function\"", b->name,
+                              sizeof(b->name)) &&
+            parse_json_string(p, end, "\"isa\"", b->suffix,
+                              sizeof(b->suffix)) &&
+            cycles && cycles < end)
+        {
+            const char *const colon = strchr(cycles, ':');
+            if (colon && colon < end) {
+                b->cycles = strtod(colon + 1, NULL);
+                state.num_baseline++;
+            }
+        }
+        p = end + 1;
+    }
+    free(buf);
+
+    if (!state.num_baseline) {
+        fprintf(stderr, "checkasm: no benchmark results in '%s'\n", filename);
+        return -1;
+    }
+    return 0;
+}
 #endif
 
 #define is_digit(x) ((x) >= '0' && (x) <= '9')
@@ -404,20 +604,49 @@ static void print_cpu_name(void) {
 }
 
 int main(int argc, char *argv[]) {
-#ifdef readtime
+#if defined(readtime) && ARCH_X86
     unsigned int seed = readtime();
 #else
+    /* the arm cycle counters trap unless the kernel enables user access,
+     * so only touch them when benchmarking */
     unsigned int seed = time(NULL);
 #endif
     int ret = 0;
 
+    state.compare_threshold = 5.0;
+
     /*if (!tests[0].func || !cpus[0].flag) {
         fprintf(stderr, "checkasm: no tests to perform\n");
         return 0;
     }*/
 
     while (argc > 1) {
-        if (!strncmp(argv[1], "--bench", 7)) {
+        if (!strncmp(argv[1], "--bench-format=", 15)) {
+            const char *const fmt = argv[1] + 15;
+            if (!strcmp(fmt, "text"))
+                state.bench_format = BENCH_FORMAT_TEXT;
+            else if (!strcmp(fmt, "csv"))
+                state.bench_format = BENCH_FORMAT_CSV;
+            else if (!strcmp(fmt, "json"))
+                state.bench_format = BENCH_FORMAT_JSON;
+            else {
+                fprintf(stderr, "checkasm: unknown bench format '%s'\n", fmt);
+                return 1;
+            }
+        } else if (!strncmp(argv[1], "--compare=", 10)) {
+#ifndef readtime
+            fprintf(stderr,
+                    "checkasm: --compare is not supported on your system\n");
+            return 1;
+#else
+            if (load_baseline(argv[1] + 10))
+                return 1;
+            if (!state.bench_pattern)
+                state.bench_pattern = "";
+#endif
+        } else if (!strncmp(argv[1], "--compare-threshold=", 20)) {
+            state.compare_threshold = strtod(argv[1] + 20, NULL);
+        } else if (!strncmp(argv[1], "--bench", 7)) {
 #ifndef readtime
             fprintf(stderr,
                     "checkasm: --bench is not supported on your system\n");
@@ -441,6 +670,11 @@ int main(int argc, char *argv[]) {
     fprintf(stderr, "checkasm: using random seed %u\n", seed);
     srand(seed);
 
+#if (ARCH_AARCH64 || ARCH_ARM) && defined(__linux__) && defined(readtime)
+    if (state.bench_pattern && perf_init())
+        return 1;
+#endif
+
     check_cpu_flag(NULL, 0);
     for (int i = 0; cpus[i].flag; i++)
         check_cpu_flag(cpus[i].name, cpus[i].flag);
@@ -454,13 +688,36 @@ int main(int argc, char *argv[]) {
 #ifdef readtime
         if (state.bench_pattern) {
             state.nop_time = measure_nop_time();
-            printf("nop: %d.%d\n", state.nop_time/10, state.nop_time%10);
+            switch (state.bench_format) {
+            case BENCH_FORMAT_TEXT:
+                printf("nop: %d.%d\n", state.nop_time/10, state.nop_time%10);
+                break;
+            case BENCH_FORMAT_CSV:
+                printf("function,isa,cycles,iterations,speedup\n");
+                break;
+            case BENCH_FORMAT_JSON:
+                printf("{\n  \"nop\": %d.%d,\n  \"benchmarks\": [",
+                       state.nop_time/10, state.nop_time%10);
+                break;
+            }
             print_benchs(state.funcs);
+            if (state.bench_format == BENCH_FORMAT_JSON)
+                printf("\n  ]\n}\n");
+            if (state.num_regressed) {
+                fprintf(stderr, "checkasm: %d benchmarks regressed by more "
+                        "than %.1f%%\n", state.num_regressed,
+                        state.compare_threshold);
+                ret = 1;
+            }
         }
 #endif
     }
 
+#if (ARCH_AARCH64 || ARCH_ARM) && defined(__linux__) && defined(readtime)
+    perf_uninit();
+#endif
     destroy_func_tree(state.funcs);
+    free(state.baseline);
     return ret;
 }
 
@@ -36,8 +36,19 @@
 #include "include/common/attributes.h"
 #include "include/common/intops.h"
 
+void checkasm_check_cdef_8bpc(void);
+void checkasm_check_cdef_10bpc(void);
+void checkasm_check_ipred_8bpc(void);
+void checkasm_check_ipred_10bpc(void);
+void checkasm_check_itx_8bpc(void);
+void checkasm_check_itx_10bpc(void);
+void checkasm_check_lf_8bpc(void);
+void checkasm_check_lf_10bpc(void);
+void checkasm_check_looprestoration_8bpc(void);
+void checkasm_check_looprestoration_10bpc(void);
 void checkasm_check_mc_8bpc(void);
 void checkasm_check_mc_10bpc(void);
+void checkasm_check_msac(void);
 
 void *checkasm_check_func(void *func, const char *name, ...);
 int checkasm_bench_func(void);
@@ -92,6 +103,53 @@ static inline uint64_t readtime(void) {
 }
 #define readtime readtime
 #endif
+#elif (ARCH_AARCH64 || ARCH_ARM) && defined(__linux__)
+#include <unistd.h>
+/* The PMU cycle counter is normally not accessible from user space on
+ * Linux, so count cycles through a perf event instead. Without one,
+ * fall back to the generic timer on AArch64, which ticks at a fixed
+ * frequency and thus has much worse precision. */
+extern int checkasm_perf_fd;
+static inline uint64_t readtime(void) {
+    uint64_t cycle_counter = 0;
+    if (checkasm_perf_fd >= 0) {
+        if (read(checkasm_perf_fd, &cycle_counter, sizeof(cycle_counter)) !=
+            sizeof(cycle_counter))
+            return 0;
+        return cycle_counter;
+    }
+#if ARCH_AARCH64
+    __asm__ __volatile__("isb\nmrs %0, cntvct_el0"
+                         : "=r"(cycle_counter)
+                         :: "memory");
+#endif
+    return cycle_counter;
+}
+#define readtime readtime
+#elif ARCH_AARCH64 && !defined(_MSC_VER)
+static inline uint64_t readtime(void) {
+    uint64_t cycle_counter;
+    /* This requires user mode access to the cycle counter to be enabled
+     * (which can only be done from kernel space). cntvct_el0 is always
+     * readable, but it is a fixed-frequency timer with much worse
+     * precision. */
+    __asm__ __volatile__("isb\nmrs %0, pmccntr_el0"
+                         : "=r"(cycle_counter)
+                         :: "memory");
+    return cycle_counter;
+}
+#define readtime readtime
+#elif ARCH_ARM && !defined(_MSC_VER) && __ARM_ARCH >= 7
+static inline uint64_t readtime(void) {
+    uint32_t cycle_counter;
+    /* This requires user mode access to the cycle counter to be enabled
+     * (which can only be done from kernel space). */
+    __asm__ __volatile__("isb\nmrc p15, 0, %0, c9, c13, 0"
+                         : "=r"(cycle_counter)
+                         :: "memory");
+    return cycle_counter;
+}
+#define readtime readtime
 #endif
 
 /* Verifies that clobbered callee-saved registers
@@ -0,0 +1,302 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * Copyright © 2018, Two Orioles, LLC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tests/checkasm/checkasm.h"
+
+#include <string.h>
+
+#include "src/ipred.h"
+#include "src/levels.h"
+#include "src/tables.h"
+
+static const char *const intra_pred_mode_names[N_IMPL_INTRA_PRED_MODES] = {
+    [DC_PRED]       = "dc",
+    [DC_128_PRED]   = "dc_128",
+    [TOP_DC_PRED]   = "dc_top",
+    [LEFT_DC_PRED]  = "dc_left",
+    [HOR_PRED]      = "h",
+    [VERT_PRED]     = "v",
+    [PAETH_PRED]    = "paeth",
+    [SMOOTH_PRED]   = "smooth",
+    [SMOOTH_V_PRED] = "smooth_v",
+    [SMOOTH_H_PRED] = "smooth_h",
+    [Z1_PRED]       = "z1",
+    [Z2_PRED]       = "z2",
+    [Z3_PRED]       = "z3",
+    [FILTER_PRED]   = "filter",
+};
+
+/* Returns a random angle which is valid for the given directional mode,
+ * with the smooth edge filter flag set half of the time. */
+static int get_angle(const int mode) {
+    static const int base_angles[] = { 45, 67, 90, 113, 135, 157, 180, 203 };
+    int angle;
+
+    do {
+        angle = base_angles[rand() & 7] + 3 * (rand() % 7 - 3);
+    } while (mode == Z1_PRED ? angle >= 90 :
+             mode == Z2_PRED ? angle <= 90 || angle >= 180 : angle <= 180);
+
+    return angle | (rand() & 0x200);
+}
+
+static void check_intra_pred(Dav1dIntraPredDSPContext *const c) {
+    ALIGN_STK_32(pixel, c_dst, 64 * 64,);
+    ALIGN_STK_32(pixel, a_dst, 64 * 64,);
+    pixel edge_mem[257], *const topleft = &edge_mem[128];
+
+    declare_func(void, pixel *dst, ptrdiff_t stride, const pixel *topleft,
+                 int angle);
+
+    for (int tx = 0; tx < N_RECT_TX_SIZES; tx++) {
+        const int w = av1_txfm_dimensions[tx].w * 4;
+        const int h = av1_txfm_dimensions[tx].h * 4;
+        const ptrdiff_t stride = w * sizeof(pixel);
+
+        for (int mode = 0; mode < N_IMPL_INTRA_PRED_MODES; mode++) {
+            if (check_func(c->intra_pred[tx][mode], "intra_pred_%s_%dx%d_%dbpc",
+                           intra_pred_mode_names[mode], w, h, BITDEPTH))
+            {
+                const int angle =
+                    mode == FILTER_PRED ? rand() % 5 :
+                    mode >= Z1_PRED && mode <= Z3_PRED ? get_angle(mode) : 0;
+                for (int i = 0; i < 257; i++)
+                    edge_mem[i] = rand() & ((1 << BITDEPTH) - 1);
+
+                call_ref(c_dst, stride, topleft, angle);
+                call_new(a_dst, stride, topleft, angle);
+                if (memcmp(c_dst, a_dst, w * h * sizeof(*c_dst)))
+                    fail();
+
+                bench_new(a_dst, stride, topleft, angle);
+            }
+        }
+    }
+    report("intra_pred");
+}
+
+static void check_cfl_pred(Dav1dIntraPredDSPContext *const c) {
+    ALIGN_STK_32(pixel, c_dst, 2, [32 * 32]);
+    ALIGN_STK_32(pixel, a_dst, 2, [32 * 32]);
+    ALIGN_STK_32(int16_t, ac, 32 * 32,);
+
+    declare_func(void, pixel *u_dst, pixel *v_dst, ptrdiff_t stride,
+                 const int16_t *ac, const int8_t *alphas, int height);
+
+    for (int lw = 0; lw < 4; lw++) {
+        const int w = 4 << lw;
+        const ptrdiff_t stride = w * sizeof(pixel);
+
+        for (int h = 4; h <= 32; h <<= 1) {
+            if (check_func(c->cfl_pred[lw], "cfl_pred_%dx%d_%dbpc",
+                           w, h, BITDEPTH))
+            {
+                const int8_t alphas[2] = { (rand() % 33) - 16,
+                                           (rand() % 33) - 16 };
+                for (int i = 0; i < w * h; i++)
+                    ac[i] = (rand() & 4095) - 2048;
+                for (int pl = 0; pl < 2; pl++)
+                    c_dst[pl][0] = a_dst[pl][0] = rand() & ((1 << BITDEPTH) - 1);
+
+                call_ref(c_dst[0], c_dst[1], stride, ac, alphas, h);
+                call_new(a_dst[0], a_dst[1], stride, ac, alphas, h);
+                if (memcmp(c_dst[0], a_dst[0], w * h * sizeof(pixel)) ||
+                    memcmp(c_dst[1], a_dst[1], w * h * sizeof(pixel)))
+                {
+                    fail();
+                }
+
+                bench_new(a_dst[0], a_dst[1], stride, ac, alphas, h);
+            }
+        }
+    }
+    report("cfl_pred");
+}
+
+static void check_cfl_pred_1(Dav1dIntraPredDSPContext *const c) {
+    ALIGN_STK_32(pixel, c_dst, 32 * 32,);
+    ALIGN_STK_32(pixel, a_dst, 32 * 32,);
+    ALIGN_STK_32(int16_t, ac, 32 * 32,);
+
+    declare_func(void, pixel *dst, ptrdiff_t stride, const int16_t *ac,
+                 int8_t alpha, int height);
+
+    for (int lw = 0; lw < 4; lw++) {
+        const int w = 4 << lw;
+        const ptrdiff_t stride = w * sizeof(pixel);
+
+        for (int h = 4; h <= 32; h <<= 1) {
+            if (check_func(c->cfl_pred_1[lw], "cfl_pred_1_%dx%d_%dbpc",
+                           w, h, BITDEPTH))
+            {
+                const int8_t alpha = (rand() % 33) - 16;
+                for (int i = 0; i < w * h; i++)
+                    ac[i] = (rand() & 4095) - 2048;
+                c_dst[0] = a_dst[0] = rand() & ((1 << BITDEPTH) - 1);
+
+                call_ref(c_dst, stride, ac, alpha, h);
+                call_new(a_dst, stride, ac, alpha, h);
+                if (memcmp(c_dst, a_dst, w * h * sizeof(*c_dst)))
+                    fail();
+
+                bench_new(a_dst, stride, ac, alpha, h);
+            }
+        }
+    }
+    report("cfl_pred_1");
+}
+
+static void check_pal_pred(Dav1dIntraPredDSPContext *const c) {
+    ALIGN_STK_32(pixel, c_dst, 64 * 64,);
+    ALIGN_STK_32(pixel, a_dst, 64 * 64,);
+    ALIGN_STK_32(uint8_t, idx, 64 * 64,);
+    uint16_t pal[8];
+
+    declare_func(void, pixel *dst, ptrdiff_t stride, const uint16_t *pal,
+                 const uint8_t *idx, int w, int h);
+
+    for (int w = 4; w <= 64; w <<= 1)
+        if (check_func(c->pal_pred, "pal_pred_w%d_%dbpc", w, BITDEPTH))
+            for (int h = imax(w / 4, 4); h <= imin(w * 4, 64); h <<= 1)
+            {
+                const ptrdiff_t stride = w * sizeof(pixel);
+
+                for (int i = 0; i < 8; i++)
+                    pal[i] = rand() & ((1 << BITDEPTH) - 1);
+                for (int i = 0; i < w * h; i++)
+                    idx[i] = rand() & 7;
+
+                call_ref(c_dst, stride, pal, idx, w, h);
+                call_new(a_dst, stride, pal, idx, w, h);
+                if (memcmp(c_dst, a_dst, w * h * sizeof(*c_dst)))
+                    fail();
+
+                bench_new(a_dst, stride, pal, idx, w, h);
+            }
+    report("pal_pred");
+}
+
+/* Returns the size of the edge that the z1, z2 (top, then left) or z3
+ * predictor of a w x h block passes to filter_edge() or upsample_edge(),
+ * and sets its offset from topleft and its valid range. */
+static int get_edge(const int type, const int w, const int h, const int up,
+                    int *const off, int *const from, int *const to)
+{
+    switch (type) {
+    case 0:
+        *off = 1, *from = -1, *to = w + imin(w, h);
+        return w + h;
+    case 1:
+        *off = !up, *from = up - 1, *to = w + up;
+        return w + up;
+    case 2:
+        *off = -h, *from = 0, *to = h + 1;
+        return h + up;
+    default:
+        *off = -(w + h), *from = imax(w - h, 0), *to = w + h + 1;
+        return w + h;
+    }
+}
+
+static void check_filter_edge(Dav1dIntraPredDSPContext *const c) {
+    ALIGN_STK_32(pixel, c_dst, 128 + 32,);
+    ALIGN_STK_32(pixel, a_dst, 128 + 32,);
+    pixel edge_mem[257], *const topleft = &edge_mem[128];
+
+    declare_func(void, pixel *out, int sz, const pixel *in, int from, int to,
+                 int strength);
+
+    for (int strength = 1; strength <= 3; strength++)
+        if (check_func(c->filter_edge, "filter_edge_s%d_%dbpc",
+                       strength, BITDEPTH))
+        {
+            for (int tx = 0; tx < N_RECT_TX_SIZES; tx++) {
+                const int w = av1_txfm_dimensions[tx].w * 4;
+                const int h = av1_txfm_dimensions[tx].h * 4;
+
+                for (int type = 0; type < 4; type++) {
+                    int off, from, to;
+                    const int sz = get_edge(type, w, h, 0, &off, &from, &to);
+
+                    for (int i = 0; i < 257; i++)
+                        edge_mem[i] = rand() & ((1 << BITDEPTH) - 1);
+                    for (int i = 0; i < 128 + 32; i++)
+                        c_dst[i] = a_dst[i] = 0x1234 & ((1 << BITDEPTH) - 1);
+
+                    call_ref(c_dst, sz, topleft + off, from, to, strength);
+                    call_new(a_dst, sz, topleft + off, from, to, strength);
+                    if (memcmp(c_dst, a_dst, sizeof(c_dst)))
+                        fail();
+                }
+            }
+            bench_new(a_dst, 128, topleft - 127, 0, 128, strength);
+        }
+    report("filter_edge");
+}
+
+static void check_upsample_edge(Dav1dIntraPredDSPContext *const c) {
+    ALIGN_STK_32(pixel, c_dst, 64,);
+    ALIGN_STK_32(pixel, a_dst, 64,);
+    pixel edge_mem[257], *const topleft = &edge_mem[128];
+
+    declare_func(void, pixel *out, int hsz, const pixel *in, int from, int to);
+
+    if (check_func(c->upsample_edge, "upsample_edge_%dbpc", BITDEPTH)) {
+        // upsampling is only done for blocks with w + h <= 16
+        for (int w = 4; w <= 8; w <<= 1)
+            for (int h = 4; w + h <= 16; h <<= 1)
+                for (int type = 0; type < 4; type++) {
+                    int off, from, to;
+                    const int hsz = get_edge(type, w, h, 1, &off, &from, &to);
+
+                    for (int i = 0; i < 257; i++)
+                        edge_mem[i] = rand() & ((1 << BITDEPTH) - 1);
+                    for (int i = 0; i < 64; i++)
+                        c_dst[i] = a_dst[i] = 0x1234 & ((1 << BITDEPTH) - 1);
+
+                    call_ref(c_dst, hsz, topleft + off, from, to);
+                    call_new(a_dst, hsz, topleft + off, from, to);
+                    if (memcmp(c_dst, a_dst, sizeof(c_dst)))
+                        fail();
+                }
+        bench_new(a_dst, 16, topleft + 1, -1, 16);
+    }
+    report("upsample_edge");
+}
+
+void bitfn(checkasm_check_ipred)(void) {
+    Dav1dIntraPredDSPContext c;
+    memset(&c, 0, sizeof(c));
+    bitfn(dav1d_intra_pred_dsp_init)(&c);
+
+    check_intra_pred(&c);
+    check_cfl_pred(&c);
+    check_cfl_pred_1(&c);
+    check_pal_pred(&c);
+    check_filter_edge(&c);
+    check_upsample_edge(&c);
+}
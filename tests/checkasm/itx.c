@@ -0,0 +1,116 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * Copyright © 2018, Two Orioles, LLC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tests/checkasm/checkasm.h"
+
+#include <string.h>
+
+#include "src/itx.h"
+#include "src/levels.h"
+#include "src/tables.h"
+
+static const char *const itx_1d_names[N_TX_TYPES] = {
+    [DCT_DCT]           = "dct_dct",
+    [ADST_DCT]          = "dct_adst",
+    [DCT_ADST]          = "adst_dct",
+    [ADST_ADST]         = "adst_adst",
+    [FLIPADST_DCT]      = "dct_flipadst",
+    [DCT_FLIPADST]      = "flipadst_dct",
+    [FLIPADST_FLIPADST] = "flipadst_flipadst",
+    [ADST_FLIPADST]     = "flipadst_adst",
+    [FLIPADST_ADST]     = "adst_flipadst",
+    [IDTX]              = "identity_identity",
+    [V_DCT]             = "identity_dct",
+    [H_DCT]             = "dct_identity",
+    [V_ADST]            = "identity_adst",
+    [H_ADST]            = "adst_identity",
+    [V_FLIPADST]        = "identity_flipadst",
+    [H_FLIPADST]        = "flipadst_identity",
+};
+
+/* Fills the first n coefficients with random values. The range is kept
+ * small enough for the intermediate results to fit in 16 bits, which is
+ * guaranteed for conforming streams but not for arbitrary input. */
+static void init_coef(coef *const buf, const int sz, const int n) {
+    memset(buf, 0, sz * sizeof(*buf));
+    for (int i = 0; i < n; i++)
+        buf[i] = (rand() & 511) - 256;
+}
+
+static void check_itxfm_add(Dav1dInvTxfmDSPContext *const c,
+                            const int tx)
+{
+    ALIGN_STK_32(coef, coeff, 2, [32 * 32]);
+    ALIGN_STK_32(pixel, c_dst, 64 * 64,);
+    ALIGN_STK_32(pixel, a_dst, 64 * 64,);
+
+    const int w = av1_txfm_dimensions[tx].w * 4;
+    const int h = av1_txfm_dimensions[tx].h * 4;
+    const int sz = imin(w, 32) * imin(h, 32);
+    const ptrdiff_t stride = w * sizeof(pixel);
+
+    declare_func(void, pixel *dst, ptrdiff_t dst_stride, coef *coeff, int eob);
+
+    for (int type = 0; type < N_TX_TYPES_PLUS_LL; type++) {
+        if (type == WHT_WHT && tx != TX_4X4) continue;
+        if (check_func(c->itxfm_add[tx][type], "inv_txfm_add_%s_%dx%d_%dbpc",
+                       type == WHT_WHT ? "wht_wht" : itx_1d_names[type],
+                       w, h, BITDEPTH))
+        {
+            // eob is the last set coefficient; the first iteration covers
+            // the DC-only (eob == 0) fast paths
+            int eob;
+            for (int n = 0; n < 2; n++) {
+                eob = n ? rand() % sz : 0;
+                init_coef(coeff[0], sz, eob + 1);
+                for (int i = 0; i < w * h; i++)
+                    c_dst[i] = a_dst[i] = rand() & ((1 << BITDEPTH) - 1);
+
+                memcpy(coeff[1], coeff[0], sz * sizeof(*coeff[0]));
+                call_ref(c_dst, stride, coeff[0], eob);
+                call_new(a_dst, stride, coeff[1], eob);
+                if (memcmp(c_dst, a_dst, w * h * sizeof(*c_dst)) ||
+                    memcmp(coeff[0], coeff[1], sz * sizeof(*coeff[0])))
+                {
+                    fail();
+                }
+            }
+
+            bench_new(a_dst, stride, coeff[1], eob);
+        }
+    }
+    report("itxfm_add");
+}
+
+void bitfn(checkasm_check_itx)(void) {
+    Dav1dInvTxfmDSPContext c;
+    memset(&c, 0, sizeof(c));
+    bitfn(dav1d_itx_dsp_init)(&c);
+
+    for (int tx = 0; tx < N_RECT_TX_SIZES; tx++)
+        check_itxfm_add(&c, tx);
+}
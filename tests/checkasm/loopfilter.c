@@ -0,0 +1,120 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * Copyright © 2018, Two Orioles, LLC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "tests/checkasm/checkasm.h"
+
+#include <string.h>
+
+#include "src/levels.h"
+#include "src/lf_mask.h"
+#include "src/loopfilter.h"
+
+/* Fills the picture with 4x4 blocks of nearly flat random content, so that
+ * all filter widths end up being used, or with plain noise, which mostly
+ * exercises the filter decision. */
+static void init_pixels(pixel *const buf, const ptrdiff_t stride,
+                        const int w, const int h)
+{
+    const int bitdepth_max = (1 << BITDEPTH) - 1;
+    const int noise = rand() & 1;
+    const int amp = 1 + (rand() & 7);
+    const int base = 64 + (rand() & 127);
+
+    for (int y = 0; y < h; y += 4)
+        for (int x = 0; x < w; x += 4) {
+            const int blk = base + (rand() % (2 * amp + 1)) - amp;
+            for (int i = 0; i < 4; i++)
+                for (int j = 0; j < 4; j++) {
+                    const int v = noise ? rand() & 255 : blk + (rand() & 1);
+                    buf[(y + i) * stride + x + j] =
+                        (v << (BITDEPTH - 8)) & bitdepth_max;
+                }
+        }
+}
+
+static void check_lpf_sb(loopfilter_sb_fn fn, const char *const name,
+                         const int n_masks, const int is_v)
+{
+    ALIGN_STK_32(pixel, c_dst_mem, 128 * 32,);
+    ALIGN_STK_32(pixel, a_dst_mem, 128 * 32,);
+    uint8_t l[33][33][4];
+    Av1FilterLUT lut;
+
+    declare_func(void, pixel *dst, ptrdiff_t stride, const uint32_t *mask,
+                 const uint8_t (*l)[4], ptrdiff_t l_stride,
+                 const Av1FilterLUT *lut);
+
+    for (int i = 0; i < 4; i++) {
+        /* luma uses level 0/1 (h/v), chroma levels 2/3 (u/v) */
+        const int lvl_idx = n_masks == 3 ? is_v : 2 + (i & 1);
+        const uint8_t (*const lvl)[4] =
+            (const uint8_t (*)[4]) &l[1][!is_v][lvl_idx];
+
+        if (check_func(fn, "%s_%dbpc", name, BITDEPTH)) {
+            const ptrdiff_t stride = (is_v ? 128 : 32) * sizeof(pixel);
+            pixel *const c_dst = c_dst_mem + (is_v ? 16 * 128 : 16);
+            pixel *const a_dst = a_dst_mem + (is_v ? 16 * 128 : 16);
+            uint32_t mask[3] = { 0 };
+
+            for (int i = 0; i < 32; i++) {
+                const int w = rand() % (n_masks + 1);
+                if (w) mask[w - 1] |= 1U << i;
+            }
+            for (int y = 0; y < 33; y++)
+                for (int x = 0; x < 33; x++)
+                    for (int k = 0; k < 4; k++)
+                        l[y][x][k] = (rand() & 3) ? rand() & 63 : 0;
+            dav1d_calc_eih(&lut, rand() & 7);
+
+            init_pixels(c_dst_mem, stride / sizeof(pixel),
+                        is_v ? 128 : 32, is_v ? 32 : 128);
+            memcpy(a_dst_mem, c_dst_mem, 128 * 32 * sizeof(pixel));
+
+            call_ref(c_dst, stride, mask, lvl, 33, &lut);
+            call_new(a_dst, stride, mask, lvl, 33, &lut);
+            if (memcmp(c_dst_mem, a_dst_mem, 128 * 32 * sizeof(pixel)))
+                fail();
+
+            bench_new(a_dst, stride, mask, lvl, 33, &lut);
+        }
+    }
+}
+
+void bitfn(checkasm_check_lf)(void) {
+    Dav1dLoopFilterDSPContext c;
+    memset(&c, 0, sizeof(c));
+    bitfn(dav1d_loop_filter_dsp_init)(&c);
+
+    check_lpf_sb(c.loop_filter_sb[0][0], "lpf_h_sb_y", 3, 0);
+    check_lpf_sb(c.loop_filter_sb[0][1], "lpf_v_sb_y", 3, 1);
+    report("lpf_sb_y");
+
+    check_lpf_sb(c.loop_filter_sb[1][0], "lpf_h_sb_uv", 2, 0);
+    check_lpf_sb(c.loop_filter_sb[1][1], "lpf_v_sb_uv", 2, 1);
+    report("lpf_sb_uv");
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * Copyright © 2018, Two Orioles, LLC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "tests/checkasm/checkasm.h"
+
+#include <string.h>
+
+#include "src/looprestoration.h"
+
+/* Picture stride, enough for the widest unit (1.5 * 256) and the pixels
+ * to the left and right of it which are read by the filters. */
+#define STRIDE 448
+
+static void init_pixels(pixel *const buf, const ptrdiff_t stride,
+                        const int w, const int h)
+{
+    const int bitdepth_max = (1 << BITDEPTH) - 1;
+    const int base = rand() & bitdepth_max;
+    const int amp = 1 + (rand() & 31);
+    const int noise = !(rand() & 3);
+
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+            buf[y * stride + x] = noise ? rand() & bitdepth_max :
+                iclip(base + (rand() % (2 * amp + 1)) - amp, 0, bitdepth_max);
+}
+
+static int cmp_unit(const pixel *const a, const pixel *const b,
+                    const int w, const int h)
+{
+    for (int y = 0; y < h; y++)
+        if (memcmp(&a[y * STRIDE], &b[y * STRIDE], w * sizeof(pixel)))
+            return 1;
+    return 0;
+}
+
+static void check_wiener(const wienerfilter_fn fn) {
+    ALIGN_STK_32(pixel, c_dst_mem, 64 * STRIDE,);
+    ALIGN_STK_32(pixel, a_dst_mem, 64 * STRIDE,);
+    ALIGN_STK_32(pixel, lpf_mem, 8 * STRIDE,);
+    pixel left[64][4];
+    pixel *const c_dst = c_dst_mem + 16;
+    pixel *const a_dst = a_dst_mem + 16;
+    pixel *const lpf = lpf_mem + 16;
+    const ptrdiff_t stride = STRIDE * sizeof(pixel);
+    int16_t filter_h[7], filter_v[7];
+
+    declare_func(void, pixel *dst, ptrdiff_t dst_stride,
+                 const pixel (*left)[4],
+                 const pixel *lpf, ptrdiff_t lpf_stride,
+                 int w, int h, const int16_t filterh[7],
+                 const int16_t filterv[7], enum LrEdgeFlags edges);
+
+    if (check_func(fn, "wiener_%dbpc", BITDEPTH)) {
+        for (int edges = 0; edges < 16; edges++) {
+            for (int i = 0; i < 4; i++) {
+                /* the unit width is a multiple of 32 except for the last
+                 * unit of a row, which can be up to 1.5 times as wide */
+                const int w = (i & 1) ? 32 << (rand() & 3) : 1 + rand() % 384;
+                const int h = 1 + (rand() & 63);
+
+                for (int k = 0; k < 2; k++) {
+                    int16_t *const f = k ? filter_v : filter_h;
+                    f[0] = f[6] = (rand() & 15) - 5;
+                    f[1] = f[5] = (rand() & 31) - 23;
+                    f[2] = f[4] = (rand() & 63) - 17;
+                    f[3] = -((f[0] + f[1] + f[2]) * 2);
+                }
+
+                init_pixels(c_dst_mem, STRIDE, STRIDE, 64);
+                init_pixels(lpf_mem, STRIDE, STRIDE, 8);
+                init_pixels(left[0], 4, 4, 64);
+                memcpy(a_dst_mem, c_dst_mem, 64 * STRIDE * sizeof(pixel));
+
+                call_ref(c_dst, stride, left, lpf, stride, w, h,
+                         filter_h, filter_v, edges);
+                call_new(a_dst, stride, left, lpf, stride, w, h,
+                         filter_h, filter_v, edges);
+                if (cmp_unit(c_dst, a_dst, w, h))
+                    fail();
+            }
+        }
+        bench_new(a_dst, stride, left, lpf, stride, 64, 64,
+                  filter_h, filter_v, 0xf);
+    }
+    report("wiener");
+}
+
+static void check_selfguided(const selfguided_fn fn) {
+    ALIGN_STK_32(pixel, c_dst_mem, 64 * STRIDE,);
+    ALIGN_STK_32(pixel, a_dst_mem, 64 * STRIDE,);
+    ALIGN_STK_32(pixel, lpf_mem, 8 * STRIDE,);
+    pixel left[64][4];
+    pixel *const c_dst = c_dst_mem + 16;
+    pixel *const a_dst = a_dst_mem + 16;
+    pixel *const lpf = lpf_mem + 16;
+    const ptrdiff_t stride = STRIDE * sizeof(pixel);
+    int16_t sgr_w[2];
+
+    declare_func(void, pixel *dst, ptrdiff_t dst_stride,
+                 const pixel (*left)[4],
+                 const pixel *lpf, ptrdiff_t lpf_stride,
+                 int w, int h, int sgr_idx, const int16_t sgr_w[2],
+                 enum LrEdgeFlags edges);
+
+    if (check_func(fn, "selfguided_%dbpc", BITDEPTH)) {
+        for (int sgr_idx = 0; sgr_idx < 16; sgr_idx++) {
+            for (int i = 0; i < 8; i++) {
+                const enum LrEdgeFlags edges = rand() & 15;
+                const int w = (i & 1) ? 32 << (rand() & 3) : 1 + rand() % 384;
+                const int h = 1 + (rand() & 63);
+
+                sgr_w[0] = (rand() & 127) - 96;
+                sgr_w[1] = (rand() & 127) - 32;
+
+                init_pixels(c_dst_mem, STRIDE, STRIDE, 64);
+                init_pixels(lpf_mem, STRIDE, STRIDE, 8);
+                init_pixels(left[0], 4, 4, 64);
+                memcpy(a_dst_mem, c_dst_mem, 64 * STRIDE * sizeof(pixel));
+
+                call_ref(c_dst, stride, left, lpf, stride, w, h,
+                         sgr_idx, sgr_w, edges);
+                call_new(a_dst, stride, left, lpf, stride, w, h,
+                         sgr_idx, sgr_w, edges);
+                if (cmp_unit(c_dst, a_dst, w, h))
+                    fail();
+            }
+        }
+        bench_new(a_dst, stride, left, lpf, stride, 64, 64, 6, sgr_w, 0xf);
+    }
+    report("selfguided");
+}
+
+void bitfn(checkasm_check_looprestoration)(void) {
+    Dav1dLoopRestorationDSPContext c;
+    memset(&c, 0, sizeof(c));
+    bitfn(dav1d_loop_restoration_dsp_init)(&c);
+
+    check_wiener(c.wiener);
+    check_selfguided(c.selfguided);
+}
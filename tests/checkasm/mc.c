@@ -45,7 +45,7 @@ static void check_mc(Dav1dMCDSPContext *const c) {
     const pixel *src = src_buf + 135 * 3 + 3;
 
     for (int i = 0; i < 135 * 135; i++)
-        src_buf[i] = rand();
+        src_buf[i] = rand() & ((1 << BITDEPTH) - 1);
 
     declare_func(void, pixel *dst, ptrdiff_t dst_stride, const pixel *src,
                  ptrdiff_t src_stride, int w, int h, int mx, int my);
@@ -60,12 +60,15 @@ static void check_mc(Dav1dMCDSPContext *const c) {
                         const int mx = (mxy & 1) ? rand() % 15 + 1 : 0;
                         const int my = (mxy & 2) ? rand() % 15 + 1 : 0;
 
-                        call_ref(c_dst, w, src, w, w, h, mx, my);
-                        call_new(a_dst, w, src, w, w, h, mx, my);
+                        call_ref(c_dst, w * sizeof(pixel), src, w * sizeof(pixel),
+                                 w, h, mx, my);
+                        call_new(a_dst, w * sizeof(pixel), src, w * sizeof(pixel),
+                                 w, h, mx, my);
                         if (memcmp(c_dst, a_dst, w * h * sizeof(*c_dst)))
                             fail();
 
-                        bench_new(a_dst, w, src, w, w, h, mx, my);
+                        bench_new(a_dst, w * sizeof(pixel), src, w * sizeof(pixel),
+                                  w, h, mx, my);
                     }
     report("mc");
 }
@@ -77,7 +80,7 @@ static void check_mct(Dav1dMCDSPContext *const c) {
     const pixel *src = src_buf + 135 * 3 + 3;
 
     for (int i = 0; i < 135 * 135; i++)
-        src_buf[i] = rand();
+        src_buf[i] = rand() & ((1 << BITDEPTH) - 1);
 
     declare_func(void, coef *tmp, const pixel *src, ptrdiff_t src_stride,
                  int w, int h, int mx, int my);
@@ -92,12 +95,12 @@ static void check_mct(Dav1dMCDSPContext *const c) {
                         const int mx = (mxy & 1) ? rand() % 15 + 1 : 0;
                         const int my = (mxy & 2) ? rand() % 15 + 1 : 0;
 
-                        call_ref(c_tmp, src, w, w, h, mx, my);
-                        call_new(a_tmp, src, w, w, h, mx, my);
+                        call_ref(c_tmp, src, w * sizeof(pixel), w, h, mx, my);
+                        call_new(a_tmp, src, w * sizeof(pixel), w, h, mx, my);
                         if (memcmp(c_tmp, a_tmp, w * h * sizeof(*c_tmp)))
                             fail();
 
-                        bench_new(a_tmp, src, w, w, h, mx, my);
+                        bench_new(a_tmp, src, w * sizeof(pixel), w, h, mx, my);
                     }
     report("mct");
 }
@@ -107,7 +110,7 @@ static void init_tmp(Dav1dMCDSPContext *const c, pixel *const buf,
 {
     for (int i = 0; i < 2; i++) {
         for (int j = 0; j < 135 * 135; j++)
-            buf[j] = rand();
+            buf[j] = rand() & ((1 << BITDEPTH) - 1);
         c->mct[rand() % N_2D_FILTERS](tmp[i], buf + 135 * 3 + 3,
                                       128 * sizeof(pixel), 128, 128,
                                       rand() & 15, rand() & 15);
@@ -128,12 +131,12 @@ static void check_avg(Dav1dMCDSPContext *const c) {
         if (check_func(c->avg, "avg_w%d_%dbpc", w, BITDEPTH))
             for (int h = imax(w / 4, 4); h <= imin(w * 4, 128); h <<= 1)
             {
-                call_ref(c_dst, w, tmp[0], tmp[1], w, h);
-                call_new(a_dst, w, tmp[0], tmp[1], w, h);
+                call_ref(c_dst, w * sizeof(pixel), tmp[0], tmp[1], w, h);
+                call_new(a_dst, w * sizeof(pixel), tmp[0], tmp[1], w, h);
                 if (memcmp(c_dst, a_dst, w * h * sizeof(*c_dst)))
                     fail();
 
-                bench_new(a_dst, w, tmp[0], tmp[1], w, h);
+                bench_new(a_dst, w * sizeof(pixel), tmp[0], tmp[1], w, h);
             }
     report("avg");
 }
@@ -154,12 +157,12 @@ static void check_w_avg(Dav1dMCDSPContext *const c) {
             {
                 int weight = rand() % 15 + 1;
 
-                call_ref(c_dst, w, tmp[0], tmp[1], w, h, weight);
-                call_new(a_dst, w, tmp[0], tmp[1], w, h, weight);
+                call_ref(c_dst, w * sizeof(pixel), tmp[0], tmp[1], w, h, weight);
+                call_new(a_dst, w * sizeof(pixel), tmp[0], tmp[1], w, h, weight);
                 if (memcmp(c_dst, a_dst, w * h * sizeof(*c_dst)))
                     fail();
 
-                bench_new(a_dst, w, tmp[0], tmp[1], w, h, weight);
+                bench_new(a_dst, w * sizeof(pixel), tmp[0], tmp[1], w, h, weight);
             }
     report("w_avg");
 }
@@ -181,12 +184,12 @@ static void check_mask(Dav1dMCDSPContext *const c) {
         if (check_func(c->mask, "mask_w%d_%dbpc", w, BITDEPTH))
             for (int h = imax(w / 4, 4); h <= imin(w * 4, 128); h <<= 1)
             {
-                call_ref(c_dst, w, tmp[0], tmp[1], w, h, mask);
-                call_new(a_dst, w, tmp[0], tmp[1], w, h, mask);
+                call_ref(c_dst, w * sizeof(pixel), tmp[0], tmp[1], w, h, mask);
+                call_new(a_dst, w * sizeof(pixel), tmp[0], tmp[1], w, h, mask);
                 if (memcmp(c_dst, a_dst, w * h * sizeof(*c_dst)))
                     fail();
 
-                bench_new(a_dst, w, tmp[0], tmp[1], w, h, mask);
+                bench_new(a_dst, w * sizeof(pixel), tmp[0], tmp[1], w, h, mask);
             }
     report("mask");
 }
@@ -213,19 +216,163 @@ static void check_w_mask(Dav1dMCDSPContext *const c) {
                 {
                     int sign = rand() & 1;
 
-                    call_ref(c_dst, w, tmp[0], tmp[1], w, h, c_mask, sign);
-                    call_new(a_dst, w, tmp[0], tmp[1], w, h, a_mask, sign);
+                    call_ref(c_dst, w * sizeof(pixel), tmp[0], tmp[1], w, h,
+                             c_mask, sign);
+                    call_new(a_dst, w * sizeof(pixel), tmp[0], tmp[1], w, h,
+                             a_mask, sign);
                     if (memcmp(c_dst, a_dst, w * h * sizeof(*c_dst)) ||
                         memcmp(c_mask, a_mask, (w * h * sizeof(*c_mask)) >> i))
                     {
                         fail();
                     }
 
-                    bench_new(a_dst, w, tmp[0], tmp[1], w, h, a_mask, sign);
+                    bench_new(a_dst, w * sizeof(pixel), tmp[0], tmp[1], w, h,
+                              a_mask, sign);
                 }
     report("w_mask");
 }
 
+static void check_blend(Dav1dMCDSPContext *const c) {
+    ALIGN_STK_32(pixel,   tmp,   128 * 128,);
+    ALIGN_STK_32(pixel,   c_dst, 128 * 128,);
+    ALIGN_STK_32(pixel,   a_dst, 128 * 128,);
+    ALIGN_STK_32(uint8_t, mask,  128 * 128,);
+
+    for (int i = 0; i < 128 * 128; i++) {
+        tmp[i] = rand() & ((1 << BITDEPTH) - 1);
+        mask[i] = rand() % 65;
+    }
+
+    declare_func(void, pixel *dst, ptrdiff_t dst_stride, const pixel *tmp,
+                 ptrdiff_t tmp_stride, int w, int h, const uint8_t *mask,
+                 ptrdiff_t mstride);
+
+    // mask stride 0: obmc left, 1: obmc above, w: interintra/wedge
+    static const char *const mode_names[] = { "h", "v", "2d" };
+
+    for (int mode = 0; mode < 3; mode++)
+        for (int w = 2; w <= (mode == 1 ? 128 : 32); w <<= 1)
+            if (check_func(c->blend, "blend_%s_w%d_%dbpc", mode_names[mode],
+                           w, BITDEPTH))
+                for (int h = 2; h <= (mode == 1 ? 32 : 128); h <<= 1) {
+                    const ptrdiff_t mstride = mode == 2 ? w : mode;
+
+                    for (int i = 0; i < w * h; i++)
+                        c_dst[i] = a_dst[i] = rand() & ((1 << BITDEPTH) - 1);
+
+                    call_ref(c_dst, w * sizeof(pixel), tmp, w * sizeof(pixel),
+                             w, h, mask, mstride);
+                    call_new(a_dst, w * sizeof(pixel), tmp, w * sizeof(pixel),
+                             w, h, mask, mstride);
+                    if (memcmp(c_dst, a_dst, w * h * sizeof(*c_dst)))
+                        fail();
+
+                    bench_new(a_dst, w * sizeof(pixel), tmp, w * sizeof(pixel),
+                              w, h, mask, mstride);
+                }
+    report("blend");
+}
+
+static void check_warp8x8(Dav1dMCDSPContext *const c) {
+    ALIGN_STK_32(pixel, src_buf, 15 * 15,);
+    ALIGN_STK_32(pixel, c_dst,    8 *  8,);
+    ALIGN_STK_32(pixel, a_dst,    8 *  8,);
+    int16_t abcd[4];
+    const pixel *src = src_buf + 15 * 3 + 3;
+
+    for (int i = 0; i < 15 * 15; i++)
+        src_buf[i] = rand() & ((1 << BITDEPTH) - 1);
+
+    declare_func(void, pixel *dst, ptrdiff_t dst_stride, const pixel *src,
+                 ptrdiff_t src_stride, const int16_t *abcd, int mx, int my);
+
+    if (check_func(c->warp8x8, "warp_8x8_%dbpc", BITDEPTH)) {
+        const int mx = (rand() & 0x1fff) - 0xa00;
+        const int my = (rand() & 0x1fff) - 0xa00;
+        for (int i = 0; i < 4; i++)
+            abcd[i] = (rand() & 0x1fff) - 0xa00;
+
+        call_ref(c_dst, 8 * sizeof(pixel), src, 15 * sizeof(pixel),
+                 abcd, mx, my);
+        call_new(a_dst, 8 * sizeof(pixel), src, 15 * sizeof(pixel),
+                 abcd, mx, my);
+        if (memcmp(c_dst, a_dst, 8 * 8 * sizeof(*c_dst)))
+            fail();
+
+        bench_new(a_dst, 8 * sizeof(pixel), src, 15 * sizeof(pixel),
+                  abcd, mx, my);
+    }
+    report("warp8x8");
+}
+
+static void check_warp8x8t(Dav1dMCDSPContext *const c) {
+    ALIGN_STK_32(pixel, src_buf, 15 * 15,);
+    ALIGN_STK_32(coef,  c_tmp,    8 *  8,);
+    ALIGN_STK_32(coef,  a_tmp,    8 *  8,);
+    int16_t abcd[4];
+    const pixel *src = src_buf + 15 * 3 + 3;
+
+    for (int i = 0; i < 15 * 15; i++)
+        src_buf[i] = rand() & ((1 << BITDEPTH) - 1);
+
+    declare_func(void, coef *tmp, ptrdiff_t tmp_stride, const pixel *src,
+                 ptrdiff_t src_stride, const int16_t *abcd, int mx, int my);
+
+    if (check_func(c->warp8x8t, "warp_8x8t_%dbpc", BITDEPTH)) {
+        const int mx = (rand() & 0x1fff) - 0xa00;
+        const int my = (rand() & 0x1fff) - 0xa00;
+        for (int i = 0; i < 4; i++)
+            abcd[i] = (rand() & 0x1fff) - 0xa00;
+
+        call_ref(c_tmp, 8, src, 15 * sizeof(pixel), abcd, mx, my);
+        call_new(a_tmp, 8, src, 15 * sizeof(pixel), abcd, mx, my);
+        if (memcmp(c_tmp, a_tmp, 8 * 8 * sizeof(*c_tmp)))
+            fail();
+
+        bench_new(a_tmp, 8, src, 15 * sizeof(pixel), abcd, mx, my);
+    }
+    report("warp8x8t");
+}
+
+static void check_emu_edge(Dav1dMCDSPContext *const c) {
+    ALIGN_STK_32(pixel, src_buf, 160 * 160,);
+    ALIGN_STK_32(pixel, c_dst,   135 * 160,);
+    ALIGN_STK_32(pixel, a_dst,   135 * 160,);
+
+    for (int i = 0; i < 160 * 160; i++)
+        src_buf[i] = rand() & ((1 << BITDEPTH) - 1);
+
+    declare_func(void, intptr_t bw, intptr_t bh, intptr_t iw, intptr_t ih,
+                 intptr_t x, intptr_t y, pixel *dst, ptrdiff_t dst_stride,
+                 const pixel *src, ptrdiff_t src_stride);
+
+    for (int w = 4; w <= 128; w <<= 1)
+        if (check_func(c->emu_edge, "emu_edge_w%d_%dbpc", w, BITDEPTH))
+            for (int h = imax(w / 4, 4); h <= imin(w * 4, 128); h <<= 1) {
+                // same block padding as mc()
+                const int bw = w + 7, bh = h + 7;
+                const int iw = 1 + rand() % 160, ih = 1 + rand() % 160;
+                const int x = rand() % (iw + bw + 16) - bw - 8;
+                const int y = rand() % (ih + bh + 16) - bh - 8;
+
+                call_ref(bw, bh, iw, ih, x, y, c_dst, 160 * sizeof(pixel),
+                         src_buf, 160 * sizeof(pixel));
+                call_new(bw, bh, iw, ih, x, y, a_dst, 160 * sizeof(pixel),
+                         src_buf, 160 * sizeof(pixel));
+                for (int r = 0; r < bh; r++)
+                    if (memcmp(&c_dst[r * 160], &a_dst[r * 160],
+                               bw * sizeof(*c_dst)))
+                    {
+                        fail();
+                        break;
+                    }
+
+                bench_new(bw, bh, iw, ih, x, y, a_dst, 160 * sizeof(pixel),
+                          src_buf, 160 * sizeof(pixel));
+            }
+    report("emu_edge");
+}
+
 void bitfn(checkasm_check_mc)(void) {
     Dav1dMCDSPContext c;
     bitfn(dav1d_mc_dsp_init)(&c);
@@ -236,4 +383,8 @@ void bitfn(checkasm_check_mc)(void) {
     check_w_avg(&c);
     check_mask(&c);
     check_w_mask(&c);
+    check_blend(&c);
+    check_warp8x8(&c);
+    check_warp8x8t(&c);
+    check_emu_edge(&c);
 }
@@ -0,0 +1,221 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * Copyright © 2018, Two Orioles, LLC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tests/checkasm/checkasm.h"
+
+#include <string.h>
+
+#include "src/cpu.h"
+#include "src/msac.h"
+
+#define BUF_SIZE 8192
+#define NUM_CDFS 16
+#define TRACE_LEN 1024
+
+typedef unsigned (*decode_symbol_adapt_fn)(MsacContext *s, uint16_t *cdf,
+                                           unsigned n_symbols);
+typedef unsigned (*decode_bool_adapt_fn)(MsacContext *s, uint16_t *cdf);
+typedef unsigned (*decode_bools_fn)(MsacContext *s, unsigned l);
+typedef void (*update_cdf_fn)(uint16_t *cdf, unsigned val, unsigned n_symbols);
+
+/* A random inverse cdf of n symbols (non-increasing and terminated by 0)
+ * followed by the adaptation counter. The remaining entries are filled
+ * with junk, so that writes past the end of the cdf are detected. */
+static void randomize_cdf(uint16_t *const cdf, const int n, const int len) {
+    for (int i = 0; i < len; i++)
+        cdf[i] = rand();
+    for (int i = 0; i < n - 1; i++) {
+        const uint16_t v = rand() & 0x7fff;
+        int j;
+        for (j = i; j > 0 && cdf[j - 1] < v; j--)
+            cdf[j] = cdf[j - 1];
+        cdf[j] = v;
+    }
+    cdf[n - 1] = 0;
+    cdf[n] = rand() % 33;
+}
+
+/* The cdfs (indices out of NUM_CDFS) that consecutive symbols are decoded
+ * with, in the pattern of a tile's symbols: a few contexts are used most
+ * of the time, and the others now and then, so that both adapted and
+ * fresh cdfs are exercised. */
+static void randomize_trace(uint8_t *const trace) {
+    for (int i = 0; i < TRACE_LEN; i++)
+        trace[i] = rand() & 3 ? rand() & 3 : rand() % NUM_CDFS;
+}
+
+static void randomize_buf(uint8_t *const buf) {
+    for (int i = 0; i < BUF_SIZE; i++)
+        buf[i] = rand();
+}
+
+static void check_decode_symbol_adapt(const decode_symbol_adapt_fn fn,
+                                      const int max_n)
+{
+    uint8_t buf[BUF_SIZE], trace[TRACE_LEN];
+    uint16_t cdf[2][NUM_CDFS][16 + 1 + 8];
+    MsacContext s_c, s_a;
+
+    declare_func(unsigned, MsacContext *s, uint16_t *cdf, unsigned n_symbols);
+
+    randomize_buf(buf);
+    randomize_trace(trace);
+    for (int n = 2; n <= max_n; n++) {
+        if (check_func(fn, "msac_decode_symbol_adapt%d_%d", max_n, n)) {
+            msac_init(&s_c, buf, BUF_SIZE);
+            s_a = s_c;
+            for (int i = 0; i < NUM_CDFS; i++)
+                randomize_cdf(cdf[0][i], n, 16 + 1 + 8);
+            memcpy(cdf[1], cdf[0], sizeof(*cdf));
+            for (int i = 0; i < TRACE_LEN; i++) {
+                const unsigned c_res = call_ref(&s_c, cdf[0][trace[i]], n);
+                const unsigned a_res = call_new(&s_a, cdf[1][trace[i]], n);
+                if (c_res != a_res || memcmp(&s_c, &s_a, sizeof(s_c)) ||
+                    memcmp(cdf[0], cdf[1], sizeof(*cdf)))
+                {
+                    fail();
+                    break;
+                }
+            }
+            bench_new(&s_a, cdf[1][0], n);
+        }
+    }
+}
+
+static void check_decode_bool_adapt(const decode_bool_adapt_fn fn) {
+    uint8_t buf[BUF_SIZE], trace[TRACE_LEN];
+    uint16_t cdf[2][NUM_CDFS][2];
+    MsacContext s_c, s_a;
+
+    declare_func(unsigned, MsacContext *s, uint16_t *cdf);
+
+    if (check_func(fn, "msac_decode_bool_adapt")) {
+        randomize_buf(buf);
+        randomize_trace(trace);
+        msac_init(&s_c, buf, BUF_SIZE);
+        s_a = s_c;
+        for (int i = 0; i < NUM_CDFS; i++) {
+            cdf[0][i][0] = 1 + rand() % 32767;
+            cdf[0][i][1] = rand() % 33;
+        }
+        memcpy(cdf[1], cdf[0], sizeof(*cdf));
+        for (int i = 0; i < TRACE_LEN; i++) {
+            const unsigned c_res = call_ref(&s_c, cdf[0][trace[i]]);
+            const unsigned a_res = call_new(&s_a, cdf[1][trace[i]]);
+            if (c_res != a_res || memcmp(&s_c, &s_a, sizeof(s_c)) ||
+                memcmp(cdf[0], cdf[1], sizeof(*cdf)))
+            {
+                fail();
+                break;
+            }
+        }
+        bench_new(&s_a, cdf[1][0]);
+    }
+}
+
+static void check_decode_bools(const decode_bools_fn fn) {
+    uint8_t buf[BUF_SIZE];
+    MsacContext s_c, s_a;
+
+    declare_func(unsigned, MsacContext *s, unsigned l);
+
+    if (check_func(fn, "msac_decode_bools")) {
+        randomize_buf(buf);
+        msac_init(&s_c, buf, BUF_SIZE);
+        s_a = s_c;
+        for (int i = 0; i < TRACE_LEN; i++) {
+            const unsigned l = 1 + rand() % 16;
+            const unsigned c_res = call_ref(&s_c, l);
+            const unsigned a_res = call_new(&s_a, l);
+            if (c_res != a_res || memcmp(&s_c, &s_a, sizeof(s_c))) {
+                fail();
+                break;
+            }
+        }
+        bench_new(&s_a, 8);
+    }
+}
+
+static void check_update_cdf(const update_cdf_fn fn) {
+    uint16_t cdf[2][16 + 1 + 8];
+
+    declare_func(void, uint16_t *cdf, unsigned val, unsigned n_symbols);
+
+    for (int n = 2; n <= 16; n++) {
+        if (check_func(fn, "update_cdf_%d", n)) {
+            randomize_cdf(cdf[0], n, 16 + 1 + 8);
+            memcpy(cdf[1], cdf[0], sizeof(*cdf));
+            for (int i = 0; i < TRACE_LEN; i++) {
+                const unsigned val = rand() % n;
+                call_ref(cdf[0], val, n);
+                call_new(cdf[1], val, n);
+                if (memcmp(cdf[0], cdf[1], sizeof(*cdf))) {
+                    fail();
+                    break;
+                }
+            }
+            bench_new(cdf[1], 0, n);
+        }
+    }
+}
+
+void checkasm_check_msac(void) {
+    decode_symbol_adapt_fn decode_symbol_adapt4  = msac_decode_symbol_adapt_c;
+    decode_symbol_adapt_fn decode_symbol_adapt8  = msac_decode_symbol_adapt_c;
+    decode_symbol_adapt_fn decode_symbol_adapt16 = msac_decode_symbol_adapt_c;
+    decode_bool_adapt_fn decode_bool_adapt = msac_decode_bool_adapt;
+    decode_bools_fn decode_bools = msac_decode_bools;
+    update_cdf_fn update = update_cdf;
+
+#if HAVE_ASM && ARCH_X86_64
+    if (dav1d_get_cpu_flags() & DAV1D_X86_CPU_FLAG_SSE2) {
+        decode_symbol_adapt4  = dav1d_msac_decode_symbol_adapt4_sse2;
+        decode_symbol_adapt8  = dav1d_msac_decode_symbol_adapt8_sse2;
+        decode_symbol_adapt16 = dav1d_msac_decode_symbol_adapt16_sse2;
+    }
+#elif HAVE_ASM && ARCH_AARCH64
+    if (dav1d_get_cpu_flags() & DAV1D_ARM_CPU_FLAG_NEON) {
+        decode_symbol_adapt4  = dav1d_msac_decode_symbol_adapt4_neon;
+        decode_symbol_adapt8  = dav1d_msac_decode_symbol_adapt8_neon;
+        decode_symbol_adapt16 = dav1d_msac_decode_symbol_adapt16_neon;
+    }
+#endif
+
+    check_decode_symbol_adapt(decode_symbol_adapt4, 4);
+    check_decode_symbol_adapt(decode_symbol_adapt8, 8);
+    check_decode_symbol_adapt(decode_symbol_adapt16, 16);
+    report("decode_symbol_adapt");
+
+    check_decode_bool_adapt(decode_bool_adapt);
+    report("decode_bool_adapt");
+
+    check_decode_bools(decode_bools);
+    report("decode_bools");
+
+    check_update_cdf(update);
+    report("update_cdf");
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Seeks with dav1d_flush() (or dav1d_reset()) while frame threads are busy:
+ * the pictures decoded after seeking to a keyframe must match those of a
+ * decode of the whole stream.
+ *
+ * usage: seek <input.ivf> <frame threads> <tile threads> [<packets> [<runs>]]
+ *
+ * Each run sends <packets> packets, cancels the frames in flight, seeks to
+ * the first keyframe and decodes the rest of the stream, then does the same
+ * from the keyframe before the middle of the stream.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dav1d/dav1d.h"
+
+#include "input/input.h"
+
+// FNV-1a over the visible pixels of all planes
+static uint64_t hash_picture(const Dav1dPicture *const p) {
+    const int hbd = p->p.bpc > 8;
+    const int ss_ver = p->p.layout == DAV1D_PIXEL_LAYOUT_I420;
+    const int ss_hor = p->p.layout != DAV1D_PIXEL_LAYOUT_I444;
+    const int n_planes = p->p.layout == DAV1D_PIXEL_LAYOUT_I400 ? 1 : 3;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (int pl = 0; pl < n_planes; pl++) {
+        const int w = pl ? (p->p.w + ss_hor) >> ss_hor : p->p.w;
+        const int h = pl ? (p->p.h + ss_ver) >> ss_ver : p->p.h;
+        const uint8_t *ptr = p->data[pl];
+
+        for (int y = 0; y < h; y++, ptr += p->stride[!!pl])
+            for (int x = 0; x < w << hbd; x++)
+                hash = (hash ^ ptr[x]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+typedef struct Hashes {
+    uint64_t *buf;
+    int n, sz;
+} Hashes;
+
+static int add_hash(Hashes *const h, const Dav1dPicture *const p) {
+    if (h->n == h->sz) {
+        const int sz = h->sz ? h->sz * 2 : 64;
+        uint64_t *const buf = realloc(h->buf, sz * sizeof(*buf));
+        if (!buf) return -ENOMEM;
+        h->buf = buf;
+        h->sz = sz;
+    }
+    h->buf[h->n++] = hash_picture(p);
+    return 0;
+}
+
+// Sends up to max_packets packets (all if < 0), or until the end of the
+// stream, hashing the pictures returned meanwhile; at the end of the stream,
+// the decoder is drained.
+static int decode(Dav1dContext *const c, DemuxerContext *const in,
+                  const int max_packets, Hashes *const out)
+{
+    Dav1dData data = { 0 };
+    Dav1dPicture p;
+    uint64_t pts;
+    int res, eos = 0;
+
+    for (int n = 0; max_packets < 0 || n < max_packets; n++) {
+        if (input_read(in, &data, &pts)) {
+            eos = 1;
+            break;
+        }
+        do {
+            if ((res = dav1d_send_data(c, &data)) < 0 && res != -EAGAIN)
+                break;
+            memset(&p, 0, sizeof(p));
+            const int ret = dav1d_get_picture(c, &p);
+            if (!ret) {
+                const int err = add_hash(out, &p);
+                dav1d_picture_unref(&p);
+                if (err) res = err;
+            } else if (ret != -EAGAIN) {
+                res = ret;
+            }
+        } while (res == -EAGAIN || (!res && data.sz));
+        if (res < 0) {
+            dav1d_data_unref(&data);
+            return res;
+        }
+    }
+    if (!eos) return 0;
+
+    if ((res = dav1d_send_data(c, NULL)) < 0) return res;
+    for (;;) {
+        memset(&p, 0, sizeof(p));
+        if ((res = dav1d_get_picture(c, &p)) < 0)
+            return res == -EAGAIN ? 0 : res;
+        res = add_hash(out, &p);
+        dav1d_picture_unref(&p);
+        if (res) return res;
+    }
+}
+
+static int check_seek(Dav1dContext *const c, DemuxerContext *const in,
+                      const Hashes *const ref, const unsigned target,
+                      const char *const what, const int run)
+{
+    Hashes out = { 0 };
+    const int kf = input_seek(in, target);
+    if (kf < 0) {
+        fprintf(stderr, "seek to frame %u failed: %s\n", target, strerror(-kf));
+        return kf;
+    }
+    int res = decode(c, in, -1, &out);
+    if (res < 0) {
+        fprintf(stderr, "decoding from frame %d after %s failed: %s\n",
+                kf, what, strerror(-res));
+    } else if (out.n != ref->n - kf) {
+        fprintf(stderr, "run %d: %d pictures from frame %d after %s, "
+                "expected %d\n", run, out.n, kf, what, ref->n - kf);
+        res = -1;
+    } else {
+        for (int n = 0; n < out.n; n++)
+            if (out.buf[n] != ref->buf[kf + n]) {
+                fprintf(stderr, "run %d: picture %d differs after %s from "
+                        "frame %d\n", run, kf + n, what, kf);
+                res = -1;
+                break;
+            }
+    }
+    free(out.buf);
+    return res;
+}
+
+int main(const int argc, char *const *const argv) {
+    DemuxerContext *in;
+    Dav1dContext *c;
+    Dav1dSettings s;
+    Hashes ref = { 0 };
+    unsigned fps[2], total;
+    int res;
+
+    if (argc < 4 || argc > 6) {
+        fprintf(stderr, "usage: %s <input.ivf> <frame threads> <tile threads> "
+                "[<packets> [<runs>]]\n", argv[0]);
+        return 1;
+    }
+    const int n_packets = argc > 4 ? atoi(argv[4]) : 8;
+    const int n_runs = argc > 5 ? atoi(argv[5]) : 10;
+
+    init_demuxers();
+    if ((res = input_open(&in, "ivf", argv[1], fps, &total)) < 0) {
+        fprintf(stderr, "failed to open %s\n", argv[1]);
+        return 1;
+    }
+
+    dav1d_init();
+    dav1d_default_settings(&s);
+    s.n_frame_threads = atoi(argv[2]);
+    s.n_tile_threads = atoi(argv[3]);
+    if ((res = dav1d_open(&c, &s)) < 0) {
+        fprintf(stderr, "failed to open the decoder: %s\n", strerror(-res));
+        input_close(in);
+        return 1;
+    }
+
+    if ((res = decode(c, in, -1, &ref)) < 0) {
+        fprintf(stderr, "decoding %s failed: %s\n", argv[1], strerror(-res));
+    } else if (!ref.n) {
+        fprintf(stderr, "no pictures in %s\n", argv[1]);
+        res = -1;
+    }
+
+    Hashes tmp = { 0 };
+    for (int run = 0; run < n_runs && res >= 0; run++) {
+        for (int mid = 0; mid < 2 && res >= 0; mid++) {
+            // dav1d_reset() on every other seek, which also forgets the
+            // sequence header
+            const int reset = (run + mid) & 1;
+            tmp.n = 0;
+            if ((res = input_seek(in, 0)) < 0) break;
+            if ((res = decode(c, in, n_packets, &tmp)) < 0) break;
+            if (reset)
+                dav1d_reset(c);
+            else
+                dav1d_flush(c);
+            res = check_seek(c, in, &ref, mid ? ref.n / 2 : 0,
+                             reset ? "dav1d_reset()" : "dav1d_flush()", run);
+        }
+    }
+    free(tmp.buf);
+    free(ref.buf);
+
+    dav1d_close(&c);
+    input_close(in);
+    return res < 0;
+}
@@ -31,14 +31,24 @@
 #include <assert.h>
 #include <errno.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #ifdef HAVE_UNISTD_H
 # include <unistd.h>
 #endif
+#ifdef _WIN32
+# include <windows.h>
+#endif
 
 #include "dav1d/data.h"
 
+#include "common/intops.h"
+
+#include "src/thread.h"
+
 #include "input/input.h"
 
 #include "output/output.h"
@@ -59,83 +69,429 @@ static void print_stats(const int istty, const unsigned n,
     }
 }
 
-int main(const int argc, char *const *const argv) {
+static uint64_t get_time_nanos(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, t;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (uint64_t) ((double) t.QuadPart * 1e9 / freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return 1000000000ULL * ts.tv_sec + ts.tv_nsec;
+#endif
+}
+
+// Per-frame decoding latency, from the dav1d_send_data() call taking an
+// input packet to dav1d_get_picture() returning the corresponding picture.
+// Pictures are matched to packets in order, which holds when each packet
+// is a temporal unit (i.e. for all but Annex B input).
+typedef struct {
+    uint64_t *t; // send time of each packet, replaced by the latency once out
+    unsigned n_in, n_out, sz;
+} Latency;
+
+static void latency_in(Latency *const l) {
+    if (l->n_in == l->sz) {
+        const unsigned sz = l->sz ? l->sz * 2 : 256;
+        uint64_t *const t = realloc(l->t, sz * sizeof(*t));
+        if (!t) return;
+        l->t = t;
+        l->sz = sz;
+    }
+    l->t[l->n_in++] = get_time_nanos();
+}
+
+static void latency_out(Latency *const l) {
+    if (l->n_out < l->n_in) {
+        l->t[l->n_out] = get_time_nanos() - l->t[l->n_out];
+        l->n_out++;
+    }
+}
+
+static int cmp_u64(const void *const a, const void *const b) {
+    const uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static void sleep_nanos(const uint64_t nanos) {
+#ifdef _WIN32
+    Sleep((DWORD) ((nanos + 999999) / 1000000));
+#else
+    const struct timespec ts = {
+        .tv_sec = nanos / 1000000000, .tv_nsec = nanos % 1000000000
+    };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+// Real-time playback simulation: packets are sent to the decoder no
+// earlier than their timestamp (relative to the first one, and divided by
+// the speed), and the pictures are due for display at that same pace,
+// counting from when the first one is output (i.e. after the startup
+// latency). The headroom of a picture is how long before its display
+// deadline it was output; it is negative for those missing it.
+typedef struct {
+    double speed;
+    int started;
+    uint64_t start, first_pts; // of the first packet
+    uint64_t display_start, display_pts; // of the first picture
+    uint64_t last_pts;
+    int64_t *t; // pts of each temporal unit, replaced by the headroom once out
+    unsigned n_in, n_out, sz;
+} Realtime;
+
+static uint64_t realtime_due_time(Realtime *const rt, const uint64_t pts) {
+    if (!rt->started) {
+        rt->started = 1;
+        rt->start = get_time_nanos();
+        rt->first_pts = pts;
+    }
+    return rt->start + (pts > rt->first_pts ?
+                        (uint64_t) ((pts - rt->first_pts) / rt->speed) : 0);
+}
+
+static int realtime_due(Realtime *const rt, const uint64_t pts) {
+    return get_time_nanos() >= realtime_due_time(rt, pts);
+}
+
+// Waits for the packet to be due, but for at most 1 ms, so that pictures
+// decoded in the meantime are still picked up without much delay.
+static void realtime_wait(Realtime *const rt, const uint64_t pts) {
+    const uint64_t due = realtime_due_time(rt, pts), now = get_time_nanos();
+    if (now < due)
+        sleep_nanos(due - now < 1000000 ? due - now : 1000000);
+}
+
+static void realtime_in(Realtime *const rt, const uint64_t pts) {
+    // the packets of a temporal unit (e.g. from Annex B input) share its pts
+    if (rt->n_in && pts == rt->last_pts) return;
+    if (rt->n_in == rt->sz) {
+        const unsigned sz = rt->sz ? rt->sz * 2 : 256;
+        int64_t *const t = realloc(rt->t, sz * sizeof(*t));
+        if (!t) return;
+        rt->t = t;
+        rt->sz = sz;
+    }
+    rt->t[rt->n_in++] = rt->last_pts = pts;
+}
+
+static void realtime_out(Realtime *const rt) {
+    if (rt->n_out == rt->n_in) return;
+
+    const uint64_t now = get_time_nanos(), pts = rt->t[rt->n_out];
+    if (!rt->n_out) {
+        rt->display_start = now;
+        rt->display_pts = pts;
+    }
+    const uint64_t deadline = rt->display_start + (pts > rt->display_pts ?
+        (uint64_t) ((pts - rt->display_pts) / rt->speed) : 0);
+    rt->t[rt->n_out++] = (int64_t) (deadline - now);
+}
+
+static int cmp_i64(const void *const a, const void *const b) {
+    const int64_t x = *(const int64_t *) a, y = *(const int64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static void print_realtime(Realtime *const rt) {
+    const unsigned n = rt->n_out;
+    unsigned missed = 0;
+
+    if (!n) return;
+    for (unsigned i = 0; i < n; i++)
+        missed += rt->t[i] < 0;
+    qsort(rt->t, n, sizeof(*rt->t), cmp_i64);
+    printf("realtime: %u frames at %.2lfx speed, startup latency %.2lf ms\n",
+           n, rt->speed, (rt->display_start - rt->start) * 1e-6);
+    printf("deadlines: %u missed (%.1lf%%)\n", missed, 100.0 * missed / n);
+#define PCT(p) (rt->t[(n * (p) + 99) / 100 - 1] * 1e-6)
+    printf("headroom: min %.2lf ms, p1 %.2lf ms, p5 %.2lf ms, p50 %.2lf ms\n",
+           rt->t[0] * 1e-6, PCT(1), PCT(5), PCT(50));
+#undef PCT
+}
+
+static void print_threads(const Dav1dSettings *const s) {
+    char fthreads[16] = "auto", tthreads[16] = "auto";
+
+    if (s->n_frame_threads)
+        snprintf(fthreads, sizeof(fthreads), "%d", s->n_frame_threads);
+    if (s->n_tile_threads)
+        snprintf(tthreads, sizeof(tthreads), "%d", s->n_tile_threads);
+    printf("threads: %s frame, %s tile\n", fthreads, tthreads);
+}
+
+static void print_latency(const char *const prefix, Latency *const l,
+                          const unsigned n)
+{
+    if (!l->n_out || l->n_out != n || l->n_in != n) {
+        printf("%slatency: n/a (input packets do not match output frames)\n",
+               prefix);
+        return;
+    }
+    qsort(l->t, n, sizeof(*l->t), cmp_u64);
+#define PCT(p) (l->t[(n * (p) + 99) / 100 - 1] * 1e-6)
+    printf("%slatency: p50 %.2lf ms, p95 %.2lf ms, p99 %.2lf ms, max %.2lf ms\n",
+           prefix, PCT(50), PCT(95), PCT(99), l->t[n - 1] * 1e-6);
+#undef PCT
+}
+
+// Per-frame statistics (--stats-file): one line per output picture, with
+// its latency (if known, see Latency) and Dav1dPicture.stats, times in ms.
+static FILE *open_stats_file(const char *const name) {
+    FILE *const f = strcmp(name, "-") ? fopen(name, "w") : stdout;
+    if (!f) {
+        fprintf(stderr, "Failed to open %s: %s\n", name, strerror(errno));
+        return NULL;
+    }
+    fprintf(f, "# poc type latency bytes tiles thread tile_time deblock_time "
+               "cdef_time lr_time decode_time intra inter skip palette "
+               "warped\n");
+    return f;
+}
+
+static void close_stats_file(FILE *const f) {
+    if (f && f != stdout) fclose(f);
+}
+
+static void write_frame_stats(FILE *const f, const Dav1dPicture *const p,
+                              const Latency *const l, const unsigned n)
+{
+    static const char *const type_names[] = {
+        [DAV1D_FRAME_TYPE_KEY] = "key",
+        [DAV1D_FRAME_TYPE_INTER] = "inter",
+        [DAV1D_FRAME_TYPE_INTRA] = "intra",
+        [DAV1D_FRAME_TYPE_SWITCH] = "switch",
+    };
+    const Dav1dFrameStats *const s = &p->stats;
+    char latency[32] = "-";
+
+    // the latency of picture n is known once it was matched to a packet
+    if (l->n_out == n + 1)
+        snprintf(latency, sizeof(latency), "%.3lf", l->t[n] * 1e-6);
+    fprintf(f, "%d %s %s %zu %dx%d %d %.3lf %.3lf %.3lf %.3lf %.3lf "
+            "%u %u %u %u %u\n",
+            p->poc, type_names[p->p.type & 3], latency, s->data_sz,
+            s->tile_cols, s->tile_rows, s->frame_thread, s->tile_time * 1e-6,
+            s->deblock_time * 1e-6, s->cdef_time * 1e-6, s->lr_time * 1e-6,
+            s->decode_time * 1e-6, s->intra_blocks, s->inter_blocks,
+            s->skip_blocks, s->palette_blocks, s->warped_blocks);
+}
+
+// Thread timeline (--trace-file), in the Chrome trace event format: a
+// begin or end event per Dav1dTraceEvent, with times in us, and each thread
+// named as it first appears. Frame threads have their own number as tid,
+// tile workers 1000 and up, and the decoding thread 0.
+typedef struct {
+    FILE *f;
+    pthread_mutex_t lock;
+    unsigned n_events;
+    uint8_t named[256 + 1 + 256]; // per Dav1dTraceEvent.thread, + 256
+} TraceFile;
+
+static int open_trace_file(TraceFile *const tf, const char *const name) {
+    tf->f = strcmp(name, "-") ? fopen(name, "w") : stdout;
+    if (!tf->f) {
+        fprintf(stderr, "Failed to open %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    pthread_mutex_init(&tf->lock, NULL);
+    tf->n_events = 0;
+    memset(tf->named, 0, sizeof(tf->named));
+    fprintf(tf->f, "[\n");
+    return 0;
+}
+
+// must be called once the decoder is closed
+static void close_trace_file(TraceFile *const tf) {
+    if (!tf->f) return;
+    fprintf(tf->f, "\n]\n");
+    if (tf->f != stdout) fclose(tf->f);
+    pthread_mutex_destroy(&tf->lock);
+    tf->f = NULL;
+}
+
+static void trace_event(const Dav1dTraceEvent *const ev, void *const cookie) {
+    static const char *const type_names[] = {
+        [DAV1D_TRACE_FRAME] = "frame",
+        [DAV1D_TRACE_TILE_SBROW] = "tile",
+        [DAV1D_TRACE_DEBLOCK] = "deblock",
+        [DAV1D_TRACE_CDEF] = "cdef",
+        [DAV1D_TRACE_LR] = "lr",
+        [DAV1D_TRACE_WAIT_REF] = "wait_ref",
+        [DAV1D_TRACE_WAIT_TILE] = "wait_tile",
+        [DAV1D_TRACE_WAIT_FRAME_THREAD] = "wait_frame_thread",
+        [DAV1D_TRACE_WAIT_WAVEFRONT] = "wait_wavefront",
+    };
+    TraceFile *const tf = cookie;
+    const int tid = ev->thread >= 0 ? ev->thread : 999 - ev->thread;
+
+    pthread_mutex_lock(&tf->lock);
+    if (!tf->named[256 + ev->thread]) {
+        char name[32];
+        if (!ev->thread)
+            snprintf(name, sizeof(name), "decoder");
+        else if (ev->thread > 0)
+            snprintf(name, sizeof(name), "frame thread %d", ev->thread - 1);
+        else
+            snprintf(name, sizeof(name), "tile worker %d", -1 - ev->thread);
+        fprintf(tf->f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                tf->n_events++ ? ",\n" : "", tid, name);
+        tf->named[256 + ev->thread] = 1;
+    }
+    fprintf(tf->f, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3lf,\"pid\":1,"
+            "\"tid\":%d,\"args\":{\"poc\":%u,\"sby\":%d}}",
+            tf->n_events++ ? ",\n" : "", type_names[ev->type],
+            ev->end ? 'E' : 'B', ev->time * 1e-3, tid, ev->poc, ev->sby);
+    pthread_mutex_unlock(&tf->lock);
+}
+
+static double fps_of(const unsigned n, const uint64_t nanos) {
+    return nanos ? n * 1e9 / nanos : 0.0;
+}
+
+typedef struct {
+    unsigned n_frames;
+    uint64_t nanos;
+} DecodeStats;
+
+// Decodes one input file to one output file. In batch mode (report_lock
+// set), the progress counter is replaced by a summary line once done.
+static int decode_file(const CLISettings *const cli_settings,
+                       const Dav1dSettings *const lib_settings,
+                       const char *const inputfile,
+                       const char *const outputfile,
+                       pthread_mutex_t *const report_lock,
+                       DecodeStats *const stats)
+{
     const int istty = isatty(fileno(stderr));
+    const int progress = !cli_settings->quiet && !report_lock;
     int res = 0;
-    CLISettings cli_settings;
-    Dav1dSettings lib_settings;
     DemuxerContext *in;
     MuxerContext *out = NULL;
     Dav1dPicture p;
     Dav1dContext *c;
     Dav1dData data;
+    Latency latency = { 0 };
+    Realtime realtime = { .speed = cli_settings->realtime };
+    Realtime *const rt = cli_settings->realtime > 0 ? &realtime : NULL;
+    FILE *stats_file = NULL;
+    TraceFile trace = { .f = NULL };
+    Dav1dSettings settings = *lib_settings;
+    const int track_latency = cli_settings->bench || cli_settings->statsfile;
+    uint64_t pts;
     unsigned n_out = 0, total, fps[2];
-    const char *version = dav1d_version();
 
-    if (strcmp(version, DAV1D_VERSION)) {
-        fprintf(stderr, "Version mismatch (library: %s, executable: %s)\n",
-                version, DAV1D_VERSION);
+    stats->n_frames = 0;
+    stats->nanos = 0;
+    if (cli_settings->statsfile &&
+        !(stats_file = open_stats_file(cli_settings->statsfile)))
+    {
         return -1;
     }
-
-    dav1d_init();
-    init_demuxers();
-    init_muxers();
-    parse(argc, argv, &cli_settings, &lib_settings);
-
-    if ((res = input_open(&in, cli_settings.inputfile,
+    if (cli_settings->tracefile) {
+        if (open_trace_file(&trace, cli_settings->tracefile)) {
+            close_stats_file(stats_file);
+            return -1;
+        }
+        settings.trace = trace_event;
+        settings.trace_cookie = &trace;
+    }
+    if ((res = input_open(&in, cli_settings->demuxer, inputfile,
                           fps, &total)) < 0)
     {
+        close_stats_file(stats_file);
+        close_trace_file(&trace);
         return res;
     }
-    for (unsigned i = 0; i <= cli_settings.skip; i++) {
-        if ((res = input_read(in, &data)) < 0)
+    // start decoding at the keyframe before the first frame to output, if
+    // the input can seek, dropping the pictures in between (one per
+    // temporal unit); else just skip over the data of the first frames
+    unsigned skip = cli_settings->skip, n_drop = 0;
+    if (skip) {
+        const int kf = input_seek(in, skip);
+        if (kf >= 0) {
+            n_drop = skip - kf;
+            skip = 0;
+        }
+    }
+    for (unsigned i = 0; i <= skip; i++) {
+        if ((res = input_read(in, &data, &pts)) < 0) {
+            input_close(in);
+            close_stats_file(stats_file);
+            close_trace_file(&trace);
             return res;
-        if (i < cli_settings.skip) dav1d_data_unref(&data);
+        }
+        if (i < skip) dav1d_data_unref(&data);
     }
 
-    if (!cli_settings.quiet)
-        fprintf(stderr, "dav1d %s - by VideoLAN\n", DAV1D_VERSION);
-
     //getc(stdin);
-    if (cli_settings.limit != 0 && cli_settings.limit < total)
-        total = cli_settings.limit;
+    if (cli_settings->limit != 0 && cli_settings->limit < total)
+        total = cli_settings->limit;
 
-    if ((res = dav1d_open(&c, &lib_settings)))
+    if ((res = dav1d_open(&c, &settings))) {
+        dav1d_data_unref(&data);
+        input_close(in);
+        close_stats_file(stats_file);
+        close_trace_file(&trace);
         return res;
+    }
 
+    const uint64_t start_time = get_time_nanos();
+    const clock_t start_cpu = clock();
     do {
         memset(&p, 0, sizeof(p));
-        if ((res = dav1d_decode(c, &data, &p)) < 0) {
+        // if the decoder still holds the previous data, keep ours for the
+        // next iteration
+        if (rt && !realtime_due(rt, pts)) {
+            res = -EAGAIN; // not sent yet
+        } else if ((res = dav1d_send_data(c, &data)) < 0 && res != -EAGAIN) {
+            fprintf(stderr, "Error decoding frame: %s\n", strerror(-res));
+            break;
+        }
+        if (track_latency && !res) latency_in(&latency);
+        if (rt && !res) realtime_in(rt, pts);
+        if ((res = dav1d_get_picture(c, &p)) < 0) {
             if (res != -EAGAIN) {
                 fprintf(stderr, "Error decoding frame: %s\n",
                         strerror(-res));
                 break;
             }
             res = 0;
+            if (rt && data.sz) realtime_wait(rt, pts);
         } else {
+            if (track_latency) latency_out(&latency);
+            if (rt) realtime_out(rt);
+            if (n_drop) {
+                n_drop--;
+                dav1d_picture_unref(&p);
+                continue;
+            }
+            if (stats_file) write_frame_stats(stats_file, &p, &latency, n_out);
             if (!n_out) {
-                if ((res = output_open(&out, cli_settings.muxer,
-                                       cli_settings.outputfile,
-                                       &p.p, fps)) < 0)
+                if ((res = output_open(&out, cli_settings->muxer,
+                                       outputfile, &p.p, fps)) < 0)
                 {
-                    return res;
+                    dav1d_picture_unref(&p);
+                    break;
                 }
             }
             if ((res = output_write(out, &p)) < 0)
                 break;
             n_out++;
-            if (!cli_settings.quiet)
+            if (progress)
                 print_stats(istty, n_out, total);
         }
 
-        if (cli_settings.limit && n_out == cli_settings.limit)
+        if (cli_settings->limit && n_out == cli_settings->limit)
             break;
-    } while (data.sz > 0 || !input_read(in, &data));
+    } while (data.sz > 0 || !input_read(in, &data, &pts));
 
     // flush
-    if (res == 0) while (!cli_settings.limit || n_out < cli_settings.limit) {
-        if ((res = dav1d_decode(c, NULL, &p)) < 0) {
+    if (res == 0) dav1d_send_data(c, NULL);
+    if (res == 0) while (!cli_settings->limit || n_out < cli_settings->limit) {
+        if ((res = dav1d_get_picture(c, &p)) < 0) {
             if (res != -EAGAIN) {
                 fprintf(stderr, "Error decoding frame: %s\n",
                         strerror(-res));
@@ -143,32 +499,561 @@ int main(const int argc, char *const *const argv) {
                 res = 0;
             break;
         } else {
+            if (track_latency) latency_out(&latency);
+            if (rt) realtime_out(rt);
+            if (n_drop) {
+                n_drop--;
+                dav1d_picture_unref(&p);
+                continue;
+            }
+            if (stats_file) write_frame_stats(stats_file, &p, &latency, n_out);
             if (!n_out) {
-                if ((res = output_open(&out, cli_settings.muxer,
-                                       cli_settings.outputfile,
-                                       &p.p, fps)) < 0)
+                if ((res = output_open(&out, cli_settings->muxer,
+                                       outputfile, &p.p, fps)) < 0)
                 {
-                    return res;
+                    dav1d_picture_unref(&p);
+                    break;
                 }
             }
             if ((res = output_write(out, &p)) < 0)
                 break;
             n_out++;
-            if (!cli_settings.quiet)
+            if (progress)
                 print_stats(istty, n_out, total);
         }
     }
 
+    stats->n_frames = n_out;
+    stats->nanos = get_time_nanos() - start_time;
+    if (out && !report_lock && cli_settings->bench) {
+        const double secs = stats->nanos * 1e-9;
+        print_threads(lib_settings);
+        printf("frames: %u in %.3lf s (%.2lf fps), cpu time %.3lf s\n",
+               n_out, secs, fps_of(n_out, stats->nanos),
+               (double) (clock() - start_cpu) / CLOCKS_PER_SEC);
+        print_latency("", &latency, n_out);
+    } else if (out && report_lock) {
+        char prefix[1024];
+        snprintf(prefix, sizeof(prefix), "%s: ", inputfile);
+        pthread_mutex_lock(report_lock);
+        printf("%s%u frames in %.3lf s (%.2lf fps)\n", prefix, n_out,
+               stats->nanos * 1e-9, fps_of(n_out, stats->nanos));
+        if (cli_settings->bench)
+            print_latency(prefix, &latency, n_out);
+        pthread_mutex_unlock(report_lock);
+    }
+    if (out && rt)
+        print_realtime(rt);
+    free(latency.t);
+    free(realtime.t);
+    close_stats_file(stats_file);
+
+    dav1d_data_unref(&data);
     input_close(in);
     if (out) {
-        if (!cli_settings.quiet && istty)
+        if (progress && istty)
             fprintf(stderr, "\n");
-        output_close(out);
+        const int err = output_close(out);
+        if (!res) res = err;
     } else {
-        fprintf(stderr, "No data decoded\n");
+        fprintf(stderr, "No data decoded%s%s\n",
+                report_lock ? " from " : "", report_lock ? inputfile : "");
         res = 1;
     }
     dav1d_close(&c);
+    close_trace_file(&trace);
+
+    return res;
+}
+
+// Several input files are decoded by a number of jobs, each picking the
+// next file once done with its previous one; the decoders share a single
+// pool of worker threads.
+typedef struct {
+    const CLISettings *cli_settings;
+    const Dav1dSettings *lib_settings;
+    pthread_mutex_t lock;
+    int next; // next input to decode
+    int n_failed;
+    unsigned n_frames;
+} Batch;
+
+// Substitutes "%s" in the output file name (once) with the base name of
+// the input file, stripped of its extension.
+static int batch_output_name(char *const buf, const size_t sz,
+                             const char *const tmpl, const char *const input)
+{
+    const char *base = strrchr(input, '/');
+    base = base ? base + 1 : input;
+    const char *const ext = strrchr(base, '.');
+    const int base_len = ext && ext != base ? (int) (ext - base) :
+                                              (int) strlen(base);
+    const char *const pos = strstr(tmpl, "%s");
+    assert(pos);
+
+    const int len = snprintf(buf, sz, "%.*s%.*s%s", (int) (pos - tmpl), tmpl,
+                             base_len, base, pos + 2);
+    return len < 0 || (size_t) len >= sz ? -1 : 0;
+}
+
+static void *batch_job(void *const data) {
+    Batch *const b = data;
+    const CLISettings *const cli_settings = b->cli_settings;
+    char outputfile[4096];
+
+    for (;;) {
+        pthread_mutex_lock(&b->lock);
+        const int i = b->next++;
+        pthread_mutex_unlock(&b->lock);
+        if (i >= cli_settings->num_inputs) break;
+
+        const char *const inputfile = cli_settings->inputfiles[i];
+        DecodeStats stats;
+        int res;
+        if (cli_settings->bench) {
+            res = decode_file(cli_settings, b->lib_settings, inputfile,
+                              cli_settings->outputfile, &b->lock, &stats);
+        } else if (batch_output_name(outputfile, sizeof(outputfile),
+                                     cli_settings->outputfile, inputfile))
+        {
+            fprintf(stderr, "Output file name too long for %s\n", inputfile);
+            res = -1;
+        } else {
+            res = decode_file(cli_settings, b->lib_settings, inputfile,
+                              outputfile, &b->lock, &stats);
+        }
+
+        pthread_mutex_lock(&b->lock);
+        if (res) {
+            printf("%s: failed\n", inputfile);
+            b->n_failed++;
+        } else {
+            b->n_frames += stats.n_frames;
+        }
+        pthread_mutex_unlock(&b->lock);
+    }
+
+    return NULL;
+}
+
+static int decode_batch(const CLISettings *const cli_settings,
+                        Dav1dSettings *const lib_settings)
+{
+    const int n_jobs = cli_settings->jobs ?
+        imin(cli_settings->jobs, cli_settings->num_inputs) :
+        imin(cli_settings->num_inputs, 8);
+    Dav1dThreadPool *pool;
+    pthread_t *jobs;
+    int res;
+
+    if ((res = dav1d_thread_pool_create(&pool, lib_settings)) < 0)
+        return res;
+    if (!(jobs = malloc(sizeof(*jobs) * n_jobs))) {
+        dav1d_thread_pool_destroy(&pool);
+        return -ENOMEM;
+    }
+    lib_settings->thread_pool = pool;
+
+    Batch b = {
+        .cli_settings = cli_settings,
+        .lib_settings = lib_settings,
+    };
+    pthread_mutex_init(&b.lock, NULL);
+
+    const uint64_t start_time = get_time_nanos();
+    const clock_t start_cpu = clock();
+    int n_started = 0;
+    for (; n_started < n_jobs; n_started++)
+        if (pthread_create(&jobs[n_started], NULL, batch_job, &b))
+            break;
+    if (!n_started) // decode everything from here then
+        batch_job(&b);
+    for (int n = 0; n < n_started; n++)
+        pthread_join(jobs[n], NULL);
+    const uint64_t nanos = get_time_nanos() - start_time;
+
+    if (cli_settings->bench)
+        print_threads(lib_settings);
+    printf("total: %d files (%d failed) by %d jobs, %u frames in %.3lf s "
+           "(%.2lf fps), cpu time %.3lf s\n",
+           cli_settings->num_inputs, b.n_failed, imax(n_started, 1),
+           b.n_frames, nanos * 1e-9, fps_of(b.n_frames, nanos),
+           (double) (clock() - start_cpu) / CLOCKS_PER_SEC);
+
+    pthread_mutex_destroy(&b.lock);
+    free(jobs);
+    dav1d_thread_pool_destroy(&pool);
+
+    return b.n_failed ? 1 : 0;
+}
+
+// A single input can also be decoded by segments (--segments), split at
+// its random access points: temporal units with a sequence header and a
+// shown key frame, which refreshes all references, so that no later frame
+// depends on an earlier one. The segments are decoded in parallel by a
+// number of jobs, each with its own decoder (sharing a pool of worker
+// threads), and their pictures are written in order as they come in. A
+// job only starts on a segment while fewer than n_jobs segments, counting
+// from the one being written, are decoded or in progress, which bounds the
+// pictures buffered to that many segments.
+typedef struct {
+    int first, end; // packets
+    Dav1dPicture *pics; // decoded, not all written yet
+    unsigned n_pics, n_written, sz;
+    int done, res;
+} Segment;
+
+typedef struct {
+    const Dav1dSettings *lib_settings;
+    Dav1dData *data; // packets, each a temporal unit
+    Segment *seg;
+    int n_seg, n_jobs;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int next; // next segment to decode
+    int writing; // segment being written
+    int abort;
+} Segments;
+
+static int read_leb128(const uint8_t *const buf, const size_t sz,
+                       size_t *const val, size_t *const len)
+{
+    uint64_t v = 0;
+    size_t i = 0;
+    unsigned more;
+
+    do {
+        if (i == sz) return -1;
+        more = buf[i] & 0x80;
+        v |= (uint64_t) (buf[i] & 0x7f) << (i * 7);
+    } while (more && ++i < 8);
+    if (more || v > SIZE_MAX) return -1;
+
+    *val = (size_t) v;
+    *len = i + 1;
+    return 0;
+}
+
+// Whether the temporal unit in buf is a random access point, see above.
+static int is_random_access_point(const uint8_t *buf, size_t sz) {
+    int has_seq_hdr = 0, reduced_still_picture_hdr = 0;
+
+    while (sz) {
+        const int type = (buf[0] >> 3) & 15;
+        const int has_extension = (buf[0] >> 2) & 1;
+        const int has_size = (buf[0] >> 1) & 1;
+        size_t obu_sz = sz - 1 - has_extension, len = 0;
+
+        if (sz < 1 + (size_t) has_extension) return 0;
+        if (has_size &&
+            (read_leb128(&buf[1 + has_extension], sz - 1 - has_extension,
+                         &obu_sz, &len) ||
+             obu_sz > sz - 1 - has_extension - len))
+        {
+            return 0;
+        }
+        const uint8_t *const payload = &buf[1 + has_extension + len];
+        switch (type) {
+        case 1: // sequence header: seq_profile, still_picture,
+                // reduced_still_picture_header
+            if (!obu_sz) return 0;
+            has_seq_hdr = 1;
+            reduced_still_picture_hdr = (payload[0] >> 3) & 1;
+            break;
+        case 3: // frame header
+        case 6: // frame: show_existing_frame, frame_type, show_frame
+            if (!has_seq_hdr || !obu_sz) return 0;
+            return reduced_still_picture_hdr ||
+                   (payload[0] & 0xf0) == 0x10;
+        }
+        buf += 1 + has_extension + len + obu_sz;
+        sz -= 1 + has_extension + len + obu_sz;
+    }
+
+    return 0;
+}
+
+// Returns 1 (and drops the picture) once the writer has stopped.
+static int segment_add_picture(Segments *const sg, Segment *const seg,
+                               Dav1dPicture *const p)
+{
+    pthread_mutex_lock(&sg->lock);
+    if (sg->abort) {
+        pthread_mutex_unlock(&sg->lock);
+        dav1d_picture_unref(p);
+        return 1;
+    }
+    if (seg->n_pics == seg->sz) {
+        const unsigned sz = seg->sz ? seg->sz * 2 : 32;
+        Dav1dPicture *const pics = realloc(seg->pics, sz * sizeof(*pics));
+        if (!pics) {
+            pthread_mutex_unlock(&sg->lock);
+            dav1d_picture_unref(p);
+            return -ENOMEM;
+        }
+        seg->pics = pics;
+        seg->sz = sz;
+    }
+    seg->pics[seg->n_pics++] = *p;
+    pthread_cond_broadcast(&sg->cond);
+    pthread_mutex_unlock(&sg->lock);
+
+    return 0;
+}
+
+static int decode_segment(Segments *const sg, Dav1dContext *const c,
+                          Segment *const seg)
+{
+    Dav1dPicture p;
+    int res = 0;
+
+    for (int n = seg->first; n < seg->end;) {
+        if ((res = dav1d_send_data(c, &sg->data[n])) < 0 && res != -EAGAIN)
+            return res;
+        if (!sg->data[n].sz) n++;
+        memset(&p, 0, sizeof(p));
+        if ((res = dav1d_get_picture(c, &p)) < 0) {
+            if (res != -EAGAIN) return res;
+        } else if ((res = segment_add_picture(sg, seg, &p))) {
+            return imin(res, 0);
+        }
+    }
+
+    dav1d_send_data(c, NULL);
+    for (;;) {
+        memset(&p, 0, sizeof(p));
+        if ((res = dav1d_get_picture(c, &p)) < 0)
+            return res == -EAGAIN ? 0 : res;
+        if ((res = segment_add_picture(sg, seg, &p)))
+            return imin(res, 0);
+    }
+}
+
+static void *segment_job(void *const data) {
+    Segments *const sg = data;
+    Dav1dContext *c = NULL;
+
+    pthread_mutex_lock(&sg->lock);
+    for (;;) {
+        while (!sg->abort && sg->next < sg->n_seg &&
+               sg->next - sg->writing >= sg->n_jobs)
+        {
+            pthread_cond_wait(&sg->cond, &sg->lock);
+        }
+        if (sg->abort || sg->next == sg->n_seg) break;
+        Segment *const seg = &sg->seg[sg->next++];
+        pthread_mutex_unlock(&sg->lock);
+
+        int res;
+        if (c) {
+            dav1d_reset(c);
+            res = 0;
+        } else {
+            res = dav1d_open(&c, sg->lib_settings);
+        }
+        if (!res)
+            res = decode_segment(sg, c, seg);
+
+        pthread_mutex_lock(&sg->lock);
+        seg->done = 1;
+        seg->res = res;
+        pthread_cond_broadcast(&sg->cond);
+    }
+    pthread_mutex_unlock(&sg->lock);
+    if (c) dav1d_close(&c);
+
+    return NULL;
+}
+
+static int decode_segments(const CLISettings *const cli_settings,
+                           Dav1dSettings *const lib_settings)
+{
+    const int istty = isatty(fileno(stderr));
+    const int progress = !cli_settings->quiet;
+    DemuxerContext *in;
+    MuxerContext *out = NULL;
+    Dav1dThreadPool *pool;
+    pthread_t *jobs;
+    Segments sg = { .lib_settings = lib_settings };
+    unsigned n_out = 0, total, fps[2];
+    int n_data = 0, sz = 0, res;
+    uint64_t pts;
+
+    if ((res = input_open(&in, cli_settings->demuxer,
+                          cli_settings->inputfiles[0], fps, &total)) < 0)
+    {
+        return res;
+    }
+    for (;;) {
+        if (n_data == sz) {
+            sz = sz ? sz * 2 : 256;
+            Dav1dData *const data = realloc(sg.data, sz * sizeof(*data));
+            if (!data) {
+                res = -ENOMEM;
+                break;
+            }
+            sg.data = data;
+        }
+        if (input_read(in, &sg.data[n_data], &pts)) break;
+        if (n_data == 0 || is_random_access_point(sg.data[n_data].data,
+                                                  sg.data[n_data].sz))
+        {
+            sg.n_seg++;
+        }
+        n_data++;
+    }
+    input_close(in);
+    if (cli_settings->limit != 0 && cli_settings->limit < total)
+        total = cli_settings->limit;
+
+    if (!res && !(sg.seg = calloc(sg.n_seg, sizeof(*sg.seg))))
+        res = -ENOMEM;
+    if (res) {
+        for (int n = 0; n < n_data; n++)
+            dav1d_data_unref(&sg.data[n]);
+        free(sg.data);
+        return res;
+    }
+    for (int n = 0, i = -1; n < n_data; n++) {
+        if (n == 0 || is_random_access_point(sg.data[n].data, sg.data[n].sz))
+            sg.seg[++i].first = n;
+        sg.seg[i].end = n + 1;
+    }
+
+    sg.n_jobs = imin(cli_settings->segments, imax(sg.n_seg, 1));
+    if ((res = dav1d_thread_pool_create(&pool, lib_settings)) < 0 ||
+        !(jobs = malloc(sizeof(*jobs) * sg.n_jobs)))
+    {
+        if (!res) {
+            dav1d_thread_pool_destroy(&pool);
+            res = -ENOMEM;
+        }
+        for (int n = 0; n < n_data; n++)
+            dav1d_data_unref(&sg.data[n]);
+        free(sg.data);
+        free(sg.seg);
+        return res;
+    }
+    lib_settings->thread_pool = pool;
+    pthread_mutex_init(&sg.lock, NULL);
+    pthread_cond_init(&sg.cond, NULL);
+
+    const uint64_t start_time = get_time_nanos();
+    const clock_t start_cpu = clock();
+    int n_started = 0;
+    for (; n_started < sg.n_jobs; n_started++)
+        if (pthread_create(&jobs[n_started], NULL, segment_job, &sg))
+            break;
+    if (!n_started) {
+        fprintf(stderr, "Failed to create the segment jobs\n");
+        res = -1;
+    }
+
+    pthread_mutex_lock(&sg.lock);
+    for (int i = 0; n_started && i < sg.n_seg && !res; i++) {
+        Segment *const seg = &sg.seg[i];
+
+        sg.writing = i;
+        pthread_cond_broadcast(&sg.cond);
+        for (;;) {
+            while (seg->n_written == seg->n_pics && !seg->done)
+                pthread_cond_wait(&sg.cond, &sg.lock);
+            if (seg->n_written == seg->n_pics) break;
+            Dav1dPicture p = seg->pics[seg->n_written++];
+            pthread_mutex_unlock(&sg.lock);
+
+            if (!n_out)
+                res = output_open(&out, cli_settings->muxer,
+                                  cli_settings->outputfile, &p.p, fps);
+            if (!res)
+                res = output_write(out, &p);
+            else
+                dav1d_picture_unref(&p);
+            if (!res) {
+                n_out++;
+                if (progress)
+                    print_stats(istty, n_out, total);
+            }
+
+            pthread_mutex_lock(&sg.lock);
+            if (res || (cli_settings->limit && n_out == cli_settings->limit))
+                break;
+        }
+        if (!res && seg->res < 0) {
+            fprintf(stderr, "Error decoding frame: %s\n", strerror(-seg->res));
+            res = seg->res;
+        }
+        if (cli_settings->limit && n_out == cli_settings->limit)
+            break;
+    }
+    sg.abort = 1;
+    pthread_cond_broadcast(&sg.cond);
+    pthread_mutex_unlock(&sg.lock);
+    for (int n = 0; n < n_started; n++)
+        pthread_join(jobs[n], NULL);
+    const uint64_t nanos = get_time_nanos() - start_time;
+
+    if (out && cli_settings->bench) {
+        print_threads(lib_settings);
+        printf("frames: %u in %.3lf s (%.2lf fps) by %d jobs, %d segments, "
+               "cpu time %.3lf s\n", n_out, nanos * 1e-9, fps_of(n_out, nanos),
+               n_started, sg.n_seg,
+               (double) (clock() - start_cpu) / CLOCKS_PER_SEC);
+    }
+    for (int i = 0; i < sg.n_seg; i++) {
+        for (unsigned n = sg.seg[i].n_written; n < sg.seg[i].n_pics; n++)
+            dav1d_picture_unref(&sg.seg[i].pics[n]);
+        free(sg.seg[i].pics);
+    }
+    for (int n = 0; n < n_data; n++)
+        dav1d_data_unref(&sg.data[n]);
+    free(sg.data);
+    free(sg.seg);
+    free(jobs);
+    pthread_cond_destroy(&sg.cond);
+    pthread_mutex_destroy(&sg.lock);
+    dav1d_thread_pool_destroy(&pool);
+
+    if (out) {
+        if (progress && istty)
+            fprintf(stderr, "\n");
+        const int err = output_close(out);
+        if (!res) res = err;
+    } else if (!res) {
+        fprintf(stderr, "No data decoded\n");
+        res = 1;
+    }
+
+    return res;
+}
+
+int main(const int argc, char *const *const argv) {
+    CLISettings cli_settings;
+    Dav1dSettings lib_settings;
+    DecodeStats stats;
+    const char *version = dav1d_version();
+
+    if (strcmp(version, DAV1D_VERSION)) {
+        fprintf(stderr, "Version mismatch (library: %s, executable: %s)\n",
+                version, DAV1D_VERSION);
+        return -1;
+    }
+
+    dav1d_init();
+    init_demuxers();
+    init_muxers();
+    parse(argc, argv, &cli_settings, &lib_settings);
+
+    if (!cli_settings.quiet)
+        fprintf(stderr, "dav1d %s - by VideoLAN\n", DAV1D_VERSION);
+
+    const int res = cli_settings.num_inputs > 1 ?
+        decode_batch(&cli_settings, &lib_settings) :
+        cli_settings.segments ?
+        decode_segments(&cli_settings, &lib_settings) :
+        decode_file(&cli_settings, &lib_settings, cli_settings.inputfiles[0],
+                    cli_settings.outputfile, NULL, &stats);
+    free(cli_settings.inputfiles);
 
     return res;
 }
@@ -39,28 +39,62 @@
 #endif
 
 #include "dav1d_cli_parse.h"
+#include "src/cpu.h"
 
 static const char short_opts[] = "i:o:vql:";
 
 enum {
+    ARG_DEMUXER,
     ARG_MUXER,
     ARG_FRAME_THREADS,
     ARG_TILE_THREADS,
+    ARG_PARSE_AHEAD,
+    ARG_SPIN_WAIT,
+    ARG_PERF_CORES,
+    ARG_CPU_MASK,
+    ARG_FILM_GRAIN,
+    ARG_BENCH,
+    ARG_JOBS,
+    ARG_SEGMENTS,
+    ARG_REALTIME,
+    ARG_STATS_FILE,
+    ARG_TRACE_FILE,
 };
 
 static const struct option long_opts[] = {
     { "input",          1, NULL, 'i' },
     { "output",         1, NULL, 'o' },
     { "quiet",          0, NULL, 'q' },
+    { "demuxer",        1, NULL, ARG_DEMUXER },
     { "muxer",          1, NULL, ARG_MUXER },
     { "version",        0, NULL, 'v' },
     { "limit",          1, NULL, 'l' },
     { "skip",           1, NULL, 's' },
     { "framethreads",   1, NULL, ARG_FRAME_THREADS },
     { "tilethreads",    1, NULL, ARG_TILE_THREADS },
+    { "parseahead",     0, NULL, ARG_PARSE_AHEAD },
+    { "spinwait",       1, NULL, ARG_SPIN_WAIT },
+    { "perfcores",      1, NULL, ARG_PERF_CORES },
+    { "cpumask",        1, NULL, ARG_CPU_MASK },
+    { "filmgrain",      1, NULL, ARG_FILM_GRAIN },
+    { "bench",          0, NULL, ARG_BENCH },
+    { "jobs",           1, NULL, ARG_JOBS },
+    { "segments",       1, NULL, ARG_SEGMENTS },
+    { "realtime",       2, NULL, ARG_REALTIME },
+    { "stats-file",     1, NULL, ARG_STATS_FILE },
+    { "trace-file",     1, NULL, ARG_TRACE_FILE },
     { NULL,             0, NULL, 0 },
 };
 
+#if ARCH_AARCH64 || ARCH_ARM
+#define ALLOWED_CPU_MASKS ", 'neon' or a bitmask"
+#elif ARCH_X86
+#define ALLOWED_CPU_MASKS \
+    ", 'sse2', 'ssse3', 'sse41', 'avx2', 'avx512' or a bitmask"
+#else
+#define ALLOWED_CPU_MASKS " or a bitmask"
+#endif
+
 static void usage(const char *const app, const char *const reason, ...) {
     if (reason) {
         va_list args;
@@ -70,17 +104,46 @@ static void usage(const char *const app, const char *const reason, ...) {
         va_end(args);
         fprintf(stderr, "\n\n");
     }
-    fprintf(stderr, "Usage: %s [options]\n\n", app);
+    fprintf(stderr, "Usage: %s [options] [input files]\n\n", app);
     fprintf(stderr, "Supported options:\n"
-            " --input/-i  $file:   input file\n"
-            " --output/-o $file:   output file\n"
+            " --input/-i  $file:   input file (\"-\" for stdin); can be repeated, and further\n"
+            "                      input files can follow the options, to decode them in\n"
+            "                      one batch\n"
+            " --demuxer $name:     force demuxer type (default: detect from extension)\n"
+            " --output/-o $file:   output file; when decoding several input files, \"%%s\"\n"
+            "                      in it is replaced by each input's base name\n"
             " --muxer $name:       force muxer type (default: detect from extension)\n"
             " --quiet/-q:          disable status messages\n"
             " --limit/-l $num:     stop decoding after $num frames\n"
-            " --skip/-s $num:      skip decoding of the first $num frames\n"
+            " --skip/-s $num:      skip the first $num frames; IVF input is decoded from the\n"
+            "                      last keyframe before, the others from frame $num\n"
             " --version/-v:        print version and exit\n"
-            " --framethreads $num: number of frame threads (default: 1)\n"
-            " --tilethreads $num:  number of tile threads (default: 1)\n");
+            " --framethreads $num: number of frame threads (default: 0 = auto)\n"
+            " --tilethreads $num:  number of tile threads (default: 0 = auto)\n"
+            " --parseahead:        with one frame thread, parse each frame ahead of its\n"
+            "                      reconstruction on the tile threads\n"
+            " --spinwait $num:     pause rounds to spin for before blocking on another\n"
+            "                      thread's progress (default: 0 = never spin)\n"
+            " --perfcores $num:    keep the frame threads on the faster cores of hybrid\n"
+            "                      processors (default: 1)\n"
+            " --cpumask $mask:     restrict permitted CPU instruction sets\n"
+            "                      (0" ALLOWED_CPU_MASKS "; default: -1)\n"
+            " --filmgrain $num:    enable film grain application (default: 1)\n"
+            " --bench:             discard the output, and report the decoding speed\n"
+            "                      and per-frame latency (replaces --output)\n"
+            " --jobs $num:         number of input files decoded concurrently, sharing\n"
+            "                      the worker threads (default: 0 = up to 8)\n"
+            " --segments $num:     split the input at key frames with a sequence header,\n"
+            "                      and decode up to $num of these segments in parallel,\n"
+            "                      buffering their pictures (for offline decoding)\n"
+            " --realtime[=$speed]: send the input at the pace of its timestamps (sped up\n"
+            "                      by $speed; default: 1), and report the frames missing\n"
+            "                      their display deadline\n"
+            " --stats-file $file:  write the decoding statistics of each output frame\n"
+            "                      to $file (\"-\" for stdout), one line per frame\n"
+            " --trace-file $file:  write a timeline of the decoding stages and waits of\n"
+            "                      each thread to $file, in the Chrome trace format\n"
+            "                      (for chrome://tracing or Perfetto)\n");
     exit(1);
 }
 
@@ -111,6 +174,54 @@ static unsigned parse_unsigned(char *optarg, const int option, const char *app)
     return res;
 }
 
+static double parse_positive(char *optarg, const int option, const char *app) {
+    char *end;
+    const double res = strtod(optarg, &end);
+    if (*end || end == optarg || !(res > 0))
+        error(app, optarg, option, "a positive number");
+    return res;
+}
+
+#if ARCH_X86
+#define X86_CPU_MASK_SSE2   (DAV1D_X86_CPU_FLAG_SSE | DAV1D_X86_CPU_FLAG_SSE2)
+#define X86_CPU_MASK_SSSE3  (X86_CPU_MASK_SSE2 | DAV1D_X86_CPU_FLAG_SSE3 | \
+                             DAV1D_X86_CPU_FLAG_SSSE3)
+#define X86_CPU_MASK_SSE41  (X86_CPU_MASK_SSSE3 | DAV1D_X86_CPU_FLAG_SSE41)
+#define X86_CPU_MASK_AVX2   (X86_CPU_MASK_SSE41 | DAV1D_X86_CPU_FLAG_SSE42 | \
+                             DAV1D_X86_CPU_FLAG_AVX | DAV1D_X86_CPU_FLAG_AVX2)
+#define X86_CPU_MASK_AVX512 (X86_CPU_MASK_AVX2 | DAV1D_X86_CPU_FLAG_AVX512)
+#endif
+
+typedef struct EnumParseTable {
+    const char *str;
+    const unsigned val;
+} EnumParseTable;
+
+static const EnumParseTable cpu_mask_tbl[] = {
+#if ARCH_AARCH64 || ARCH_ARM
+    { "neon", DAV1D_ARM_CPU_FLAG_NEON },
+#elif ARCH_X86
+    { "sse2",   X86_CPU_MASK_SSE2 },
+    { "ssse3",  X86_CPU_MASK_SSSE3 },
+    { "sse41",  X86_CPU_MASK_SSE41 },
+    { "avx2",   X86_CPU_MASK_AVX2 },
+    { "avx512", X86_CPU_MASK_AVX512 },
+#endif
+    { 0 },
+};
+
+static unsigned parse_cpu_mask(char *optarg, const int option, const char *app) {
+    for (int n = 0; cpu_mask_tbl[n].str; n++)
+        if (!strcmp(cpu_mask_tbl[n].str, optarg))
+            return cpu_mask_tbl[n].val;
+
+    char *end;
+    const unsigned res = (unsigned) strtol(optarg, &end, 0);
+    if (*end || end == optarg)
+        error(app, optarg, option, "a CPU mask (0" ALLOWED_CPU_MASKS ")");
+    return res;
+}
+
 void parse(const int argc, char *const *const argv,
            CLISettings *const cli_settings, Dav1dSettings *const lib_settings)
 {
@@ -118,6 +229,11 @@ void parse(const int argc, char *const *const argv,
 
     memset(cli_settings, 0, sizeof(*cli_settings));
     dav1d_default_settings(lib_settings);
+    // there are at most as many input files as arguments
+    if (!(cli_settings->inputfiles = malloc(sizeof(char *) * argc))) {
+        fprintf(stderr, "Failed to allocate memory\n");
+        exit(1);
+    }
 
     while ((o = getopt_long(argc, argv, short_opts, long_opts, NULL)) >= 0) {
         switch (o) {
@@ -125,7 +241,7 @@ void parse(const int argc, char *const *const argv,
             cli_settings->outputfile = optarg;
             break;
         case 'i':
-            cli_settings->inputfile = optarg;
+            cli_settings->inputfiles[cli_settings->num_inputs++] = optarg;
             break;
         case 'q':
             cli_settings->quiet = 1;
@@ -136,6 +252,9 @@ void parse(const int argc, char *const *const argv,
         case 's':
             cli_settings->skip = parse_unsigned(optarg, 's', argv[0]);
             break;
+        case ARG_DEMUXER:
+            cli_settings->demuxer = optarg;
+            break;
         case ARG_MUXER:
             cli_settings->muxer = optarg;
             break;
@@ -147,6 +266,46 @@ void parse(const int argc, char *const *const argv,
             lib_settings->n_tile_threads =
                 parse_unsigned(optarg, ARG_TILE_THREADS, argv[0]);
             break;
+        case ARG_PARSE_AHEAD:
+            lib_settings->parse_ahead = 1;
+            break;
+        case ARG_SPIN_WAIT:
+            lib_settings->spin_wait =
+                parse_unsigned(optarg, ARG_SPIN_WAIT, argv[0]);
+            break;
+        case ARG_PERF_CORES:
+            lib_settings->performance_cores =
+                !!parse_unsigned(optarg, ARG_PERF_CORES, argv[0]);
+            break;
+        case ARG_CPU_MASK:
+            dav1d_set_cpu_flags_mask(parse_cpu_mask(optarg, ARG_CPU_MASK,
+                                                    argv[0]));
+            break;
+        case ARG_FILM_GRAIN:
+            lib_settings->apply_grain =
+                !!parse_unsigned(optarg, ARG_FILM_GRAIN, argv[0]);
+            break;
+        case ARG_BENCH:
+            cli_settings->bench = 1;
+            break;
+        case ARG_JOBS:
+            cli_settings->jobs = parse_unsigned(optarg, ARG_JOBS, argv[0]);
+            break;
+        case ARG_SEGMENTS:
+            cli_settings->segments =
+                parse_unsigned(optarg, ARG_SEGMENTS, argv[0]);
+            break;
+        case ARG_REALTIME:
+            cli_settings->realtime = optarg ?
+                parse_positive(optarg, ARG_REALTIME, argv[0]) : 1.0;
+            break;
+        case ARG_STATS_FILE:
+            cli_settings->statsfile = optarg;
+            lib_settings->frame_stats = 1;
+            break;
+        case ARG_TRACE_FILE:
+            cli_settings->tracefile = optarg;
+            break;
         case 'v':
             fprintf(stderr, "%s\n", dav1d_version());
             exit(0);
@@ -155,8 +314,39 @@ void parse(const int argc, char *const *const argv,
         }
     }
 
-    if (!cli_settings->inputfile)
+    while (optind < argc)
+        cli_settings->inputfiles[cli_settings->num_inputs++] = argv[optind++];
+    if (!cli_settings->num_inputs)
         usage(argv[0], "Input file (-i/--input) is required");
+    for (int i = 0; i < cli_settings->num_inputs; i++)
+        if (!strcmp(cli_settings->inputfiles[i], "-") && !cli_settings->demuxer)
+            usage(argv[0], "Reading from stdin requires --demuxer");
+    if (cli_settings->num_inputs > 1 && cli_settings->realtime)
+        usage(argv[0], "--realtime takes a single input file");
+    if (cli_settings->num_inputs > 1 && cli_settings->statsfile)
+        usage(argv[0], "--stats-file takes a single input file");
+    if (cli_settings->num_inputs > 1 && cli_settings->tracefile)
+        usage(argv[0], "--trace-file takes a single input file");
+    if (cli_settings->segments &&
+        (cli_settings->num_inputs > 1 || cli_settings->realtime ||
+         cli_settings->statsfile || cli_settings->tracefile ||
+         cli_settings->skip))
+    {
+        usage(argv[0], "--segments takes a single input file, and cannot be "
+              "combined with --realtime, --stats-file, --trace-file or --skip");
+    }
+    if (cli_settings->bench) {
+        if (cli_settings->outputfile || cli_settings->muxer)
+            usage(argv[0], "--bench cannot be combined with -o/--output or --muxer");
+        cli_settings->outputfile = "-";
+        cli_settings->muxer = "null";
+    }
     if (!cli_settings->outputfile)
         usage(argv[0], "Output file (-o/--output) is required");
+    if (cli_settings->num_inputs > 1 && !cli_settings->bench &&
+        !strstr(cli_settings->outputfile, "%s"))
+    {
+        usage(argv[0], "Output file (-o/--output) must contain \"%%s\" when "
+              "decoding several input files");
+    }
 }
@@ -32,10 +32,18 @@
 
 typedef struct {
     const char *outputfile;
-    const char *inputfile;
+    const char **inputfiles; // allocated, to be freed by the caller
+    int num_inputs;
+    const char *demuxer;
     const char *muxer;
     unsigned limit, skip;
     int quiet;
+    int bench;
+    unsigned jobs;
+    unsigned segments; // jobs decoding segments of a single input, or 0
+    double realtime; // playback speed, 0 if not simulating playback
+    const char *statsfile;
+    const char *tracefile;
 } CLISettings;
 
 void parse(const int argc, char *const *const argv,
@@ -0,0 +1,124 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "input/demuxer.h"
+#include "input/parse.h"
+
+// Annex B (length delimited) bitstream: each temporal unit, frame unit and
+// OBU is preceded by its size, and the OBUs need not have a size field.
+// These are handed to the decoder one OBU at a time.
+typedef struct DemuxerPriv {
+    FILE *f;
+    size_t temporal_unit_size, frame_unit_size; // bytes left in each
+    unsigned temporal_unit; // index of the current one
+} AnnexbInputContext;
+
+static int annexb_open(AnnexbInputContext *const c, const char *const file,
+                       unsigned fps[2], unsigned *const num_frames)
+{
+    size_t sz, len;
+
+    memset(c, 0, sizeof(*c));
+    if (!(c->f = open_input(file)))
+        return -1;
+
+    // there is no timing information; count the temporal units (unless
+    // streaming), which are given timestamps at 25 fps
+    fps[0] = 25;
+    fps[1] = 1;
+    if (!is_seekable(c->f)) {
+        *num_frames = 0xFFFFFFFFU;
+        return 0;
+    }
+    for (*num_frames = 0; !leb128(c->f, &sz, NULL, &len); (*num_frames)++)
+        if (fseek(c->f, sz, SEEK_CUR)) break;
+    if (!*num_frames) {
+        fprintf(stderr, "%s is not an Annex B file\n", file);
+        close_input(c->f);
+        return -1;
+    }
+    fseek(c->f, 0, SEEK_SET);
+
+    return 0;
+}
+
+static int annexb_read(AnnexbInputContext *const c, Dav1dData *const buf,
+                       uint64_t *const pts)
+{
+    size_t sz, len;
+
+    while (!c->frame_unit_size) {
+        while (!c->temporal_unit_size) {
+            if (leb128(c->f, &c->temporal_unit_size, NULL, &len))
+                return -1; // EOF
+            c->temporal_unit++;
+        }
+        if (leb128(c->f, &c->frame_unit_size, NULL, &len) ||
+            len + c->frame_unit_size > c->temporal_unit_size)
+        {
+            goto error;
+        }
+        c->temporal_unit_size -= len + c->frame_unit_size;
+    }
+    if (leb128(c->f, &sz, NULL, &len) || !sz || len + sz > c->frame_unit_size)
+        goto error;
+    c->frame_unit_size -= len + sz;
+    *pts = (c->temporal_unit - 1) * 40000000ULL;
+
+    if (dav1d_data_create(buf, sz) < 0) return -1;
+    if (fread(buf->data, sz, 1, c->f) != 1) {
+        fprintf(stderr, "Failed to read frame data: %s\n", strerror(errno));
+        dav1d_data_unref(buf);
+        return -1;
+    }
+
+    return 0;
+
+error:
+    fprintf(stderr, "Invalid Annex B unit size\n");
+    return -1;
+}
+
+static void annexb_close(AnnexbInputContext *const c) {
+    close_input(c->f);
+}
+
+const Demuxer annexb_demuxer = {
+    .priv_data_size = sizeof(AnnexbInputContext),
+    .name = "annexb",
+    .extension = "annexb",
+    .open = annexb_open,
+    .read = annexb_read,
+    .close = annexb_close,
+};
@@ -37,7 +37,13 @@ typedef struct Demuxer {
     const char *extension;
     int (*open)(DemuxerPriv *ctx, const char *filename,
                 unsigned fps[2], unsigned *num_frames);
-    int (*read)(DemuxerPriv *ctx, Dav1dData *data);
+    // *pts is set to the presentation time of the packet, in nanoseconds
+    int (*read)(DemuxerPriv *ctx, Dav1dData *data, uint64_t *pts);
+    // optional; positions the input at the closest keyframe at or before
+    // frame (counted from 0), from which decoding can start, and returns
+    // its frame number, or a negative value (leaving the position as is)
+    // if the input cannot seek
+    int (*seek)(DemuxerPriv *ctx, unsigned frame);
     void (*close)(DemuxerPriv *ctx);
 } Demuxer;
 
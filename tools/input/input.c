@@ -41,7 +41,7 @@ struct DemuxerContext {
     const Demuxer *impl;
 };
 
-#define MAX_NUM_DEMUXERS 1
+#define MAX_NUM_DEMUXERS 3
 static const Demuxer *demuxers[MAX_NUM_DEMUXERS];
 static int num_demuxers = 0;
 
@@ -53,6 +53,8 @@ static int num_demuxers = 0;
 
 void init_demuxers(void) {
     register_demuxer(ivf_demuxer);
+    register_demuxer(annexb_demuxer);
+    register_demuxer(section5_demuxer);
 }
 
 static const char *find_extension(const char *const f) {
@@ -72,30 +74,44 @@ static const char *find_extension(const char *const f) {
            &step[1] : NULL;
 }
 
-int input_open(DemuxerContext **const c_out, const char *const filename,
+int input_open(DemuxerContext **const c_out,
+               const char *const name, const char *const filename,
                unsigned fps[2], unsigned *const num_frames)
 {
     const Demuxer *impl;
     DemuxerContext *c;
     int res, i;
 
-    const char *const ext = find_extension(filename);
-    if (!ext) {
-        fprintf(stderr, "No extension found for file %s\n", filename);
-        return -1;
-    }
+    if (name) {
+        for (i = 0; i < num_demuxers; i++) {
+            if (!strcmp(demuxers[i]->name, name)) {
+                impl = demuxers[i];
+                break;
+            }
+        }
+        if (i == num_demuxers) {
+            fprintf(stderr, "Failed to find demuxer named \"%s\"\n", name);
+            return -ENOPROTOOPT;
+        }
+    } else {
+        const char *const ext = find_extension(filename);
+        if (!ext) {
+            fprintf(stderr, "No extension found for file %s\n", filename);
+            return -1;
+        }
 
-    for (i = 0; i < num_demuxers; i++) {
-        if (!strcmp(demuxers[i]->extension, ext)) {
-            impl = demuxers[i];
-            break;
+        for (i = 0; i < num_demuxers; i++) {
+            if (!strcmp(demuxers[i]->extension, ext)) {
+                impl = demuxers[i];
+                break;
+            }
+        }
+        if (i == num_demuxers) {
+            fprintf(stderr,
+                    "Failed to find demuxer for file %s (\"%s\")\n",
+                    filename, ext);
+            return -ENOPROTOOPT;
         }
-    }
-    if (i == num_demuxers) {
-        fprintf(stderr,
-                "Failed to find demuxer for file %s (\"%s\")\n",
-                filename, ext);
-        return -ENOPROTOOPT;
     }
 
     if (!(c = malloc(sizeof(DemuxerContext) + impl->priv_data_size))) {
@@ -114,8 +130,14 @@ int input_open(DemuxerContext **const c_out, const char *const filename,
     return 0;
 }
 
-int input_read(DemuxerContext *const ctx, Dav1dData *const data) {
-    return ctx->impl->read(ctx->data, data);
+int input_read(DemuxerContext *const ctx, Dav1dData *const data,
+               uint64_t *const pts)
+{
+    return ctx->impl->read(ctx->data, data, pts);
+}
+
+int input_seek(DemuxerContext *const ctx, const unsigned frame) {
+    return ctx->impl->seek ? ctx->impl->seek(ctx->data, frame) : -ENOSYS;
 }
 
 void input_close(DemuxerContext *const ctx) {
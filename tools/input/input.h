@@ -33,9 +33,10 @@
 typedef struct DemuxerContext DemuxerContext;
 
 void init_demuxers(void);
-int input_open(DemuxerContext **c, const char *filename,
+int input_open(DemuxerContext **c, const char *name, const char *filename,
                unsigned fps[2], unsigned *num_frames);
-int input_read(DemuxerContext *ctx, Dav1dData *data);
+int input_read(DemuxerContext *ctx, Dav1dData *data, uint64_t *pts);
+int input_seek(DemuxerContext *ctx, unsigned frame);
 void input_close(DemuxerContext *ctx);
 
 #endif /* __DAV1D_INPUT_INPUT_H__ */
@@ -34,14 +34,83 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef HAVE_MMAP
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #include "common/intops.h"
 
 #include "input/demuxer.h"
+#include "input/parse.h"
+
+#ifdef HAVE_MMAP
+// The mapped file, which the packets handed out point into; it is unmapped
+// once the demuxer is closed and the decoder has released all of them.
+typedef struct IvfMapping {
+    uint8_t *data;
+    size_t sz;
+    atomic_int ref_cnt;
+} IvfMapping;
+
+static void mapping_unref(IvfMapping *const m) {
+    if (atomic_fetch_sub(&m->ref_cnt, 1) == 1) {
+        munmap(m->data, m->sz);
+        free(m);
+    }
+}
+
+static void free_packet(uint8_t *const data, void *const user_data) {
+    mapping_unref(user_data);
+}
+#endif
+
+typedef struct IvfKeyframe {
+    unsigned frame;
+    uint64_t pos; // of its frame header
+} IvfKeyframe;
 
 typedef struct DemuxerPriv {
     FILE *f;
+#ifdef HAVE_MMAP
+    IvfMapping *map; // NULL if the file could not be mapped (e.g. a pipe)
+    size_t pos; // of the next frame header in map
+#endif
+    double timebase; // in nanoseconds
+    // index of the keyframes, built by ivf_seek(), which has scanned the
+    // frame headers up to frame scan_frame (at scan_pos) so far
+    IvfKeyframe *kf;
+    unsigned n_kf, n_kf_alloc, scan_frame;
+    uint64_t scan_pos;
 } IvfInputContext;
 
+#ifdef HAVE_MMAP
+// Maps the file, if it is a regular one, so that packets can be handed out
+// without copying them.
+static void map_file(IvfInputContext *const c) {
+    struct stat st;
+
+    if (fstat(fileno(c->f), &st) || !S_ISREG(st.st_mode) || st.st_size <= 32)
+        return;
+    const size_t sz = (size_t) st.st_size;
+    if ((off_t) sz != st.st_size) return; // too large for our address space
+
+    IvfMapping *const m = malloc(sizeof(*m));
+    if (!m) return;
+    m->data = mmap(NULL, sz, PROT_READ, MAP_PRIVATE, fileno(c->f), 0);
+    if (m->data == MAP_FAILED) {
+        free(m);
+        return;
+    }
+    posix_madvise(m->data, sz, POSIX_MADV_SEQUENTIAL);
+    m->sz = sz;
+    atomic_init(&m->ref_cnt, 1);
+    c->map = m;
+    c->pos = 32;
+}
+#endif
+
 static int ivf_open(IvfInputContext *const c, const char *const file,
                     unsigned fps[2], unsigned *const num_frames)
 {
@@ -49,48 +118,68 @@ static int ivf_open(IvfInputContext *const c, const char *const file,
     uint8_t hdr[32];
 
     memset(c, 0, sizeof(*c));
-    if (!(c->f = fopen(file, "rb"))) {
-        fprintf(stderr, "Failed to open %s: %s\n", file, strerror(errno));
+    if (!(c->f = open_input(file))) {
         return -1;
     } else if ((res = fread(hdr, 32, 1, c->f)) != 1) {
         fprintf(stderr, "Failed to read stream header: %s\n", strerror(errno));
-        fclose(c->f);
+        close_input(c->f);
         return -1;
     } else if (memcmp(hdr, "DKIF", 4)) {
         fprintf(stderr, "%s is not an IVF file [tag=%4s|0x%02x%02x%02x%02x]\n",
                 file, hdr, hdr[0], hdr[1], hdr[2], hdr[3]);
-        fclose(c->f);
+        close_input(c->f);
         return -1;
     } else if (memcmp(&hdr[8], "AV01", 4)) {
         fprintf(stderr, "%s is not an AV1 file [tag=%4s|0x%02x%02x%02x%02x]\n",
                 file, &hdr[8], hdr[8], hdr[9], hdr[10], hdr[11]);
-        fclose(c->f);
+        close_input(c->f);
         return -1;
     }
 
     fps[0] = rl32(&hdr[16]);
     fps[1] = rl32(&hdr[20]);
-    const unsigned duration = rl32(&hdr[24]);
-    uint8_t data[4];
-    for (*num_frames = 0;; (*num_frames)++) {
-        if ((res = fread(data, 4, 1, c->f)) != 1)
-            break; // EOF
-        fseek(c->f, rl32(data) + 8, SEEK_CUR);
-    }
-    fps[0] *= *num_frames;
-    fps[1] *= duration;
-    fseek(c->f, 32, SEEK_SET);
+    c->timebase = fps[0] && fps[1] ? 1e9 * fps[1] / fps[0] : 1e9 / 25;
+    // rather than scanning the file, which would delay decoding and does
+    // not work for pipes, trust the frame count of the header, if set
+    *num_frames = rl32(&hdr[24]);
+    if (!*num_frames) *num_frames = 0xFFFFFFFFU;
+#ifdef HAVE_MMAP
+    map_file(c);
+#endif
 
     return 0;
 }
 
-static int ivf_read(IvfInputContext *const c, Dav1dData *const buf) {
-    uint8_t data[4];
+static int ivf_read(IvfInputContext *const c, Dav1dData *const buf,
+                    uint64_t *const pts)
+{
+    uint8_t data[12];
     int res;
 
-    if ((res = fread(data, 4, 1, c->f)) != 1)
+#ifdef HAVE_MMAP
+    if (c->map) {
+        IvfMapping *const m = c->map;
+        if (m->sz - c->pos < 12)
+            return -1; // EOF
+        size_t sz = rl32(&m->data[c->pos]);
+        *pts = (uint64_t) (rl64(&m->data[c->pos + 4]) * c->timebase);
+        c->pos += 12;
+        if (sz > m->sz - c->pos) {
+            fprintf(stderr, "Failed to read frame data: truncated file\n");
+            sz = m->sz - c->pos;
+        }
+        atomic_fetch_add(&m->ref_cnt, 1);
+        if (dav1d_data_wrap(buf, &m->data[c->pos], sz, free_packet, m) < 0) {
+            mapping_unref(m);
+            return -1;
+        }
+        c->pos += sz;
+        return 0;
+    }
+#endif
+    if ((res = fread(data, 12, 1, c->f)) != 1)
         return -1; // EOF
-    fseek(c->f, 8, SEEK_CUR); // skip timestamp
+    *pts = (uint64_t) (rl64(&data[4]) * c->timebase);
     const ptrdiff_t sz = rl32(data);
     dav1d_data_create(buf, sz);
     if ((res = fread(buf->data, sz, 1, c->f)) != 1)
@@ -99,8 +188,132 @@ static int ivf_read(IvfInputContext *const c, Dav1dData *const buf) {
     return 0;
 }
 
+// bytes of each frame looked at by ivf_seek(), which typically cover the
+// sequence and frame header of keyframes
+#define SNIFF_SZ 256
+
+// Whether decoding can start at the temporal unit of which the first sz
+// bytes are in buf: it carries a sequence header and a shown key frame.
+static int is_keyframe(const uint8_t *buf, size_t sz) {
+    int seq_hdr = 0, reduced_still_picture_hdr = 0;
+
+    while (sz) {
+        const int type = (buf[0] >> 3) & 0xf;
+        size_t len = 1 + ((buf[0] >> 2) & 1), obu_sz = 0;
+        if (!(buf[0] & 2)) return 0; // no obu_size, which IVF requires
+        unsigned i = 0, more;
+        do {
+            if (len >= sz) return 0;
+            more = buf[len] & 0x80;
+            obu_sz |= (size_t) (buf[len++] & 0x7f) << (i * 7);
+        } while (more && ++i < 8);
+        if (more) return 0;
+
+        switch (type) {
+        case OBU_TYPE_SEQ_HDR:
+            if (len >= sz) return 0;
+            seq_hdr = 1;
+            // after seq_profile (3 bits) and still_picture (1 bit)
+            reduced_still_picture_hdr = (buf[len] >> 3) & 1;
+            break;
+        case OBU_TYPE_FRAME_HDR:
+        case OBU_TYPE_FRAME:
+            if (!seq_hdr || len >= sz) return 0;
+            if (reduced_still_picture_hdr) return 1;
+            // show_existing_frame = 0, frame_type = KEY_FRAME (0) and
+            // show_frame = 1
+            return (buf[len] & 0xf0) == 0x10;
+        }
+        if (obu_sz >= sz - len) return 0;
+        buf += len + obu_sz;
+        sz -= len + obu_sz;
+    }
+
+    return 0;
+}
+
+// Extends the keyframe index up to and including frame, or the end of the
+// file, reading only the frame headers and the start of each frame.
+static int scan_frames(IvfInputContext *const c, const unsigned frame) {
+    uint8_t data[12 + SNIFF_SZ];
+
+    if (!c->scan_pos) c->scan_pos = 32;
+    for (; c->scan_frame <= frame; c->scan_frame++) {
+        const uint8_t *hdr = data;
+        size_t avail;
+#ifdef HAVE_MMAP
+        if (c->map) {
+            const IvfMapping *const m = c->map;
+            if (m->sz - c->scan_pos < 12) break;
+            hdr = &m->data[c->scan_pos];
+            avail = m->sz - c->scan_pos - 12;
+        } else
+#endif
+        {
+            if (fseek(c->f, (long) c->scan_pos, SEEK_SET) ||
+                (avail = fread(data, 1, sizeof(data), c->f)) < 12)
+            {
+                break;
+            }
+            avail -= 12;
+        }
+        const size_t sz = rl32(hdr);
+        if (is_keyframe(&hdr[12], sz < avail ? sz : avail)) {
+            if (c->n_kf == c->n_kf_alloc) {
+                const unsigned n = c->n_kf_alloc ? c->n_kf_alloc * 2 : 64;
+                IvfKeyframe *const kf = realloc(c->kf, n * sizeof(*kf));
+                if (!kf) return -1;
+                c->kf = kf;
+                c->n_kf_alloc = n;
+            }
+            c->kf[c->n_kf].frame = c->scan_frame;
+            c->kf[c->n_kf++].pos = c->scan_pos;
+        }
+        c->scan_pos += 12 + sz;
+    }
+
+    return 0;
+}
+
+static int ivf_seek(IvfInputContext *const c, const unsigned frame) {
+    long cur = -1;
+
+#ifdef HAVE_MMAP
+    if (!c->map)
+#endif
+    if ((cur = ftell(c->f)) < 0) return -1; // a pipe
+
+    if (scan_frames(c, frame)) {
+        if (cur >= 0) fseek(c->f, cur, SEEK_SET);
+        return -1;
+    }
+    // the first frame, if it was not recognized as a keyframe
+    IvfKeyframe kf = { .frame = 0, .pos = 32 };
+    for (unsigned n = c->n_kf; n > 0; n--)
+        if (c->kf[n - 1].frame <= frame) {
+            kf = c->kf[n - 1];
+            break;
+        }
+
+#ifdef HAVE_MMAP
+    if (c->map) {
+        c->pos = (size_t) kf.pos;
+        return kf.frame;
+    }
+#endif
+    if (fseek(c->f, (long) kf.pos, SEEK_SET)) {
+        fseek(c->f, cur, SEEK_SET);
+        return -1;
+    }
+    return kf.frame;
+}
+
 static void ivf_close(IvfInputContext *const c) {
-    fclose(c->f);
+#ifdef HAVE_MMAP
+    if (c->map) mapping_unref(c->map);
+#endif
+    free(c->kf);
+    close_input(c->f);
 }
 
 const Demuxer ivf_demuxer = {
@@ -109,5 +322,6 @@ const Demuxer ivf_demuxer = {
     .extension = "ivf",
     .open = ivf_open,
     .read = ivf_read,
+    .seek = ivf_seek,
     .close = ivf_close,
 };
@@ -0,0 +1,87 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __DAV1D_INPUT_PARSE_H__
+#define __DAV1D_INPUT_PARSE_H__
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define OBU_TYPE_SEQ_HDR 1
+#define OBU_TYPE_TD 2 // temporal delimiter, starting each temporal unit
+#define OBU_TYPE_FRAME_HDR 3
+#define OBU_TYPE_FRAME 6
+
+// Reads an unsigned LEB128 value (as used for OBU sizes) from f into *val,
+// setting *len to the number of bytes it takes, which are also copied to
+// raw unless it is NULL. Returns 0, or -1 at the end of the file or if the
+// value is invalid.
+static inline int leb128(FILE *const f, size_t *const val, uint8_t *const raw,
+                         size_t *const len)
+{
+    uint64_t v = 0;
+    unsigned i = 0, more;
+
+    do {
+        uint8_t byte;
+        if (fread(&byte, 1, 1, f) < 1) return -1;
+        if (raw) raw[i] = byte;
+        more = byte & 0x80;
+        v |= (uint64_t) (byte & 0x7f) << (i * 7);
+    } while (more && ++i < 8);
+    if (more || v > SIZE_MAX) return -1;
+
+    *val = (size_t) v;
+    *len = i + 1;
+    return 0;
+}
+
+// Opens the input file, or standard input for "-".
+static inline FILE *open_input(const char *const file) {
+    if (!strcmp(file, "-")) return stdin;
+
+    FILE *const f = fopen(file, "rb");
+    if (!f)
+        fprintf(stderr, "Failed to open %s: %s\n", file, strerror(errno));
+    return f;
+}
+
+static inline void close_input(FILE *const f) {
+    if (f != stdin)
+        fclose(f);
+}
+
+// Whether the input can be scanned ahead (e.g. to count frames) and
+// rewound; pipes cannot.
+static inline int is_seekable(FILE *const f) {
+    return !fseek(f, 0, SEEK_CUR);
+}
+
+#endif /* __DAV1D_INPUT_PARSE_H__ */
@@ -0,0 +1,169 @@
+/*
+ * Copyright © 2018, VideoLAN and dav1d authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "input/demuxer.h"
+#include "input/parse.h"
+
+// Low overhead bitstream format (AV1 spec section 5): a plain sequence of
+// OBUs with size fields. These are handed to the decoder one temporal unit
+// (i.e. from one temporal delimiter to the next) at a time. The input is
+// read sequentially, so that it can be a pipe.
+typedef struct DemuxerPriv {
+    FILE *f;
+    uint8_t *buf; // OBUs read ahead, i.e. the next temporal unit's delimiter
+    size_t buf_len, buf_sz;
+    unsigned temporal_unit; // index of the next one
+} Section5InputContext;
+
+// Reads the header of the next OBU, and returns its type, with *sz set to
+// its total size, or -1 at the end of the file or on error.
+static int read_obu_header(FILE *const f, size_t *const sz) {
+    uint8_t byte[2];
+    size_t obu_sz, len;
+
+    if (fread(&byte[0], 1, 1, f) < 1) return -1;
+    const int has_extension = (byte[0] >> 2) & 1;
+    const int has_length_field = (byte[0] >> 1) & 1;
+    if (!has_length_field) return -1;
+    if (has_extension && fread(&byte[1], 1, 1, f) < 1) return -1;
+    if (leb128(f, &obu_sz, NULL, &len)) return -1;
+
+    *sz = 1 + has_extension + len + obu_sz;
+    return (byte[0] >> 3) & 0xf;
+}
+
+// Appends the next OBU to c->buf, and returns its type, or -1 at the end
+// of the file or on error.
+static int read_obu(Section5InputContext *const c) {
+    uint8_t hdr[2 + 8]; // header, extension and size field
+    size_t obu_sz, len;
+
+    if (fread(&hdr[0], 1, 1, c->f) < 1) return -1;
+    const int has_extension = (hdr[0] >> 2) & 1;
+    const int has_length_field = (hdr[0] >> 1) & 1;
+    if (!has_length_field) return -1;
+    if (has_extension && fread(&hdr[1], 1, 1, c->f) < 1) return -1;
+    if (leb128(c->f, &obu_sz, &hdr[1 + has_extension], &len)) return -1;
+
+    const size_t hdr_sz = 1 + has_extension + len;
+    if (obu_sz > SIZE_MAX - hdr_sz - c->buf_len) return -1;
+    const size_t sz = c->buf_len + hdr_sz + obu_sz;
+    if (sz > c->buf_sz) {
+        const size_t buf_sz = sz > 2 * c->buf_sz ? sz : 2 * c->buf_sz;
+        uint8_t *const buf = realloc(c->buf, buf_sz);
+        if (!buf) return -1;
+        c->buf = buf;
+        c->buf_sz = buf_sz;
+    }
+    memcpy(&c->buf[c->buf_len], hdr, hdr_sz);
+    if (obu_sz && fread(&c->buf[c->buf_len + hdr_sz], obu_sz, 1, c->f) != 1)
+        return -1;
+    c->buf_len = sz;
+
+    return (hdr[0] >> 3) & 0xf;
+}
+
+static int section5_open(Section5InputContext *const c, const char *const file,
+                         unsigned fps[2], unsigned *const num_frames)
+{
+    size_t sz;
+    int type;
+
+    memset(c, 0, sizeof(*c));
+    if (!(c->f = open_input(file)))
+        return -1;
+
+    if (read_obu(c) != OBU_TYPE_TD) {
+        fprintf(stderr, "%s is not a raw OBU (section 5) file\n", file);
+        free(c->buf);
+        close_input(c->f);
+        return -1;
+    }
+
+    // there is no timing information; count the temporal units (unless
+    // streaming), which are given timestamps at 25 fps
+    fps[0] = 25;
+    fps[1] = 1;
+    if (!is_seekable(c->f)) {
+        *num_frames = 0xFFFFFFFFU;
+        return 0;
+    }
+    const long start = ftell(c->f);
+    *num_frames = 1;
+    for (long pos = start; (type = read_obu_header(c->f, &sz)) >= 0; pos += sz) {
+        *num_frames += type == OBU_TYPE_TD;
+        if (fseek(c->f, pos + sz, SEEK_SET)) break;
+    }
+    fseek(c->f, start, SEEK_SET);
+
+    return 0;
+}
+
+static int section5_read(Section5InputContext *const c, Dav1dData *const buf,
+                         uint64_t *const pts)
+{
+    size_t end;
+    int type;
+
+    // the temporal delimiter was read ahead
+    if (!c->buf_len) return -1; // EOF
+
+    // find the end of the temporal unit, reading ahead the next delimiter
+    do {
+        end = c->buf_len;
+        type = read_obu(c);
+    } while (type >= 0 && type != OBU_TYPE_TD);
+
+    if (dav1d_data_create(buf, end) < 0) return -1;
+    memcpy(buf->data, c->buf, end);
+    memmove(c->buf, &c->buf[end], c->buf_len - end);
+    c->buf_len -= end;
+    *pts = c->temporal_unit++ * 40000000ULL;
+
+    return 0;
+}
+
+static void section5_close(Section5InputContext *const c) {
+    free(c->buf);
+    close_input(c->f);
+}
+
+const Demuxer section5_demuxer = {
+    .priv_data_size = sizeof(Section5InputContext),
+    .name = "section5",
+    .extension = "obu",
+    .open = section5_open,
+    .read = section5_read,
+    .close = section5_close,
+};
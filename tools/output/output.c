@@ -33,15 +33,29 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "src/thread.h"
+
 #include "output/output.h"
 #include "output/muxer.h"
 
+// Pictures are written by a separate thread, so that I/O overlaps with
+// decoding; the decoder only blocks once this many are waiting.
+#define OUTPUT_QUEUE_SIZE 8
+
 struct MuxerContext {
     MuxerPriv *data;
     const Muxer *impl;
+
+    int threaded;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    Dav1dPicture queue[OUTPUT_QUEUE_SIZE];
+    int first, n; // n includes the picture being written
+    int eos, error;
 };
 
-#define MAX_NUM_MUXERS 3
+#define MAX_NUM_MUXERS 5
 static const Muxer *muxers[MAX_NUM_MUXERS];
 static int num_muxers = 0;
 
@@ -53,8 +67,10 @@ static int num_muxers = 0;
 
 void init_muxers(void) {
     register_muxer(md5_muxer);
+    register_muxer(null_muxer);
     register_muxer(yuv_muxer);
     register_muxer(y4m2_muxer);
+    register_muxer(xxh64_muxer);
 }
 
 static const char *find_extension(const char *const f) {
@@ -74,6 +90,35 @@ static const char *find_extension(const char *const f) {
            &step[1] : NULL;
 }
 
+static void *output_thread(void *const data) {
+    MuxerContext *const c = data;
+
+    pthread_mutex_lock(&c->lock);
+    for (;;) {
+        while (!c->n && !c->eos)
+            pthread_cond_wait(&c->cond, &c->lock);
+        if (!c->n) break;
+
+        Dav1dPicture p = c->queue[c->first];
+        const int error = c->error;
+        pthread_mutex_unlock(&c->lock);
+        int res = 0;
+        if (error) // keep draining the queue after a failure
+            dav1d_picture_unref(&p);
+        else
+            res = c->impl->write_picture(c->data, &p);
+        pthread_mutex_lock(&c->lock);
+
+        if (res < 0) c->error = res;
+        c->first = (c->first + 1) % OUTPUT_QUEUE_SIZE;
+        c->n--;
+        pthread_cond_signal(&c->cond);
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    return NULL;
+}
+
 int output_open(MuxerContext **const c_out,
                 const char *const name, const char *const filename,
                 const Dav1dPictureParameters *const p, const unsigned fps[2])
@@ -121,6 +166,12 @@ int output_open(MuxerContext **const c_out,
         free(c);
         return res;
     }
+
+    c->first = c->n = c->eos = c->error = 0;
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->cond, NULL);
+    // fall back to writing from the calling thread
+    c->threaded = !pthread_create(&c->thread, NULL, output_thread, c);
     *c_out = c;
 
     return 0;
@@ -129,13 +180,42 @@ int output_open(MuxerContext **const c_out,
 int output_write(MuxerContext *const ctx, Dav1dPicture *const p) {
     int res;
 
-    if ((res = ctx->impl->write_picture(ctx->data, p)) < 0)
+    if (!ctx->threaded) {
+        if ((res = ctx->impl->write_picture(ctx->data, p)) < 0)
+            return res;
+
+        return 0;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    while (ctx->n == OUTPUT_QUEUE_SIZE && !ctx->error)
+        pthread_cond_wait(&ctx->cond, &ctx->lock);
+    if ((res = ctx->error) < 0) {
+        pthread_mutex_unlock(&ctx->lock);
+        dav1d_picture_unref(p);
         return res;
+    }
+    ctx->queue[(ctx->first + ctx->n++) % OUTPUT_QUEUE_SIZE] = *p;
+    memset(p, 0, sizeof(*p));
+    pthread_cond_signal(&ctx->cond);
+    pthread_mutex_unlock(&ctx->lock);
 
     return 0;
 }
 
-void output_close(MuxerContext *const ctx) {
+int output_close(MuxerContext *const ctx) {
+    if (ctx->threaded) {
+        pthread_mutex_lock(&ctx->lock);
+        ctx->eos = 1;
+        pthread_cond_signal(&ctx->cond);
+        pthread_mutex_unlock(&ctx->lock);
+        pthread_join(ctx->thread, NULL);
+    }
+    const int res = ctx->error;
+    pthread_cond_destroy(&ctx->cond);
+    pthread_mutex_destroy(&ctx->lock);
     ctx->impl->write_trailer(ctx->data);
     free(ctx);
+
+    return res;
 }
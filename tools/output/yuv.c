@@ -53,16 +53,25 @@ static int yuv_open(YuvOutputContext *const c, const char *const file,
     return 0;
 }
 
+// Writes a plane of w bytes by h lines, in a single call when it has no
+// padding between the lines.
+static int write_plane(FILE *const f, const uint8_t *ptr,
+                       const ptrdiff_t stride, const int w, const int h)
+{
+    if (stride == w)
+        return fwrite(ptr, (size_t) w * h, 1, f) == 1 ? 0 : -1;
+    for (int y = 0; y < h; y++, ptr += stride)
+        if (fwrite(ptr, w, 1, f) != 1)
+            return -1;
+
+    return 0;
+}
+
 static int yuv_write(YuvOutputContext *const c, Dav1dPicture *const p) {
-    uint8_t *ptr;
     const int hbd = p->p.bpc > 8;
 
-    ptr = p->data[0];
-    for (int y = 0; y < p->p.h; y++) {
-        if (fwrite(ptr, p->p.w << hbd, 1, c->f) != 1)
-            goto error;
-        ptr += p->stride[0];
-    }
+    if (write_plane(c->f, p->data[0], p->stride[0], p->p.w << hbd, p->p.h))
+        goto error;
 
     if (p->p.layout != DAV1D_PIXEL_LAYOUT_I400) {
         // u/v
@@ -70,14 +79,9 @@ static int yuv_write(YuvOutputContext *const c, Dav1dPicture *const p) {
         const int ss_hor = p->p.layout != DAV1D_PIXEL_LAYOUT_I444;
         const int cw = (p->p.w + ss_hor) >> ss_hor;
         const int ch = (p->p.h + ss_ver) >> ss_ver;
-        for (int pl = 1; pl <= 2; pl++) {
-            ptr = p->data[pl];
-            for (int y = 0; y < ch; y++) {
-                if (fwrite(ptr, cw << hbd, 1, c->f) != 1)
-                    goto error;
-                ptr += p->stride[1];
-            }
-        }
+        for (int pl = 1; pl <= 2; pl++)
+            if (write_plane(c->f, p->data[pl], p->stride[1], cw << hbd, ch))
+                goto error;
     }
 
     dav1d_picture_unref(p);